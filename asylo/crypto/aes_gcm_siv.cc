@@ -18,11 +18,9 @@
 
 #include "asylo/crypto/aes_gcm_siv.h"
 
-#include <openssl/rand.h>
 #include <string>
 
-#include "absl/strings/str_cat.h"
-#include "asylo/crypto/util/bssl_util.h"
+#include "asylo/crypto/chacha20_drbg.h"
 #include "asylo/util/status.h"
 
 namespace asylo {
@@ -30,11 +28,7 @@ namespace asylo {
 Status AesGcmSivNonceGenerator::NextNonce(
     const std::vector<uint8_t> &key_id,
     AesGcmSivNonceGenerator::AesGcmSivNonce *nonce) {
-  if (RAND_bytes(nonce->data(), nonce->size()) != 1) {
-    return Status(error::GoogleError::INTERNAL,
-                  absl::StrCat("RAND_bytes failed", BsslLastErrorString()));
-  }
-  return Status::OkStatus();
+  return BufferedRandomBytes(nonce->data(), nonce->size());
 }
 
 }  // namespace asylo
@@ -0,0 +1,136 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/crypto/chacha20_drbg.h"
+
+#include <openssl/chacha.h>
+#include <openssl/mem.h>
+#include <openssl/rand.h>
+#ifndef __ASYLO__
+#include <pthread.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#include "absl/base/attributes.h"
+#include "absl/strings/str_cat.h"
+#include "asylo/crypto/util/bssl_util.h"
+#include "asylo/util/status_macros.h"
+
+namespace asylo {
+namespace {
+
+// The nonce passed to ChaCha20. A fixed nonce is safe because every refill
+// uses a fresh key.
+constexpr uint8_t kNonce[12] = {};
+
+// Incremented by ChaCha20Drbg::ReseedAll(). A generator whose generation does
+// not match reseeds before producing output. Starts at one so that a generator
+// that has never been seeded never matches.
+ABSL_CONST_INIT std::atomic<uint64_t> reseed_generation(1);
+
+#ifndef __ASYLO__
+// Makes the children of fork() reseed every generator they inherit.
+void RegisterForkHandler() {
+  static const int registered =
+      pthread_atfork(/*prepare=*/nullptr, /*parent=*/nullptr,
+                     /*child=*/&ChaCha20Drbg::ReseedAll);
+  (void)registered;
+}
+#endif  // __ASYLO__
+
+Status RandBytesSeedSource(uint8_t *seed, size_t size) {
+  if (RAND_bytes(seed, size) != 1) {
+    return Status(error::GoogleError::INTERNAL,
+                  absl::StrCat("RAND_bytes failed: ", BsslLastErrorString()));
+  }
+  return Status::OkStatus();
+}
+
+ABSL_CONST_INIT thread_local ChaCha20Drbg buffered_drbg(RandBytesSeedSource);
+
+}  // namespace
+
+constexpr size_t ChaCha20Drbg::kKeySize;
+constexpr size_t ChaCha20Drbg::kBufferSize;
+constexpr uint64_t ChaCha20Drbg::kReseedInterval;
+
+Status ChaCha20Drbg::Generate(uint8_t *output, size_t size) {
+  if (generation_ != reseed_generation.load(std::memory_order_acquire) ||
+      bytes_since_reseed_ >= kReseedInterval) {
+    ASYLO_RETURN_IF_ERROR(Reseed());
+  }
+
+  bytes_since_reseed_ += size;
+  while (size > 0) {
+    if (available_ == 0) {
+      Refill();
+    }
+    size_t chunk = std::min(size, available_);
+    uint8_t *source = buffer_ + kBufferSize - available_;
+    memcpy(output, source, chunk);
+    OPENSSL_cleanse(source, chunk);
+    available_ -= chunk;
+    output += chunk;
+    size -= chunk;
+  }
+  return Status::OkStatus();
+}
+
+void ChaCha20Drbg::ReseedAll() {
+  reseed_generation.fetch_add(1, std::memory_order_acq_rel);
+}
+
+Status ChaCha20Drbg::Reseed() {
+  uint64_t generation = reseed_generation.load(std::memory_order_acquire);
+  uint8_t seed[kKeySize];
+  Status status = seed_source_(seed, sizeof(seed));
+  if (status.ok()) {
+    // Mix the seed into the key instead of replacing it, so that a weak seed
+    // never makes the generator weaker than it already was.
+    for (size_t i = 0; i < kKeySize; ++i) {
+      key_[i] ^= seed[i];
+    }
+    OPENSSL_cleanse(buffer_, sizeof(buffer_));
+    available_ = 0;
+    generation_ = generation;
+    bytes_since_reseed_ = 0;
+#ifndef __ASYLO__
+    RegisterForkHandler();
+#endif  // __ASYLO__
+  }
+  OPENSSL_cleanse(seed, sizeof(seed));
+  return status;
+}
+
+void ChaCha20Drbg::Refill() {
+  memset(buffer_, 0, sizeof(buffer_));
+  CRYPTO_chacha_20(buffer_, buffer_, sizeof(buffer_), key_, kNonce,
+                   /*counter=*/0);
+  memcpy(key_, buffer_, kKeySize);
+  OPENSSL_cleanse(buffer_, kKeySize);
+  available_ = kBufferSize - kKeySize;
+}
+
+Status BufferedRandomBytes(uint8_t *output, size_t size) {
+  return buffered_drbg.Generate(output, size);
+}
+
+}  // namespace asylo
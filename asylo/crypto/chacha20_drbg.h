@@ -0,0 +1,117 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_CRYPTO_CHACHA20_DRBG_H_
+#define ASYLO_CRYPTO_CHACHA20_DRBG_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "asylo/util/status.h"
+
+namespace asylo {
+
+// ChaCha20Drbg is a deterministic random bit generator that stretches a small
+// seed into an arbitrary amount of output using the ChaCha20 stream cipher with
+// fast key erasure.
+//
+// Output is produced kBufferSize bytes at a time. Each refill runs ChaCha20
+// under the current key, replaces the key with the first kKeySize bytes of the
+// keystream, and buffers the rest. Bytes are wiped from the buffer as they are
+// handed out, so a later compromise of the generator does not reveal any output
+// it has already produced.
+//
+// The generator draws kKeySize bytes from its seed source before its first
+// output, after every kReseedInterval bytes of output, and after every call to
+// ReseedAll(). Expensive entropy sources such as RDSEED are therefore consulted
+// once per kReseedInterval bytes instead of once per request.
+//
+// A ChaCha20Drbg is not thread-safe. It is constant-initialized and trivially
+// destructible so that it can be kept in an ABSL_CONST_INIT thread_local
+// variable, giving each thread its own lock-free generator.
+class ChaCha20Drbg {
+ public:
+  // A function that fills |seed| with |size| bytes of entropy.
+  using SeedSource = Status (*)(uint8_t *seed, size_t size);
+
+  // The size of the ChaCha20 key, which is also the size of each seed.
+  static constexpr size_t kKeySize = 32;
+
+  // The number of keystream bytes generated by each refill, including the
+  // kKeySize bytes used as the next key.
+  static constexpr size_t kBufferSize = 512;
+
+  // The number of output bytes after which the generator reseeds.
+  static constexpr uint64_t kReseedInterval = 1 << 20;
+
+  // Creates a generator that seeds itself from |seed_source| on first use.
+  constexpr explicit ChaCha20Drbg(SeedSource seed_source)
+      : seed_source_(seed_source),
+        generation_(0),
+        bytes_since_reseed_(0),
+        available_(0),
+        key_{},
+        buffer_{} {}
+
+  ChaCha20Drbg(const ChaCha20Drbg &other) = delete;
+  ChaCha20Drbg &operator=(const ChaCha20Drbg &other) = delete;
+
+  // Fills |output| with |size| random bytes. Returns the error of the seed
+  // source if the generator had to reseed and the seed source failed, in which
+  // case no output is produced.
+  Status Generate(uint8_t *output, size_t size);
+
+  // Forces every ChaCha20Drbg in the process to reseed before producing any
+  // more output. This must be called in a copy of a process or enclave, such as
+  // the child of fork() or an enclave restored from a snapshot, so that the
+  // copies do not produce the same output. On the host this is done
+  // automatically in the child of fork().
+  static void ReseedAll();
+
+ private:
+  // Mixes kKeySize bytes from the seed source into the key and discards any
+  // buffered output.
+  Status Reseed();
+
+  // Refills the buffer and replaces the key.
+  void Refill();
+
+  SeedSource seed_source_;
+
+  // The value of the process-wide reseed generation when this generator last
+  // reseeded, or zero if it has never been seeded.
+  uint64_t generation_;
+
+  uint64_t bytes_since_reseed_;
+
+  // The number of unused bytes at the end of |buffer_|.
+  size_t available_;
+
+  uint8_t key_[kKeySize];
+  uint8_t buffer_[kBufferSize];
+};
+
+// Fills |output| with |size| random bytes from a per-thread ChaCha20Drbg that
+// is seeded from RAND_bytes(). This is meant for callers that draw small values
+// such as nonces on every operation: RAND_bytes() mixes fresh entropy into each
+// call, which makes it far slower than this generator for small requests.
+Status BufferedRandomBytes(uint8_t *output, size_t size);
+
+}  // namespace asylo
+
+#endif  // ASYLO_CRYPTO_CHACHA20_DRBG_H_
@@ -0,0 +1,172 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/crypto/chacha20_drbg.h"
+
+#include <openssl/chacha.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/util/status.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::Each;
+using ::testing::Eq;
+using ::testing::Ne;
+using ::testing::Not;
+
+constexpr uint8_t kSeedByte = 0x5a;
+
+// The number of times FakeSeedSource() has been called.
+int seed_calls = 0;
+
+// Whether FakeSeedSource() fails.
+bool fail_seeding = false;
+
+// Fills |seed| with kSeedByte, or fails if |fail_seeding| is set.
+Status FakeSeedSource(uint8_t *seed, size_t size) {
+  ++seed_calls;
+  if (fail_seeding) {
+    return Status(error::GoogleError::UNAVAILABLE, "No entropy");
+  }
+  memset(seed, kSeedByte, size);
+  return Status::OkStatus();
+}
+
+class ChaCha20DrbgTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    seed_calls = 0;
+    fail_seeding = false;
+  }
+};
+
+// Returns the output of ChaCha20 under |key| from the start of the keystream.
+std::vector<uint8_t> Keystream(const uint8_t *key, size_t size) {
+  static constexpr uint8_t kNonce[12] = {};
+  std::vector<uint8_t> keystream(size, 0);
+  CRYPTO_chacha_20(keystream.data(), keystream.data(), size, key, kNonce,
+                   /*counter=*/0);
+  return keystream;
+}
+
+// Tests that the first output of a generator is the ChaCha20 keystream of its
+// seed, without the bytes used as the next key.
+TEST_F(ChaCha20DrbgTest, FirstOutputIsKeystreamOfSeed) {
+  ChaCha20Drbg drbg(FakeSeedSource);
+  std::vector<uint8_t> output(ChaCha20Drbg::kBufferSize -
+                              ChaCha20Drbg::kKeySize);
+  ASSERT_THAT(drbg.Generate(output.data(), output.size()), IsOk());
+
+  std::vector<uint8_t> seed(ChaCha20Drbg::kKeySize, kSeedByte);
+  std::vector<uint8_t> keystream =
+      Keystream(seed.data(), ChaCha20Drbg::kBufferSize);
+  EXPECT_THAT(output, Eq(std::vector<uint8_t>(
+                          keystream.begin() + ChaCha20Drbg::kKeySize,
+                          keystream.end())));
+  EXPECT_THAT(seed_calls, Eq(1));
+}
+
+// Tests that output does not depend on how it is split between calls.
+TEST_F(ChaCha20DrbgTest, OutputIsIndependentOfRequestSizes) {
+  constexpr size_t kOutputSize = 3 * ChaCha20Drbg::kBufferSize + 7;
+  ChaCha20Drbg whole_drbg(FakeSeedSource);
+  std::vector<uint8_t> whole(kOutputSize);
+  ASSERT_THAT(whole_drbg.Generate(whole.data(), whole.size()), IsOk());
+
+  ChaCha20Drbg split_drbg(FakeSeedSource);
+  std::vector<uint8_t> split(kOutputSize);
+  for (size_t offset = 0; offset < kOutputSize; offset += 13) {
+    size_t size = std::min<size_t>(13, kOutputSize - offset);
+    ASSERT_THAT(split_drbg.Generate(split.data() + offset, size), IsOk());
+  }
+  EXPECT_THAT(split, Eq(whole));
+
+  // Refills must not repeat the keystream.
+  EXPECT_THAT(std::vector<uint8_t>(whole.begin(), whole.begin() + 64),
+              Ne(std::vector<uint8_t>(
+                  whole.begin() + ChaCha20Drbg::kBufferSize -
+                      ChaCha20Drbg::kKeySize,
+                  whole.begin() + ChaCha20Drbg::kBufferSize -
+                      ChaCha20Drbg::kKeySize + 64)));
+}
+
+// Tests that a generator reseeds once it has produced kReseedInterval bytes.
+TEST_F(ChaCha20DrbgTest, ReseedsAfterInterval) {
+  ChaCha20Drbg drbg(FakeSeedSource);
+  std::vector<uint8_t> output(ChaCha20Drbg::kReseedInterval);
+  ASSERT_THAT(drbg.Generate(output.data(), output.size()), IsOk());
+  EXPECT_THAT(seed_calls, Eq(1));
+  ASSERT_THAT(drbg.Generate(output.data(), 1), IsOk());
+  EXPECT_THAT(seed_calls, Eq(2));
+  ASSERT_THAT(drbg.Generate(output.data(), 1), IsOk());
+  EXPECT_THAT(seed_calls, Eq(2));
+}
+
+// Tests that ReseedAll() makes an existing generator reseed and diverge from
+// an identical generator that has not seen the reseed.
+TEST_F(ChaCha20DrbgTest, ReseedAllForcesReseed) {
+  ChaCha20Drbg drbg(FakeSeedSource);
+  std::vector<uint8_t> output(16);
+  ASSERT_THAT(drbg.Generate(output.data(), output.size()), IsOk());
+  ChaCha20Drbg::ReseedAll();
+  ASSERT_THAT(drbg.Generate(output.data(), output.size()), IsOk());
+  EXPECT_THAT(seed_calls, Eq(2));
+
+  // The reseeded generator mixes the seed into its key, so it does not return
+  // to the output of a freshly seeded generator.
+  ChaCha20Drbg fresh_drbg(FakeSeedSource);
+  std::vector<uint8_t> fresh_output(16);
+  ASSERT_THAT(fresh_drbg.Generate(fresh_output.data(), fresh_output.size()),
+              IsOk());
+  EXPECT_THAT(output, Ne(fresh_output));
+}
+
+// Tests that a failing seed source fails generation without producing output,
+// and that the generator recovers once the seed source does.
+TEST_F(ChaCha20DrbgTest, SeedFailurePropagates) {
+  ChaCha20Drbg drbg(FakeSeedSource);
+  fail_seeding = true;
+  std::vector<uint8_t> output(16, 0);
+  EXPECT_THAT(drbg.Generate(output.data(), output.size()), Not(IsOk()));
+  EXPECT_THAT(output, Each(Eq(0)));
+
+  fail_seeding = false;
+  EXPECT_THAT(drbg.Generate(output.data(), output.size()), IsOk());
+  EXPECT_THAT(output, Not(Each(Eq(0))));
+}
+
+// Tests that BufferedRandomBytes() does not repeat itself.
+TEST(BufferedRandomBytesTest, ProducesDistinctOutput) {
+  std::vector<uint8_t> first(32);
+  std::vector<uint8_t> second(32);
+  ASSERT_THAT(BufferedRandomBytes(first.data(), first.size()), IsOk());
+  ASSERT_THAT(BufferedRandomBytes(second.data(), second.size()), IsOk());
+  EXPECT_THAT(first, Ne(second));
+}
+
+}  // namespace
+}  // namespace asylo
@@ -18,13 +18,11 @@
 
 #include "asylo/crypto/random_nonce_generator.h"
 
-#include <openssl/rand.h>
-
 #include <cstdint>
 #include <memory>
 
 #include "absl/strings/str_cat.h"
-#include "asylo/crypto/util/bssl_util.h"
+#include "asylo/crypto/chacha20_drbg.h"
 #include "asylo/util/status.h"
 
 namespace asylo {
@@ -48,11 +46,7 @@ Status RandomNonceGenerator::NextNonce(absl::Span<uint8_t> nonce) {
                   absl::StrCat("Invalid vector parameter size: ", nonce.size(),
                                " (vector size must be >= ", nonce_size_, ")"));
   }
-  if (RAND_bytes(nonce.data(), nonce_size_) != 1) {
-    return Status(error::GoogleError::INTERNAL,
-                  absl::StrCat("RAND_bytes failed: ", BsslLastErrorString()));
-  }
-  return Status::OkStatus();
+  return BufferedRandomBytes(nonce.data(), nonce_size_);
 }
 
 RandomNonceGenerator::RandomNonceGenerator(size_t size) : nonce_size_(size) {}
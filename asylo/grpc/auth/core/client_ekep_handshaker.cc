@@ -22,10 +22,12 @@
 #include <openssl/rand.h>
 
 #include <algorithm>
+#include <utility>
 
 #include <google/protobuf/io/zero_copy_stream_impl_lite.h>
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
 #include "asylo/crypto/sha256_hash.h"
 #include "asylo/util/logging.h"
 #include "asylo/grpc/auth/core/ekep_crypto.h"
@@ -58,6 +60,14 @@ ClientEkepHandshaker::ClientEkepHandshaker(const EkepHandshakerOptions &options)
       additional_authenticated_data_(options.additional_authenticated_data),
       selected_cipher_suite_(UNKNOWN_HANDSHAKE_CIPHER),
       selected_record_protocol_(UNKNOWN_RECORD_PROTOCOL),
+      session_cache_(options.session_cache),
+      session_cache_key_(
+          options.session_cache
+              ? MakeEkepResumptionContext(
+                    options.session_cache_key, options.self_assertions,
+                    options.accepted_peer_assertions,
+                    options.additional_authenticated_data)
+              : ""),
       expected_message_type_(SERVER_PRECOMMIT),
       handshaker_state_(EkepHandshaker::HandshakeState::NOT_STARTED) {}
 
@@ -226,6 +236,13 @@ Status ClientEkepHandshaker::HandleServerPrecommit(
                                server_precommit.challenge().size()));
   }
 
+  if (server_precommit.resumption_accepted()) {
+    return ResumeSession(server_precommit);
+  }
+  // The server declined the offered session, if any. A new ticket issued at the
+  // end of this handshake replaces it in the session cache.
+  offered_session_.reset();
+
   // Verify that the server requested a non-empty subset of the assertions that
   // were offered by the client.
   if (server_precommit.server_requests().empty()) {
@@ -271,6 +288,48 @@ Status ClientEkepHandshaker::HandleServerPrecommit(
                        server_precommit.server_requests().cend(), output);
 }
 
+Status ClientEkepHandshaker::ResumeSession(
+    const ServerPrecommit &server_precommit) {
+  if (!offered_session_) {
+    return Status(Abort_ErrorCode_PROTOCOL_ERROR,
+                  "Server resumed a session that was not offered");
+  }
+  if (selected_cipher_suite_ != offered_session_->cipher_suite ||
+      selected_record_protocol_ != offered_session_->record_protocol) {
+    return Status(Abort_ErrorCode_PROTOCOL_ERROR,
+                  "Server changed the parameters of the resumed session");
+  }
+  if (!server_precommit.server_offers().empty() ||
+      !server_precommit.server_requests().empty()) {
+    return Status(Abort_ErrorCode_PROTOCOL_ERROR,
+                  "Server exchanged assertions in a resumed handshake");
+  }
+
+  for (const EnclaveIdentity &identity :
+       offered_session_->peer_identities.identities()) {
+    AddPeerIdentity(identity);
+  }
+
+  // At this stage in the protocol, the transcript is:
+  //   hash(ClientPrecommit || ServerPrecommit)
+  //
+  // This transcript is used by both the client and server to derive the EKEP
+  // secrets of the resumed handshake.
+  std::string transcript_hash;
+  ASYLO_RETURN_IF_ERROR(GetTranscriptHash(&transcript_hash));
+  ASYLO_RETURN_IF_ERROR(DeriveResumedSecrets(
+      selected_cipher_suite_, transcript_hash,
+      offered_session_->resumption_secret, &master_secret_,
+      &authenticator_secret_));
+  ASYLO_RETURN_IF_ERROR(DeriveResumptionSecret(
+      selected_cipher_suite_, transcript_hash, master_secret_,
+      &resumption_secret_));
+
+  // The ClientId and ServerId messages are skipped.
+  expected_message_type_ = SERVER_FINISH;
+  return Status::OkStatus();
+}
+
 Status ClientEkepHandshaker::HandleServerId(const google::protobuf::Message &message) {
   const auto *server_id_ptr = dynamic_cast<const ServerId *>(&message);
   if (!server_id_ptr) {
@@ -329,9 +388,14 @@ Status ClientEkepHandshaker::HandleServerId(const google::protobuf::Message &mes
   // and the server's public key.
   std::string transcript_hash;
   ASYLO_RETURN_IF_ERROR(GetTranscriptHash(&transcript_hash));
-  return DeriveSecrets(selected_cipher_suite_, transcript_hash,
-                       server_public_key, dh_private_key_, &master_secret_,
-                       &authenticator_secret_);
+  ASYLO_RETURN_IF_ERROR(DeriveSecrets(selected_cipher_suite_, transcript_hash,
+                                      server_public_key, dh_private_key_,
+                                      &master_secret_, &authenticator_secret_));
+  if (!session_cache_) {
+    return Status::OkStatus();
+  }
+  return DeriveResumptionSecret(selected_cipher_suite_, transcript_hash,
+                                master_secret_, &resumption_secret_);
 }
 
 Status ClientEkepHandshaker::HandleServerFinish(const google::protobuf::Message &message,
@@ -362,9 +426,27 @@ Status ClientEkepHandshaker::HandleServerFinish(const google::protobuf::Message
                   "Server handshake authenticator value is incorrect");
   }
 
+  if (session_cache_ && !server_finish.resumption_ticket().empty()) {
+    CacheSession(server_finish);
+  }
+
   return WriteClientFinish(output);
 }
 
+void ClientEkepHandshaker::CacheSession(const ServerFinish &server_finish) {
+  EkepResumptionSession session;
+  session.cipher_suite = selected_cipher_suite_;
+  session.record_protocol = selected_record_protocol_;
+  session.resumption_secret = resumption_secret_;
+  session.peer_identities = PeerIdentities();
+  session.ticket = server_finish.resumption_ticket();
+  session.expiration =
+      absl::Now() +
+      std::min(absl::Seconds(server_finish.resumption_ticket_lifetime()),
+               EkepSessionCache::kMaxSessionLifetime);
+  session_cache_->Insert(session_cache_key_, std::move(session));
+}
+
 Status ClientEkepHandshaker::WriteClientPrecommit(std::string *output) {
   ClientPrecommit client_precommit;
 
@@ -393,6 +475,14 @@ Status ClientEkepHandshaker::WriteClientPrecommit(std::string *output) {
   }
   client_precommit.set_challenge(challenge.data(), challenge.size());
 
+  if (session_cache_) {
+    auto session = absl::make_unique<EkepResumptionSession>();
+    if (session_cache_->Lookup(session_cache_key_, session.get())) {
+      client_precommit.set_resumption_ticket(session->ticket);
+      offered_session_ = std::move(session);
+    }
+  }
+
   for (const AssertionDescription &description : self_assertions_) {
     // Note that assertion generators were verified during creation of the
     // handshaker so there is no need to check whether the call to
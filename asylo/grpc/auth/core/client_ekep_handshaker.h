@@ -28,6 +28,8 @@
 #include <google/protobuf/message.h>
 #include "asylo/grpc/auth/core/ekep_handshaker.h"
 #include "asylo/grpc/auth/core/ekep_handshaker_util.h"
+#include "asylo/grpc/auth/core/ekep_resumption.h"
+#include "asylo/grpc/auth/core/handshake.pb.h"
 #include "asylo/util/cleansing_types.h"
 
 namespace asylo {
@@ -36,6 +38,11 @@ namespace asylo {
 // handshake. It handles ServerPrecommit, ServerId, and ServerFinish messages
 // from the server and sends ClientPrecommit, ClientId, and ClientFinish
 // messages to the server.
+//
+// If configured with a session cache, the client offers a cached resumption
+// ticket in its ClientPrecommit. If the server accepts the ticket, the server
+// follows its ServerPrecommit with a ServerFinish and the ClientId and ServerId
+// messages are skipped.
 class ClientEkepHandshaker final : public EkepHandshaker {
  public:
   // Creates a ClientEkepHandshaker configured with the given |options|, if
@@ -81,6 +88,11 @@ class ClientEkepHandshaker final : public EkepHandshaker {
   Status HandleServerPrecommit(const google::protobuf::Message &message,
                                std::string *output);
 
+  // Resumes the session offered in the ClientPrecommit after the server
+  // accepted it in |server_precommit|. Derives the EKEP secrets from the
+  // resumption secret of the offered session.
+  Status ResumeSession(const ServerPrecommit &server_precommit);
+
   // Validates the ServerId handshake message contained in |message|.
   Status HandleServerId(const google::protobuf::Message &message);
 
@@ -90,6 +102,9 @@ class ClientEkepHandshaker final : public EkepHandshaker {
   Status HandleServerFinish(const google::protobuf::Message &message,
                             std::string *output);
 
+  // Stores the resumption ticket in |server_finish| in the session cache.
+  void CacheSession(const ServerFinish &server_finish);
+
   // Writes the ClientPrecommit frame to |output| and updates the transcript.
   Status WriteClientPrecommit(std::string *output);
 
@@ -165,6 +180,20 @@ class ClientEkepHandshaker final : public EkepHandshaker {
   CleansingVector<uint8_t> authenticator_secret_;
   CleansingVector<uint8_t> master_secret_;
 
+  // Cache of resumable sessions, or nullptr if session resumption is disabled.
+  const std::shared_ptr<EkepSessionCache> session_cache_;
+
+  // The key under which sessions with the server are stored in
+  // |session_cache_|.
+  const std::string session_cache_key_;
+
+  // The session offered for resumption in the ClientPrecommit, if any.
+  std::unique_ptr<EkepResumptionSession> offered_session_;
+
+  // The resumption secret of this handshake. This field is only populated if
+  // |session_cache_| is set.
+  CleansingVector<uint8_t> resumption_secret_;
+
   // A snapshot of the transcript to which the server's assertions are bound:
   //   hash(ClientPrecommit || ServerPrecommit || ClientId)
   std::string server_assertion_transcript_;
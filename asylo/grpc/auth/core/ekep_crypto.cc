@@ -44,6 +44,8 @@ constexpr size_t kEkepSecretSize =
 
 constexpr char kEkepHkdfSalt[] = "EKEP Handshake v1";
 constexpr char kEkepHkdfSaltRecordProtocol[] = "EKEP Record Protocol v1";
+constexpr char kEkepHkdfSaltResumption[] = "EKEP Resumption v1";
+constexpr char kEkepHkdfSaltResumptionSecret[] = "EKEP Resumption Secret v1";
 constexpr char kServerAuthenticatedText[] = "EKEP Handshake v1: Server Finish";
 constexpr char kClientAuthenticatedText[] = "EKEP Handshake v1: Client Finish";
 
@@ -77,6 +79,27 @@ Status Hmac(const HandshakeCipher &ciphersuite, ByteContainerView key,
   return Status::OkStatus();
 }
 
+// Returns the hash function for HKDF from |ciphersuite|, or nullptr if the
+// ciphersuite is unsupported.
+const EVP_MD *GetHkdfDigest(const HandshakeCipher &ciphersuite) {
+  switch (ciphersuite) {
+    case CURVE25519_SHA256:
+      return EVP_sha256();
+    default:
+      return nullptr;
+  }
+}
+
+// Splits |output_key| into the master secret and authenticator secret.
+void SplitEkepSecrets(const CleansingVector<uint8_t> &output_key,
+                      CleansingVector<uint8_t> *master_secret,
+                      CleansingVector<uint8_t> *authenticator_secret) {
+  std::copy(output_key.cbegin(), output_key.cbegin() + kEkepMasterSecretSize,
+            std::back_inserter(*master_secret));
+  std::copy(output_key.cbegin() + kEkepMasterSecretSize, output_key.cend(),
+            std::back_inserter(*authenticator_secret));
+}
+
 }  // namespace
 
 Status DeriveSecrets(const HandshakeCipher &ciphersuite,
@@ -133,14 +156,65 @@ Status DeriveSecrets(const HandshakeCipher &ciphersuite,
     return Status(Abort_ErrorCode_INTERNAL_ERROR, "Internal error");
   }
 
-  // Copy the master secret.
-  std::copy(output_key.cbegin(), output_key.cbegin() + kEkepMasterSecretSize,
-            std::back_inserter(*master_secret));
+  SplitEkepSecrets(output_key, master_secret, authenticator_secret);
+  return Status::OkStatus();
+}
 
-  // Copy the authenticator secret.
-  std::copy(output_key.cbegin() + kEkepMasterSecretSize, output_key.cend(),
-            std::back_inserter(*authenticator_secret));
+Status DeriveResumedSecrets(const HandshakeCipher &ciphersuite,
+                            ByteContainerView transcript_hash,
+                            ByteContainerView resumption_secret,
+                            CleansingVector<uint8_t> *master_secret,
+                            CleansingVector<uint8_t> *authenticator_secret) {
+  const EVP_MD *digest = GetHkdfDigest(ciphersuite);
+  if (!digest) {
+    return Status(
+        Abort_ErrorCode_BAD_HANDSHAKE_CIPHER,
+        "Ciphersuite not supported: " + HandshakeCipher_Name(ciphersuite));
+  }
+  if (resumption_secret.size() != kEkepResumptionSecretSize) {
+    return Status(Abort_ErrorCode_PROTOCOL_ERROR,
+                  absl::StrCat("Resumption secret has incorrect size: ",
+                               resumption_secret.size()));
+  }
 
+  // Derive the master and authenticator secrets using HKDF.
+  std::string salt(kEkepHkdfSaltResumption);
+  CleansingVector<uint8_t> output_key;
+  output_key.resize(kEkepSecretSize);
+  if (!HKDF(output_key.data(), kEkepSecretSize, digest,
+            resumption_secret.data(), resumption_secret.size(),
+            reinterpret_cast<const uint8_t *>(salt.data()), salt.size(),
+            transcript_hash.data(), transcript_hash.size())) {
+    LOG(ERROR) << "HKDF failed: " << BsslLastErrorString();
+    return Status(Abort_ErrorCode_INTERNAL_ERROR, "Internal error");
+  }
+
+  SplitEkepSecrets(output_key, master_secret, authenticator_secret);
+  return Status::OkStatus();
+}
+
+Status DeriveResumptionSecret(const HandshakeCipher &ciphersuite,
+                              ByteContainerView transcript_hash,
+                              ByteContainerView master_secret,
+                              CleansingVector<uint8_t> *resumption_secret) {
+  resumption_secret->clear();
+  const EVP_MD *digest = GetHkdfDigest(ciphersuite);
+  if (!digest) {
+    return Status(
+        Abort_ErrorCode_BAD_HANDSHAKE_CIPHER,
+        "Ciphersuite not supported: " + HandshakeCipher_Name(ciphersuite));
+  }
+
+  std::string salt(kEkepHkdfSaltResumptionSecret);
+  resumption_secret->resize(kEkepResumptionSecretSize);
+  if (!HKDF(resumption_secret->data(), resumption_secret->size(), digest,
+            master_secret.data(), master_secret.size(),
+            reinterpret_cast<const uint8_t *>(salt.data()), salt.size(),
+            transcript_hash.data(), transcript_hash.size())) {
+    LOG(ERROR) << "HKDF failed: " << BsslLastErrorString();
+    resumption_secret->clear();
+    return Status(Abort_ErrorCode_INTERNAL_ERROR, "Internal error");
+  }
   return Status::OkStatus();
 }
 
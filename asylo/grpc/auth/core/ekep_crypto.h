@@ -33,6 +33,7 @@ namespace asylo {
 constexpr size_t kEkepMasterSecretSize = 64;
 constexpr size_t kEkepAuthenticatorSecretSize = 64;
 constexpr size_t kSealAes128GcmKeySize = 16;
+constexpr size_t kEkepResumptionSecretSize = 64;
 
 // Derives EKEP secrets based on the selected |ciphersuite| and the input
 // |transcript_hash|, |peer_dh_public_key|, and |self_dh_private_key|. On
@@ -55,6 +56,41 @@ Status DeriveSecrets(const HandshakeCipher &ciphersuite,
                      CleansingVector<uint8_t> *master_secret,
                      CleansingVector<uint8_t> *authenticator_secret);
 
+// Derives EKEP secrets for a resumed handshake based on the selected
+// |ciphersuite|, the input |transcript_hash|, and the |resumption_secret| of
+// the handshake being resumed. On success, writes the master secret to
+// |master_secret| and the authenticator secret to |authenticator_secret|.
+//
+// Note that |resumption_secret| is a ByteContainerView, which does not enforce
+// any data safety policy on the underlying container. The caller should take
+// care to pass the resumption secret using a self-cleansing container.
+//
+// If the ciphersuite is unsupported, returns BAD_HANDSHAKE_CIPHER.
+// If the resumption secret has an invalid size, returns PROTOCOL_ERROR.
+// Returns INTERNAL_ERROR on other errors.
+Status DeriveResumedSecrets(const HandshakeCipher &ciphersuite,
+                            ByteContainerView transcript_hash,
+                            ByteContainerView resumption_secret,
+                            CleansingVector<uint8_t> *master_secret,
+                            CleansingVector<uint8_t> *authenticator_secret);
+
+// Derives the resumption secret that a later handshake can use to resume the
+// current one. The secret is derived using HKDF initialized with the hash
+// function from |ciphersuite|, the input key material |master_secret|, and
+// the |transcript_hash| from which |master_secret| was derived. On success,
+// writes the resumption secret to |resumption_secret|.
+//
+// Note that |master_secret| is a ByteContainerView, which does not enforce
+// any data safety policy on the underlying container. The caller should take
+// care to pass their master secret using a self-cleansing container.
+//
+// If the ciphersuite is unsupported, returns BAD_HANDSHAKE_CIPHER.
+// Returns INTERNAL_ERROR on other errors.
+Status DeriveResumptionSecret(const HandshakeCipher &ciphersuite,
+                              ByteContainerView transcript_hash,
+                              ByteContainerView master_secret,
+                              CleansingVector<uint8_t> *resumption_secret);
+
 // Derives a record protocol key for the given |record_protocol| using HKDF
 // initialized with the hash function from |ciphersuite| and the input key
 // material |master_secret|. On success, writes the record protocol key to
@@ -83,6 +83,28 @@ constexpr char kTestServerHandshakeAuthenticator[] =
 constexpr char kTestClientHandshakeAuthenticator[] =
     "d43f4ef069507d34afee16b475c54cdca87d21daa04309f38deb7b01bd092ac9";
 
+// Test vector for resumption-secret derivation.
+//   Inputs:
+//     kTestMasterSecret, kTestTranscriptHash
+//   Outputs:
+//     kTestResumptionSecret
+constexpr char kTestResumptionSecret[] =
+    "f278e2c2aa9bd4915654f2b89c91a091020e93855a5da4afcc9d8cb1ade96193"
+    "75484cca0bf0d09c05e673eefd16267dfec5977b1b58befaeb3891263b5cd01c";
+
+// Test vector for resumed EKEP secret derivation.
+//   Inputs:
+//     kTestResumptionSecret, kTestTranscriptHash
+//   Outputs:
+//     kTestResumedMasterSecret, kTestResumedAuthenticatorSecret
+constexpr char kTestResumedMasterSecret[] =
+    "3f633ebda642b4a74c4a9dee4317128b739e054fcafd856c6c82e78ef639eb5e"
+    "55676baadfafcebc2217ddc1c067feca9ca7a439ec8df67afc2b7069e945a4d6";
+
+constexpr char kTestResumedAuthenticatorSecret[] =
+    "64b75f926300e2cee9c39b61d0de0a2eba578cdb24cd95001655a02efe375ee2"
+    "d9e6892429d321293c91963097b5b0b4d3110ce04f4d9b03d32b2c19002ff9ce";
+
 // Verify that DeriveSecrets fails and returns BAD_HANDSHAKE_CIPHER when passed
 // an unsupported ciphersuite.
 TEST(EkepCryptoTest, DeriveSecretsBadCiphersuite) {
@@ -185,6 +207,94 @@ TEST(EkepCryptoTest, DeriveSecretsWithCurve25519Sha256) {
   EXPECT_EQ(*actual_authenticator_secret, expected_authenticator_secret);
 }
 
+// Verify that DeriveResumptionSecret fails and returns BAD_HANDSHAKE_CIPHER
+// when passed an unsupported ciphersuite.
+TEST(EkepCryptoTest, DeriveResumptionSecretBadCiphersuite) {
+  std::string transcript_hash;
+  std::vector<uint8_t> master_secret;
+  CleansingVector<uint8_t> resumption_secret;
+
+  Status status = DeriveResumptionSecret(UNKNOWN_HANDSHAKE_CIPHER,
+                                         transcript_hash, master_secret,
+                                         &resumption_secret);
+  EXPECT_THAT(status, StatusIs(Abort_ErrorCode_BAD_HANDSHAKE_CIPHER));
+}
+
+// Verify success of DeriveResumptionSecret when using the ciphersuite
+// consisting of Curve25519 and SHA256.
+TEST(EkepCryptoTest, DeriveResumptionSecretWithCurve25519Sha256) {
+  UnsafeBytes<SHA256_DIGEST_LENGTH> transcript_hash;
+  ASYLO_ASSERT_OK(
+      SetTrivialObjectFromHexString(kTestTranscriptHash, &transcript_hash));
+
+  SafeBytes<kEkepMasterSecretSize> master_secret;
+  ASYLO_ASSERT_OK(
+      SetTrivialObjectFromHexString(kTestMasterSecret, &master_secret));
+
+  SafeBytes<kEkepResumptionSecretSize> expected_resumption_secret;
+  ASYLO_ASSERT_OK(SetTrivialObjectFromHexString(kTestResumptionSecret,
+                                                &expected_resumption_secret));
+
+  CleansingVector<uint8_t> resumption_secret;
+  ASYLO_ASSERT_OK(DeriveResumptionSecret(CURVE25519_SHA256, transcript_hash,
+                                         master_secret, &resumption_secret));
+
+  SafeBytes<kEkepResumptionSecretSize> *actual_resumption_secret =
+      SafeBytes<kEkepResumptionSecretSize>::Place(&resumption_secret,
+                                                  /*offset=*/0);
+  EXPECT_EQ(*actual_resumption_secret, expected_resumption_secret);
+}
+
+// Verify that DeriveResumedSecrets fails and returns PROTOCOL_ERROR when passed
+// a resumption secret with an invalid size.
+TEST(EkepCryptoTest, DeriveResumedSecretsBadResumptionSecretSize) {
+  std::string transcript_hash;
+  std::vector<uint8_t> resumption_secret(kEkepResumptionSecretSize - 1);
+  CleansingVector<uint8_t> authenticator_secret;
+  CleansingVector<uint8_t> master_secret;
+
+  Status status = DeriveResumedSecrets(CURVE25519_SHA256, transcript_hash,
+                                       resumption_secret, &master_secret,
+                                       &authenticator_secret);
+  EXPECT_THAT(status, StatusIs(Abort_ErrorCode_PROTOCOL_ERROR));
+}
+
+// Verify success of DeriveResumedSecrets when using the ciphersuite consisting
+// of Curve25519 and SHA256.
+TEST(EkepCryptoTest, DeriveResumedSecretsWithCurve25519Sha256) {
+  UnsafeBytes<SHA256_DIGEST_LENGTH> transcript_hash;
+  ASYLO_ASSERT_OK(
+      SetTrivialObjectFromHexString(kTestTranscriptHash, &transcript_hash));
+
+  SafeBytes<kEkepResumptionSecretSize> resumption_secret;
+  ASYLO_ASSERT_OK(
+      SetTrivialObjectFromHexString(kTestResumptionSecret, &resumption_secret));
+
+  SafeBytes<kEkepMasterSecretSize> expected_master_secret;
+  ASYLO_ASSERT_OK(SetTrivialObjectFromHexString(kTestResumedMasterSecret,
+                                                &expected_master_secret));
+
+  SafeBytes<kEkepAuthenticatorSecretSize> expected_authenticator_secret;
+  ASYLO_ASSERT_OK(SetTrivialObjectFromHexString(
+      kTestResumedAuthenticatorSecret, &expected_authenticator_secret));
+
+  CleansingVector<uint8_t> authenticator_secret;
+  CleansingVector<uint8_t> master_secret;
+  ASYLO_ASSERT_OK(DeriveResumedSecrets(CURVE25519_SHA256, transcript_hash,
+                                       resumption_secret, &master_secret,
+                                       &authenticator_secret));
+
+  SafeBytes<kEkepMasterSecretSize> *actual_master_secret =
+      SafeBytes<kEkepMasterSecretSize>::Place(&master_secret,
+                                              /*offset=*/0);
+  EXPECT_EQ(*actual_master_secret, expected_master_secret);
+
+  SafeBytes<kEkepAuthenticatorSecretSize> *actual_authenticator_secret =
+      SafeBytes<kEkepAuthenticatorSecretSize>::Place(&authenticator_secret,
+                                                     /*offset=*/0);
+  EXPECT_EQ(*actual_authenticator_secret, expected_authenticator_secret);
+}
+
 // Verify that DeriveRecordProtocolKey fails and returns BAD_HANDSHAKE_CIPHER
 // when passed an unsupported ciphersuite.
 TEST(EkepCryptoTest, DeriveRecordProtocolKeyBadCiphersuite) {
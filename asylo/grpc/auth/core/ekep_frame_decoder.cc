@@ -0,0 +1,254 @@
+/*
+ *
+ * Copyright 2018 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/grpc/auth/core/ekep_frame_decoder.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <google/protobuf/io/coded_stream.h>
+#include "absl/strings/str_cat.h"
+#include "asylo/grpc/auth/core/ekep_error_space.h"
+#include "asylo/util/status.h"
+#include "asylo/util/status_macros.h"
+
+namespace asylo {
+namespace {
+
+using google::protobuf::io::CodedInputStream;
+
+// The maximum size of an encoded varint.
+constexpr size_t kMaxVarintSize = 10;
+
+// Protobuf wire types.
+constexpr uint32_t kWireTypeVarint = 0;
+constexpr uint32_t kWireTypeFixed64 = 1;
+constexpr uint32_t kWireTypeLengthDelimited = 2;
+constexpr uint32_t kWireTypeFixed32 = 5;
+
+Status DeserializationError(const std::string &message) {
+  return Status(Abort_ErrorCode_DESERIALIZATION_FAILED,
+                absl::StrCat("Failed to deserialize handshake message: ",
+                             message));
+}
+
+// Reads a varint from the front of |data| into |value|. Returns the size of the
+// varint, 0 if |data| ends before the varint does, or -1 if the varint is
+// malformed.
+int ReadVarint(absl::string_view data, uint64_t *value) {
+  *value = 0;
+  for (size_t i = 0; i < data.size(); ++i) {
+    if (i == kMaxVarintSize) {
+      return -1;
+    }
+    uint8_t byte = static_cast<uint8_t>(data[i]);
+    *value |= static_cast<uint64_t>(byte & 0x7f) << (7 * i);
+    if ((byte & 0x80) == 0) {
+      return i + 1;
+    }
+  }
+  return data.size() < kMaxVarintSize ? 0 : -1;
+}
+
+// Returns the size of the longest prefix of |data| that consists of complete
+// top-level protobuf fields. |bytes_to_come| is the number of bytes of the
+// message that follow |data| and have not been received yet. Fails if |data|
+// is malformed or contains a field that cannot end within the message.
+//
+// Only the field framing is checked here. The contents of each field are
+// validated when the field is merged into the message.
+StatusOr<size_t> CompleteFieldsSize(absl::string_view data,
+                                    uint64_t bytes_to_come) {
+  size_t offset = 0;
+  while (offset < data.size()) {
+    absl::string_view field = data.substr(offset);
+    uint64_t tag;
+    int tag_size = ReadVarint(field, &tag);
+    if (tag_size < 0 || (tag_size > 0 && (tag >> 3) == 0) ||
+        tag > UINT32_MAX) {
+      return DeserializationError("invalid field tag");
+    }
+    if (tag_size == 0) {
+      break;
+    }
+
+    absl::string_view value = field.substr(tag_size);
+    uint64_t field_size = tag_size;
+    bool field_size_known = true;
+    switch (tag & 0x7) {
+      case kWireTypeVarint: {
+        uint64_t unused;
+        int varint_size = ReadVarint(value, &unused);
+        if (varint_size < 0) {
+          return DeserializationError("invalid varint");
+        }
+        field_size_known = varint_size > 0;
+        field_size += varint_size;
+        break;
+      }
+      case kWireTypeFixed64:
+        field_size += sizeof(uint64_t);
+        break;
+      case kWireTypeLengthDelimited: {
+        uint64_t length;
+        int length_size = ReadVarint(value, &length);
+        if (length_size < 0) {
+          return DeserializationError("invalid field length");
+        }
+        field_size_known = length_size > 0;
+        if (length > field.size() + bytes_to_come) {
+          return DeserializationError("field exceeds message size");
+        }
+        field_size += length_size + length;
+        break;
+      }
+      case kWireTypeFixed32:
+        field_size += sizeof(uint32_t);
+        break;
+      default:
+        // Groups are not used by any handshake message.
+        return DeserializationError(
+            absl::StrCat("unsupported wire type ", tag & 0x7));
+    }
+
+    if (field_size > field.size() + bytes_to_come) {
+      return DeserializationError("field exceeds message size");
+    }
+    if (!field_size_known || field_size > field.size()) {
+      break;
+    }
+    offset += field_size;
+  }
+  return offset;
+}
+
+}  // namespace
+
+EkepFrameDecoder::EkepFrameDecoder(uint32_t max_frame_size)
+    : max_frame_size_(max_frame_size) {
+  Reset();
+}
+
+StatusOr<bool> EkepFrameDecoder::DecodeHeader(absl::string_view *input) {
+  if (header_decoded()) {
+    return true;
+  }
+
+  size_t size = std::min<size_t>(input->size(),
+                                 kEkepFrameHeaderSize - header_size_);
+  memcpy(header_ + header_size_, input->data(), size);
+  input->remove_prefix(size);
+  header_size_ += size;
+  if (!header_decoded()) {
+    return false;
+  }
+
+  const uint8_t *header = reinterpret_cast<const uint8_t *>(header_);
+
+  // Read in the frame size.
+  uint32_t frame_size;
+  header = CodedInputStream::ReadLittleEndian32FromArray(header, &frame_size);
+  if (frame_size < sizeof(message_type_) || frame_size > max_frame_size_) {
+    return Status(Abort_ErrorCode_BAD_MESSAGE,
+                  absl::StrCat("Invalid frame size: ", frame_size));
+  }
+
+  // Read in the message type.
+  uint32_t message_type_encoded;
+  CodedInputStream::ReadLittleEndian32FromArray(header, &message_type_encoded);
+  if (!HandshakeMessageType_IsValid(message_type_encoded)) {
+    return Status(
+        Abort_ErrorCode_BAD_MESSAGE,
+        absl::StrCat("Invalid frame message type: ", message_type_encoded));
+  }
+  if (message_type_encoded == HandshakeMessageType::UNKNOWN_HANDSHAKE_MESSAGE) {
+    return Status(Abort_ErrorCode_BAD_MESSAGE,
+                  "Received frame with UNKNOWN_HANDSHAKE_MESSAGE type");
+  }
+
+  message_type_ = static_cast<HandshakeMessageType>(message_type_encoded);
+  message_size_ = frame_size - sizeof(message_type_);
+  message_bytes_remaining_ = message_size_;
+  return true;
+}
+
+StatusOr<bool> EkepFrameDecoder::DecodeMessage(
+    absl::string_view *input, google::protobuf::Message *message) {
+  if (!header_decoded()) {
+    return Status(Abort_ErrorCode_INTERNAL_ERROR,
+                  "Frame header has not been decoded");
+  }
+
+  size_t chunk_size =
+      std::min<size_t>(input->size(), message_bytes_remaining_);
+  absl::string_view chunk = input->substr(0, chunk_size);
+  input->remove_prefix(chunk_size);
+  message_bytes_remaining_ -= chunk_size;
+
+  // Parse directly from |input| unless an incomplete field is carried over
+  // from a previous call.
+  absl::string_view data = chunk;
+  bool carried_over = !unparsed_bytes_.empty();
+  if (carried_over) {
+    unparsed_bytes_.append(chunk.data(), chunk.size());
+    data = unparsed_bytes_;
+  }
+
+  size_t complete_size;
+  ASYLO_ASSIGN_OR_RETURN(complete_size,
+                         CompleteFieldsSize(data, message_bytes_remaining_));
+  if (complete_size > 0) {
+    // Parsing a message from the concatenation of its fields is equivalent to
+    // merging the fields into it one run at a time.
+    CodedInputStream stream(reinterpret_cast<const uint8_t *>(data.data()),
+                            complete_size);
+    if (!message->MergePartialFromCodedStream(&stream) ||
+        static_cast<size_t>(stream.CurrentPosition()) != complete_size) {
+      return DeserializationError("invalid field");
+    }
+  }
+
+  if (carried_over) {
+    unparsed_bytes_.erase(0, complete_size);
+  } else {
+    unparsed_bytes_.assign(data.data() + complete_size,
+                           data.size() - complete_size);
+  }
+
+  if (message_bytes_remaining_ > 0) {
+    return false;
+  }
+  if (!unparsed_bytes_.empty()) {
+    return DeserializationError("message ends with a truncated field");
+  }
+  if (!message->IsInitialized()) {
+    return DeserializationError("missing required fields");
+  }
+  Reset();
+  return true;
+}
+
+void EkepFrameDecoder::Reset() {
+  header_size_ = 0;
+  message_type_ = UNKNOWN_HANDSHAKE_MESSAGE;
+  message_size_ = 0;
+  message_bytes_remaining_ = 0;
+  unparsed_bytes_.clear();
+}
+
+}  // namespace asylo
@@ -0,0 +1,124 @@
+/*
+ *
+ * Copyright 2018 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_GRPC_AUTH_CORE_EKEP_FRAME_DECODER_H_
+#define ASYLO_GRPC_AUTH_CORE_EKEP_FRAME_DECODER_H_
+
+#include <cstdint>
+#include <string>
+
+#include <google/protobuf/message.h>
+#include "absl/strings/string_view.h"
+#include "asylo/grpc/auth/core/handshake.pb.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+
+// The size of an EKEP frame header.
+const uint32_t kEkepFrameHeaderSize = 8;
+
+// EkepFrameDecoder incrementally decodes EKEP frames from a byte stream that
+// arrives in arbitrarily-sized pieces. Rather than buffering an entire frame
+// before parsing it, the decoder parses each top-level field of the frame's
+// handshake message as soon as all of its bytes have arrived. At any point, the
+// decoder only holds the header of the current frame and the bytes of the
+// top-level field that is currently incomplete.
+//
+// Decoding a frame is done in two phases. DecodeHeader() is called until it
+// returns true, at which point message_type() and message_size() describe the
+// frame. DecodeMessage() is then called with the handshake message proto
+// corresponding to message_type() until it returns true, at which point the
+// message is fully parsed and the decoder is ready for the next frame.
+//
+// Both methods consume bytes from the front of their |input| argument and never
+// consume bytes past the end of the current frame, so the caller can tell
+// exactly which bytes belong to the frame (for example, to add them to a
+// transcript) and which bytes follow it.
+//
+// This class is not thread-safe.
+class EkepFrameDecoder {
+ public:
+  // Creates a decoder that rejects frames larger than |max_frame_size| bytes,
+  // excluding the frame size field.
+  explicit EkepFrameDecoder(uint32_t max_frame_size);
+
+  EkepFrameDecoder(const EkepFrameDecoder &other) = delete;
+  EkepFrameDecoder &operator=(const EkepFrameDecoder &other) = delete;
+
+  // Consumes bytes from the front of |input| until the header of the current
+  // frame is complete. Returns true if the header is complete, and false if
+  // |input| was exhausted first. On parsing failure, returns a status with a
+  // BAD_MESSAGE error code.
+  StatusOr<bool> DecodeHeader(absl::string_view *input);
+
+  // Returns true if the header of the current frame is complete.
+  bool header_decoded() const { return header_size_ == kEkepFrameHeaderSize; }
+
+  // Returns the raw bytes of the current frame header. Only valid if
+  // header_decoded() is true.
+  absl::string_view header() const {
+    return absl::string_view(header_, kEkepFrameHeaderSize);
+  }
+
+  // Returns the message type of the current frame. Only valid if
+  // header_decoded() is true.
+  HandshakeMessageType message_type() const { return message_type_; }
+
+  // Returns the size of the handshake message in the current frame. Only valid
+  // if header_decoded() is true.
+  uint32_t message_size() const { return message_size_; }
+
+  // Consumes bytes of the current frame's handshake message from the front of
+  // |input| and merges every complete top-level field into |message|. Returns
+  // true if the entire message has been parsed, in which case the decoder is
+  // reset to decode the next frame. Returns false if |input| was exhausted
+  // first. The same |message| must be passed for every call made for a frame.
+  // On parsing failure, returns a status with a DESERIALIZATION_FAILED error
+  // code.
+  //
+  // Must only be called if header_decoded() is true.
+  StatusOr<bool> DecodeMessage(absl::string_view *input,
+                               google::protobuf::Message *message);
+
+  // Discards the current frame and prepares to decode a new frame header.
+  void Reset();
+
+ private:
+  // The maximum frame size accepted by this decoder.
+  const uint32_t max_frame_size_;
+
+  // The bytes of the current frame header received so far.
+  char header_[kEkepFrameHeaderSize];
+  uint32_t header_size_;
+
+  // Fields parsed from the current frame header.
+  HandshakeMessageType message_type_;
+  uint32_t message_size_;
+
+  // The number of bytes of the current handshake message that have not been
+  // consumed yet.
+  uint32_t message_bytes_remaining_;
+
+  // Consumed bytes of the current handshake message that do not yet form a
+  // complete top-level field.
+  std::string unparsed_bytes_;
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_GRPC_AUTH_CORE_EKEP_FRAME_DECODER_H_
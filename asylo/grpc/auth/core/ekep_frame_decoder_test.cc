@@ -0,0 +1,227 @@
+/*
+ *
+ * Copyright 2018 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/grpc/auth/core/ekep_frame_decoder.h"
+
+#include <cstdint>
+#include <string>
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/strings/string_view.h"
+#include "asylo/grpc/auth/core/ekep_error_space.h"
+#include "asylo/grpc/auth/core/handshake.pb.h"
+#include "asylo/identity/descriptions.h"
+#include "asylo/test/util/proto_matchers.h"
+#include "asylo/test/util/status_matchers.h"
+
+namespace asylo {
+namespace {
+
+constexpr uint32_t kMaxFrameSize = 1 << 20;
+
+// Returns an EKEP frame with the given |frame_size| and |message_type| fields,
+// followed by |message_bytes|.
+std::string MakeFrame(uint32_t frame_size, uint32_t message_type,
+                      const std::string &message_bytes) {
+  std::string frame;
+  {
+    google::protobuf::io::StringOutputStream stream(&frame);
+    google::protobuf::io::CodedOutputStream output(&stream);
+    output.WriteLittleEndian32(frame_size);
+    output.WriteLittleEndian32(message_type);
+  }
+  return frame + message_bytes;
+}
+
+// Returns an EKEP frame holding |message| of type |message_type|.
+std::string MakeFrame(HandshakeMessageType message_type,
+                      const google::protobuf::Message &message) {
+  std::string message_bytes = message.SerializeAsString();
+  return MakeFrame(sizeof(uint32_t) + message_bytes.size(), message_type,
+                   message_bytes);
+}
+
+// Returns a ClientPrecommit with fields of every wire type used by EKEP.
+ClientPrecommit MakeClientPrecommit() {
+  ClientPrecommit precommit;
+  precommit.add_available_ekep_versions()->set_name("EKEP v1");
+  precommit.add_available_cipher_suites(CURVE25519_SHA256);
+  precommit.add_available_record_protocols(SEAL_AES128_GCM);
+  for (int i = 0; i < 3; ++i) {
+    AssertionOffer *offer = precommit.add_client_offers();
+    SetNullAssertionDescription(offer->mutable_description());
+    offer->set_additional_information(std::string(100 * (i + 1), 'a' + i));
+  }
+  precommit.set_challenge(std::string(32, 'c'));
+  return precommit;
+}
+
+// Decodes a frame from |input|, which is delivered |chunk_size| bytes at a
+// time, into |message|. Returns the number of bytes of |input| that follow the
+// frame.
+size_t DecodeInChunks(absl::string_view input, size_t chunk_size,
+                      EkepFrameDecoder *decoder,
+                      google::protobuf::Message *message) {
+  while (!input.empty()) {
+    absl::string_view chunk = input.substr(0, chunk_size);
+    input.remove_prefix(chunk.size());
+
+    if (!decoder->header_decoded()) {
+      auto header_result = decoder->DecodeHeader(&chunk);
+      EXPECT_THAT(header_result, IsOk());
+      if (!header_result.ok() || !header_result.ValueOrDie()) {
+        continue;
+      }
+    }
+    auto message_result = decoder->DecodeMessage(&chunk, message);
+    EXPECT_THAT(message_result, IsOk());
+    if (message_result.ok() && message_result.ValueOrDie()) {
+      return chunk.size() + input.size();
+    }
+    EXPECT_TRUE(chunk.empty());
+  }
+  ADD_FAILURE() << "Frame was not decoded";
+  return 0;
+}
+
+// Verify that a frame is decoded correctly no matter how it is split.
+TEST(EkepFrameDecoderTest, DecodesFrameInChunks) {
+  ClientPrecommit expected = MakeClientPrecommit();
+  std::string frame = MakeFrame(CLIENT_PRECOMMIT, expected);
+
+  for (size_t chunk_size : {size_t{1}, size_t{3}, size_t{64}, frame.size()}) {
+    EkepFrameDecoder decoder(kMaxFrameSize);
+    ClientPrecommit actual;
+    EXPECT_EQ(DecodeInChunks(frame, chunk_size, &decoder, &actual), 0u);
+    EXPECT_THAT(actual, EqualsProto(expected)) << chunk_size;
+    EXPECT_FALSE(decoder.header_decoded());
+  }
+}
+
+// Verify that the decoder does not consume bytes past the end of a frame, and
+// that it can decode consecutive frames.
+TEST(EkepFrameDecoderTest, DoesNotConsumeBytesAfterFrame) {
+  ClientPrecommit first = MakeClientPrecommit();
+  ServerPrecommit second;
+  second.set_selected_cipher_suite(CURVE25519_SHA256);
+  const std::string kTrailer = "trailing bytes";
+  std::string input = MakeFrame(CLIENT_PRECOMMIT, first) +
+                      MakeFrame(SERVER_PRECOMMIT, second) + kTrailer;
+
+  EkepFrameDecoder decoder(kMaxFrameSize);
+  absl::string_view remaining(input);
+
+  ClientPrecommit first_decoded;
+  ASSERT_THAT(decoder.DecodeHeader(&remaining), IsOkAndHolds(true));
+  EXPECT_EQ(decoder.message_type(), CLIENT_PRECOMMIT);
+  EXPECT_EQ(decoder.message_size(), first.ByteSizeLong());
+  ASSERT_THAT(decoder.DecodeMessage(&remaining, &first_decoded),
+              IsOkAndHolds(true));
+  EXPECT_THAT(first_decoded, EqualsProto(first));
+
+  ServerPrecommit second_decoded;
+  ASSERT_THAT(decoder.DecodeHeader(&remaining), IsOkAndHolds(true));
+  EXPECT_EQ(decoder.message_type(), SERVER_PRECOMMIT);
+  ASSERT_THAT(decoder.DecodeMessage(&remaining, &second_decoded),
+              IsOkAndHolds(true));
+  EXPECT_THAT(second_decoded, EqualsProto(second));
+
+  EXPECT_EQ(remaining, kTrailer);
+}
+
+// Verify that a frame with an empty message is decoded.
+TEST(EkepFrameDecoderTest, DecodesEmptyMessage) {
+  std::string frame = MakeFrame(CLIENT_FINISH, ClientFinish());
+  absl::string_view input(frame);
+
+  EkepFrameDecoder decoder(kMaxFrameSize);
+  ASSERT_THAT(decoder.DecodeHeader(&input), IsOkAndHolds(true));
+  EXPECT_EQ(decoder.message_size(), 0u);
+  ClientFinish message;
+  EXPECT_THAT(decoder.DecodeMessage(&input, &message), IsOkAndHolds(true));
+}
+
+// Verify that invalid frame headers are rejected.
+TEST(EkepFrameDecoderTest, RejectsInvalidHeaders) {
+  const std::string kHeaders[] = {
+      MakeFrame(/*frame_size=*/0, CLIENT_PRECOMMIT, ""),
+      MakeFrame(kMaxFrameSize + 1, CLIENT_PRECOMMIT, ""),
+      MakeFrame(sizeof(uint32_t), /*message_type=*/12345, ""),
+      MakeFrame(sizeof(uint32_t), UNKNOWN_HANDSHAKE_MESSAGE, ""),
+  };
+  for (const std::string &header : kHeaders) {
+    EkepFrameDecoder decoder(kMaxFrameSize);
+    absl::string_view input(header);
+    EXPECT_THAT(decoder.DecodeHeader(&input).status(),
+                StatusIs(Abort_ErrorCode_BAD_MESSAGE));
+  }
+}
+
+// Verify that a field that extends past the end of the message is rejected as
+// soon as its length is known, before the rest of the frame arrives.
+TEST(EkepFrameDecoderTest, RejectsFieldLongerThanMessage) {
+  // Field 7 (challenge), length-delimited, with a length of 100 bytes in a
+  // message of 10 bytes.
+  std::string message_bytes = "\x3a\x64";
+  std::string frame = MakeFrame(sizeof(uint32_t) + 10, CLIENT_PRECOMMIT,
+                                message_bytes);
+  absl::string_view input(frame);
+
+  EkepFrameDecoder decoder(kMaxFrameSize);
+  ASSERT_THAT(decoder.DecodeHeader(&input), IsOkAndHolds(true));
+  ClientPrecommit message;
+  EXPECT_THAT(decoder.DecodeMessage(&input, &message).status(),
+              StatusIs(Abort_ErrorCode_DESERIALIZATION_FAILED));
+}
+
+// Verify that a message that ends in the middle of a field is rejected.
+TEST(EkepFrameDecoderTest, RejectsTruncatedField) {
+  ClientPrecommit precommit = MakeClientPrecommit();
+  std::string message_bytes = precommit.SerializeAsString();
+  message_bytes.pop_back();
+  std::string frame = MakeFrame(sizeof(uint32_t) + message_bytes.size(),
+                                CLIENT_PRECOMMIT, message_bytes);
+  absl::string_view input(frame);
+
+  EkepFrameDecoder decoder(kMaxFrameSize);
+  ASSERT_THAT(decoder.DecodeHeader(&input), IsOkAndHolds(true));
+  ClientPrecommit message;
+  EXPECT_THAT(decoder.DecodeMessage(&input, &message).status(),
+              StatusIs(Abort_ErrorCode_DESERIALIZATION_FAILED));
+}
+
+// Verify that group wire types, which no handshake message uses, are rejected.
+TEST(EkepFrameDecoderTest, RejectsGroups) {
+  // Field 1, start group.
+  std::string message_bytes = "\x0b";
+  std::string frame = MakeFrame(sizeof(uint32_t) + message_bytes.size(),
+                                CLIENT_PRECOMMIT, message_bytes);
+  absl::string_view input(frame);
+
+  EkepFrameDecoder decoder(kMaxFrameSize);
+  ASSERT_THAT(decoder.DecodeHeader(&input), IsOkAndHolds(true));
+  ClientPrecommit message;
+  EXPECT_THAT(decoder.DecodeMessage(&input, &message).status(),
+              StatusIs(Abort_ErrorCode_DESERIALIZATION_FAILED));
+}
+
+}  // namespace
+}  // namespace asylo
@@ -20,9 +20,10 @@
 
 #include <cstdint>
 #include <memory>
+#include <string>
+#include <utility>
 
 #include <google/protobuf/io/coded_stream.h>
-#include <google/protobuf/io/zero_copy_stream_impl.h>
 #include <google/protobuf/io/zero_copy_stream_impl_lite.h>
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
@@ -94,30 +95,37 @@ EkepHandshaker::Result EkepHandshaker::NextHandshakeStep(
 
     result = StartHandshake(outgoing_bytes);
   } else {
-    // Process bytes from the peer.
-    input_stream_.AddBuffer(incoming_bytes, incoming_bytes_size);
-
+    // Process bytes from the peer. Every complete frame in |incoming_bytes| is
+    // handled in this call, and the responses to all of them are concatenated
+    // in |outgoing_bytes|. This allows a peer to pipeline several frames in a
+    // single flight without a round trip per frame. Bytes of an incomplete
+    // trailing frame are decoded as far as possible and the rest is kept by
+    // the frame decoder until the next call.
+    absl::string_view input(incoming_bytes, incoming_bytes_size);
+
+    result = Result::NOT_ENOUGH_DATA;
+    std::string frame_output;
     do {
-      result = DecodeAndHandleFrame(outgoing_bytes);
-      if (result != Result::IN_PROGRESS) {
+      frame_output.clear();
+      Result frame_result = DecodeAndHandleFrame(&input, &frame_output);
+      if (frame_result == Result::ABORTED) {
+        // Responses to earlier frames are dropped. Only the Abort frame, if
+        // any, is sent to the peer.
+        *outgoing_bytes = std::move(frame_output);
+        return Result::ABORTED;
+      }
+      if (frame_result == Result::NOT_ENOUGH_DATA) {
+        break;
+      }
+      outgoing_bytes->append(frame_output);
+      result = frame_result;
+      if (result == Result::COMPLETED) {
+        // Any remaining bytes belong to the record protocol and are available
+        // through GetUnusedBytes().
+        unused_bytes_.assign(input.data(), input.size());
         return result;
       }
-      // Continue processing data from the peer while there are still leftover
-      // bytes from the peer and the handshaker has not encoded a response
-      // frame.
-    } while (input_stream_.RemainingByteCount() != 0 &&
-             outgoing_bytes->empty());
-  }
-
-  if (!outgoing_bytes->empty() && input_stream_.RemainingByteCount() != 0) {
-    // A handshake step was completed and the handshake is still in progress but
-    // there are remaining bytes left over. This is not allowed at any step in
-    // the protocol.
-    outgoing_bytes->clear();
-    AbortHandshake(
-        Status(Abort_ErrorCode_BAD_MESSAGE, "Received unexpected bytes"),
-        outgoing_bytes);
-    return Result::ABORTED;
+    } while (!input.empty());
   }
 
   return result;
@@ -157,59 +165,13 @@ Status EkepHandshaker::EncodeFrame(
   return Status::OkStatus();
 }
 
-Status EkepHandshaker::ParseFrameHeader(
-    google::protobuf::io::ZeroCopyInputStream *input, uint32_t *message_size,
-    HandshakeMessageType *message_type) const {
-  google::protobuf::io::CodedInputStream encoded_frame(input);
-
-  // Read in the frame size.
-  uint32_t frame_size;
-  if (!encoded_frame.ReadLittleEndian32(&frame_size)) {
-    return Status(Abort_ErrorCode_BAD_MESSAGE, "Failed to read frame size");
-  }
-  if (frame_size < sizeof(*message_type) || frame_size > max_frame_size_) {
-    return Status(Abort_ErrorCode_BAD_MESSAGE,
-                  absl::StrCat("Invalid frame size: ", frame_size));
-  }
-
-  // Read in the message type.
-  uint32_t message_type_encoded;
-  if (!encoded_frame.ReadLittleEndian32(&message_type_encoded)) {
-    return Status(Abort_ErrorCode_BAD_MESSAGE,
-                  "Failed to read frame message type");
-  }
-  if (!HandshakeMessageType_IsValid(message_type_encoded)) {
-    return Status(
-        Abort_ErrorCode_BAD_MESSAGE,
-        absl::StrCat("Invalid frame message type: ", message_type_encoded));
-  }
-  if (message_type_encoded == HandshakeMessageType::UNKNOWN_HANDSHAKE_MESSAGE) {
-    return Status(Abort_ErrorCode_BAD_MESSAGE,
-                  "Received frame with UNKNOWN_HANDSHAKE_MESSAGE type");
-  }
-
-  *message_type = static_cast<HandshakeMessageType>(message_type_encoded);
-  *message_size = frame_size - sizeof(*message_type);
-  return Status::OkStatus();
-}
-
-Status EkepHandshaker::ParseFrameMessage(uint32_t message_size,
-                                         google::protobuf::io::ZeroCopyInputStream *input,
-                                         google::protobuf::Message *message) const {
-  if (!message->ParseFromBoundedZeroCopyStream(input, message_size)) {
-    return Status(Abort_ErrorCode_DESERIALIZATION_FAILED,
-                  "Failed to deserialize handshake message");
-  }
-  return Status::OkStatus();
-}
-
 StatusOr<std::string> EkepHandshaker::GetUnusedBytes() {
   if (!IsHandshakeCompleted()) {
     return Status(asylo::error::GoogleError::FAILED_PRECONDITION,
                   "Cannot retrieve unused bytes before handshake is complete");
   }
 
-  return input_stream_.RemainingBytes();
+  return unused_bytes_;
 }
 
 StatusOr<std::unique_ptr<EnclaveIdentities>>
@@ -244,62 +206,71 @@ StatusOr<CleansingVector<uint8_t>> EkepHandshaker::GetRecordProtocolKey() {
 }
 
 EkepHandshaker::EkepHandshaker(int max_frame_size)
-    : max_frame_size_(max_frame_size) {
+    : max_frame_size_(max_frame_size), frame_decoder_(max_frame_size) {
   peer_identities_ = absl::make_unique<EnclaveIdentities>();
 }
 
 EkepHandshaker::Result EkepHandshaker::DecodeAndHandleFrame(
-    std::string *output) {
-  // Check if there are enough bytes to parse a frame header.
-  if (input_stream_.RemainingByteCount() < kEkepFrameHeaderSize) {
-    return Result::NOT_ENOUGH_DATA;
-  }
+    absl::string_view *input, std::string *output) {
+  if (!frame_decoder_.header_decoded()) {
+    // Any errors that occur in header parsing are fatal.
+    auto header_result = frame_decoder_.DecodeHeader(input);
+    if (!header_result.ok()) {
+      AbortHandshake(header_result.status(), output);
+      return Result::ABORTED;
+    }
+    if (!header_result.ValueOrDie()) {
+      return Result::NOT_ENOUGH_DATA;
+    }
 
-  // There are enough bytes to parse the frame header. Any errors that occur in
-  // header parsing are now fatal.
-  uint32_t message_size;
-  HandshakeMessageType message_type;
-  Status status =
-      ParseFrameHeader(&input_stream_, &message_size, &message_type);
-  if (!status.ok()) {
-    AbortHandshake(status, output);
-    return Result::ABORTED;
-  }
+    HandshakeMessageType message_type = frame_decoder_.message_type();
+    VLOG(2) << "Received " << HandshakeMessageType_Name(message_type)
+            << " from peer";
 
-  VLOG(2) << "Received " << HandshakeMessageType_Name(message_type)
-          << " from peer";
+    if ((message_type != GetExpectedMessageType()) && (message_type != ABORT)) {
+      // Don't bother decoding an unexpected message, unless it's an ABORT.
+      AbortHandshake(
+          Status(Abort_ErrorCode_PROTOCOL_ERROR, "Unexpected message"), output);
+      return Result::ABORTED;
+    }
 
-  if ((message_type != GetExpectedMessageType()) && (message_type != ABORT)) {
-    // Don't bother decoding an unexpected message, unless it's an ABORT.
-    AbortHandshake(Status(Abort_ErrorCode_PROTOCOL_ERROR, "Unexpected message"),
-                   output);
-    return Result::ABORTED;
+    incoming_message_ = CreateHandshakeMessage(message_type);
+    if (message_type != ABORT) {
+      // Frame bytes are added to the transcript as they are consumed, so that
+      // the frame never has to be buffered in its entirety. If the frame turns
+      // out to be malformed, the handshake is aborted and the transcript is
+      // never used.
+      absl::string_view header = frame_decoder_.header();
+      transcript_.Add(header.data(), header.size());
+    }
   }
 
-  if (input_stream_.RemainingByteCount() < message_size) {
-    // Not enough bytes to parse the frame message. Rewind the internal stream
-    // since the frame was not consumed.
-    input_stream_.Rewind();
-    return Result::NOT_ENOUGH_DATA;
+  HandshakeMessageType message_type = frame_decoder_.message_type();
+  const char *message_bytes = input->data();
+  auto message_result =
+      frame_decoder_.DecodeMessage(input, incoming_message_.get());
+  if (message_type != ABORT) {
+    transcript_.Add(message_bytes, input->data() - message_bytes);
   }
-  std::unique_ptr<google::protobuf::Message> message =
-      CreateHandshakeMessage(message_type);
 
-  // There are enough bytes to parse the frame message. Any errors that occur
-  // during deserialization are fatal.
-  status = ParseFrameMessage(message_size, &input_stream_, message.get());
-  if (!status.ok()) {
+  // Any errors that occur during deserialization are fatal.
+  if (!message_result.ok()) {
     if (message_type == ABORT) {
       // The peer sent an Abort message that could not be parsed. There is not
       // much else to do but log the error and terminate the handshake.
       HandleAbortMessage(nullptr);
-      LOG(ERROR) << "Failed to deserialize peer's Abort: " << status;
+      LOG(ERROR) << "Failed to deserialize peer's Abort: "
+                 << message_result.status();
     } else {
-      AbortHandshake(status, output);
+      AbortHandshake(message_result.status(), output);
     }
     return Result::ABORTED;
   }
+  if (!message_result.ValueOrDie()) {
+    return Result::NOT_ENOUGH_DATA;
+  }
 
+  std::unique_ptr<google::protobuf::Message> message = std::move(incoming_message_);
   VLOG(2) << message->DebugString();
 
   if (message_type == ABORT) {
@@ -310,10 +281,6 @@ EkepHandshaker::Result EkepHandshaker::DecodeAndHandleFrame(
     return Result::ABORTED;
   }
 
-  // Add all consumed bytes to the transcript and expunge them.
-  UpdateTranscriptWithIncomingBytes();
-  input_stream_.TrimFront();
-
   return HandleHandshakeMessage(message_type, *message, output);
 }
 
@@ -336,6 +303,10 @@ void EkepHandshaker::AddPeerIdentity(const EnclaveIdentity &identity) {
   *peer_identities_->add_identities() = identity;
 }
 
+const EnclaveIdentities &EkepHandshaker::PeerIdentities() const {
+  return *peer_identities_;
+}
+
 void EkepHandshaker::SetRecordProtocol(RecordProtocol record_protocol) {
   record_protocol_ = record_protocol;
 }
@@ -373,13 +344,4 @@ void EkepHandshaker::UpdateTranscriptWithOutgoingBytes(
   }
 }
 
-void EkepHandshaker::UpdateTranscriptWithIncomingBytes() {
-  int64_t bytes_read = input_stream_.ByteCount();
-  if (bytes_read != 0) {
-    input_stream_.Rewind();
-    google::protobuf::io::LimitingInputStream consumed_bytes(&input_stream_, bytes_read);
-    transcript_.Add(&consumed_bytes);
-  }
-}
-
 }  // namespace asylo
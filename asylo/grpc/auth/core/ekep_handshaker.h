@@ -20,14 +20,17 @@
 #define ASYLO_GRPC_AUTH_CORE_EKEP_HANDSHAKER_H_
 
 #include <cstdint>
+#include <memory>
+#include <string>
 
 #include <google/protobuf/io/zero_copy_stream.h>
 #include <google/protobuf/message.h>
+#include "absl/strings/string_view.h"
 #include "asylo/crypto/hash_interface.h"
 #include "asylo/crypto/util/byte_container_view.h"
+#include "asylo/grpc/auth/core/ekep_frame_decoder.h"
 #include "asylo/grpc/auth/core/handshake.pb.h"
 #include "asylo/grpc/auth/core/transcript.h"
-#include "asylo/grpc/auth/util/multi_buffer_input_stream.h"
 #include "asylo/identity/identity.pb.h"
 #include "asylo/util/cleansing_types.h"
 #include "asylo/util/status.h"
@@ -35,8 +38,6 @@
 
 namespace asylo {
 
-// The size of an EKEP frame header.
-const uint32_t kEkepFrameHeaderSize = 8;
 const uint32_t kEkepChallengeSize = 32;
 
 // EkepHandshaker is an abstract class that implements the Enclave Key Exchange
@@ -87,19 +88,20 @@ class EkepHandshaker {
 
   virtual ~EkepHandshaker() = default;
 
-  // Performs the next handshake step for this handshaker. This step processes a
-  // frame from the peer using |incoming_bytes| and any cached bytes. If a
-  // response frame is required to complete the handshake step, attempts to
-  // write an outgoing frame to |outgoing_bytes|. The caller must check for the
-  // presence of an outgoing frame by checking whether |outgoing_bytes| has a
-  // non-zero size.
+  // Performs the next handshake step for this handshaker. This step processes
+  // every complete frame from the peer in |incoming_bytes| and any cached
+  // bytes. If response frames are required to complete the handshake step,
+  // attempts to write the outgoing frames to |outgoing_bytes|. The caller must
+  // check for the presence of outgoing frames by checking whether
+  // |outgoing_bytes| has a non-zero size. Bytes of an incomplete trailing frame
+  // are cached until the next call.
   //
   // |incoming_bytes| contains |incoming_bytes_size| bytes from the peer.
-  // |outgoing_bytes| is an output parameter that contains an outgoing frame, if
-  // applicable. If there is no outgoing frame, |outgoing_bytes| is set to an
-  // empty string.
+  // |outgoing_bytes| is an output parameter that contains the outgoing frames,
+  // if applicable. If there are no outgoing frames, |outgoing_bytes| is set to
+  // an empty string.
   //
-  // If a handshake step was completed successfully without completing the
+  // If at least one frame was processed successfully without completing the
   // handshake, returns IN_PROGRESS.
   // If the handshake was completed successfully, returns COMPLETED.
   // If there are not enough bytes to decode the next frame, returns
@@ -118,22 +120,6 @@ class EkepHandshaker {
                      const google::protobuf::Message &handshake_message,
                      google::protobuf::io::ZeroCopyOutputStream *output) const;
 
-  // Parses an EKEP frame header from the |input| stream. On success, sets
-  // |message_size| to the message size computed from the header and sets
-  // |message_type| to the message type parsed from the header. On parsing
-  // failure, returns a status with a BAD_MESSAGE error code.
-  Status ParseFrameHeader(google::protobuf::io::ZeroCopyInputStream *input,
-                          uint32_t *message_size,
-                          HandshakeMessageType *message_type) const;
-
-  // Parses a handshake message of length |message_size| from the EKEP frame in
-  // the |input| stream. |message| should be a valid handshake message proto. On
-  // success, initializes |message| to the deserialized handshake message. On
-  // parsing failure, returns a status with a DESERIALIZATION_FAILED error code.
-  Status ParseFrameMessage(uint32_t message_size,
-                           google::protobuf::io::ZeroCopyInputStream *input,
-                           google::protobuf::Message *message) const;
-
   // Returns a string containing the unused bytes at the end of the handshake,
   // given that the handshake has successfully completed. If the handshake has
   // not yet completed, returns GoogleError::FAILED_PRECONDITION.
@@ -164,10 +150,12 @@ class EkepHandshaker {
 
   EkepHandshaker(int max_frame_size);
 
-  // Attempts to decode and handle a handshake message from the internal
-  // input_stream_. Writes any response frames, if applicable, to |output| and
-  // returns a Result indicating the status of the handshake.
-  Result DecodeAndHandleFrame(std::string *output);
+  // Consumes bytes of the current frame from the front of |input|. If this
+  // completes the frame, handles its handshake message. Writes any response
+  // frames, if applicable, to |output| and returns a Result indicating the
+  // status of the handshake. Returns NOT_ENOUGH_DATA if |input| was exhausted
+  // before the frame was complete.
+  Result DecodeAndHandleFrame(absl::string_view *input, std::string *output);
 
   // Encodes the |handshake_message| of type |message_type| as an EKEP frame,
   // writes the encoded frame to |output|, and updates the transcript with all
@@ -198,6 +186,9 @@ class EkepHandshaker {
   // Adds an identity to the list of peer identities.
   void AddPeerIdentity(const EnclaveIdentity &identity);
 
+  // Returns the peer identities that have been added so far.
+  const EnclaveIdentities &PeerIdentities() const;
+
   // Sets the record protocol to use after the handshake completes.
   void SetRecordProtocol(RecordProtocol record_protocol);
 
@@ -264,16 +255,18 @@ class EkepHandshaker {
   void UpdateTranscriptWithOutgoingBytes(const char *outgoing_bytes,
                                          int outgoing_bytes_size);
 
-  // Updates the transcript with all consumed bytes from the internal
-  // input_stream_.
-  void UpdateTranscriptWithIncomingBytes();
-
   // The maximum frame size of frames that are encoded and decoded by this
   // handshaker.
   const int max_frame_size_;
 
-  // A stream of unconsumed handshake bytes.
-  MultiBufferInputStream input_stream_;
+  // Incrementally decodes frames from the peer.
+  EkepFrameDecoder frame_decoder_;
+
+  // The handshake message of the frame currently being decoded.
+  std::unique_ptr<google::protobuf::Message> incoming_message_;
+
+  // Bytes received after the final handshake frame.
+  std::string unused_bytes_;
 
   // A running hash of the handshake transcript.
   Transcript transcript_;
@@ -0,0 +1,250 @@
+/*
+ *
+ * Copyright 2018 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Measures the throughput and per-phase latency of EKEP handshakes between a
+// ClientEkepHandshaker and a ServerEkepHandshaker driven in the same process,
+// without a transport. Usage:
+//
+//   ekep_handshaker_benchmark --authority=sgx_local --iterations=5000
+//
+// --authority selects the assertion authority used by both peers: "null" or
+// "sgx_local". The SGX local authority runs against the fake SGX hardware, with
+// both peers inside the same fake enclave. --resumption enables session
+// resumption, in which case every handshake after the first is resumed.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "asylo/grpc/auth/core/client_ekep_handshaker.h"
+#include "asylo/grpc/auth/core/ekep_handshaker.h"
+#include "asylo/grpc/auth/core/ekep_handshaker_util.h"
+#include "asylo/grpc/auth/core/ekep_resumption.h"
+#include "asylo/grpc/auth/core/server_ekep_handshaker.h"
+#include "asylo/identity/descriptions.h"
+#include "asylo/identity/enclave_assertion_authority_config.pb.h"
+#include "asylo/identity/identity.pb.h"
+#include "asylo/identity/init.h"
+#include "asylo/identity/sgx/fake_enclave.h"
+#include "asylo/test/util/enclave_assertion_authority_configs.h"
+#include "asylo/util/logging.h"
+#include "asylo/util/status.h"
+#include "gflags/gflags.h"
+
+DEFINE_int32(iterations, 1000, "Number of handshakes to measure");
+DEFINE_int32(warmup_iterations, 10,
+             "Number of handshakes to run before measuring");
+DEFINE_string(authority, "null",
+              "Assertion authority used by both peers: null or sgx_local");
+DEFINE_bool(resumption, false, "Whether to resume sessions");
+
+namespace asylo {
+namespace {
+
+// Latency samples of one handshake phase. A phase is one call to
+// NextHandshakeStep() on one of the peers.
+struct PhaseSamples {
+  std::string name;
+  std::vector<absl::Duration> latencies;
+};
+
+// Runs a single handshake between a new client and a new server. If |phases|
+// is non-null, appends the latency of each call to NextHandshakeStep() to the
+// corresponding element of |phases|, growing it as needed.
+Status RunHandshake(const EkepHandshakerOptions &client_options,
+                    const EkepHandshakerOptions &server_options,
+                    std::vector<PhaseSamples> *phases) {
+  std::unique_ptr<EkepHandshaker> client =
+      ClientEkepHandshaker::Create(client_options);
+  std::unique_ptr<EkepHandshaker> server =
+      ServerEkepHandshaker::Create(server_options);
+  if (!client || !server) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Invalid handshaker options");
+  }
+
+  std::string incoming;
+  std::string outgoing;
+  EkepHandshaker::Result client_result = EkepHandshaker::Result::IN_PROGRESS;
+  EkepHandshaker::Result server_result = EkepHandshaker::Result::IN_PROGRESS;
+  bool client_turn = true;
+  bool first_step = true;
+  size_t phase = 0;
+  while (client_result != EkepHandshaker::Result::COMPLETED ||
+         server_result != EkepHandshaker::Result::COMPLETED) {
+    EkepHandshaker *handshaker = client_turn ? client.get() : server.get();
+    absl::Time start = absl::Now();
+    EkepHandshaker::Result result = handshaker->NextHandshakeStep(
+        first_step ? nullptr : incoming.data(),
+        first_step ? 0 : incoming.size(), &outgoing);
+    absl::Duration latency = absl::Now() - start;
+
+    if (result != EkepHandshaker::Result::IN_PROGRESS &&
+        result != EkepHandshaker::Result::COMPLETED) {
+      return Status(error::GoogleError::INTERNAL,
+                    client_turn ? "Client handshake failed"
+                                : "Server handshake failed");
+    }
+    if (client_turn) {
+      client_result = result;
+    } else {
+      server_result = result;
+    }
+
+    if (phases) {
+      if (phases->size() <= phase) {
+        phases->push_back({absl::StrCat(client_turn ? "client" : "server",
+                                        " step ", phase / 2 + 1),
+                           {}});
+      }
+      (*phases)[phase].latencies.push_back(latency);
+    }
+
+    incoming.swap(outgoing);
+    client_turn = !client_turn;
+    first_step = false;
+    ++phase;
+  }
+
+  return Status::OkStatus();
+}
+
+// Returns the |quantile| of the sorted samples in |latencies|.
+absl::Duration Quantile(const std::vector<absl::Duration> &latencies,
+                        double quantile) {
+  size_t index = static_cast<size_t>(quantile * (latencies.size() - 1));
+  return latencies[index];
+}
+
+void PrintReport(absl::Duration total, int handshakes,
+                 std::vector<PhaseSamples> *phases) {
+  printf("authority=%s resumption=%s handshakes=%d\n", FLAGS_authority.c_str(),
+         FLAGS_resumption ? "true" : "false", handshakes);
+  printf("total time: %s\n", absl::FormatDuration(total).c_str());
+  printf("handshakes/second: %.1f\n",
+         handshakes / absl::ToDoubleSeconds(total));
+  printf("%-16s %10s %12s %12s %12s %12s\n", "phase", "samples", "mean", "p50",
+         "p90", "p99");
+  for (PhaseSamples &samples : *phases) {
+    std::vector<absl::Duration> &latencies = samples.latencies;
+    std::sort(latencies.begin(), latencies.end());
+    absl::Duration sum;
+    for (absl::Duration latency : latencies) {
+      sum += latency;
+    }
+    absl::Duration mean = sum / static_cast<int64_t>(latencies.size());
+    printf("%-16s %10zu %12s %12s %12s %12s\n", samples.name.c_str(),
+           latencies.size(),
+           absl::FormatDuration(mean).c_str(),
+           absl::FormatDuration(Quantile(latencies, 0.5)).c_str(),
+           absl::FormatDuration(Quantile(latencies, 0.9)).c_str(),
+           absl::FormatDuration(Quantile(latencies, 0.99)).c_str());
+  }
+}
+
+int RunBenchmark() {
+  EnclaveAssertionAuthorityConfig authority_config;
+  AssertionDescription description;
+  sgx::FakeEnclave enclave;
+  if (FLAGS_authority == "null") {
+    authority_config = GetNullAssertionAuthorityTestConfig();
+    SetNullAssertionDescription(&description);
+  } else if (FLAGS_authority == "sgx_local") {
+    authority_config = GetSgxLocalAssertionAuthorityTestConfig();
+    SetSgxLocalAssertionDescription(&description);
+
+    // Both peers run in the same fake enclave.
+    enclave.SetRandomIdentity();
+    sgx::FakeEnclave::EnterEnclave(enclave);
+  } else {
+    LOG(ERROR) << "Unknown authority: " << FLAGS_authority;
+    return 1;
+  }
+
+  std::vector<EnclaveAssertionAuthorityConfig> authority_configs = {
+      authority_config};
+  Status status = InitializeEnclaveAssertionAuthorities(
+      authority_configs.cbegin(), authority_configs.cend());
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to initialize assertion authorities: " << status;
+    return 1;
+  }
+
+  EkepHandshakerOptions client_options;
+  client_options.self_assertions = {description};
+  client_options.accepted_peer_assertions = {description};
+  EkepHandshakerOptions server_options = client_options;
+
+  std::unique_ptr<EkepTicketCrypter> ticket_crypter;
+  if (FLAGS_resumption) {
+    auto crypter_result = EkepTicketCrypter::Create();
+    if (!crypter_result.ok()) {
+      LOG(ERROR) << "Failed to create ticket crypter: "
+                 << crypter_result.status();
+      return 1;
+    }
+    ticket_crypter = std::move(crypter_result).ValueOrDie();
+    client_options.session_cache = std::make_shared<EkepSessionCache>();
+    client_options.session_cache_key = "benchmark";
+    server_options.ticket_crypter = ticket_crypter.get();
+  }
+
+  // Warm up, which also populates the session cache when resumption is
+  // enabled.
+  for (int i = 0; i < std::max(FLAGS_warmup_iterations, 1); ++i) {
+    status = RunHandshake(client_options, server_options, /*phases=*/nullptr);
+    if (!status.ok()) {
+      LOG(ERROR) << status;
+      return 1;
+    }
+  }
+
+  std::vector<PhaseSamples> phases;
+  absl::Time start = absl::Now();
+  for (int i = 0; i < FLAGS_iterations; ++i) {
+    status = RunHandshake(client_options, server_options, &phases);
+    if (!status.ok()) {
+      LOG(ERROR) << status;
+      return 1;
+    }
+  }
+  absl::Duration total = absl::Now() - start;
+
+  if (FLAGS_authority == "sgx_local") {
+    sgx::FakeEnclave::ExitEnclave();
+  }
+
+  if (FLAGS_iterations > 0) {
+    PrintReport(total, FLAGS_iterations, &phases);
+  }
+  return 0;
+}
+
+}  // namespace
+}  // namespace asylo
+
+int main(int argc, char *argv[]) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  return asylo::RunBenchmark();
+}
@@ -19,9 +19,11 @@
 #ifndef ASYLO_GRPC_AUTH_CORE_EKEP_HANDSHAKER_UTIL_H_
 #define ASYLO_GRPC_AUTH_CORE_EKEP_HANDSHAKER_UTIL_H_
 
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "asylo/grpc/auth/core/ekep_resumption.h"
 #include "asylo/identity/enclave_assertion_generator.h"
 #include "asylo/identity/enclave_assertion_verifier.h"
 #include "asylo/identity/identity.pb.h"
@@ -45,6 +47,18 @@ struct EkepHandshakerOptions {
   // Additional data presented by the EKEP participant during the handshake.
   std::string additional_authenticated_data;
 
+  // Client only. If set, the client offers the resumption ticket stored in
+  // |session_cache| for |session_cache_key|, if any, and stores any ticket
+  // issued by the server there. |session_cache_key| should identify the server,
+  // for example by its address.
+  std::shared_ptr<EkepSessionCache> session_cache;
+  std::string session_cache_key;
+
+  // Server only. If set, the server issues resumption tickets sealed by
+  // |ticket_crypter| and accepts tickets that it can open. The crypter must
+  // outlive any handshaker created with these options.
+  EkepTicketCrypter *ticket_crypter = nullptr;
+
   // Validates the handshaker options. All of the following conditions must
   // hold, otherwise returns INVALID_ARGUMENT:
   //   * max_frame_size is non-zero and does not exceed
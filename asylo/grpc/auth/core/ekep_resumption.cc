@@ -0,0 +1,267 @@
+/*
+ *
+ * Copyright 2018 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/grpc/auth/core/ekep_resumption.h"
+
+#include <openssl/mem.h>
+#include <openssl/rand.h>
+
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/types/span.h"
+#include "asylo/util/logging.h"
+#include "asylo/util/status_macros.h"
+
+namespace asylo {
+namespace {
+
+// The size of the key used to seal tickets.
+constexpr size_t kTicketKeySize = 16;
+
+// Appends |data| to |context|, prefixed by its length.
+void AppendLengthPrefixed(const std::string &data, std::string *context) {
+  uint64_t size = data.size();
+  context->append(reinterpret_cast<const char *>(&size), sizeof(size));
+  context->append(data);
+}
+
+// Creates an AES-GCM cryptor with a fresh random key.
+StatusOr<std::unique_ptr<experimental::AeadCryptor>> CreateTicketCryptor() {
+  CleansingVector<uint8_t> key(kTicketKeySize);
+  if (RAND_bytes(key.data(), key.size()) != 1) {
+    return Status(error::GoogleError::INTERNAL,
+                  "Failed to generate ticket key");
+  }
+  return experimental::AeadCryptor::CreateAesGcmCryptor(key);
+}
+
+}  // namespace
+
+constexpr size_t EkepSessionCache::kDefaultMaxEntries;
+constexpr absl::Duration EkepSessionCache::kMaxSessionLifetime;
+constexpr absl::Duration EkepTicketCrypter::kDefaultTicketLifetime;
+constexpr absl::Duration EkepTicketCrypter::kMaxTicketLifetime;
+constexpr uint64_t EkepTicketCrypter::kDefaultTicketsPerKey;
+
+std::string MakeEkepResumptionContext(
+    const std::string &prefix,
+    const std::vector<AssertionDescription> &self_assertions,
+    const std::vector<AssertionDescription> &accepted_peer_assertions,
+    const std::string &additional_authenticated_data) {
+  std::string context;
+  AppendLengthPrefixed(prefix, &context);
+  for (const auto *assertions : {&self_assertions, &accepted_peer_assertions}) {
+    AppendLengthPrefixed(std::to_string(assertions->size()), &context);
+    for (const AssertionDescription &description : *assertions) {
+      AppendLengthPrefixed(description.SerializeAsString(), &context);
+    }
+  }
+  AppendLengthPrefixed(additional_authenticated_data, &context);
+  return context;
+}
+
+EkepSessionCache::EkepSessionCache(size_t max_entries)
+    : max_entries_(max_entries) {}
+
+void EkepSessionCache::Insert(const std::string &key,
+                              EkepResumptionSession session) {
+  absl::MutexLock lock(&mu_);
+  auto it = sessions_.find(key);
+  if (it != sessions_.end()) {
+    it->second = std::move(session);
+    return;
+  }
+
+  if (max_entries_ == 0) {
+    return;
+  }
+  while (sessions_.size() >= max_entries_) {
+    sessions_.erase(insertion_order_.front());
+    insertion_order_.pop_front();
+  }
+  sessions_.emplace(key, std::move(session));
+  insertion_order_.push_back(key);
+}
+
+bool EkepSessionCache::Lookup(const std::string &key,
+                              EkepResumptionSession *session) {
+  absl::MutexLock lock(&mu_);
+  auto it = sessions_.find(key);
+  if (it == sessions_.end()) {
+    return false;
+  }
+  if (it->second.expiration <= absl::Now()) {
+    // Expired sessions are left in place until they are replaced or evicted.
+    return false;
+  }
+  *session = it->second;
+  return true;
+}
+
+void EkepSessionCache::Erase(const std::string &key) {
+  absl::MutexLock lock(&mu_);
+  if (sessions_.erase(key) == 0) {
+    return;
+  }
+  for (auto it = insertion_order_.begin(); it != insertion_order_.end(); ++it) {
+    if (*it == key) {
+      insertion_order_.erase(it);
+      break;
+    }
+  }
+}
+
+StatusOr<std::unique_ptr<EkepTicketCrypter>> EkepTicketCrypter::Create(
+    absl::Duration ticket_lifetime, uint64_t tickets_per_key) {
+  if (ticket_lifetime <= absl::ZeroDuration()) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Ticket lifetime must be positive");
+  }
+  if (ticket_lifetime > kMaxTicketLifetime) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Ticket lifetime exceeds the maximum lifetime");
+  }
+  if (tickets_per_key == 0) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Number of tickets per key must be positive");
+  }
+  std::unique_ptr<experimental::AeadCryptor> cryptor;
+  ASYLO_ASSIGN_OR_RETURN(cryptor, CreateTicketCryptor());
+  return absl::WrapUnique(new EkepTicketCrypter(
+      std::move(cryptor), ticket_lifetime, tickets_per_key));
+}
+
+EkepTicketCrypter::EkepTicketCrypter(
+    std::unique_ptr<experimental::AeadCryptor> cryptor,
+    absl::Duration ticket_lifetime, uint64_t tickets_per_key)
+    : ticket_lifetime_(ticket_lifetime),
+      tickets_per_key_(tickets_per_key),
+      cryptor_(std::move(cryptor)),
+      tickets_sealed_(0) {}
+
+Status EkepTicketCrypter::RotateKey() {
+  std::unique_ptr<experimental::AeadCryptor> cryptor;
+  ASYLO_ASSIGN_OR_RETURN(cryptor, CreateTicketCryptor());
+  previous_cryptor_ = std::move(cryptor_);
+  cryptor_ = std::move(cryptor);
+  tickets_sealed_ = 0;
+  return Status::OkStatus();
+}
+
+StatusOr<std::string> EkepTicketCrypter::IssueTicket(
+    const EkepResumptionSession &session, ByteContainerView context) {
+  ResumptionTicketContents contents;
+  contents.set_cipher_suite(session.cipher_suite);
+  contents.set_record_protocol(session.record_protocol);
+  contents.set_resumption_secret(session.resumption_secret.data(),
+                                 session.resumption_secret.size());
+  *contents.mutable_peer_identities() = session.peer_identities;
+  contents.set_expiration_time(
+      absl::ToUnixSeconds(absl::Now() + ticket_lifetime_));
+
+  std::string plaintext = contents.SerializeAsString();
+  OPENSSL_cleanse(&(*contents.mutable_resumption_secret())[0],
+                  contents.resumption_secret().size());
+
+  absl::MutexLock lock(&mu_);
+  Status status = Status::OkStatus();
+  if (tickets_sealed_ >= tickets_per_key_) {
+    status = RotateKey();
+    if (!status.ok()) {
+      OPENSSL_cleanse(&plaintext[0], plaintext.size());
+      return status;
+    }
+  }
+  std::vector<uint8_t> ticket(cryptor_->NonceSize() + plaintext.size() +
+                              cryptor_->MaxSealOverhead());
+  absl::Span<uint8_t> nonce(ticket.data(), cryptor_->NonceSize());
+  absl::Span<uint8_t> ciphertext(ticket.data() + nonce.size(),
+                                 ticket.size() - nonce.size());
+  size_t ciphertext_size;
+  status =
+      cryptor_->Seal(plaintext, context, nonce, ciphertext, &ciphertext_size);
+  if (!status.ok()) {
+    // The cryptor may have sealed as many messages as it safely can. Replace
+    // it; tickets sealed under the old key can still be opened until the next
+    // rotation.
+    LOG(WARNING) << "Rotating EKEP ticket key after Seal() failed: " << status;
+    status = RotateKey();
+    if (status.ok()) {
+      status = cryptor_->Seal(plaintext, context, nonce, ciphertext,
+                              &ciphertext_size);
+    }
+  }
+  OPENSSL_cleanse(&plaintext[0], plaintext.size());
+  ASYLO_RETURN_IF_ERROR(status);
+  ++tickets_sealed_;
+
+  return std::string(reinterpret_cast<const char *>(ticket.data()),
+                     nonce.size() + ciphertext_size);
+}
+
+Status EkepTicketCrypter::OpenTicket(ByteContainerView ticket,
+                                     ByteContainerView context,
+                                     EkepResumptionSession *session) {
+  CleansingVector<uint8_t> plaintext(ticket.size());
+  size_t plaintext_size;
+  {
+    absl::MutexLock lock(&mu_);
+    size_t nonce_size = cryptor_->NonceSize();
+    if (ticket.size() < nonce_size) {
+      return Status(error::GoogleError::INVALID_ARGUMENT,
+                    "Ticket is too small");
+    }
+    ByteContainerView ciphertext(ticket.data() + nonce_size,
+                                 ticket.size() - nonce_size);
+    ByteContainerView nonce(ticket.data(), nonce_size);
+    Status status = cryptor_->Open(ciphertext, context, nonce,
+                                   absl::MakeSpan(plaintext), &plaintext_size);
+    if (!status.ok() && previous_cryptor_) {
+      status = previous_cryptor_->Open(ciphertext, context, nonce,
+                                       absl::MakeSpan(plaintext),
+                                       &plaintext_size);
+    }
+    ASYLO_RETURN_IF_ERROR(status);
+  }
+
+  ResumptionTicketContents contents;
+  if (!contents.ParseFromArray(plaintext.data(), plaintext_size)) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Failed to parse ticket contents");
+  }
+
+  absl::Time expiration = absl::FromUnixSeconds(contents.expiration_time());
+  if (expiration <= absl::Now()) {
+    return Status(error::GoogleError::DEADLINE_EXCEEDED, "Ticket has expired");
+  }
+
+  session->cipher_suite = contents.cipher_suite();
+  session->record_protocol = contents.record_protocol();
+  session->resumption_secret.assign(contents.resumption_secret().cbegin(),
+                                    contents.resumption_secret().cend());
+  session->peer_identities = contents.peer_identities();
+  session->ticket.clear();
+  session->expiration = expiration;
+
+  OPENSSL_cleanse(&(*contents.mutable_resumption_secret())[0],
+                  contents.resumption_secret().size());
+  return Status::OkStatus();
+}
+
+}  // namespace asylo
@@ -0,0 +1,186 @@
+/*
+ *
+ * Copyright 2018 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_GRPC_AUTH_CORE_EKEP_RESUMPTION_H_
+#define ASYLO_GRPC_AUTH_CORE_EKEP_RESUMPTION_H_
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "asylo/crypto/aead_cryptor.h"
+#include "asylo/crypto/util/byte_container_view.h"
+#include "asylo/grpc/auth/core/handshake.pb.h"
+#include "asylo/identity/identity.pb.h"
+#include "asylo/util/cleansing_types.h"
+#include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+
+// The state needed to resume an EKEP handshake.
+struct EkepResumptionSession {
+  // The parameters negotiated by the handshake being resumed.
+  HandshakeCipher cipher_suite = UNKNOWN_HANDSHAKE_CIPHER;
+  RecordProtocol record_protocol = UNKNOWN_RECORD_PROTOCOL;
+
+  // The resumption secret of the handshake being resumed.
+  CleansingVector<uint8_t> resumption_secret;
+
+  // The peer's identities, as established by the handshake being resumed.
+  EnclaveIdentities peer_identities;
+
+  // The opaque ticket issued by the server. Only used by clients.
+  std::string ticket;
+
+  // The time after which the session can no longer be resumed. The time is
+  // read from the host, so expiration is advisory; see EkepTicketCrypter for
+  // the bound that the enclave enforces.
+  absl::Time expiration;
+};
+
+// Creates a string that identifies an EKEP participant's configuration from
+// its |self_assertions|, |accepted_peer_assertions|, and
+// |additional_authenticated_data|, prefixed by |prefix|. Sessions established
+// under one configuration are never resumed under a different one.
+std::string MakeEkepResumptionContext(
+    const std::string &prefix,
+    const std::vector<AssertionDescription> &self_assertions,
+    const std::vector<AssertionDescription> &accepted_peer_assertions,
+    const std::string &additional_authenticated_data);
+
+// A bounded cache of resumable sessions held by EKEP clients, keyed by an
+// arbitrary string that identifies the server (for example, a channel target
+// combined with the output of MakeEkepResumptionContext()). When the cache is
+// full, the oldest entry is evicted.
+//
+// This class is thread-safe.
+class EkepSessionCache {
+ public:
+  static constexpr size_t kDefaultMaxEntries = 256;
+
+  // The maximum time for which a session is cached, regardless of the ticket
+  // lifetime advertised by the server.
+  static constexpr absl::Duration kMaxSessionLifetime = absl::Hours(24);
+
+  explicit EkepSessionCache(size_t max_entries = kDefaultMaxEntries);
+
+  EkepSessionCache(const EkepSessionCache &other) = delete;
+  EkepSessionCache &operator=(const EkepSessionCache &other) = delete;
+
+  // Stores |session| under |key|, replacing any existing entry.
+  void Insert(const std::string &key, EkepResumptionSession session);
+
+  // Copies the unexpired session stored under |key| to |session|. Returns false
+  // if there is no such session.
+  bool Lookup(const std::string &key, EkepResumptionSession *session);
+
+  // Removes the session stored under |key|, if any.
+  void Erase(const std::string &key);
+
+ private:
+  const size_t max_entries_;
+
+  absl::Mutex mu_;
+  std::unordered_map<std::string, EkepResumptionSession> sessions_
+      GUARDED_BY(mu_);
+
+  // Keys of |sessions_| in insertion order, used for FIFO eviction.
+  std::deque<std::string> insertion_order_ GUARDED_BY(mu_);
+};
+
+// Seals and opens the resumption tickets issued by EKEP servers. Tickets are
+// sealed with AES-GCM under a random key that is generated by the crypter and
+// never leaves it, so only the crypter that issued a ticket can open it.
+//
+// The lifetime of a ticket is measured with the host's clock, which an enclave
+// cannot trust, so it only limits how long honest hosts resume sessions. The
+// bound that the enclave enforces is key rotation: the crypter replaces its
+// key after sealing a fixed number of tickets, and only opens tickets sealed
+// under its current or previous key. A ticket can therefore no longer be
+// opened once the crypter has issued twice that number of tickets after it.
+//
+// This class is thread-safe.
+class EkepTicketCrypter {
+ public:
+  // The default lifetime of an issued ticket.
+  static constexpr absl::Duration kDefaultTicketLifetime = absl::Hours(1);
+
+  // The maximum lifetime of an issued ticket.
+  static constexpr absl::Duration kMaxTicketLifetime = absl::Hours(24);
+
+  // The default number of tickets sealed under each key.
+  static constexpr uint64_t kDefaultTicketsPerKey = 1 << 16;
+
+  // Creates a crypter that issues tickets valid for |ticket_lifetime|, which
+  // must be positive and at most kMaxTicketLifetime, and that rotates its key
+  // after sealing |tickets_per_key| tickets, which must be positive.
+  static StatusOr<std::unique_ptr<EkepTicketCrypter>> Create(
+      absl::Duration ticket_lifetime = kDefaultTicketLifetime,
+      uint64_t tickets_per_key = kDefaultTicketsPerKey);
+
+  EkepTicketCrypter(const EkepTicketCrypter &other) = delete;
+  EkepTicketCrypter &operator=(const EkepTicketCrypter &other) = delete;
+
+  // Returns the lifetime of tickets issued by this crypter.
+  absl::Duration ticket_lifetime() const { return ticket_lifetime_; }
+
+  // Returns a ticket holding the cipher suite, record protocol, resumption
+  // secret, and peer identities of |session|, bound to |context|. The
+  // expiration time of |session| is ignored; the ticket expires after
+  // ticket_lifetime().
+  StatusOr<std::string> IssueTicket(const EkepResumptionSession &session,
+                                    ByteContainerView context);
+
+  // Opens |ticket| and writes its contents to |session|. Fails if |ticket| was
+  // not issued by this crypter, was sealed under a key that has since been
+  // rotated out, was issued with a different |context|, or has expired.
+  Status OpenTicket(ByteContainerView ticket, ByteContainerView context,
+                    EkepResumptionSession *session);
+
+ private:
+  EkepTicketCrypter(std::unique_ptr<experimental::AeadCryptor> cryptor,
+                    absl::Duration ticket_lifetime, uint64_t tickets_per_key);
+
+  // Replaces the current key with a new random key, keeping the current key
+  // as the previous one.
+  Status RotateKey() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const absl::Duration ticket_lifetime_;
+  const uint64_t tickets_per_key_;
+
+  absl::Mutex mu_;
+  std::unique_ptr<experimental::AeadCryptor> cryptor_ GUARDED_BY(mu_);
+
+  // The key that was current before |cryptor_|, or nullptr if the key has
+  // never been rotated.
+  std::unique_ptr<experimental::AeadCryptor> previous_cryptor_
+      GUARDED_BY(mu_);
+
+  // The number of tickets sealed under |cryptor_|.
+  uint64_t tickets_sealed_ GUARDED_BY(mu_);
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_GRPC_AUTH_CORE_EKEP_RESUMPTION_H_
@@ -0,0 +1,428 @@
+/*
+ *
+ * Copyright 2018 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/grpc/auth/core/ekep_resumption.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/time/time.h"
+#include "asylo/grpc/auth/core/client_ekep_handshaker.h"
+#include "asylo/grpc/auth/core/ekep_crypto.h"
+#include "asylo/grpc/auth/core/ekep_handshaker.h"
+#include "asylo/grpc/auth/core/ekep_handshaker_util.h"
+#include "asylo/grpc/auth/core/server_ekep_handshaker.h"
+#include "asylo/identity/enclave_assertion_authority_config.pb.h"
+#include "asylo/identity/init.h"
+#include "asylo/identity/null_identity/null_identity_util.h"
+#include "asylo/test/util/enclave_assertion_authority_configs.h"
+#include "asylo/test/util/status_matchers.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::Not;
+
+constexpr char kContext[] = "context";
+constexpr char kServerAddress[] = "server address";
+
+// Returns a session with distinctive contents.
+EkepResumptionSession MakeSession(const std::string &ticket) {
+  EkepResumptionSession session;
+  session.cipher_suite = CURVE25519_SHA256;
+  session.record_protocol = SEAL_AES128_GCM;
+  session.resumption_secret.assign(kEkepResumptionSecretSize, 0xab);
+  EnclaveIdentity *identity = session.peer_identities.add_identities();
+  identity->mutable_description()->set_identity_type(NULL_IDENTITY);
+  identity->set_identity("peer");
+  session.ticket = ticket;
+  session.expiration = absl::Now() + absl::Hours(1);
+  return session;
+}
+
+TEST(EkepSessionCacheTest, LookupReturnsInsertedSession) {
+  EkepSessionCache cache;
+  cache.Insert("key", MakeSession("ticket"));
+
+  EkepResumptionSession session;
+  ASSERT_TRUE(cache.Lookup("key", &session));
+  EXPECT_EQ(session.ticket, "ticket");
+  EXPECT_EQ(session.resumption_secret,
+            MakeSession("ticket").resumption_secret);
+  EXPECT_FALSE(cache.Lookup("other key", &session));
+}
+
+TEST(EkepSessionCacheTest, InsertReplacesSession) {
+  EkepSessionCache cache;
+  cache.Insert("key", MakeSession("old ticket"));
+  cache.Insert("key", MakeSession("new ticket"));
+
+  EkepResumptionSession session;
+  ASSERT_TRUE(cache.Lookup("key", &session));
+  EXPECT_EQ(session.ticket, "new ticket");
+}
+
+TEST(EkepSessionCacheTest, ExpiredSessionIsNotReturned) {
+  EkepSessionCache cache;
+  EkepResumptionSession expired = MakeSession("ticket");
+  expired.expiration = absl::Now() - absl::Seconds(1);
+  cache.Insert("key", std::move(expired));
+
+  EkepResumptionSession session;
+  EXPECT_FALSE(cache.Lookup("key", &session));
+}
+
+TEST(EkepSessionCacheTest, EvictsOldestSession) {
+  EkepSessionCache cache(/*max_entries=*/2);
+  cache.Insert("first", MakeSession("1"));
+  cache.Insert("second", MakeSession("2"));
+  cache.Insert("third", MakeSession("3"));
+
+  EkepResumptionSession session;
+  EXPECT_FALSE(cache.Lookup("first", &session));
+  EXPECT_TRUE(cache.Lookup("second", &session));
+  EXPECT_TRUE(cache.Lookup("third", &session));
+}
+
+TEST(EkepSessionCacheTest, EraseRemovesSession) {
+  EkepSessionCache cache(/*max_entries=*/2);
+  cache.Insert("first", MakeSession("1"));
+  cache.Erase("first");
+
+  EkepResumptionSession session;
+  EXPECT_FALSE(cache.Lookup("first", &session));
+
+  // Erased entries do not count towards the cache capacity.
+  cache.Insert("second", MakeSession("2"));
+  cache.Insert("third", MakeSession("3"));
+  EXPECT_TRUE(cache.Lookup("second", &session));
+  EXPECT_TRUE(cache.Lookup("third", &session));
+}
+
+TEST(EkepTicketCrypterTest, CreateFailsWithNonPositiveLifetime) {
+  EXPECT_THAT(EkepTicketCrypter::Create(absl::ZeroDuration()), Not(IsOk()));
+}
+
+TEST(EkepTicketCrypterTest, CreateFailsWithExcessiveLifetime) {
+  EXPECT_THAT(EkepTicketCrypter::Create(EkepTicketCrypter::kMaxTicketLifetime +
+                                        absl::Seconds(1)),
+              Not(IsOk()));
+}
+
+TEST(EkepTicketCrypterTest, CreateFailsWithNoTicketsPerKey) {
+  EXPECT_THAT(EkepTicketCrypter::Create(
+                  EkepTicketCrypter::kDefaultTicketLifetime,
+                  /*tickets_per_key=*/0),
+              Not(IsOk()));
+}
+
+TEST(EkepTicketCrypterTest, KeyRotationRetiresOldTickets) {
+  auto crypter_result = EkepTicketCrypter::Create(
+      EkepTicketCrypter::kDefaultTicketLifetime, /*tickets_per_key=*/1);
+  ASSERT_THAT(crypter_result, IsOk());
+  std::unique_ptr<EkepTicketCrypter> crypter =
+      std::move(crypter_result).ValueOrDie();
+
+  std::vector<std::string> tickets;
+  for (int i = 0; i < 3; ++i) {
+    auto ticket_result = crypter->IssueTicket(MakeSession(""), kContext);
+    ASSERT_THAT(ticket_result, IsOk());
+    tickets.push_back(ticket_result.ValueOrDie());
+  }
+
+  // Each ticket was sealed under its own key, and only the last two keys are
+  // kept.
+  EkepResumptionSession opened;
+  EXPECT_THAT(crypter->OpenTicket(tickets[0], kContext, &opened),
+              Not(IsOk()));
+  EXPECT_THAT(crypter->OpenTicket(tickets[1], kContext, &opened), IsOk());
+  EXPECT_THAT(crypter->OpenTicket(tickets[2], kContext, &opened), IsOk());
+}
+
+TEST(EkepTicketCrypterTest, OpenTicketReturnsIssuedSession) {
+  auto crypter_result = EkepTicketCrypter::Create();
+  ASSERT_THAT(crypter_result, IsOk());
+  std::unique_ptr<EkepTicketCrypter> crypter =
+      std::move(crypter_result).ValueOrDie();
+
+  EkepResumptionSession issued = MakeSession("");
+  auto ticket_result = crypter->IssueTicket(issued, kContext);
+  ASSERT_THAT(ticket_result, IsOk());
+
+  EkepResumptionSession opened;
+  ASSERT_THAT(crypter->OpenTicket(ticket_result.ValueOrDie(), kContext,
+                                  &opened),
+              IsOk());
+  EXPECT_EQ(opened.cipher_suite, issued.cipher_suite);
+  EXPECT_EQ(opened.record_protocol, issued.record_protocol);
+  EXPECT_EQ(opened.resumption_secret, issued.resumption_secret);
+  EXPECT_EQ(opened.peer_identities.SerializeAsString(),
+            issued.peer_identities.SerializeAsString());
+  EXPECT_GT(opened.expiration, absl::Now());
+}
+
+TEST(EkepTicketCrypterTest, OpenTicketFailsWithDifferentContext) {
+  auto crypter_result = EkepTicketCrypter::Create();
+  ASSERT_THAT(crypter_result, IsOk());
+  std::unique_ptr<EkepTicketCrypter> crypter =
+      std::move(crypter_result).ValueOrDie();
+
+  auto ticket_result = crypter->IssueTicket(MakeSession(""), kContext);
+  ASSERT_THAT(ticket_result, IsOk());
+
+  EkepResumptionSession opened;
+  EXPECT_THAT(crypter->OpenTicket(ticket_result.ValueOrDie(),
+                                  "other context", &opened),
+              Not(IsOk()));
+}
+
+TEST(EkepTicketCrypterTest, OpenTicketFailsWithModifiedTicket) {
+  auto crypter_result = EkepTicketCrypter::Create();
+  ASSERT_THAT(crypter_result, IsOk());
+  std::unique_ptr<EkepTicketCrypter> crypter =
+      std::move(crypter_result).ValueOrDie();
+
+  auto ticket_result = crypter->IssueTicket(MakeSession(""), kContext);
+  ASSERT_THAT(ticket_result, IsOk());
+  std::string ticket = ticket_result.ValueOrDie();
+  ticket.back() ^= 1;
+
+  EkepResumptionSession opened;
+  EXPECT_THAT(crypter->OpenTicket(ticket, kContext, &opened), Not(IsOk()));
+  EXPECT_THAT(crypter->OpenTicket("", kContext, &opened), Not(IsOk()));
+}
+
+TEST(EkepTicketCrypterTest, OpenTicketFailsWithOtherCrypter) {
+  auto crypter_result = EkepTicketCrypter::Create();
+  ASSERT_THAT(crypter_result, IsOk());
+  auto other_crypter_result = EkepTicketCrypter::Create();
+  ASSERT_THAT(other_crypter_result, IsOk());
+
+  auto ticket_result =
+      crypter_result.ValueOrDie()->IssueTicket(MakeSession(""), kContext);
+  ASSERT_THAT(ticket_result, IsOk());
+
+  EkepResumptionSession opened;
+  EXPECT_THAT(other_crypter_result.ValueOrDie()->OpenTicket(
+                  ticket_result.ValueOrDie(), kContext, &opened),
+              Not(IsOk()));
+}
+
+class EkepResumptionHandshakeTest : public ::testing::Test {
+ protected:
+  static void SetUpTestCase() {
+    std::vector<EnclaveAssertionAuthorityConfig> authority_configs = {
+        GetNullAssertionAuthorityTestConfig(),
+    };
+    ASSERT_THAT(InitializeEnclaveAssertionAuthorities(
+                    authority_configs.cbegin(), authority_configs.cend()),
+                IsOk());
+  }
+
+  void SetUp() override {
+    AssertionDescription description;
+    SetNullAssertionDescription(&description);
+    client_options_.self_assertions = {description};
+    client_options_.accepted_peer_assertions = {description};
+    client_options_.session_cache = std::make_shared<EkepSessionCache>();
+    client_options_.session_cache_key = kServerAddress;
+
+    server_options_.self_assertions = {description};
+    server_options_.accepted_peer_assertions = {description};
+    auto crypter_result = EkepTicketCrypter::Create();
+    ASSERT_THAT(crypter_result, IsOk());
+    ticket_crypter_ = std::move(crypter_result).ValueOrDie();
+    server_options_.ticket_crypter = ticket_crypter_.get();
+  }
+
+  // Runs a handshake between a new client and a new server, and checks that
+  // both agree on the outcome. Writes the number of flights sent by the client
+  // to |client_flights|.
+  void RunHandshake(int *client_flights) {
+    std::unique_ptr<EkepHandshaker> client =
+        ClientEkepHandshaker::Create(client_options_);
+    std::unique_ptr<EkepHandshaker> server =
+        ServerEkepHandshaker::Create(server_options_);
+    ASSERT_NE(client, nullptr);
+    ASSERT_NE(server, nullptr);
+
+    std::string client_output;
+    std::string server_output;
+    EkepHandshaker::Result client_result =
+        client->NextHandshakeStep(nullptr, 0, &client_output);
+    *client_flights = 1;
+    while (client_result == EkepHandshaker::Result::IN_PROGRESS) {
+      ASSERT_EQ(server->NextHandshakeStep(client_output.data(),
+                                          client_output.size(), &server_output),
+                EkepHandshaker::Result::IN_PROGRESS);
+      client_result = client->NextHandshakeStep(
+          server_output.data(), server_output.size(), &client_output);
+      ++*client_flights;
+    }
+    ASSERT_EQ(client_result, EkepHandshaker::Result::COMPLETED);
+    ASSERT_EQ(server->NextHandshakeStep(client_output.data(),
+                                        client_output.size(), &server_output),
+              EkepHandshaker::Result::COMPLETED);
+
+    auto client_key = client->GetRecordProtocolKey();
+    auto server_key = server->GetRecordProtocolKey();
+    ASSERT_THAT(client_key, IsOk());
+    ASSERT_THAT(server_key, IsOk());
+    EXPECT_EQ(client_key.ValueOrDie(), server_key.ValueOrDie());
+
+    auto client_peer_identities = client->GetPeerIdentities();
+    auto server_peer_identities = server->GetPeerIdentities();
+    ASSERT_THAT(client_peer_identities, IsOk());
+    ASSERT_THAT(server_peer_identities, IsOk());
+    EXPECT_EQ(client_peer_identities.ValueOrDie()->identities_size(), 1);
+    EXPECT_EQ(server_peer_identities.ValueOrDie()->identities_size(), 1);
+  }
+
+  EkepHandshakerOptions client_options_;
+  EkepHandshakerOptions server_options_;
+  std::unique_ptr<EkepTicketCrypter> ticket_crypter_;
+};
+
+// Verify that a handshake following a full handshake is resumed, which saves
+// the client a flight.
+TEST_F(EkepResumptionHandshakeTest, SecondHandshakeIsResumed) {
+  int client_flights;
+  ASSERT_NO_FATAL_FAILURE(RunHandshake(&client_flights));
+  EXPECT_EQ(client_flights, 3);
+
+  ASSERT_NO_FATAL_FAILURE(RunHandshake(&client_flights));
+  EXPECT_EQ(client_flights, 2);
+
+  // Resumed handshakes issue new tickets, so they can be resumed as well.
+  ASSERT_NO_FATAL_FAILURE(RunHandshake(&client_flights));
+  EXPECT_EQ(client_flights, 2);
+}
+
+// Verify that the handshake falls back to a full handshake if the server
+// cannot open the client's ticket.
+TEST_F(EkepResumptionHandshakeTest, FallsBackToFullHandshake) {
+  int client_flights;
+  ASSERT_NO_FATAL_FAILURE(RunHandshake(&client_flights));
+  EXPECT_EQ(client_flights, 3);
+
+  // Simulate a server restart.
+  auto crypter_result = EkepTicketCrypter::Create();
+  ASSERT_THAT(crypter_result, IsOk());
+  ticket_crypter_ = std::move(crypter_result).ValueOrDie();
+  server_options_.ticket_crypter = ticket_crypter_.get();
+
+  ASSERT_NO_FATAL_FAILURE(RunHandshake(&client_flights));
+  EXPECT_EQ(client_flights, 3);
+
+  ASSERT_NO_FATAL_FAILURE(RunHandshake(&client_flights));
+  EXPECT_EQ(client_flights, 2);
+}
+
+// Verify that sessions are not resumed if the client's configuration changes.
+TEST_F(EkepResumptionHandshakeTest, ConfigurationChangePreventsResumption) {
+  int client_flights;
+  ASSERT_NO_FATAL_FAILURE(RunHandshake(&client_flights));
+  EXPECT_EQ(client_flights, 3);
+
+  client_options_.additional_authenticated_data = "new data";
+  ASSERT_NO_FATAL_FAILURE(RunHandshake(&client_flights));
+  EXPECT_EQ(client_flights, 3);
+}
+
+// Verify that a server without a ticket crypter performs full handshakes.
+TEST_F(EkepResumptionHandshakeTest, ServerWithoutCrypterDoesNotResume) {
+  server_options_.ticket_crypter = nullptr;
+
+  int client_flights;
+  ASSERT_NO_FATAL_FAILURE(RunHandshake(&client_flights));
+  EXPECT_EQ(client_flights, 3);
+  ASSERT_NO_FATAL_FAILURE(RunHandshake(&client_flights));
+  EXPECT_EQ(client_flights, 3);
+}
+
+// Verify that a client holding a ticket falls back to a full handshake if the
+// server has resumption disabled, and that a client with resumption disabled
+// does not offer its ticket.
+TEST_F(EkepResumptionHandshakeTest, DisabledResumptionUsesFullHandshake) {
+  int client_flights;
+  ASSERT_NO_FATAL_FAILURE(RunHandshake(&client_flights));
+  EXPECT_EQ(client_flights, 3);
+
+  server_options_.ticket_crypter = nullptr;
+  ASSERT_NO_FATAL_FAILURE(RunHandshake(&client_flights));
+  EXPECT_EQ(client_flights, 3);
+
+  server_options_.ticket_crypter = ticket_crypter_.get();
+  ASSERT_NO_FATAL_FAILURE(RunHandshake(&client_flights));
+  EXPECT_EQ(client_flights, 2);
+
+  client_options_.session_cache = nullptr;
+  ASSERT_NO_FATAL_FAILURE(RunHandshake(&client_flights));
+  EXPECT_EQ(client_flights, 3);
+}
+
+// Verify that the client handles the server's resumed flight, which carries
+// two frames, when it is split across calls: within the first frame, and within
+// the second frame after the first frame is complete.
+TEST_F(EkepResumptionHandshakeTest, ClientHandlesSplitResumedFlight) {
+  int client_flights;
+  ASSERT_NO_FATAL_FAILURE(RunHandshake(&client_flights));
+
+  for (bool split_in_first_frame : {true, false}) {
+    std::unique_ptr<EkepHandshaker> client =
+        ClientEkepHandshaker::Create(client_options_);
+    std::unique_ptr<EkepHandshaker> server =
+        ServerEkepHandshaker::Create(server_options_);
+    ASSERT_NE(client, nullptr);
+    ASSERT_NE(server, nullptr);
+
+    std::string client_output;
+    std::string server_output;
+    ASSERT_EQ(client->NextHandshakeStep(nullptr, 0, &client_output),
+              EkepHandshaker::Result::IN_PROGRESS);
+    ASSERT_EQ(server->NextHandshakeStep(client_output.data(),
+                                        client_output.size(), &server_output),
+              EkepHandshaker::Result::IN_PROGRESS);
+
+    // The first call only carries part of the flight, so the client has
+    // nothing to send yet.
+    size_t split = split_in_first_frame ? 1 : server_output.size() - 1;
+    EkepHandshaker::Result result =
+        client->NextHandshakeStep(server_output.data(), split, &client_output);
+    EXPECT_EQ(result, split_in_first_frame
+                          ? EkepHandshaker::Result::NOT_ENOUGH_DATA
+                          : EkepHandshaker::Result::IN_PROGRESS);
+    EXPECT_TRUE(client_output.empty());
+
+    // The second call completes the flight.
+    ASSERT_EQ(client->NextHandshakeStep(server_output.data() + split,
+                                        server_output.size() - split,
+                                        &client_output),
+              EkepHandshaker::Result::COMPLETED);
+    EXPECT_EQ(server->NextHandshakeStep(client_output.data(),
+                                        client_output.size(), &server_output),
+              EkepHandshaker::Result::COMPLETED);
+  }
+}
+
+}  // namespace
+}  // namespace asylo
@@ -73,7 +73,8 @@ grpc_enclave_server_credentials::create_security_connector() {
 
 grpc_enclave_channel_credentials::grpc_enclave_channel_credentials(
     const grpc_enclave_credentials_options &options)
-    : grpc_channel_credentials(GRPC_CREDENTIALS_TYPE_ENCLAVE) {
+    : grpc_channel_credentials(GRPC_CREDENTIALS_TYPE_ENCLAVE),
+      enable_session_resumption_(options.enable_session_resumption != 0) {
   // Initialize all members.
   safe_string_init(&additional_authenticated_data_);
   assertion_description_array_init(/*count=*/0, &self_assertions_);
@@ -91,7 +92,8 @@ grpc_enclave_channel_credentials::grpc_enclave_channel_credentials(
 
 grpc_enclave_server_credentials::grpc_enclave_server_credentials(
     const grpc_enclave_credentials_options &options)
-    : grpc_server_credentials(GRPC_CREDENTIALS_TYPE_ENCLAVE) {
+    : grpc_server_credentials(GRPC_CREDENTIALS_TYPE_ENCLAVE),
+      enable_session_resumption_(options.enable_session_resumption != 0) {
   // Initialize all members.
   safe_string_init(&additional_authenticated_data_);
   assertion_description_array_init(/*count=*/0, &self_assertions_);
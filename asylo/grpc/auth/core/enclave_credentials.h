@@ -64,6 +64,7 @@ class grpc_enclave_channel_credentials final : public grpc_channel_credentials {
   assertion_description_array* mutable_accepted_peer_assertions() {
     return &accepted_peer_assertions_;
   }
+  bool enable_session_resumption() const { return enable_session_resumption_; }
 
  private:
   // Additional authenticated data provided by the client.
@@ -75,6 +76,9 @@ class grpc_enclave_channel_credentials final : public grpc_channel_credentials {
   // Server assertions accepted by the client.
   assertion_description_array accepted_peer_assertions_;
 
+  // Whether the client offers and caches session resumption tickets.
+  bool enable_session_resumption_;
+
 };
 
 class grpc_enclave_server_credentials final : public grpc_server_credentials {
@@ -95,6 +99,7 @@ class grpc_enclave_server_credentials final : public grpc_server_credentials {
   assertion_description_array* mutable_accepted_peer_assertions() {
     return &accepted_peer_assertions_;
   }
+  bool enable_session_resumption() const { return enable_session_resumption_; }
 
  private:
   // Additional authenticated data provided by the server.
@@ -106,6 +111,9 @@ class grpc_enclave_server_credentials final : public grpc_server_credentials {
   // Client assertions accepted by the server.
   assertion_description_array accepted_peer_assertions_;
 
+  // Whether the server issues and accepts session resumption tickets.
+  bool enable_session_resumption_;
+
 };
 
 #endif  // ASYLO_GRPC_AUTH_CORE_ENCLAVE_CREDENTIALS_H_
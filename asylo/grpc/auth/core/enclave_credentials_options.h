@@ -31,6 +31,9 @@ typedef struct {
   /* The credential holder's accepted peer assertions. */
   assertion_description_array accepted_peer_assertions;
 
+  /* Whether the credential holder resumes EKEP sessions. */
+  int enable_session_resumption;
+
 } grpc_enclave_credentials_options;
 
 /* Initializes an options object. This should be called before assigning to or
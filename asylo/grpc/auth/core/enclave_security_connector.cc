@@ -170,7 +170,7 @@ class grpc_enclave_channel_security_connector final
         /*is_client=*/true, channel_creds->mutable_self_assertions(),
         channel_creds->mutable_accepted_peer_assertions(),
         channel_creds->mutable_additional_authenticated_data(),
-        &tsi_handshaker);
+        channel_creds->enable_session_resumption(), target_, &tsi_handshaker);
     if (result != TSI_OK) {
       gpr_log(GPR_ERROR, "Enclave handshaker creation failed with error %s.",
               tsi_result_to_string(result));
@@ -216,7 +216,9 @@ class grpc_enclave_server_security_connector final
     tsi_result result = tsi_enclave_handshaker_create(
         /*is_client=*/false, server_creds->mutable_self_assertions(),
         server_creds->mutable_accepted_peer_assertions(),
-        server_creds->mutable_additional_authenticated_data(), &tsi_handshaker);
+        server_creds->mutable_additional_authenticated_data(),
+        server_creds->enable_session_resumption(),
+        /*session_cache_key=*/nullptr, &tsi_handshaker);
     if (result != TSI_OK) {
       gpr_log(GPR_ERROR, "Enclave handshaker creation failed with error %s.",
               tsi_result_to_string(result));
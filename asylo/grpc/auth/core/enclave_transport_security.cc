@@ -28,6 +28,7 @@
 #include "asylo/grpc/auth/core/client_ekep_handshaker.h"
 #include "asylo/grpc/auth/core/ekep_handshaker.h"
 #include "asylo/grpc/auth/core/ekep_handshaker_util.h"
+#include "asylo/grpc/auth/core/ekep_resumption.h"
 #include "asylo/grpc/auth/core/handshake.pb.h"
 #include "asylo/grpc/auth/core/server_ekep_handshaker.h"
 #include "asylo/identity/identity.pb.h"
@@ -44,6 +45,29 @@ namespace {
 
 constexpr int kEnclavePeerPropertyCount = 3;
 
+// Returns the session cache shared by all client handshakers in the process.
+std::shared_ptr<EkepSessionCache> GetClientSessionCache() {
+  static std::shared_ptr<EkepSessionCache> *session_cache =
+      new std::shared_ptr<EkepSessionCache>(
+          std::make_shared<EkepSessionCache>());
+  return *session_cache;
+}
+
+// Returns the ticket crypter shared by all server handshakers in the process,
+// or nullptr if it could not be created.
+EkepTicketCrypter *GetServerTicketCrypter() {
+  static EkepTicketCrypter *ticket_crypter = [] {
+    auto crypter_result = EkepTicketCrypter::Create();
+    if (!crypter_result.ok()) {
+      gpr_log(GPR_ERROR, "EKEP session resumption is disabled: %s",
+              crypter_result.status().ToString().c_str());
+      return static_cast<EkepTicketCrypter *>(nullptr);
+    }
+    return std::move(crypter_result).ValueOrDie().release();
+  }();
+  return ticket_crypter;
+}
+
 // Converts an assertion_description_array to a vector of AssertionDescriptions.
 std::vector<AssertionDescription> CreateAssertionDescriptionVector(
     const assertion_description_array &descriptions_array) {
@@ -375,14 +399,16 @@ tsi_result tsi_enclave_handshaker_create(
     int is_client, const assertion_description_array *self_assertions,
     const assertion_description_array *accepted_peer_assertions,
     const safe_string *additional_authenticated_data,
+    int enable_session_resumption, const char *session_cache_key,
     tsi_handshaker **handshaker) {
   GRPC_API_TRACE(
       "tsi_enclave_handshaker_create(is_client=%d, self_assertions=%p, "
       "accepted_peer_assertions=%p, additional_authenticated_data=%p, "
-      "handshaker=%p)",
-      5,
+      "enable_session_resumption=%d, session_cache_key=%s, handshaker=%p)",
+      7,
       (is_client, self_assertions, accepted_peer_assertions,
-       additional_authenticated_data, handshaker));
+       additional_authenticated_data, enable_session_resumption,
+       session_cache_key ? session_cache_key : "(null)", handshaker));
 
   // Convert arguments to handshaker options.
   asylo::EkepHandshakerOptions options;
@@ -392,6 +418,16 @@ tsi_result tsi_enclave_handshaker_create(
       asylo::CreateAssertionDescriptionVector(*self_assertions);
   options.accepted_peer_assertions =
       asylo::CreateAssertionDescriptionVector(*accepted_peer_assertions);
+  // Without a session cache or ticket crypter, the handshaker performs a full
+  // handshake.
+  if (enable_session_resumption) {
+    if (!is_client) {
+      options.ticket_crypter = asylo::GetServerTicketCrypter();
+    } else if (session_cache_key) {
+      options.session_cache = asylo::GetClientSessionCache();
+      options.session_cache_key = session_cache_key;
+    }
+  }
 
   if (!options.additional_authenticated_data.empty()) {
     gpr_log(GPR_DEBUG, "additional authenticated data: %s",
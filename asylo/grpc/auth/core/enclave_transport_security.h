@@ -42,10 +42,18 @@
 //   is willing to accept from the peer during the handshake
 //   * |additional_authenticated_data| is data to be authenticated as part of
 //   the handshake
+//   * |enable_session_resumption| indicates whether to resume EKEP sessions.
+//   If zero, the handshaker neither offers nor issues resumption tickets, and
+//   always performs a full handshake
+//   * |session_cache_key| identifies the server to a client handshaker, for
+//   example by its address. If non-null and resumption is enabled, the client
+//   offers and stores resumption tickets under this key in a process-wide
+//   session cache. Server handshakers ignore this argument
 tsi_result tsi_enclave_handshaker_create(
     int is_client, const assertion_description_array *self_assertions,
     const assertion_description_array *accepted_peer_assertions,
     const safe_string *additional_authenticated_data,
+    int enable_session_resumption, const char *session_cache_key,
     tsi_handshaker **handshaker);
 
 #endif  // ASYLO_GRPC_AUTH_CORE_ENCLAVE_TRANSPORT_SECURITY_H_
@@ -23,6 +23,7 @@
 
 #include <google/protobuf/io/zero_copy_stream_impl_lite.h>
 #include "absl/memory/memory.h"
+#include "absl/time/time.h"
 #include "asylo/crypto/sha256_hash.h"
 #include "asylo/util/logging.h"
 #include "asylo/grpc/auth/core/ekep_crypto.h"
@@ -64,6 +65,14 @@ ServerEkepHandshaker::ServerEkepHandshaker(const EkepHandshakerOptions &options)
       additional_authenticated_data_(options.additional_authenticated_data),
       selected_cipher_suite_(UNKNOWN_HANDSHAKE_CIPHER),
       selected_record_protocol_(UNKNOWN_RECORD_PROTOCOL),
+      ticket_crypter_(options.ticket_crypter),
+      resumption_context_(options.ticket_crypter
+                              ? MakeEkepResumptionContext(
+                                    /*prefix=*/"", options.self_assertions,
+                                    options.accepted_peer_assertions,
+                                    options.additional_authenticated_data)
+                              : ""),
+      resumed_(false),
       expected_message_type_(CLIENT_PRECOMMIT),
       // The handshake is in progress for the server because it relies on the
       // client to act first.
@@ -232,6 +241,18 @@ Status ServerEkepHandshaker::HandleClientPrecommit(
                   "Received a challenge with incorrect size");
   }
 
+  if (ticket_crypter_ && !client_precommit.resumption_ticket().empty()) {
+    EkepResumptionSession session;
+    Status status = ticket_crypter_->OpenTicket(
+        client_precommit.resumption_ticket(), resumption_context_, &session);
+    if (status.ok() && session.cipher_suite == selected_cipher_suite_ &&
+        session.record_protocol == selected_record_protocol_) {
+      return ResumeSession(session, output);
+    }
+    // The ticket is not usable, so fall back to a full handshake.
+    VLOG(1) << "Declining resumption ticket: " << status;
+  }
+
   for (const AssertionOffer &offer : client_precommit.client_offers()) {
     const AssertionDescription &offer_desc = offer.description();
     // Request any assertion that the peer offered and that this handshaker is
@@ -272,6 +293,34 @@ Status ServerEkepHandshaker::HandleClientPrecommit(
   return WriteServerPrecommit(output);
 }
 
+Status ServerEkepHandshaker::ResumeSession(const EkepResumptionSession &session,
+                                           std::string *output) {
+  for (const EnclaveIdentity &identity : session.peer_identities.identities()) {
+    AddPeerIdentity(identity);
+  }
+
+  resumed_ = true;
+  ASYLO_RETURN_IF_ERROR(WriteServerPrecommit(output));
+
+  // At this stage in the protocol, the transcript is:
+  //   hash(ClientPrecommit || ServerPrecommit)
+  //
+  // This transcript is used by both the client and server to derive the EKEP
+  // secrets of the resumed handshake.
+  std::string transcript_hash;
+  ASYLO_RETURN_IF_ERROR(GetTranscriptHash(&transcript_hash));
+  ASYLO_RETURN_IF_ERROR(DeriveResumedSecrets(
+      selected_cipher_suite_, transcript_hash, session.resumption_secret,
+      &master_secret_, &authenticator_secret_));
+  ASYLO_RETURN_IF_ERROR(DeriveResumptionSecret(
+      selected_cipher_suite_, transcript_hash, master_secret_,
+      &resumption_secret_));
+
+  // The ClientId and ServerId messages are skipped.
+  expected_message_type_ = CLIENT_FINISH;
+  return WriteServerFinish(output);
+}
+
 Status ServerEkepHandshaker::HandleClientId(const google::protobuf::Message &message,
                                             std::string *output) {
   const auto *client_id_ptr = dynamic_cast<const ClientId *>(&message);
@@ -377,6 +426,10 @@ Status ServerEkepHandshaker::WriteServerPrecommit(std::string *output) {
   }
   server_precommit.set_challenge(challenge.data(), challenge.size());
 
+  if (resumed_) {
+    server_precommit.set_resumption_accepted(true);
+  }
+
   for (const AssertionRequest &request : promised_assertions_) {
     const AssertionDescription &description = request.description();
     // Note that assertion generators were verified during creation of the
@@ -460,22 +513,26 @@ Status ServerEkepHandshaker::WriteServerId(std::string *output) {
   ASYLO_RETURN_IF_ERROR(
       WriteFrameAndUpdateTranscript(SERVER_ID, server_id, output));
 
-  return WriteServerFinish(output);
-}
-
-Status ServerEkepHandshaker::WriteServerFinish(std::string *output) {
   // At this stage in the protocol, the transcript is:
   //   hash(ClientPrecommit || ServerPrecommit || ClientId || ServerId)
   //
   // This transcript is used by both the client and server to derive the EKEP
   // secrets.
-  std::string transcript_hash;
   ASYLO_RETURN_IF_ERROR(GetTranscriptHash(&transcript_hash));
 
   ASYLO_RETURN_IF_ERROR(DeriveSecrets(selected_cipher_suite_, transcript_hash,
                                       client_public_key_, dh_private_key_,
                                       &master_secret_, &authenticator_secret_));
+  if (ticket_crypter_) {
+    ASYLO_RETURN_IF_ERROR(DeriveResumptionSecret(
+        selected_cipher_suite_, transcript_hash, master_secret_,
+        &resumption_secret_));
+  }
 
+  return WriteServerFinish(output);
+}
+
+Status ServerEkepHandshaker::WriteServerFinish(std::string *output) {
   CleansingVector<uint8_t> authenticator;
   ASYLO_RETURN_IF_ERROR(ComputeServerHandshakeAuthenticator(
       selected_cipher_suite_, authenticator_secret_, &authenticator));
@@ -484,6 +541,26 @@ Status ServerEkepHandshaker::WriteServerFinish(std::string *output) {
   server_finish.set_handshake_authenticator(authenticator.data(),
                                             authenticator.size());
 
+  if (ticket_crypter_) {
+    EkepResumptionSession session;
+    session.cipher_suite = selected_cipher_suite_;
+    session.record_protocol = selected_record_protocol_;
+    session.resumption_secret = resumption_secret_;
+    session.peer_identities = PeerIdentities();
+    StatusOr<std::string> ticket_result =
+        ticket_crypter_->IssueTicket(session, resumption_context_);
+    if (ticket_result.ok()) {
+      server_finish.set_resumption_ticket(ticket_result.ValueOrDie());
+      server_finish.set_resumption_ticket_lifetime(
+          absl::ToInt64Seconds(ticket_crypter_->ticket_lifetime()));
+    } else {
+      // Failing to issue a ticket only costs the client a full handshake next
+      // time, so it does not fail this handshake.
+      LOG(WARNING) << "Failed to issue resumption ticket: "
+                   << ticket_result.status();
+    }
+  }
+
   return WriteFrameAndUpdateTranscript(SERVER_FINISH, server_finish, output);
 }
 
@@ -28,6 +28,7 @@
 #include <google/protobuf/message.h>
 #include "asylo/grpc/auth/core/ekep_handshaker.h"
 #include "asylo/grpc/auth/core/ekep_handshaker_util.h"
+#include "asylo/grpc/auth/core/ekep_resumption.h"
 #include "asylo/util/cleansing_types.h"
 
 namespace asylo {
@@ -36,6 +37,12 @@ namespace asylo {
 // handshake. It handles ClientPrecommit, ClientId, and ClientFinish messages
 // from the client and sends ServerPrecommit, ServerId, and ServerFinish
 // messages to the client.
+//
+// If configured with a ticket crypter, the server issues a resumption ticket in
+// each ServerFinish. If a later ClientPrecommit carries a ticket that the
+// server can open, the server resumes the session: it follows its
+// ServerPrecommit with a ServerFinish, and the ClientId and ServerId messages
+// are skipped.
 class ServerEkepHandshaker final : public EkepHandshaker {
  public:
   // Creates a ServerEkepHandshaker configured with the given |options|, if
@@ -81,6 +88,11 @@ class ServerEkepHandshaker final : public EkepHandshaker {
   Status HandleClientPrecommit(const google::protobuf::Message &message,
                                std::string *output);
 
+  // Resumes |session|. Writes the ServerPrecommit and ServerFinish messages to
+  // |output| and updates the handshake transcript with both outgoing frames.
+  Status ResumeSession(const EkepResumptionSession &session,
+                       std::string *output);
+
   // Validates the ClientId handshake message contained in |message|. If
   // validation succeeds, writes the ServerId and ServerFinish messages to
   // |output| and updates the handshake transcript with both outgoing frames.
@@ -94,10 +106,12 @@ class ServerEkepHandshaker final : public EkepHandshaker {
   Status WriteServerPrecommit(std::string *output);
 
   // Writes the ServerId frame to |output| and updates the handshake transcript.
+  // Then derives the EKEP secrets and writes the ServerFinish frame.
   Status WriteServerId(std::string *output);
 
   // Writes the ServerFinish frame to |output| and updates the handshake
-  // transcript.
+  // transcript. If |ticket_crypter_| is set, the ServerFinish carries a new
+  // resumption ticket.
   Status WriteServerFinish(std::string *output);
 
   // Sets the handshaker's selected EKEP version to first compatible EKEP
@@ -169,6 +183,20 @@ class ServerEkepHandshaker final : public EkepHandshaker {
   CleansingVector<uint8_t> master_secret_;
   CleansingVector<uint8_t> authenticator_secret_;
 
+  // Crypter for resumption tickets, or nullptr if session resumption is
+  // disabled.
+  EkepTicketCrypter *const ticket_crypter_;
+
+  // The context to which this server's resumption tickets are bound.
+  const std::string resumption_context_;
+
+  // Whether this handshake resumes a previous session.
+  bool resumed_;
+
+  // The resumption secret of this handshake. This field is only populated if
+  // |ticket_crypter_| is set.
+  CleansingVector<uint8_t> resumption_secret_;
+
   // A snapshot of the transcript to which the client's assertions are bound:
   //   hash(ClientPrecommit || ServerPrecommit)
   std::string client_assertion_transcript_;
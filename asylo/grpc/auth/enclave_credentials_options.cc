@@ -25,6 +25,8 @@ EnclaveCredentialsOptions &EnclaveCredentialsOptions::Add(
                          additional.self_assertions.end());
   accepted_peer_assertions.insert(additional.accepted_peer_assertions.begin(),
                                   additional.accepted_peer_assertions.end());
+  enable_session_resumption =
+      enable_session_resumption || additional.enable_session_resumption;
   return *this;
 }
 
@@ -46,6 +46,13 @@ struct EnclaveCredentialsOptions {
 
   /// Peer assertions accepted by the credential holder.
   AssertionDescriptionHashSet accepted_peer_assertions;
+
+  /// Whether to resume previously-established sessions with abbreviated
+  /// handshakes. Channel credentials offer and cache resumption tickets, and
+  /// server credentials issue and accept them. Sessions are resumed only if
+  /// both peers enable resumption; otherwise every connection performs a full
+  /// handshake. Disabled by default.
+  bool enable_session_resumption = false;
 };
 
 }  // namespace asylo
@@ -100,5 +100,20 @@ TEST_F(EnclaveCredentialsOptionsTest, BidirectionalSgxLocalNull) {
                            EqualsProto(sgx_local_assertion_description_)));
 }
 
+/// Verifies that session resumption is disabled by default, and that it is
+/// enabled in combined options if either set of options enables it.
+TEST_F(EnclaveCredentialsOptionsTest, SessionResumption) {
+  EXPECT_FALSE(BidirectionalNullCredentialsOptions().enable_session_resumption);
+
+  EnclaveCredentialsOptions resumption;
+  resumption.enable_session_resumption = true;
+  EXPECT_TRUE(BidirectionalNullCredentialsOptions()
+                  .Add(resumption)
+                  .enable_session_resumption);
+  EXPECT_TRUE(EnclaveCredentialsOptions(resumption)
+                  .Add(BidirectionalNullCredentialsOptions())
+                  .enable_session_resumption);
+}
+
 }  // namespace
 }  // namespace asylo
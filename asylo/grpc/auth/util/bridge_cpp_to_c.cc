@@ -63,6 +63,7 @@ void CopyEnclaveCredentialsOptions(const EnclaveCredentialsOptions &src,
                        src.additional_authenticated_data.size(),
                        src.additional_authenticated_data.data());
   }
+  dest->enable_session_resumption = src.enable_session_resumption;
 }
 
 }  // namespace asylo
@@ -94,6 +94,10 @@ bool CredentialsOptionsAreEqual(
                                      actual.accepted_peer_assertions)) {
     return false;
   }
+  if (expected.enable_session_resumption !=
+      (actual.enable_session_resumption != 0)) {
+    return false;
+  }
   return AdditionalAuthenticatedDataIsEqual(
       expected.additional_authenticated_data,
       actual.additional_authenticated_data);
@@ -132,5 +136,16 @@ TEST_F(BridgeCppToCTest, CopyEnclaveCredentialsOptionsEmpty) {
   ASSERT_NO_FATAL_FAILURE(CredentialsOptionsAreEqual(options, bridge_options_));
 }
 
+// Verifies that CopyEnclaveCredentialsOptions translates the session resumption
+// setting.
+TEST_F(BridgeCppToCTest, CopyEnclaveCredentialsOptionsSessionResumption) {
+  EnclaveCredentialsOptions options = BidirectionalNullCredentialsOptions();
+  options.enable_session_resumption = true;
+  CopyEnclaveCredentialsOptions(options, &bridge_options_);
+
+  EXPECT_NE(bridge_options_.enable_session_resumption, 0);
+  EXPECT_TRUE(CredentialsOptionsAreEqual(options, bridge_options_));
+}
+
 }  // namespace
 }  // namespace asylo
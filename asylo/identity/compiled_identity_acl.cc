@@ -0,0 +1,330 @@
+/*
+ *
+ * Copyright 2018 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/identity/compiled_identity_acl.h"
+
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "asylo/identity/sgx/code_identity.pb.h"
+#include "asylo/identity/sgx/code_identity_constants.h"
+#include "asylo/identity/sgx/code_identity_util.h"
+#include "asylo/util/status_macros.h"
+
+namespace asylo {
+namespace {
+
+// Returns true if |description| describes an SGX code identity.
+bool IsSgxIdentityDescription(const EnclaveIdentityDescription &description) {
+  return description.identity_type() == CODE_IDENTITY &&
+         description.authority_type() == sgx::kSgxAuthorizationAuthority;
+}
+
+}  // namespace
+
+constexpr size_t CompiledIdentityAcl::kMaxCachedIdentities;
+
+StatusOr<std::unique_ptr<CompiledIdentityAcl>> CompiledIdentityAcl::Compile(
+    const IdentityAclPredicate &acl) {
+  std::unique_ptr<CompiledIdentityAcl> compiled(new CompiledIdentityAcl());
+  ASYLO_RETURN_IF_ERROR(compiled->CompilePredicate(acl));
+  return std::move(compiled);
+}
+
+Status CompiledIdentityAcl::CompilePredicate(const IdentityAclPredicate &acl) {
+  size_t index = program_.size();
+  program_.emplace_back();
+
+  switch (acl.item_case()) {
+    case IdentityAclPredicate::kAclGroup: {
+      const IdentityAclGroup &group = acl.acl_group();
+      if (group.predicates().empty()) {
+        return Status(error::GoogleError::INVALID_ARGUMENT,
+                      "ACL predicate groups cannot be empty");
+      }
+      switch (group.type()) {
+        case IdentityAclGroup::OR:
+          program_[index].opcode = Instruction::OR;
+          break;
+        case IdentityAclGroup::AND:
+          program_[index].opcode = Instruction::AND;
+          break;
+        case IdentityAclGroup::NOT:
+          if (group.predicates_size() != 1) {
+            return Status(error::GoogleError::INVALID_ARGUMENT,
+                          "NOT predicate groups must have exactly one element");
+          }
+          program_[index].opcode = Instruction::NOT;
+          break;
+        default:
+          return Status(error::GoogleError::INVALID_ARGUMENT,
+                        absl::StrCat("Unknown acl_group type: ", group.type()));
+      }
+      for (const IdentityAclPredicate &predicate : group.predicates()) {
+        ASYLO_RETURN_IF_ERROR(CompilePredicate(predicate));
+      }
+      break;
+    }
+    case IdentityAclPredicate::kExpectation: {
+      const EnclaveIdentityExpectation &expectation = acl.expectation();
+      if (!IsSgxIdentityDescription(
+              expectation.reference_identity().description())) {
+        program_[index].opcode = Instruction::MATCH_GENERIC;
+        program_[index].operand = generic_expectations_.size();
+        generic_expectations_.push_back(expectation);
+        break;
+      }
+
+      sgx::CodeIdentityExpectation sgx_expectation;
+      ASYLO_RETURN_IF_ERROR(
+          sgx::ParseSgxExpectation(expectation, &sgx_expectation));
+      // Reject invalid expectations up front, since MatchSgx() relies on the
+      // same invariants that MatchIdentityToExpectation() checks on each call.
+      if (!sgx::IsValidExpectation(sgx_expectation)) {
+        return Status(error::GoogleError::INVALID_ARGUMENT,
+                      "Expectation parameter is invalid");
+      }
+      const sgx::CodeIdentity &reference = sgx_expectation.reference_identity();
+      const sgx::CodeIdentityMatchSpec &spec = sgx_expectation.match_spec();
+
+      SgxExpectationFields fields;
+      fields.reference.has_mrenclave = reference.has_mrenclave();
+      fields.reference.mrenclave = reference.mrenclave().hash();
+      fields.reference.has_mrsigner =
+          reference.signer_assigned_identity().has_mrsigner();
+      fields.reference.mrsigner =
+          reference.signer_assigned_identity().mrsigner().hash();
+      fields.reference.isvprodid =
+          reference.signer_assigned_identity().isvprodid();
+      fields.reference.isvsvn = reference.signer_assigned_identity().isvsvn();
+      fields.reference.miscselect = reference.miscselect();
+      fields.reference.attributes_flags = reference.attributes().flags();
+      fields.reference.attributes_xfrm = reference.attributes().xfrm();
+      fields.mrenclave_match_required = spec.is_mrenclave_match_required();
+      fields.mrsigner_match_required = spec.is_mrsigner_match_required();
+      fields.miscselect_match_mask = spec.miscselect_match_mask();
+      fields.attributes_flags_match_mask = spec.attributes_match_mask().flags();
+      fields.attributes_xfrm_match_mask = spec.attributes_match_mask().xfrm();
+      fields.expectation = expectation;
+
+      program_[index].opcode = Instruction::MATCH_SGX;
+      program_[index].operand = sgx_expectations_.size();
+      sgx_expectations_.push_back(std::move(fields));
+      break;
+    }
+    case IdentityAclPredicate::ITEM_NOT_SET:
+      return Status(
+          error::GoogleError::INVALID_ARGUMENT,
+          "Invalid ACL predicate: must be either a group or an expectation.");
+    default:
+      return Status(error::GoogleError::INVALID_ARGUMENT,
+                    absl::StrCat("Unknown acl item: ", acl.item_case()));
+  }
+
+  program_[index].end = program_.size();
+  return Status::OkStatus();
+}
+
+StatusOr<bool> CompiledIdentityAcl::Evaluate(
+    const std::vector<EnclaveIdentity> &identities,
+    const IdentityExpectationMatcher &matcher) const {
+  std::vector<PreparedIdentity> prepared(identities.size());
+  for (size_t i = 0; i < identities.size(); ++i) {
+    prepared[i].identity = &identities[i];
+    prepared[i].is_sgx =
+        !sgx_expectations_.empty() &&
+        IsSgxIdentityDescription(identities[i].description());
+    if (!prepared[i].is_sgx) {
+      continue;
+    }
+
+    // Parsing errors are reported only if an SGX expectation is actually
+    // evaluated against this identity, matching the behavior of
+    // EvaluateIdentityAcl().
+    StatusOr<std::shared_ptr<const SgxIdentityFields>> sgx_identity =
+        GetSgxIdentity(identities[i]);
+    if (sgx_identity.ok()) {
+      prepared[i].sgx = std::move(sgx_identity).ValueOrDie();
+    } else {
+      prepared[i].sgx_status = sgx_identity.status();
+    }
+  }
+
+  return EvaluateInstruction(/*index=*/0, prepared, matcher);
+}
+
+StatusOr<bool> CompiledIdentityAcl::EvaluateInstruction(
+    size_t index, const std::vector<PreparedIdentity> &identities,
+    const IdentityExpectationMatcher &matcher) const {
+  const Instruction &instruction = program_[index];
+
+  switch (instruction.opcode) {
+    case Instruction::OR:
+      for (size_t child = index + 1; child < instruction.end;
+           child = program_[child].end) {
+        bool result;
+        ASYLO_ASSIGN_OR_RETURN(result,
+                               EvaluateInstruction(child, identities, matcher));
+        if (result) {
+          return true;
+        }
+      }
+      return false;
+    case Instruction::AND:
+      for (size_t child = index + 1; child < instruction.end;
+           child = program_[child].end) {
+        bool result;
+        ASYLO_ASSIGN_OR_RETURN(result,
+                               EvaluateInstruction(child, identities, matcher));
+        if (!result) {
+          return false;
+        }
+      }
+      return true;
+    case Instruction::NOT: {
+      bool result;
+      ASYLO_ASSIGN_OR_RETURN(
+          result, EvaluateInstruction(index + 1, identities, matcher));
+      return !result;
+    }
+    case Instruction::MATCH_SGX:
+    case Instruction::MATCH_GENERIC:
+      return EvaluateLeaf(instruction, identities, matcher);
+  }
+
+  return Status(error::GoogleError::INTERNAL,
+                absl::StrCat("Unknown instruction opcode: ",
+                             static_cast<int>(instruction.opcode)));
+}
+
+StatusOr<bool> CompiledIdentityAcl::EvaluateLeaf(
+    const Instruction &instruction,
+    const std::vector<PreparedIdentity> &identities,
+    const IdentityExpectationMatcher &matcher) const {
+  for (const PreparedIdentity &identity : identities) {
+    StatusOr<bool> result;
+    if (instruction.opcode == Instruction::MATCH_GENERIC) {
+      result = matcher.Match(*identity.identity,
+                             generic_expectations_[instruction.operand]);
+    } else if (!identity.is_sgx) {
+      result = matcher.Match(
+          *identity.identity,
+          sgx_expectations_[instruction.operand].expectation);
+    } else if (!identity.sgx) {
+      return identity.sgx_status;
+    } else {
+      result =
+          MatchSgx(*identity.sgx, sgx_expectations_[instruction.operand]);
+    }
+
+    if (!result.ok()) {
+      return result;
+    }
+    if (result.ValueOrDie()) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+StatusOr<std::shared_ptr<const CompiledIdentityAcl::SgxIdentityFields>>
+CompiledIdentityAcl::GetSgxIdentity(const EnclaveIdentity &identity) const {
+  {
+    absl::MutexLock lock(&cache_mu_);
+    auto it = cache_.find(identity.identity());
+    if (it != cache_.end()) {
+      return it->second;
+    }
+  }
+
+  sgx::CodeIdentity code_identity;
+  ASYLO_RETURN_IF_ERROR(sgx::ParseSgxIdentity(identity, &code_identity));
+  if (!sgx::IsValidCodeIdentity(code_identity)) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Identity parameter is invalid");
+  }
+
+  auto fields = std::make_shared<SgxIdentityFields>();
+  fields->has_mrenclave = code_identity.has_mrenclave();
+  fields->mrenclave = code_identity.mrenclave().hash();
+  fields->has_mrsigner =
+      code_identity.signer_assigned_identity().has_mrsigner();
+  fields->mrsigner = code_identity.signer_assigned_identity().mrsigner().hash();
+  fields->isvprodid = code_identity.signer_assigned_identity().isvprodid();
+  fields->isvsvn = code_identity.signer_assigned_identity().isvsvn();
+  fields->miscselect = code_identity.miscselect();
+  fields->attributes_flags = code_identity.attributes().flags();
+  fields->attributes_xfrm = code_identity.attributes().xfrm();
+
+  absl::MutexLock lock(&cache_mu_);
+  auto emplace_result = cache_.emplace(identity.identity(), fields);
+  if (!emplace_result.second) {
+    // Another thread populated the entry concurrently.
+    return emplace_result.first->second;
+  }
+  cache_order_.push_back(identity.identity());
+  if (cache_order_.size() > kMaxCachedIdentities) {
+    cache_.erase(cache_order_.front());
+    cache_order_.pop_front();
+  }
+  return std::shared_ptr<const SgxIdentityFields>(std::move(fields));
+}
+
+StatusOr<bool> CompiledIdentityAcl::MatchSgx(
+    const SgxIdentityFields &identity,
+    const SgxExpectationFields &expectation) {
+  const SgxIdentityFields &expected = expectation.reference;
+
+  if ((expectation.mrenclave_match_required && !identity.has_mrenclave) ||
+      (expectation.mrsigner_match_required && !identity.has_mrsigner)) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Identity is not compatible with specified match spec");
+  }
+
+  if (expectation.mrenclave_match_required &&
+      identity.mrenclave != expected.mrenclave) {
+    return false;
+  }
+  if (expectation.mrsigner_match_required &&
+      identity.mrsigner != expected.mrsigner) {
+    return false;
+  }
+  if (identity.isvprodid != expected.isvprodid) {
+    return false;
+  }
+  if (identity.isvsvn < expected.isvsvn) {
+    return false;
+  }
+  if ((identity.miscselect & expectation.miscselect_match_mask) !=
+      (expected.miscselect & expectation.miscselect_match_mask)) {
+    return false;
+  }
+  if ((identity.attributes_flags & expectation.attributes_flags_match_mask) !=
+          (expected.attributes_flags &
+           expectation.attributes_flags_match_mask) ||
+      (identity.attributes_xfrm & expectation.attributes_xfrm_match_mask) !=
+          (expected.attributes_xfrm &
+           expectation.attributes_xfrm_match_mask)) {
+    return false;
+  }
+
+  return true;
+}
+
+}  // namespace asylo
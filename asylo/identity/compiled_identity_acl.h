@@ -0,0 +1,189 @@
+/*
+ *
+ * Copyright 2018 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_IDENTITY_COMPILED_IDENTITY_ACL_H_
+#define ASYLO_IDENTITY_COMPILED_IDENTITY_ACL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "asylo/identity/identity.pb.h"
+#include "asylo/identity/identity_acl.pb.h"
+#include "asylo/identity/identity_expectation_matcher.h"
+#include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+
+/// A pre-processed form of an `IdentityAclPredicate` that can be evaluated
+/// repeatedly without re-walking or re-parsing the ACL protos.
+///
+/// `Compile()` validates the ACL and flattens the predicate tree into a linear
+/// program. Expectations on SGX code identities are parsed once into a
+/// fixed-layout representation, so that matching an SGX peer identity against
+/// them reduces to a handful of integer and byte comparisons. Parsed SGX peer
+/// identities are kept in a small bounded cache keyed by their serialized
+/// form, so repeated evaluations for the same peer skip proto parsing too.
+///
+/// Expectations on all other identity types are evaluated by delegating to the
+/// `IdentityExpectationMatcher` passed to `Evaluate()`, exactly as
+/// `EvaluateIdentityAcl()` does.
+///
+/// Unlike `EvaluateIdentityAcl()`, which only reports malformed sub-predicates
+/// when they are reached, `Compile()` rejects any malformed ACL up front.
+///
+/// This class is thread-safe.
+class CompiledIdentityAcl {
+ public:
+  /// The maximum number of parsed peer identities retained by the cache.
+  static constexpr size_t kMaxCachedIdentities = 64;
+
+  /// Compiles `acl`.
+  ///
+  /// \param acl An ACL satisfying the constraints documented on
+  ///            `EvaluateIdentityAcl()`.
+  /// \return The compiled ACL, or a non-OK Status if `acl` is malformed.
+  static StatusOr<std::unique_ptr<CompiledIdentityAcl>> Compile(
+      const IdentityAclPredicate &acl);
+
+  CompiledIdentityAcl(const CompiledIdentityAcl &other) = delete;
+  CompiledIdentityAcl &operator=(const CompiledIdentityAcl &other) = delete;
+
+  /// Evaluates whether `identities` satisfies the compiled ACL.
+  ///
+  /// SGX code identities are matched against SGX code-identity expectations
+  /// directly. Every other identity/expectation pair is passed to `matcher`.
+  ///
+  /// \param identities A list of identities to match against the ACL.
+  /// \param matcher The matcher to use for non-SGX identities and
+  ///                expectations.
+  /// \return A bool indicating whether the ACL evaluated to true, or a non-OK
+  ///         Status if any of the identities are invalid.
+  StatusOr<bool> Evaluate(const std::vector<EnclaveIdentity> &identities,
+                          const IdentityExpectationMatcher &matcher) const;
+
+ private:
+  // Fixed-layout form of an sgx::CodeIdentity.
+  struct SgxIdentityFields {
+    bool has_mrenclave;
+    std::string mrenclave;
+    bool has_mrsigner;
+    std::string mrsigner;
+    uint32_t isvprodid;
+    uint32_t isvsvn;
+    uint32_t miscselect;
+    uint64_t attributes_flags;
+    uint64_t attributes_xfrm;
+  };
+
+  // Fixed-layout form of an sgx::CodeIdentityExpectation.
+  struct SgxExpectationFields {
+    SgxIdentityFields reference;
+    bool mrenclave_match_required;
+    bool mrsigner_match_required;
+    uint32_t miscselect_match_mask;
+    uint64_t attributes_flags_match_mask;
+    uint64_t attributes_xfrm_match_mask;
+
+    // The original expectation, used when the peer identity is not an SGX
+    // identity.
+    EnclaveIdentityExpectation expectation;
+  };
+
+  // A single node of the flattened predicate tree. Nodes are stored in
+  // pre-order, so the children of a group node start immediately after it and
+  // each child's subtree ends where its next sibling starts.
+  struct Instruction {
+    enum Opcode : uint8_t {
+      OR,
+      AND,
+      NOT,
+      MATCH_SGX,
+      MATCH_GENERIC,
+    };
+
+    Opcode opcode;
+
+    // The index one past the last instruction in this node's subtree.
+    size_t end;
+
+    // For MATCH_SGX and MATCH_GENERIC, an index into sgx_expectations_ or
+    // generic_expectations_ respectively. Unused otherwise.
+    size_t operand;
+  };
+
+  // A peer identity prepared for evaluation.
+  struct PreparedIdentity {
+    const EnclaveIdentity *identity;
+    bool is_sgx;
+
+    // Set if |is_sgx| is true and |identity| was parsed successfully.
+    std::shared_ptr<const SgxIdentityFields> sgx;
+
+    // The parsing error if |is_sgx| is true and |sgx| is null.
+    Status sgx_status;
+  };
+
+  CompiledIdentityAcl() = default;
+
+  // Appends the instructions for |acl| to |program_|.
+  Status CompilePredicate(const IdentityAclPredicate &acl);
+
+  // Evaluates the subtree rooted at |program_[index]|.
+  StatusOr<bool> EvaluateInstruction(
+      size_t index, const std::vector<PreparedIdentity> &identities,
+      const IdentityExpectationMatcher &matcher) const;
+
+  // Evaluates the leaf instruction |instruction| against |identities|.
+  StatusOr<bool> EvaluateLeaf(const Instruction &instruction,
+                              const std::vector<PreparedIdentity> &identities,
+                              const IdentityExpectationMatcher &matcher) const;
+
+  // Returns the parsed form of the SGX identity |identity|, consulting and
+  // populating the cache.
+  StatusOr<std::shared_ptr<const SgxIdentityFields>> GetSgxIdentity(
+      const EnclaveIdentity &identity) const;
+
+  // Matches |identity| against |expectation| with the semantics of
+  // sgx::MatchIdentityToExpectation().
+  static StatusOr<bool> MatchSgx(const SgxIdentityFields &identity,
+                                 const SgxExpectationFields &expectation);
+
+  std::vector<Instruction> program_;
+  std::vector<SgxExpectationFields> sgx_expectations_;
+  std::vector<EnclaveIdentityExpectation> generic_expectations_;
+
+  // Cache of parsed SGX identities, keyed by EnclaveIdentity.identity().
+  mutable absl::Mutex cache_mu_;
+  mutable std::unordered_map<std::string,
+                             std::shared_ptr<const SgxIdentityFields>>
+      cache_ GUARDED_BY(cache_mu_);
+
+  // Keys of |cache_| in insertion order, used for FIFO eviction.
+  mutable std::deque<std::string> cache_order_ GUARDED_BY(cache_mu_);
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_IDENTITY_COMPILED_IDENTITY_ACL_H_
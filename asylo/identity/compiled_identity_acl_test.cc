@@ -0,0 +1,275 @@
+/*
+ *
+ * Copyright 2018 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/identity/compiled_identity_acl.h"
+
+#include <memory>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "asylo/identity/identity.pb.h"
+#include "asylo/identity/identity_acl.pb.h"
+#include "asylo/identity/identity_acl_evaluator.h"
+#include "asylo/identity/sgx/code_identity.pb.h"
+#include "asylo/identity/sgx/code_identity_constants.h"
+#include "asylo/identity/sgx/code_identity_test_util.h"
+#include "asylo/identity/sgx/sgx_code_identity_expectation_matcher.h"
+#include "asylo/test/util/status_matchers.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::Not;
+
+constexpr int kNumRandomIterations = 100;
+
+class CompiledIdentityAclTest : public ::testing::Test {
+ protected:
+  // Returns a predicate holding a random valid SGX expectation.
+  IdentityAclPredicate RandomExpectationPredicate() {
+    IdentityAclPredicate predicate;
+    sgx::CodeIdentityExpectation sgx_expectation;
+    EXPECT_THAT(sgx::SetRandomValidGenericExpectation(
+                    predicate.mutable_expectation(), &sgx_expectation),
+                IsOk());
+    return predicate;
+  }
+
+  // Returns a predicate holding a random invalid expectation whose reference
+  // identity is described as an SGX code identity, so that it is compiled as
+  // an SGX expectation rather than deferred to the matcher.
+  IdentityAclPredicate RandomInvalidSgxExpectationPredicate() {
+    IdentityAclPredicate predicate;
+    EnclaveIdentityDescription *description =
+        predicate.mutable_expectation()
+            ->mutable_reference_identity()
+            ->mutable_description();
+    do {
+      EXPECT_THAT(sgx::SetRandomInvalidGenericExpectation(
+                      predicate.mutable_expectation()),
+                  IsOk());
+    } while (description->identity_type() != CODE_IDENTITY ||
+             description->authority_type() != sgx::kSgxAuthorizationAuthority);
+    return predicate;
+  }
+
+  // Returns a group of |type| holding |predicates|.
+  IdentityAclPredicate Group(
+      IdentityAclGroup::GroupType type,
+      const std::vector<IdentityAclPredicate> &predicates) {
+    IdentityAclPredicate group;
+    group.mutable_acl_group()->set_type(type);
+    for (const IdentityAclPredicate &predicate : predicates) {
+      *group.mutable_acl_group()->add_predicates() = predicate;
+    }
+    return group;
+  }
+
+  // Checks that the compiled form of |acl| agrees with EvaluateIdentityAcl()
+  // on |identities|.
+  void ExpectSameResult(const IdentityAclPredicate &acl,
+                        const std::vector<EnclaveIdentity> &identities) {
+    auto compiled_result = CompiledIdentityAcl::Compile(acl);
+    ASSERT_THAT(compiled_result, IsOk());
+    std::unique_ptr<CompiledIdentityAcl> compiled =
+        std::move(compiled_result).ValueOrDie();
+
+    StatusOr<bool> expected = EvaluateIdentityAcl(identities, acl, matcher_);
+    // Evaluate twice so that the second evaluation hits the identity cache.
+    for (int i = 0; i < 2; ++i) {
+      StatusOr<bool> actual = compiled->Evaluate(identities, matcher_);
+      ASSERT_EQ(actual.ok(), expected.ok()) << acl.ShortDebugString();
+      if (expected.ok()) {
+        EXPECT_EQ(actual.ValueOrDie(), expected.ValueOrDie())
+            << acl.ShortDebugString();
+      }
+    }
+  }
+
+  SgxCodeIdentityExpectationMatcher matcher_;
+};
+
+TEST_F(CompiledIdentityAclTest, EmptyGroupFailsToCompile) {
+  IdentityAclPredicate acl;
+  acl.mutable_acl_group()->set_type(IdentityAclGroup::AND);
+  EXPECT_THAT(CompiledIdentityAcl::Compile(acl), Not(IsOk()));
+}
+
+TEST_F(CompiledIdentityAclTest, NotGroupWithTwoPredicatesFailsToCompile) {
+  IdentityAclPredicate acl =
+      Group(IdentityAclGroup::NOT,
+            {RandomExpectationPredicate(), RandomExpectationPredicate()});
+  EXPECT_THAT(CompiledIdentityAcl::Compile(acl), Not(IsOk()));
+}
+
+TEST_F(CompiledIdentityAclTest, UnsetPredicateFailsToCompile) {
+  IdentityAclPredicate acl =
+      Group(IdentityAclGroup::OR,
+            {RandomExpectationPredicate(), IdentityAclPredicate()});
+  EXPECT_THAT(CompiledIdentityAcl::Compile(acl), Not(IsOk()));
+}
+
+TEST_F(CompiledIdentityAclTest, InvalidSgxExpectationFailsToCompile) {
+  IdentityAclPredicate acl = RandomInvalidSgxExpectationPredicate();
+  EXPECT_THAT(CompiledIdentityAcl::Compile(acl), Not(IsOk()));
+}
+
+TEST_F(CompiledIdentityAclTest, ReferenceIdentityMatchesExpectation) {
+  IdentityAclPredicate acl = RandomExpectationPredicate();
+  auto compiled = CompiledIdentityAcl::Compile(acl);
+  ASSERT_THAT(compiled, IsOk());
+
+  StatusOr<bool> result = compiled.ValueOrDie()->Evaluate(
+      {acl.expectation().reference_identity()}, matcher_);
+  ASSERT_THAT(result, IsOk());
+  EXPECT_TRUE(result.ValueOrDie());
+}
+
+TEST_F(CompiledIdentityAclTest, InvalidIdentityFailsToEvaluate) {
+  IdentityAclPredicate acl = RandomExpectationPredicate();
+  auto compiled = CompiledIdentityAcl::Compile(acl);
+  ASSERT_THAT(compiled, IsOk());
+
+  EnclaveIdentity identity;
+  sgx::SetRandomInvalidGenericIdentity(&identity);
+  EXPECT_THAT(compiled.ValueOrDie()->Evaluate({identity}, matcher_),
+              Not(IsOk()));
+}
+
+// Tests that malformed SGX identities are rejected as by EvaluateIdentityAcl(),
+// including on a repeated evaluation that would hit the identity cache.
+TEST_F(CompiledIdentityAclTest, MalformedIdentitiesAreRejected) {
+  IdentityAclPredicate acl = RandomExpectationPredicate();
+  auto compiled_result = CompiledIdentityAcl::Compile(acl);
+  ASSERT_THAT(compiled_result, IsOk());
+  std::unique_ptr<CompiledIdentityAcl> compiled =
+      std::move(compiled_result).ValueOrDie();
+
+  for (int i = 0; i < kNumRandomIterations; ++i) {
+    EnclaveIdentity invalid_identity;
+    sgx::SetRandomInvalidGenericIdentity(&invalid_identity);
+
+    // An identity that parses but is missing a required field.
+    EnclaveIdentity incomplete_identity;
+    sgx::CodeIdentity code_identity;
+    sgx::SetRandomValidGenericIdentity(&incomplete_identity, &code_identity);
+    code_identity.clear_attributes();
+    ASSERT_TRUE(code_identity.SerializeToString(
+        incomplete_identity.mutable_identity()));
+
+    for (const EnclaveIdentity &identity :
+         {invalid_identity, incomplete_identity}) {
+      EXPECT_THAT(EvaluateIdentityAcl({identity}, acl, matcher_), Not(IsOk()));
+      for (int j = 0; j < 2; ++j) {
+        EXPECT_THAT(compiled->Evaluate({identity}, matcher_), Not(IsOk()));
+      }
+    }
+  }
+}
+
+// Tests that malformed SGX expectations are rejected at compile time, as they
+// would be by EvaluateIdentityAcl().
+TEST_F(CompiledIdentityAclTest, MalformedExpectationsAreRejected) {
+  for (int i = 0; i < kNumRandomIterations; ++i) {
+    IdentityAclPredicate valid = RandomExpectationPredicate();
+    const EnclaveIdentity &identity = valid.expectation().reference_identity();
+
+    IdentityAclPredicate invalid = RandomInvalidSgxExpectationPredicate();
+
+    // An expectation whose match spec requires an MRENCLAVE that the reference
+    // identity does not carry.
+    IdentityAclPredicate incompatible;
+    sgx::CodeIdentityExpectation sgx_expectation =
+        sgx::GetRandomValidExpectation();
+    sgx_expectation.mutable_reference_identity()->clear_mrenclave();
+    sgx_expectation.mutable_match_spec()->set_is_mrenclave_match_required(true);
+    ASSERT_TRUE(sgx_expectation.reference_identity().SerializeToString(
+        incompatible.mutable_expectation()
+            ->mutable_reference_identity()
+            ->mutable_identity()));
+    *incompatible.mutable_expectation()
+         ->mutable_reference_identity()
+         ->mutable_description() = identity.description();
+    ASSERT_TRUE(sgx_expectation.match_spec().SerializeToString(
+        incompatible.mutable_expectation()->mutable_match_spec()));
+
+    for (const IdentityAclPredicate &acl :
+         {invalid, incompatible,
+          Group(IdentityAclGroup::AND, {valid, incompatible})}) {
+      EXPECT_THAT(EvaluateIdentityAcl({identity}, acl, matcher_), Not(IsOk()));
+      EXPECT_THAT(CompiledIdentityAcl::Compile(acl), Not(IsOk()));
+    }
+  }
+}
+
+// Tests that random ACLs evaluate the same way as with EvaluateIdentityAcl().
+TEST_F(CompiledIdentityAclTest, AgreesWithEvaluateIdentityAcl) {
+  for (int i = 0; i < kNumRandomIterations; ++i) {
+    IdentityAclPredicate first = RandomExpectationPredicate();
+    IdentityAclPredicate second = RandomExpectationPredicate();
+    IdentityAclPredicate third = RandomExpectationPredicate();
+
+    std::vector<EnclaveIdentity> identities = {
+        first.expectation().reference_identity(),
+        third.expectation().reference_identity()};
+
+    ExpectSameResult(first, identities);
+    ExpectSameResult(Group(IdentityAclGroup::OR, {second, third}), identities);
+    ExpectSameResult(Group(IdentityAclGroup::AND, {first, second}),
+                     identities);
+    ExpectSameResult(Group(IdentityAclGroup::NOT, {second}), identities);
+    ExpectSameResult(
+        Group(IdentityAclGroup::AND,
+              {Group(IdentityAclGroup::OR, {first, second}),
+               Group(IdentityAclGroup::NOT,
+                     {Group(IdentityAclGroup::AND, {second, third})})}),
+        identities);
+  }
+}
+
+// Tests that evaluating more distinct identities than the cache holds does not
+// affect results.
+TEST_F(CompiledIdentityAclTest, CacheEviction) {
+  IdentityAclPredicate acl = RandomExpectationPredicate();
+  auto compiled_result = CompiledIdentityAcl::Compile(acl);
+  ASSERT_THAT(compiled_result, IsOk());
+  std::unique_ptr<CompiledIdentityAcl> compiled =
+      std::move(compiled_result).ValueOrDie();
+
+  for (size_t i = 0; i < 2 * CompiledIdentityAcl::kMaxCachedIdentities; ++i) {
+    EnclaveIdentity identity;
+    sgx::CodeIdentity code_identity;
+    sgx::SetRandomValidGenericIdentity(&identity, &code_identity);
+
+    StatusOr<bool> expected = EvaluateIdentityAcl({identity}, acl, matcher_);
+    StatusOr<bool> actual = compiled->Evaluate({identity}, matcher_);
+    ASSERT_EQ(actual.ok(), expected.ok());
+    if (expected.ok()) {
+      EXPECT_EQ(actual.ValueOrDie(), expected.ValueOrDie());
+    }
+  }
+
+  StatusOr<bool> result =
+      compiled->Evaluate({acl.expectation().reference_identity()}, matcher_);
+  ASSERT_THAT(result, IsOk());
+  EXPECT_TRUE(result.ValueOrDie());
+}
+
+}  // namespace
+}  // namespace asylo
@@ -0,0 +1,143 @@
+/*
+ *
+ * Copyright 2018 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/identity/sgx/hardware_report_verifier.h"
+
+#include <openssl/cipher.h>
+#include <openssl/cmac.h>
+#include <cstddef>
+
+#include "absl/strings/str_cat.h"
+#include "asylo/crypto/util/bssl_util.h"
+#include "asylo/identity/sgx/code_identity_util.h"
+#include "asylo/util/status_macros.h"
+
+namespace asylo {
+namespace sgx {
+
+constexpr size_t HardwareReportVerifier::kMaxCachedKeys;
+
+Status HardwareReportVerifier::Verify(const Report &report) const {
+  std::shared_ptr<const HardwareKey> report_key;
+  ASYLO_ASSIGN_OR_RETURN(report_key, GetCachedReportKey(report.keyid));
+  return VerifyHardwareReportWithKey(report, *report_key);
+}
+
+std::vector<Status> HardwareReportVerifier::VerifyBatch(
+    absl::Span<const Report> reports) const {
+  std::vector<Status> results(reports.size());
+
+  bssl::UniquePtr<CMAC_CTX> cmac(CMAC_CTX_new());
+  if (!cmac) {
+    Status status(
+        error::GoogleError::INTERNAL,
+        absl::StrCat("CMAC context allocation failed: ", BsslLastErrorString()));
+    for (Status &result : results) {
+      result = status;
+    }
+    return results;
+  }
+
+  // The key that |cmac| is currently initialized with. Holding a reference
+  // keeps the key alive even if it is evicted from the cache, so its address
+  // cannot be reused by another key.
+  std::shared_ptr<const HardwareKey> cmac_key;
+
+  for (size_t i = 0; i < reports.size(); ++i) {
+    const Report &report = reports[i];
+
+    StatusOr<std::shared_ptr<const HardwareKey>> key_result =
+        GetCachedReportKey(report.keyid);
+    if (!key_result.ok()) {
+      results[i] = key_result.status();
+      continue;
+    }
+    std::shared_ptr<const HardwareKey> report_key =
+        std::move(key_result).ValueOrDie();
+
+    // Expanding the CMAC key schedule is only necessary when the KEYID changes.
+    // Otherwise, resetting the context reuses the expanded key.
+    int init_result;
+    if (cmac_key == report_key) {
+      init_result = CMAC_Reset(cmac.get());
+    } else {
+      init_result = CMAC_Init(cmac.get(), report_key->data(),
+                              report_key->size(), EVP_aes_128_cbc(),
+                              /*engine=*/nullptr);
+      cmac_key = init_result == 1 ? report_key : nullptr;
+    }
+
+    // The last two fields (KEYID and MAC) from the REPORT struct are not
+    // included in the MAC computation.
+    SafeBytes<sizeof(report.mac)> actual_mac;
+    size_t actual_mac_size = actual_mac.size();
+    if (init_result != 1 ||
+        CMAC_Update(cmac.get(), reinterpret_cast<const uint8_t *>(&report),
+                    offsetof(Report, keyid)) != 1 ||
+        CMAC_Final(cmac.get(), actual_mac.data(), &actual_mac_size) != 1 ||
+        actual_mac_size != actual_mac.size()) {
+      results[i] = Status(
+          error::GoogleError::INTERNAL,
+          absl::StrCat("CMAC computation failed: ", BsslLastErrorString()));
+      cmac_key.reset();
+      continue;
+    }
+
+    // Inequality operator on a SafeBytes object performs a constant-time
+    // comparison, which is required for MAC verification.
+    if (actual_mac != report.mac) {
+      results[i] =
+          Status(error::GoogleError::INTERNAL, "MAC verification failed");
+    }
+  }
+
+  return results;
+}
+
+StatusOr<std::shared_ptr<const HardwareKey>>
+HardwareReportVerifier::GetCachedReportKey(
+    const UnsafeBytes<kReportKeyidSize> &keyid) const {
+  {
+    absl::MutexLock lock(&keys_mu_);
+    for (const auto &entry : keys_) {
+      if (entry.first == keyid) {
+        return entry.second;
+      }
+    }
+  }
+
+  // Derive the key outside of the lock, since EGETKEY is comparatively slow.
+  AlignedHardwareKeyPtr report_key;
+  ASYLO_RETURN_IF_ERROR(GetReportKey(keyid, report_key.get()));
+  auto key = std::make_shared<const HardwareKey>(*report_key);
+
+  absl::MutexLock lock(&keys_mu_);
+  for (const auto &entry : keys_) {
+    if (entry.first == keyid) {
+      return entry.second;
+    }
+  }
+  if (keys_.size() == kMaxCachedKeys) {
+    keys_.erase(keys_.begin());
+  }
+  keys_.emplace_back(keyid, key);
+  return key;
+}
+
+}  // namespace sgx
+}  // namespace asylo
@@ -0,0 +1,85 @@
+/*
+ *
+ * Copyright 2018 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_IDENTITY_SGX_HARDWARE_REPORT_VERIFIER_H_
+#define ASYLO_IDENTITY_SGX_HARDWARE_REPORT_VERIFIER_H_
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "asylo/crypto/util/bytes.h"
+#include "asylo/identity/sgx/hardware_interface.h"
+#include "asylo/identity/sgx/identity_key_management_structs.h"
+#include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+namespace sgx {
+
+// HardwareReportVerifier verifies hardware REPORTs targeted at the current
+// enclave, as VerifyHardwareReport() does, but retains the REPORT key derived
+// for each KEYID it encounters. The KEYID of a REPORT is fixed by the platform
+// for the lifetime of a boot, so after the first verification subsequent
+// REPORTs are verified without issuing EGETKEY.
+//
+// Cached keys belong to the enclave that derived them, so an instance must only
+// be used from within a single enclave.
+//
+// This class is thread-safe.
+class HardwareReportVerifier {
+ public:
+  // The maximum number of REPORT keys retained by a verifier.
+  static constexpr size_t kMaxCachedKeys = 4;
+
+  HardwareReportVerifier() = default;
+
+  HardwareReportVerifier(const HardwareReportVerifier &other) = delete;
+  HardwareReportVerifier &operator=(const HardwareReportVerifier &other) =
+      delete;
+
+  // Verifies the hardware report |report|.
+  Status Verify(const Report &report) const;
+
+  // Verifies each of |reports| and returns a vector holding the outcome of each
+  // verification, in the same order as |reports|. All REPORTs that share a
+  // KEYID are verified with a single key derivation and a single CMAC key
+  // schedule.
+  std::vector<Status> VerifyBatch(absl::Span<const Report> reports) const;
+
+ private:
+  // Returns the REPORT key for |keyid|, deriving and caching it if necessary.
+  StatusOr<std::shared_ptr<const HardwareKey>> GetCachedReportKey(
+      const UnsafeBytes<kReportKeyidSize> &keyid) const;
+
+  // Cached REPORT keys, in order of insertion.
+  mutable std::vector<std::pair<UnsafeBytes<kReportKeyidSize>,
+                                std::shared_ptr<const HardwareKey>>>
+      keys_ GUARDED_BY(keys_mu_);
+
+  // A mutex that guards the keys_ member.
+  mutable absl::Mutex keys_mu_;
+};
+
+}  // namespace sgx
+}  // namespace asylo
+
+#endif  // ASYLO_IDENTITY_SGX_HARDWARE_REPORT_VERIFIER_H_
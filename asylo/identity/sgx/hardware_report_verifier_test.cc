@@ -0,0 +1,116 @@
+/*
+ *
+ * Copyright 2018 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/identity/sgx/hardware_report_verifier.h"
+
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "asylo/crypto/util/trivial_object_util.h"
+#include "asylo/identity/sgx/code_identity_util.h"
+#include "asylo/identity/sgx/hardware_interface.h"
+#include "asylo/identity/sgx/identity_key_management_structs.h"
+#include "asylo/test/util/status_matchers.h"
+
+namespace asylo {
+namespace sgx {
+namespace {
+
+using ::testing::Not;
+
+constexpr int kNumReports = 16;
+
+// Returns a REPORT with random REPORTDATA. The REPORT is targeted at the
+// current enclave if |target_self| is true, and at an all-zero TARGETINFO
+// otherwise.
+Report GenerateReport(bool target_self) {
+  AlignedTargetinfoPtr targetinfo;
+  if (target_self) {
+    SetTargetinfoFromSelfIdentity(targetinfo.get());
+  } else {
+    *targetinfo = TrivialZeroObject<Targetinfo>();
+  }
+
+  AlignedReportdataPtr reportdata;
+  reportdata->data = TrivialRandomObject<UnsafeBytes<kReportdataSize>>();
+
+  AlignedReportPtr report;
+  EXPECT_THAT(GetHardwareReport(*targetinfo, *reportdata, report.get()),
+              IsOk());
+  return *report;
+}
+
+// Verify that Verify() accepts REPORTs targeted at the verifying enclave, both
+// when the REPORT key is derived and when it is served from the cache.
+TEST(HardwareReportVerifierTest, VerifySucceedsWhenTargetIsSelf) {
+  HardwareReportVerifier verifier;
+  for (int i = 0; i < kNumReports; ++i) {
+    ASYLO_EXPECT_OK(verifier.Verify(GenerateReport(/*target_self=*/true)));
+  }
+}
+
+// Verify that Verify() rejects REPORTs not targeted at the verifying enclave.
+TEST(HardwareReportVerifierTest, VerifyFailsWhenTargetIsNotSelf) {
+  HardwareReportVerifier verifier;
+  ASYLO_ASSERT_OK(verifier.Verify(GenerateReport(/*target_self=*/true)));
+  EXPECT_THAT(verifier.Verify(GenerateReport(/*target_self=*/false)),
+              Not(IsOk()));
+}
+
+// Verify that Verify() rejects a REPORT whose contents were modified after it
+// was generated.
+TEST(HardwareReportVerifierTest, VerifyFailsWhenReportIsModified) {
+  HardwareReportVerifier verifier;
+  Report report = GenerateReport(/*target_self=*/true);
+  ASYLO_ASSERT_OK(verifier.Verify(report));
+
+  report.isvsvn ^= 1;
+  EXPECT_THAT(verifier.Verify(report), Not(IsOk()));
+}
+
+// Verify that VerifyBatch() returns the same per-REPORT results as
+// VerifyHardwareReport().
+TEST(HardwareReportVerifierTest, VerifyBatchMatchesVerifyHardwareReport) {
+  std::vector<Report> reports;
+  for (int i = 0; i < kNumReports; ++i) {
+    reports.push_back(GenerateReport(/*target_self=*/i % 3 != 0));
+  }
+  reports[1].reportdata.data[0] ^= 1;
+
+  HardwareReportVerifier verifier;
+  std::vector<Status> results = verifier.VerifyBatch(reports);
+  ASSERT_EQ(results.size(), reports.size());
+  for (int i = 0; i < kNumReports; ++i) {
+    EXPECT_EQ(results[i].ok(), VerifyHardwareReport(reports[i]).ok())
+        << "REPORT " << i;
+  }
+  EXPECT_THAT(results[0], Not(IsOk()));
+  EXPECT_THAT(results[1], Not(IsOk()));
+  ASYLO_EXPECT_OK(results[2]);
+}
+
+// Verify that VerifyBatch() handles an empty batch.
+TEST(HardwareReportVerifierTest, VerifyBatchEmpty) {
+  HardwareReportVerifier verifier;
+  EXPECT_TRUE(verifier.VerifyBatch({}).empty());
+}
+
+}  // namespace
+}  // namespace sgx
+}  // namespace asylo
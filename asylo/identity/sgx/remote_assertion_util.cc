@@ -18,7 +18,24 @@
 
 #include "asylo/identity/sgx/remote_assertion_util.h"
 
+#include <openssl/bio.h>
+#include <openssl/ec_key.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
 #include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "asylo/crypto/ecdsa_p256_sha256_signing_key.h"
+#include "asylo/crypto/sha256_hash.h"
+#include "asylo/crypto/util/bssl_util.h"
 #include "asylo/util/status_macros.h"
 
 namespace asylo {
@@ -27,6 +44,250 @@ namespace {
 
 constexpr char kRemoteAssertionVersion[] = "Asylo SGX Remote Assertion v1";
 
+// The maximum number of validated certificate chains remembered by
+// VerifyRemoteAssertion().
+constexpr size_t kMaxCachedCertificateChains = 64;
+
+// A certificate chain whose signatures have been verified, from its end-entity
+// certificate up to its self-signed root certificate.
+struct ValidatedCertificateChain {
+  // The DER encoding of the root certificate of the chain.
+  std::string root_certificate_der;
+
+  // The DER encoding of the public key in the end-entity certificate.
+  std::string end_entity_key_der;
+
+  // The public key in the end-entity certificate.
+  std::unique_ptr<const EcdsaP256Sha256VerifyingKey> end_entity_key;
+};
+
+// A bounded cache of validated certificate chains, keyed by a hash of the
+// chain. When the cache is full, the oldest entry is evicted.
+//
+// This class is thread-safe.
+class CertificateChainCache {
+ public:
+  CertificateChainCache() = default;
+
+  CertificateChainCache(const CertificateChainCache &other) = delete;
+  CertificateChainCache &operator=(const CertificateChainCache &other) =
+      delete;
+
+  // Returns the chain cached under |chain_hash|, or null if there is none.
+  std::shared_ptr<const ValidatedCertificateChain> Lookup(
+      const std::string &chain_hash) {
+    absl::MutexLock lock(&mu_);
+    auto it = chains_.find(chain_hash);
+    return it == chains_.end() ? nullptr : it->second;
+  }
+
+  // Caches |chain| under |chain_hash|.
+  void Insert(const std::string &chain_hash,
+              std::shared_ptr<const ValidatedCertificateChain> chain) {
+    absl::MutexLock lock(&mu_);
+    if (!chains_.emplace(chain_hash, std::move(chain)).second) {
+      return;
+    }
+    insertion_order_.push_back(chain_hash);
+    while (chains_.size() > kMaxCachedCertificateChains) {
+      chains_.erase(insertion_order_.front());
+      insertion_order_.pop_front();
+    }
+  }
+
+ private:
+  absl::Mutex mu_;
+  std::unordered_map<std::string,
+                     std::shared_ptr<const ValidatedCertificateChain>>
+      chains_ GUARDED_BY(mu_);
+
+  // Keys of |chains_| in insertion order, used for FIFO eviction.
+  std::deque<std::string> insertion_order_ GUARDED_BY(mu_);
+};
+
+CertificateChainCache *GetCertificateChainCache() {
+  static CertificateChainCache *cache = new CertificateChainCache();
+  return cache;
+}
+
+// Returns a hash that identifies |chain|, covering the format and contents of
+// every certificate in it.
+StatusOr<std::string> HashCertificateChain(const CertificateChain &chain) {
+  Sha256Hash hasher;
+  hasher.Init();
+  for (const Certificate &certificate : chain.certificates()) {
+    uint64_t header[] = {static_cast<uint64_t>(certificate.format()),
+                         certificate.data().size()};
+    hasher.Update(ByteContainerView(header, sizeof(header)));
+    hasher.Update(certificate.data());
+  }
+  std::vector<uint8_t> digest;
+  ASYLO_RETURN_IF_ERROR(hasher.CumulativeHash(&digest));
+  return std::string(digest.begin(), digest.end());
+}
+
+// Parses |certificate| into an X509 object.
+StatusOr<bssl::UniquePtr<X509>> ParseCertificate(
+    const Certificate &certificate) {
+  bssl::UniquePtr<X509> x509;
+  switch (certificate.format()) {
+    case Certificate::X509_DER: {
+      const uint8_t *data =
+          reinterpret_cast<const uint8_t *>(certificate.data().data());
+      x509.reset(d2i_X509(/*out=*/nullptr, &data, certificate.data().size()));
+      break;
+    }
+    case Certificate::X509_PEM: {
+      bssl::UniquePtr<BIO> bio(BIO_new_mem_buf(certificate.data().data(),
+                                               certificate.data().size()));
+      if (!bio) {
+        return Status(error::GoogleError::INTERNAL, BsslLastErrorString());
+      }
+      x509.reset(PEM_read_bio_X509(bio.get(), /*x=*/nullptr,
+                                   /*cb=*/nullptr, /*u=*/nullptr));
+      break;
+    }
+    default:
+      return Status(error::GoogleError::INVALID_ARGUMENT,
+                    absl::StrCat("Unsupported certificate format: ",
+                                 Certificate::CertificateFormat_Name(
+                                     certificate.format())));
+  }
+  if (!x509) {
+    return Status(
+        error::GoogleError::INVALID_ARGUMENT,
+        absl::StrCat("Failed to parse certificate: ", BsslLastErrorString()));
+  }
+  return std::move(x509);
+}
+
+// Returns the DER encoding of |x509|.
+StatusOr<std::string> SerializeCertificateToDer(X509 *x509) {
+  uint8_t *der = nullptr;
+  int length = i2d_X509(x509, &der);
+  if (length <= 0) {
+    return Status(error::GoogleError::INTERNAL, BsslLastErrorString());
+  }
+  bssl::UniquePtr<uint8_t> deleter(der);
+  return std::string(reinterpret_cast<char *>(der), length);
+}
+
+// Returns the DER encoding of |certificate|, parsing it only if it is not
+// already DER-encoded.
+StatusOr<std::string> GetCertificateDer(const Certificate &certificate) {
+  if (certificate.format() == Certificate::X509_DER) {
+    return certificate.data();
+  }
+  bssl::UniquePtr<X509> x509;
+  ASYLO_ASSIGN_OR_RETURN(x509, ParseCertificate(certificate));
+  return SerializeCertificateToDer(x509.get());
+}
+
+// Returns OK if |certificate| is self-issued and self-signed.
+Status VerifySelfSigned(X509 *certificate) {
+  if (X509_check_issued(certificate, certificate) != X509_V_OK) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Last certificate in the chain is not self-issued");
+  }
+  bssl::UniquePtr<EVP_PKEY> key(X509_get_pubkey(certificate));
+  if (!key || X509_verify(certificate, key.get()) != 1) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  absl::StrCat("Certificate signature verification failed: ",
+                               BsslLastErrorString()));
+  }
+  return Status::OkStatus();
+}
+
+// Verifies |chain| from its end-entity certificate up to its last certificate,
+// which must be self-signed and is the only one trusted while verifying. Each
+// certificate must be issued by the next one in the chain, every issuer must be
+// a CA whose path length constraint admits the certificates below it, and the
+// end-entity certificate must hold an ECDSA-P256 key.
+//
+// Validity periods are not checked, since enclaves have no trusted source of
+// time.
+StatusOr<std::shared_ptr<const ValidatedCertificateChain>>
+ValidateCertificateChain(const CertificateChain &chain) {
+  if (chain.certificates_size() == 0) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Certificate chain is empty");
+  }
+
+  std::vector<bssl::UniquePtr<X509>> certificates;
+  for (const Certificate &certificate : chain.certificates()) {
+    bssl::UniquePtr<X509> x509;
+    ASYLO_ASSIGN_OR_RETURN(x509, ParseCertificate(certificate));
+    certificates.push_back(std::move(x509));
+  }
+  X509 *root = certificates.back().get();
+  ASYLO_RETURN_IF_ERROR(VerifySelfSigned(root));
+
+  bssl::UniquePtr<X509_STORE> store(X509_STORE_new());
+  bssl::UniquePtr<STACK_OF(X509)> intermediates(sk_X509_new_null());
+  bssl::UniquePtr<X509_STORE_CTX> context(X509_STORE_CTX_new());
+  if (!store || !intermediates || !context ||
+      !X509_STORE_add_cert(store.get(), root)) {
+    return Status(error::GoogleError::INTERNAL, BsslLastErrorString());
+  }
+  for (size_t i = 1; i + 1 < certificates.size(); ++i) {
+    if (!sk_X509_push(intermediates.get(), certificates[i].get())) {
+      return Status(error::GoogleError::INTERNAL, BsslLastErrorString());
+    }
+    X509_up_ref(certificates[i].get());
+  }
+  if (!X509_STORE_CTX_init(context.get(), store.get(),
+                           certificates.front().get(), intermediates.get())) {
+    return Status(error::GoogleError::INTERNAL, BsslLastErrorString());
+  }
+  X509_VERIFY_PARAM_set_flags(X509_STORE_CTX_get0_param(context.get()),
+                              X509_V_FLAG_NO_CHECK_TIME);
+  if (X509_verify_cert(context.get()) != 1) {
+    return Status(
+        error::GoogleError::INVALID_ARGUMENT,
+        absl::StrCat("Certificate chain verification failed: ",
+                     X509_verify_cert_error_string(
+                         X509_STORE_CTX_get_error(context.get()))));
+  }
+
+  bssl::UniquePtr<EVP_PKEY> end_entity_key(
+      X509_get_pubkey(certificates.front().get()));
+  bssl::UniquePtr<EC_KEY> ec_key(
+      end_entity_key ? EVP_PKEY_get1_EC_KEY(end_entity_key.get()) : nullptr);
+  if (!ec_key) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "End-entity certificate does not hold an EC key");
+  }
+
+  auto validated_chain = std::make_shared<ValidatedCertificateChain>();
+  ASYLO_ASSIGN_OR_RETURN(validated_chain->root_certificate_der,
+                         SerializeCertificateToDer(root));
+  ASYLO_ASSIGN_OR_RETURN(
+      validated_chain->end_entity_key,
+      EcdsaP256Sha256VerifyingKey::Create(std::move(ec_key)));
+  ASYLO_ASSIGN_OR_RETURN(validated_chain->end_entity_key_der,
+                         validated_chain->end_entity_key->SerializeToDer());
+  return std::shared_ptr<const ValidatedCertificateChain>(
+      std::move(validated_chain));
+}
+
+// Returns the validated form of |chain|, validating and caching it if it is
+// not already cached.
+StatusOr<std::shared_ptr<const ValidatedCertificateChain>>
+GetValidatedCertificateChain(const CertificateChain &chain) {
+  std::string chain_hash;
+  ASYLO_ASSIGN_OR_RETURN(chain_hash, HashCertificateChain(chain));
+  CertificateChainCache *cache = GetCertificateChainCache();
+  std::shared_ptr<const ValidatedCertificateChain> validated_chain =
+      cache->Lookup(chain_hash);
+  if (validated_chain) {
+    return validated_chain;
+  }
+
+  ASYLO_ASSIGN_OR_RETURN(validated_chain, ValidateCertificateChain(chain));
+  cache->Insert(chain_hash, validated_chain);
+  return validated_chain;
+}
+
 }  // namespace
 
 Status MakeRemoteAssertion(const std::string &user_data,
@@ -63,7 +324,79 @@ Status VerifyRemoteAssertion(const std::string &user_data,
                              const std::vector<Certificate> &root_certificates,
                              const RemoteAssertion &assertion,
                              CodeIdentity *identity) {
-  return Status(error::GoogleError::UNIMPLEMENTED, "Not implemented");
+  if (assertion.signature_scheme() != verifying_key.GetSignatureScheme()) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Assertion signature scheme does not match verifying key");
+  }
+
+  // Find a validated chain from |verifying_key| to each root certificate.
+  // Chains are validated at most once while they remain cached, so the
+  // signature over the payload is usually the only signature verified here.
+  std::vector<std::shared_ptr<const ValidatedCertificateChain>> chains;
+  std::vector<Status> chain_statuses;
+  std::string verifying_key_der;
+  if (!root_certificates.empty()) {
+    for (const CertificateChain &chain : assertion.certificate_chains()) {
+      auto chain_result = GetValidatedCertificateChain(chain);
+      if (chain_result.ok()) {
+        chains.push_back(std::move(chain_result).ValueOrDie());
+      } else {
+        chain_statuses.push_back(chain_result.status());
+      }
+    }
+    ASYLO_ASSIGN_OR_RETURN(verifying_key_der, verifying_key.SerializeToDer());
+  }
+
+  // The key that the payload signature is verified with. Once a chain vouches
+  // for |verifying_key|, the key decoded and cached with that chain is used.
+  const VerifyingKey *signature_key = &verifying_key;
+  for (const Certificate &root_certificate : root_certificates) {
+    std::string root_der;
+    ASYLO_ASSIGN_OR_RETURN(root_der, GetCertificateDer(root_certificate));
+    bool found = false;
+    for (const auto &chain : chains) {
+      if (chain->root_certificate_der == root_der &&
+          chain->end_entity_key_der == verifying_key_der) {
+        signature_key = chain->end_entity_key.get();
+        found = true;
+        break;
+      }
+    }
+    if (!found) {
+      std::string message =
+          "Assertion has no valid certificate chain for the verifying key to "
+          "a required root certificate";
+      for (const Status &status : chain_statuses) {
+        absl::StrAppend(&message, "; ", status.error_message());
+      }
+      return Status(error::GoogleError::UNAUTHENTICATED, message);
+    }
+  }
+
+  ASYLO_RETURN_IF_ERROR(
+      signature_key->Verify(assertion.payload(), assertion.signature()));
+
+  RemoteAssertionPayload payload;
+  if (!payload.ParseFromString(assertion.payload())) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Failed to parse assertion payload");
+  }
+  if (payload.version() != kRemoteAssertionVersion) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  absl::StrCat("Unsupported assertion version: ",
+                               payload.version()));
+  }
+  if (payload.signature_scheme() != assertion.signature_scheme()) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Payload signature scheme does not match assertion");
+  }
+  if (payload.user_data() != user_data) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Assertion is not bound to the provided user data");
+  }
+
+  *identity = payload.identity();
+  return Status::OkStatus();
 }
 
 }  // namespace sgx
@@ -47,6 +47,15 @@ Status MakeRemoteAssertion(const std::string &user_data,
 //   * |assertion| provides a certificate chain for |verifying_key| for each
 //   root certificate in |root_certificates|.
 //
+// Each certificate in a chain must be issued and signed by the next one, and
+// the last certificate must be self-signed. Certificate validity periods are
+// not checked.
+//
+// Certificate chains that pass validation are kept in a bounded process-wide
+// cache keyed by a hash of the chain, together with the end-entity key decoded
+// from them. Repeated assertions that present the same chains therefore only
+// cost the verification of the signature over the payload.
+//
 // On success, extracts the peer's verified CodeIdentity to |identity|.
 Status VerifyRemoteAssertion(const std::string &user_data,
                              const VerifyingKey &verifying_key,
@@ -18,7 +18,17 @@
 
 #include "asylo/identity/sgx/remote_assertion_util.h"
 
+#include <openssl/base.h>
+#include <openssl/bio.h>
+#include <openssl/ec_key.h>
+#include <openssl/evp.h>
+#include <openssl/nid.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+
 #include <memory>
+#include <string>
 #include <vector>
 
 #include <gmock/gmock.h>
@@ -30,11 +40,14 @@
 #include "asylo/identity/sgx/remote_assertion.pb.h"
 #include "asylo/test/util/proto_matchers.h"
 #include "asylo/test/util/status_matchers.h"
+#include "asylo/util/logging.h"
 
 namespace asylo {
 namespace sgx {
 namespace {
 
+using ::testing::Not;
+
 constexpr char kUserData[] = "User Data";
 constexpr char kCertificate[] = "Certificate";
 
@@ -77,6 +90,255 @@ TEST(RemoteAssertionUtilTest, MakeRemoteAssertionSucceeds) {
               IsOk());
 }
 
+// Returns a new random ECDSA-P256 key.
+bssl::UniquePtr<EC_KEY> CreateEcKey() {
+  bssl::UniquePtr<EC_KEY> key(EC_KEY_new_by_curve_name(NID_X9_62_prime256v1));
+  CHECK(key && EC_KEY_generate_key(key.get()));
+  return key;
+}
+
+// Returns an EVP_PKEY holding a reference to |key|.
+bssl::UniquePtr<EVP_PKEY> ToEvpKey(EC_KEY *key) {
+  bssl::UniquePtr<EVP_PKEY> evp_key(EVP_PKEY_new());
+  CHECK(evp_key && EVP_PKEY_set1_EC_KEY(evp_key.get(), key));
+  return evp_key;
+}
+
+// Returns a DER-encoded X.509 certificate for |subject_key| with the common
+// name |subject|, issued by |issuer| and signed with |issuer_key|. If |is_ca|
+// is true, the certificate is marked as a CA certificate, with a path length
+// constraint of |max_path_length| if it is not negative.
+Certificate CreateCertificate(const std::string &subject, EC_KEY *subject_key,
+                              const std::string &issuer, EC_KEY *issuer_key,
+                              bool is_ca = false, int max_path_length = -1) {
+  bssl::UniquePtr<X509> x509(X509_new());
+  CHECK(x509);
+  CHECK(X509_set_version(x509.get(), 2));
+  CHECK(ASN1_INTEGER_set(X509_get_serialNumber(x509.get()), 1));
+  CHECK(X509_gmtime_adj(X509_getm_notBefore(x509.get()), 0));
+  CHECK(X509_gmtime_adj(X509_getm_notAfter(x509.get()), 24 * 60 * 60));
+  CHECK(X509_NAME_add_entry_by_txt(
+      X509_get_subject_name(x509.get()), "CN", MBSTRING_ASC,
+      reinterpret_cast<const uint8_t *>(subject.c_str()), -1, -1, 0));
+  CHECK(X509_NAME_add_entry_by_txt(
+      X509_get_issuer_name(x509.get()), "CN", MBSTRING_ASC,
+      reinterpret_cast<const uint8_t *>(issuer.c_str()), -1, -1, 0));
+  CHECK(X509_set_pubkey(x509.get(), ToEvpKey(subject_key).get()));
+  if (is_ca) {
+    bssl::UniquePtr<BASIC_CONSTRAINTS> constraints(BASIC_CONSTRAINTS_new());
+    CHECK(constraints);
+    constraints->ca = 0xff;
+    if (max_path_length >= 0) {
+      constraints->pathlen = ASN1_INTEGER_new();
+      CHECK(constraints->pathlen &&
+            ASN1_INTEGER_set(constraints->pathlen, max_path_length));
+    }
+    CHECK(X509_add1_ext_i2d(x509.get(), NID_basic_constraints,
+                            constraints.get(), /*crit=*/1, /*flags=*/0));
+  }
+  CHECK(X509_sign(x509.get(), ToEvpKey(issuer_key).get(), EVP_sha256()));
+
+  uint8_t *der = nullptr;
+  int length = i2d_X509(x509.get(), &der);
+  CHECK_GT(length, 0);
+  bssl::UniquePtr<uint8_t> deleter(der);
+
+  Certificate certificate;
+  certificate.set_format(Certificate::X509_DER);
+  certificate.set_data(reinterpret_cast<const char *>(der), length);
+  return certificate;
+}
+
+// Returns |certificate|, which must be DER-encoded, in PEM format.
+Certificate ConvertToPem(const Certificate &certificate) {
+  const uint8_t *data =
+      reinterpret_cast<const uint8_t *>(certificate.data().data());
+  bssl::UniquePtr<X509> x509(
+      d2i_X509(/*out=*/nullptr, &data, certificate.data().size()));
+  bssl::UniquePtr<BIO> bio(BIO_new(BIO_s_mem()));
+  CHECK(x509 && bio && PEM_write_bio_X509(bio.get(), x509.get()));
+  const uint8_t *contents;
+  size_t length;
+  CHECK(BIO_mem_contents(bio.get(), &contents, &length));
+
+  Certificate pem;
+  pem.set_format(Certificate::X509_PEM);
+  pem.set_data(reinterpret_cast<const char *>(contents), length);
+  return pem;
+}
+
+class VerifyRemoteAssertionTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    root_key_ = CreateEcKey();
+    intermediate_key_ = CreateEcKey();
+    bssl::UniquePtr<EC_KEY> attestation_key = CreateEcKey();
+
+    root_certificate_ = CreateCertificate("Root", root_key_.get(), "Root",
+                                          root_key_.get(), /*is_ca=*/true);
+    CertificateChain chain;
+    *chain.add_certificates() =
+        CreateCertificate("Attestation", attestation_key.get(), "Intermediate",
+                          intermediate_key_.get());
+    *chain.add_certificates() =
+        CreateCertificate("Intermediate", intermediate_key_.get(), "Root",
+                          root_key_.get(), /*is_ca=*/true);
+    *chain.add_certificates() = root_certificate_;
+    certificate_chains_.push_back(chain);
+
+    auto signing_key_result =
+        EcdsaP256Sha256SigningKey::Create(std::move(attestation_key));
+    ASSERT_THAT(signing_key_result, IsOk());
+    signing_key_ = std::move(signing_key_result).ValueOrDie();
+    auto verifying_key_result = signing_key_->GetVerifyingKey();
+    ASSERT_THAT(verifying_key_result, IsOk());
+    verifying_key_ = std::move(verifying_key_result).ValueOrDie();
+
+    SetSelfCodeIdentity(&identity_);
+  }
+
+  // Returns an assertion over |identity_| signed by |signing_key_| that
+  // carries |certificate_chains_|.
+  RemoteAssertion MakeAssertion() {
+    RemoteAssertion assertion;
+    CHECK(MakeRemoteAssertion(kUserData, identity_, *signing_key_,
+                              certificate_chains_, &assertion)
+              .ok());
+    return assertion;
+  }
+
+  bssl::UniquePtr<EC_KEY> root_key_;
+  bssl::UniquePtr<EC_KEY> intermediate_key_;
+  Certificate root_certificate_;
+  std::vector<CertificateChain> certificate_chains_;
+  std::unique_ptr<SigningKey> signing_key_;
+  std::unique_ptr<VerifyingKey> verifying_key_;
+  CodeIdentity identity_;
+};
+
+TEST_F(VerifyRemoteAssertionTest, Succeeds) {
+  RemoteAssertion assertion = MakeAssertion();
+
+  // The second verification uses the cached certificate chain.
+  for (int i = 0; i < 2; ++i) {
+    CodeIdentity identity;
+    ASSERT_THAT(VerifyRemoteAssertion(kUserData, *verifying_key_,
+                                      {root_certificate_}, assertion,
+                                      &identity),
+                IsOk());
+    EXPECT_THAT(identity, EqualsProto(identity_));
+  }
+}
+
+TEST_F(VerifyRemoteAssertionTest, SucceedsWithPemRootCertificate) {
+  CodeIdentity identity;
+  EXPECT_THAT(VerifyRemoteAssertion(kUserData, *verifying_key_,
+                                    {ConvertToPem(root_certificate_)},
+                                    MakeAssertion(), &identity),
+              IsOk());
+}
+
+TEST_F(VerifyRemoteAssertionTest, FailsWithWrongUserData) {
+  CodeIdentity identity;
+  EXPECT_THAT(VerifyRemoteAssertion("Other User Data", *verifying_key_,
+                                    {root_certificate_}, MakeAssertion(),
+                                    &identity),
+              Not(IsOk()));
+}
+
+TEST_F(VerifyRemoteAssertionTest, FailsWithTamperedPayload) {
+  RemoteAssertion assertion = MakeAssertion();
+  RemoteAssertionPayload payload;
+  ASSERT_TRUE(payload.ParseFromString(assertion.payload()));
+  payload.mutable_identity()->mutable_mrenclave()->set_hash("Other Hash");
+  ASSERT_TRUE(payload.SerializeToString(assertion.mutable_payload()));
+
+  CodeIdentity identity;
+  EXPECT_THAT(VerifyRemoteAssertion(kUserData, *verifying_key_,
+                                    {root_certificate_}, assertion, &identity),
+              Not(IsOk()));
+}
+
+TEST_F(VerifyRemoteAssertionTest, FailsWithUntrustedRootCertificate) {
+  bssl::UniquePtr<EC_KEY> other_root_key = CreateEcKey();
+  Certificate other_root_certificate =
+      CreateCertificate("Root", other_root_key.get(), "Root",
+                        other_root_key.get(), /*is_ca=*/true);
+
+  CodeIdentity identity;
+  EXPECT_THAT(VerifyRemoteAssertion(kUserData, *verifying_key_,
+                                    {other_root_certificate}, MakeAssertion(),
+                                    &identity),
+              StatusIs(error::GoogleError::UNAUTHENTICATED));
+}
+
+TEST_F(VerifyRemoteAssertionTest, FailsWithChainForDifferentKey) {
+  auto other_signing_key_result = EcdsaP256Sha256SigningKey::Create();
+  ASSERT_THAT(other_signing_key_result, IsOk());
+  signing_key_ = std::move(other_signing_key_result).ValueOrDie();
+  auto other_verifying_key_result = signing_key_->GetVerifyingKey();
+  ASSERT_THAT(other_verifying_key_result, IsOk());
+  verifying_key_ = std::move(other_verifying_key_result).ValueOrDie();
+
+  CodeIdentity identity;
+  EXPECT_THAT(VerifyRemoteAssertion(kUserData, *verifying_key_,
+                                    {root_certificate_}, MakeAssertion(),
+                                    &identity),
+              StatusIs(error::GoogleError::UNAUTHENTICATED));
+}
+
+TEST_F(VerifyRemoteAssertionTest, FailsWithForgedIntermediateCertificate) {
+  // Replace the intermediate certificate with one that claims to be issued by
+  // the root but is signed by the intermediate key.
+  *certificate_chains_[0].mutable_certificates(1) =
+      CreateCertificate("Intermediate", intermediate_key_.get(), "Root",
+                        intermediate_key_.get(), /*is_ca=*/true);
+
+  CodeIdentity identity;
+  EXPECT_THAT(VerifyRemoteAssertion(kUserData, *verifying_key_,
+                                    {root_certificate_}, MakeAssertion(),
+                                    &identity),
+              StatusIs(error::GoogleError::UNAUTHENTICATED));
+}
+
+TEST_F(VerifyRemoteAssertionTest, FailsWithChainIssuedByNonCaCertificate) {
+  // Replace the intermediate certificate with a correctly signed one that is
+  // not a CA certificate, which makes it an end-entity certificate that issued
+  // the attestation certificate.
+  *certificate_chains_[0].mutable_certificates(1) = CreateCertificate(
+      "Intermediate", intermediate_key_.get(), "Root", root_key_.get());
+
+  CodeIdentity identity;
+  EXPECT_THAT(VerifyRemoteAssertion(kUserData, *verifying_key_,
+                                    {root_certificate_}, MakeAssertion(),
+                                    &identity),
+              StatusIs(error::GoogleError::UNAUTHENTICATED));
+}
+
+TEST_F(VerifyRemoteAssertionTest, FailsWhenPathLengthIsExceeded) {
+  // Allow no intermediate CA certificates below the root.
+  root_certificate_ =
+      CreateCertificate("Root", root_key_.get(), "Root", root_key_.get(),
+                        /*is_ca=*/true, /*max_path_length=*/0);
+  *certificate_chains_[0].mutable_certificates(2) = root_certificate_;
+
+  CodeIdentity identity;
+  EXPECT_THAT(VerifyRemoteAssertion(kUserData, *verifying_key_,
+                                    {root_certificate_}, MakeAssertion(),
+                                    &identity),
+              StatusIs(error::GoogleError::UNAUTHENTICATED));
+}
+
+TEST_F(VerifyRemoteAssertionTest, FailsWithoutCertificateChain) {
+  certificate_chains_.clear();
+
+  CodeIdentity identity;
+  EXPECT_THAT(VerifyRemoteAssertion(kUserData, *verifying_key_,
+                                    {root_certificate_}, MakeAssertion(),
+                                    &identity),
+              StatusIs(error::GoogleError::UNAUTHENTICATED));
+}
+
 }  // namespace
 }  // namespace sgx
 }  // namespace asylo
@@ -139,6 +139,70 @@ Status SgxLocalAssertionVerifier::Verify(const std::string &user_data,
     return Status(error::GoogleError::FAILED_PRECONDITION, "Not initialized");
   }
 
+  sgx::Report report;
+  ASYLO_RETURN_IF_ERROR(ParseReport(assertion, &report));
+
+  // First, verify the hardware REPORT embedded in the assertion. This will only
+  // succeed if the REPORT is targeted at this enclave.
+  ASYLO_RETURN_IF_ERROR(report_verifier_.Verify(report));
+
+  return CompleteVerification(user_data, report, peer_identity);
+}
+
+std::vector<Status> SgxLocalAssertionVerifier::VerifyBatch(
+    const std::vector<std::string> &user_data,
+    const std::vector<Assertion> &assertions,
+    std::vector<EnclaveIdentity> *peer_identities) const {
+  std::vector<Status> results(assertions.size());
+  peer_identities->clear();
+  peer_identities->resize(assertions.size());
+
+  if (!IsInitialized()) {
+    for (Status &result : results) {
+      result = Status(error::GoogleError::FAILED_PRECONDITION,
+                      "Not initialized");
+    }
+    return results;
+  }
+  if (user_data.size() != assertions.size()) {
+    for (Status &result : results) {
+      result = Status(error::GoogleError::INVALID_ARGUMENT,
+                      "Mismatched number of user-data and assertions");
+    }
+    return results;
+  }
+
+  // Parse all REPORTs up front so that the well-formed ones can be verified
+  // together. |report_indices| maps each entry of |reports| back to its
+  // assertion.
+  std::vector<sgx::Report> reports;
+  std::vector<size_t> report_indices;
+  reports.reserve(assertions.size());
+  report_indices.reserve(assertions.size());
+  for (size_t i = 0; i < assertions.size(); ++i) {
+    sgx::Report report;
+    results[i] = ParseReport(assertions[i], &report);
+    if (results[i].ok()) {
+      reports.push_back(report);
+      report_indices.push_back(i);
+    }
+  }
+
+  std::vector<Status> report_results = report_verifier_.VerifyBatch(reports);
+  for (size_t j = 0; j < reports.size(); ++j) {
+    size_t i = report_indices[j];
+    results[i] = report_results[j];
+    if (results[i].ok()) {
+      results[i] = CompleteVerification(user_data[i], reports[j],
+                                        &(*peer_identities)[i]);
+    }
+  }
+
+  return results;
+}
+
+Status SgxLocalAssertionVerifier::ParseReport(const Assertion &assertion,
+                                              sgx::Report *report) const {
   if (!IsCompatibleAssertionDescription(assertion.description())) {
     return Status(error::GoogleError::INVALID_ARGUMENT,
                   "Assertion has incompatible assertion description");
@@ -150,20 +214,21 @@ Status SgxLocalAssertionVerifier::Verify(const std::string &user_data,
                   "Failed to parse LocalAssertion");
   }
 
-  // First, verify the hardware REPORT embedded in the assertion. This will only
-  // succeed if the REPORT is targeted at this enclave. Note that since the
-  // layout and endianness of the REPORT structure is defined by the Intel SGX
-  // architecture, two SGX enclaves can exchange a REPORT by simply dumping the
-  // raw bytes of a REPORT structure into a proto. This code assumes that the
-  // assertion originates from a machine that supports the Intel SGX
-  // architecture and was copied into the assertion byte-for-byte, so is safe to
-  // restore the REPORT structure directly from the deserialized LocalAssertion.
-  sgx::Report report;
-  ASYLO_RETURN_IF_ERROR(SetTrivialObjectFromBinaryString<sgx::Report>(
-      local_assertion.report(), &report));
-  ASYLO_RETURN_IF_ERROR(sgx::VerifyHardwareReport(report));
+  // Note that since the layout and endianness of the REPORT structure is
+  // defined by the Intel SGX architecture, two SGX enclaves can exchange a
+  // REPORT by simply dumping the raw bytes of a REPORT structure into a proto.
+  // This code assumes that the assertion originates from a machine that
+  // supports the Intel SGX architecture and was copied into the assertion
+  // byte-for-byte, so is safe to restore the REPORT structure directly from the
+  // deserialized LocalAssertion.
+  return SetTrivialObjectFromBinaryString<sgx::Report>(local_assertion.report(),
+                                                       report);
+}
 
-  // Next, verify that the REPORT is cryptographically-bound to the provided
+Status SgxLocalAssertionVerifier::CompleteVerification(
+    const std::string &user_data, const sgx::Report &report,
+    EnclaveIdentity *peer_identity) const {
+  // Verify that the REPORT is cryptographically-bound to the provided
   // |user_data|. This is done by re-constructing the expected REPORTDATA (a
   // SHA256 hash of |user_data| padded with zeros), and comparing it to the
   // actual REPORTDATA inside the REPORT.
@@ -21,7 +21,12 @@
 
 #include "asylo/identity/enclave_assertion_verifier.h"
 
+#include <string>
+#include <vector>
+
 #include "absl/synchronization/mutex.h"
+#include "asylo/identity/sgx/hardware_report_verifier.h"
+#include "asylo/identity/sgx/identity_key_management_structs.h"
 
 namespace asylo {
 
@@ -61,7 +66,35 @@ class SgxLocalAssertionVerifier final : public EnclaveAssertionVerifier {
   Status Verify(const std::string &user_data, const Assertion &assertion,
                 EnclaveIdentity *peer_identity) const override;
 
+  /// Verifies a batch of assertions.
+  ///
+  /// Equivalent to calling Verify() on each element of `assertions` with the
+  /// corresponding element of `user_data`, but verifies the hardware REPORTs
+  /// of all assertions together so that the REPORT key is derived at most once
+  /// for the whole batch.
+  ///
+  /// \param user_data The user-provided data bound to each assertion.
+  /// \param assertions The assertions to verify.
+  /// \param[out] peer_identities Resized to the number of assertions. Each
+  ///                             entry whose verification succeeded holds the
+  ///                             identity extracted from that assertion.
+  /// \return The outcome of verifying each assertion, in order.
+  std::vector<Status> VerifyBatch(
+      const std::vector<std::string> &user_data,
+      const std::vector<Assertion> &assertions,
+      std::vector<EnclaveIdentity> *peer_identities) const;
+
  private:
+  // Checks the description of |assertion| and extracts the hardware REPORT
+  // embedded in it.
+  Status ParseReport(const Assertion &assertion, sgx::Report *report) const;
+
+  // Verifies that the already-verified |report| is bound to |user_data| and
+  // writes the identity it describes to |peer_identity|.
+  Status CompleteVerification(const std::string &user_data,
+                              const sgx::Report &report,
+                              EnclaveIdentity *peer_identity) const;
+
   // The identity type handled by this verifier.
   static constexpr EnclaveIdentityType identity_type_ = CODE_IDENTITY;
 
@@ -76,6 +109,9 @@ class SgxLocalAssertionVerifier final : public EnclaveAssertionVerifier {
 
   // A mutex that guards the initialized_ member.
   mutable absl::Mutex initialized_mu_;
+
+  // Verifies hardware REPORTs, caching the REPORT keys of this enclave.
+  sgx::HardwareReportVerifier report_verifier_;
 };
 
 }  // namespace asylo
@@ -391,5 +391,73 @@ TEST_F(SgxLocalAssertionVerifierTest, VerifySuccess) {
       << expected_identity.DebugString();
 }
 
+// Verify that VerifyBatch() fails every assertion if the verifier is not yet
+// initialized.
+TEST_F(SgxLocalAssertionVerifierTest, VerifyBatchFailsIfNotInitialized) {
+  SgxLocalAssertionVerifier verifier;
+
+  std::vector<EnclaveIdentity> identities;
+  std::vector<Status> results =
+      verifier.VerifyBatch({kUserData}, {Assertion()}, &identities);
+  ASSERT_EQ(results.size(), 1);
+  EXPECT_THAT(results[0], Not(IsOk()));
+}
+
+// Verify that VerifyBatch() reports the outcome of each assertion separately
+// and extracts the identities of the successfully-verified ones.
+TEST_F(SgxLocalAssertionVerifierTest, VerifyBatchReportsPerAssertionResults) {
+  SgxLocalAssertionVerifier verifier;
+  ASYLO_ASSERT_OK(verifier.Initialize(config_));
+
+  Sha256Hash hash;
+  hash.Update(kUserData);
+  sgx::AlignedReportdataPtr reportdata;
+  *reportdata = TrivialZeroObject<sgx::Reportdata>();
+  std::vector<uint8_t> digest;
+  ASYLO_ASSERT_OK(hash.CumulativeHash(&digest));
+  reportdata->data.replace(/*pos=*/0, digest);
+
+  sgx::AlignedTargetinfoPtr targetinfo;
+  sgx::SetTargetinfoFromSelfIdentity(targetinfo.get());
+
+  sgx::AlignedReportPtr report;
+  ASYLO_ASSERT_OK(
+      sgx::GetHardwareReport(*targetinfo, *reportdata, report.get()));
+  sgx::LocalAssertion local_assertion;
+  local_assertion.set_report(reinterpret_cast<const char *>(report.get()),
+                             sizeof(*report));
+
+  Assertion valid_assertion;
+  SetAssertionDescription(valid_assertion.mutable_description());
+  ASSERT_TRUE(
+      local_assertion.SerializeToString(valid_assertion.mutable_assertion()));
+
+  Assertion unparseable_assertion;
+  SetAssertionDescription(unparseable_assertion.mutable_description());
+  unparseable_assertion.set_assertion(kBadLocalAssertion);
+
+  std::vector<EnclaveIdentity> identities;
+  std::vector<Status> results = verifier.VerifyBatch(
+      {kUserData, kUserData, "Other user data", kUserData},
+      {valid_assertion, unparseable_assertion, valid_assertion,
+       valid_assertion},
+      &identities);
+  ASSERT_EQ(results.size(), 4);
+  ASSERT_EQ(identities.size(), 4);
+  ASYLO_EXPECT_OK(results[0]);
+  EXPECT_THAT(results[1], Not(IsOk()));
+  EXPECT_THAT(results[2], Not(IsOk()));
+  ASYLO_EXPECT_OK(results[3]);
+
+  sgx::CodeIdentity expected_identity = sgx::GetSelfIdentity()->identity;
+  for (int i : {0, 3}) {
+    EXPECT_EQ(identities[i].description().authority_type(),
+              sgx::kSgxAuthorizationAuthority);
+    sgx::CodeIdentity code_identity;
+    ASSERT_TRUE(code_identity.ParseFromString(identities[i].identity()));
+    EXPECT_THAT(code_identity, EqualsProto(expected_identity));
+  }
+}
+
 }  // namespace
 }  // namespace asylo
@@ -26,8 +26,15 @@
 extern "C" {
 #endif
 
+// Fills |buf| with |count| random bytes from the hardware random number
+// generator. Returns |count|.
 ssize_t enc_hardware_random(uint8_t *buf, size_t count);
 
+// Fills |buf| with |count| bytes of hardware entropy suitable for seeding a
+// software random bit generator. This is slower than enc_hardware_random() and
+// should only be used for seeding. Returns |count|.
+ssize_t enc_hardware_random_seed(uint8_t *buf, size_t count);
+
 #ifdef __cplusplus
 }  // extern "C"
 #endif
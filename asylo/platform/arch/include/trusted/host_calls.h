@@ -84,6 +84,10 @@ int enc_untrusted_open(const char *path_name, int flags, ...);
 int enc_untrusted_close(int fd);
 ssize_t enc_untrusted_read(int fd, void *buf, size_t len);
 ssize_t enc_untrusted_write(int fd, const void *buf, size_t len);
+// Reads from and writes to |offset| without moving the file cursor.
+ssize_t enc_untrusted_pread64(int fd, void *buf, size_t len, off_t offset);
+ssize_t enc_untrusted_pwrite64(int fd, const void *buf, size_t len,
+                               off_t offset);
 int enc_untrusted_puts(const char *str);
 off_t enc_untrusted_lseek(int fd, off_t offset, int whence);
 int enc_untrusted_unlink(const char *path_name);
@@ -99,9 +103,18 @@ int enc_untrusted_lstat(const char *pathname, struct stat *stat_buffer);
 int enc_untrusted_symlink(const char *from, const char *to);
 int enc_untrusted_fstat(int fd, struct stat *stat_buffer);
 int enc_untrusted_isatty(int file);
-ssize_t enc_untrusted_writev(int fd, char *buf, int size);
-ssize_t enc_untrusted_readv(int fd, const struct iovec *iov, int iovcnt,
-                            char *buf, int size);
+// Writes from and reads into buffers described by an iovec array staged in
+// untrusted memory, along with the buffers themselves.
+ssize_t enc_untrusted_writev(int fd, const struct bridge_iovec *bridge_iov,
+                             int iovcnt);
+ssize_t enc_untrusted_readv(int fd, const struct bridge_iovec *bridge_iov,
+                            int iovcnt);
+// Similar to enc_untrusted_writev and enc_untrusted_readv, but access the file
+// at |offset| without moving the file cursor.
+ssize_t enc_untrusted_pwritev(int fd, const struct bridge_iovec *bridge_iov,
+                              int iovcnt, off_t offset);
+ssize_t enc_untrusted_preadv(int fd, const struct bridge_iovec *bridge_iov,
+                             int iovcnt, off_t offset);
 
 //////////////////////////////////////
 //            Sockets               //
@@ -123,8 +136,8 @@ int enc_untrusted_inet_pton(int af, const char *src, void *dst);
 ssize_t enc_untrusted_send(int sockfd, const void *buf, size_t len, int flags);
 ssize_t enc_untrusted_sendmsg(
     int sockfd, const struct bridge_msghdr *bridge_msg, int flags);
-ssize_t enc_untrusted_recvmsg(int sockfd, struct msghdr *msg,
-                              struct bridge_msghdr *bridge_msg, int flags);
+ssize_t enc_untrusted_recvmsg(int sockfd, struct bridge_msghdr *bridge_msg,
+                              int flags);
 int enc_untrusted_getaddrinfo(const char *node, const char *service,
                               const struct addrinfo *hints,
                               struct addrinfo **res);
@@ -151,8 +164,18 @@ int enc_untrusted_create_thread(const char *name);
 // enc_untrusted_sys_futex_wake. Otherwise returns immediately.
 void enc_untrusted_sys_futex_wait(int32_t *futex, int32_t expected);
 
-// Exits the enclave and wakes a suspended thread blocked on |futex|.
-void enc_untrusted_sys_futex_wake(int32_t *futex);
+// Behaves like enc_untrusted_sys_futex_wait, but also returns once
+// |timeout_nanoseconds| have elapsed on the host.
+void enc_untrusted_sys_futex_timedwait(int32_t *futex, int32_t expected,
+                                       int64_t timeout_nanoseconds);
+
+// Exits the enclave and wakes a suspended thread blocked on |futex|. Returns
+// the number of threads woken, as reported by the host.
+int enc_untrusted_sys_futex_wake(int32_t *futex);
+
+// Exits the enclave and wakes all suspended threads blocked on |futex|. Returns
+// the number of threads woken, as reported by the host.
+int enc_untrusted_sys_futex_wake_all(int32_t *futex);
 
 //////////////////////////////////////
 //            poll.h                //
@@ -178,8 +201,12 @@ int enc_untrusted_inotify_init1(int non_block);
 int enc_untrusted_inotify_add_watch(int fd, const char *pathname,
                                     uint32_t mask);
 int enc_untrusted_inotify_rm_watch(int fd, int wd);
-int enc_untrusted_inotify_read(int fd, size_t count, char **serialized_events,
-                               size_t *serialized_events_len);
+
+// Reads up to |count| bytes of inotify events from the host inotify file
+// descriptor |fd| into |buf|, which must be in enclave memory. The events are
+// validated and their masks translated in place. Returns the number of bytes
+// read, or -1 on failure with errno set.
+ssize_t enc_untrusted_inotify_read(int fd, char *buf, size_t count);
 
 //////////////////////////////////////
 //            ifaddrs.h             //
@@ -314,6 +341,16 @@ void *enc_untrusted_acquire_shared_resource(enum SharedNameKind kind,
 int enc_untrusted_release_shared_resource(enum SharedNameKind kind,
                                           const char *name);
 
+// Reads at most |count| bytes of input from the host end of a stream opened by
+// EnclaveClient::EnterAndRunStream() into |buf|. Returns the number of bytes
+// read, zero at the end of the input, or -1 if the host failed to produce
+// input.
+ssize_t enc_untrusted_stream_read(void *channel, void *buf, size_t count);
+
+// Passes |count| bytes of output at |buf| to the host end of a stream opened by
+// EnclaveClient::EnterAndRunStream(). Returns 0 on success.
+int enc_untrusted_stream_write(void *channel, const void *buf, size_t count);
+
 //////////////////////////////////////
 //            Debugging             //
 //////////////////////////////////////
@@ -81,6 +81,45 @@ int ecall_run(const char *input, bridge_size_t input_len, char **output,
   return result;
 }
 
+// Invokes the enclave raw run entry-point. Returns a non-zero error code on
+// failure.
+int ecall_run_raw(const char *input, bridge_size_t input_len, char **output,
+                  bridge_size_t *output_len, int *output_is_status) {
+  int result = 0;
+  size_t tmp_output_len;
+  try {
+    result = asylo::__asylo_user_run_raw(input, static_cast<size_t>(input_len),
+                                         output, &tmp_output_len,
+                                         output_is_status);
+  } catch (...) {
+    LOG(FATAL) << "Uncaught exception in enclave";
+  }
+
+  if (output_len) {
+    *output_len = static_cast<bridge_size_t>(tmp_output_len);
+  }
+
+  return result;
+}
+
+// Invokes the enclave streaming run entry-point. Returns a non-zero error code
+// on failure.
+int ecall_run_stream(void *channel, char **output, bridge_size_t *output_len) {
+  int result = 0;
+  size_t tmp_output_len;
+  try {
+    result = asylo::__asylo_user_run_stream(channel, output, &tmp_output_len);
+  } catch (...) {
+    LOG(FATAL) << "Uncaught exception in enclave";
+  }
+
+  if (output_len) {
+    *output_len = static_cast<bridge_size_t>(tmp_output_len);
+  }
+
+  return result;
+}
+
 int ecall_donate_thread() { return asylo::__asylo_threading_donate(); }
 
 // Invokes the enclave signal handling entry-point. Returns a non-zero error
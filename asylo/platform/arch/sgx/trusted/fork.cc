@@ -27,6 +27,7 @@
 
 #include "absl/base/macros.h"
 #include "asylo/crypto/aead_cryptor.h"
+#include "asylo/crypto/chacha20_drbg.h"
 #include "asylo/crypto/util/bssl_util.h"
 #include "asylo/crypto/util/byte_container_view.h"
 #include "asylo/crypto/util/trivial_object_util.h"
@@ -660,6 +661,10 @@ Status RestoreForFork(const char *input, size_t input_len) {
     return Status(error_code, error_message);
   }
 
+  // The restored random bit generators are copies of the parent's, so make
+  // them reseed before the child produces any output from them.
+  ChaCha20Drbg::ReseedAll();
+
   // Only unblock other entries if restoring the child enclave succeeds.
   // Otherwise this enclave blocks all entries. The entries are blocked at this
   // point because they were blocked when the snapshot is taken, and inherited
@@ -45,6 +45,29 @@ static uint64_t rdrand64() {
   return temp;
 }
 
+static void rdseed64(void *out) {
+  // RDSEED fails whenever the entropy conditioner is drained, which happens
+  // under contention, so it is retried more patiently than RDRAND. If it keeps
+  // failing, fall back to RDRAND, whose output is reseeded from the same
+  // conditioner.
+  constexpr int kSeedRetries = 100;
+  for (int i = 0; i < kSeedRetries; ++i) {
+    if (_rdseed64_step(static_cast<unsigned long long *>(out))) {
+      return;
+    }
+    _mm_pause();
+  }
+
+  rdrand64(out);
+}
+
+static uint64_t rdseed64() {
+  uint64_t temp;
+  rdseed64(&temp);
+
+  return temp;
+}
+
 // Compute alignment properties of given buffer.
 static void CalculateAlignment(const void *buf, size_t size, size_t align_size,
                                size_t *unaligned_bytes, size_t *aligned_count,
@@ -56,10 +79,10 @@ static void CalculateAlignment(const void *buf, size_t size, size_t align_size,
   *partial_bytes = size - *unaligned_bytes - (*aligned_count * align_size);
 }
 
-}  // namespace
-
-// Fills given buffer with random values generated with the rdrand instruction.
-extern "C" ssize_t enc_hardware_random(uint8_t *buf, size_t count) {
+// Fills given buffer with 64-bit values produced by |word| and |fill|, which
+// return a value and write a value in place respectively.
+template <uint64_t (*word)(), void (*fill)(void *)>
+static ssize_t FillRandom(uint8_t *buf, size_t count) {
   size_t unaligned_bytes;
   size_t aligned_count;
   size_t partial_bytes;
@@ -71,7 +94,7 @@ extern "C" ssize_t enc_hardware_random(uint8_t *buf, size_t count) {
 
   // Copy random bytes into any unaligned portion at the start.
   if (unaligned_bytes) {
-    uint64_t temp = rdrand64();
+    uint64_t temp = word();
     memcpy(&byte_buf[0], &temp, unaligned_bytes);
   }
 
@@ -79,16 +102,28 @@ extern "C" ssize_t enc_hardware_random(uint8_t *buf, size_t count) {
   uint8_t *aligned_end = &byte_buf[count - partial_bytes];
   for (uint8_t *aligned_buf = &byte_buf[unaligned_bytes];
        aligned_buf < aligned_end; aligned_buf += sizeof(uint64_t)) {
-    rdrand64(aligned_buf);
+    fill(aligned_buf);
   }
 
   // Copy random bytes into any partial portion at the end.
   if (partial_bytes) {
-    uint64_t temp = rdrand64();
+    uint64_t temp = word();
     memcpy(aligned_end, &temp, partial_bytes);
   }
 
   return count;
 }
 
+}  // namespace
+
+// Fills given buffer with random values generated with the rdrand instruction.
+extern "C" ssize_t enc_hardware_random(uint8_t *buf, size_t count) {
+  return FillRandom<rdrand64, rdrand64>(buf, count);
+}
+
+// Fills given buffer with seed values generated with the rdseed instruction.
+extern "C" ssize_t enc_hardware_random_seed(uint8_t *buf, size_t count) {
+  return FillRandom<rdseed64, rdseed64>(buf, count);
+}
+
 }  // namespace asylo
@@ -26,6 +26,8 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <poll.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
 #include <stdarg.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -210,34 +212,33 @@ int enc_untrusted_lstat(const char *pathname, struct stat *stat_buffer) {
   return result;
 }
 
-void fill_iov(const char *buf, int size, const struct iovec *iov, int iovcnt) {
-  size_t bytes_left = size;
-  for (int i = 0; i < iovcnt; ++i) {
-    if (bytes_left == 0) {
-      break;
-    }
-    int bytes_to_copy = std::min(bytes_left, iov[i].iov_len);
-    memcpy(iov[i].iov_base, buf, bytes_to_copy);
-    buf += bytes_to_copy;
-    bytes_left -= bytes_to_copy;
-  }
+ssize_t enc_untrusted_writev(int fd, const struct bridge_iovec *bridge_iov,
+                             int iovcnt) {
+  bridge_ssize_t ret;
+  CHECK_OCALL(ocall_enc_untrusted_writev(&ret, fd, bridge_iov, iovcnt));
+  return static_cast<ssize_t>(ret);
 }
 
-ssize_t enc_untrusted_writev(int fd, char *buf, int size) {
-  asylo::UntrustedUniquePtr<char> tmp(buf);
+ssize_t enc_untrusted_readv(int fd, const struct bridge_iovec *bridge_iov,
+                            int iovcnt) {
   bridge_ssize_t ret;
+  CHECK_OCALL(ocall_enc_untrusted_readv(&ret, fd, bridge_iov, iovcnt));
+  return static_cast<ssize_t>(ret);
+}
 
+ssize_t enc_untrusted_pwritev(int fd, const struct bridge_iovec *bridge_iov,
+                              int iovcnt, off_t offset) {
+  bridge_ssize_t ret;
   CHECK_OCALL(
-      ocall_enc_untrusted_write_with_untrusted_ptr(&ret, fd, buf, size));
+      ocall_enc_untrusted_pwritev(&ret, fd, bridge_iov, iovcnt, offset));
   return static_cast<ssize_t>(ret);
 }
 
-ssize_t enc_untrusted_readv(int fd, const struct iovec *iov, int iovcnt,
-                            char *buf, int size) {
-  asylo::UntrustedUniquePtr<char> tmp(buf);
+ssize_t enc_untrusted_preadv(int fd, const struct bridge_iovec *bridge_iov,
+                             int iovcnt, off_t offset) {
   bridge_ssize_t ret;
-  CHECK_OCALL(ocall_enc_untrusted_read_with_untrusted_ptr(&ret, fd, buf, size));
-  fill_iov(buf, ret, iov, iovcnt);
+  CHECK_OCALL(
+      ocall_enc_untrusted_preadv(&ret, fd, bridge_iov, iovcnt, offset));
   return static_cast<ssize_t>(ret);
 }
 
@@ -298,15 +299,11 @@ ssize_t enc_untrusted_sendmsg(int sockfd,
   return static_cast<ssize_t>(ret);
 }
 
-ssize_t enc_untrusted_recvmsg(int sockfd,
-                              struct msghdr *msg,
-                              struct bridge_msghdr *bridge_msg,
+ssize_t enc_untrusted_recvmsg(int sockfd, struct bridge_msghdr *bridge_msg,
                               int flags) {
   bridge_ssize_t ret;
   CHECK_OCALL(
       ocall_enc_untrusted_recvmsg(&ret, sockfd, bridge_msg, flags));
-
-  asylo::FromBridgeIovecArray(bridge_msg, msg);
   return static_cast<ssize_t>(ret);
 }
 
@@ -472,60 +469,31 @@ int enc_untrusted_getpeername(int sockfd, struct sockaddr *addr,
 
 ssize_t enc_untrusted_recvfrom(int sockfd, void *buf, size_t len, int flags,
                                struct sockaddr *src_addr, socklen_t *addrlen) {
-  ssize_t ret = 0;
-  char *serialized_args = nullptr;
-  size_t serialized_len = 0;
-  if (!asylo::SerializeRecvFromArgs(sockfd, len, flags, &serialized_args,
-                                    &serialized_len)) {
+  if (src_addr && !addrlen) {
     errno = EINVAL;
     return -1;
   }
-  asylo::MallocUniquePtr<char[]> args_ptr(serialized_args);
-  char *serialized_output = nullptr;
-  char **serialized_output_ptr = src_addr ? &serialized_output : nullptr;
-  char *output_buf = nullptr;
-  bridge_ssize_t output_len = 0;
-  CHECK_OCALL(ocall_enc_untrusted_recvfrom(&ret, serialized_args,
-                                           serialized_len, &output_buf,
-                                           serialized_output_ptr, &output_len));
-  asylo::UntrustedUniquePtr<char[]> output_buf_ptr(output_buf);
+  bridge_ssize_t ret;
+  struct bridge_sockaddr bridge_src_addr;
+  CHECK_OCALL(ocall_enc_untrusted_recvfrom(
+      &ret, sockfd, buf, static_cast<bridge_size_t>(len), flags,
+      src_addr ? &bridge_src_addr : nullptr));
   if (ret < 0) {
     // errno is propagated.
     return -1;
   }
-  if (!sgx_is_outside_enclave(output_buf, ret)) {
+  // At most |len| bytes were copied into |buf|, so a larger count suggests
+  // malicious behavior, therefore, we abort(). Only MSG_TRUNC asks for the
+  // real length of a datagram longer than |buf|.
+  if (static_cast<size_t>(ret) > len && !(flags & MSG_TRUNC)) {
     abort();
   }
-  memcpy(buf, output_buf, ret);
-  if (src_addr) {
-    struct sockaddr *src_addr_copy = nullptr;
-    asylo::UntrustedUniquePtr<char[]> output_unique_ptr(serialized_output);
-    if (!sgx_is_outside_enclave(serialized_output, output_len)) {
-      abort();
-    }
-    std::string serialized_output_str(serialized_output, output_len);
-    if (!addrlen || !asylo::DeserializeRecvFromSrcAddr(serialized_output_str,
-                                                       &src_addr_copy)) {
-      errno = EINVAL;
-      return -1;
-    }
-    asylo::MallocUniquePtr<struct sockaddr> src_addr_ptr(src_addr_copy);
-    if (src_addr_copy->sa_family == AF_INET) {
-      memcpy(
-          src_addr, src_addr_copy,
-          std::min(static_cast<size_t>(*addrlen), sizeof(struct sockaddr_in)));
-      *addrlen = sizeof(struct sockaddr_in);
-    } else if (src_addr_copy->sa_family == AF_INET6) {
-      memcpy(
-          src_addr, src_addr_copy,
-          std::min(static_cast<size_t>(*addrlen), sizeof(struct sockaddr_in6)));
-      *addrlen = sizeof(struct sockaddr_in6);
-    } else {
-      errno = EINVAL;
-      return -1;
-    }
+  if (src_addr &&
+      !asylo::FromBridgeSockaddr(&bridge_src_addr, src_addr, addrlen)) {
+    errno = EINVAL;
+    return -1;
   }
-  return ret;
+  return static_cast<ssize_t>(ret);
 }
 
 //////////////////////////////////////
@@ -575,59 +543,43 @@ int enc_untrusted_epoll_create(int size) {
 
 int enc_untrusted_epoll_ctl(int epfd, int op, int fd,
                             struct epoll_event *event) {
-  char *serialized_args = nullptr;
-  asylo::MallocUniquePtr<char[]> args_ptr(serialized_args);
-  size_t len = 0;
-  if (!asylo::SerializeEpollCtlArgs(epfd, op, fd, event, &serialized_args,
-                                    &len)) {
+  int bridge_op = asylo::ToBridgeEpollCtlOperation(op);
+  if (bridge_op == BRIDGE_EPOLL_CTL_UNSUPPORTED) {
     errno = EINVAL;
     return -1;
   }
-  bridge_size_t serialized_args_len = static_cast<bridge_size_t>(len);
+  struct bridge_epoll_event bridge_event;
+  struct bridge_epoll_event *bridge_event_ptr =
+      asylo::ToBridgeEpollEvent(event, &bridge_event);
   int ret = 0;
-  CHECK_OCALL(ocall_enc_untrusted_epoll_ctl(&ret, serialized_args,
-                                            serialized_args_len));
+  CHECK_OCALL(ocall_enc_untrusted_epoll_ctl(&ret, epfd, bridge_op, fd,
+                                            bridge_event_ptr));
   return ret;
 }
 
 int enc_untrusted_epoll_wait(int epfd, struct epoll_event *events,
                              int maxevents, int timeout) {
-  char *serialized_args = nullptr;
-  asylo::MallocUniquePtr<char[]> args_ptr(serialized_args);
-  size_t len = 0;
-  if (!asylo::SerializeEpollWaitArgs(epfd, maxevents, timeout, &serialized_args,
-                                     &len)) {
+  if (maxevents <= 0) {
     errno = EINVAL;
     return -1;
   }
-
-  bridge_size_t serialized_args_len = static_cast<bridge_size_t>(len);
+  auto bridge_events = absl::make_unique<bridge_epoll_event[]>(maxevents);
   int ret = 0;
-  char *serialized_event_list = nullptr;
-  bridge_size_t serialized_event_list_len = 0;
-  CHECK_OCALL(ocall_enc_untrusted_epoll_wait(
-      &ret, serialized_args, serialized_args_len, &serialized_event_list,
-      &serialized_event_list_len));
-  if (!sgx_is_outside_enclave(serialized_event_list,
-                              serialized_event_list_len)) {
-    abort();
-  }
-  asylo::UntrustedUniquePtr<char[]>
-      serialized_events_ptr(serialized_event_list);
-  // The line below intentially copies |serialized_event_list| into trusted
-  // memory.
-  std::string event_list_str(serialized_event_list, serialized_event_list_len);
-  int numevents = 0;
-  if (!asylo::DeserializeEvents(event_list_str, events, &numevents)) {
-    errno = EBADE;
+  CHECK_OCALL(ocall_enc_untrusted_epoll_wait(&ret, epfd, bridge_events.get(),
+                                             maxevents, timeout));
+  if (ret < 0) {
+    // errno is propagated.
     return -1;
   }
-  // Check if the number of events in the deserialized results (|numevents|) is
-  // the same as the return value of epoll_wait (|ret|). An inconsistency would
-  // suggest malicious behavior, therefore, we would abort().
-  if (numevents != ret) {
+  // The events were copied into the enclave as a fixed-size array, so the only
+  // thing to validate is the number of events reported by the host. A count
+  // larger than |maxevents| suggests malicious behavior, therefore, we abort().
+  if (ret > maxevents) {
     abort();
   }
+  for (int i = 0; i < ret; ++i) {
+    asylo::FromBridgeEpollEvent(&bridge_events[i], &events[i]);
+  }
   return ret;
 }
 
@@ -643,41 +595,55 @@ int enc_untrusted_inotify_init1(int non_block) {
 
 int enc_untrusted_inotify_add_watch(int fd, const char *pathname,
                                     uint32_t mask) {
-  char *serialized_args = nullptr;
-  asylo::MallocUniquePtr<char> args_ptr(serialized_args);
-  size_t len = 0;
-  if (!asylo::SerializeInotifyAddWatchArgs(fd, pathname, mask, &serialized_args,
-                                           &len)) {
-    return -1;
-  }
-  bridge_size_t serialized_args_len = static_cast<bridge_size_t>(len);
   int ret = 0;
-  CHECK_OCALL(ocall_enc_untrusted_inotify_add_watch(&ret, serialized_args,
-                                                    serialized_args_len));
+  CHECK_OCALL(ocall_enc_untrusted_inotify_add_watch(
+      &ret, fd, pathname, asylo::ToBridgeInotifyEventMask(mask)));
   return ret;
 }
 
 int enc_untrusted_inotify_rm_watch(int fd, int wd) {
-  char *serialized_args = nullptr;
-  asylo::MallocUniquePtr<char> args_ptr(serialized_args);
-  size_t len = 0;
-  if (!asylo::SerializeInotifyRmWatchArgs(fd, wd, &serialized_args, &len)) {
-    errno = EINVAL;
-    return -1;
-  }
-  bridge_size_t serialized_args_len = static_cast<bridge_size_t>(len);
   int ret = 0;
-  CHECK_OCALL(ocall_enc_untrusted_inotify_rm_watch(&ret, serialized_args,
-                                                   serialized_args_len));
+  CHECK_OCALL(ocall_enc_untrusted_inotify_rm_watch(&ret, fd, wd));
   return ret;
 }
 
-int enc_untrusted_inotify_read(int fd, size_t count, char **serialized_events,
-                               size_t *serialized_events_len) {
-  int ret = 0;
+ssize_t enc_untrusted_inotify_read(int fd, char *buf, size_t count) {
+  static_assert(sizeof(struct bridge_inotify_event) ==
+                    sizeof(struct inotify_event),
+                "bridge_inotify_event must match the inotify_event layout");
+  bridge_ssize_t ret = 0;
   CHECK_OCALL(ocall_enc_untrusted_inotify_read(
-      &ret, fd, count, serialized_events, serialized_events_len));
-  return ret;
+      &ret, fd, buf, static_cast<bridge_size_t>(count)));
+  if (ret < 0) {
+    // errno is propagated.
+    return -1;
+  }
+  if (static_cast<size_t>(ret) > count) {
+    abort();
+  }
+  // Walk the events in place, checking that each one lies entirely within the
+  // bytes read and translating its mask. Malformed events suggest malicious
+  // behavior, therefore, we abort().
+  size_t offset = 0;
+  while (offset < static_cast<size_t>(ret)) {
+    size_t remaining = static_cast<size_t>(ret) - offset;
+    if (remaining < sizeof(struct bridge_inotify_event)) {
+      abort();
+    }
+    struct bridge_inotify_event bridge_event;
+    memcpy(&bridge_event, buf + offset, sizeof(bridge_event));
+    if (bridge_event.len > remaining - sizeof(bridge_event)) {
+      abort();
+    }
+    struct inotify_event event;
+    event.wd = bridge_event.wd;
+    event.mask = asylo::FromBridgeInotifyEventMask(bridge_event.mask);
+    event.cookie = bridge_event.cookie;
+    event.len = bridge_event.len;
+    memcpy(buf + offset, &event, sizeof(event));
+    offset += sizeof(bridge_event) + bridge_event.len;
+  }
+  return static_cast<ssize_t>(ret);
 }
 
 //////////////////////////////////////
@@ -1057,6 +1023,20 @@ int enc_untrusted_release_shared_resource(enum SharedNameKind kind,
   return ret ? 0 : -1;
 }
 
+ssize_t enc_untrusted_stream_read(void *channel, void *buf, size_t count) {
+  bridge_ssize_t ret;
+  CHECK_OCALL(ocall_enc_untrusted_stream_read(
+      &ret, channel, buf, static_cast<bridge_size_t>(count)));
+  return static_cast<ssize_t>(ret);
+}
+
+int enc_untrusted_stream_write(void *channel, const void *buf, size_t count) {
+  int ret;
+  CHECK_OCALL(ocall_enc_untrusted_stream_write(
+      &ret, channel, buf, static_cast<bridge_size_t>(count)));
+  return ret;
+}
+
 //////////////////////////////////////
 //           Debugging              //
 //////////////////////////////////////
@@ -36,6 +36,7 @@
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/uio.h>
 #include <sys/utsname.h>
 #include <sys/wait.h>
 #include <syslog.h>
@@ -48,11 +49,13 @@
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
 #include <iterator>
 #include <vector>
 
 #include "absl/memory/memory.h"
+#include "asylo/crypto/util/byte_container_view.h"
 #include "asylo/enclave.pb.h"
 #include "asylo/platform/arch/sgx/untrusted/generated_bridge_u.h"
 #include "asylo/platform/arch/sgx/untrusted/sgx_client.h"
@@ -67,6 +70,7 @@
 #include "asylo/util/posix_error_space.h"
 #include "asylo/util/status.h"
 #include "asylo/util/status_macros.h"
+#include "asylo/util/statusor.h"
 
 #include "asylo/util/logging.h"
 
@@ -271,15 +275,46 @@ int ocall_enc_untrusted_lstat(const char *pathname,
   return ret;
 }
 
-bridge_ssize_t ocall_enc_untrusted_write_with_untrusted_ptr(int fd,
-                                                            const void *buf,
-                                                            int size) {
-  return static_cast<bridge_ssize_t>(write(fd, buf, size));
+bridge_ssize_t ocall_enc_untrusted_writev(int fd,
+                                          const struct bridge_iovec *iov,
+                                          int iovcnt) {
+  std::vector<struct iovec> host_iov(std::max(iovcnt, 0));
+  for (int i = 0; i < iovcnt; ++i) {
+    asylo::FromBridgeIovec(&iov[i], &host_iov[i]);
+  }
+  return static_cast<bridge_ssize_t>(writev(fd, host_iov.data(), iovcnt));
+}
+
+bridge_ssize_t ocall_enc_untrusted_readv(int fd,
+                                         const struct bridge_iovec *iov,
+                                         int iovcnt) {
+  std::vector<struct iovec> host_iov(std::max(iovcnt, 0));
+  for (int i = 0; i < iovcnt; ++i) {
+    asylo::FromBridgeIovec(&iov[i], &host_iov[i]);
+  }
+  return static_cast<bridge_ssize_t>(readv(fd, host_iov.data(), iovcnt));
+}
+
+bridge_ssize_t ocall_enc_untrusted_pwritev(int fd,
+                                           const struct bridge_iovec *iov,
+                                           int iovcnt, int64_t offset) {
+  std::vector<struct iovec> host_iov(std::max(iovcnt, 0));
+  for (int i = 0; i < iovcnt; ++i) {
+    asylo::FromBridgeIovec(&iov[i], &host_iov[i]);
+  }
+  return static_cast<bridge_ssize_t>(
+      pwritev(fd, host_iov.data(), iovcnt, offset));
 }
 
-bridge_ssize_t ocall_enc_untrusted_read_with_untrusted_ptr(int fd, void *buf,
-                                                           int size) {
-  return static_cast<bridge_ssize_t>(read(fd, buf, size));
+bridge_ssize_t ocall_enc_untrusted_preadv(int fd,
+                                          const struct bridge_iovec *iov,
+                                          int iovcnt, int64_t offset) {
+  std::vector<struct iovec> host_iov(std::max(iovcnt, 0));
+  for (int i = 0; i < iovcnt; ++i) {
+    asylo::FromBridgeIovec(&iov[i], &host_iov[i]);
+  }
+  return static_cast<bridge_ssize_t>(
+      preadv(fd, host_iov.data(), iovcnt, offset));
 }
 
 //////////////////////////////////////
@@ -370,9 +405,12 @@ bridge_ssize_t ocall_enc_untrusted_recvmsg(int sockfd,
   tmp.msg_iov = buf.get();
   bridge_ssize_t ret =
       static_cast<bridge_ssize_t>(recvmsg(sockfd, &tmp, flags));
-  if (!asylo::ToBridgeIovecArray(&tmp, msg)) {
-    errno = EFAULT;
-    return -1;
+  if (ret != -1) {
+    // The data, name and control data were received in place; only the
+    // lengths and flags need to be reported back.
+    msg->msg_namelen = tmp.msg_namelen;
+    msg->msg_controllen = tmp.msg_controllen;
+    msg->msg_flags = tmp.msg_flags;
   }
   return ret;
 }
@@ -475,43 +513,34 @@ int ocall_enc_untrusted_getpeername(int sockfd, struct bridge_sockaddr *addr) {
   return ret;
 }
 
-ssize_t ocall_enc_untrusted_recvfrom(const char *serialized_args,
-                                     bridge_ssize_t serialized_args_len,
-                                     char **buf_ptr, char **serialized_output,
-                                     bridge_ssize_t *serialized_output_len) {
-  std::string serialized_args_str(serialized_args, serialized_args_len);
-  int sockfd = 0;
-  size_t len = 0;
-  int flags = 0;
-  if (!asylo::DeserializeRecvFromArgs(serialized_args, &sockfd, &len, &flags) ||
-      !buf_ptr) {
+bridge_ssize_t ocall_enc_untrusted_recvfrom(int sockfd, void *buf,
+                                            bridge_size_t len, int flags,
+                                            struct bridge_sockaddr *src_addr) {
+  if (!src_addr) {
+    return recvfrom(sockfd, buf, static_cast<size_t>(len), flags, nullptr,
+                    nullptr);
+  }
+  struct sockaddr_storage tmp;
+  memset(&tmp, 0, sizeof(tmp));
+  socklen_t tmp_len = sizeof(tmp);
+  ssize_t ret = recvfrom(sockfd, buf, static_cast<size_t>(len), flags,
+                         reinterpret_cast<struct sockaddr *>(&tmp), &tmp_len);
+  if (ret < 0) {
+    return ret;
+  }
+  // Connection-oriented sockets may not fill in the source address, in which
+  // case |tmp| is left as an AF_UNSPEC address.
+  if (tmp.ss_family != AF_UNSPEC && tmp.ss_family != AF_INET &&
+      tmp.ss_family != AF_INET6 && tmp.ss_family != AF_UNIX) {
     errno = EINVAL;
     return -1;
   }
-  *buf_ptr = static_cast<char *>(malloc(len));
-  if (serialized_output) {
-    struct sockaddr_storage src_addr;
-    struct sockaddr *src_addr_ptr =
-        reinterpret_cast<struct sockaddr *>(&src_addr);
-    socklen_t addrlen;
-    int ret = recvfrom(sockfd, *buf_ptr, len, flags, src_addr_ptr, &addrlen);
-    size_t src_addr_len = 0;
-    // If the address family is unsupported, then errno is set to indicate an
-    // invalid argument error. The value of error_code is irrelevant in this
-    // context.
-    int error_code;
-    // The caller is responsible for freeing the memory allocated by
-    // SerializeRecvFromSrcAddr.
-    if (!asylo::SerializeRecvFromSrcAddr(src_addr_ptr, serialized_output,
-                                         &src_addr_len, &error_code)) {
-      errno = EINVAL;
-      return -1;
-    }
-    *serialized_output_len = static_cast<bridge_size_t>(src_addr_len);
-    return ret;
-  } else {
-    return recvfrom(sockfd, *buf_ptr, len, flags, nullptr, nullptr);
+  if (!asylo::ToBridgeSockaddr(reinterpret_cast<struct sockaddr *>(&tmp),
+                               sizeof(tmp), src_addr)) {
+    errno = EINVAL;
+    return -1;
   }
+  return ret;
 }
 
 //////////////////////////////////////
@@ -543,46 +572,31 @@ int ocall_enc_untrusted_poll(struct bridge_pollfd *fds, unsigned int nfds,
 
 int ocall_enc_untrusted_epoll_create(int size) { return epoll_create(size); }
 
-int ocall_enc_untrusted_epoll_ctl(const char *serialized_args,
-                                  bridge_size_t serialized_args_len) {
-  std::string serialized_args_str(serialized_args,
-                                  static_cast<size_t>(serialized_args_len));
-  int epfd = 0;
-  int op = 0;
-  int hostfd = 0;
-  struct epoll_event event;
-  if (!asylo::DeserializeEpollCtlArgs(serialized_args_str, &epfd, &op, &hostfd,
-                                      &event)) {
+int ocall_enc_untrusted_epoll_ctl(int epfd, int op, int fd,
+                                  struct bridge_epoll_event *event) {
+  int host_op = asylo::FromBridgeEpollCtlOperation(op);
+  if (host_op < 0) {
     errno = EINVAL;
     return -1;
   }
-  return epoll_ctl(epfd, op, hostfd, &event);
+  struct epoll_event host_event;
+  return epoll_ctl(epfd, host_op, fd,
+                   asylo::FromBridgeEpollEvent(event, &host_event));
 }
 
-int ocall_enc_untrusted_epoll_wait(const char *serialized_args,
-                                   bridge_size_t serialized_args_len,
-                                   char **serialized_events,
-                                   bridge_size_t *serialized_events_len) {
-  int epfd = 0;
-  int maxevents = 0;
-  int timeout = 0;
-  std::string serialized_args_str(serialized_args,
-                                  static_cast<size_t>(serialized_args_len));
-  if (!asylo::DeserializeEpollWaitArgs(serialized_args_str, &epfd, &maxevents,
-                                       &timeout)) {
-    errno = EINVAL;
-    return -1;
+int ocall_enc_untrusted_epoll_wait(int epfd, struct bridge_epoll_event *events,
+                                   int maxevents, int timeout) {
+  static_assert(sizeof(struct bridge_epoll_event) == sizeof(struct epoll_event),
+                "bridge_epoll_event must match the host epoll_event layout");
+  // The host epoll_event has the same layout as bridge_epoll_event, so the
+  // events are written directly into |events| and translated in place.
+  struct epoll_event *host_events =
+      reinterpret_cast<struct epoll_event *>(events);
+  int ret = epoll_wait(epfd, host_events, maxevents, timeout);
+  for (int i = 0; i < ret; ++i) {
+    struct epoll_event host_event = host_events[i];
+    asylo::ToBridgeEpollEvent(&host_event, &events[i]);
   }
-  struct epoll_event *event_array = static_cast<struct epoll_event *>(
-      malloc(sizeof(struct epoll_event) * maxevents));
-  asylo::MallocUniquePtr<struct epoll_event> event_array_ptr(event_array);
-  int ret = epoll_wait(epfd, event_array, maxevents, timeout);
-  size_t len = 0;
-  if (!asylo::SerializeEvents(event_array, ret, serialized_events, &len)) {
-    errno = EINVAL;
-    return -1;
-  }
-  *serialized_events_len = static_cast<bridge_size_t>(len);
   return ret;
 }
 
@@ -595,52 +609,37 @@ int ocall_enc_untrusted_inotify_init1(int non_block) {
   return inotify_init1(flags);
 }
 
-int ocall_enc_untrusted_inotify_add_watch(const char *serialized_args,
-                                          bridge_size_t serialized_args_len) {
-  std::string serialized_args_str(serialized_args, serialized_args_len);
-  int fd = 0;
-  char *pathname = nullptr;
-  asylo::MallocUniquePtr<char> pathname_ptr(pathname);
-  uint32_t mask = 0;
-  if (!asylo::DeserializeInotifyAddWatchArgs(serialized_args_str, &fd,
-                                             &pathname, &mask)) {
-    errno = EINVAL;
-    return -1;
-  }
-  return inotify_add_watch(fd, pathname, mask);
+int ocall_enc_untrusted_inotify_add_watch(int fd, const char *pathname,
+                                          uint32_t mask) {
+  return inotify_add_watch(fd, pathname,
+                           asylo::FromBridgeInotifyEventMask(mask));
 }
 
-int ocall_enc_untrusted_inotify_rm_watch(const char *serialized_args,
-                                         bridge_size_t serialized_args_len) {
-  std::string serialized_args_str(serialized_args, serialized_args_len);
-  int fd = 0;
-  int wd = 0;
-  if (!asylo::DeserializeInotifyRmWatchArgs(serialized_args_str, &fd, &wd)) {
-    errno = EINVAL;
-    return -1;
-  }
+int ocall_enc_untrusted_inotify_rm_watch(int fd, int wd) {
   return inotify_rm_watch(fd, wd);
 }
 
-int ocall_enc_untrusted_inotify_read(int fd, bridge_size_t count,
-                                     char **serialized_events,
-                                     bridge_size_t *serialized_events_len) {
-  size_t buf_size =
-      std::max(sizeof(struct inotify_event) + NAME_MAX + 1, count);
-  char *buf = static_cast<char *>(malloc(buf_size));
-  asylo::MallocUniquePtr<char> buf_ptr(buf);
-  int bytes_read = read(fd, buf, buf_size);
+bridge_ssize_t ocall_enc_untrusted_inotify_read(int fd, char *buf,
+                                                bridge_size_t count) {
+  static_assert(
+      sizeof(struct bridge_inotify_event) == sizeof(struct inotify_event),
+      "bridge_inotify_event must match the host inotify_event layout");
+  ssize_t bytes_read = read(fd, buf, static_cast<size_t>(count));
   if (bytes_read < 0) {
     // Errno will be set by read.
     return -1;
   }
-  size_t len = 0;
-  if (!asylo::SerializeInotifyEvents(buf, bytes_read, serialized_events,
-                                     &len)) {
-    return -1;
-  }
-  *serialized_events_len = static_cast<bridge_size_t>(len);
-  return 0;
+  // The events are passed to the enclave as read, with only the masks
+  // translated to bridge values.
+  size_t offset = 0;
+  while (offset + sizeof(struct inotify_event) <=
+         static_cast<size_t>(bytes_read)) {
+    struct inotify_event *event =
+        reinterpret_cast<struct inotify_event *>(buf + offset);
+    event->mask = asylo::ToBridgeInotifyEventMask(event->mask);
+    offset += sizeof(struct inotify_event) + event->len;
+  }
+  return bytes_read;
 }
 
 //////////////////////////////////////
@@ -1246,6 +1245,38 @@ int ocall_enc_untrusted_release_shared_resource(SharedNameKind kind,
   return false;
 }
 
+bridge_ssize_t ocall_enc_untrusted_stream_read(void *channel, void *buf,
+                                               bridge_size_t count) {
+  auto *stream = reinterpret_cast<asylo::SgxStreamChannel *>(channel);
+  if (!stream->status.ok()) {
+    return -1;
+  }
+  if (!*stream->source) {
+    return 0;
+  }
+  asylo::StatusOr<size_t> result =
+      (*stream->source)(reinterpret_cast<char *>(buf), count);
+  if (!result.ok()) {
+    stream->status = result.status();
+    return -1;
+  }
+  if (result.ValueOrDie() > count) {
+    stream->status = asylo::Status(asylo::error::GoogleError::OUT_OF_RANGE,
+                                   "Stream source overran its buffer");
+    return -1;
+  }
+  return static_cast<bridge_ssize_t>(result.ValueOrDie());
+}
+
+int ocall_enc_untrusted_stream_write(void *channel, const void *buf,
+                                     bridge_size_t count) {
+  auto *stream = reinterpret_cast<asylo::SgxStreamChannel *>(channel);
+  if (*stream->output_sink) {
+    (*stream->output_sink)(asylo::ByteContainerView(buf, count));
+  }
+  return 0;
+}
+
 //////////////////////////////////////
 //           Debugging              //
 //////////////////////////////////////
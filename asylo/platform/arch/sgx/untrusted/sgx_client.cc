@@ -33,6 +33,7 @@
 #include "asylo/platform/primitives/sgx/untrusted_sgx.h"
 #include "asylo/platform/primitives/untrusted_primitives.h"
 #include "asylo/platform/primitives/util/dispatch_table.h"
+#include "asylo/util/cleanup.h"
 #include "asylo/util/elf_reader.h"
 #include "asylo/util/file_mapping.h"
 #include "asylo/util/posix_error_space.h"
@@ -97,6 +98,62 @@ static Status run(sgx_enclave_id_t eid, const char *input, size_t input_len,
   return Status::OkStatus();
 }
 
+// Enters the enclave and invokes the raw execution entry-point. If the ecall
+// fails, returns a non-OK status. Otherwise, |output| points to a buffer of
+// length *|output_len| that contains either the raw output of the enclave or,
+// if *|output_is_status| is set, a serialized StatusProto. An empty raw output
+// may leave |output| null.
+static Status run_raw(sgx_enclave_id_t eid, const char *input,
+                      size_t input_len, char **output, size_t *output_len,
+                      int *output_is_status) {
+  int result;
+  bridge_size_t bridge_output_len = 0;
+  sgx_status_t sgx_status = ecall_run_raw(
+      eid, &result, input, static_cast<bridge_size_t>(input_len), output,
+      &bridge_output_len, output_is_status);
+  if (output_len) {
+    *output_len = static_cast<size_t>(bridge_output_len);
+  }
+  if (sgx_status != SGX_SUCCESS) {
+    // Return a Status object in the SGX error space.
+    return Status(sgx_status, "Call to ecall_run_raw failed");
+  } else if (result || (*output_is_status && *output_len == 0)) {
+    // Ecall succeeded but did not return a value. This indicates that the
+    // trusted code failed to propagate error information over the enclave
+    // boundary.
+    return Status(error::GoogleError::INTERNAL, "No output from enclave");
+  }
+
+  return Status::OkStatus();
+}
+
+// Enters the enclave and invokes the streaming run entry-point, which exchanges
+// data with the host through |channel| until it returns. If the ecall fails, or
+// the enclave does not return any output, returns a non-OK status. Otherwise,
+// |output| points to a buffer of length *|output_len| that contains a
+// serialized StatusProto.
+static Status run_stream(sgx_enclave_id_t eid, SgxStreamChannel *channel,
+                         char **output, size_t *output_len) {
+  int result;
+  bridge_size_t bridge_output_len = 0;
+  sgx_status_t sgx_status =
+      ecall_run_stream(eid, &result, channel, output, &bridge_output_len);
+  if (output_len) {
+    *output_len = static_cast<size_t>(bridge_output_len);
+  }
+  if (sgx_status != SGX_SUCCESS) {
+    // Return a Status object in the SGX error space.
+    return Status(sgx_status, "Call to ecall_run_stream failed");
+  } else if (result || *output_len == 0) {
+    // Ecall succeeded but did not return a value. This indicates that the
+    // trusted code failed to propagate error information over the enclave
+    // boundary.
+    return Status(error::GoogleError::INTERNAL, "No output from enclave");
+  }
+
+  return Status::OkStatus();
+}
+
 // Enters the enclave and invokes the finalization entry-point. If the ecall
 // fails, or the enclave does not return any output, returns a non-OK status. In
 // this case, the caller cannot make any assumptions about the contents of
@@ -243,6 +300,13 @@ static Status transfer_secure_snapshot_key(sgx_enclave_id_t eid,
 StatusOr<std::unique_ptr<EnclaveClient>> SgxLoader::LoadEnclave(
     const std::string &name, void *base_address, const size_t enclave_size,
     const EnclaveConfig &config) const {
+  return LoadEnclave(name, base_address, enclave_size, config,
+                     /*trace=*/nullptr);
+}
+
+StatusOr<std::unique_ptr<EnclaveClient>> SgxLoader::LoadEnclave(
+    const std::string &name, void *base_address, const size_t enclave_size,
+    const EnclaveConfig &config, EnclaveLoadTrace *trace) const {
   std::unique_ptr<SgxClient> client = absl::make_unique<SgxClient>(name);
   std::shared_ptr<primitives::Client> primitive_client;
 
@@ -250,7 +314,7 @@ StatusOr<std::unique_ptr<EnclaveClient>> SgxLoader::LoadEnclave(
       primitive_client,
       primitives::LoadEnclave<primitives::SgxBackend>(
           base_address, enclave_path_, enclave_size, config, debug_,
-          absl::make_unique<primitives::DispatchTable>()));
+          absl::make_unique<primitives::DispatchTable>(), trace));
 
   client->Sync(primitive_client);
 
@@ -268,6 +332,13 @@ StatusOr<std::unique_ptr<EnclaveLoader>> SgxLoader::Copy() const {
 StatusOr<std::unique_ptr<EnclaveClient>> SgxEmbeddedLoader::LoadEnclave(
     const std::string &name, void *base_address, const size_t enclave_size,
     const EnclaveConfig &config) const {
+  return LoadEnclave(name, base_address, enclave_size, config,
+                     /*trace=*/nullptr);
+}
+
+StatusOr<std::unique_ptr<EnclaveClient>> SgxEmbeddedLoader::LoadEnclave(
+    const std::string &name, void *base_address, const size_t enclave_size,
+    const EnclaveConfig &config, EnclaveLoadTrace *trace) const {
   std::unique_ptr<SgxClient> client = absl::make_unique<SgxClient>(name);
   std::shared_ptr<primitives::Client> primitive_client;
 
@@ -275,7 +346,7 @@ StatusOr<std::unique_ptr<EnclaveClient>> SgxEmbeddedLoader::LoadEnclave(
       primitive_client,
       primitives::LoadEnclave<primitives::SgxEmbeddedBackend>(
           base_address, section_name_, enclave_size, config, debug_,
-          absl::make_unique<primitives::DispatchTable>()));
+          absl::make_unique<primitives::DispatchTable>(), trace));
   client->Sync(primitive_client);
 
   return std::unique_ptr<EnclaveClient>(std::move(client));
@@ -299,6 +370,11 @@ void SgxClient::Sync(std::shared_ptr<primitives::Client> primitive_client) {
 }
 
 Status SgxClient::EnterAndInitialize(const EnclaveConfig &config) {
+  return EnterAndInitialize(config, /*trace=*/nullptr);
+}
+
+Status SgxClient::EnterAndInitialize(const EnclaveConfig &config,
+                                     EnclaveLoadTrace *trace) {
   std::string buf;
   if (!config.SerializeToString(&buf)) {
     return Status(error::GoogleError::INVALID_ARGUMENT,
@@ -312,13 +388,16 @@ Status SgxClient::EnterAndInitialize(const EnclaveConfig &config) {
 
   // Enclave entry-point was successfully invoked. |output| is guaranteed to
   // have a value.
-  StatusProto status_proto;
-  if (!status_proto.ParseFromArray(output, output_len)) {
+  EnclaveInitializeOutput initialize_output;
+  if (!initialize_output.ParseFromArray(output, output_len)) {
     return Status(error::GoogleError::INTERNAL,
-                  "Failed to deserialize StatusProto");
+                  "Failed to deserialize EnclaveInitializeOutput");
   }
   Status status;
-  status.RestoreFrom(status_proto);
+  status.RestoreFrom(initialize_output.status());
+  if (trace) {
+    trace->MergeFrom(initialize_output.trace());
+  }
 
   // |output| points to an untrusted memory buffer allocated by the enclave. It
   // is the untrusted caller's responsibility to free this buffer.
@@ -360,6 +439,64 @@ Status SgxClient::EnterAndRun(const EnclaveInput &input,
   return status;
 }
 
+Status SgxClient::EnterAndRunRaw(ByteContainerView input,
+                                 const RawOutputSink &output_sink) {
+  char *output_buf = nullptr;
+  size_t output_len = 0;
+  int output_is_status = 0;
+  ASYLO_RETURN_IF_ERROR(
+      run_raw(id_, reinterpret_cast<const char *>(input.data()), input.size(),
+              &output_buf, &output_len, &output_is_status));
+
+  // |output_buf| points to a memory buffer allocated outside the enclave by
+  // the enclave. It is the caller's responsibility to free this buffer.
+  Cleanup free_output([output_buf] { free(output_buf); });
+
+  if (output_is_status) {
+    StatusProto status_proto;
+    if (!status_proto.ParseFromArray(output_buf, output_len)) {
+      return Status(error::GoogleError::INTERNAL,
+                    "Failed to deserialize StatusProto");
+    }
+    Status status;
+    status.RestoreFrom(status_proto);
+    return status;
+  }
+
+  // The sink reads the output in place, so it is not copied on the host.
+  if (output_sink) {
+    output_sink(ByteContainerView(output_buf, output_len));
+  }
+  return Status::OkStatus();
+}
+
+Status SgxClient::EnterAndRunStream(const StreamSource &source,
+                                    const RawOutputSink &output_sink) {
+  SgxStreamChannel channel = {&source, &output_sink, Status::OkStatus()};
+  char *output = nullptr;
+  size_t output_len = 0;
+  ASYLO_RETURN_IF_ERROR(run_stream(id_, &channel, &output, &output_len));
+
+  // |output| points to a memory buffer allocated outside the enclave by the
+  // enclave. It is the caller's responsibility to free this buffer.
+  Cleanup free_output([output] { free(output); });
+
+  // An error from the source is the root cause of whatever the enclave made
+  // of the truncated input.
+  if (!channel.status.ok()) {
+    return channel.status;
+  }
+
+  StatusProto status_proto;
+  if (!status_proto.ParseFromArray(output, output_len)) {
+    return Status(error::GoogleError::INTERNAL,
+                  "Failed to deserialize StatusProto");
+  }
+  Status status;
+  status.RestoreFrom(status_proto);
+  return status;
+}
+
 Status SgxClient::EnterAndFinalize(const EnclaveFinal &final_input) {
   std::string buf;
   if (!final_input.SerializeToString(&buf)) {
@@ -33,6 +33,18 @@
 
 namespace asylo {
 
+// The host end of a stream opened by SgxClient::EnterAndRunStream(). The
+// enclave passes its address back to the ocalls that read input from |source|
+// and write output to |output_sink|.
+struct SgxStreamChannel {
+  const EnclaveClient::StreamSource *source;
+  const EnclaveClient::RawOutputSink *output_sink;
+
+  // The first error returned by |source|, which is reported to the caller of
+  // EnterAndRunStream() in preference to the status returned by the enclave.
+  Status status;
+};
+
 /// Enclave client for Intel Software Guard Extensions (SGX) based enclaves.
 class SgxClient : public EnclaveClient {
  public:
@@ -41,6 +53,12 @@ class SgxClient : public EnclaveClient {
   explicit SgxClient(const std::string &name) : EnclaveClient(name) {}
   Status EnterAndRun(const EnclaveInput &input, EnclaveOutput *output) override;
 
+  using EnclaveClient::EnterAndRunRaw;
+  Status EnterAndRunRaw(ByteContainerView input,
+                        const RawOutputSink &output_sink) override;
+  Status EnterAndRunStream(const StreamSource &source,
+                           const RawOutputSink &output_sink) override;
+
   // Returns true when a TCS is active in simulation mode. Always returns false
   // in hardware mode, since TCS active/inactive state is only set and used in
   // simulation mode.
@@ -62,6 +80,8 @@ class SgxClient : public EnclaveClient {
   void Sync(std::shared_ptr<primitives::Client> primitive_client);
 
   Status EnterAndInitialize(const EnclaveConfig &config) override;
+  Status EnterAndInitialize(const EnclaveConfig &config,
+                            EnclaveLoadTrace *trace) override;
   Status EnterAndFinalize(const EnclaveFinal &final_input) override;
   Status EnterAndDonateThread() override;
   Status EnterAndHandleSignal(const EnclaveSignal &signal) override;
@@ -97,6 +117,9 @@ class SgxLoader : public EnclaveLoader {
   StatusOr<std::unique_ptr<EnclaveClient>> LoadEnclave(
       const std::string &name, void *base_address, const size_t enclave_size,
       const EnclaveConfig &config) const override;
+  StatusOr<std::unique_ptr<EnclaveClient>> LoadEnclave(
+      const std::string &name, void *base_address, const size_t enclave_size,
+      const EnclaveConfig &config, EnclaveLoadTrace *trace) const override;
 
   StatusOr<std::unique_ptr<EnclaveLoader>> Copy() const override;
 
@@ -121,6 +144,9 @@ class SgxEmbeddedLoader : public EnclaveLoader {
   StatusOr<std::unique_ptr<EnclaveClient>> LoadEnclave(
       const std::string &name, void *base_address, const size_t enclave_size,
       const EnclaveConfig &config) const override;
+  StatusOr<std::unique_ptr<EnclaveClient>> LoadEnclave(
+      const std::string &name, void *base_address, const size_t enclave_size,
+      const EnclaveConfig &config, EnclaveLoadTrace *trace) const override;
 
   StatusOr<std::unique_ptr<EnclaveLoader>> Copy() const override;
 
@@ -39,3 +39,9 @@ extern "C" ssize_t enc_hardware_random(uint8_t *buf, size_t count) {
   std::generate(&buf[0], &buf[count], ::rand);
   return count;
 }
+
+// Fills a buffer |buf| with |count| bytes from enc_hardware_random(), which is
+// no weaker than any other source available to the simulation backend.
+extern "C" ssize_t enc_hardware_random_seed(uint8_t *buf, size_t count) {
+  return enc_hardware_random(buf, count);
+}
@@ -0,0 +1,63 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_BENCHMARK_BENCHMARK_SELECTORS_H_
+#define ASYLO_PLATFORM_BENCHMARK_BENCHMARK_SELECTORS_H_
+
+#include <cstdint>
+
+#include "asylo/platform/primitives/primitives.h"
+
+namespace asylo {
+namespace benchmark {
+
+// Entry points registered by the transition benchmark enclave.
+
+// Returns a copy of the single item on the parameter stack.
+constexpr uint64_t kEchoSelector = primitives::kSelectorUser + 1;
+
+// Makes the number of untrusted calls to |kNoOpExitSelector| given by the
+// single int32_t on the parameter stack.
+constexpr uint64_t kUntrustedCallLoopSelector = primitives::kSelectorUser + 2;
+
+// Makes a number of host calls of one kind. The parameter stack holds, from
+// bottom to top, a path, a file descriptor, a BenchmarkHostCall and the number
+// of calls, and receives the number of calls that failed.
+constexpr uint64_t kHostCallLoopSelector = primitives::kSelectorUser + 3;
+
+// Exit points registered by the transition benchmark driver.
+
+// Does nothing.
+constexpr uint64_t kNoOpExitSelector = primitives::kSelectorUser + 1;
+
+// The host calls measured through |kHostCallLoopSelector|. Each goes through
+// enc_untrusted_syscall().
+enum class BenchmarkHostCall : int32_t {
+  kGetPid = 0,   // getpid()
+  kGetUid = 1,   // getuid()
+  kAccess = 2,   // access(path, F_OK)
+  kLseek = 3,    // lseek(fd, 0, SEEK_SET)
+  kFcntl = 4,    // fcntl(fd, F_GETFL)
+  kRead = 5,     // read(fd, buf, 64)
+  kWrite = 6,    // write(fd, buf, 64)
+};
+
+}  // namespace benchmark
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_BENCHMARK_BENCHMARK_SELECTORS_H_
@@ -0,0 +1,173 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/benchmark/benchmark_util.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "asylo/util/thread.h"
+
+namespace asylo {
+namespace benchmark {
+namespace {
+
+// The samples and outcome of the calls made by one thread.
+struct ThreadSamples {
+  std::vector<absl::Duration> latencies;
+  Status status;
+};
+
+// Makes the untimed and then the timed calls of one thread, waiting for |start|
+// in between so that the timed calls of all threads overlap.
+void RunThread(const BenchmarkOptions &options, int64_t operations_per_call,
+               const BenchmarkOperation &operation, absl::Mutex *mu,
+               int *ready_threads, const absl::Notification *start,
+               ThreadSamples *samples) {
+  for (int i = 0; i < options.warmup_iterations; ++i) {
+    samples->status = operation();
+    if (!samples->status.ok()) {
+      break;
+    }
+  }
+  {
+    absl::MutexLock lock(mu);
+    ++*ready_threads;
+  }
+  start->WaitForNotification();
+  if (!samples->status.ok()) {
+    return;
+  }
+
+  samples->latencies.reserve(options.iterations);
+  for (int i = 0; i < options.iterations; ++i) {
+    absl::Time call_start = absl::Now();
+    samples->status = operation();
+    absl::Duration latency = absl::Now() - call_start;
+    if (!samples->status.ok()) {
+      return;
+    }
+    samples->latencies.push_back(latency / operations_per_call);
+  }
+}
+
+// Returns the |quantile| of the sorted samples in |latencies|.
+absl::Duration Quantile(const std::vector<absl::Duration> &latencies,
+                        double quantile) {
+  size_t index = static_cast<size_t>(quantile * (latencies.size() - 1));
+  return latencies[index];
+}
+
+}  // namespace
+
+StatusOr<BenchmarkResult> RunBenchmark(const std::string &name,
+                                       const BenchmarkOptions &options,
+                                       int threads, int64_t operations_per_call,
+                                       const BenchmarkOperation &operation) {
+  if (threads < 1 || operations_per_call < 1) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "A benchmark needs at least one thread and one operation");
+  }
+
+  std::vector<ThreadSamples> samples(threads);
+  absl::Mutex mu;
+  int ready_threads = 0;
+  absl::Notification start;
+  std::vector<Thread> workers;
+  workers.reserve(threads);
+  for (int i = 0; i < threads; ++i) {
+    workers.emplace_back(RunThread, std::cref(options), operations_per_call,
+                         std::cref(operation), &mu, &ready_threads, &start,
+                         &samples[i]);
+  }
+
+  // Start the clock once every thread has warmed up.
+  {
+    absl::MutexLock lock(&mu);
+    auto all_ready = [&ready_threads, threads] {
+      return ready_threads == threads;
+    };
+    mu.Await(absl::Condition(&all_ready));
+  }
+  absl::Time start_time = absl::Now();
+  start.Notify();
+  for (Thread &worker : workers) {
+    worker.Join();
+  }
+
+  BenchmarkResult result;
+  result.name = name;
+  result.wall_time = absl::Now() - start_time;
+  for (ThreadSamples &thread_samples : samples) {
+    if (!thread_samples.status.ok()) {
+      return thread_samples.status;
+    }
+    result.latencies.insert(result.latencies.end(),
+                            thread_samples.latencies.begin(),
+                            thread_samples.latencies.end());
+  }
+  result.operations = result.latencies.size() * operations_per_call;
+  return result;
+}
+
+StatusOr<std::vector<int64_t>> ParseIntegerList(const std::string &list) {
+  std::vector<int64_t> values;
+  for (absl::string_view item : absl::StrSplit(list, ',', absl::SkipEmpty())) {
+    int64_t value;
+    if (!absl::SimpleAtoi(item, &value) || value < 0) {
+      return Status(error::GoogleError::INVALID_ARGUMENT,
+                    absl::StrCat("Invalid list item: ", item));
+    }
+    values.push_back(value);
+  }
+  return values;
+}
+
+void PrintReportHeader() {
+  printf("%-28s %10s %12s %12s %12s %12s %14s\n", "benchmark", "samples",
+         "mean", "p50", "p90", "p99", "ops/second");
+}
+
+void PrintReportRow(BenchmarkResult *result) {
+  std::vector<absl::Duration> &latencies = result->latencies;
+  if (latencies.empty()) {
+    printf("%-28s %10d\n", result->name.c_str(), 0);
+    return;
+  }
+  std::sort(latencies.begin(), latencies.end());
+  absl::Duration sum;
+  for (absl::Duration latency : latencies) {
+    sum += latency;
+  }
+  absl::Duration mean = sum / static_cast<int64_t>(latencies.size());
+  printf("%-28s %10zu %12s %12s %12s %12s %14.1f\n", result->name.c_str(),
+         latencies.size(), absl::FormatDuration(mean).c_str(),
+         absl::FormatDuration(Quantile(latencies, 0.5)).c_str(),
+         absl::FormatDuration(Quantile(latencies, 0.9)).c_str(),
+         absl::FormatDuration(Quantile(latencies, 0.99)).c_str(),
+         result->operations / absl::ToDoubleSeconds(result->wall_time));
+}
+
+}  // namespace benchmark
+}  // namespace asylo
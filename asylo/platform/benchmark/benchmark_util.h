@@ -0,0 +1,82 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_BENCHMARK_BENCHMARK_UTIL_H_
+#define ASYLO_PLATFORM_BENCHMARK_BENCHMARK_UTIL_H_
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+namespace benchmark {
+
+// The options shared by every benchmark in a run.
+struct BenchmarkOptions {
+  // The number of timed calls to the benchmarked operation, per thread.
+  int iterations;
+
+  // The number of untimed calls made before the timed calls, per thread.
+  int warmup_iterations;
+};
+
+// The outcome of one benchmark.
+struct BenchmarkResult {
+  std::string name;
+
+  // The latency of a single operation, one sample per timed call.
+  std::vector<absl::Duration> latencies;
+
+  // The number of operations performed by all timed calls.
+  int64_t operations;
+
+  // The wall time taken by all timed calls, across all threads.
+  absl::Duration wall_time;
+};
+
+// An operation to benchmark. A call may perform several operations, in which
+// case every sample is the mean latency of the operations in the call.
+using BenchmarkOperation = std::function<Status()>;
+
+// Runs |operation| on |threads| threads at once, each of which makes the calls
+// given by |options|. Each call performs |operations_per_call| operations.
+// Returns the first error returned by |operation|.
+StatusOr<BenchmarkResult> RunBenchmark(const std::string &name,
+                                       const BenchmarkOptions &options,
+                                       int threads, int64_t operations_per_call,
+                                       const BenchmarkOperation &operation);
+
+// Parses a comma-separated list of non-negative integers, as passed to the
+// list flags of a benchmark driver.
+StatusOr<std::vector<int64_t>> ParseIntegerList(const std::string &list);
+
+// Prints the header of the report table to standard output.
+void PrintReportHeader();
+
+// Prints |result| as a row of the report table to standard output.
+void PrintReportRow(BenchmarkResult *result);
+
+}  // namespace benchmark
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_BENCHMARK_BENCHMARK_UTIL_H_
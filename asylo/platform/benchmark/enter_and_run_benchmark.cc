@@ -0,0 +1,164 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Measures the latency of EnclaveClient entry points, which go through the
+// EnclaveManager and TrustedApplication rather than the bare primitives layer.
+// Usage:
+//
+//   enter_and_run_benchmark --enclave_path=<path> --iterations=10000
+//
+// Reports, one row per benchmark:
+//   enter_and_run/<size>      EnterAndRun() with a <size>-byte string in an
+//                             EnclaveInput extension, echoed back in an
+//                             EnclaveOutput extension.
+//   enter_and_run_raw/<size>  EnterAndRunRaw() echoing <size> bytes.
+//   enter_and_run_threads/<n> EnterAndRun() with an empty input, made by <n>
+//                             threads at once, where ops/second is the
+//                             aggregate throughput.
+//
+// The enclave may be built for SGX hardware or for SGX simulation; the
+// benchmark loads either.
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "asylo/client.h"
+#include "asylo/crypto/util/byte_container_view.h"
+#include "asylo/platform/benchmark/benchmark_util.h"
+#include "asylo/test/util/test_string.pb.h"
+#include "asylo/util/logging.h"
+#include "asylo/util/status.h"
+#include "asylo/util/status_macros.h"
+#include "gflags/gflags.h"
+
+DEFINE_string(enclave_path, "", "Path to the benchmark enclave binary");
+DEFINE_int32(iterations, 10000, "Number of timed calls per benchmark");
+DEFINE_int32(warmup_iterations, 100,
+             "Number of untimed calls made before each benchmark");
+DEFINE_string(payload_sizes, "0,64,1024,16384,262144,1048576",
+              "Comma-separated list of payload sizes, in bytes");
+DEFINE_string(threads, "1,2,4,8",
+              "Comma-separated list of thread counts for the scaling "
+              "benchmark");
+
+namespace asylo {
+namespace benchmark {
+namespace {
+
+constexpr char kEnclaveName[] = "enter_and_run_benchmark";
+
+// Runs |operation| and prints its report row.
+Status RunAndReport(const std::string &name, const BenchmarkOptions &options,
+                    int threads, const BenchmarkOperation &operation) {
+  BenchmarkResult result;
+  ASYLO_ASSIGN_OR_RETURN(
+      result, RunBenchmark(name, options, threads,
+                           /*operations_per_call=*/1, operation));
+  PrintReportRow(&result);
+  fflush(stdout);
+  return Status::OkStatus();
+}
+
+// Returns an operation that echoes |payload| through EnterAndRun().
+BenchmarkOperation EnterAndRunOperation(EnclaveClient *client,
+                                        const std::string &payload) {
+  return [client, &payload]() -> Status {
+    EnclaveInput input;
+    input.MutableExtension(enclave_input_test_string)
+        ->set_test_string(payload);
+    EnclaveOutput output;
+    ASYLO_RETURN_IF_ERROR(client->EnterAndRun(input, &output));
+    if (output.GetExtension(enclave_output_test_string).test_string().size() !=
+        payload.size()) {
+      return Status(error::GoogleError::INTERNAL, "Bad echo from enclave");
+    }
+    return Status::OkStatus();
+  };
+}
+
+// Returns an operation that echoes |payload| through EnterAndRunRaw().
+BenchmarkOperation EnterAndRunRawOperation(EnclaveClient *client,
+                                           const std::string &payload) {
+  return [client, &payload]() -> Status {
+    size_t output_size = 0;
+    ASYLO_RETURN_IF_ERROR(client->EnterAndRunRaw(
+        payload,
+        [&output_size](ByteContainerView output) {
+          output_size = output.size();
+        }));
+    if (output_size != payload.size()) {
+      return Status(error::GoogleError::INTERNAL, "Bad echo from enclave");
+    }
+    return Status::OkStatus();
+  };
+}
+
+Status RunBenchmarks() {
+  std::vector<int64_t> payload_sizes;
+  ASYLO_ASSIGN_OR_RETURN(payload_sizes, ParseIntegerList(FLAGS_payload_sizes));
+  std::vector<int64_t> thread_counts;
+  ASYLO_ASSIGN_OR_RETURN(thread_counts, ParseIntegerList(FLAGS_threads));
+
+  EnclaveManager::Configure(EnclaveManagerOptions());
+  EnclaveManager *manager;
+  ASYLO_ASSIGN_OR_RETURN(manager, EnclaveManager::Instance());
+  SgxLoader loader(FLAGS_enclave_path, /*debug=*/true);
+  ASYLO_RETURN_IF_ERROR(manager->LoadEnclave(kEnclaveName, loader));
+  EnclaveClient *client = manager->GetClient(kEnclaveName);
+
+  BenchmarkOptions options = {FLAGS_iterations, FLAGS_warmup_iterations};
+  printf("enclave=%s iterations=%d\n", FLAGS_enclave_path.c_str(),
+         FLAGS_iterations);
+  PrintReportHeader();
+
+  for (int64_t size : payload_sizes) {
+    std::string payload(size, 'x');
+    ASYLO_RETURN_IF_ERROR(RunAndReport(absl::StrCat("enter_and_run/", size),
+                                       options, /*threads=*/1,
+                                       EnterAndRunOperation(client, payload)));
+    ASYLO_RETURN_IF_ERROR(
+        RunAndReport(absl::StrCat("enter_and_run_raw/", size), options,
+                     /*threads=*/1, EnterAndRunRawOperation(client, payload)));
+  }
+
+  const std::string empty_payload;
+  for (int64_t threads : thread_counts) {
+    ASYLO_RETURN_IF_ERROR(
+        RunAndReport(absl::StrCat("enter_and_run_threads/", threads), options,
+                     threads, EnterAndRunOperation(client, empty_payload)));
+  }
+
+  return manager->DestroyEnclave(client, EnclaveFinal());
+}
+
+}  // namespace
+}  // namespace benchmark
+}  // namespace asylo
+
+int main(int argc, char *argv[]) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  asylo::Status status = asylo::benchmark::RunBenchmarks();
+  if (!status.ok()) {
+    LOG(ERROR) << status;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,58 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// TrustedApplication that echoes the payloads sent by enter_and_run_benchmark.
+
+#include <string>
+
+#include "asylo/crypto/util/byte_container_view.h"
+#include "asylo/test/util/test_string.pb.h"
+#include "asylo/trusted_application.h"
+#include "asylo/util/status.h"
+
+namespace asylo {
+namespace {
+
+class EnterAndRunBenchmarkEnclave : public TrustedApplication {
+ public:
+  EnterAndRunBenchmarkEnclave() = default;
+
+  // Copies the test string extension of |input| to |output|.
+  Status Run(const EnclaveInput &input, EnclaveOutput *output) override {
+    if (output) {
+      *output->MutableExtension(enclave_output_test_string) =
+          input.GetExtension(enclave_input_test_string);
+    }
+    return Status::OkStatus();
+  }
+
+  // Copies |input| to |output|.
+  Status RunRaw(ByteContainerView input, std::string *output) override {
+    output->assign(reinterpret_cast<const char *>(input.data()),
+                   input.size());
+    return Status::OkStatus();
+  }
+};
+
+}  // namespace
+
+TrustedApplication *BuildTrustedApplication() {
+  return new EnterAndRunBenchmarkEnclave;
+}
+
+}  // namespace asylo
@@ -0,0 +1,232 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Measures the latency of enclave transitions through the primitives layer on
+// the simulation backend. Usage:
+//
+//   transition_benchmark --iterations=10000 --payload_sizes=0,4096
+//
+// Reports, one row per benchmark:
+//   ecall/<size>         EnclaveCall() round trips carrying <size> bytes into
+//                        and back out of the enclave.
+//   untrusted_call       UntrustedCall() round trips with no parameters.
+//   host_call/<name>     System calls made through enc_untrusted_syscall().
+//   ecall_threads/<n>    Empty EnclaveCall() round trips made by <n> threads at
+//                        once, where ops/second is the aggregate throughput.
+//
+// Untrusted calls and host calls are made --batch at a time from a single
+// enclave entry, and reported per call.
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "asylo/platform/benchmark/benchmark_selectors.h"
+#include "asylo/platform/benchmark/benchmark_util.h"
+#include "asylo/platform/host_call/untrusted/host_call_handlers_initializer.h"
+#include "asylo/platform/primitives/sim/untrusted_sim.h"
+#include "asylo/platform/primitives/untrusted_primitives.h"
+#include "asylo/platform/primitives/util/dispatch_table.h"
+#include "asylo/platform/storage/utils/fd_closer.h"
+#include "asylo/util/logging.h"
+#include "asylo/util/posix_error_space.h"
+#include "asylo/util/status.h"
+#include "asylo/util/status_macros.h"
+#include "gflags/gflags.h"
+
+DEFINE_string(enclave_path, "", "Path to the simulation enclave binary");
+DEFINE_int32(iterations, 10000, "Number of timed calls per benchmark");
+DEFINE_int32(warmup_iterations, 100,
+             "Number of untimed calls made before each benchmark");
+DEFINE_string(payload_sizes, "0,64,1024,16384,262144,1048576",
+              "Comma-separated list of ecall payload sizes, in bytes");
+DEFINE_int32(batch, 100,
+             "Number of untrusted calls or host calls per enclave entry");
+DEFINE_string(threads, "1,2,4,8",
+              "Comma-separated list of thread counts for the scaling "
+              "benchmark");
+
+namespace asylo {
+namespace benchmark {
+namespace {
+
+using primitives::Client;
+using primitives::UntrustedParameterStack;
+
+// An exit handler that does nothing, for measuring bare untrusted calls.
+Status NoOpExitHandler(std::shared_ptr<Client> client, void *context,
+                       UntrustedParameterStack *params) {
+  return Status::OkStatus();
+}
+
+// Loads the benchmark enclave with the host call handlers and the no-op exit
+// handler registered.
+StatusOr<std::shared_ptr<Client>> LoadBenchmarkEnclave() {
+  std::unique_ptr<Client::ExitCallProvider> exit_call_provider;
+  ASYLO_ASSIGN_OR_RETURN(exit_call_provider,
+                         host_call::GetHostCallHandlersMapping());
+  ASYLO_RETURN_IF_ERROR(exit_call_provider->RegisterExitHandler(
+      kNoOpExitSelector, primitives::ExitHandler{NoOpExitHandler}));
+  return primitives::LoadEnclave<primitives::SimBackend>(
+      FLAGS_enclave_path, std::move(exit_call_provider));
+}
+
+// Runs |operation| and prints its report row.
+Status RunAndReport(const std::string &name, const BenchmarkOptions &options,
+                    int threads, int64_t operations_per_call,
+                    const BenchmarkOperation &operation) {
+  BenchmarkResult result;
+  ASYLO_ASSIGN_OR_RETURN(result, RunBenchmark(name, options, threads,
+                                              operations_per_call, operation));
+  PrintReportRow(&result);
+  fflush(stdout);
+  return Status::OkStatus();
+}
+
+// Returns an operation that echoes |payload| through the enclave.
+BenchmarkOperation EchoOperation(const std::shared_ptr<Client> &client,
+                                 const std::string &payload) {
+  return [client, &payload]() -> Status {
+    UntrustedParameterStack params;
+    params.PushByReference(primitives::Extent{
+        const_cast<char *>(payload.data()), payload.size()});
+    ASYLO_RETURN_IF_ERROR(client->EnclaveCall(kEchoSelector, &params));
+    if (params.size() != 1 || params.Pop()->size() != payload.size()) {
+      return Status(error::GoogleError::INTERNAL, "Bad echo from enclave");
+    }
+    return Status::OkStatus();
+  };
+}
+
+// Returns an operation that makes |calls| host calls of kind |host_call| from
+// one enclave entry.
+BenchmarkOperation HostCallOperation(const std::shared_ptr<Client> &client,
+                                     BenchmarkHostCall host_call, int fd,
+                                     const std::string &path, int32_t calls) {
+  return [client, host_call, fd, &path, calls]() -> Status {
+    UntrustedParameterStack params;
+    params.PushByCopy<char>(path.c_str(), path.size() + 1);
+    *params.PushAlloc<int32_t>() = fd;
+    *params.PushAlloc<int32_t>() = static_cast<int32_t>(host_call);
+    *params.PushAlloc<int32_t>() = calls;
+    ASYLO_RETURN_IF_ERROR(client->EnclaveCall(kHostCallLoopSelector, &params));
+    if (params.size() != 1 || params.Pop<int32_t>() != 0) {
+      return Status(error::GoogleError::INTERNAL, "Host call failed");
+    }
+    return Status::OkStatus();
+  };
+}
+
+Status RunBenchmarks() {
+  std::vector<int64_t> payload_sizes;
+  ASYLO_ASSIGN_OR_RETURN(payload_sizes, ParseIntegerList(FLAGS_payload_sizes));
+  std::vector<int64_t> thread_counts;
+  ASYLO_ASSIGN_OR_RETURN(thread_counts, ParseIntegerList(FLAGS_threads));
+  if (FLAGS_batch < 1) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "--batch must be positive");
+  }
+
+  std::shared_ptr<Client> client;
+  ASYLO_ASSIGN_OR_RETURN(client, LoadBenchmarkEnclave());
+
+  BenchmarkOptions options = {FLAGS_iterations, FLAGS_warmup_iterations};
+  printf("backend=sim iterations=%d batch=%d\n", FLAGS_iterations,
+         FLAGS_batch);
+  PrintReportHeader();
+
+  for (int64_t size : payload_sizes) {
+    std::string payload(size, 'x');
+    ASYLO_RETURN_IF_ERROR(RunAndReport(absl::StrCat("ecall/", size), options,
+                                       /*threads=*/1, /*operations_per_call=*/1,
+                                       EchoOperation(client, payload)));
+  }
+
+  const int32_t batch = FLAGS_batch;
+  ASYLO_RETURN_IF_ERROR(RunAndReport(
+      "untrusted_call", options, /*threads=*/1, batch, [client, batch] {
+        UntrustedParameterStack params;
+        *params.PushAlloc<int32_t>() = batch;
+        return client->EnclaveCall(kUntrustedCallLoopSelector, &params);
+      }));
+
+  // Reads and seeks go to /dev/zero and writes to /dev/null, so that every host
+  // call does the same work on every iteration.
+  const std::string path = "/dev/null";
+  int read_fd = open("/dev/zero", O_RDONLY);
+  platform::storage::FdCloser read_fd_closer(read_fd);
+  int write_fd = open(path.c_str(), O_WRONLY);
+  platform::storage::FdCloser write_fd_closer(write_fd);
+  if (read_fd < 0 || write_fd < 0) {
+    return Status(static_cast<error::PosixError>(errno),
+                  "Failed to open /dev/zero or /dev/null");
+  }
+  struct HostCallBenchmark {
+    const char *name;
+    BenchmarkHostCall host_call;
+    int fd;
+  };
+  const HostCallBenchmark host_call_benchmarks[] = {
+      {"getpid", BenchmarkHostCall::kGetPid, -1},
+      {"getuid", BenchmarkHostCall::kGetUid, -1},
+      {"access", BenchmarkHostCall::kAccess, -1},
+      {"lseek", BenchmarkHostCall::kLseek, read_fd},
+      {"fcntl", BenchmarkHostCall::kFcntl, read_fd},
+      {"read", BenchmarkHostCall::kRead, read_fd},
+      {"write", BenchmarkHostCall::kWrite, write_fd},
+  };
+  for (const HostCallBenchmark &benchmark : host_call_benchmarks) {
+    ASYLO_RETURN_IF_ERROR(RunAndReport(
+        absl::StrCat("host_call/", benchmark.name), options, /*threads=*/1,
+        batch,
+        HostCallOperation(client, benchmark.host_call, benchmark.fd, path,
+                          batch)));
+  }
+
+  const std::string empty_payload;
+  for (int64_t threads : thread_counts) {
+    ASYLO_RETURN_IF_ERROR(
+        RunAndReport(absl::StrCat("ecall_threads/", threads), options, threads,
+                     /*operations_per_call=*/1,
+                     EchoOperation(client, empty_payload)));
+  }
+
+  return client->Destroy();
+}
+
+}  // namespace
+}  // namespace benchmark
+}  // namespace asylo
+
+int main(int argc, char *argv[]) {
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  asylo::Status status = asylo::benchmark::RunBenchmarks();
+  if (!status.ok()) {
+    LOG(ERROR) << status;
+    return 1;
+  }
+  return 0;
+}
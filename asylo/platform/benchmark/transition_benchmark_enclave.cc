@@ -0,0 +1,140 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Primitives enclave that makes the enclave transitions measured by
+// transition_benchmark.
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+
+#include "asylo/platform/benchmark/benchmark_selectors.h"
+#include "asylo/platform/host_call/trusted/host_call_dispatcher.h"
+#include "asylo/platform/host_call/trusted/host_calls.h"
+#include "asylo/platform/primitives/parameter_stack.h"
+#include "asylo/platform/primitives/primitive_status.h"
+#include "asylo/platform/primitives/trusted_primitives.h"
+#include "asylo/platform/system_call/system_call.h"
+#include "asylo/util/status_macros.h"
+
+namespace asylo {
+namespace benchmark {
+namespace {
+
+using primitives::PrimitiveStatus;
+using primitives::TrustedParameterStack;
+using primitives::TrustedPrimitives;
+
+// The number of bytes moved by each read and write host call.
+constexpr size_t kHostCallBufferSize = 64;
+
+// Copies the only item on the parameter stack into a new item of the same
+// size, so the payload crosses the enclave boundary in both directions.
+PrimitiveStatus Echo(void *context, TrustedParameterStack *params) {
+  ASYLO_RETURN_IF_INCORRECT_ARGUMENTS(params, 1);
+  const auto input = params->Pop();
+  auto output = params->PushAlloc(input->size());
+  memcpy(output.data(), input->data(), input->size());
+  return PrimitiveStatus::OkStatus();
+}
+
+// Makes the requested number of untrusted calls, each with an empty parameter
+// stack.
+PrimitiveStatus UntrustedCallLoop(void *context,
+                                  TrustedParameterStack *params) {
+  ASYLO_RETURN_IF_INCORRECT_ARGUMENTS(params, 1);
+  const int32_t calls = params->Pop<int32_t>();
+  for (int32_t i = 0; i < calls; ++i) {
+    TrustedParameterStack exit_params;
+    ASYLO_RETURN_IF_ERROR(
+        TrustedPrimitives::UntrustedCall(kNoOpExitSelector, &exit_params));
+  }
+  return PrimitiveStatus::OkStatus();
+}
+
+// Makes the requested number of host calls of one kind, and returns how many
+// of them failed.
+PrimitiveStatus HostCallLoop(void *context, TrustedParameterStack *params) {
+  ASYLO_RETURN_IF_INCORRECT_ARGUMENTS(params, 4);
+  const int32_t calls = params->Pop<int32_t>();
+  const auto host_call = static_cast<BenchmarkHostCall>(params->Pop<int32_t>());
+  const int fd = params->Pop<int32_t>();
+  const auto path = params->Pop();
+
+  char buffer[kHostCallBufferSize] = {};
+  int32_t failures = 0;
+  for (int32_t i = 0; i < calls; ++i) {
+    int64_t result;
+    switch (host_call) {
+      case BenchmarkHostCall::kGetPid:
+        result = enc_untrusted_getpid();
+        break;
+      case BenchmarkHostCall::kGetUid:
+        result = enc_untrusted_getuid();
+        break;
+      case BenchmarkHostCall::kAccess:
+        result = enc_untrusted_access(path->As<char>(), F_OK);
+        break;
+      case BenchmarkHostCall::kLseek:
+        result = enc_untrusted_lseek(fd, 0, SEEK_SET);
+        break;
+      case BenchmarkHostCall::kFcntl:
+        result = enc_untrusted_fcntl(fd, F_GETFL, 0);
+        break;
+      case BenchmarkHostCall::kRead:
+        result = enc_untrusted_read(fd, buffer, sizeof(buffer));
+        break;
+      case BenchmarkHostCall::kWrite:
+        result = enc_untrusted_write(fd, buffer, sizeof(buffer));
+        break;
+      default:
+        return {error::GoogleError::INVALID_ARGUMENT, "Unknown host call"};
+    }
+    if (result < 0) {
+      ++failures;
+    }
+  }
+  *params->PushAlloc<int32_t>() = failures;
+  return PrimitiveStatus::OkStatus();
+}
+
+}  // namespace
+
+// Implements the required enclave initialization function.
+extern "C" PrimitiveStatus asylo_enclave_init() {
+  // Register the host call dispatcher.
+  enc_set_dispatch_syscall(host_call::HostCallDispatcher);
+
+  ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
+      kEchoSelector, primitives::EntryHandler{Echo}));
+  ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
+      kUntrustedCallLoopSelector, primitives::EntryHandler{UntrustedCallLoop}));
+  ASYLO_RETURN_IF_ERROR(TrustedPrimitives::RegisterEntryHandler(
+      kHostCallLoopSelector, primitives::EntryHandler{HostCallLoop}));
+  return PrimitiveStatus::OkStatus();
+}
+
+// Implements the required enclave finalization function.
+extern "C" PrimitiveStatus asylo_enclave_fini() {
+  return PrimitiveStatus::OkStatus();
+}
+
+}  // namespace benchmark
+}  // namespace asylo
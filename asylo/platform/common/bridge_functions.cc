@@ -32,6 +32,8 @@
 #include <netdb.h>
 #include <netinet/in.h>
 #include <poll.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -1053,6 +1055,110 @@ struct bridge_pollfd *ToBridgePollfd(const struct pollfd *fd,
   return bridge_fd;
 }
 
+struct epoll_event *FromBridgeEpollEvent(
+    const struct bridge_epoll_event *bridge_event, struct epoll_event *event) {
+  if (!bridge_event || !event) return nullptr;
+  uint32_t bridge_events = bridge_event->events;
+  event->events = 0;
+  if (bridge_events & BRIDGE_EPOLLIN) event->events |= EPOLLIN;
+  if (bridge_events & BRIDGE_EPOLLPRI) event->events |= EPOLLPRI;
+  if (bridge_events & BRIDGE_EPOLLOUT) event->events |= EPOLLOUT;
+  if (bridge_events & BRIDGE_EPOLLMSG) event->events |= EPOLLMSG;
+  if (bridge_events & BRIDGE_EPOLLERR) event->events |= EPOLLERR;
+  if (bridge_events & BRIDGE_EPOLLHUP) event->events |= EPOLLHUP;
+  if (bridge_events & BRIDGE_EPOLLRDHUP) event->events |= EPOLLRDHUP;
+  if (bridge_events & BRIDGE_EPOLLWAKEUP) event->events |= EPOLLWAKEUP;
+  if (bridge_events & BRIDGE_EPOLLONESHOT) event->events |= EPOLLONESHOT;
+  if (bridge_events & BRIDGE_EPOLLET) event->events |= EPOLLET;
+  event->data.u64 = bridge_event->data;
+  return event;
+}
+
+struct bridge_epoll_event *ToBridgeEpollEvent(
+    const struct epoll_event *event, struct bridge_epoll_event *bridge_event) {
+  if (!event || !bridge_event) return nullptr;
+  uint32_t events = event->events;
+  bridge_event->events = 0;
+  if (events & EPOLLIN) bridge_event->events |= BRIDGE_EPOLLIN;
+  if (events & EPOLLPRI) bridge_event->events |= BRIDGE_EPOLLPRI;
+  if (events & EPOLLOUT) bridge_event->events |= BRIDGE_EPOLLOUT;
+  if (events & EPOLLMSG) bridge_event->events |= BRIDGE_EPOLLMSG;
+  if (events & EPOLLERR) bridge_event->events |= BRIDGE_EPOLLERR;
+  if (events & EPOLLHUP) bridge_event->events |= BRIDGE_EPOLLHUP;
+  if (events & EPOLLRDHUP) bridge_event->events |= BRIDGE_EPOLLRDHUP;
+  if (events & EPOLLWAKEUP) bridge_event->events |= BRIDGE_EPOLLWAKEUP;
+  if (events & EPOLLONESHOT) bridge_event->events |= BRIDGE_EPOLLONESHOT;
+  if (events & EPOLLET) bridge_event->events |= BRIDGE_EPOLLET;
+  bridge_event->data = event->data.u64;
+  return bridge_event;
+}
+
+int FromBridgeEpollCtlOperation(int bridge_op) {
+  if (bridge_op == BRIDGE_EPOLL_CTL_ADD) return EPOLL_CTL_ADD;
+  if (bridge_op == BRIDGE_EPOLL_CTL_DEL) return EPOLL_CTL_DEL;
+  if (bridge_op == BRIDGE_EPOLL_CTL_MOD) return EPOLL_CTL_MOD;
+  return -1;
+}
+
+int ToBridgeEpollCtlOperation(int op) {
+  if (op == EPOLL_CTL_ADD) return BRIDGE_EPOLL_CTL_ADD;
+  if (op == EPOLL_CTL_DEL) return BRIDGE_EPOLL_CTL_DEL;
+  if (op == EPOLL_CTL_MOD) return BRIDGE_EPOLL_CTL_MOD;
+  return BRIDGE_EPOLL_CTL_UNSUPPORTED;
+}
+
+uint32_t FromBridgeInotifyEventMask(uint32_t bridge_mask) {
+  uint32_t mask = 0;
+  if (bridge_mask & BRIDGE_IN_ACCESS) mask |= IN_ACCESS;
+  if (bridge_mask & BRIDGE_IN_ATTRIB) mask |= IN_ATTRIB;
+  if (bridge_mask & BRIDGE_IN_CLOSE_WRITE) mask |= IN_CLOSE_WRITE;
+  if (bridge_mask & BRIDGE_IN_CLOSE_NOWRITE) mask |= IN_CLOSE_NOWRITE;
+  if (bridge_mask & BRIDGE_IN_CREATE) mask |= IN_CREATE;
+  if (bridge_mask & BRIDGE_IN_DELETE) mask |= IN_DELETE;
+  if (bridge_mask & BRIDGE_IN_DELETE_SELF) mask |= IN_DELETE_SELF;
+  if (bridge_mask & BRIDGE_IN_MODIFY) mask |= IN_MODIFY;
+  if (bridge_mask & BRIDGE_IN_MOVE_SELF) mask |= IN_MOVE_SELF;
+  if (bridge_mask & BRIDGE_IN_MOVED_FROM) mask |= IN_MOVED_FROM;
+  if (bridge_mask & BRIDGE_IN_MOVED_TO) mask |= IN_MOVED_TO;
+  if (bridge_mask & BRIDGE_IN_OPEN) mask |= IN_OPEN;
+  if (bridge_mask & BRIDGE_IN_DONT_FOLLOW) mask |= IN_DONT_FOLLOW;
+  if (bridge_mask & BRIDGE_IN_EXCL_UNLINK) mask |= IN_EXCL_UNLINK;
+  if (bridge_mask & BRIDGE_IN_MASK_ADD) mask |= IN_MASK_ADD;
+  if (bridge_mask & BRIDGE_IN_ONESHOT) mask |= IN_ONESHOT;
+  if (bridge_mask & BRIDGE_IN_ONLYDIR) mask |= IN_ONLYDIR;
+  if (bridge_mask & BRIDGE_IN_IGNORED) mask |= IN_IGNORED;
+  if (bridge_mask & BRIDGE_IN_ISDIR) mask |= IN_ISDIR;
+  if (bridge_mask & BRIDGE_IN_Q_OVERFLOW) mask |= IN_Q_OVERFLOW;
+  if (bridge_mask & BRIDGE_IN_UNMOUNT) mask |= IN_UNMOUNT;
+  return mask;
+}
+
+uint32_t ToBridgeInotifyEventMask(uint32_t mask) {
+  uint32_t bridge_mask = 0;
+  if (mask & IN_ACCESS) bridge_mask |= BRIDGE_IN_ACCESS;
+  if (mask & IN_ATTRIB) bridge_mask |= BRIDGE_IN_ATTRIB;
+  if (mask & IN_CLOSE_WRITE) bridge_mask |= BRIDGE_IN_CLOSE_WRITE;
+  if (mask & IN_CLOSE_NOWRITE) bridge_mask |= BRIDGE_IN_CLOSE_NOWRITE;
+  if (mask & IN_CREATE) bridge_mask |= BRIDGE_IN_CREATE;
+  if (mask & IN_DELETE) bridge_mask |= BRIDGE_IN_DELETE;
+  if (mask & IN_DELETE_SELF) bridge_mask |= BRIDGE_IN_DELETE_SELF;
+  if (mask & IN_MODIFY) bridge_mask |= BRIDGE_IN_MODIFY;
+  if (mask & IN_MOVE_SELF) bridge_mask |= BRIDGE_IN_MOVE_SELF;
+  if (mask & IN_MOVED_FROM) bridge_mask |= BRIDGE_IN_MOVED_FROM;
+  if (mask & IN_MOVED_TO) bridge_mask |= BRIDGE_IN_MOVED_TO;
+  if (mask & IN_OPEN) bridge_mask |= BRIDGE_IN_OPEN;
+  if (mask & IN_DONT_FOLLOW) bridge_mask |= BRIDGE_IN_DONT_FOLLOW;
+  if (mask & IN_EXCL_UNLINK) bridge_mask |= BRIDGE_IN_EXCL_UNLINK;
+  if (mask & IN_MASK_ADD) bridge_mask |= BRIDGE_IN_MASK_ADD;
+  if (mask & IN_ONESHOT) bridge_mask |= BRIDGE_IN_ONESHOT;
+  if (mask & IN_ONLYDIR) bridge_mask |= BRIDGE_IN_ONLYDIR;
+  if (mask & IN_IGNORED) bridge_mask |= BRIDGE_IN_IGNORED;
+  if (mask & IN_ISDIR) bridge_mask |= BRIDGE_IN_ISDIR;
+  if (mask & IN_Q_OVERFLOW) bridge_mask |= BRIDGE_IN_Q_OVERFLOW;
+  if (mask & IN_UNMOUNT) bridge_mask |= BRIDGE_IN_UNMOUNT;
+  return bridge_mask;
+}
+
 struct msghdr *FromBridgeMsgHdr(const struct bridge_msghdr *bridge_msg,
                                 struct msghdr *msg) {
   if (!bridge_msg || !msg) return nullptr;
@@ -1079,26 +1185,6 @@ struct bridge_msghdr *ToBridgeMsgHdr(const struct msghdr *msg,
   return bridge_msg;
 }
 
-struct msghdr *FromBridgeIovecArray(const struct bridge_msghdr *bridge_msg,
-                                    struct msghdr *msg) {
-  if (!bridge_msg || !msg) return nullptr;
-  for (uint64_t i = 0; i < bridge_msg->msg_iovlen; ++i) {
-    memcpy(msg->msg_iov[i].iov_base, bridge_msg->msg_iov[i].iov_base,
-           bridge_msg->msg_iov[i].iov_len);
-  }
-  return msg;
-}
-
-struct bridge_msghdr *ToBridgeIovecArray(const struct msghdr *msg,
-                                         struct bridge_msghdr *bridge_msg) {
-  if (!msg || !bridge_msg) return nullptr;
-  for (uint64_t i = 0; i < msg->msg_iovlen; ++i) {
-    memcpy(bridge_msg->msg_iov[i].iov_base, msg->msg_iov[i].iov_base,
-           msg->msg_iov[i].iov_len);
-  }
-  return bridge_msg;
-}
-
 struct iovec *FromBridgeIovec(const struct bridge_iovec *bridge_iov,
                               struct iovec *iov) {
   if (!bridge_iov || !iov) return nullptr;
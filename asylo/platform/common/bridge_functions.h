@@ -22,6 +22,8 @@
 #include <netdb.h>
 #include <netinet/tcp.h>
 #include <poll.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
 #include <sys/resource.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
@@ -286,6 +288,29 @@ struct pollfd *FromBridgePollfd(const struct bridge_pollfd *bridge_fd,
 struct bridge_pollfd *ToBridgePollfd(const struct pollfd *fd,
                                      struct bridge_pollfd *bridge_fd);
 
+// Converts |bridge_event| to a runtime epoll_event. Returns nullptr if
+// unsuccessful.
+struct epoll_event *FromBridgeEpollEvent(
+    const struct bridge_epoll_event *bridge_event, struct epoll_event *event);
+
+// Converts |event| to a bridge epoll_event. Returns nullptr if unsuccessful.
+struct bridge_epoll_event *ToBridgeEpollEvent(
+    const struct epoll_event *event, struct bridge_epoll_event *bridge_event);
+
+// Converts |bridge_op| to a runtime epoll_ctl operation. Returns -1 if
+// |bridge_op| is not supported.
+int FromBridgeEpollCtlOperation(int bridge_op);
+
+// Converts |op| to a bridge epoll_ctl operation. Returns
+// BRIDGE_EPOLL_CTL_UNSUPPORTED if |op| is not supported.
+int ToBridgeEpollCtlOperation(int op);
+
+// Converts |bridge_mask| to a runtime inotify event mask.
+uint32_t FromBridgeInotifyEventMask(uint32_t bridge_mask);
+
+// Converts |mask| to a bridge inotify event mask.
+uint32_t ToBridgeInotifyEventMask(uint32_t mask);
+
 // Converts |bridge_msg| to a runtime msghdr. This only does a shallow copy of
 // the pointers. A deep copy of the |iovec| array is done in a helper class
 // |BridgeMsghdrWrapper| in host_calls. Returns nullptr if unsuccessful.
@@ -298,18 +323,6 @@ struct msghdr *FromBridgeMsgHdr(const struct bridge_msghdr *bridge_msg,
 struct bridge_msghdr *ToBridgeMsgHdr(const struct msghdr *msg,
                                      struct bridge_msghdr *bridge_msg);
 
-// Copies all the iovec buffers from |bridge_msg| to |msg|. This conversion does
-// not allocate memory, just copies data to already allocated memory. Returns
-// nullptr if unsuccessful.
-struct msghdr *FromBridgeIovecArray(const struct bridge_msghdr *bridge_msg,
-                                    struct msghdr *msg);
-
-// Copies all the iovec buffers from |msg| to |bridge_msg|. This conversion does
-// not allocate memory, just copies data to already allocated memory. Returns
-// nullptr is unsuccessful.
-struct bridge_msghdr *ToBridgeIovecArray(const struct msghdr *msg,
-                                         struct bridge_msghdr *bridge_msg);
-
 // Converts |bridge_iov| to a runtime iovec. Returns nullptr if unsuccessful.
 struct iovec *FromBridgeIovec(const struct bridge_iovec *bridge_iov,
                               struct iovec *iov);
@@ -20,6 +20,8 @@
 
 #include <fcntl.h>
 #include <netdb.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <syslog.h>
@@ -342,6 +344,102 @@ TEST_F(BridgeTest, BridgeAfFamilyTest) {
               to_matcher);
 }
 
+TEST_F(BridgeTest, BridgeEpollEventsTest) {
+  intvec from_bits = {BRIDGE_EPOLLIN,      BRIDGE_EPOLLPRI,   BRIDGE_EPOLLOUT,
+                      BRIDGE_EPOLLMSG,     BRIDGE_EPOLLERR,   BRIDGE_EPOLLHUP,
+                      BRIDGE_EPOLLRDHUP,   BRIDGE_EPOLLWAKEUP,
+                      BRIDGE_EPOLLONESHOT, BRIDGE_EPOLLET};
+  intvec to_bits = {EPOLLIN,     EPOLLPRI,    EPOLLOUT,     EPOLLMSG,
+                    EPOLLERR,    EPOLLHUP,    EPOLLRDHUP,   EPOLLWAKEUP,
+                    EPOLLONESHOT, static_cast<int>(EPOLLET)};
+  std::function<int(int)> from_events = [](int bridge_events) {
+    struct bridge_epoll_event bridge_event;
+    bridge_event.events = static_cast<uint32_t>(bridge_events);
+    bridge_event.data = 0;
+    struct epoll_event event;
+    FromBridgeEpollEvent(&bridge_event, &event);
+    return static_cast<int>(event.events);
+  };
+  std::function<int(int)> to_events = [](int events) {
+    struct epoll_event event;
+    event.events = static_cast<uint32_t>(events);
+    event.data.u64 = 0;
+    struct bridge_epoll_event bridge_event;
+    ToBridgeEpollEvent(&event, &bridge_event);
+    return static_cast<int>(bridge_event.events);
+  };
+  auto from_matcher = IsFiniteRestrictionOf<int, int>(from_events);
+  EXPECT_THAT(FuzzBitsetTranslationFunction(from_bits, to_bits, ITER_BOUND),
+              from_matcher);
+  auto to_matcher = IsFiniteRestrictionOf<int, int>(to_events);
+  EXPECT_THAT(FuzzBitsetTranslationFunction(to_bits, from_bits, ITER_BOUND),
+              to_matcher);
+}
+
+TEST_F(BridgeTest, BridgeEpollEventDataTest) {
+  struct epoll_event event;
+  event.events = EPOLLIN;
+  event.data.u64 = 0x0123456789abcdef;
+  struct bridge_epoll_event bridge_event;
+  ASSERT_NE(ToBridgeEpollEvent(&event, &bridge_event), nullptr);
+  EXPECT_EQ(bridge_event.data, event.data.u64);
+
+  struct epoll_event converted;
+  ASSERT_NE(FromBridgeEpollEvent(&bridge_event, &converted), nullptr);
+  EXPECT_EQ(converted.events, event.events);
+  EXPECT_EQ(converted.data.u64, event.data.u64);
+
+  EXPECT_EQ(ToBridgeEpollEvent(nullptr, &bridge_event), nullptr);
+  EXPECT_EQ(FromBridgeEpollEvent(&bridge_event, nullptr), nullptr);
+}
+
+TEST_F(BridgeTest, BridgeEpollCtlOperationTest) {
+  intvec from_consts = {BRIDGE_EPOLL_CTL_ADD, BRIDGE_EPOLL_CTL_DEL,
+                        BRIDGE_EPOLL_CTL_MOD};
+  intvec to_consts = {EPOLL_CTL_ADD, EPOLL_CTL_DEL, EPOLL_CTL_MOD};
+  auto from_matcher =
+      IsFiniteRestrictionOf<int, int>(FromBridgeEpollCtlOperation);
+  EXPECT_THAT(
+      FuzzFiniteFunctionWithFallback(from_consts, to_consts, -1, ITER_BOUND),
+      from_matcher);
+  auto to_matcher = IsFiniteRestrictionOf<int, int>(ToBridgeEpollCtlOperation);
+  EXPECT_THAT(FuzzFiniteFunctionWithFallback(
+                  to_consts, from_consts,
+                  static_cast<int>(BRIDGE_EPOLL_CTL_UNSUPPORTED), ITER_BOUND),
+              to_matcher);
+}
+
+TEST_F(BridgeTest, BridgeInotifyEventMaskTest) {
+  intvec from_bits = {
+      BRIDGE_IN_ACCESS,        BRIDGE_IN_ATTRIB,      BRIDGE_IN_CLOSE_WRITE,
+      BRIDGE_IN_CLOSE_NOWRITE, BRIDGE_IN_CREATE,      BRIDGE_IN_DELETE,
+      BRIDGE_IN_DELETE_SELF,   BRIDGE_IN_MODIFY,      BRIDGE_IN_MOVE_SELF,
+      BRIDGE_IN_MOVED_FROM,    BRIDGE_IN_MOVED_TO,    BRIDGE_IN_OPEN,
+      BRIDGE_IN_DONT_FOLLOW,   BRIDGE_IN_EXCL_UNLINK, BRIDGE_IN_MASK_ADD,
+      BRIDGE_IN_ONESHOT,       BRIDGE_IN_ONLYDIR,     BRIDGE_IN_IGNORED,
+      BRIDGE_IN_ISDIR,         BRIDGE_IN_Q_OVERFLOW,  BRIDGE_IN_UNMOUNT};
+  intvec to_bits = {IN_ACCESS,        IN_ATTRIB,      IN_CLOSE_WRITE,
+                    IN_CLOSE_NOWRITE, IN_CREATE,      IN_DELETE,
+                    IN_DELETE_SELF,   IN_MODIFY,      IN_MOVE_SELF,
+                    IN_MOVED_FROM,    IN_MOVED_TO,    IN_OPEN,
+                    IN_DONT_FOLLOW,   IN_EXCL_UNLINK, IN_MASK_ADD,
+                    static_cast<int>(IN_ONESHOT),     IN_ONLYDIR,
+                    IN_IGNORED,       IN_ISDIR,       IN_Q_OVERFLOW,
+                    IN_UNMOUNT};
+  std::function<int(int)> from_mask = [](int bridge_mask) {
+    return static_cast<int>(FromBridgeInotifyEventMask(bridge_mask));
+  };
+  std::function<int(int)> to_mask = [](int mask) {
+    return static_cast<int>(ToBridgeInotifyEventMask(mask));
+  };
+  auto from_matcher = IsFiniteRestrictionOf<int, int>(from_mask);
+  EXPECT_THAT(FuzzBitsetTranslationFunction(from_bits, to_bits, ITER_BOUND),
+              from_matcher);
+  auto to_matcher = IsFiniteRestrictionOf<int, int>(to_mask);
+  EXPECT_THAT(FuzzBitsetTranslationFunction(to_bits, from_bits, ITER_BOUND),
+              to_matcher);
+}
+
 }  // namespace
 
 }  // namespace asylo
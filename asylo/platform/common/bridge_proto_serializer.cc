@@ -19,8 +19,6 @@
 #include <ifaddrs.h>
 #include <net/if.h>
 #include <netdb.h>
-#include <sys/epoll.h>
-#include <sys/inotify.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/types.h>
@@ -182,118 +180,6 @@ bool ConvertToAddrinfoProtobuf(const struct addrinfo *in, AddrinfosProto *out,
   return true;
 }
 
-// Epoll conversion functions.
-void ConvertToEpollEventProtobuf(const struct epoll_event *event,
-                                 EpollEvent *event_proto) {
-  int flags = event->events;
-  if (flags & EPOLLIN) event_proto->add_event_flags(EpollEvent::PROTO_IN);
-  if (flags & EPOLLPRI) event_proto->add_event_flags(EpollEvent::PROTO_PRI);
-  if (flags & EPOLLOUT) event_proto->add_event_flags(EpollEvent::PROTO_OUT);
-  if (flags & EPOLLMSG) event_proto->add_event_flags(EpollEvent::PROTO_MSG);
-  if (flags & EPOLLERR) event_proto->add_event_flags(EpollEvent::PROTO_ERR);
-  if (flags & EPOLLHUP) event_proto->add_event_flags(EpollEvent::PROTO_HUP);
-  if (flags & EPOLLRDHUP) event_proto->add_event_flags(EpollEvent::PROTO_RDHUP);
-  if (flags & EPOLLWAKEUP)
-    event_proto->add_event_flags(EpollEvent::PROTO_WAKEUP);
-  if (flags & EPOLLONESHOT)
-    event_proto->add_event_flags(EpollEvent::PROTO_ONESHOT);
-  if (flags & EPOLLET) event_proto->add_event_flags(EpollEvent::PROTO_ET);
-  event_proto->set_data(event->data.u64);
-}
-
-void ConvertToEpollEvent(const EpollEvent &event_proto,
-                         struct epoll_event *event) {
-  int flags = 0;
-  for (int i = 0; i < event_proto.event_flags_size(); ++i) {
-    EpollEvent::EpollEventFlag curr_flag = event_proto.event_flags(i);
-    if (curr_flag == EpollEvent::PROTO_IN)
-      flags |= EPOLLIN;
-    else if (curr_flag == EpollEvent::PROTO_PRI)
-      flags |= EPOLLPRI;
-    else if (curr_flag == EpollEvent::PROTO_OUT)
-      flags |= EPOLLOUT;
-    else if (curr_flag == EpollEvent::PROTO_MSG)
-      flags |= EPOLLMSG;
-    else if (curr_flag == EpollEvent::PROTO_ERR)
-      flags |= EPOLLERR;
-    else if (curr_flag == EpollEvent::PROTO_HUP)
-      flags |= EPOLLHUP;
-    else if (curr_flag == EpollEvent::PROTO_RDHUP)
-      flags |= EPOLLRDHUP;
-    else if (curr_flag == EpollEvent::PROTO_WAKEUP)
-      flags |= EPOLLWAKEUP;
-    else if (curr_flag == EpollEvent::PROTO_ONESHOT)
-      flags |= EPOLLONESHOT;
-    else if (curr_flag == EpollEvent::PROTO_ET)
-      flags |= EPOLLET;
-  }
-  event->events = flags;
-  event->data.u64 = event_proto.data();
-}
-
-bool ConvertToEpollEventList(const struct epoll_event *events, int numevents,
-                             EpollEventList *event_list) {
-  if (!events || !event_list) return false;
-  for (int i = 0; i < numevents; i++) {
-    EpollEvent *event = event_list->add_events();
-    ConvertToEpollEventProtobuf(&events[i], event);
-  }
-  return true;
-}
-
-bool ConvertToEpollEventStructs(const EpollEventList &event_list,
-                                struct epoll_event *events, int *numevents) {
-  if (!events) {
-    return false;
-  }
-  *numevents = event_list.events().size();
-  for (int i = 0; i < *numevents; ++i) {
-    ConvertToEpollEvent(event_list.events(i), &events[i]);
-  }
-  return true;
-}
-
-EpollCtlArgs::EpollCtlOp ConvertToProtoOp(int host_op) {
-  if (host_op == EPOLL_CTL_ADD)
-    return EpollCtlArgs::PROTO_CTL_ADD;
-  else if (host_op == EPOLL_CTL_DEL)
-    return EpollCtlArgs::PROTO_CTL_DEL;
-  else if (host_op == EPOLL_CTL_MOD)
-    return EpollCtlArgs::PROTO_CTL_MOD;
-  return EpollCtlArgs::UNSUPPORTED;
-}
-
-int ConvertToHostOp(EpollCtlArgs::EpollCtlOp proto_op) {
-  if (proto_op == EpollCtlArgs::PROTO_CTL_ADD)
-    return EPOLL_CTL_ADD;
-  else if (proto_op == EpollCtlArgs::PROTO_CTL_DEL)
-    return EPOLL_CTL_DEL;
-  else if (proto_op == EpollCtlArgs::PROTO_CTL_MOD)
-    return EPOLL_CTL_MOD;
-  return -1;
-}
-
-bool ConvertToEpollCtlArgsProtobuf(int epfd, int op, int fd,
-                                   struct epoll_event *event,
-                                   EpollCtlArgs *args) {
-  if ((!event && op != EPOLL_CTL_DEL) || !args) return false;
-  args->set_epfd(epfd);
-  args->set_op(ConvertToProtoOp(op));
-  args->set_hostfd(fd);
-  EpollEvent *event_proto = args->mutable_event();
-  if (event) ConvertToEpollEventProtobuf(event, event_proto);
-  return true;
-}
-
-bool ConvertToEpollWaitArgsProtobuf(int epfd, int maxevents, int timeout,
-                                    EpollWaitArgs *args) {
-  if (!args) return false;
-  args->set_epfd(epfd);
-  args->set_maxevents(maxevents);
-  args->set_timeout(timeout);
-  return true;
-}
-
 // IfAddr conversion functions.
 int FromProtoIffFlags(const IfAddrProto &in) {
   int flags = 0;
@@ -407,217 +293,6 @@ bool ConvertToIfAddrsProtobuf(const struct ifaddrs *in, IfAddrsProto *out) {
   return true;
 }
 
-void ConvertToInotifyMaskProto(uint32_t mask,
-                               google::protobuf::RepeatedField<int> *mask_proto) {
-  if (mask & IN_ACCESS) mask_proto->Add(InotifyFlag::PROTO_ACCESS);
-  if (mask & IN_ATTRIB) mask_proto->Add(InotifyFlag::PROTO_ATTRIB);
-  if (mask & IN_CLOSE_WRITE) mask_proto->Add(InotifyFlag::PROTO_CLOSE_WRITE);
-  if (mask & IN_CLOSE_NOWRITE)
-    mask_proto->Add(InotifyFlag::PROTO_CLOSE_NOWRITE);
-  if (mask & IN_CREATE) mask_proto->Add(InotifyFlag::PROTO_CREATE);
-  if (mask & IN_DELETE) mask_proto->Add(InotifyFlag::PROTO_DELETE);
-  if (mask & IN_DELETE_SELF) mask_proto->Add(InotifyFlag::PROTO_DELETE_SELF);
-  if (mask & IN_MODIFY) mask_proto->Add(InotifyFlag::PROTO_MODIFY);
-  if (mask & IN_MOVE_SELF) mask_proto->Add(InotifyFlag::PROTO_MOVE_SELF);
-  if (mask & IN_MOVED_FROM) mask_proto->Add(InotifyFlag::PROTO_MOVED_FROM);
-  if (mask & IN_MOVED_TO) mask_proto->Add(InotifyFlag::PROTO_MOVED_TO);
-  if (mask & IN_OPEN) mask_proto->Add(InotifyFlag::PROTO_OPEN);
-  if (mask & IN_DONT_FOLLOW) mask_proto->Add(InotifyFlag::PROTO_DONT_FOLLOW);
-  if (mask & IN_EXCL_UNLINK) mask_proto->Add(InotifyFlag::PROTO_EXCL_UNLINK);
-  if (mask & IN_MASK_ADD) mask_proto->Add(InotifyFlag::PROTO_MASK_ADD);
-  if (mask & IN_ONESHOT) mask_proto->Add(InotifyFlag::PROTO_ONESHOT);
-  if (mask & IN_ONLYDIR) mask_proto->Add(InotifyFlag::PROTO_ONLYDIR);
-  if (mask & IN_IGNORED) mask_proto->Add(InotifyFlag::PROTO_IGNORED);
-  if (mask & IN_ISDIR) mask_proto->Add(InotifyFlag::PROTO_ISDIR);
-  if (mask & IN_Q_OVERFLOW) mask_proto->Add(InotifyFlag::PROTO_Q_OVERFLOW);
-  if (mask & IN_UNMOUNT) mask_proto->Add(InotifyFlag::PROTO_UNMOUNT);
-}
-
-uint32_t ConvertFromInotifyMaskProto(
-    const google::protobuf::RepeatedField<int> &mask_proto) {
-  uint32_t flags = 0;
-  for (int i = 0; i < mask_proto.size(); ++i) {
-    int curr_flag = mask_proto.Get(i);
-    if (curr_flag == InotifyFlag::PROTO_ACCESS)
-      flags |= IN_ACCESS;
-    else if (curr_flag == InotifyFlag::PROTO_ATTRIB)
-      flags |= IN_ATTRIB;
-    else if (curr_flag == InotifyFlag::PROTO_CLOSE_WRITE)
-      flags |= IN_CLOSE_WRITE;
-    else if (curr_flag == InotifyFlag::PROTO_CLOSE_NOWRITE)
-      flags |= IN_CLOSE_NOWRITE;
-    else if (curr_flag == InotifyFlag::PROTO_CREATE)
-      flags |= IN_CREATE;
-    else if (curr_flag == InotifyFlag::PROTO_DELETE)
-      flags |= IN_DELETE;
-    else if (curr_flag == InotifyFlag::PROTO_DELETE_SELF)
-      flags |= IN_DELETE_SELF;
-    else if (curr_flag == InotifyFlag::PROTO_MODIFY)
-      flags |= IN_MODIFY;
-    else if (curr_flag == InotifyFlag::PROTO_MOVE_SELF)
-      flags |= IN_MOVE_SELF;
-    else if (curr_flag == InotifyFlag::PROTO_MOVED_FROM)
-      flags |= IN_MOVED_FROM;
-    else if (curr_flag == InotifyFlag::PROTO_MOVED_TO)
-      flags |= IN_MOVED_TO;
-    else if (curr_flag == InotifyFlag::PROTO_OPEN)
-      flags |= IN_OPEN;
-    else if (curr_flag == InotifyFlag::PROTO_DONT_FOLLOW)
-      flags |= IN_DONT_FOLLOW;
-    else if (curr_flag == InotifyFlag::PROTO_EXCL_UNLINK)
-      flags |= IN_EXCL_UNLINK;
-    else if (curr_flag == InotifyFlag::PROTO_MASK_ADD)
-      flags |= IN_MASK_ADD;
-    else if (curr_flag == InotifyFlag::PROTO_ONESHOT)
-      flags |= IN_ONESHOT;
-    else if (curr_flag == InotifyFlag::PROTO_ONLYDIR)
-      flags |= IN_ONLYDIR;
-    else if (curr_flag == InotifyFlag::PROTO_IGNORED)
-      flags |= IN_IGNORED;
-    else if (curr_flag == InotifyFlag::PROTO_ISDIR)
-      flags |= IN_ISDIR;
-    else if (curr_flag == InotifyFlag::PROTO_Q_OVERFLOW)
-      flags |= IN_Q_OVERFLOW;
-    else if (curr_flag == InotifyFlag::PROTO_UNMOUNT)
-      flags |= IN_UNMOUNT;
-  }
-  return flags;
-}
-
-bool ConvertToInotifyAddWatchArgsProtobuf(int fd, absl::string_view pathname,
-                                          uint32_t mask,
-                                          InotifyAddWatchArgs *args) {
-  if (!args) return false;
-  args->set_fd(fd);
-  args->set_pathname(pathname.data(), pathname.size());
-  ConvertToInotifyMaskProto(mask, args->mutable_mask());
-  return true;
-}
-
-bool ConvertToInotifyRmWatchArgsProtobuf(int fd, int wd,
-                                         InotifyRmWatchArgs *args) {
-  if (!args) return false;
-  args->set_fd(fd);
-  args->set_wd(wd);
-  return true;
-}
-
-bool ConvertToInotifyEventProtobuf(const struct inotify_event *event,
-                                   InotifyEvent *event_proto) {
-  if (!event || !event_proto) return false;
-  event_proto->set_wd(event->wd);
-  ConvertToInotifyMaskProto(event->mask, event_proto->mutable_mask());
-  event_proto->set_cookie(event->cookie);
-  if (event->len) {
-    event_proto->set_name(event->name);
-  }
-  return true;
-}
-
-bool ConvertToInotifyEventList(char *buf, size_t buf_len,
-                               InotifyEventList *event_list) {
-  char *curr_event_ptr = buf;
-  while (curr_event_ptr < buf + buf_len) {
-    struct inotify_event *curr_event =
-        reinterpret_cast<struct inotify_event *>(curr_event_ptr);
-    if (!ConvertToInotifyEventProtobuf(curr_event, event_list->add_events()))
-      return false;
-    curr_event_ptr += sizeof(struct inotify_event) + curr_event->len;
-  }
-  return true;
-}
-
-void AddToInotifyEventQueue(const InotifyEventList &event_list,
-                            std::queue<struct inotify_event *> *event_structs) {
-  for (int i = 0; i < event_list.events().size(); ++i) {
-    const InotifyEvent &curr_event = event_list.events(i);
-    // The len field accounts for the null-terminator.
-    uint32_t len = 0;
-    if (curr_event.has_name()) {
-      len = curr_event.name().length() + 1;
-    }
-    // The caller is responsible for deallocating the memory allocated below.
-    struct inotify_event *new_event_struct =
-        static_cast<struct inotify_event *>(
-            malloc(sizeof(struct inotify_event) + len));
-    new_event_struct->wd = curr_event.wd();
-    new_event_struct->mask = ConvertFromInotifyMaskProto(curr_event.mask());
-    new_event_struct->cookie = curr_event.cookie();
-    new_event_struct->len = len;
-    if (len) {
-      memcpy(new_event_struct->name, curr_event.name().c_str(), len);
-    }
-    event_structs->push(new_event_struct);
-  }
-}
-
-
-bool ConvertToRecvFromArgs(int sockfd, size_t len, int flags,
-                           RecvFromArgs *args) {
-  if (!args) {
-    return false;
-  }
-  args->set_sockfd(sockfd);
-  args->set_len(len);
-  if (flags & MSG_OOB) args->add_flags(RecvSendFlags::PROTO_OOB);
-  if (flags & MSG_PEEK) args->add_flags(RecvSendFlags::PROTO_PEEK);
-  if (flags & MSG_DONTROUTE) args->add_flags(RecvSendFlags::PROTO_DONTROUTE);
-  if (flags & MSG_CTRUNC) args->add_flags(RecvSendFlags::PROTO_CTRUNC);
-  if (flags & MSG_PROXY) args->add_flags(RecvSendFlags::PROTO_PROXY);
-  if (flags & MSG_TRUNC) args->add_flags(RecvSendFlags::PROTO_TRUNC);
-  if (flags & MSG_DONTWAIT) args->add_flags(RecvSendFlags::PROTO_DONTWAIT);
-  if (flags & MSG_EOR) args->add_flags(RecvSendFlags::PROTO_EOR);
-  if (flags & MSG_WAITALL) args->add_flags(RecvSendFlags::PROTO_WAITALL);
-  if (flags & MSG_FIN) args->add_flags(RecvSendFlags::PROTO_FIN);
-  if (flags & MSG_SYN) args->add_flags(RecvSendFlags::PROTO_SYN);
-  if (flags & MSG_CONFIRM) args->add_flags(RecvSendFlags::PROTO_CONFIRM);
-  if (flags & MSG_RST) args->add_flags(RecvSendFlags::PROTO_RST);
-  if (flags & MSG_ERRQUEUE) args->add_flags(RecvSendFlags::PROTO_ERRQUEUE);
-  if (flags & MSG_NOSIGNAL) args->add_flags(RecvSendFlags::PROTO_NOSIGNAL);
-  if (flags & MSG_MORE) args->add_flags(RecvSendFlags::PROTO_MORE);
-  if (flags & MSG_WAITFORONE) args->add_flags(RecvSendFlags::PROTO_WAITFORONE);
-  if (flags & MSG_FASTOPEN) args->add_flags(RecvSendFlags::PROTO_FASTOPEN);
-  if (flags & MSG_CMSG_CLOEXEC) {
-    args->add_flags(RecvSendFlags::PROTO_CMSG_CLOEXEC);
-  }
-  return true;
-}
-
-bool ConvertFromRecvFromArgsProto(const RecvFromArgs &args, int *sockfd,
-                                  size_t *len, int *flags) {
-  if (!sockfd || !len || !flags) {
-    return false;
-  }
-  *flags = 0;
-  *sockfd = args.sockfd();
-  *len = args.len();
-  for (int i = 0; i < args.flags().size(); ++i) {
-    int curr_flag = args.flags(i);
-    if (curr_flag == RecvSendFlags::PROTO_OOB) *flags |= MSG_OOB;
-    if (curr_flag == RecvSendFlags::PROTO_PEEK) *flags |= MSG_PEEK;
-    if (curr_flag == RecvSendFlags::PROTO_DONTROUTE) *flags |= MSG_DONTROUTE;
-    if (curr_flag == RecvSendFlags::PROTO_CTRUNC) *flags |= MSG_CTRUNC;
-    if (curr_flag == RecvSendFlags::PROTO_PROXY) *flags |= MSG_PROXY;
-    if (curr_flag == RecvSendFlags::PROTO_TRUNC) *flags |= MSG_TRUNC;
-    if (curr_flag == RecvSendFlags::PROTO_DONTWAIT) *flags |= MSG_DONTWAIT;
-    if (curr_flag == RecvSendFlags::PROTO_EOR) *flags |= MSG_EOR;
-    if (curr_flag == RecvSendFlags::PROTO_WAITALL) *flags |= MSG_WAITALL;
-    if (curr_flag == RecvSendFlags::PROTO_FIN) *flags |= MSG_FIN;
-    if (curr_flag == RecvSendFlags::PROTO_SYN) *flags |= MSG_SYN;
-    if (curr_flag == RecvSendFlags::PROTO_CONFIRM) *flags |= MSG_CONFIRM;
-    if (curr_flag == RecvSendFlags::PROTO_RST) *flags |= MSG_RST;
-    if (curr_flag == RecvSendFlags::PROTO_ERRQUEUE) *flags |= MSG_ERRQUEUE;
-    if (curr_flag == RecvSendFlags::PROTO_NOSIGNAL) *flags |= MSG_NOSIGNAL;
-    if (curr_flag == RecvSendFlags::PROTO_MORE) *flags |= MSG_MORE;
-    if (curr_flag == RecvSendFlags::PROTO_WAITFORONE) *flags |= MSG_WAITFORONE;
-    if (curr_flag == RecvSendFlags::PROTO_FASTOPEN) *flags |= MSG_FASTOPEN;
-    if (curr_flag == RecvSendFlags::PROTO_CMSG_CLOEXEC) {
-      *flags |= MSG_CMSG_CLOEXEC;
-    }
-  }
-  return true;
-}
-
 }  // namespace
 
 bool SerializeAddrinfo(const struct addrinfo *in, std::string *out,
@@ -649,76 +324,6 @@ void FreeDeserializedAddrinfo(struct addrinfo *in) {
   if (prev_info) free(prev_info);
 }
 
-bool SerializeEpollCtlArgs(int epfd, int op, int fd, struct epoll_event *event,
-                           char **out, size_t *len) {
-  if (!out || !len) return false;
-  EpollCtlArgs args_proto;
-  if (ConvertToEpollCtlArgsProtobuf(epfd, op, fd, event, &args_proto)) {
-    *len = args_proto.ByteSizeLong();
-    // The caller is responsible for freeing the memory allocated by malloc.
-    *out = static_cast<char *>(malloc(*len));
-    return args_proto.SerializeToArray(*out, *len);
-  }
-  return false;
-}
-
-bool DeserializeEpollCtlArgs(absl::string_view in, int *epfd, int *op, int *fd,
-                             struct epoll_event *event) {
-  if (!epfd || !op || !fd || (!event && *op == EPOLL_CTL_DEL)) return false;
-  EpollCtlArgs args_proto;
-  if (!args_proto.ParseFromArray(in.data(), in.length())) return false;
-  *epfd = args_proto.epfd();
-  *op = ConvertToHostOp(args_proto.op());
-  *fd = args_proto.hostfd();
-  if (args_proto.has_event()) ConvertToEpollEvent(args_proto.event(), event);
-  return true;
-}
-
-bool SerializeEpollWaitArgs(int epfd, int maxevents, int timeout, char **out,
-                            size_t *len) {
-  if (!out || !len) return false;
-  EpollWaitArgs args_proto;
-  if (ConvertToEpollWaitArgsProtobuf(epfd, maxevents, timeout, &args_proto)) {
-    *len = args_proto.ByteSizeLong();
-    // The caller is responsible for freeing the memory allocated below.
-    *out = static_cast<char *>(malloc(*len));
-    return args_proto.SerializeToArray(*out, *len);
-  }
-  return false;
-}
-
-bool DeserializeEpollWaitArgs(absl::string_view in, int *epfd, int *maxevents,
-                              int *timeout) {
-  if (!epfd || !maxevents) return false;
-  EpollWaitArgs args_proto;
-  if (!args_proto.ParseFromArray(in.data(), in.length())) return false;
-  *epfd = args_proto.epfd();
-  *maxevents = args_proto.maxevents();
-  *timeout = args_proto.timeout();
-  return true;
-}
-
-bool SerializeEvents(const struct epoll_event *events, int numevents,
-                     char **out, size_t *len) {
-  if (!events || !out) return false;
-  EpollEventList event_list_proto;
-  if (ConvertToEpollEventList(events, numevents, &event_list_proto)) {
-    *len = event_list_proto.ByteSizeLong();
-    // The caller is responsible for freeing the memory allocated below.
-    *out = static_cast<char *>(malloc(*len));
-    return event_list_proto.SerializeToArray(*out, *len);
-  }
-  return false;
-}
-
-bool DeserializeEvents(absl::string_view in, struct epoll_event *events,
-                       int *numevents) {
-  if (!events || !numevents) return false;
-  EpollEventList event_list_proto;
-  if (!event_list_proto.ParseFromArray(in.data(), in.length())) return false;
-  return ConvertToEpollEventStructs(event_list_proto, events, numevents);
-}
-
 bool SerializeIfAddrs(const struct ifaddrs *in, char **out, size_t *len) {
   IfAddrsProto ifaddrs_proto;
   if (!out) return false;
@@ -763,119 +368,4 @@ bool IfAddrSupported(const struct ifaddrs *entry) {
   return true;
 }
 
-bool SerializeInotifyAddWatchArgs(int fd, absl::string_view pathname,
-                                  uint32_t mask, char **out, size_t *len) {
-  if (!out || !len) return false;
-  InotifyAddWatchArgs args_proto;
-  if (ConvertToInotifyAddWatchArgsProtobuf(fd, pathname, mask, &args_proto)) {
-    *len = args_proto.ByteSizeLong();
-    // The caller is responsible for freeing the memory allocated below.
-    *out = static_cast<char *>(malloc(*len));
-    return args_proto.SerializeToArray(*out, *len);
-  }
-  return false;
-}
-
-bool SerializeInotifyRmWatchArgs(int fd, int wd, char **out, size_t *len) {
-  if (!out || !len) return false;
-  InotifyRmWatchArgs args_proto;
-  if (ConvertToInotifyRmWatchArgsProtobuf(fd, wd, &args_proto)) {
-    *len = args_proto.ByteSizeLong();
-    *out = static_cast<char *>(malloc(*len));
-    return args_proto.SerializeToArray(*out, *len);
-  }
-  return false;
-}
-
-bool DeserializeInotifyAddWatchArgs(absl::string_view in, int *fd,
-                                    char **pathname, uint32_t *mask) {
-  if (!fd || !pathname || !mask) return false;
-  InotifyAddWatchArgs args_proto;
-  if (!args_proto.ParseFromArray(in.data(), in.length())) return false;
-  *fd = args_proto.fd();
-  // The caller is responsible for deallocating the memory allocated below.
-  *pathname = strdup(args_proto.pathname().c_str());
-  *mask = ConvertFromInotifyMaskProto(args_proto.mask());
-  return true;
-}
-
-bool DeserializeInotifyRmWatchArgs(absl::string_view in, int *fd, int *wd) {
-  if (!fd || !wd) return false;
-  InotifyRmWatchArgs args_proto;
-  if (!args_proto.ParseFromArray(in.data(), in.length())) return false;
-  *fd = args_proto.fd();
-  *wd = args_proto.wd();
-  return true;
-}
-
-bool SerializeInotifyEvents(char *buf, size_t buf_len, char **out,
-                            size_t *len) {
-  InotifyEventList event_list_proto;
-  if (ConvertToInotifyEventList(buf, buf_len, &event_list_proto)) {
-    *len = event_list_proto.ByteSizeLong();
-    // The caller is responsible for freeing the memory below.
-    *out = static_cast<char *>(malloc(*len));
-    return event_list_proto.SerializeToArray(*out, *len);
-  }
-  return false;
-}
-
-bool DeserializeInotifyEvents(absl::string_view in,
-                              std::queue<struct inotify_event *> *events) {
-  if (!events) return false;
-  InotifyEventList event_list_proto;
-  if (!event_list_proto.ParseFromArray(in.data(), in.length())) return false;
-  AddToInotifyEventQueue(event_list_proto, events);
-  return true;
-}
-
-bool SerializeRecvFromArgs(int sockfd, size_t len, int flags, char **out,
-                           size_t *out_len) {
-  if (!out || !out_len) {
-    return false;
-  }
-  RecvFromArgs args_proto;
-  if (ConvertToRecvFromArgs(sockfd, len, flags, &args_proto)) {
-    *out_len = args_proto.ByteSizeLong();
-    // The caller is responsible for freeing the memory allocated below.
-    *out = static_cast<char *>(malloc(*out_len));
-    return args_proto.SerializeToArray(*out, *out_len);
-  }
-  return false;
-}
-
-bool DeserializeRecvFromArgs(absl::string_view in, int *sockfd, size_t *len,
-                             int *flags) {
-  RecvFromArgs args;
-  if (!args.ParseFromArray(in.data(), in.length())) {
-    return false;
-  }
-  return ConvertFromRecvFromArgsProto(args, sockfd, len, flags);
-}
-
-bool SerializeRecvFromSrcAddr(struct sockaddr *src_addr, char **out,
-                              size_t *out_len, int *bridge_error_code) {
-  RecvFromSrcAddr addr_proto;
-  if (!src_addr || !out || !out_len ||
-      !ConvertToSockaddrProtobuf(src_addr, addr_proto.mutable_src_addr(),
-                                 bridge_error_code)) {
-    return false;
-  }
-  *out_len = addr_proto.ByteSizeLong();
-  // The caller is responsible for freeing the memory allocated below.
-  *out = static_cast<char *>(malloc(*out_len));
-  return addr_proto.SerializeToArray(*out, *out_len);
-}
-
-bool DeserializeRecvFromSrcAddr(absl::string_view in,
-                                struct sockaddr **src_addr) {
-  RecvFromSrcAddr addr_proto;
-  if (!src_addr || !addr_proto.ParseFromArray(in.data(), in.length())) {
-    return false;
-  }
-  // The caller is responsible for freeing the memory allocated by
-  // ConvertToSockaddr.
-  return ConvertToSockaddr(addr_proto.src_addr(), src_addr);
-}
-
 }  // namespace asylo
@@ -337,6 +337,50 @@ enum BridgePollEvents {
   BRIDGE_POLLWRBAND = 0x400,
 };
 
+enum BridgeEpollEvents {
+  BRIDGE_EPOLLIN = 0x001,
+  BRIDGE_EPOLLPRI = 0x002,
+  BRIDGE_EPOLLOUT = 0x004,
+  BRIDGE_EPOLLMSG = 0x008,
+  BRIDGE_EPOLLERR = 0x010,
+  BRIDGE_EPOLLHUP = 0x020,
+  BRIDGE_EPOLLRDHUP = 0x040,
+  BRIDGE_EPOLLWAKEUP = 0x080,
+  BRIDGE_EPOLLONESHOT = 0x100,
+  BRIDGE_EPOLLET = 0x200,
+};
+
+enum BridgeEpollCtlOperation {
+  BRIDGE_EPOLL_CTL_UNSUPPORTED = 0,
+  BRIDGE_EPOLL_CTL_ADD = 1,
+  BRIDGE_EPOLL_CTL_DEL = 2,
+  BRIDGE_EPOLL_CTL_MOD = 3,
+};
+
+enum BridgeInotifyFlags {
+  BRIDGE_IN_ACCESS = 0x000001,
+  BRIDGE_IN_ATTRIB = 0x000002,
+  BRIDGE_IN_CLOSE_WRITE = 0x000004,
+  BRIDGE_IN_CLOSE_NOWRITE = 0x000008,
+  BRIDGE_IN_CREATE = 0x000010,
+  BRIDGE_IN_DELETE = 0x000020,
+  BRIDGE_IN_DELETE_SELF = 0x000040,
+  BRIDGE_IN_MODIFY = 0x000080,
+  BRIDGE_IN_MOVE_SELF = 0x000100,
+  BRIDGE_IN_MOVED_FROM = 0x000200,
+  BRIDGE_IN_MOVED_TO = 0x000400,
+  BRIDGE_IN_OPEN = 0x000800,
+  BRIDGE_IN_DONT_FOLLOW = 0x001000,
+  BRIDGE_IN_EXCL_UNLINK = 0x002000,
+  BRIDGE_IN_MASK_ADD = 0x004000,
+  BRIDGE_IN_ONESHOT = 0x008000,
+  BRIDGE_IN_ONLYDIR = 0x010000,
+  BRIDGE_IN_IGNORED = 0x020000,
+  BRIDGE_IN_ISDIR = 0x040000,
+  BRIDGE_IN_Q_OVERFLOW = 0x080000,
+  BRIDGE_IN_UNMOUNT = 0x100000,
+};
+
 struct bridge_in_addr {
   uint32_t inet_addr;
 } ABSL_ATTRIBUTE_PACKED;
@@ -427,6 +471,24 @@ struct bridge_pollfd {
   int16_t revents;
 };
 
+// Has the same layout as the host's struct epoll_event, so an array of events
+// can be passed to and from epoll_wait() on the host without repacking.
+struct bridge_epoll_event {
+  uint32_t events;
+  uint64_t data;
+} ABSL_ATTRIBUTE_PACKED;
+
+// Header of an inotify event as read from an inotify file descriptor. Each
+// header is followed by |len| bytes of null-padded file name. This has the same
+// layout as struct inotify_event, so the events read by the host are passed
+// across the enclave boundary as is, with only |mask| translated.
+struct bridge_inotify_event {
+  int32_t wd;
+  uint32_t mask;
+  uint32_t cookie;
+  uint32_t len;
+} ABSL_ATTRIBUTE_PACKED;
+
 struct bridge_msghdr {
   void *msg_name;
   uint64_t msg_namelen;
@@ -42,8 +42,24 @@ void sys_futex_wait(int32_t *futex, int32_t expected) {
   sys_futex(futex, FUTEX_WAIT, expected, nullptr, nullptr, 0);
 }
 
-void sys_futex_wake(int32_t *futex) {
-  sys_futex(futex, FUTEX_WAKE, 0, nullptr, nullptr, 0);
+void sys_futex_timedwait(int32_t *futex, int32_t expected,
+                         int64_t timeout_nanoseconds) {
+  constexpr int64_t kNanosecondsPerSecond = 1000000000;
+  if (timeout_nanoseconds < 0) {
+    timeout_nanoseconds = 0;
+  }
+  struct timespec timeout;
+  timeout.tv_sec = timeout_nanoseconds / kNanosecondsPerSecond;
+  timeout.tv_nsec = timeout_nanoseconds % kNanosecondsPerSecond;
+  sys_futex(futex, FUTEX_WAIT, expected, &timeout, nullptr, 0);
+}
+
+int sys_futex_wake(int32_t *futex) {
+  return sys_futex(futex, FUTEX_WAKE, 0, nullptr, nullptr, 0);
+}
+
+int sys_futex_wake_all(int32_t *futex) {
+  return sys_futex(futex, FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
 }
 }
 
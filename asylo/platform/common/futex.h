@@ -28,8 +28,18 @@ extern "C" {
 // `futex_wake`. Otherwise returns immediately.
 void sys_futex_wait(int32_t *futex, int32_t expected);
 
-// Wakes at most one of the threads waiting on `futex`.
-void sys_futex_wake(int32_t *futex);
+// Behaves like `sys_futex_wait`, but returns once `timeout_nanoseconds` have
+// elapsed even if `futex` has not been notified.
+void sys_futex_timedwait(int32_t *futex, int32_t expected,
+                         int64_t timeout_nanoseconds);
+
+// Wakes at most one of the threads waiting on `futex` and returns the number of
+// threads woken.
+int sys_futex_wake(int32_t *futex);
+
+// Wakes all of the threads waiting on `futex` and returns the number of threads
+// woken.
+int sys_futex_wake_all(int32_t *futex);
 
 }
 #endif  // ASYLO_PLATFORM_COMMON_FUTEX_H_
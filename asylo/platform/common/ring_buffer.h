@@ -57,10 +57,6 @@ namespace asylo {
 // RingBuffer<kCapacity>::TypeVersion() == instance->InstanceVersion();
 //
 
-// Exposes NonBlockingRead/Write for testing.
-template <size_t kCapacity>
-class RingBufferForTest;
-
 template <size_t kCapacity>
 class RingBuffer {
  public:
@@ -124,64 +120,9 @@ class RingBuffer {
     return already_written;
   }
 
-  // Sets the closed-for-write flag, indicating that no more writes to this
-  // buffer are expected and the reader should not wait for more data.
-  void close_for_write() { closed_for_write_ = 1; }
-
-  // Sets the closed-for-read flag, indicating that no more reads to this buffer
-  // are expected and the writer should not wait to write more data.
-  void close_for_read() { closed_for_read_ = 1; }
-
-  // Returns the closed-for-write flag.
-  bool is_closed_for_write() const { return closed_for_write_ != 0; }
-
-  // Returns the closed-for-read flag.
-  bool is_closed_for_read() const { return closed_for_read_ != 0; }
-
-  // Returns the maximum capacity of the buffer in bytes.
-  constexpr size_t capacity() const { return kCapacity; }
-
-  // Clears the buffer and leaves it empty. This operation is not synchronized
-  // and its behavior in the presence of concurrent readers and writers is
-  // undefined.
-  void UnsynchronizedClear() {
-    closed_for_read_ = 0;
-    closed_for_write_ = 0;
-    count_ = 0;
-    read_pos_ = 0;
-    write_pos_ = 0;
-  }
-
-  // Returns the number of bytes of empty space available for writing.
-  size_t available() const { return kCapacity - count_; }
-
-  // Returns number of bytes stored in the buffer for reading.
-  size_t size() const { return count_; }
-
-  // Returns true is the buffer is empty.
-  bool empty() const { return count_ == 0; }
-
-  // Returns true is the buffer is full.
-  bool full() const { return count_ == kCapacity; }
-
-  // Returns a signature reflecting the layout of this concrete instance.
-  uint64_t InstanceVersion() const { return instance_version_; }
-
-  // Returns a signature reflecting the layout of this abstract type.
-  static constexpr uint64_t TypeVersion() {
-    return offsetof(RingBuffer, count_) << 0 |
-           offsetof(RingBuffer, closed_for_read_) << 8 |
-           offsetof(RingBuffer, closed_for_write_) << 16 |
-           offsetof(RingBuffer, read_pos_) << 24 |
-           offsetof(RingBuffer, write_pos_) << 32 |
-           offsetof(RingBuffer, buffer_) << 40 | sizeof(RingBuffer) << 48;
-  }
-
- private:
-  friend class RingBufferForTest<kCapacity>;
-
   // Reads up to |nbyte| bytes without blocking, returning the number
-  // successfully read.
+  // successfully read. Callers that share the buffer between several readers
+  // must serialize their calls.
   size_t NonBlockingRead(uint8_t *buf, size_t nbyte) {
     // Since there is only one reader, and since the writer will only ever add
     // bytes to the buffer, we can read at least size bytes.
@@ -216,7 +157,8 @@ class RingBuffer {
   }
 
   // Writes up to |nbyte| bytes without blocking, returning the number
-  // successfully written.
+  // successfully written. Callers that share the buffer between several
+  // writers must serialize their calls.
   size_t NonBlockingWrite(const uint8_t *buf, size_t nbyte) {
     // Since there is only one writer, and since the reader will only ever
     // remove bytes from the buffer, we can write at least size bytes.
@@ -248,6 +190,60 @@ class RingBuffer {
     return size;
   }
 
+  // Sets the closed-for-write flag, indicating that no more writes to this
+  // buffer are expected and the reader should not wait for more data.
+  void close_for_write() { closed_for_write_ = 1; }
+
+  // Sets the closed-for-read flag, indicating that no more reads to this buffer
+  // are expected and the writer should not wait to write more data.
+  void close_for_read() { closed_for_read_ = 1; }
+
+  // Returns the closed-for-write flag.
+  bool is_closed_for_write() const { return closed_for_write_ != 0; }
+
+  // Returns the closed-for-read flag.
+  bool is_closed_for_read() const { return closed_for_read_ != 0; }
+
+  // Returns the maximum capacity of the buffer in bytes.
+  constexpr size_t capacity() const { return kCapacity; }
+
+  // Clears the buffer and leaves it empty. This operation is not synchronized
+  // and its behavior in the presence of concurrent readers and writers is
+  // undefined.
+  void UnsynchronizedClear() {
+    closed_for_read_ = 0;
+    closed_for_write_ = 0;
+    count_ = 0;
+    read_pos_ = 0;
+    write_pos_ = 0;
+  }
+
+  // Returns the number of bytes of empty space available for writing.
+  size_t available() const { return kCapacity - count_; }
+
+  // Returns number of bytes stored in the buffer for reading.
+  size_t size() const { return count_; }
+
+  // Returns true is the buffer is empty.
+  bool empty() const { return count_ == 0; }
+
+  // Returns true is the buffer is full.
+  bool full() const { return count_ == kCapacity; }
+
+  // Returns a signature reflecting the layout of this concrete instance.
+  uint64_t InstanceVersion() const { return instance_version_; }
+
+  // Returns a signature reflecting the layout of this abstract type.
+  static constexpr uint64_t TypeVersion() {
+    return offsetof(RingBuffer, count_) << 0 |
+           offsetof(RingBuffer, closed_for_read_) << 8 |
+           offsetof(RingBuffer, closed_for_write_) << 16 |
+           offsetof(RingBuffer, read_pos_) << 24 |
+           offsetof(RingBuffer, write_pos_) << 32 |
+           offsetof(RingBuffer, buffer_) << 40 | sizeof(RingBuffer) << 48;
+  }
+
+ private:
   const uint64_t instance_version_;         // Layout of the struct.
   std::atomic<uint32_t> closed_for_read_;   // Reader is done reading.
   std::atomic<uint32_t> closed_for_write_;  // Writer is done writing.
@@ -29,19 +29,6 @@ namespace asylo {
 
 constexpr const size_t kDataSize = 4 * 1024 * 1024;
 
-// Exposes NonBlockingWrite and NonBlockingRead for testing.
-template <size_t Capacity>
-class RingBufferForTest : public RingBuffer<Capacity> {
- public:
-  size_t NonBlockingWrite(const uint8_t *buf, size_t nbyte) {
-    return RingBuffer<Capacity>::NonBlockingWrite(buf, nbyte);
-  }
-
-  size_t NonBlockingRead(uint8_t *buf, size_t nbyte) {
-    return RingBuffer<Capacity>::NonBlockingRead(buf, nbyte);
-  }
-};
-
 // Generate a series of test data.
 std::vector<uint8_t> MakeTestData(size_t size) {
   uint8_t f1 = 0;
@@ -82,7 +69,7 @@ class RingBufferTest : public ::testing::Test {
     buf_.close_for_write();
   }
 
-  RingBufferForTest<kDataSize> buf_;
+  RingBuffer<kDataSize> buf_;
   std::vector<uint8_t> scratch_;
   std::vector<uint8_t> data_;
 };
@@ -124,7 +111,7 @@ TEST_F(RingBufferTest, VersionMatching) {
 TEST_F(RingBufferTest, SingleThreadedStressTest) {
   std::vector<uint8_t> copied_data(kDataSize);
   const size_t kBiggestChunk = 1024;
-  RingBufferForTest<255> small_buf;
+  RingBuffer<255> small_buf;
 
   // Index into data_ to write to the buffer.
   int data_index = 0;
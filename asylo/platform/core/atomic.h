@@ -45,6 +45,13 @@ inline T AtomicDecrement(volatile T *location) {
   return __atomic_fetch_sub(location, 1, __ATOMIC_SEQ_CST);
 }
 
+// Atomically stores `desired` at `location`, returning the value at `location`
+// prior to the exchange.
+template <typename T>
+inline T AtomicExchange(volatile T *location, T desired) {
+  return __atomic_exchange_n(location, desired, __ATOMIC_SEQ_CST);
+}
+
 // Sets the value at location to zero using __ATOMIC_RELEASE memory ordering.
 template <typename T>
 inline void AtomicRelease(volatile T *location) {
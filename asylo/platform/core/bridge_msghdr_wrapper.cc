@@ -15,130 +15,168 @@
  * limitations under the License.
  *
  */
-#include <errno.h>
 
-#include "asylo/util/logging.h"
-#include "asylo/platform/common/bridge_functions.h"
 #include "asylo/platform/core/bridge_msghdr_wrapper.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
 #include "asylo/platform/core/untrusted_cache_malloc.h"
 
 namespace asylo {
 namespace {
 
-// Allocates untrusted memory and copies the buffer |data| of size |size| to it.
-// |addr| is updated to point to the address of the copied memory. It is the
-// responsibility of the caller to free the memory pointed to by |addr|.
-// It is a fatal error if memory cannot be allocated.
-bool CopyToUntrustedMemory(void **addr, void *data, size_t size) {
-  if (data && !addr) {
-    return false;
-  }
-  // The operation trivially succeeds if there is nothing to copy.
-  if (!data) {
-    if (addr) {
-      *addr = nullptr;
-    }
-    return true;
-  }
-
-  // Instance of the global memory pool singleton.
-  asylo::UntrustedCacheMalloc *untrusted_cache_malloc =
-      asylo::UntrustedCacheMalloc::Instance();
-  void *outside_enclave = untrusted_cache_malloc->Malloc(size);
-  // The operation fails if it cannot allocate the necessary resources.
-  LOG_IF(FATAL, !outside_enclave) << "Untrusted memory allocation failed";
-
-  memcpy(outside_enclave, data, size);
-  *addr = outside_enclave;
-  return true;
+// Rounds |size| up so that the next part of the staging area is aligned.
+size_t Align(size_t size) {
+  constexpr size_t kAlignment = alignof(std::max_align_t);
+  return (size + kAlignment - 1) & ~(kAlignment - 1);
 }
 
 }  // namespace
-}  // namespace asylo
 
-asylo::BridgeMsghdrWrapper::BridgeMsghdrWrapper(const struct msghdr *in) {
-  struct bridge_msghdr trusted_bridge_msghdr;
-  ToBridgeMsgHdr(in, &trusted_bridge_msghdr);
-  struct bridge_msghdr *untrusted_bridge_msghdr = nullptr;
-  const bool ret = CopyToUntrustedMemory(
-      reinterpret_cast<void **>(&untrusted_bridge_msghdr),
-      &trusted_bridge_msghdr, sizeof(struct bridge_msghdr));
-  if (ret && untrusted_bridge_msghdr) {
-    msg_out_.reset(untrusted_bridge_msghdr);
-  }
-  msg_in_ = in;
+BridgeMsghdrWrapper::BridgeMsghdrWrapper(const struct msghdr *in)
+    : msg_in_(), data_size_(0), name_(nullptr), control_(nullptr),
+      data_(nullptr) {
+  if (!in) {
+    errno = EFAULT;
+    return;
+  }
+  msg_in_ = *in;
+  Stage();
 }
 
-bridge_msghdr *asylo::BridgeMsghdrWrapper::get_msg()
-    const { return msg_out_.get(); }
-
-bool asylo::BridgeMsghdrWrapper::CopyMsgName() {
-  void *tmp_name_ptr = nullptr;
-  if (!CopyToUntrustedMemory(&tmp_name_ptr, msg_in_->msg_name,
-                             msg_in_->msg_namelen)) {
-    return false;
-  }
-  if (tmp_name_ptr) {
-    msg_name_ptr_.reset(tmp_name_ptr);
-    msg_out_->msg_name = tmp_name_ptr;
+BridgeMsghdrWrapper::BridgeMsghdrWrapper(const struct iovec *iov, int iovcnt)
+    : msg_in_(), data_size_(0), name_(nullptr), control_(nullptr),
+      data_(nullptr) {
+  if (iovcnt < 0) {
+    errno = EINVAL;
+    return;
   }
-  return true;
+  msg_in_.msg_iov = const_cast<struct iovec *>(iov);
+  msg_in_.msg_iovlen = iovcnt;
+  Stage();
 }
 
-// It is a fatal error if memory cannot be allocated.
-bool asylo::BridgeMsghdrWrapper::CopyMsgIov() {
-  // Instance of the global memory pool singleton.
-  asylo::UntrustedCacheMalloc *untrusted_cache_malloc =
-      asylo::UntrustedCacheMalloc::Instance();
-  auto tmp_iov_ptr =
-      reinterpret_cast<struct bridge_iovec *>(untrusted_cache_malloc->Malloc(
-          msg_in_->msg_iovlen * sizeof(struct bridge_iovec)));
-  LOG_IF(FATAL, !tmp_iov_ptr) << "Untrusted memory allocation failed";
-  if (tmp_iov_ptr) {
-    msg_iov_ptr_.reset(tmp_iov_ptr);
-    msg_out_->msg_iov = tmp_iov_ptr;
-  }
-  for (int i = 0; i < msg_in_->msg_iovlen; ++i) {
-    if (!ToBridgeIovec(&msg_in_->msg_iov[i], &msg_out_->msg_iov[i])) {
-      LOG(FATAL) << "Iovec allocation failed";
+void BridgeMsghdrWrapper::Stage() {
+  if (msg_in_.msg_iovlen > kMaxIovecs ||
+      (msg_in_.msg_iovlen > 0 && !msg_in_.msg_iov)) {
+    errno = EINVAL;
+    return;
+  }
+  for (size_t i = 0; i < msg_in_.msg_iovlen; ++i) {
+    if (msg_in_.msg_iov[i].iov_len > SSIZE_MAX - data_size_) {
+      errno = EINVAL;
+      return;
     }
+    data_size_ += msg_in_.msg_iov[i].iov_len;
+  }
+  size_t namelen = msg_in_.msg_name ? msg_in_.msg_namelen : 0;
+  size_t controllen = msg_in_.msg_control ? msg_in_.msg_controllen : 0;
+  if (controllen > SSIZE_MAX) {
+    errno = EINVAL;
+    return;
   }
-  return true;
-}
 
-bool asylo::BridgeMsghdrWrapper::CopyMsgIovBase() {
-  for (int i = 0; i < msg_in_->msg_iovlen; ++i) {
-    msg_iov_base_ptrs_.push_back(nullptr);
-    void *tmp_iov_base_ptr = nullptr;
-    if (!CopyToUntrustedMemory(&tmp_iov_base_ptr, msg_in_->msg_iov[i].iov_base,
-                               msg_in_->msg_iov[i].iov_len)) {
-      return false;
-    }
-    if (tmp_iov_base_ptr) {
-      msg_iov_base_ptrs_[i].reset(tmp_iov_base_ptr);
-      msg_out_->msg_iov[i].iov_base = tmp_iov_base_ptr;
-    }
+  size_t iov_offset = Align(sizeof(struct bridge_msghdr));
+  size_t name_offset =
+      iov_offset + Align(msg_in_.msg_iovlen * sizeof(struct bridge_iovec));
+  size_t control_offset = name_offset + Align(namelen);
+  size_t data_offset = control_offset + Align(controllen);
+  if (data_size_ > SIZE_MAX - data_offset) {
+    errno = EINVAL;
+    return;
+  }
+  char *area = reinterpret_cast<char *>(
+      UntrustedCacheMalloc::Instance()->Malloc(data_offset + data_size_));
+  if (!area) {
+    errno = ENOMEM;
+    return;
+  }
+  msg_out_.reset(reinterpret_cast<struct bridge_msghdr *>(area));
+  name_ = namelen > 0 ? area + name_offset : nullptr;
+  control_ = controllen > 0 ? area + control_offset : nullptr;
+  data_ = area + data_offset;
+
+  struct bridge_msghdr *msg = msg_out_.get();
+  msg->msg_name = name_;
+  msg->msg_namelen = namelen;
+  msg->msg_iov = reinterpret_cast<struct bridge_iovec *>(area + iov_offset);
+  msg->msg_iovlen = msg_in_.msg_iovlen;
+  msg->msg_control = control_;
+  msg->msg_controllen = controllen;
+  msg->msg_flags = msg_in_.msg_flags;
+  char *segment = data_;
+  for (size_t i = 0; i < msg_in_.msg_iovlen; ++i) {
+    msg->msg_iov[i].iov_base = segment;
+    msg->msg_iov[i].iov_len = msg_in_.msg_iov[i].iov_len;
+    segment += msg_in_.msg_iov[i].iov_len;
   }
-  return true;
 }
 
-bool asylo::BridgeMsghdrWrapper::CopyMsgControl() {
-  void *tmp_control_ptr = nullptr;
-  if (!CopyToUntrustedMemory(&tmp_control_ptr, msg_in_->msg_control,
-                             msg_in_->msg_controllen)) {
+bridge_msghdr *BridgeMsghdrWrapper::get_msg() const { return msg_out_.get(); }
+
+bool BridgeMsghdrWrapper::CopyAllBuffers() {
+  if (!msg_out_) {
     return false;
   }
-  if (tmp_control_ptr) {
-    msg_control_ptr_.reset(tmp_control_ptr);
-    msg_out_->msg_control = tmp_control_ptr;
+  if (name_) {
+    memcpy(name_, msg_in_.msg_name, msg_in_.msg_namelen);
+  }
+  if (control_) {
+    memcpy(control_, msg_in_.msg_control, msg_in_.msg_controllen);
+  }
+  char *segment = data_;
+  for (size_t i = 0; i < msg_in_.msg_iovlen; ++i) {
+    memcpy(segment, msg_in_.msg_iov[i].iov_base, msg_in_.msg_iov[i].iov_len);
+    segment += msg_in_.msg_iov[i].iov_len;
   }
   return true;
 }
 
-bool asylo::BridgeMsghdrWrapper::CopyAllBuffers() {
-  if (!CopyMsgName() || !CopyMsgIov() || !CopyMsgIovBase() ||
-      !CopyMsgControl()) {
-    return false;
+void BridgeMsghdrWrapper::CopyReceivedBuffers(size_t size,
+                                              struct msghdr *out) const {
+  if (!msg_out_) {
+    return;
+  }
+  CopyReceivedBuffers(size, out->msg_iov);
+
+  // The staged message is read once, since the host may change it at any
+  // time.
+  struct bridge_msghdr received = *msg_out_;
+  if (name_) {
+    out->msg_namelen = std::min<uint64_t>(received.msg_namelen,
+                                          msg_in_.msg_namelen);
+    memcpy(out->msg_name, name_, out->msg_namelen);
+  } else {
+    out->msg_namelen = 0;
+  }
+  if (control_) {
+    out->msg_controllen = std::min<uint64_t>(received.msg_controllen,
+                                             msg_in_.msg_controllen);
+    memcpy(out->msg_control, control_, out->msg_controllen);
+  } else {
+    out->msg_controllen = 0;
+  }
+  out->msg_flags = received.msg_flags;
+}
+
+void BridgeMsghdrWrapper::CopyReceivedBuffers(size_t size,
+                                              const struct iovec *iov) const {
+  if (!msg_out_) {
+    return;
+  }
+  size_t bytes_left = std::min(size, data_size_);
+  const char *segment = data_;
+  for (size_t i = 0; i < msg_in_.msg_iovlen && bytes_left > 0; ++i) {
+    size_t bytes_to_copy = std::min(bytes_left, msg_in_.msg_iov[i].iov_len);
+    memcpy(iov[i].iov_base, segment, bytes_to_copy);
+    segment += bytes_to_copy;
+    bytes_left -= bytes_to_copy;
   }
-  return true;
 }
+
+}  // namespace asylo
@@ -20,35 +20,79 @@
 #define ASYLO_PLATFORM_CORE_BRIDGE_MSGHDR_WRAPPER_H_
 
 #include <sys/socket.h>
-#include <vector>
+#include <sys/uio.h>
+#include <cstddef>
 
 #include "asylo/platform/arch/include/trusted/memory.h"
 #include "asylo/platform/common/bridge_types.h"
 
 namespace asylo {
 
-// This helper class wraps a bridge_msghdr and does a deep copy of all the
-// buffers to untrusted memory.
+// This helper class stages a msghdr in untrusted memory as a bridge_msghdr,
+// so that it can be passed to sendmsg() or recvmsg() on the host, or its
+// iovec array to writev() or readv().
+//
+// The bridge_msghdr, its iovec array, its name and control buffers and the
+// data of every iovec are laid out in a single untrusted allocation. Each
+// byte sent or received is copied across the enclave boundary once, directly
+// between the caller's buffers and their place in the staging area.
 class BridgeMsghdrWrapper {
  public:
+  // The largest number of iovecs a message may have, as on Linux.
+  static constexpr size_t kMaxIovecs = 1024;
+
+  // Lays out a staging area for |in|, which must outlive the wrapper. No
+  // buffer contents are copied yet. On failure, get_msg() returns nullptr and
+  // errno is set.
   explicit BridgeMsghdrWrapper(const struct msghdr *in);
+
+  // Stages |iovcnt| buffers described by |iov|, as for a message with no name
+  // or control data.
+  BridgeMsghdrWrapper(const struct iovec *iov, int iovcnt);
+
   BridgeMsghdrWrapper(const BridgeMsghdrWrapper &other) = delete;
   BridgeMsghdrWrapper &operator=(const BridgeMsghdrWrapper &other) = delete;
+
+  // Returns the staged message in untrusted memory, or nullptr if it could not
+  // be staged.
   bridge_msghdr *get_msg() const;
+
+  // Returns the total size of the staged iovec data, which bounds the number
+  // of bytes a receive into the staged message can produce.
+  size_t data_size() const { return data_size_; }
+
+  // Copies the name, the iovec data and the control data of the message into
+  // the staging area, for sending. Returns false and sets errno if the message
+  // could not be staged.
   bool CopyAllBuffers();
 
+  // Copies the results of receiving |size| bytes into the staged message back
+  // to |out|, which must be the message the wrapper was created from: the
+  // data into the iovec buffers, and the name, control data and flags along
+  // with their lengths. Lengths reported by the host are bounded by the staged
+  // buffer sizes.
+  void CopyReceivedBuffers(size_t size, struct msghdr *out) const;
+
+  // Copies |size| bytes received into the staged iovecs back to |iov|, which
+  // must be the iovecs the wrapper was created from.
+  void CopyReceivedBuffers(size_t size, const struct iovec *iov) const;
+
  private:
-  bool CopyMsgName();
-  bool CopyMsgIov();
-  bool CopyMsgIovBase();
-  bool CopyMsgControl();
+  // Allocates the staging area and points the staged message at its parts.
+  void Stage();
+
+  struct msghdr msg_in_;
+
+  // The total size of the iovec data.
+  size_t data_size_;
 
-  const msghdr *msg_in_;
   UntrustedUniquePtr<bridge_msghdr> msg_out_;
-  UntrustedUniquePtr<void> msg_name_ptr_;
-  UntrustedUniquePtr<void> msg_iov_ptr_;
-  UntrustedUniquePtr<void> msg_control_ptr_;
-  std::vector<UntrustedUniquePtr<void>> msg_iov_base_ptrs_;
+
+  // The parts of the staging area. These are kept inside the enclave, so that
+  // the host cannot redirect copies by changing the staged message.
+  char *name_;
+  char *control_;
+  char *data_;
 };
 
 }  // namespace asylo
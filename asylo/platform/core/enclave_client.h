@@ -19,12 +19,17 @@
 #ifndef ASYLO_PLATFORM_CORE_ENCLAVE_CLIENT_H_
 #define ASYLO_PLATFORM_CORE_ENCLAVE_CLIENT_H_
 
+#include <functional>
+#include <string>
+
 #include "absl/container/flat_hash_map.h"
 #include "absl/memory/memory.h"
+#include "asylo/crypto/util/byte_container_view.h"
 #include "asylo/enclave.pb.h"  // IWYU pragma: export
 #include "asylo/platform/arch/fork.pb.h"
 #include "asylo/platform/core/shared_name.h"
 #include "asylo/util/status.h"  // IWYU pragma: export
+#include "asylo/util/statusor.h"
 
 namespace asylo {
 
@@ -50,6 +55,72 @@ class EnclaveClient {
   virtual Status EnterAndRun(const EnclaveInput &input,
                              EnclaveOutput *output) = 0;
 
+  /// A consumer for the output of EnterAndRunRaw() and EnterAndRunStream(). The
+  /// output passed to it is only valid for the duration of the sink call.
+  using RawOutputSink = std::function<void(ByteContainerView output)>;
+
+  /// Enters the enclave and invokes its raw execution entry point.
+  ///
+  /// Unlike EnterAndRun(), the input and output are plain bytes handled by
+  /// TrustedApplication::RunRaw(), so large payloads are not wrapped in,
+  /// serialized to, or parsed from protobuf messages on either side of the
+  /// enclave boundary. The default implementation returns an UNIMPLEMENTED
+  /// error.
+  ///
+  /// \param input Bytes to pass to the enclave.
+  /// \param output_sink A nullable consumer for the bytes returned by the
+  ///                    enclave, which are passed to it without being copied.
+  /// \anchor enter-and-run-raw
+  virtual Status EnterAndRunRaw(ByteContainerView input,
+                                const RawOutputSink &output_sink) {
+    return Status(error::GoogleError::UNIMPLEMENTED,
+                  "EnterAndRunRaw is not supported by this client");
+  }
+
+  /// Enters the enclave and invokes its raw execution entry point, copying
+  /// the output into a string.
+  ///
+  /// \param input Bytes to pass to the enclave.
+  /// \param[out] output A nullable pointer to a string that receives the bytes
+  ///                    returned by the enclave.
+  Status EnterAndRunRaw(ByteContainerView input, std::string *output) {
+    return EnterAndRunRaw(input, [output](ByteContainerView bytes) {
+      if (output) {
+        output->assign(reinterpret_cast<const char *>(bytes.data()),
+                       bytes.size());
+      }
+    });
+  }
+
+  /// A producer for the input of EnterAndRunStream(). Each call writes the
+  /// next chunk of input to the first bytes of `buffer`, which holds
+  /// `capacity` bytes, and returns the number of bytes written. Returning zero
+  /// ends the input.
+  using StreamSource =
+      std::function<StatusOr<size_t>(char *buffer, size_t capacity)>;
+
+  /// Enters the enclave and invokes its streaming execution entry point.
+  ///
+  /// TrustedApplication::RunStream() pulls input from `source` and pushes
+  /// output to `output_sink` one bounded chunk at a time while the enclave is
+  /// running, so payloads larger than the enclave's memory can be processed.
+  /// Neither side of the enclave boundary holds the whole input or output at
+  /// once. The default implementation returns an UNIMPLEMENTED error.
+  ///
+  /// \param source A nullable producer of the input. A null source provides
+  ///               an empty input.
+  /// \param output_sink A nullable consumer for the output, which is called
+  ///                    once for every chunk written by the enclave. Each chunk
+  ///                    is only valid for the duration of the sink call.
+  /// \return The first error returned by `source` if there was one, or else
+  ///         the status returned by the enclave.
+  /// \anchor enter-and-run-stream
+  virtual Status EnterAndRunStream(const StreamSource &source,
+                                   const RawOutputSink &output_sink) {
+    return Status(error::GoogleError::UNIMPLEMENTED,
+                  "EnterAndRunStream is not supported by this client");
+  }
+
   /// Returns the name of the enclave.
   ///
   /// \return The name of the enclave.
@@ -69,6 +140,14 @@ class EnclaveClient {
   // Enters the enclave and invokes its initialization entry point.
   virtual Status EnterAndInitialize(const EnclaveConfig &config) = 0;
 
+  // Enters the enclave and invokes its initialization entry point, recording
+  // the phases of initialization timed inside the enclave in |trace|, which
+  // may be null. Clients that cannot time those phases leave |trace| alone.
+  virtual Status EnterAndInitialize(const EnclaveConfig &config,
+                                    EnclaveLoadTrace *trace) {
+    return EnterAndInitialize(config);
+  }
+
   // Enters the enclave and invokes its finalization entry point.
   virtual Status EnterAndFinalize(const EnclaveFinal &final_input) = 0;
 
@@ -25,9 +25,11 @@
 #include <thread>
 
 #include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
 
 #include "asylo/util/logging.h"
 #include "asylo/platform/common/time_util.h"
+#include "asylo/util/cleanup.h"
 #include "asylo/util/status_macros.h"
 
 namespace asylo {
@@ -49,6 +51,11 @@ int64_t RealTimeClock() {
   return TimeSpecToNanoseconds(&ts);
 }
 
+// Returns the nanoseconds elapsed since |start|.
+int64_t NanosecondsSince(absl::Time start) {
+  return absl::ToInt64Nanoseconds(absl::Now() - start);
+}
+
 // Sleeps for a interval specified in nanoseconds.
 void Sleep(int64_t nanoseconds) {
   struct timespec req;
@@ -295,41 +302,79 @@ Status EnclaveManager::LoadEnclave(const std::string &name,
                              enclave_size);
 }
 
+Status EnclaveManager::LoadEnclave(const std::string &name,
+                                   const EnclaveLoader &loader,
+                                   EnclaveConfig config,
+                                   EnclaveLoadTrace *trace) {
+  EnclaveConfig sanitized_config = std::move(config);
+  SetEnclaveConfigDefaults(host_config_, &sanitized_config);
+  return LoadEnclaveInternal(name, loader, sanitized_config,
+                             /*base_address=*/nullptr, /*enclave_size=*/0,
+                             trace);
+}
+
 Status EnclaveManager::LoadEnclaveInternal(const std::string &name,
                                            const EnclaveLoader &loader,
                                            const EnclaveConfig &config,
                                            void *base_address,
-                                           const size_t enclave_size) {
+                                           const size_t enclave_size,
+                                           EnclaveLoadTrace *trace) {
+  absl::Time start = absl::Now();
   if (config.enable_fork() && base_address) {
     // If fork is enabled and a base address is provided, it is now loading an
     // enclave in the child process. Remove the reference in the enclave table
     // that points to the enclave in the parent process.
     RemoveEnclaveReference(name);
   }
-  // Check whether a client with this name already exists.
-  {
-    absl::ReaderMutexLock lock(&client_table_lock_);
-    if (client_by_name_.find(name) != client_by_name_.end()) {
-      Status status(error::GoogleError::ALREADY_EXISTS,
-                    "Name already exists: " + name);
-      LOG(ERROR) << "LoadEnclave failed: " << status;
-      return status;
-    }
-  }
+  ASYLO_RETURN_IF_ERROR(ReserveEnclaveName(name));
+  Cleanup release_name([this, &name] { ReleaseEnclaveName(name); });
 
   // Attempt to load the enclave.
+  absl::Time load_start = absl::Now();
   StatusOr<std::unique_ptr<EnclaveClient>> result =
-      loader.LoadEnclave(name, base_address, enclave_size, config);
+      loader.LoadEnclave(name, base_address, enclave_size, config, trace);
+  if (trace) {
+    trace->set_load_ns(NanosecondsSince(load_start));
+  }
   if (!result.ok()) {
     LOG(ERROR) << "LoadEnclave failed: " << result.status();
     return result.status();
   }
 
+  Status status = InitializeLoadedEnclave(
+      name, std::move(result).ValueOrDie(), loader, config, trace);
+  if (trace) {
+    trace->set_total_ns(NanosecondsSince(start));
+  }
+  return status;
+}
+
+Status EnclaveManager::ReserveEnclaveName(const std::string &name) {
+  absl::WriterMutexLock lock(&client_table_lock_);
+  if (client_by_name_.find(name) != client_by_name_.end() ||
+      !loading_names_.insert(name).second) {
+    Status status(error::GoogleError::ALREADY_EXISTS,
+                  "Name already exists: " + name);
+    LOG(ERROR) << "LoadEnclave failed: " << status;
+    return status;
+  }
+  return Status::OkStatus();
+}
+
+void EnclaveManager::ReleaseEnclaveName(const std::string &name) {
+  absl::WriterMutexLock lock(&client_table_lock_);
+  loading_names_.erase(name);
+}
+
+Status EnclaveManager::InitializeLoadedEnclave(
+    const std::string &name, std::unique_ptr<EnclaveClient> loaded_client,
+    const EnclaveLoader &loader, const EnclaveConfig &config,
+    EnclaveLoadTrace *trace) {
   // Add the client to the lookup tables.
-  EnclaveClient *client = result.ValueOrDie().get();
+  EnclaveClient *client = loaded_client.get();
   {
     absl::WriterMutexLock lock(&client_table_lock_);
-    client_by_name_.emplace(name, std::move(result).ValueOrDie());
+    client_by_name_.emplace(name, std::move(loaded_client));
     name_by_client_.emplace(client, name);
 
     if (config.enable_fork()) {
@@ -341,7 +386,11 @@ Status EnclaveManager::LoadEnclaveInternal(const std::string &name,
     }
   }
 
-  Status status = client->EnterAndInitialize(config);
+  absl::Time initialize_start = absl::Now();
+  Status status = client->EnterAndInitialize(config, trace);
+  if (trace) {
+    trace->set_enter_and_initialize_ns(NanosecondsSince(initialize_start));
+  }
   // If initialization fails, don't keep the enclave registered. GetClient will
   // return a nullptr rather than an enclave in a bad state.
   if (!status.ok()) {
@@ -360,6 +409,168 @@ Status EnclaveManager::LoadEnclaveInternal(const std::string &name,
   return status;
 }
 
+Status EnclaveManager::CreateEnclavePool(const std::string &pool_name,
+                                         const EnclaveLoader &loader,
+                                         EnclaveConfig config, size_t size) {
+  if (size == 0) {
+    return Status(error::GoogleError::INVALID_ARGUMENT,
+                  "Enclave pool size must be positive");
+  }
+
+  auto pool = std::make_shared<EnclavePool>();
+  pool->name = pool_name;
+  ASYLO_ASSIGN_OR_RETURN(pool->loader, loader.Copy());
+  pool->config = std::move(config);
+  SetEnclaveConfigDefaults(host_config_, &pool->config);
+  pool->size = size;
+
+  absl::MutexLock lock(&pool_table_lock_);
+  if (!pool_by_name_.emplace(pool_name, pool).second) {
+    return Status(error::GoogleError::ALREADY_EXISTS,
+                  "Pool name already exists: " + pool_name);
+  }
+  RefillEnclavePool(std::move(pool));
+  return Status::OkStatus();
+}
+
+Status EnclaveManager::LoadEnclaveFromPool(const std::string &name,
+                                           const std::string &pool_name) {
+  std::shared_ptr<EnclavePool> pool;
+  {
+    absl::MutexLock lock(&pool_table_lock_);
+    auto it = pool_by_name_.find(pool_name);
+    if (it == pool_by_name_.end()) {
+      return Status(error::GoogleError::NOT_FOUND,
+                    "No enclave pool named: " + pool_name);
+    }
+    pool = it->second;
+  }
+
+  // Reserve the name before taking an enclave out of the pool, so that the
+  // enclave is not lost if the name is taken.
+  ASYLO_RETURN_IF_ERROR(ReserveEnclaveName(name));
+  Cleanup release_name([this, &name] { ReleaseEnclaveName(name); });
+
+  std::unique_ptr<EnclaveClient> client;
+  {
+    absl::MutexLock lock(&pool_table_lock_);
+    if (!pool->parked.empty()) {
+      client = std::move(pool->parked.front());
+      pool->parked.pop_front();
+    }
+    RefillEnclavePool(pool);
+  }
+
+  // The loader and config of a pool never change once it is created, so they
+  // are used without holding |pool_table_lock_|.
+  if (client) {
+    client->name_ = name;
+  } else {
+    // The pool has run dry, so load an enclave on demand.
+    StatusOr<std::unique_ptr<EnclaveClient>> result = pool->loader->LoadEnclave(
+        name, /*base_address=*/nullptr, /*enclave_size=*/0, pool->config);
+    if (!result.ok()) {
+      LOG(ERROR) << "LoadEnclaveFromPool failed: " << result.status();
+      return result.status();
+    }
+    client = std::move(result).ValueOrDie();
+  }
+  return InitializeLoadedEnclave(name, std::move(client), *pool->loader,
+                                 pool->config, /*trace=*/nullptr);
+}
+
+Status EnclaveManager::DestroyEnclavePool(const std::string &pool_name) {
+  std::deque<std::unique_ptr<EnclaveClient>> parked;
+  {
+    absl::MutexLock lock(&pool_table_lock_);
+    auto it = pool_by_name_.find(pool_name);
+    if (it == pool_by_name_.end()) {
+      return Status(error::GoogleError::NOT_FOUND,
+                    "No enclave pool named: " + pool_name);
+    }
+    std::shared_ptr<EnclavePool> pool = std::move(it->second);
+    pool_by_name_.erase(it);
+
+    // Wait for the refill thread to notice, so that no enclave it loads
+    // outlives the pool.
+    pool->destroyed = true;
+    pool_table_lock_.Await(absl::Condition(
+        +[](EnclavePool *pool) { return !pool->refilling; }, pool.get()));
+    parked.swap(pool->parked);
+  }
+
+  Status status = Status::OkStatus();
+  for (std::unique_ptr<EnclaveClient> &client : parked) {
+    Status destroy_status = client->DestroyEnclave();
+    if (!destroy_status.ok()) {
+      LOG(ERROR) << "DestroyEnclave failed for a parked enclave: "
+                 << destroy_status;
+      status = destroy_status;
+    }
+  }
+  return status;
+}
+
+size_t EnclaveManager::GetEnclavePoolSize(const std::string &pool_name) const {
+  absl::MutexLock lock(&pool_table_lock_);
+  auto it = pool_by_name_.find(pool_name);
+  if (it == pool_by_name_.end()) {
+    return 0;
+  }
+  return it->second->parked.size();
+}
+
+void EnclaveManager::RefillEnclavePool(std::shared_ptr<EnclavePool> pool) {
+  if (pool->refilling || pool->destroyed ||
+      pool->parked.size() >= pool->size) {
+    return;
+  }
+  pool->refilling = true;
+  std::thread refill([this, pool] { RefillLoop(pool); });
+  refill.detach();
+}
+
+void EnclaveManager::RefillLoop(const std::shared_ptr<EnclavePool> &pool) {
+  while (true) {
+    {
+      absl::MutexLock lock(&pool_table_lock_);
+      if (pool->destroyed || pool->parked.size() >= pool->size) {
+        pool->refilling = false;
+        return;
+      }
+    }
+
+    // Parked enclaves are named after their pool until they are handed out.
+    StatusOr<std::unique_ptr<EnclaveClient>> result =
+        pool->loader->LoadEnclave(pool->name, /*base_address=*/nullptr,
+                                  /*enclave_size=*/0, pool->config);
+    if (!result.ok()) {
+      // Give up until the next enclave is taken from the pool rather than
+      // retrying a failing load in a tight loop.
+      LOG(ERROR) << "Failed to refill enclave pool " << pool->name << ": "
+                 << result.status();
+      absl::MutexLock lock(&pool_table_lock_);
+      pool->refilling = false;
+      return;
+    }
+
+    std::unique_ptr<EnclaveClient> client = std::move(result).ValueOrDie();
+    bool destroyed;
+    {
+      absl::MutexLock lock(&pool_table_lock_);
+      destroyed = pool->destroyed;
+      if (!destroyed) {
+        pool->parked.push_back(std::move(client));
+      }
+    }
+    if (destroyed) {
+      Status status = client->DestroyEnclave();
+      LOG_IF(ERROR, !status.ok())
+          << "DestroyEnclave failed for a parked enclave: " << status;
+    }
+  }
+}
+
 void EnclaveManager::RemoveEnclaveReference(const std::string &name) {
   absl::WriterMutexLock lock(&client_table_lock_);
   EnclaveClient *client = client_by_name_[name].get();
@@ -22,10 +22,14 @@
 // Declares the enclave client API, providing types and methods for loading,
 // accessing, and finalizing enclaves.
 
+#include <cstddef>
+#include <deque>
+#include <memory>
 #include <string>
 #include <utility>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
@@ -151,6 +155,9 @@ class EnclaveManagerOptions {
 /// initial configuration to the enclaves it launches. The contents of the
 /// EnclaveManagerOptions instance control how the default values for the
 /// configuration are chosen.
+///
+/// Enclaves bound to different names may be loaded concurrently from several
+/// threads.
 class EnclaveManager {
  public:
   /// Fetches the EnclaveManager singleton instance.
@@ -213,6 +220,88 @@ class EnclaveManager {
                      EnclaveConfig config, void *base_address = nullptr,
                      const size_t enclave_size = 0);
 
+  /// Loads an enclave and traces its startup.
+  ///
+  /// Loads a new enclave with custom enclave config settings and binds it to a
+  /// name, as above, and records how long each phase of loading took. Phases
+  /// that `loader` does not go through are left unset in `trace`.
+  ///
+  /// Example:
+  ///
+  /// ```
+  ///  EnclaveLoadTrace trace;
+  ///  LoadEnclave("/EchoEnclave", SgxLoader("echoService.so"), config, &trace);
+  ///  LOG(INFO) << trace.DebugString();
+  /// ```
+  ///
+  /// \param name Name to bind the loaded enclave under.
+  /// \param loader Configured enclave loader to load from.
+  /// \param config Enclave configuration to launch the enclave with.
+  /// \param[out] trace The durations of the phases of loading, which are
+  ///                   recorded even if loading fails.
+  Status LoadEnclave(const std::string &name, const EnclaveLoader &loader,
+                     EnclaveConfig config, EnclaveLoadTrace *trace);
+
+  /// Creates a pool of pre-loaded enclaves.
+  ///
+  /// Keeps `size` enclaves loaded by `loader` with custom enclave config
+  /// settings parked under a pool name, so that LoadEnclaveFromPool() does not
+  /// pay for creating an enclave. Parked enclaves are loaded but not
+  /// initialized, since initialization binds an enclave to its name. The pool
+  /// is filled, and refilled after each enclave handed out, by a background
+  /// thread.
+  ///
+  /// It is an error to specify a pool name which is already bound to a pool.
+  ///
+  /// Example:
+  /// ```
+  ///   CreateEnclavePool("/EchoPool", SgxLoader("echoService.so"), config, 4);
+  ///   ...
+  ///   LoadEnclaveFromPool("/EchoEnclave", "/EchoPool");
+  /// ```
+  ///
+  /// \param pool_name Name to bind the pool under.
+  /// \param loader Configured enclave loader to load from. The loader must
+  ///               support being copied.
+  /// \param config Enclave configuration to launch the enclaves with.
+  /// \param size The number of enclaves to keep parked in the pool.
+  Status CreateEnclavePool(const std::string &pool_name,
+                           const EnclaveLoader &loader, EnclaveConfig config,
+                           size_t size) LOCKS_EXCLUDED(pool_table_lock_);
+
+  /// Loads an enclave from a pool.
+  ///
+  /// Takes an enclave parked in a pool, binds it to a name and initializes it.
+  /// If the pool is empty, an enclave is loaded with the loader and config of
+  /// the pool instead, as LoadEnclave() would.
+  ///
+  /// It is an error to specify a name which is already bound to an enclave.
+  ///
+  /// \param name Name to bind the loaded enclave under.
+  /// \param pool_name Name of the pool to take the enclave from.
+  Status LoadEnclaveFromPool(const std::string &name,
+                             const std::string &pool_name)
+      LOCKS_EXCLUDED(pool_table_lock_, client_table_lock_);
+
+  /// Destroys a pool.
+  ///
+  /// Destroys the enclaves parked in a pool without finalizing them, since they
+  /// were never initialized, after waiting for any background refill to stop.
+  /// Enclaves already loaded from the pool are not affected.
+  ///
+  /// \param pool_name Name of the pool to destroy.
+  Status DestroyEnclavePool(const std::string &pool_name)
+      LOCKS_EXCLUDED(pool_table_lock_);
+
+  /// Returns the number of enclaves parked in a pool.
+  ///
+  /// \param pool_name Name of a pool that may be registered in the
+  ///                  EnclaveManager.
+  /// \return The number of enclaves ready to be handed out, or 0 if no pool is
+  ///         bound to `pool_name`.
+  size_t GetEnclavePoolSize(const std::string &pool_name) const
+      LOCKS_EXCLUDED(pool_table_lock_);
+
   /// Fetches a client to a loaded enclave.
   ///
   /// \param name The name of an EnclaveClient that may be registered in the
@@ -308,14 +397,64 @@ class EnclaveManager {
 
   // Loads a new enclave with custom enclave config settings and binds it to a
   // name. The actual work of opening the enclave is delegated to the passed
-  // loader object.
+  // loader object. If |trace| is not null, the phases of loading are recorded
+  // in it.
   Status LoadEnclaveInternal(const std::string &name,
                              const EnclaveLoader &loader,
                              const EnclaveConfig &config,
                              void *base_address = nullptr,
-                             const size_t enclave_size = 0)
+                             const size_t enclave_size = 0,
+                             EnclaveLoadTrace *trace = nullptr)
+      LOCKS_EXCLUDED(client_table_lock_);
+
+  // Reserves |name| for an enclave that is being loaded, so that other
+  // enclaves can be loaded concurrently while loads under the same name fail.
+  // Returns an error if the name is bound or reserved already.
+  Status ReserveEnclaveName(const std::string &name)
+      LOCKS_EXCLUDED(client_table_lock_);
+
+  // Releases a name reserved by ReserveEnclaveName().
+  void ReleaseEnclaveName(const std::string &name)
       LOCKS_EXCLUDED(client_table_lock_);
 
+  // Enclaves of one loader and config, loaded ahead of time.
+  struct EnclavePool {
+    std::string name;
+    std::unique_ptr<EnclaveLoader> loader;
+    EnclaveConfig config;
+
+    // The number of enclaves the pool is kept filled to.
+    size_t size;
+
+    // Loaded enclaves waiting to be handed out.
+    std::deque<std::unique_ptr<EnclaveClient>> parked;
+
+    // Whether a background thread is refilling the pool.
+    bool refilling = false;
+
+    // Set when the pool is destroyed, so that a running refill stops.
+    bool destroyed = false;
+  };
+
+  // Binds a loaded enclave to a name and initializes it. If initialization
+  // fails, the enclave is destroyed and no name is bound. If |trace| is not
+  // null, the phases of initialization are recorded in it.
+  Status InitializeLoadedEnclave(const std::string &name,
+                                 std::unique_ptr<EnclaveClient> client,
+                                 const EnclaveLoader &loader,
+                                 const EnclaveConfig &config,
+                                 EnclaveLoadTrace *trace)
+      LOCKS_EXCLUDED(client_table_lock_);
+
+  // Starts a background refill of |pool| unless one is running already.
+  void RefillEnclavePool(std::shared_ptr<EnclavePool> pool)
+      EXCLUSIVE_LOCKS_REQUIRED(pool_table_lock_);
+
+  // Loads enclaves into |pool| until it is full or destroyed. Run by the
+  // refill thread.
+  void RefillLoop(const std::shared_ptr<EnclavePool> &pool)
+      LOCKS_EXCLUDED(pool_table_lock_);
+
   // Deletes an enclave client reference that points to an enclave that no
   // longer exists. This should only happen during fork.
   void RemoveEnclaveReference(const std::string &name)
@@ -340,9 +479,14 @@ class EnclaveManager {
   std::atomic<int64_t> clock_realtime_;
 
   // A mutex guarding |client_by_name_|, |name_by_client_|, and
-  // |loader_by_client_| tables.
+  // |loader_by_client_| tables, and the |loading_names_| set. It is not held
+  // while an enclave is loaded or initialized.
   mutable absl::Mutex client_table_lock_;
 
+  // Names reserved by loads in progress.
+  absl::flat_hash_set<std::string> loading_names_
+      GUARDED_BY(client_table_lock_);
+
   absl::flat_hash_map<std::string, std::unique_ptr<EnclaveClient>>
       client_by_name_ GUARDED_BY(client_table_lock_);
   absl::flat_hash_map<const EnclaveClient *, std::string> name_by_client_
@@ -351,6 +495,12 @@ class EnclaveManager {
   absl::flat_hash_map<const EnclaveClient *, std::unique_ptr<EnclaveLoader>>
       loader_by_client_ GUARDED_BY(client_table_lock_);
 
+  // A mutex guarding |pool_by_name_| and the contents of every pool.
+  mutable absl::Mutex pool_table_lock_;
+
+  absl::flat_hash_map<std::string, std::shared_ptr<EnclavePool>> pool_by_name_
+      GUARDED_BY(pool_table_lock_);
+
   // A part of the configuration for enclaves launched by the enclave manager
   // comes from the Asylo daemon. This member caches such configuration.
   HostConfig host_config_;
@@ -396,6 +546,15 @@ class EnclaveLoader {
       const std::string &name, void *base_address, const size_t enclave_size,
       const EnclaveConfig &config) const = 0;
 
+  // Loads an enclave at the specified address as above, recording the phases
+  // of loading in |trace|, which may be null. Loaders that do not break down
+  // their loading time leave |trace| alone.
+  virtual StatusOr<std::unique_ptr<EnclaveClient>> LoadEnclave(
+      const std::string &name, void *base_address, const size_t enclave_size,
+      const EnclaveConfig &config, EnclaveLoadTrace *trace) const {
+    return LoadEnclave(name, base_address, enclave_size, config);
+  }
+
   // Gets a copy of the loader that loaded a previous enclave. This is only used
   // by fork to load a child enclave with the same loader as the parent.
   virtual StatusOr<std::unique_ptr<EnclaveLoader>> Copy() const = 0;
@@ -44,7 +44,7 @@ extern "C" {
 // User-defined enclave initialization routine.
 //
 // The input type is asylo::EnclaveConfig.
-// The output type is asylo::StatusProto.
+// The output type is asylo::EnclaveInitializeOutput.
 int __asylo_user_init(const char *name, const char *config, size_t config_len,
                       char **output, size_t *output_len);
 
@@ -55,6 +55,22 @@ int __asylo_user_init(const char *name, const char *config, size_t config_len,
 int __asylo_user_run(const char *input, size_t input_len, char **output,
                      size_t *output_len);
 
+// User-defined raw enclave execution routine.
+//
+// The input and output are uninterpreted bytes passed to and returned from
+// TrustedApplication::RunRaw(). If RunRaw() fails, *|output_is_status| is set
+// and the output type is asylo::StatusProto instead. An empty output may leave
+// |output| null.
+int __asylo_user_run_raw(const char *input, size_t input_len, char **output,
+                         size_t *output_len, int *output_is_status);
+
+// User-defined streaming enclave execution routine.
+//
+// |channel| is an opaque pointer to the host end of the stream, which is passed
+// back to the host calls that read stream input and write stream output.
+// The output type is asylo::StatusProto.
+int __asylo_user_run_stream(void *channel, char **output, size_t *output_len);
+
 // User-defined enclave finalization routine.
 //
 // The input type is asylo::EnclaveFinal.
@@ -0,0 +1,65 @@
+/*
+ *
+ * Copyright 2018 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/core/stream_channel.h"
+
+#include <algorithm>
+
+#include "asylo/platform/arch/include/trusted/host_calls.h"
+
+namespace asylo {
+
+constexpr size_t StreamChannel::kMaxChunkSize;
+
+StatusOr<size_t> StreamChannel::Read(void *buffer, size_t size) {
+  if (end_of_input_ || size == 0) {
+    return 0;
+  }
+  size_t count = std::min(size, kMaxChunkSize);
+  ssize_t result = enc_untrusted_stream_read(host_channel_, buffer, count);
+  if (result < 0) {
+    return Status(error::GoogleError::ABORTED,
+                  "Host failed to produce stream input");
+  }
+  // The host is untrusted, so do not take its word for how much was read.
+  if (static_cast<size_t>(result) > count) {
+    return Status(error::GoogleError::INTERNAL,
+                  "Host returned more stream input than requested");
+  }
+  if (result == 0) {
+    end_of_input_ = true;
+  }
+  return static_cast<size_t>(result);
+}
+
+Status StreamChannel::Write(ByteContainerView data) {
+  const uint8_t *next = data.data();
+  size_t remaining = data.size();
+  while (remaining > 0) {
+    size_t count = std::min(remaining, kMaxChunkSize);
+    if (enc_untrusted_stream_write(host_channel_, next, count) != 0) {
+      return Status(error::GoogleError::ABORTED,
+                    "Host failed to consume stream output");
+    }
+    next += count;
+    remaining -= count;
+  }
+  return Status::OkStatus();
+}
+
+}  // namespace asylo
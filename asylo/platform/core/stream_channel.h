@@ -0,0 +1,86 @@
+/*
+ *
+ * Copyright 2018 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_CORE_STREAM_CHANNEL_H_
+#define ASYLO_PLATFORM_CORE_STREAM_CHANNEL_H_
+
+#include <cstddef>
+
+#include "asylo/crypto/util/byte_container_view.h"
+#include "asylo/platform/core/entry_points.h"
+#include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+
+/// The enclave end of a stream opened by EnclaveClient::EnterAndRunStream().
+///
+/// Input is pulled from the host one chunk at a time, and output is pushed to
+/// the host one chunk at a time, so neither the input nor the output of a
+/// stream is ever held in trusted memory as a whole. Every chunk crosses the
+/// enclave boundary in a single host call of at most kMaxChunkSize bytes.
+///
+/// A StreamChannel is only valid for the duration of the
+/// TrustedApplication::RunStream() call it is passed to.
+class StreamChannel {
+ public:
+  /// The largest number of bytes moved across the enclave boundary by a single
+  /// call to Read() or by each host call made by Write().
+  static constexpr size_t kMaxChunkSize = 64 * 1024;
+
+  StreamChannel(const StreamChannel &other) = delete;
+  StreamChannel &operator=(const StreamChannel &other) = delete;
+
+  /// Reads the next chunk of input into a trusted buffer.
+  ///
+  /// Like read(2), this may return fewer bytes than requested even before the
+  /// end of the input is reached.
+  ///
+  /// \param buffer The buffer to read into.
+  /// \param size The size of `buffer`.
+  /// \return The number of bytes read, which is zero only at the end of the
+  ///         input or if `size` is zero, or an error if the host failed to
+  ///         produce input.
+  StatusOr<size_t> Read(void *buffer, size_t size);
+
+  /// Passes bytes to the host as output, in chunks of at most kMaxChunkSize
+  /// bytes.
+  ///
+  /// \param data The bytes to write.
+  /// \return OK status or error.
+  Status Write(ByteContainerView data);
+
+ private:
+  friend int __asylo_user_run_stream(void *channel, char **output,
+                                     size_t *output_len);
+
+  // Creates the enclave end of the stream whose host end is |host_channel|, an
+  // opaque pointer to untrusted memory.
+  explicit StreamChannel(void *host_channel)
+      : host_channel_(host_channel), end_of_input_(false) {}
+
+  void *const host_channel_;
+
+  // Set once the host reports the end of the input, after which Read() no
+  // longer exits the enclave.
+  bool end_of_input_;
+};
+
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_CORE_STREAM_CHANNEL_H_
@@ -37,7 +37,15 @@ class LockTest : public ::testing::Test {
   LockType non_recursive_;
 };
 
-typedef ::testing::Types<UntrustedMutex, TrustedSpinLock, TrustedMutex>
+// A TrustedSpinLock that parks waiting threads after spinning briefly.
+class AdaptiveTrustedSpinLock : public TrustedSpinLock {
+ public:
+  explicit AdaptiveTrustedSpinLock(bool is_recursive)
+      : TrustedSpinLock(is_recursive, /*is_adaptive=*/true) {}
+};
+
+typedef ::testing::Types<UntrustedMutex, TrustedSpinLock,
+                         AdaptiveTrustedSpinLock, TrustedMutex>
     Implementations;
 
 TYPED_TEST_CASE(LockTest, Implementations);
@@ -19,11 +19,13 @@
 #include "asylo/platform/core/trusted_application.h"
 
 #include <sys/ucontext.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <cerrno>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <string>
 
@@ -36,6 +38,7 @@
 #include "asylo/platform/arch/include/trusted/host_calls.h"
 #include "asylo/platform/arch/include/trusted/time.h"
 #include "asylo/platform/common/bridge_functions.h"
+#include "asylo/platform/common/time_util.h"
 #include "asylo/platform/core/shared_name_kind.h"
 #include "asylo/platform/core/trusted_global_state.h"
 #include "asylo/platform/core/untrusted_cache_malloc.h"
@@ -54,6 +57,13 @@ using google::protobuf::RepeatedPtrField;
 namespace asylo {
 namespace {
 
+// Returns the value of the enclave monotonic clock as a number of nanoseconds.
+int64_t MonotonicClock() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return TimeSpecToNanoseconds(&ts);
+}
+
 void LogError(const Status &status) {
   EnclaveState state = GetApplicationInstance()->GetState();
   if (state < EnclaveState::kUserInitializing) {
@@ -212,7 +222,9 @@ Status InitializeEnvironmentVariables(
   return Status::OkStatus();
 }
 
-Status TrustedApplication::InitializeInternal(const EnclaveConfig &config) {
+Status TrustedApplication::InitializeInternal(const EnclaveConfig &config,
+                                              EnclaveLoadTrace *trace) {
+  int64_t start = MonotonicClock();
   InitializeIO(config);
   Status status =
       InitializeEnvironmentVariables(config.environment_variables());
@@ -237,7 +249,11 @@ Status TrustedApplication::InitializeInternal(const EnclaveConfig &config) {
 
   ASYLO_RETURN_IF_ERROR(VerifyAndSetState(EnclaveState::kInternalInitializing,
                                           EnclaveState::kUserInitializing));
-  return Initialize(config);
+  int64_t runtime_initialized = MonotonicClock();
+  trace->set_runtime_initialize_ns(runtime_initialized - start);
+  status = Initialize(config);
+  trace->set_application_initialize_ns(MonotonicClock() - runtime_initialized);
+  return status;
 }
 
 void InitializeIO(const EnclaveConfig &config) {
@@ -301,14 +317,20 @@ int __asylo_user_init(const char *name, const char *config, size_t config_len,
     return 1;
   }
 
-  StatusSerializer<StatusProto> status_serializer(output, output_len);
+  EnclaveInitializeOutput initialize_output;
+  StatusSerializer<EnclaveInitializeOutput> status_serializer(
+      &initialize_output, initialize_output.mutable_status(), output,
+      output_len);
 
+  int64_t start = MonotonicClock();
   EnclaveConfig enclave_config;
   if (!enclave_config.ParseFromArray(config, config_len)) {
     status = Status(error::GoogleError::INVALID_ARGUMENT,
                     "Failed to parse EnclaveConfig");
     return status_serializer.Serialize(status);
   }
+  initialize_output.mutable_trace()->set_config_parsing_ns(MonotonicClock() -
+                                                           start);
 
   TrustedApplication *trusted_application = GetApplicationInstance();
   status = trusted_application->VerifyAndSetState(
@@ -319,7 +341,8 @@ int __asylo_user_init(const char *name, const char *config, size_t config_len,
 
   SetEnclaveName(name);
   // Invoke the enclave entry-point.
-  status = trusted_application->InitializeInternal(enclave_config);
+  status = trusted_application->InitializeInternal(
+      enclave_config, initialize_output.mutable_trace());
   if (!status.ok()) {
     trusted_application->SetState(EnclaveState::kUninitialized);
     return status_serializer.Serialize(status);
@@ -360,6 +383,68 @@ int __asylo_user_run(const char *input, size_t input_len, char **output,
   return status_serializer.Serialize(status);
 }
 
+int __asylo_user_run_raw(const char *input, size_t input_len, char **output,
+                         size_t *output_len, int *output_is_status) {
+  Status status = VerifyOutputArguments(output, output_len);
+  if (!status.ok() || !output_is_status) {
+    return 1;
+  }
+
+  std::string raw_output;
+  TrustedApplication *trusted_application = GetApplicationInstance();
+  if (trusted_application->GetState() != EnclaveState::kRunning) {
+    status = Status(error::GoogleError::FAILED_PRECONDITION,
+                    "Enclave not in state RUNNING");
+  } else {
+    // Invoke the enclave entry-point.
+    status = trusted_application->RunRaw(ByteContainerView(input, input_len),
+                                         &raw_output);
+  }
+
+  if (!status.ok()) {
+    *output_is_status = 1;
+    StatusSerializer<StatusProto> status_serializer(output, output_len);
+    return status_serializer.Serialize(status);
+  }
+
+  // The output is copied straight into untrusted memory, without the
+  // serialization buffer used for protobuf outputs.
+  *output_is_status = 0;
+  *output_len = raw_output.size();
+  *output = nullptr;
+  if (!raw_output.empty()) {
+    *output = reinterpret_cast<char *>(
+        UntrustedCacheMalloc::Instance()->Malloc(raw_output.size()));
+    if (!*output) {
+      *output_len = 0;
+      return 1;
+    }
+    memcpy(*output, raw_output.data(), raw_output.size());
+  }
+  return 0;
+}
+
+int __asylo_user_run_stream(void *channel, char **output, size_t *output_len) {
+  Status status = VerifyOutputArguments(output, output_len);
+  if (!status.ok()) {
+    return 1;
+  }
+
+  StatusSerializer<StatusProto> status_serializer(output, output_len);
+
+  TrustedApplication *trusted_application = GetApplicationInstance();
+  if (trusted_application->GetState() != EnclaveState::kRunning) {
+    status = Status(error::GoogleError::FAILED_PRECONDITION,
+                    "Enclave not in state RUNNING");
+    return status_serializer.Serialize(status);
+  }
+
+  // Invoke the enclave entry-point.
+  StreamChannel stream_channel(channel);
+  status = trusted_application->RunStream(&stream_channel);
+  return status_serializer.Serialize(status);
+}
+
 int __asylo_user_fini(const char *input, size_t input_len, char **output,
                       size_t *output_len) {
   Status status = VerifyOutputArguments(output, output_len);
@@ -23,9 +23,11 @@
 
 #include <string>
 
+#include "asylo/crypto/util/byte_container_view.h"
 #include "asylo/enclave.pb.h"
 #include "asylo/platform/arch/fork.pb.h"
 #include "asylo/platform/core/entry_points.h"
+#include "asylo/platform/core/stream_channel.h"
 #include "asylo/platform/core/trusted_global_state.h"
 #include "asylo/util/status.h"
 
@@ -89,7 +91,8 @@ class TrustedApplication {
   };
 
   /// \private
-  Status InitializeInternal(const EnclaveConfig &config);
+  Status InitializeInternal(const EnclaveConfig &config,
+                            EnclaveLoadTrace *trace);
 
   /// Implements enclave initialization entry-point.
   ///
@@ -110,6 +113,41 @@ class TrustedApplication {
     return Status::OkStatus();
   }
 
+  /// Implements the raw enclave execution entry-point.
+  ///
+  /// Invoked by EnclaveClient::EnterAndRunRaw(). Unlike Run(), the input and
+  /// output are plain bytes, so large payloads are not wrapped in, serialized
+  /// to, or parsed from protobuf messages on their way through the enclave
+  /// boundary.
+  ///
+  /// \param input Bytes passed by the untrusted caller, which are only valid
+  ///              for the duration of the call.
+  /// \param output Bytes passed back to the untrusted caller.
+  /// \return OK status or error. The default implementation returns an
+  ///         UNIMPLEMENTED error.
+  /// \anchor run-raw
+  virtual Status RunRaw(ByteContainerView input, std::string *output) {
+    return Status(error::GoogleError::UNIMPLEMENTED,
+                  "RunRaw is not implemented by this enclave");
+  }
+
+  /// Implements the streaming enclave execution entry-point.
+  ///
+  /// Invoked by EnclaveClient::EnterAndRunStream(). Input is read from and
+  /// output is written to `channel` in chunks while the call is in progress,
+  /// so an implementation that processes its input incrementally needs only a
+  /// bounded amount of trusted memory, however large the stream is.
+  ///
+  /// \param channel The enclave end of the stream, which is only valid for the
+  ///                duration of the call.
+  /// \return OK status or error. The default implementation returns an
+  ///         UNIMPLEMENTED error.
+  /// \anchor run-stream
+  virtual Status RunStream(StreamChannel *channel) {
+    return Status(error::GoogleError::UNIMPLEMENTED,
+                  "RunStream is not implemented by this enclave");
+  }
+
   /// Implements enclave finalization behavior.
   ///
   /// \param final_input Message passed on enclave finalization.
@@ -148,6 +186,11 @@ class TrustedApplication {
                                size_t *output_len);
   friend int __asylo_user_run(const char *input, size_t input_len,
                               char **output, size_t *output_len);
+  friend int __asylo_user_run_raw(const char *input, size_t input_len,
+                                  char **output, size_t *output_len,
+                                  int *output_is_status);
+  friend int __asylo_user_run_stream(void *channel, char **output,
+                                     size_t *output_len);
   friend int __asylo_user_fini(const char *input, size_t input_len,
                                char **output, size_t *output_len);
   friend int __asylo_threading_donate();
@@ -30,6 +30,15 @@ TrustedMutex::TrustedMutex(bool is_recursive)
     : untrusted_mutex_(is_recursive), trusted_spin_lock_(is_recursive) {}
 
 void TrustedMutex::Lock() {
+  // Spin for a bounded number of attempts before exiting the enclave to park on
+  // the untrusted mutex, since most critical sections are short.
+  for (int i = 0; i < TrustedSpinLock::kAdaptiveSpinIterations; i++) {
+    if (TryLock()) {
+      return;
+    }
+    enc_pause();
+  }
+
   untrusted_mutex_.Lock();
   if (!trusted_spin_lock_.TryLock()) {
     abort();
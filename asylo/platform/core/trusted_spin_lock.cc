@@ -22,13 +22,14 @@
 #include <cstdlib>
 
 #include "asylo/platform/arch/include/trusted/host_calls.h"
+#include "asylo/platform/core/untrusted_cache_malloc.h"
 
 namespace asylo {
 namespace {
 
 // Aborts if the value of the |spin_lock| is invalid.
 void ValidateSpinLock(uint32_t spin_lock) {
-  if (spin_lock > TrustedSpinLock::kLocked) {
+  if (spin_lock > TrustedSpinLock::kQueued) {
     char buf[1024];
     snprintf(buf, sizeof(buf),
              "Invalid spin lock value in TrustedSpinLock operation: %u\n",
@@ -40,10 +41,82 @@ void ValidateSpinLock(uint32_t spin_lock) {
 
 }  // namespace
 
+TrustedSpinLock::~TrustedSpinLock() {
+  if (untrusted_futex_) {
+    UntrustedCacheMalloc::Instance()->Free(untrusted_futex_);
+  }
+}
+
 void TrustedSpinLock::Lock() {
-  while (!TryLock()) {
+  if (!is_adaptive_) {
+    while (!TryLock()) {
+      enc_pause();
+    }
+    return;
+  }
+
+  for (int i = 0; i < kAdaptiveSpinIterations; i++) {
+    if (TryLock()) {
+      return;
+    }
     enc_pause();
   }
+  LockSlow();
+}
+
+void TrustedSpinLock::LockSlow() {
+  int32_t *futex = GetUntrustedFutex();
+  if (!futex) {
+    // Without a futex the calling thread cannot park, so it keeps spinning.
+    while (!TryLock()) {
+      enc_pause();
+    }
+    return;
+  }
+
+  // Mark the lock as queued whenever the calling thread is about to park, so
+  // that the owner wakes a parked thread when it releases the lock. A thread
+  // that acquires the lock here leaves it marked as queued since other threads
+  // may still be parked.
+  while (AtomicExchange(&spin_lock_, kQueued) != kUnlocked) {
+    // Read the sequence number before re-checking the lock word, so that a
+    // wakeup issued between the check and the wait makes the wait return.
+    int32_t sequence = __atomic_load_n(futex, __ATOMIC_SEQ_CST);
+    if (spin_lock_ != kQueued) {
+      continue;
+    }
+    enc_untrusted_sys_futex_wait(futex, sequence);
+  }
+
+  owner_ = enc_thread_self();
+  if (is_recursive_) {
+    recursive_lock_count_ = 1;
+  }
+}
+
+int32_t *TrustedSpinLock::GetUntrustedFutex() {
+  int32_t *futex = __atomic_load_n(&untrusted_futex_, __ATOMIC_ACQUIRE);
+  if (futex) {
+    return futex;
+  }
+
+  // Allocate a full cache line to avoid false sharing with another object.
+  UntrustedCacheMalloc *untrusted_cache_malloc =
+      UntrustedCacheMalloc::Instance();
+  int32_t *allocated =
+      static_cast<int32_t *>(untrusted_cache_malloc->Malloc(kCacheLineSize));
+  if (!allocated) {
+    return nullptr;
+  }
+  *allocated = 0;
+  if (!__atomic_compare_exchange_n(&untrusted_futex_, &futex, allocated,
+                                   /*weak=*/false, __ATOMIC_ACQ_REL,
+                                   __ATOMIC_ACQUIRE)) {
+    // Another thread installed its futex first.
+    untrusted_cache_malloc->Free(allocated);
+    return futex;
+  }
+  return allocated;
 }
 
 bool TrustedSpinLock::Owned() const { return owner_ == enc_thread_self(); }
@@ -88,7 +161,20 @@ void TrustedSpinLock::Unlock() {
 
   if (!is_recursive_ || recursive_lock_count_ == 0) {
     owner_ = kInvalidThread;
-    AtomicRelease(&spin_lock_);
+    if (!is_adaptive_) {
+      AtomicRelease(&spin_lock_);
+      return;
+    }
+
+    // Wake one parked thread if any thread marked the lock as queued. The
+    // untrusted host only schedules the woken thread, which must still acquire
+    // the trusted lock word itself.
+    if (AtomicExchange(&spin_lock_, kUnlocked) == kQueued) {
+      // Only threads that have a futex to park on mark the lock as queued.
+      int32_t *futex = __atomic_load_n(&untrusted_futex_, __ATOMIC_ACQUIRE);
+      __atomic_fetch_add(futex, 1, __ATOMIC_SEQ_CST);
+      enc_untrusted_sys_futex_wake(futex);
+    }
   }
 }
 
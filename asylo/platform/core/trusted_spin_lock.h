@@ -31,31 +31,49 @@ namespace asylo {
 // An TrustedSpinLock object is a thread synchronization primitive that depends
 // on only resources inside the enclave.
 //
+// An adaptive TrustedSpinLock spins only a bounded number of times and then
+// parks the calling thread on the host until the lock is released, so that a
+// thread waiting for a lock held by a descheduled thread does not burn its
+// timeslice. Parked threads wait on a futex in untrusted memory, but ownership
+// of the lock is still decided by the trusted lock word alone.
+//
 // The 'alignas' aligns the object to to the cache line size and pads the object
 // to the same cache line size.
 class alignas(kCacheLineSize) TrustedSpinLock {
  public:
   // A spin lock is a 32-bit value. In this implementation, the value of the
-  // spin lock distinguishes between two possible states:
+  // spin lock distinguishes between three possible states:
   //
   // The spin lock is unlocked.
   constexpr static uint32_t kUnlocked = 0;
   //
   // The spin lock is locked.
   constexpr static uint32_t kLocked = 1;
+  //
+  // The spin lock is locked and threads may be parked waiting for it. Only
+  // adaptive spin locks enter this state.
+  constexpr static uint32_t kQueued = 2;
+
+  // The number of times an adaptive spin lock tries to acquire the lock before
+  // parking the calling thread.
+  constexpr static int kAdaptiveSpinIterations = 100;
 
   // Initializes an unlocked spin lock. If |is_recursive| is true, then the
   // mutex is a recursive lock and may 1) be locked more than once by the caller
   // and 2) does not become free until it is unlocked a corresponding number of
   // times. This optional functionality is provided for compatibility with
-  // pthread_mutex.
-  constexpr explicit TrustedSpinLock(bool is_recursive)
+  // pthread_mutex. If |is_adaptive| is true, then threads waiting for the lock
+  // park on the host after spinning kAdaptiveSpinIterations times.
+  constexpr explicit TrustedSpinLock(bool is_recursive,
+                                     bool is_adaptive = false)
       : spin_lock_(kUnlocked),
         owner_(kInvalidThread),
         is_recursive_(is_recursive),
-        recursive_lock_count_(0) {}
+        is_adaptive_(is_adaptive),
+        recursive_lock_count_(0),
+        untrusted_futex_(nullptr) {}
 
-  ~TrustedSpinLock() = default;
+  ~TrustedSpinLock();
 
   // If this lock is not already held, block until the calling thread is able to
   // acquire it. If configured as a recursive lock, an TrustedSpinLock may be
@@ -76,6 +94,14 @@ class alignas(kCacheLineSize) TrustedSpinLock {
   void Unlock();
 
  private:
+  // Parks the calling thread until it acquires an adaptive lock.
+  void LockSlow();
+
+  // Returns the futex that threads waiting for an adaptive lock park on,
+  // allocating it in untrusted memory on first use. Returns nullptr if the
+  // futex could not be allocated, in which case waiting threads spin instead.
+  int32_t *GetUntrustedFutex();
+
   // A synchronization value in untrusted memory, aligned to a cache line.
   volatile uint32_t spin_lock_;
 
@@ -86,8 +112,15 @@ class alignas(kCacheLineSize) TrustedSpinLock {
   // True if this mutex has been configured as a recursive lock.
   bool is_recursive_;
 
+  // True if this lock parks waiting threads instead of spinning indefinitely.
+  bool is_adaptive_;
+
   // The number of times this lock has been locked recursively.
   uint64_t recursive_lock_count_;
+
+  // A sequence number in untrusted memory, incremented before each wakeup of a
+  // parked thread, or null if no thread has parked on this lock yet.
+  int32_t *untrusted_futex_;
 };
 
 static_assert(sizeof(TrustedSpinLock) == kCacheLineSize,
@@ -30,10 +30,12 @@
 
 #include "absl/memory/memory.h"
 #include "absl/synchronization/mutex.h"
+#include "asylo/crypto/chacha20_drbg.h"
 #include "asylo/crypto/util/bssl_util.h"
 #include "asylo/crypto/util/byte_container_view.h"
 #include "asylo/crypto/util/bytes.h"
 #include "asylo/util/logging.h"
+#include "asylo/util/status.h"
 
 namespace asylo {
 namespace platform {
@@ -152,10 +154,11 @@ bool GcmCryptor::EncryptBlock(const uint8_t *plaintext_data, uint8_t *token,
 
   absl::MutexLock lock(&mu_);
 
-  if (1 != RAND_bytes(next_token_.nonce, kNonceLength)) {
+  Status status = BufferedRandomBytes(next_token_.nonce, kNonceLength);
+  if (!status.ok()) {
     LOG(ERROR)
         << "Failed to generate random nonce for GcmCryptor::EncryptBlock: "
-        << BsslLastErrorString();
+        << status;
     return false;
   }
 
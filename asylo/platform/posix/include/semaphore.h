@@ -19,17 +19,30 @@
 #ifndef ASYLO_PLATFORM_POSIX_INCLUDE_SEMAPHORE_H_
 #define ASYLO_PLATFORM_POSIX_INCLUDE_SEMAPHORE_H_
 
+#include <limits.h>
 #include <pthread.h>
+#include <stdint.h>
 #include <time.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// The largest value a semaphore can hold.
+#ifndef SEM_VALUE_MAX
+#define SEM_VALUE_MAX INT_MAX
+#endif
+
 typedef struct sem_t {
+  // The value of the semaphore.
   int count_;
-  pthread_mutex_t mu_;
-  pthread_cond_t cv_;
+
+  // The number of threads blocked waiting for the value to become positive.
+  int waiters_;
+
+  // A futex in untrusted memory that blocked threads park on, or null if no
+  // thread has blocked on the semaphore yet.
+  int32_t *futex_;
 } sem_t;
 
 // These calls are supported. Note that sem_init is supported only with
@@ -35,6 +35,10 @@ ssize_t readv(int fd, const struct iovec *iov, int iovcnt);
 
 ssize_t writev(int fd, const struct iovec *iov, int iovcnt);
 
+ssize_t preadv(int fd, const struct iovec *iov, int iovcnt, off_t offset);
+
+ssize_t pwritev(int fd, const struct iovec *iov, int iovcnt, off_t offset);
+
 #ifdef __cplusplus
 }  // extern "C"
 #endif
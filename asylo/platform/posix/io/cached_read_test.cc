@@ -0,0 +1,141 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "asylo/platform/common/memory.h"
+#include "asylo/platform/posix/io/io_manager.h"
+#include "asylo/test/util/test_flags.h"
+
+namespace asylo {
+namespace {
+
+using ::testing::Eq;
+
+// Tests reads of host files through the page cache of the IOManager.
+class CachedReadTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    io::PageCache *cache = io::IOManager::GetInstance().page_cache();
+    cache->SetCapacity(1024 * io::PageCache::kPageSize);
+    ASSERT_TRUE(cache->RegisterPrefix(FLAGS_test_tmpdir));
+    test_file_.reset(tempnam(FLAGS_test_tmpdir.c_str(), "CRT"));
+    ASSERT_TRUE(cache->IsCached(test_file_.get()));
+
+    data_.resize(10 * io::PageCache::kPageSize + 123);
+    for (size_t i = 0; i < data_.size(); ++i) {
+      data_[i] = static_cast<char>(i * 13);
+    }
+    WriteFile(data_);
+  }
+
+  void TearDown() override {
+    io::PageCache *cache = io::IOManager::GetInstance().page_cache();
+    cache->DeregisterPrefix(FLAGS_test_tmpdir);
+    cache->SetCapacity(0);
+    if (test_file_) {
+      remove(test_file_.get());
+    }
+  }
+
+  // Replaces the contents of the test file with |contents|.
+  void WriteFile(const std::string &contents) {
+    int fd = open(test_file_.get(), O_CREAT | O_WRONLY | O_TRUNC, 0644);
+    ASSERT_GE(fd, 0);
+    ASSERT_THAT(write(fd, contents.data(), contents.size()),
+                Eq(contents.size()));
+    ASSERT_THAT(close(fd), Eq(0));
+  }
+
+  asylo::MallocUniquePtr<char> test_file_;
+  std::string data_;
+};
+
+// Reads the whole file several times in small pieces, and checks that the
+// cached reads return the contents of the file.
+TEST_F(CachedReadTest, RepeatedSequentialReads) {
+  int fd = open(test_file_.get(), O_RDONLY);
+  ASSERT_GE(fd, 0);
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_THAT(lseek(fd, 0, SEEK_SET), Eq(0));
+    std::string contents;
+    char buf[777];
+    ssize_t bytes_read;
+    while ((bytes_read = read(fd, buf, sizeof(buf))) > 0) {
+      contents.append(buf, bytes_read);
+    }
+    ASSERT_THAT(bytes_read, Eq(0));
+    EXPECT_THAT(contents, Eq(data_));
+  }
+  EXPECT_THAT(close(fd), Eq(0));
+}
+
+// Checks that positional and vectored reads, and seeks from the end of the
+// file, are served consistently with the file contents.
+TEST_F(CachedReadTest, PositionalReadsAndSeeks) {
+  int fd = open(test_file_.get(), O_RDONLY);
+  ASSERT_GE(fd, 0);
+
+  char buf[200];
+  ASSERT_THAT(pread(fd, buf, sizeof(buf), data_.size() - 50), Eq(50));
+  EXPECT_THAT(std::string(buf, 50), Eq(data_.substr(data_.size() - 50)));
+  EXPECT_THAT(lseek(fd, 0, SEEK_CUR), Eq(0));
+
+  char first[10];
+  char second[20];
+  struct iovec iov[2] = {{first, sizeof(first)}, {second, sizeof(second)}};
+  ASSERT_THAT(preadv(fd, iov, 2, 4090), Eq(30));
+  EXPECT_THAT(std::string(first, sizeof(first)) +
+                  std::string(second, sizeof(second)),
+              Eq(data_.substr(4090, 30)));
+
+  ASSERT_THAT(lseek(fd, -10, SEEK_END), Eq(data_.size() - 10));
+  ASSERT_THAT(readv(fd, iov, 2), Eq(10));
+  EXPECT_THAT(std::string(first, 10), Eq(data_.substr(data_.size() - 10)));
+  EXPECT_THAT(close(fd), Eq(0));
+}
+
+// Checks that a change to the file is seen once the file is reopened.
+TEST_F(CachedReadTest, ReopenSeesNewContents) {
+  int fd = open(test_file_.get(), O_RDONLY);
+  ASSERT_GE(fd, 0);
+  char buf[100];
+  ASSERT_THAT(read(fd, buf, sizeof(buf)), Eq(sizeof(buf)));
+  EXPECT_THAT(close(fd), Eq(0));
+
+  const std::string new_contents = "replaced";
+  WriteFile(new_contents);
+
+  fd = open(test_file_.get(), O_RDONLY);
+  ASSERT_GE(fd, 0);
+  ASSERT_THAT(read(fd, buf, sizeof(buf)), Eq(new_contents.size()));
+  EXPECT_THAT(std::string(buf, new_contents.size()), Eq(new_contents));
+  EXPECT_THAT(close(fd), Eq(0));
+}
+
+}  // namespace
+}  // namespace asylo
@@ -0,0 +1,168 @@
+/*
+ *
+ * Copyright 2018 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/posix/io/epoll_data_table.h"
+
+#include <openssl/rand.h>
+
+namespace asylo {
+namespace io {
+namespace {
+
+// The number of random tags generated at a time.
+constexpr size_t kTagBatchSize = 64;
+
+uint64_t MakeKey(uint32_t tag, uint32_t index) {
+  return (static_cast<uint64_t>(tag) << 32) | index;
+}
+
+uint32_t KeyTag(uint64_t key) { return static_cast<uint32_t>(key >> 32); }
+
+uint32_t KeyIndex(uint64_t key) { return static_cast<uint32_t>(key); }
+
+}  // namespace
+
+constexpr size_t EpollDataTable::kChunkSize;
+constexpr size_t EpollDataTable::kMaxChunks;
+
+EpollDataTable::EpollDataTable() {
+  for (auto &chunk : chunks_) {
+    chunk.store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+EpollDataTable::~EpollDataTable() {
+  for (auto &chunk : chunks_) {
+    delete[] chunk.load(std::memory_order_relaxed);
+  }
+}
+
+bool EpollDataTable::Register(uint64_t data, uint64_t *key) {
+  absl::MutexLock lock(&mu_);
+  uint32_t tag = NextTag();
+  if (tag == 0) {
+    return false;
+  }
+
+  uint32_t index;
+  if (!free_slots_.empty()) {
+    index = free_slots_.back();
+    free_slots_.pop_back();
+  } else {
+    if (!GrowTo(high_water_mark_ + 1)) {
+      return false;
+    }
+    index = static_cast<uint32_t>(high_water_mark_++);
+  }
+
+  // Publish the data before the tag, so a lookup that observes the tag also
+  // observes the data.
+  Slot *slot = GetSlot(index);
+  slot->data.store(data, std::memory_order_relaxed);
+  slot->tag.store(tag, std::memory_order_release);
+  *key = MakeKey(tag, index);
+  return true;
+}
+
+bool EpollDataTable::Update(uint64_t key, uint64_t data) {
+  absl::MutexLock lock(&mu_);
+  Slot *slot = GetSlot(KeyIndex(key));
+  if (!slot || KeyTag(key) == 0 ||
+      slot->tag.load(std::memory_order_relaxed) != KeyTag(key)) {
+    return false;
+  }
+  slot->data.store(data, std::memory_order_release);
+  return true;
+}
+
+bool EpollDataTable::Unregister(uint64_t key) {
+  absl::MutexLock lock(&mu_);
+  Slot *slot = GetSlot(KeyIndex(key));
+  if (!slot || KeyTag(key) == 0 ||
+      slot->tag.load(std::memory_order_relaxed) != KeyTag(key)) {
+    return false;
+  }
+  slot->tag.store(0, std::memory_order_release);
+  free_slots_.push_back(KeyIndex(key));
+  return true;
+}
+
+bool EpollDataTable::Lookup(uint64_t key, uint64_t *data) const {
+  uint32_t tag = KeyTag(key);
+  Slot *slot = GetSlot(KeyIndex(key));
+  if (!slot || tag == 0 || slot->tag.load(std::memory_order_acquire) != tag) {
+    return false;
+  }
+  uint64_t value = slot->data.load(std::memory_order_acquire);
+  // If the slot was freed and reused while |value| was being read, the tag
+  // changed and |value| may belong to the new registration.
+  if (slot->tag.load(std::memory_order_relaxed) != tag) {
+    return false;
+  }
+  *data = value;
+  return true;
+}
+
+EpollDataTable::Slot *EpollDataTable::GetSlot(uint64_t index) const {
+  size_t chunk_index = index / kChunkSize;
+  if (chunk_index >= kMaxChunks) {
+    return nullptr;
+  }
+  Slot *chunk = chunks_[chunk_index].load(std::memory_order_acquire);
+  if (!chunk) {
+    return nullptr;
+  }
+  return &chunk[index % kChunkSize];
+}
+
+bool EpollDataTable::GrowTo(size_t count) {
+  if (count > kChunkSize * kMaxChunks) {
+    return false;
+  }
+  while (capacity_ < count) {
+    Slot *chunk = new Slot[kChunkSize];
+    for (size_t i = 0; i < kChunkSize; ++i) {
+      chunk[i].tag.store(0, std::memory_order_relaxed);
+      chunk[i].data.store(0, std::memory_order_relaxed);
+    }
+    chunks_[capacity_ / kChunkSize].store(chunk, std::memory_order_release);
+    capacity_ += kChunkSize;
+  }
+  return true;
+}
+
+uint32_t EpollDataTable::NextTag() {
+  while (true) {
+    if (tags_.empty()) {
+      tags_.resize(kTagBatchSize);
+      if (RAND_bytes(reinterpret_cast<uint8_t *>(tags_.data()),
+                     tags_.size() * sizeof(uint32_t)) != 1) {
+        tags_.clear();
+        return 0;
+      }
+    }
+    uint32_t tag = tags_.back();
+    tags_.pop_back();
+    if (tag != 0) {
+      return tag;
+    }
+  }
+}
+
+}  // namespace io
+}  // namespace asylo
@@ -0,0 +1,117 @@
+/*
+ *
+ * Copyright 2018 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_POSIX_IO_EPOLL_DATA_TABLE_H_
+#define ASYLO_PLATFORM_POSIX_IO_EPOLL_DATA_TABLE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace asylo {
+namespace io {
+
+// EpollDataTable maps the user data registered with an enclave epoll instance
+// to opaque keys, which are handed to the host in place of the data so that no
+// enclave pointers or other user data leak out of the enclave.
+//
+// A key holds the index of the slot storing the data in its low 32 bits and a
+// random, non-zero tag in its high 32 bits. Translating a key back to its data
+// is a single indexed load that takes no locks, so any number of threads may
+// call Lookup() concurrently with each other and with the mutating methods.
+// The tag makes keys for freed or reused slots, and keys made up by the host,
+// fail to resolve.
+//
+// Slots are allocated in fixed-size chunks that are never moved or freed
+// before the table is destroyed, so growing the table never invalidates a
+// concurrent lookup.
+class EpollDataTable {
+ public:
+  // The number of slots allocated at a time.
+  static constexpr size_t kChunkSize = 4096;
+
+  // The maximum number of chunks, which bounds the number of registrations.
+  static constexpr size_t kMaxChunks = 1024;
+
+  EpollDataTable();
+  ~EpollDataTable();
+
+  EpollDataTable(const EpollDataTable &other) = delete;
+  EpollDataTable &operator=(const EpollDataTable &other) = delete;
+
+  // Stores |data| in a free slot and writes its key to |key|. Returns false if
+  // the table is full or no random tag could be generated.
+  bool Register(uint64_t data, uint64_t *key) LOCKS_EXCLUDED(mu_);
+
+  // Replaces the data stored under |key|. Returns false if |key| is not
+  // registered.
+  bool Update(uint64_t key, uint64_t data) LOCKS_EXCLUDED(mu_);
+
+  // Frees the slot for |key|. Returns false if |key| is not registered.
+  bool Unregister(uint64_t key) LOCKS_EXCLUDED(mu_);
+
+  // Writes the data stored under |key| to |data|. Returns false if |key| is not
+  // registered. Does not block.
+  bool Lookup(uint64_t key, uint64_t *data) const;
+
+ private:
+  struct Slot {
+    // The tag of the key currently stored in this slot, or 0 if it is free.
+    std::atomic<uint32_t> tag;
+    std::atomic<uint64_t> data;
+  };
+
+  // Returns the slot at |index|, or nullptr if its chunk is not allocated.
+  Slot *GetSlot(uint64_t index) const;
+
+  // Allocates chunks until there are at least |count| slots. Returns false if
+  // |count| exceeds the capacity of the table.
+  bool GrowTo(size_t count) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Returns a random non-zero tag, or 0 if random bytes are unavailable.
+  uint32_t NextTag() EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Chunks of slots. Entries are only ever changed from nullptr to a chunk,
+  // which is then read without holding |mu_|.
+  std::atomic<Slot *> chunks_[kMaxChunks];
+
+  // Serializes changes to the table.
+  absl::Mutex mu_;
+
+  // The number of slots in allocated chunks.
+  size_t capacity_ GUARDED_BY(mu_) = 0;
+
+  // Slots below this index have been used at least once.
+  size_t high_water_mark_ GUARDED_BY(mu_) = 0;
+
+  // Previously used slots that are free again, most recently freed last.
+  std::vector<uint32_t> free_slots_ GUARDED_BY(mu_);
+
+  // Random tags generated in bulk, to amortize the cost of the random number
+  // generator across registrations.
+  std::vector<uint32_t> tags_ GUARDED_BY(mu_);
+};
+
+}  // namespace io
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_POSIX_IO_EPOLL_DATA_TABLE_H_
@@ -0,0 +1,151 @@
+/*
+ *
+ * Copyright 2018 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/posix/io/epoll_data_table.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace asylo {
+namespace io {
+namespace {
+
+TEST(EpollDataTableTest, LookupReturnsRegisteredData) {
+  EpollDataTable table;
+  std::vector<uint64_t> keys;
+  for (uint64_t data = 0; data < 100; ++data) {
+    uint64_t key;
+    ASSERT_TRUE(table.Register(data * 7, &key));
+    keys.push_back(key);
+  }
+  for (uint64_t data = 0; data < keys.size(); ++data) {
+    uint64_t value;
+    ASSERT_TRUE(table.Lookup(keys[data], &value));
+    EXPECT_EQ(value, data * 7);
+  }
+}
+
+TEST(EpollDataTableTest, UpdateReplacesData) {
+  EpollDataTable table;
+  uint64_t key;
+  ASSERT_TRUE(table.Register(1, &key));
+  ASSERT_TRUE(table.Update(key, 2));
+  uint64_t value;
+  ASSERT_TRUE(table.Lookup(key, &value));
+  EXPECT_EQ(value, uint64_t{2});
+}
+
+// Verify that the key of an unregistered slot does not resolve, even after the
+// slot is reused.
+TEST(EpollDataTableTest, StaleKeysDoNotResolve) {
+  EpollDataTable table;
+  uint64_t old_key;
+  ASSERT_TRUE(table.Register(1, &old_key));
+  ASSERT_TRUE(table.Unregister(old_key));
+
+  uint64_t value;
+  EXPECT_FALSE(table.Lookup(old_key, &value));
+  EXPECT_FALSE(table.Update(old_key, 3));
+  EXPECT_FALSE(table.Unregister(old_key));
+
+  uint64_t new_key;
+  ASSERT_TRUE(table.Register(2, &new_key));
+  EXPECT_NE(new_key, old_key);
+  EXPECT_FALSE(table.Lookup(old_key, &value));
+  ASSERT_TRUE(table.Lookup(new_key, &value));
+  EXPECT_EQ(value, uint64_t{2});
+}
+
+// Verify that keys that were never handed out do not resolve.
+TEST(EpollDataTableTest, UnknownKeysDoNotResolve) {
+  EpollDataTable table;
+  uint64_t key;
+  ASSERT_TRUE(table.Register(1, &key));
+
+  uint64_t value;
+  EXPECT_FALSE(table.Lookup(0, &value));
+  EXPECT_FALSE(table.Lookup(key ^ (uint64_t{1} << 32), &value));
+  EXPECT_FALSE(table.Lookup(key + 1, &value));
+  EXPECT_FALSE(table.Lookup(UINT64_MAX, &value));
+}
+
+TEST(EpollDataTableTest, RegistrationsSpanChunks) {
+  EpollDataTable table;
+  std::vector<uint64_t> keys(3 * EpollDataTable::kChunkSize);
+  for (uint64_t data = 0; data < keys.size(); ++data) {
+    ASSERT_TRUE(table.Register(data, &keys[data]));
+  }
+  for (uint64_t data = 0; data < keys.size(); ++data) {
+    uint64_t value;
+    ASSERT_TRUE(table.Lookup(keys[data], &value));
+    EXPECT_EQ(value, data);
+  }
+}
+
+// Verify that lookups racing with registrations and removals only ever return
+// the data registered under the key being looked up.
+TEST(EpollDataTableTest, ConcurrentLookups) {
+  constexpr int kNumKeys = 1000;
+  constexpr int kNumReaders = 4;
+
+  EpollDataTable table;
+  std::vector<uint64_t> stable_keys(kNumKeys);
+  for (int i = 0; i < kNumKeys; ++i) {
+    ASSERT_TRUE(table.Register(i, &stable_keys[i]));
+  }
+
+  std::atomic<bool> done(false);
+  std::atomic<int> failures(0);
+  std::vector<std::thread> readers;
+  for (int t = 0; t < kNumReaders; ++t) {
+    readers.emplace_back([&] {
+      while (!done.load()) {
+        for (int i = 0; i < kNumKeys; ++i) {
+          uint64_t value;
+          if (!table.Lookup(stable_keys[i], &value) ||
+              value != static_cast<uint64_t>(i)) {
+            failures.fetch_add(1);
+          }
+        }
+      }
+    });
+  }
+
+  for (int round = 0; round < 100; ++round) {
+    std::vector<uint64_t> keys(kNumKeys);
+    for (int i = 0; i < kNumKeys; ++i) {
+      EXPECT_TRUE(table.Register(kNumKeys + i, &keys[i]));
+    }
+    for (uint64_t key : keys) {
+      EXPECT_TRUE(table.Unregister(key));
+    }
+  }
+  done.store(true);
+  for (std::thread &reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(failures.load(), 0);
+}
+
+}  // namespace
+}  // namespace io
+}  // namespace asylo
@@ -18,73 +18,275 @@
 #include "asylo/platform/posix/io/io_context_epoll.h"
 
 #include <errno.h>
-#include <openssl/rand.h>
+#include <poll.h>
 #include <stdint.h>
 
 #include "absl/memory/memory.h"
+#include "absl/time/time.h"
 #include "asylo/platform/arch/include/trusted/host_calls.h"
+#include "asylo/platform/posix/io/readiness_notifier.h"
 
 namespace asylo {
 namespace io {
+namespace {
+
+// The reported generation of a registration that has not reported an event
+// since it was last armed. Generations start at zero and never reach it.
+constexpr uint64_t kNeverReported = UINT64_MAX;
+
+// Converts the poll(2) events reported by an enclave stream to epoll events.
+uint32_t PollToEpollEvents(int poll_events) {
+  uint32_t events = 0;
+  if (poll_events & POLLIN) events |= EPOLLIN;
+  if (poll_events & POLLPRI) events |= EPOLLPRI;
+  if (poll_events & POLLOUT) events |= EPOLLOUT;
+  if (poll_events & POLLERR) events |= EPOLLERR;
+  if (poll_events & POLLHUP) events |= EPOLLHUP;
+  if (poll_events & POLLRDHUP) events |= EPOLLRDHUP;
+  return events;
+}
+
+// The data of the event registered for the wakeup file descriptor of the
+// ReadinessNotifier. Keys of the data table have a non-zero tag, so it never
+// resolves, and WaitForHostEvents() drops its events.
+constexpr uint64_t kWakeupKey = 0;
+
+}  // namespace
 
 int IOContextEpoll::EpollCtl(int op, int hostfd, struct epoll_event *event) {
   struct epoll_event event_copy;
   if (event) {
     event_copy.events = event->events;
   }
+  absl::MutexLock lock(&ctl_mutex_);
+  auto it = fd_to_key_.find(hostfd);
   if (op == EPOLL_CTL_ADD) {
+    if (it != fd_to_key_.end()) {
+      errno = EEXIST;
+      return -1;
+    }
     uint64_t key = 0;
-    do {
-      if (RAND_bytes(reinterpret_cast<uint8_t *>(&key),
-                     sizeof(uint64_t)) != 1) {
-        errno = EBADE;
-        return -1;
-      }
-    } while (key_to_data.find(key) != key_to_data.end());
-    key_to_data[key] = event->data.u64;
-    fd_to_key[hostfd] = key;
+    if (!key_to_data_.Register(event->data.u64, &key)) {
+      errno = ENOSPC;
+      return -1;
+    }
     event_copy.data.u64 = key;
+    int ret = enc_untrusted_epoll_ctl(host_fd_, op, hostfd, &event_copy);
+    if (ret == 0) {
+      fd_to_key_[hostfd] = key;
+    } else {
+      key_to_data_.Unregister(key);
+    }
+    return ret;
   } else if (op == EPOLL_CTL_MOD) {
-    if (fd_to_key.find(hostfd) == fd_to_key.end()) {
+    if (it == fd_to_key_.end()) {
       errno = ENOENT;
       return -1;
     }
-    uint64_t key = fd_to_key[hostfd];
-    key_to_data[key] = event->data.u64;
-    event_copy.data.u64 = key;
+    key_to_data_.Update(it->second, event->data.u64);
+    event_copy.data.u64 = it->second;
   } else if (op == EPOLL_CTL_DEL) {
-    if (fd_to_key.find(hostfd) == fd_to_key.end()) {
+    if (it == fd_to_key_.end()) {
       errno = ENOENT;
       return -1;
     }
-    uint64_t key = fd_to_key[hostfd];
-    event_copy.data.u64 = key;
-    fd_to_key.erase(hostfd);
-    key_to_data.erase(key);
+    event_copy.data.u64 = it->second;
+    key_to_data_.Unregister(it->second);
+    fd_to_key_.erase(it);
   } else {
+    errno = EINVAL;
     return -1;
   }
   return enc_untrusted_epoll_ctl(host_fd_, op, hostfd, &event_copy);
 }
 
+int IOContextEpoll::EpollCtlEnclave(int op, int fd, ReadinessCallback readiness,
+                                    struct epoll_event *event) {
+  if ((op == EPOLL_CTL_ADD || op == EPOLL_CTL_MOD) && !event) {
+    errno = EFAULT;
+    return -1;
+  }
+  absl::MutexLock lock(&ctl_mutex_);
+  auto it = enclave_fds_.find(fd);
+  uint64_t generation;
+  if (it != enclave_fds_.end() && it->second.readiness(&generation) < 0) {
+    // The registered stream has been closed, and |fd| reused.
+    enclave_fds_.erase(it);
+    it = enclave_fds_.end();
+  }
+  switch (op) {
+    case EPOLL_CTL_ADD:
+      if (it != enclave_fds_.end()) {
+        errno = EEXIST;
+        return -1;
+      }
+      enclave_fds_[fd] = {std::move(readiness), event->events, event->data.u64,
+                          kNeverReported, /*disabled=*/false};
+      return 0;
+    case EPOLL_CTL_MOD:
+      if (it == enclave_fds_.end()) {
+        errno = ENOENT;
+        return -1;
+      }
+      it->second.events = event->events;
+      it->second.data = event->data.u64;
+      it->second.reported_generation = kNeverReported;
+      it->second.disabled = false;
+      return 0;
+    case EPOLL_CTL_DEL:
+      if (it == enclave_fds_.end()) {
+        errno = ENOENT;
+        return -1;
+      }
+      enclave_fds_.erase(it);
+      return 0;
+    default:
+      errno = EINVAL;
+      return -1;
+  }
+}
+
 int IOContextEpoll::EpollWait(struct epoll_event *events, int maxevents,
                               int timeout) {
+  bool has_enclave_fds;
+  {
+    absl::MutexLock lock(&ctl_mutex_);
+    has_enclave_fds = !enclave_fds_.empty();
+  }
+  absl::Time deadline = timeout < 0
+                            ? absl::InfiniteFuture()
+                            : absl::Now() + absl::Milliseconds(timeout);
+  if (!has_enclave_fds) {
+    // Every event of a host wait may be dropped by WaitForHostEvents(), which
+    // must not end the wait before |deadline|.
+    while (true) {
+      int ret = WaitForHostEvents(
+          events, maxevents, ReadinessNotifier::RemainingTimeout(deadline));
+      if (ret != 0 || absl::Now() >= deadline) {
+        return ret;
+      }
+    }
+  }
+  if (maxevents <= 0) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  ReadinessNotifier &notifier = ReadinessNotifier::GetInstance();
+  while (true) {
+    uint64_t notifier_generation = notifier.generation();
+    int num_events = CollectEnclaveEvents(events, maxevents);
+
+    bool has_host_fds;
+    {
+      absl::MutexLock lock(&ctl_mutex_);
+      has_host_fds = !fd_to_key_.empty();
+    }
+    if (has_host_fds && num_events < maxevents) {
+      bool host_wait = num_events == 0;
+      uint64_t epoch;
+      int host_timeout = 0;
+      if (host_wait) {
+        int wakeup_fd;
+        if (!notifier.BeginHostWait(notifier_generation, &wakeup_fd,
+                                    &epoch)) {
+          continue;
+        }
+        host_timeout = WatchWakeupFd(wakeup_fd)
+                           ? ReadinessNotifier::RemainingTimeout(deadline)
+                           : ReadinessNotifier::HostWaitTimeout(deadline);
+      }
+      int ret = WaitForHostEvents(events + num_events, maxevents - num_events,
+                                  host_timeout);
+      if (host_wait) {
+        notifier.EndHostWait(epoch);
+      }
+      if (ret < 0) {
+        return num_events > 0 ? num_events : -1;
+      }
+      num_events += ret;
+    } else if (num_events == 0 &&
+               notifier.WaitForChange(notifier_generation, deadline)) {
+      continue;
+    }
+
+    if (num_events > 0 || absl::Now() >= deadline) {
+      return num_events;
+    }
+  }
+}
+
+bool IOContextEpoll::WatchWakeupFd(int wakeup_fd) {
+  if (wakeup_fd < 0) {
+    return false;
+  }
+  absl::MutexLock lock(&ctl_mutex_);
+  if (!wakeup_fd_watched_) {
+    // The registration is edge-triggered, so that a byte left in the pipe for
+    // other waiters does not wake this instance repeatedly.
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLET;
+    event.data.u64 = kWakeupKey;
+    wakeup_fd_watched_ =
+        enc_untrusted_epoll_ctl(host_fd_, EPOLL_CTL_ADD, wakeup_fd, &event) ==
+        0;
+  }
+  return wakeup_fd_watched_;
+}
+
+int IOContextEpoll::WaitForHostEvents(struct epoll_event *events,
+                                      int maxevents, int timeout) {
   int ret = enc_untrusted_epoll_wait(host_fd_, events, maxevents, timeout);
   if (ret == -1) {
     // errno is set in enc_untrusted_epoll_wait.
     return -1;
   }
-  // Convert the random bits in the data field back to the original data using
-  // the key_to_data map.
+  // Convert the keys in the data field back to the original data. An event
+  // whose key does not resolve was reported for a file descriptor removed by
+  // a concurrent EpollCtl call, or was made up by the host, and is dropped.
+  int num_events = 0;
   for (int i = 0; i < ret; ++i) {
-    uint64_t key = events[i].data.u64;
-    if (key_to_data.find(key) == key_to_data.end()) {
-      errno = EBADE;
-      return -1;
+    uint64_t data;
+    if (!key_to_data_.Lookup(events[i].data.u64, &data)) {
+      continue;
+    }
+    events[num_events].events = events[i].events;
+    events[num_events].data.u64 = data;
+    ++num_events;
+  }
+  return num_events;
+}
+
+int IOContextEpoll::CollectEnclaveEvents(struct epoll_event *events,
+                                         int maxevents) {
+  absl::MutexLock lock(&ctl_mutex_);
+  int num_events = 0;
+  auto it = enclave_fds_.begin();
+  while (it != enclave_fds_.end() && num_events < maxevents) {
+    EnclaveRegistration &registration = it->second;
+    uint64_t generation;
+    int ready = registration.readiness(&generation);
+    if (ready < 0) {
+      // The stream has been closed, which removes it from the epoll instance.
+      enclave_fds_.erase(it++);
+      continue;
+    }
+    uint32_t ready_events = PollToEpollEvents(ready) &
+                            (registration.events | EPOLLERR | EPOLLHUP);
+    bool edge_seen = (registration.events & EPOLLET) &&
+                     generation == registration.reported_generation;
+    if (registration.disabled || ready_events == 0 || edge_seen) {
+      ++it;
+      continue;
     }
-    events[i].data.u64 = key_to_data[key];
+    registration.reported_generation = generation;
+    registration.disabled = registration.events & EPOLLONESHOT;
+    events[num_events].events = ready_events;
+    events[num_events].data.u64 = registration.data;
+    ++num_events;
+    ++it;
   }
-  return ret;
+  return num_events;
 }
 
 int IOContextEpoll::GetHostFileDescriptor() { return host_fd_; }
@@ -19,7 +19,10 @@
 #ifndef ASYLO_PLATFORM_POSIX_IO_IO_CONTEXT_EPOLL_H_
 #define ASYLO_PLATFORM_POSIX_IO_IO_CONTEXT_EPOLL_H_
 
+#include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "asylo/platform/posix/io/epoll_data_table.h"
 #include "asylo/platform/posix/io/io_manager.h"
 
 namespace asylo {
@@ -30,7 +33,11 @@ class IOContextEpoll : public IOManager::IOContext {
   explicit IOContextEpoll(int host_fd) : host_fd_(host_fd) {}
   // It's important to note that adding dup'd file descriptors here won't work
   // the same as it would in POSIX.
-  int EpollCtl(int op, int hostfd, struct epoll_event *event) override;
+  int EpollCtl(int op, int hostfd, struct epoll_event *event) override
+      LOCKS_EXCLUDED(ctl_mutex_);
+  int EpollCtlEnclave(int op, int fd, ReadinessCallback readiness,
+                      struct epoll_event *event) override
+      LOCKS_EXCLUDED(ctl_mutex_);
   int EpollWait(struct epoll_event *events, int maxevents,
                 int timeout) override;
   int GetHostFileDescriptor() override;
@@ -39,12 +46,51 @@ class IOContextEpoll : public IOManager::IOContext {
   int Close();
 
  private:
+  // A stream implemented inside the enclave, which is polled by the enclave
+  // rather than by the host.
+  struct EnclaveRegistration {
+    ReadinessCallback readiness;
+    uint32_t events;
+    uint64_t data;
+    // The generation of the stream when an event was last reported, for
+    // EPOLLET.
+    uint64_t reported_generation;
+    // Set once an EPOLLONESHOT event has been reported.
+    bool disabled;
+  };
+
+  // Waits for events on the host file descriptors, translating their data.
+  int WaitForHostEvents(struct epoll_event *events, int maxevents,
+                        int timeout);
+
+  // Adds |wakeup_fd|, the wakeup file descriptor of the ReadinessNotifier, to
+  // the host epoll instance if it is not there yet. Returns false if it could
+  // not be added.
+  bool WatchWakeupFd(int wakeup_fd) LOCKS_EXCLUDED(ctl_mutex_);
+
+  // Stores up to |maxevents| events of enclave streams that are ready in
+  // |events|, and returns how many were stored.
+  int CollectEnclaveEvents(struct epoll_event *events, int maxevents)
+      LOCKS_EXCLUDED(ctl_mutex_);
+
   // Host file descriptor implementing this stream.
   int host_fd_;
-  absl::flat_hash_map<uint64_t, uint64_t> key_to_data;
-  // Manages a mapping from the host file descriptor to a random key to enable
-  // updates to the above map durring deletions/modifications.
-  absl::flat_hash_map<int, uint64_t> fd_to_key;
+  // Maps the keys passed to the host in the data field of each event back to
+  // the data registered by the caller. Lookups from EpollWait do not lock.
+  EpollDataTable key_to_data_;
+  // Serializes EpollCtl calls, so that the table and |fd_to_key_| are updated
+  // together.
+  absl::Mutex ctl_mutex_;
+  // Manages a mapping from the host file descriptor to its key to enable
+  // updates to the above table during deletions/modifications.
+  absl::flat_hash_map<int, uint64_t> fd_to_key_ GUARDED_BY(ctl_mutex_);
+  // The enclave streams registered with this instance, by enclave file
+  // descriptor.
+  absl::flat_hash_map<int, EnclaveRegistration> enclave_fds_
+      GUARDED_BY(ctl_mutex_);
+  // Set once the wakeup file descriptor of the ReadinessNotifier has been
+  // added to the host epoll instance.
+  bool wakeup_fd_watched_ GUARDED_BY(ctl_mutex_) = false;
 };
 
 }  // namespace io
@@ -15,12 +15,12 @@
  * limitations under the License.
  *
  */
+
+#include <errno.h>
 #include <sys/inotify.h>
+#include <cstring>
 
 #include "asylo/platform/arch/include/trusted/host_calls.h"
-#include "asylo/platform/arch/include/trusted/memory.h"
-#include "asylo/platform/common/bridge_proto_serializer.h"
-#include "asylo/platform/common/memory.h"
 #include "asylo/platform/posix/io/io_context_inotify.h"
 
 namespace asylo {
@@ -36,55 +36,65 @@ int IOContextInotify::InotifyRmWatch(int wd) {
   return enc_untrusted_inotify_rm_watch(host_fd_, wd);
 }
 
-size_t IOContextInotify::TransferFromQueueToBuffer(char *buf_ptr,
-                                                   size_t count) {
+size_t IOContextInotify::TransferPendingEvents(char *buf, size_t count) {
   size_t num_bytes_written = 0;
-  while (!event_queue_.empty()) {
-    struct inotify_event *front_event = event_queue_.front();
-    size_t front_event_len = sizeof(struct inotify_event) + front_event->len;
+  while (HasPendingEvents()) {
+    const char *front = pending_events_.data() + pending_offset_;
+    struct inotify_event front_event;
+    memcpy(&front_event, front, sizeof(front_event));
+    size_t front_event_len = sizeof(struct inotify_event) + front_event.len;
     if (count < front_event_len) {
-      return num_bytes_written;
+      break;
     }
-    memcpy(buf_ptr, front_event, front_event_len);
-    buf_ptr += front_event_len;
+    memcpy(buf + num_bytes_written, front, front_event_len);
     num_bytes_written += front_event_len;
     count -= front_event_len;
-    asylo::MallocUniquePtr<struct inotify_event> ev_ptr(front_event);
-    event_queue_.pop();
+    pending_offset_ += front_event_len;
+  }
+  if (!HasPendingEvents()) {
+    pending_events_.clear();
+    pending_offset_ = 0;
   }
   return num_bytes_written;
 }
 
 ssize_t IOContextInotify::Read(void *buf, size_t count) {
-  // Remove events from queue, if there are any.
   char *buf_ptr = static_cast<char *>(buf);
-  size_t num_bytes_written = TransferFromQueueToBuffer(buf_ptr, count);
-  buf_ptr += num_bytes_written;
-  count -= num_bytes_written;  if (!event_queue_.empty() && (num_bytes_written == 0)) {
-    errno = EINVAL;
-    return -1;
-  } else if (!event_queue_.empty() || count == 0) {
-    // No need to read events from the host if the queue is not empty.
+
+  // Return events left over from a previous read, if there are any.
+  if (HasPendingEvents()) {
+    size_t num_bytes_written = TransferPendingEvents(buf_ptr, count);
+    if (num_bytes_written == 0) {
+      errno = EINVAL;
+      return -1;
+    }
     return num_bytes_written;
   }
-  // Read serialized events from the host, adjusting for space left in buffer.
-  char *serialized_events = nullptr;
-  size_t len = 0;
-  if (enc_untrusted_inotify_read(host_fd_, count, &serialized_events, &len) <
-      0) {
-    // errno is set by enc_untrusted_inotify_read.
-    return -1;
+
+  // A buffer of this size can hold at least one event, no matter how long its
+  // file name is. NAME_MAX is 255 on Linux.
+  constexpr size_t kMinReadSize = sizeof(struct inotify_event) + 255 + 1;
+
+  // The host writes events directly into |buf| if it is large enough.
+  if (count >= kMinReadSize) {
+    // errno is set by enc_untrusted_inotify_read on failure.
+    return enc_untrusted_inotify_read(host_fd_, buf_ptr, count);
   }
-  asylo::UntrustedUniquePtr<char> serialized_events_ptr(serialized_events);
-  // Extract events back into the queue.
-  std::string serialized_events_str(serialized_events, len);
-  if (!asylo::DeserializeInotifyEvents(serialized_events_str, &event_queue_)) {
-    errno = EBADE;
+
+  // Otherwise, read into a buffer of the minimum size and keep the events that
+  // do not fit in |buf| for the next read.
+  pending_events_.resize(kMinReadSize);
+  pending_offset_ = 0;
+  ssize_t bytes_read = enc_untrusted_inotify_read(
+      host_fd_, pending_events_.data(), pending_events_.size());
+  if (bytes_read < 0) {
+    // errno is set by enc_untrusted_inotify_read.
+    pending_events_.clear();
     return -1;
   }
-  // Transfer events from the queue into the buffer again (as much as possible).
-  num_bytes_written += TransferFromQueueToBuffer(buf_ptr, count);
-  if (!event_queue_.empty() && (num_bytes_written == 0)) {
+  pending_events_.resize(bytes_read);
+  size_t num_bytes_written = TransferPendingEvents(buf_ptr, count);
+  if (num_bytes_written == 0 && HasPendingEvents()) {
     errno = EINVAL;
     return -1;
   }
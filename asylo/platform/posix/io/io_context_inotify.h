@@ -21,7 +21,8 @@
 
 #include <sys/inotify.h>
 
-#include <queue>
+#include <vector>
+
 #include "asylo/platform/posix/io/io_manager.h"
 
 namespace asylo {
@@ -40,10 +41,23 @@ class IOContextInotify : public IOManager::IOContext {
   int Close() override;
 
  private:
-  size_t TransferFromQueueToBuffer(char *buf_ptr, size_t count);
+  // Copies as many whole events from |pending_events_| into |buf| as fit in
+  // |count| bytes. Returns the number of bytes copied.
+  size_t TransferPendingEvents(char *buf, size_t count);
+
+  // Returns true if there are events that were read from the host but not yet
+  // returned to the caller.
+  bool HasPendingEvents() const {
+    return pending_offset_ < pending_events_.size();
+  }
+
   // Host file descriptor implementing this stream.
   int host_fd_;
-  std::queue<struct inotify_event *> event_queue_;
+
+  // Events read from the host that did not fit in the caller's buffer. The
+  // events that have not been returned yet start at |pending_offset_|.
+  std::vector<char> pending_events_;
+  size_t pending_offset_ = 0;
 };
 
 }  // namespace io
@@ -0,0 +1,742 @@
+/*
+ *
+ * Copyright 2018 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/posix/io/io_context_pipe.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "asylo/platform/common/ring_buffer.h"
+#include "asylo/platform/posix/io/readiness_notifier.h"
+
+namespace asylo {
+namespace io {
+namespace {
+
+// Writes of at most this many bytes are atomic. It is also the size of a packet
+// in an O_DIRECT pipe, and the smallest capacity of a pipe.
+constexpr size_t kPipeBufSize = PIPE_BUF;
+
+// Tracks a position within an array of iovecs.
+class IovecCursor {
+ public:
+  IovecCursor(const struct iovec *iov, int iovcnt)
+      : iov_(iov), iovcnt_(iovcnt), index_(0), offset_(0) {}
+
+  // Returns the next contiguous run of at most |max_size| bytes in |*data| and
+  // advances past it. Returns the size of the run.
+  size_t Next(size_t max_size, uint8_t **data) {
+    while (index_ < iovcnt_ && offset_ == iov_[index_].iov_len) {
+      ++index_;
+      offset_ = 0;
+    }
+    if (index_ == iovcnt_) {
+      return 0;
+    }
+    size_t size = std::min(max_size, iov_[index_].iov_len - offset_);
+    *data = reinterpret_cast<uint8_t *>(iov_[index_].iov_base) + offset_;
+    offset_ += size;
+    return size;
+  }
+
+ private:
+  const struct iovec *iov_;
+  int iovcnt_;
+  int index_;
+  size_t offset_;
+};
+
+// Returns the total size of the buffers in |iov|, or -1 with errno set if the
+// array is invalid.
+ssize_t TotalSize(const struct iovec *iov, int iovcnt) {
+  if (iovcnt < 0 || (iovcnt > 0 && !iov)) {
+    errno = EINVAL;
+    return -1;
+  }
+  size_t total = 0;
+  for (int i = 0; i < iovcnt; ++i) {
+    if (iov[i].iov_len > SSIZE_MAX - total) {
+      errno = EINVAL;
+      return -1;
+    }
+    total += iov[i].iov_len;
+  }
+  return total;
+}
+
+}  // namespace
+
+class PipeBuffer {
+ public:
+  // A snapshot of the readiness of the buffer.
+  struct State {
+    // The number of changes made to the buffer so far.
+    uint64_t changes;
+    bool reader_open;
+    bool writer_open;
+    // Whether a read would return data.
+    bool readable;
+    // Whether there is room for at least one atomic write.
+    bool writable;
+  };
+
+  explicit PipeBuffer(bool packet_mode) : packet_mode_(packet_mode) {}
+
+  ssize_t Write(const struct iovec *iov, int iovcnt, bool nonblock)
+      LOCKS_EXCLUDED(mu_);
+  ssize_t Read(const struct iovec *iov, int iovcnt, bool nonblock,
+               bool wait_all) LOCKS_EXCLUDED(mu_);
+
+  // Marks the reading side or the writing side of the buffer closed. Readers
+  // see end-of-file once the buffer drains after the writer closes, and
+  // writers fail with EPIPE once the reader closes.
+  void CloseReader() LOCKS_EXCLUDED(mu_);
+  void CloseWriter() LOCKS_EXCLUDED(mu_);
+
+  State GetState() LOCKS_EXCLUDED(mu_);
+
+  int capacity() LOCKS_EXCLUDED(mu_) {
+    absl::MutexLock lock(&mu_);
+    return capacity_;
+  }
+
+  // Implements F_SETPIPE_SZ.
+  int SetCapacity(int64_t size) LOCKS_EXCLUDED(mu_);
+
+ private:
+  using Ring = RingBuffer<IOContextPipe::kDefaultPipeSize>;
+
+  size_t StoredBytes() const EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    return ring_ ? ring_->size() : 0;
+  }
+
+  // Returns how many of the |remaining| bytes of a write can be stored now. If
+  // |atomic| is set, the write must be stored all at once.
+  size_t WritableBytes(size_t remaining, bool atomic) const
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Copies |size| bytes between |cursor| and the ring.
+  void CopyIn(IovecCursor *cursor, size_t size) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  void CopyOut(IovecCursor *cursor, size_t size) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Drops the next |size| bytes in the ring.
+  void Discard(size_t size) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Records a change in the state of the buffer and wakes pollers.
+  void Changed() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    ++changes_;
+    ReadinessNotifier::GetInstance().Notify();
+  }
+
+  // Whether each write is split into packets of at most kPipeBufSize bytes
+  // that are read one at a time, as in an O_DIRECT pipe.
+  const bool packet_mode_;
+
+  absl::Mutex mu_;
+
+  // The bytes in flight. Allocated on the first write, so that pipes that are
+  // never written to do not take up enclave memory.
+  std::unique_ptr<Ring> ring_ GUARDED_BY(mu_);
+
+  // The number of bytes the buffer may hold, at most the size of |ring_|.
+  size_t capacity_ GUARDED_BY(mu_) = IOContextPipe::kDefaultPipeSize;
+
+  // The sizes of the packets in |ring_|, oldest first, in packet mode.
+  std::deque<size_t> packets_ GUARDED_BY(mu_);
+
+  bool reader_open_ GUARDED_BY(mu_) = true;
+  bool writer_open_ GUARDED_BY(mu_) = true;
+  uint64_t changes_ GUARDED_BY(mu_) = 0;
+};
+
+ssize_t PipeBuffer::Write(const struct iovec *iov, int iovcnt, bool nonblock) {
+  ssize_t total = TotalSize(iov, iovcnt);
+  if (total < 0) {
+    return -1;
+  }
+  absl::MutexLock lock(&mu_);
+  if (!reader_open_ || !writer_open_) {
+    errno = EPIPE;
+    return -1;
+  }
+  if (total == 0) {
+    return 0;
+  }
+  if (!ring_) {
+    ring_ = absl::make_unique<Ring>();
+  }
+
+  bool atomic = static_cast<size_t>(total) <= kPipeBufSize;
+  IovecCursor source(iov, iovcnt);
+  size_t written = 0;
+  while (written < static_cast<size_t>(total) && reader_open_) {
+    size_t remaining = total - written;
+    size_t size = WritableBytes(remaining, atomic);
+    if (size == 0) {
+      if (nonblock) {
+        break;
+      }
+      auto ready = [this, remaining, atomic]() {
+        mu_.AssertHeld();
+        return !reader_open_ || WritableBytes(remaining, atomic) > 0;
+      };
+      mu_.Await(absl::Condition(&ready));
+      continue;
+    }
+    if (packet_mode_) {
+      for (size_t left = size; left > 0;) {
+        size_t packet = std::min(left, kPipeBufSize);
+        CopyIn(&source, packet);
+        packets_.push_back(packet);
+        left -= packet;
+      }
+    } else {
+      CopyIn(&source, size);
+    }
+    written += size;
+    Changed();
+  }
+
+  if (written == 0) {
+    errno = reader_open_ ? EAGAIN : EPIPE;
+    return -1;
+  }
+  return written;
+}
+
+ssize_t PipeBuffer::Read(const struct iovec *iov, int iovcnt, bool nonblock,
+                         bool wait_all) {
+  ssize_t total = TotalSize(iov, iovcnt);
+  if (total <= 0) {
+    return total;
+  }
+  absl::MutexLock lock(&mu_);
+  IovecCursor destination(iov, iovcnt);
+  size_t bytes_read = 0;
+  while (bytes_read < static_cast<size_t>(total)) {
+    size_t stored = StoredBytes();
+    if (stored > 0 && reader_open_) {
+      size_t remaining = total - bytes_read;
+      if (packet_mode_) {
+        // Each read returns at most one packet, and drops whatever part of the
+        // packet does not fit in the caller's buffers.
+        size_t packet = packets_.front();
+        packets_.pop_front();
+        size_t size = std::min(packet, remaining);
+        CopyOut(&destination, size);
+        Discard(packet - size);
+        bytes_read += size;
+        Changed();
+        break;
+      }
+      size_t size = std::min(stored, remaining);
+      CopyOut(&destination, size);
+      bytes_read += size;
+      Changed();
+      if (!wait_all) {
+        break;
+      }
+      continue;
+    }
+    if (!reader_open_ || !writer_open_) {
+      // End of file.
+      break;
+    }
+    if (nonblock) {
+      if (bytes_read == 0) {
+        errno = EAGAIN;
+        return -1;
+      }
+      break;
+    }
+    auto ready = [this]() {
+      mu_.AssertHeld();
+      return StoredBytes() > 0 || !reader_open_ || !writer_open_;
+    };
+    mu_.Await(absl::Condition(&ready));
+  }
+  return bytes_read;
+}
+
+void PipeBuffer::CloseReader() {
+  absl::MutexLock lock(&mu_);
+  if (!reader_open_) {
+    return;
+  }
+  // Nothing can read the data in flight any more.
+  reader_open_ = false;
+  ring_.reset();
+  packets_.clear();
+  Changed();
+}
+
+void PipeBuffer::CloseWriter() {
+  absl::MutexLock lock(&mu_);
+  if (!writer_open_) {
+    return;
+  }
+  writer_open_ = false;
+  Changed();
+}
+
+PipeBuffer::State PipeBuffer::GetState() {
+  absl::MutexLock lock(&mu_);
+  State state;
+  state.changes = changes_;
+  state.reader_open = reader_open_;
+  state.writer_open = writer_open_;
+  state.readable = reader_open_ && StoredBytes() > 0;
+  state.writable = reader_open_ && WritableBytes(kPipeBufSize, true) > 0;
+  return state;
+}
+
+int PipeBuffer::SetCapacity(int64_t size) {
+  if (size < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (size > static_cast<int64_t>(IOContextPipe::kDefaultPipeSize)) {
+    errno = EPERM;
+    return -1;
+  }
+  // As on Linux, the capacity is rounded up to a power of two number of pages.
+  size_t capacity = kPipeBufSize;
+  while (capacity < static_cast<size_t>(size)) {
+    capacity <<= 1;
+  }
+
+  absl::MutexLock lock(&mu_);
+  if (StoredBytes() > capacity ||
+      (packet_mode_ && packets_.size() > capacity / kPipeBufSize)) {
+    errno = EBUSY;
+    return -1;
+  }
+  capacity_ = capacity;
+  Changed();
+  return capacity_;
+}
+
+size_t PipeBuffer::WritableBytes(size_t remaining, bool atomic) const {
+  size_t size;
+  if (packet_mode_) {
+    // Every packet takes up a whole kPipeBufSize slot, however small it is.
+    size_t slots = capacity_ / kPipeBufSize;
+    size_t free_slots = slots > packets_.size() ? slots - packets_.size() : 0;
+    size = std::min(remaining, free_slots * kPipeBufSize);
+  } else {
+    size_t stored = StoredBytes();
+    size = std::min(remaining, capacity_ > stored ? capacity_ - stored : 0);
+  }
+  return atomic && size < remaining ? 0 : size;
+}
+
+void PipeBuffer::CopyIn(IovecCursor *cursor, size_t size) {
+  while (size > 0) {
+    uint8_t *data;
+    size_t chunk = cursor->Next(size, &data);
+    ring_->NonBlockingWrite(data, chunk);
+    size -= chunk;
+  }
+}
+
+void PipeBuffer::CopyOut(IovecCursor *cursor, size_t size) {
+  while (size > 0) {
+    uint8_t *data;
+    size_t chunk = cursor->Next(size, &data);
+    ring_->NonBlockingRead(data, chunk);
+    size -= chunk;
+  }
+}
+
+void PipeBuffer::Discard(size_t size) {
+  uint8_t scratch[256];
+  while (size > 0) {
+    size -= ring_->NonBlockingRead(scratch, std::min(size, sizeof(scratch)));
+  }
+}
+
+constexpr size_t IOContextPipe::kDefaultPipeSize;
+
+void IOContextPipe::CreatePipe(int flags,
+                               std::unique_ptr<IOContextPipe> *read_end,
+                               std::unique_ptr<IOContextPipe> *write_end) {
+  auto buffer = std::make_shared<PipeBuffer>(flags & O_DIRECT);
+  bool close_on_exec = flags & O_CLOEXEC;
+  // As on Linux, only the write end reports O_DIRECT.
+  read_end->reset(new IOContextPipe(buffer, nullptr, /*is_socket=*/false,
+                                    flags & O_NONBLOCK, close_on_exec));
+  write_end->reset(new IOContextPipe(nullptr, buffer, /*is_socket=*/false,
+                                     flags & (O_NONBLOCK | O_DIRECT),
+                                     close_on_exec));
+}
+
+void IOContextPipe::CreateSocketPair(int flags,
+                                     std::unique_ptr<IOContextPipe> *first,
+                                     std::unique_ptr<IOContextPipe> *second) {
+  auto first_to_second = std::make_shared<PipeBuffer>(/*packet_mode=*/false);
+  auto second_to_first = std::make_shared<PipeBuffer>(/*packet_mode=*/false);
+  int status_flags = (flags & SOCK_NONBLOCK) ? O_NONBLOCK : 0;
+  bool close_on_exec = flags & SOCK_CLOEXEC;
+  first->reset(new IOContextPipe(second_to_first, first_to_second,
+                                 /*is_socket=*/true, status_flags,
+                                 close_on_exec));
+  second->reset(new IOContextPipe(first_to_second, second_to_first,
+                                  /*is_socket=*/true, status_flags,
+                                  close_on_exec));
+}
+
+IOContextPipe::IOContextPipe(std::shared_ptr<PipeBuffer> read_buffer,
+                             std::shared_ptr<PipeBuffer> write_buffer,
+                             bool is_socket, int status_flags,
+                             bool close_on_exec)
+    : read_buffer_(std::move(read_buffer)),
+      write_buffer_(std::move(write_buffer)),
+      is_socket_(is_socket),
+      status_flags_(status_flags),
+      close_on_exec_(close_on_exec),
+      closed_(false) {}
+
+IOContextPipe::~IOContextPipe() { Close(); }
+
+ssize_t IOContextPipe::Read(void *buf, size_t count) {
+  struct iovec iov = {buf, count};
+  return ReadBuffers(&iov, 1, 0);
+}
+
+ssize_t IOContextPipe::Write(const void *buf, size_t count) {
+  struct iovec iov = {const_cast<void *>(buf), count};
+  return WriteBuffers(&iov, 1, 0);
+}
+
+int IOContextPipe::Close() {
+  if (closed_.exchange(true)) {
+    return 0;
+  }
+  if (read_buffer_) {
+    read_buffer_->CloseReader();
+  }
+  if (write_buffer_) {
+    write_buffer_->CloseWriter();
+  }
+  return 0;
+}
+
+int IOContextPipe::LSeek(off_t offset, int whence) {
+  errno = ESPIPE;
+  return -1;
+}
+
+int IOContextPipe::FCntl(int cmd, int64_t arg) {
+  switch (cmd) {
+    case F_GETFL: {
+      int access_mode = O_RDWR;
+      if (!write_buffer_) {
+        access_mode = O_RDONLY;
+      } else if (!read_buffer_) {
+        access_mode = O_WRONLY;
+      }
+      return access_mode | status_flags_.load();
+    }
+    case F_SETFL: {
+      // Only O_NONBLOCK may be changed. Packet mode is fixed when the pipe is
+      // created.
+      int flags = status_flags_.load();
+      while (!status_flags_.compare_exchange_weak(
+          flags, (flags & ~O_NONBLOCK) | (arg & O_NONBLOCK))) {
+      }
+      return 0;
+    }
+    case F_GETFD:
+      return close_on_exec_.load() ? FD_CLOEXEC : 0;
+    case F_SETFD:
+      close_on_exec_.store(arg & FD_CLOEXEC);
+      return 0;
+    case F_GETPIPE_SZ:
+    case F_SETPIPE_SZ: {
+      if (is_socket_) {
+        errno = EBADF;
+        return -1;
+      }
+      PipeBuffer *buffer = read_buffer_ ? read_buffer_.get()
+                                        : write_buffer_.get();
+      return cmd == F_GETPIPE_SZ ? buffer->capacity()
+                                 : buffer->SetCapacity(arg);
+    }
+    default:
+      errno = EINVAL;
+      return -1;
+  }
+}
+
+int IOContextPipe::FStat(struct stat *st) {
+  memset(st, 0, sizeof(*st));
+  st->st_mode = (is_socket_ ? S_IFSOCK : S_IFIFO) | S_IRUSR | S_IWUSR;
+  st->st_nlink = 1;
+  st->st_blksize = kPipeBufSize;
+  return 0;
+}
+
+int IOContextPipe::Isatty() {
+  errno = ENOTTY;
+  return 0;
+}
+
+ssize_t IOContextPipe::Writev(const struct iovec *iov, int iovcnt) {
+  return WriteBuffers(iov, iovcnt, 0);
+}
+
+ssize_t IOContextPipe::Readv(const struct iovec *iov, int iovcnt) {
+  return ReadBuffers(iov, iovcnt, 0);
+}
+
+int IOContextPipe::SetSockOpt(int level, int option_name,
+                              const void *option_value, socklen_t option_len) {
+  if (!CheckSocket()) {
+    return -1;
+  }
+  if (level == SOL_SOCKET &&
+      (option_name == SO_SNDBUF || option_name == SO_RCVBUF)) {
+    // Buffer sizes are fixed, and are only hints on Linux as well.
+    return 0;
+  }
+  errno = ENOPROTOOPT;
+  return -1;
+}
+
+int IOContextPipe::Shutdown(int how) {
+  if (!CheckSocket()) {
+    return -1;
+  }
+  if (how != SHUT_RD && how != SHUT_WR && how != SHUT_RDWR) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (how != SHUT_WR) {
+    read_buffer_->CloseReader();
+  }
+  if (how != SHUT_RD) {
+    write_buffer_->CloseWriter();
+  }
+  return 0;
+}
+
+ssize_t IOContextPipe::Send(const void *buf, size_t len, int flags) {
+  if (!CheckSocket()) {
+    return -1;
+  }
+  struct iovec iov = {const_cast<void *>(buf), len};
+  return WriteBuffers(&iov, 1, flags);
+}
+
+int IOContextPipe::GetSockOpt(int level, int optname, void *optval,
+                              socklen_t *optlen) {
+  if (!CheckSocket()) {
+    return -1;
+  }
+  if (level != SOL_SOCKET) {
+    errno = ENOPROTOOPT;
+    return -1;
+  }
+  int value;
+  switch (optname) {
+    case SO_TYPE:
+      value = SOCK_STREAM;
+      break;
+    case SO_ERROR:
+      value = 0;
+      break;
+    case SO_SNDBUF:
+      value = write_buffer_->capacity();
+      break;
+    case SO_RCVBUF:
+      value = read_buffer_->capacity();
+      break;
+    default:
+      errno = ENOPROTOOPT;
+      return -1;
+  }
+  if (!optval || !optlen || *optlen < sizeof(value)) {
+    errno = EINVAL;
+    return -1;
+  }
+  memcpy(optval, &value, sizeof(value));
+  *optlen = sizeof(value);
+  return 0;
+}
+
+ssize_t IOContextPipe::SendMsg(const struct msghdr *msg, int flags) {
+  if (!CheckSocket()) {
+    return -1;
+  }
+  if (msg->msg_controllen > 0) {
+    // Passing file descriptors between sockets is not supported.
+    errno = EOPNOTSUPP;
+    return -1;
+  }
+  return WriteBuffers(msg->msg_iov, msg->msg_iovlen, flags);
+}
+
+ssize_t IOContextPipe::RecvMsg(struct msghdr *msg, int flags) {
+  if (!CheckSocket()) {
+    return -1;
+  }
+  ssize_t ret = ReadBuffers(msg->msg_iov, msg->msg_iovlen, flags);
+  if (ret >= 0) {
+    // The peer socket is unnamed.
+    msg->msg_namelen = 0;
+    msg->msg_controllen = 0;
+    msg->msg_flags = 0;
+  }
+  return ret;
+}
+
+int IOContextPipe::GetSockName(struct sockaddr *addr, socklen_t *addrlen) {
+  if (!CheckSocket()) {
+    return -1;
+  }
+  GetUnnamedAddress(addr, addrlen);
+  return 0;
+}
+
+int IOContextPipe::GetPeerName(struct sockaddr *addr, socklen_t *addrlen) {
+  if (!CheckSocket()) {
+    return -1;
+  }
+  GetUnnamedAddress(addr, addrlen);
+  return 0;
+}
+
+ssize_t IOContextPipe::RecvFrom(void *buf, size_t len, int flags,
+                                struct sockaddr *src_addr,
+                                socklen_t *addrlen) {
+  if (!CheckSocket()) {
+    return -1;
+  }
+  struct iovec iov = {buf, len};
+  ssize_t ret = ReadBuffers(&iov, 1, flags);
+  if (ret >= 0 && src_addr && addrlen) {
+    // The peer socket is unnamed.
+    *addrlen = 0;
+  }
+  return ret;
+}
+
+int IOContextPipe::PollReadiness(uint64_t *generation) {
+  int events = 0;
+  *generation = 0;
+  bool peer_closed_write = false;
+  bool peer_closed_read = false;
+  if (read_buffer_) {
+    PipeBuffer::State state = read_buffer_->GetState();
+    *generation += state.changes;
+    if (state.readable) {
+      events |= POLLIN | POLLRDNORM;
+    }
+    peer_closed_write = !state.writer_open;
+  }
+  if (write_buffer_) {
+    PipeBuffer::State state = write_buffer_->GetState();
+    *generation += state.changes;
+    if (state.writable) {
+      events |= POLLOUT | POLLWRNORM;
+    }
+    peer_closed_read = !state.reader_open;
+  }
+
+  if (!is_socket_) {
+    if (peer_closed_write) {
+      events |= POLLHUP;
+    }
+    if (peer_closed_read) {
+      events |= POLLERR;
+    }
+    return events;
+  }
+  if (peer_closed_write) {
+    // End of file can be read without blocking.
+    events |= POLLIN | POLLRDNORM | POLLRDHUP;
+  }
+  if (peer_closed_read) {
+    // A write fails with EPIPE without blocking.
+    events |= POLLOUT | POLLWRNORM;
+  }
+  if (peer_closed_write && peer_closed_read) {
+    events |= POLLHUP;
+  }
+  return events;
+}
+
+bool IOContextPipe::NonBlocking(int flags) const {
+  return (status_flags_.load() & O_NONBLOCK) || (flags & MSG_DONTWAIT);
+}
+
+ssize_t IOContextPipe::ReadBuffers(const struct iovec *iov, int iovcnt,
+                                   int flags) {
+  if (!read_buffer_) {
+    errno = EBADF;
+    return -1;
+  }
+  if (flags & ~(MSG_DONTWAIT | MSG_WAITALL)) {
+    errno = EOPNOTSUPP;
+    return -1;
+  }
+  return read_buffer_->Read(iov, iovcnt, NonBlocking(flags),
+                            flags & MSG_WAITALL);
+}
+
+ssize_t IOContextPipe::WriteBuffers(const struct iovec *iov, int iovcnt,
+                                    int flags) {
+  if (!write_buffer_) {
+    errno = EBADF;
+    return -1;
+  }
+  if (flags & ~(MSG_DONTWAIT | MSG_NOSIGNAL)) {
+    errno = EOPNOTSUPP;
+    return -1;
+  }
+  return write_buffer_->Write(iov, iovcnt, NonBlocking(flags));
+}
+
+bool IOContextPipe::CheckSocket() const {
+  if (!is_socket_) {
+    errno = ENOTSOCK;
+    return false;
+  }
+  return true;
+}
+
+void IOContextPipe::GetUnnamedAddress(struct sockaddr *addr,
+                                      socklen_t *addrlen) const {
+  sa_family_t family = AF_UNIX;
+  memcpy(addr, &family, std::min<size_t>(*addrlen, sizeof(family)));
+  *addrlen = sizeof(family);
+}
+
+}  // namespace io
+}  // namespace asylo
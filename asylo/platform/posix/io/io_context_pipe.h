@@ -0,0 +1,124 @@
+/*
+ *
+ * Copyright 2018 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_POSIX_IO_IO_CONTEXT_PIPE_H_
+#define ASYLO_PLATFORM_POSIX_IO_IO_CONTEXT_PIPE_H_
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+#include "asylo/platform/posix/io/io_manager.h"
+
+namespace asylo {
+namespace io {
+
+// The data in flight in one direction of a pipe or socket pair.
+class PipeBuffer;
+
+// IOContext implementation of one end of a pipe, or of one socket of an
+// AF_UNIX stream socket pair, whose data never leaves the enclave. Reads and
+// writes copy through a RingBuffer in enclave memory instead of exiting to the
+// host, and readiness is reported to poll(), select() and epoll_wait() through
+// PollReadiness(). Writes with no reader left fail with EPIPE; SIGPIPE is not
+// raised.
+class IOContextPipe : public IOManager::IOContext {
+ public:
+  // The default capacity of a pipe, which is also the largest capacity that
+  // F_SETPIPE_SZ accepts.
+  static constexpr size_t kDefaultPipeSize = 16 * 4096;
+
+  // Creates the read end and the write end of a pipe. |flags| is a bitwise-or
+  // of O_CLOEXEC, O_DIRECT and O_NONBLOCK, as accepted by pipe2().
+  static void CreatePipe(int flags, std::unique_ptr<IOContextPipe> *read_end,
+                         std::unique_ptr<IOContextPipe> *write_end);
+
+  // Creates a connected pair of AF_UNIX stream sockets. |flags| is a
+  // bitwise-or of SOCK_CLOEXEC and SOCK_NONBLOCK.
+  static void CreateSocketPair(int flags, std::unique_ptr<IOContextPipe> *first,
+                               std::unique_ptr<IOContextPipe> *second);
+
+  ~IOContextPipe() override;
+
+  ssize_t Read(void *buf, size_t count) override;
+  ssize_t Write(const void *buf, size_t count) override;
+  int Close() override;
+  int LSeek(off_t offset, int whence) override;
+  int FCntl(int cmd, int64_t arg) override;
+  int FStat(struct stat *st) override;
+  int Isatty() override;
+  ssize_t Writev(const struct iovec *iov, int iovcnt) override;
+  ssize_t Readv(const struct iovec *iov, int iovcnt) override;
+  int SetSockOpt(int level, int option_name, const void *option_value,
+                 socklen_t option_len) override;
+  int Shutdown(int how) override;
+  ssize_t Send(const void *buf, size_t len, int flags) override;
+  int GetSockOpt(int level, int optname, void *optval,
+                 socklen_t *optlen) override;
+  ssize_t SendMsg(const struct msghdr *msg, int flags) override;
+  ssize_t RecvMsg(struct msghdr *msg, int flags) override;
+  int GetSockName(struct sockaddr *addr, socklen_t *addrlen) override;
+  int GetPeerName(struct sockaddr *addr, socklen_t *addrlen) override;
+  ssize_t RecvFrom(void *buf, size_t len, int flags, struct sockaddr *src_addr,
+                   socklen_t *addrlen) override;
+  int PollReadiness(uint64_t *generation) override;
+
+ private:
+  // Creates an endpoint that reads from |read_buffer| and writes to
+  // |write_buffer|, either of which may be null. |status_flags| holds the
+  // O_NONBLOCK and O_DIRECT file status flags.
+  IOContextPipe(std::shared_ptr<PipeBuffer> read_buffer,
+                std::shared_ptr<PipeBuffer> write_buffer, bool is_socket,
+                int status_flags, bool close_on_exec);
+
+  // Returns whether calls should fail with EAGAIN rather than block, given the
+  // MSG_* |flags| of a socket call.
+  bool NonBlocking(int flags = 0) const;
+
+  // Reads into or writes from the given buffers, honoring the MSG_DONTWAIT
+  // and MSG_WAITALL |flags|.
+  ssize_t ReadBuffers(const struct iovec *iov, int iovcnt, int flags);
+  ssize_t WriteBuffers(const struct iovec *iov, int iovcnt, int flags);
+
+  // Sets errno to ENOTSOCK and returns false if this is not a socket.
+  bool CheckSocket() const;
+
+  // Writes the unnamed AF_UNIX address of either socket to |addr|.
+  void GetUnnamedAddress(struct sockaddr *addr, socklen_t *addrlen) const;
+
+  const std::shared_ptr<PipeBuffer> read_buffer_;
+  const std::shared_ptr<PipeBuffer> write_buffer_;
+  const bool is_socket_;
+
+  // The O_NONBLOCK and O_DIRECT file status flags.
+  std::atomic<int> status_flags_;
+
+  // The FD_CLOEXEC file descriptor flag. This is kept per stream rather than
+  // per file descriptor, and has no effect since enclaves cannot exec().
+  std::atomic<bool> close_on_exec_;
+
+  std::atomic<bool> closed_;
+};
+
+}  // namespace io
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_POSIX_IO_IO_CONTEXT_PIPE_H_
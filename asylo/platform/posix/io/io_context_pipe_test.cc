@@ -0,0 +1,382 @@
+/*
+ *
+ * Copyright 2018 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+// Tests the behavior of pipes and socket pairs that matters to in-enclave
+// implementations: blocking, end-of-file and readiness reporting through
+// poll(), select() and epoll_wait().
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+namespace asylo {
+namespace {
+
+constexpr char kMessage[] = "producer to consumer";
+
+class PipeFds {
+ public:
+  PipeFds() : fds_{-1, -1} {}
+  ~PipeFds() {
+    for (int fd : fds_) {
+      if (fd >= 0) {
+        close(fd);
+      }
+    }
+  }
+
+  int *get() { return fds_; }
+  int operator[](int i) const { return fds_[i]; }
+
+  // Closes one of the file descriptors early.
+  void Close(int i) {
+    close(fds_[i]);
+    fds_[i] = -1;
+  }
+
+ private:
+  int fds_[2];
+};
+
+TEST(IOContextPipeTest, PollWakesWhenDataIsWritten) {
+  PipeFds fds;
+  ASSERT_EQ(pipe(fds.get()), 0) << strerror(errno);
+
+  struct pollfd pfd = {fds[0], POLLIN, 0};
+  EXPECT_EQ(poll(&pfd, 1, 0), 0);
+
+  std::thread writer([&fds] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(write(fds[1], kMessage, sizeof(kMessage)), sizeof(kMessage));
+  });
+  ASSERT_EQ(poll(&pfd, 1, -1), 1) << strerror(errno);
+  EXPECT_EQ(pfd.revents, POLLIN);
+  writer.join();
+
+  char buffer[sizeof(kMessage)];
+  EXPECT_EQ(read(fds[0], buffer, sizeof(buffer)), sizeof(kMessage));
+  EXPECT_STREQ(buffer, kMessage);
+}
+
+// Inside an enclave, the socket is a host file descriptor, so the host waits
+// on it and must still be woken by the write to the pipe.
+TEST(IOContextPipeTest, PollWithHostFdsWakesWhenDataIsWritten) {
+  PipeFds fds;
+  ASSERT_EQ(pipe(fds.get()), 0) << strerror(errno);
+  int socket_fd = socket(AF_INET, SOCK_DGRAM, 0);
+  ASSERT_GE(socket_fd, 0) << strerror(errno);
+
+  struct pollfd pfds[2] = {{fds[0], POLLIN, 0}, {socket_fd, POLLIN, 0}};
+  std::thread writer([&fds] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(write(fds[1], kMessage, sizeof(kMessage)), sizeof(kMessage));
+  });
+  auto start = std::chrono::steady_clock::now();
+  ASSERT_EQ(poll(pfds, 2, 10000), 1) << strerror(errno);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+  EXPECT_EQ(pfds[0].revents, POLLIN);
+  EXPECT_EQ(pfds[1].revents, 0);
+  writer.join();
+  close(socket_fd);
+}
+
+TEST(IOContextPipeTest, PollReportsClosedEnds) {
+  PipeFds fds;
+  ASSERT_EQ(pipe(fds.get()), 0) << strerror(errno);
+
+  struct pollfd pfd = {fds[1], POLLOUT, 0};
+  ASSERT_EQ(poll(&pfd, 1, 0), 1);
+  EXPECT_EQ(pfd.revents, POLLOUT);
+
+  fds.Close(0);
+  ASSERT_EQ(poll(&pfd, 1, 0), 1);
+  EXPECT_TRUE(pfd.revents & POLLERR);
+}
+
+TEST(IOContextPipeTest, ReaderSeesEndOfFileAfterData) {
+  PipeFds fds;
+  ASSERT_EQ(pipe(fds.get()), 0) << strerror(errno);
+  ASSERT_EQ(write(fds[1], kMessage, sizeof(kMessage)), sizeof(kMessage));
+  fds.Close(1);
+
+  struct pollfd pfd = {fds[0], POLLIN, 0};
+  ASSERT_EQ(poll(&pfd, 1, 0), 1);
+  EXPECT_TRUE(pfd.revents & POLLIN);
+  EXPECT_TRUE(pfd.revents & POLLHUP);
+
+  char buffer[2 * sizeof(kMessage)];
+  EXPECT_EQ(read(fds[0], buffer, sizeof(buffer)), sizeof(kMessage));
+  EXPECT_EQ(read(fds[0], buffer, sizeof(buffer)), 0);
+}
+
+TEST(IOContextPipeTest, BlockingReadWaitsForWriter) {
+  PipeFds fds;
+  ASSERT_EQ(pipe(fds.get()), 0) << strerror(errno);
+
+  std::thread writer([&fds] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(write(fds[1], kMessage, sizeof(kMessage)), sizeof(kMessage));
+  });
+  char buffer[sizeof(kMessage)];
+  EXPECT_EQ(read(fds[0], buffer, sizeof(buffer)), sizeof(kMessage));
+  EXPECT_STREQ(buffer, kMessage);
+  writer.join();
+}
+
+TEST(IOContextPipeTest, BlockingWriteLargerThanPipe) {
+  PipeFds fds;
+  ASSERT_EQ(pipe(fds.get()), 0) << strerror(errno);
+  int pipe_size = fcntl(fds[1], F_GETPIPE_SZ);
+  ASSERT_GT(pipe_size, 0);
+
+  std::string data(4 * pipe_size, '\0');
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<char>(i * 7);
+  }
+  std::thread writer([&fds, &data] {
+    EXPECT_EQ(write(fds[1], data.data(), data.size()), data.size());
+  });
+
+  std::string received;
+  char buffer[1000];
+  while (received.size() < data.size()) {
+    ssize_t ret = read(fds[0], buffer, sizeof(buffer));
+    ASSERT_GT(ret, 0) << strerror(errno);
+    received.append(buffer, ret);
+  }
+  writer.join();
+  EXPECT_EQ(received, data);
+}
+
+TEST(IOContextPipeTest, VectoredIo) {
+  PipeFds fds;
+  ASSERT_EQ(pipe(fds.get()), 0) << strerror(errno);
+
+  char first[] = "abc";
+  char second[] = "defg";
+  struct iovec out[] = {{first, 3}, {second, 4}};
+  ASSERT_EQ(writev(fds[1], out, 2), 7);
+
+  char head[2];
+  char tail[5];
+  struct iovec in[] = {{head, sizeof(head)}, {tail, sizeof(tail)}};
+  ASSERT_EQ(readv(fds[0], in, 2), 7);
+  EXPECT_EQ(std::string(head, 2), "ab");
+  EXPECT_EQ(std::string(tail, 5), "cdefg");
+}
+
+TEST(IOContextPipeTest, SelectReportsReadyEnds) {
+  PipeFds fds;
+  ASSERT_EQ(pipe(fds.get()), 0) << strerror(errno);
+  int nfds = std::max(fds[0], fds[1]) + 1;
+
+  fd_set readfds;
+  FD_ZERO(&readfds);
+  FD_SET(fds[0], &readfds);
+  struct timeval timeout = {0, 0};
+  EXPECT_EQ(select(nfds, &readfds, nullptr, nullptr, &timeout), 0);
+
+  std::thread writer([&fds] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(write(fds[1], kMessage, sizeof(kMessage)), sizeof(kMessage));
+  });
+  FD_ZERO(&readfds);
+  FD_SET(fds[0], &readfds);
+  fd_set writefds;
+  FD_ZERO(&writefds);
+  FD_SET(fds[0], &writefds);
+  ASSERT_EQ(select(nfds, &readfds, &writefds, nullptr, nullptr), 1);
+  EXPECT_TRUE(FD_ISSET(fds[0], &readfds));
+  EXPECT_FALSE(FD_ISSET(fds[0], &writefds));
+  writer.join();
+}
+
+TEST(IOContextPipeTest, SelectWritesBackRemainingTime) {
+  PipeFds fds;
+  ASSERT_EQ(pipe(fds.get()), 0) << strerror(errno);
+
+  // |nfds| may exceed FD_SETSIZE.
+  fd_set readfds;
+  FD_ZERO(&readfds);
+  FD_SET(fds[0], &readfds);
+  struct timeval timeout = {0, 20000};
+  EXPECT_EQ(select(FD_SETSIZE + 1, &readfds, nullptr, nullptr, &timeout), 0);
+  EXPECT_EQ(timeout.tv_sec, 0);
+  EXPECT_EQ(timeout.tv_usec, 0);
+
+  ASSERT_EQ(write(fds[1], kMessage, sizeof(kMessage)), sizeof(kMessage));
+  FD_ZERO(&readfds);
+  FD_SET(fds[0], &readfds);
+  timeout = {100, 0};
+  ASSERT_EQ(select(fds[0] + 1, &readfds, nullptr, nullptr, &timeout), 1);
+  EXPECT_TRUE(FD_ISSET(fds[0], &readfds));
+  EXPECT_GT(timeout.tv_sec, 90);
+}
+
+TEST(IOContextPipeTest, EpollLevelTriggered) {
+  PipeFds fds;
+  ASSERT_EQ(pipe(fds.get()), 0) << strerror(errno);
+  int epfd = epoll_create(1);
+  ASSERT_GE(epfd, 0) << strerror(errno);
+
+  struct epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.u64 = 0x1234;
+  ASSERT_EQ(epoll_ctl(epfd, EPOLL_CTL_ADD, fds[0], &event), 0)
+      << strerror(errno);
+  EXPECT_EQ(epoll_ctl(epfd, EPOLL_CTL_ADD, fds[0], &event), -1);
+  EXPECT_EQ(errno, EEXIST);
+
+  struct epoll_event ready[4];
+  EXPECT_EQ(epoll_wait(epfd, ready, 4, 0), 0);
+
+  std::thread writer([&fds] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(write(fds[1], kMessage, sizeof(kMessage)), sizeof(kMessage));
+  });
+  ASSERT_EQ(epoll_wait(epfd, ready, 4, -1), 1) << strerror(errno);
+  EXPECT_EQ(ready[0].events, EPOLLIN);
+  EXPECT_EQ(ready[0].data.u64, 0x1234);
+  writer.join();
+
+  // The event is reported again until the data is read.
+  ASSERT_EQ(epoll_wait(epfd, ready, 4, 0), 1);
+  char buffer[sizeof(kMessage)];
+  ASSERT_EQ(read(fds[0], buffer, sizeof(buffer)), sizeof(kMessage));
+  EXPECT_EQ(epoll_wait(epfd, ready, 4, 0), 0);
+
+  ASSERT_EQ(epoll_ctl(epfd, EPOLL_CTL_DEL, fds[0], nullptr), 0);
+  ASSERT_EQ(write(fds[1], kMessage, sizeof(kMessage)), sizeof(kMessage));
+  EXPECT_EQ(epoll_wait(epfd, ready, 4, 0), 0);
+  close(epfd);
+}
+
+TEST(IOContextPipeTest, EpollEdgeTriggeredAndOneShot) {
+  PipeFds fds;
+  ASSERT_EQ(pipe(fds.get()), 0) << strerror(errno);
+  int epfd = epoll_create(1);
+  ASSERT_GE(epfd, 0) << strerror(errno);
+
+  struct epoll_event event = {};
+  event.events = EPOLLIN | EPOLLET;
+  ASSERT_EQ(epoll_ctl(epfd, EPOLL_CTL_ADD, fds[0], &event), 0);
+
+  struct epoll_event ready[4];
+  ASSERT_EQ(write(fds[1], kMessage, sizeof(kMessage)), sizeof(kMessage));
+  EXPECT_EQ(epoll_wait(epfd, ready, 4, 0), 1);
+  // No new data has arrived since the last report.
+  EXPECT_EQ(epoll_wait(epfd, ready, 4, 0), 0);
+  ASSERT_EQ(write(fds[1], kMessage, sizeof(kMessage)), sizeof(kMessage));
+  EXPECT_EQ(epoll_wait(epfd, ready, 4, 0), 1);
+
+  event.events = EPOLLIN | EPOLLONESHOT;
+  ASSERT_EQ(epoll_ctl(epfd, EPOLL_CTL_MOD, fds[0], &event), 0);
+  EXPECT_EQ(epoll_wait(epfd, ready, 4, 0), 1);
+  EXPECT_EQ(epoll_wait(epfd, ready, 4, 0), 0);
+  ASSERT_EQ(epoll_ctl(epfd, EPOLL_CTL_MOD, fds[0], &event), 0);
+  EXPECT_EQ(epoll_wait(epfd, ready, 4, 0), 1);
+  close(epfd);
+}
+
+TEST(IOContextPipeTest, PositionalIoFailsWithEspipe) {
+  PipeFds fds;
+  ASSERT_EQ(pipe(fds.get()), 0) << strerror(errno);
+
+  char buffer[sizeof(kMessage)];
+  EXPECT_EQ(pwrite(fds[1], kMessage, sizeof(kMessage), 0), -1);
+  EXPECT_EQ(errno, ESPIPE);
+  struct iovec iov = {buffer, sizeof(buffer)};
+  EXPECT_EQ(pwritev(fds[1], &iov, 1, 0), -1);
+  EXPECT_EQ(errno, ESPIPE);
+  EXPECT_EQ(pread(fds[0], buffer, sizeof(buffer), 0), -1);
+  EXPECT_EQ(errno, ESPIPE);
+  EXPECT_EQ(preadv(fds[0], &iov, 1, 0), -1);
+  EXPECT_EQ(errno, ESPIPE);
+}
+
+TEST(IOContextPipeTest, SocketPairIsBidirectional) {
+  PipeFds fds;
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds.get()), 0)
+      << strerror(errno);
+
+  struct stat st;
+  ASSERT_EQ(fstat(fds[0], &st), 0);
+  EXPECT_TRUE(S_ISSOCK(st.st_mode));
+
+  char buffer[sizeof(kMessage)];
+  for (int from = 0; from < 2; ++from) {
+    int to = 1 - from;
+    ASSERT_EQ(send(fds[from], kMessage, sizeof(kMessage), 0),
+              sizeof(kMessage));
+    ASSERT_EQ(recv(fds[to], buffer, sizeof(buffer), MSG_WAITALL),
+              sizeof(kMessage));
+    EXPECT_STREQ(buffer, kMessage);
+  }
+
+  EXPECT_EQ(recv(fds[0], buffer, sizeof(buffer), MSG_DONTWAIT), -1);
+  EXPECT_EQ(errno, EAGAIN);
+
+  int type;
+  socklen_t length = sizeof(type);
+  ASSERT_EQ(getsockopt(fds[0], SOL_SOCKET, SO_TYPE, &type, &length), 0);
+  EXPECT_EQ(type, SOCK_STREAM);
+}
+
+TEST(IOContextPipeTest, SocketPairShutdown) {
+  PipeFds fds;
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds.get()), 0)
+      << strerror(errno);
+
+  ASSERT_EQ(shutdown(fds[0], SHUT_WR), 0);
+  char buffer[sizeof(kMessage)];
+  EXPECT_EQ(read(fds[1], buffer, sizeof(buffer)), 0);
+
+  struct pollfd pfd = {fds[1], POLLIN | POLLRDHUP, 0};
+  ASSERT_EQ(poll(&pfd, 1, 0), 1);
+  EXPECT_TRUE(pfd.revents & POLLIN);
+  EXPECT_TRUE(pfd.revents & POLLRDHUP);
+
+  EXPECT_EQ(send(fds[0], kMessage, sizeof(kMessage), MSG_NOSIGNAL), -1);
+  EXPECT_EQ(errno, EPIPE);
+
+  // The other direction still works.
+  ASSERT_EQ(write(fds[1], kMessage, sizeof(kMessage)), sizeof(kMessage));
+  EXPECT_EQ(read(fds[0], buffer, sizeof(buffer)), sizeof(kMessage));
+}
+
+TEST(IOContextPipeTest, SocketPairRejectsUnsupportedTypes) {
+  int fds[2];
+  EXPECT_EQ(socketpair(AF_INET, SOCK_STREAM, 0, fds), -1);
+}
+
+}  // namespace
+}  // namespace asylo
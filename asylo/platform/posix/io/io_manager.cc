@@ -20,19 +20,26 @@
 
 #include <fcntl.h>
 #include <poll.h>
+#include <sys/select.h>
+#include <algorithm>
 #include <cerrno>
+#include <climits>
 #include <cstdint>
 #include <memory>
+#include <vector>
 
 #include "absl/algorithm/container.h"
-#include "absl/container/flat_hash_set.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "asylo/platform/arch/include/trusted/host_calls.h"
+#include "asylo/platform/core/trusted_global_state.h"
 #include "asylo/platform/posix/io/io_context_epoll.h"
 #include "asylo/platform/posix/io/io_context_eventfd.h"
 #include "asylo/platform/posix/io/io_context_inotify.h"
+#include "asylo/platform/posix/io/io_context_pipe.h"
 #include "asylo/platform/posix/io/native_paths.h"
+#include "asylo/platform/posix/io/readiness_notifier.h"
 #include "asylo/platform/posix/io/util.h"
 #include "asylo/util/posix_error_space.h"
 #include "asylo/util/statusor.h"
@@ -40,27 +47,181 @@
 namespace asylo {
 namespace io {
 
+namespace {
+
+// The number of hazard pointers of each thread. The last one is only used
+// within FileDescriptorTable calls, so the others bound how many I/O contexts
+// a thread can reference at once without falling back to shared ownership.
+constexpr int kHazardsPerThread = 4;
+
+// The hazard pointers of one thread. Each pointer is either null or an open
+// file that the thread is using, which must not be freed.
+//
+// Records are never freed. Enclaves run a fixed pool of threads, so there are
+// only ever as many records as threads that have done I/O.
+struct HazardRecord {
+  std::array<std::atomic<const void *>, kHazardsPerThread> hazards{};
+  HazardRecord *next = nullptr;
+};
+
+std::atomic<HazardRecord *> hazard_records{nullptr};
+
+// Returns the hazard record of the calling thread.
+HazardRecord *ThreadHazardRecord() {
+  static thread_local HazardRecord *record = nullptr;
+  if (!record) {
+    record = new HazardRecord;
+    record->next = hazard_records.load();
+    while (!hazard_records.compare_exchange_weak(record->next, record)) {
+    }
+  }
+  return record;
+}
+
+// Returns whether any thread has a hazard pointer to |file|.
+bool IsHazardous(const void *file) {
+  for (HazardRecord *record = hazard_records.load(); record;
+       record = record->next) {
+    for (const auto &hazard : record->hazards) {
+      if (hazard.load() == file) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Loads the pointer in |slot| and publishes it in |hazard|, retrying until the
+// published pointer is still the one in |slot|. From then on it cannot be
+// freed until |hazard| is cleared. Returns nullptr, with |hazard| cleared, if
+// |slot| is empty.
+template <typename T>
+T *Protect(const std::atomic<T *> &slot, std::atomic<const void *> *hazard) {
+  T *value = slot.load();
+  while (value) {
+    // Sequentially consistent, so that the store is visible before |slot| is
+    // read again. This pairs with IsHazardous() being called after the slot
+    // is cleared.
+    hazard->store(value);
+    T *current = slot.load();
+    if (current == value) {
+      return value;
+    }
+    value = current;
+  }
+  hazard->store(nullptr, std::memory_order_release);
+  return nullptr;
+}
+
+// Returns the index of the lowest set bit in |word|, which must not be zero.
+int LowestSetBit(uint64_t word) { return __builtin_ctzll(word); }
+
+// Returns the index of the highest set bit in |word|, which must not be zero.
+int HighestSetBit(uint64_t word) { return 63 - __builtin_clzll(word); }
+
+}  // namespace
+
+IOManager::FileDescriptorTable::ContextReference::ContextReference(
+    ContextReference &&other)
+    : context_(other.context_),
+      hazard_(other.hazard_),
+      owner_(std::move(other.owner_)) {
+  other.context_ = nullptr;
+  other.hazard_ = nullptr;
+}
+
+IOManager::FileDescriptorTable::ContextReference::~ContextReference() {
+  if (hazard_) {
+    hazard_->store(nullptr, std::memory_order_release);
+  }
+}
+
 IOManager::FileDescriptorTable::FileDescriptorTable()
-    : maximum_fd_soft_limit(kMaxOpenFiles),
+    : chunks_(),
+      used_(),
+      full_words_(),
+      maximum_fd_soft_limit(kDefaultMaxOpenFiles),
       maximum_fd_hard_limit(kMaxOpenFiles) {}
 
+IOManager::FileDescriptorTable::~FileDescriptorTable() {
+  for (int fd = GetHighestFileDescriptorUsed(); fd >= 0; --fd) {
+    if (!IsFileDescriptorUnused(fd)) {
+      Delete(fd);
+    }
+  }
+  for (OpenFile *file : retired_) {
+    delete file;
+  }
+  for (auto &chunk : chunks_) {
+    delete chunk.load();
+  }
+}
+
 std::shared_ptr<IOManager::IOContext> IOManager::FileDescriptorTable::Get(
     int fd) {
-  if (!IsFileDescriptorValid(fd) || !fd_table_[fd]) return nullptr;
-  return fd_table_[fd]->Get();
+  std::atomic<OpenFile *> *slot = FindSlot(fd);
+  if (!slot) {
+    return nullptr;
+  }
+  std::atomic<const void *> *hazard =
+      &ThreadHazardRecord()->hazards[kHazardsPerThread - 1];
+  OpenFile *file = Protect(*slot, hazard);
+  if (!file) {
+    return nullptr;
+  }
+  std::shared_ptr<IOContext> context = file->context;
+  hazard->store(nullptr, std::memory_order_release);
+  return context;
+}
+
+IOManager::FileDescriptorTable::ContextReference
+IOManager::FileDescriptorTable::Borrow(int fd) {
+  ContextReference reference;
+  std::atomic<OpenFile *> *slot = FindSlot(fd);
+  if (!slot) {
+    return reference;
+  }
+  HazardRecord *record = ThreadHazardRecord();
+  for (int i = 0; i < kHazardsPerThread - 1; ++i) {
+    std::atomic<const void *> *hazard = &record->hazards[i];
+    if (!hazard->load(std::memory_order_relaxed)) {
+      OpenFile *file = Protect(*slot, hazard);
+      if (file) {
+        reference.context_ = file->context.get();
+        reference.hazard_ = hazard;
+      }
+      return reference;
+    }
+  }
+  // All hazard pointers are held by enclosing calls on this thread.
+  reference.owner_ = Get(fd);
+  reference.context_ = reference.owner_.get();
+  return reference;
 }
 
 int IOManager::FileDescriptorTable::Delete(int fd) {
-  if (!IsFileDescriptorValid(fd)) return 0;
-  int close_result = 0;
-  fd_table_[fd]->WriteCloseResultTo(&close_result);
-  fd_table_[fd] = nullptr;
+  std::atomic<OpenFile *> *slot =
+      IsFileDescriptorValid(fd) ? FindSlot(fd) : nullptr;
+  OpenFile *file = slot ? slot->load() : nullptr;
+  if (!file) {
+    errno = EBADF;
+    return -1;
+  }
+  slot->store(nullptr);
+  used_[fd / kBitsPerWord] &= ~(uint64_t{1} << (fd % kBitsPerWord));
+  full_words_[fd / kBitsPerWord / kBitsPerWord] &=
+      ~(uint64_t{1} << (fd / kBitsPerWord % kBitsPerWord));
+  if (--file->descriptor_count > 0) {
+    return 0;
+  }
+  int close_result = file->context->Close() == -1 ? -1 : 0;
+  Retire(file);
   return close_result;
 }
 
 bool IOManager::FileDescriptorTable::IsFileDescriptorUnused(int fd) {
   if (!IsFileDescriptorValid(fd)) return false;
-  return !fd_table_[fd];
+  return !(used_[fd / kBitsPerWord] & (uint64_t{1} << (fd % kBitsPerWord)));
 }
 
 int IOManager::FileDescriptorTable::Insert(IOContext *context) {
@@ -68,26 +229,31 @@ int IOManager::FileDescriptorTable::Insert(IOContext *context) {
   if (fd < 0) {
     return -1;
   }
-  fd_table_[fd] = std::make_shared<AutoCloseIOContext>(context);
+  Assign(fd, new OpenFile(context));
   return fd;
 }
 
 int IOManager::FileDescriptorTable::CopyFileDescriptor(int oldfd, int startfd) {
   int newfd = GetNextFreeFileDescriptor(startfd);
-  if (!IsFileDescriptorValid(oldfd) || newfd == -1) {
+  if (!IsFileDescriptorValid(oldfd) || IsFileDescriptorUnused(oldfd) ||
+      newfd == -1) {
     return -1;
   }
-  fd_table_[newfd] = fd_table_[oldfd];
+  OpenFile *file = FindSlot(oldfd)->load();
+  ++file->descriptor_count;
+  Assign(newfd, file);
   return newfd;
 }
 
 int IOManager::FileDescriptorTable::CopyFileDescriptorToSpecifiedTarget(
     int oldfd, int newfd) {
-  if (!IsFileDescriptorValid(oldfd) || !IsFileDescriptorValid(newfd) ||
-      fd_table_[newfd]) {
+  if (!IsFileDescriptorValid(oldfd) || IsFileDescriptorUnused(oldfd) ||
+      !IsFileDescriptorUnused(newfd)) {
     return -1;
   }
-  fd_table_[newfd] = fd_table_[oldfd];
+  OpenFile *file = FindSlot(oldfd)->load();
+  ++file->descriptor_count;
+  Assign(newfd, file);
   return newfd;
 }
 
@@ -121,27 +287,82 @@ bool IOManager::FileDescriptorTable::IsFileDescriptorValid(int fd) {
   return fd >= 0 && fd < kMaxOpenFiles;
 }
 
+std::atomic<IOManager::FileDescriptorTable::OpenFile *>
+    *IOManager::FileDescriptorTable::FindSlot(int fd) {
+  if (!IsFileDescriptorValid(fd)) return nullptr;
+  Chunk *chunk =
+      chunks_[fd / kFileDescriptorsPerChunk].load(std::memory_order_acquire);
+  if (!chunk) return nullptr;
+  return &(*chunk)[fd % kFileDescriptorsPerChunk];
+}
+
+std::atomic<IOManager::FileDescriptorTable::OpenFile *>
+    &IOManager::FileDescriptorTable::GetOrCreateSlot(int fd) {
+  std::atomic<Chunk *> &chunk = chunks_[fd / kFileDescriptorsPerChunk];
+  if (!chunk.load(std::memory_order_relaxed)) {
+    chunk.store(new Chunk(), std::memory_order_release);
+  }
+  Chunk *allocated = chunk.load(std::memory_order_relaxed);
+  return (*allocated)[fd % kFileDescriptorsPerChunk];
+}
+
+void IOManager::FileDescriptorTable::Assign(int fd, OpenFile *file) {
+  GetOrCreateSlot(fd).store(file);
+  uint64_t &word = used_[fd / kBitsPerWord];
+  word |= uint64_t{1} << (fd % kBitsPerWord);
+  if (word == ~uint64_t{0}) {
+    full_words_[fd / kBitsPerWord / kBitsPerWord] |=
+        uint64_t{1} << (fd / kBitsPerWord % kBitsPerWord);
+  }
+}
+
+void IOManager::FileDescriptorTable::Retire(OpenFile *file) {
+  retired_.push_back(file);
+  retired_.erase(std::remove_if(retired_.begin(), retired_.end(),
+                                [](OpenFile *retired) {
+                                  if (IsHazardous(retired)) {
+                                    return false;
+                                  }
+                                  delete retired;
+                                  return true;
+                                }),
+                 retired_.end());
+}
+
 int IOManager::FileDescriptorTable::GetHighestFileDescriptorUsed() {
-  for (int i = kMaxOpenFiles - 1; i >= 0; --i) {
-    if (fd_table_[i]) {
-      return i;
+  for (int i = kWords - 1; i >= 0; --i) {
+    if (used_[i]) {
+      return i * kBitsPerWord + HighestSetBit(used_[i]);
     }
   }
   return -1;
 }
 
 int IOManager::FileDescriptorTable::GetNextFreeFileDescriptor(int startfd) {
-  if (startfd < 0) {
+  if (startfd < 0 || startfd >= maximum_fd_soft_limit) {
     return -1;
   }
   int fd = -1;
-  for (int i = startfd; i < maximum_fd_soft_limit; ++i) {
-    if (!fd_table_[i]) {
-      fd = i;
-      break;
+  int word = startfd / kBitsPerWord;
+  uint64_t free_bits =
+      ~used_[word] & (~uint64_t{0} << (startfd % kBitsPerWord));
+  if (free_bits) {
+    fd = word * kBitsPerWord + LowestSetBit(free_bits);
+  } else {
+    // Find the first word after |word| that is not full.
+    for (int i = (word + 1) / kBitsPerWord; i < kWords / kBitsPerWord; ++i) {
+      uint64_t free_words = ~full_words_[i];
+      if (i == (word + 1) / kBitsPerWord) {
+        free_words &= ~uint64_t{0} << ((word + 1) % kBitsPerWord);
+      }
+      if (free_words) {
+        int free_word = i * kBitsPerWord + LowestSetBit(free_words);
+        fd = free_word * kBitsPerWord + LowestSetBit(~used_[free_word]);
+        break;
+      }
     }
   }
-  return fd;
+  return fd < maximum_fd_soft_limit ? fd : -1;
 }
 
 int IOManager::Access(const char *path, int mode) {
@@ -152,8 +373,8 @@ int IOManager::Access(const char *path, int mode) {
 }
 
 int IOManager::CloseFileDescriptor(int fd) {
-  std::shared_ptr<IOContext> context = fd_table_.Get(fd);
-  if (context) {
+  if (fd_table_.IsFileDescriptorValid(fd) &&
+      !fd_table_.IsFileDescriptorUnused(fd)) {
     return fd_table_.Delete(fd);
   }
   errno = EBADF;
@@ -236,7 +457,8 @@ int IOManager::Open(const char *path, int flags, mode_t mode) {
 
 int IOManager::Dup(int oldfd) {
   absl::WriterMutexLock lock(&fd_table_lock_);
-  if (!fd_table_.IsFileDescriptorUnused(oldfd)) {
+  if (fd_table_.IsFileDescriptorValid(oldfd) &&
+      !fd_table_.IsFileDescriptorUnused(oldfd)) {
     int ret = fd_table_.CopyFileDescriptor(oldfd, 0);
     if (ret < 0) {
       errno = EINVAL;
@@ -249,7 +471,8 @@ int IOManager::Dup(int oldfd) {
 
 int IOManager::Dup2(int oldfd, int newfd) {
   absl::WriterMutexLock lock(&fd_table_lock_);
-  if (!fd_table_.IsFileDescriptorUnused(oldfd)) {
+  if (fd_table_.IsFileDescriptorValid(oldfd) &&
+      !fd_table_.IsFileDescriptorUnused(oldfd)) {
     if (oldfd == newfd) {
       return newfd;
     }
@@ -268,16 +491,72 @@ int IOManager::Dup2(int oldfd, int newfd) {
 }
 
 int IOManager::Pipe(int pipefd[2], int flags) {
-  int res = enc_untrusted_pipe2(pipefd, flags);
-  if (res != -1) {
-    pipefd[0] = RegisterHostFileDescriptor(pipefd[0]);
-    pipefd[1] = RegisterHostFileDescriptor(pipefd[1]);
-    if (pipefd[0] < 0 || pipefd[1] < 0) {
-      errno = EMFILE;
-      return -1;
+  if (flags & ~(O_CLOEXEC | O_DIRECT | O_NONBLOCK)) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  // Only host pipes are shared with the child enclave of a fork.
+  StatusOr<const EnclaveConfig *> config = GetEnclaveConfig();
+  if (config.ok() && config.ValueOrDie()->enable_fork()) {
+    int res = enc_untrusted_pipe2(pipefd, flags);
+    if (res != -1) {
+      pipefd[0] = RegisterHostFileDescriptor(pipefd[0]);
+      pipefd[1] = RegisterHostFileDescriptor(pipefd[1]);
+      if (pipefd[0] < 0 || pipefd[1] < 0) {
+        errno = EMFILE;
+        return -1;
+      }
     }
+    return res;
   }
-  return res;
+
+  std::unique_ptr<IOContextPipe> read_end;
+  std::unique_ptr<IOContextPipe> write_end;
+  IOContextPipe::CreatePipe(flags, &read_end, &write_end);
+  return InsertPair(std::move(read_end), std::move(write_end), pipefd);
+}
+
+int IOManager::SocketPair(int domain, int type, int protocol, int sv[2]) {
+  if (domain != AF_UNIX) {
+    errno = EAFNOSUPPORT;
+    return -1;
+  }
+  int flags = type & (SOCK_CLOEXEC | SOCK_NONBLOCK);
+  if ((type & ~flags) != SOCK_STREAM) {
+    errno = EOPNOTSUPP;
+    return -1;
+  }
+  if (protocol != 0) {
+    errno = EPROTONOSUPPORT;
+    return -1;
+  }
+
+  std::unique_ptr<IOContextPipe> first;
+  std::unique_ptr<IOContextPipe> second;
+  IOContextPipe::CreateSocketPair(flags, &first, &second);
+  return InsertPair(std::move(first), std::move(second), sv);
+}
+
+int IOManager::InsertPair(std::unique_ptr<IOContext> first,
+                          std::unique_ptr<IOContext> second, int fds[2]) {
+  absl::WriterMutexLock lock(&fd_table_lock_);
+  int first_fd = fd_table_.Insert(first.get());
+  if (first_fd < 0) {
+    errno = EMFILE;
+    return -1;
+  }
+  first.release();
+  int second_fd = fd_table_.Insert(second.get());
+  if (second_fd < 0) {
+    fd_table_.Delete(first_fd);
+    errno = EMFILE;
+    return -1;
+  }
+  second.release();
+  fds[0] = first_fd;
+  fds[1] = second_fd;
+  return 0;
 }
 
 int IOManager::Select(int nfds, fd_set *readfds, fd_set *writefds,
@@ -286,67 +565,52 @@ int IOManager::Select(int nfds, fd_set *readfds, fd_set *writefds,
     errno = EINVAL;
     return -1;
   }
+  // The sets cannot hold descriptors past FD_SETSIZE, so larger values of
+  // |nfds| are accepted but not scanned beyond it.
+  nfds = std::min(nfds, FD_SETSIZE);
+  int poll_timeout = -1;
+  absl::Time deadline;
+  if (timeout) {
+    if (timeout->tv_sec < 0 || timeout->tv_usec < 0) {
+      errno = EINVAL;
+      return -1;
+    }
+    int64_t timeout_ms = static_cast<int64_t>(timeout->tv_sec) * 1000 +
+                         (timeout->tv_usec + 999) / 1000;
+    poll_timeout = static_cast<int>(std::min<int64_t>(timeout_ms, INT_MAX));
+    deadline = absl::Now() + absl::DurationFromTimeval(*timeout);
+  }
 
-  // Translate the fd_sets into host file descriptors.
-  fd_set host_readfds, host_writefds, host_exceptfds;
-  FD_ZERO(&host_readfds);
-  FD_ZERO(&host_writefds);
-  FD_ZERO(&host_exceptfds);
-
-  int host_nfds = 0;
+  // Select is implemented with Poll, so that it covers streams implemented
+  // inside the enclave as well as host file descriptors.
+  std::vector<struct pollfd> fds;
   for (int fd = 0; fd < nfds; ++fd) {
+    short events = 0;
     if (readfds && FD_ISSET(fd, readfds)) {
-      std::shared_ptr<IOContext> context = fd_table_.Get(fd);
-      if (context) {
-        int host_fd = context->GetHostFileDescriptor();
-        FD_SET(host_fd, &host_readfds);
-        host_nfds = std::max(host_nfds, host_fd + 1);
-      }
+      events |= POLLIN;
     }
     if (writefds && FD_ISSET(fd, writefds)) {
-      std::shared_ptr<IOContext> context = fd_table_.Get(fd);
-      if (context) {
-        int host_fd = context->GetHostFileDescriptor();
-        FD_SET(host_fd, &host_writefds);
-        host_nfds = std::max(host_nfds, host_fd + 1);
-      }
+      events |= POLLOUT;
     }
     if (exceptfds && FD_ISSET(fd, exceptfds)) {
-      std::shared_ptr<IOContext> context = fd_table_.Get(fd);
-      if (context) {
-        int host_fd = context->GetHostFileDescriptor();
-        FD_SET(host_fd, &host_exceptfds);
-        host_nfds = std::max(host_nfds, host_fd + 1);
-      }
+      events |= POLLPRI;
+    }
+    if (events) {
+      fds.push_back({fd, events, 0});
     }
   }
-  int ret = enc_untrusted_select(host_nfds, &host_readfds, &host_writefds,
-                                 &host_exceptfds, timeout);
 
-  // On error, errno should have been set by the host.
+  int ret = Poll(fds.data(), fds.size(), poll_timeout);
+  // As on Linux, the time left is written back to |timeout|.
+  if (timeout) {
+    *timeout = absl::ToTimeval(
+        std::max(deadline - absl::Now(), absl::ZeroDuration()));
+  }
+  // On error, errno should have been set by Poll.
   if (ret < 0) {
     return ret;
   }
 
-  // Add the returned fd_sets into absl::flat_hash_set.
-  absl::flat_hash_set<int> host_readfds_set, host_writefds_set,
-      host_exceptfds_set;
-  for (int fd = 0; fd < nfds; ++fd) {
-    std::shared_ptr<IOContext> context = fd_table_.Get(fd);
-    if (context) {
-      int host_fd = context->GetHostFileDescriptor();
-      if (FD_ISSET(host_fd, &host_readfds)) {
-        host_readfds_set.insert(host_fd);
-      }
-      if (FD_ISSET(host_fd, &host_writefds)) {
-        host_writefds_set.insert(host_fd);
-      }
-      if (FD_ISSET(host_fd, &host_exceptfds)) {
-        host_exceptfds_set.insert(host_fd);
-      }
-    }
-  }
-
   if (readfds) {
     FD_ZERO(readfds);
   }
@@ -356,50 +620,139 @@ int IOManager::Select(int nfds, fd_set *readfds, fd_set *writefds,
   if (exceptfds) {
     FD_ZERO(exceptfds);
   }
-  // Go through the file descriptor table, if any host file descriptor is
-  // included in any of the sets, add the corresponding enclave fd to the
-  // enclave fd_set.
-  for (int fd = 0; fd < nfds; ++fd) {
-    std::shared_ptr<IOContext> context = fd_table_.Get(fd);
-    if (context) {
-      int host_fd = context->GetHostFileDescriptor();
-      if (readfds && host_readfds_set.find(host_fd) != host_readfds_set.end()) {
-        FD_SET(fd, readfds);
-      }
-      if (writefds &&
-          host_writefds_set.find(host_fd) != host_writefds_set.end()) {
-        FD_SET(fd, writefds);
-      }
-      if (exceptfds &&
-          host_exceptfds_set.find(host_fd) != host_exceptfds_set.end()) {
-        FD_SET(fd, exceptfds);
-      }
+  int num_set = 0;
+  for (const struct pollfd &pfd : fds) {
+    if ((pfd.events & POLLIN) &&
+        (pfd.revents & (POLLIN | POLLHUP | POLLERR))) {
+      FD_SET(pfd.fd, readfds);
+      ++num_set;
+    }
+    if ((pfd.events & POLLOUT) && (pfd.revents & (POLLOUT | POLLERR))) {
+      FD_SET(pfd.fd, writefds);
+      ++num_set;
+    }
+    if ((pfd.events & POLLPRI) && (pfd.revents & POLLPRI)) {
+      FD_SET(pfd.fd, exceptfds);
+      ++num_set;
     }
   }
-  return ret;
+  return num_set;
 }
 
 int IOManager::Poll(struct pollfd *fds, nfds_t nfds, int timeout) {
   std::vector<int> enclave_fd(nfds);
-  {
-    absl::ReaderMutexLock lock(&fd_table_lock_);
-    for (int i = 0; i < nfds; ++i) {
-      enclave_fd[i] = fds[i].fd;
-      std::shared_ptr<IOContext> context = fd_table_.Get(enclave_fd[i]);
-      if (context) {
-        fds[i].fd = context->GetHostFileDescriptor();
-      } else {
-        fds[i].fd = -1;
-      }
+  // The contexts of the streams implemented inside the enclave, which are
+  // polled here rather than by the host.
+  std::vector<std::shared_ptr<IOContext>> enclave_streams(nfds);
+  bool has_enclave_streams = false;
+  for (int i = 0; i < nfds; ++i) {
+    enclave_fd[i] = fds[i].fd;
+    std::shared_ptr<IOContext> context = fd_table_.Get(enclave_fd[i]);
+    uint64_t generation;
+    if (context && context->PollReadiness(&generation) >= 0) {
+      enclave_streams[i] = std::move(context);
+      has_enclave_streams = true;
+      fds[i].fd = -1;
+    } else if (context) {
+      fds[i].fd = context->GetHostFileDescriptor();
+    } else {
+      fds[i].fd = -1;
     }
   }
-  int ret = enc_untrusted_poll(fds, nfds, timeout);
+
+  int ret;
+  if (has_enclave_streams) {
+    ret = PollWithEnclaveStreams(fds, nfds, timeout, enclave_streams);
+  } else {
+    ret = enc_untrusted_poll(fds, nfds, timeout);
+  }
   for (int i = 0; i < nfds; ++i) {
     fds[i].fd = enclave_fd[i];
   }
   return ret;
 }
 
+int IOManager::PollWithEnclaveStreams(
+    struct pollfd *fds, nfds_t nfds, int timeout,
+    const std::vector<std::shared_ptr<IOContext>> &enclave_streams) {
+  // The host file descriptors are polled as a separate array, so that the host
+  // does not overwrite the events of enclave streams.
+  std::vector<struct pollfd> host_fds;
+  std::vector<nfds_t> host_index;
+  for (nfds_t i = 0; i < nfds; ++i) {
+    if (fds[i].fd >= 0) {
+      host_fds.push_back(fds[i]);
+      host_index.push_back(i);
+    }
+  }
+
+  absl::Time deadline = timeout < 0
+                            ? absl::InfiniteFuture()
+                            : absl::Now() + absl::Milliseconds(timeout);
+  ReadinessNotifier &notifier = ReadinessNotifier::GetInstance();
+  while (true) {
+    uint64_t notifier_generation = notifier.generation();
+    int ready = 0;
+    for (nfds_t i = 0; i < nfds; ++i) {
+      fds[i].revents = 0;
+      if (enclave_streams[i]) {
+        uint64_t generation;
+        int events = enclave_streams[i]->PollReadiness(&generation);
+        fds[i].revents =
+            events & (fds[i].events | POLLERR | POLLHUP | POLLNVAL);
+        if (fds[i].revents) {
+          ++ready;
+        }
+      }
+    }
+
+    if (!host_fds.empty()) {
+      // Unless enclave streams are already ready, the host waits on the
+      // wakeup file descriptor of |notifier| too, which is polled last.
+      bool host_wait = ready == 0;
+      int wakeup_fd = -1;
+      uint64_t epoch;
+      int host_timeout = 0;
+      if (host_wait) {
+        if (!notifier.BeginHostWait(notifier_generation, &wakeup_fd,
+                                    &epoch)) {
+          continue;
+        }
+        host_timeout = wakeup_fd >= 0
+                           ? ReadinessNotifier::RemainingTimeout(deadline)
+                           : ReadinessNotifier::HostWaitTimeout(deadline);
+      }
+      size_t num_host_fds = host_fds.size();
+      if (wakeup_fd >= 0) {
+        host_fds.push_back({wakeup_fd, POLLIN, 0});
+      }
+      int ret = enc_untrusted_poll(host_fds.data(), host_fds.size(),
+                                   host_timeout);
+      if (host_wait) {
+        notifier.EndHostWait(epoch);
+      }
+      if (ret > 0 && wakeup_fd >= 0 && host_fds.back().revents) {
+        --ret;
+      }
+      host_fds.resize(num_host_fds);
+      if (ret < 0) {
+        return -1;
+      }
+      for (size_t i = 0; i < host_fds.size(); ++i) {
+        fds[host_index[i]].revents = host_fds[i].revents;
+      }
+      ready += ret;
+    } else if (ready == 0 && notifier.WaitForChange(notifier_generation,
+                                                    deadline)) {
+      continue;
+    }
+
+    if (ready > 0 || absl::Now() >= deadline) {
+      return ready;
+    }
+  }
+}
+
 int IOManager::EpollCreate(int size) {
   if (size < 1) {
     errno = EINVAL;
@@ -421,26 +774,38 @@ int IOManager::EpollCreate(int size) {
 }
 
 int IOManager::EpollCtl(int epfd, int op, int fd, struct epoll_event *event) {
-  std::shared_ptr<IOContext> context;
-  {
-    absl::ReaderMutexLock lock(&fd_table_lock_);
-    context = fd_table_.Get(fd);
+  std::shared_ptr<IOContext> context = fd_table_.Get(fd);
+  uint64_t generation;
+  if (context && context->PollReadiness(&generation) >= 0) {
+    // The epoll instance must poll streams implemented inside the enclave
+    // itself. It holds on to them weakly, so that closing the stream removes
+    // it from the instance, as on Linux.
+    std::weak_ptr<IOContext> weak_context = context;
+    IOContext::ReadinessCallback readiness =
+        [weak_context](uint64_t *generation) {
+          std::shared_ptr<IOContext> context = weak_context.lock();
+          return context ? context->PollReadiness(generation) : -1;
+        };
+    return CallWithContext(epfd, [op, fd, &readiness, event](
+                                     IOContext *epoll_context) {
+      return epoll_context->EpollCtlEnclave(op, fd, std::move(readiness),
+                                            event);
+    });
   }
   int hostfd = context ? context->GetHostFileDescriptor() : -1;
   if (hostfd == -1) {
     errno = EBADF;
     return -1;
   }
-  return CallWithContext(
-      epfd, [op, hostfd, event](std::shared_ptr<IOContext> epoll_context) {
-        return epoll_context->EpollCtl(op, hostfd, event);
-      });
+  return CallWithContext(epfd, [op, hostfd, event](IOContext *epoll_context) {
+    return epoll_context->EpollCtl(op, hostfd, event);
+  });
 }
 
 int IOManager::EpollWait(int epfd, struct epoll_event *events, int maxevents,
                          int timeout) {
   return CallWithContext(
-      epfd, [events, maxevents, timeout](std::shared_ptr<IOContext> context) {
+      epfd, [events, maxevents, timeout](IOContext *context) {
         return context->EpollWait(events, maxevents, timeout);
       });
 }
@@ -474,14 +839,13 @@ int IOManager::InotifyInit(bool non_block) {
 }
 
 int IOManager::InotifyAddWatch(int fd, const char *pathname, uint32_t mask) {
-  return CallWithContext(
-      fd, [pathname, mask](std::shared_ptr<IOContext> inotify_context) {
-        return inotify_context->InotifyAddWatch(pathname, mask);
-      });
+  return CallWithContext(fd, [pathname, mask](IOContext *inotify_context) {
+    return inotify_context->InotifyAddWatch(pathname, mask);
+  });
 }
 
 int IOManager::InotifyRmWatch(int fd, int wd) {
-  return CallWithContext(fd, [wd](std::shared_ptr<IOContext> inotify_context) {
+  return CallWithContext(fd, [wd](IOContext *inotify_context) {
     return inotify_context->InotifyRmWatch(wd);
   });
 }
@@ -511,13 +875,9 @@ struct ErrorValue<Type,
 
 template <typename IOAction, typename ReturnType>
 ReturnType IOManager::CallWithContext(int fd, IOAction action) {
-  std::shared_ptr<IOContext> context;
-  {
-    absl::ReaderMutexLock lock(&fd_table_lock_);
-    context = fd_table_.Get(fd);
-  }
+  FileDescriptorTable::ContextReference context = fd_table_.Borrow(fd);
   if (context) {
-    return action(context);
+    return action(context.get());
   }
   errno = EBADF;
   return ErrorValue<ReturnType>::value;
@@ -575,7 +935,7 @@ ReturnType IOManager::CallWithHandler(const char *path1, const char *path2,
 }
 
 int IOManager::Read(int fd, char *buf, size_t count) {
-  return CallWithContext(fd, [buf, count](std::shared_ptr<IOContext> context) {
+  return CallWithContext(fd, [buf, count](IOContext *context) {
     return context->Read(buf, count);
   });
 }
@@ -658,7 +1018,7 @@ StatusOr<std::string> IOManager::CanonicalizePath(
 }
 
 int IOManager::Write(int fd, const char *buf, size_t count) {
-  return CallWithContext(fd, [buf, count](std::shared_ptr<IOContext> context) {
+  return CallWithContext(fd, [buf, count](IOContext *context) {
     return context->Write(buf, count);
   });
 }
@@ -725,7 +1085,7 @@ int IOManager::Truncate(const char *path, off_t length) {
 }
 
 int IOManager::FTruncate(int fd, off_t length) {
-  return CallWithContext(fd, [length](std::shared_ptr<IOContext> context) {
+  return CallWithContext(fd, [length](IOContext *context) {
     return context->FTruncate(length);
   });
 }
@@ -752,16 +1112,16 @@ int IOManager::ChMod(const char *pathname, mode_t mode) {
 }
 
 int IOManager::LSeek(int fd, off_t offset, int whence) {
-  return CallWithContext(fd,
-                         [offset, whence](std::shared_ptr<IOContext> context) {
-                           return context->LSeek(offset, whence);
-                         });
+  return CallWithContext(fd, [offset, whence](IOContext *context) {
+    return context->LSeek(offset, whence);
+  });
 }
 
 int IOManager::FCntl(int fd, int cmd, int64_t arg) {
   if (cmd == F_DUPFD) {
     absl::WriterMutexLock lock(&fd_table_lock_);
-    if (!fd_table_.IsFileDescriptorUnused(fd)) {
+    if (fd_table_.IsFileDescriptorValid(fd) &&
+        !fd_table_.IsFileDescriptorUnused(fd)) {
       int ret = fd_table_.CopyFileDescriptor(fd, arg);
       if (ret < 0) {
         errno = EINVAL;
@@ -771,44 +1131,43 @@ int IOManager::FCntl(int fd, int cmd, int64_t arg) {
     errno = EBADF;
     return -1;
   }
-  return CallWithContext(fd, [cmd, arg](std::shared_ptr<IOContext> context) {
+  return CallWithContext(fd, [cmd, arg](IOContext *context) {
     return context->FCntl(cmd, arg);
   });
 }
 
 int IOManager::FSync(int fd) {
-  return CallWithContext(
-      fd, [](std::shared_ptr<IOContext> context) { return context->FSync(); });
+  return CallWithContext(fd,
+                         [](IOContext *context) { return context->FSync(); });
 }
 
 int IOManager::FDataSync(int fd) {
-  return CallWithContext(fd, [](std::shared_ptr<IOContext> context) {
+  return CallWithContext(fd, [](IOContext *context) {
     return context->FDataSync();
   });
 }
 
 int IOManager::FStat(int fd, struct stat *stat_buffer) {
-  return CallWithContext(fd, [stat_buffer](std::shared_ptr<IOContext> context) {
+  return CallWithContext(fd, [stat_buffer](IOContext *context) {
     return context->FStat(stat_buffer);
   });
 }
 
 int IOManager::Isatty(int fd) {
-  return CallWithContext(
-      fd, [](std::shared_ptr<IOContext> context) { return context->Isatty(); });
+  return CallWithContext(fd,
+                         [](IOContext *context) { return context->Isatty(); });
 }
 
 int IOManager::FLock(int fd, int operation) {
-  return CallWithContext(fd, [operation](std::shared_ptr<IOContext> context) {
+  return CallWithContext(fd, [operation](IOContext *context) {
     return context->FLock(operation);
   });
 }
 
 int IOManager::Ioctl(int fd, int request, void *argp) {
-  return CallWithContext(fd,
-                         [request, argp](std::shared_ptr<IOContext> context) {
-                           return context->Ioctl(request, argp);
-                         });
+  return CallWithContext(fd, [request, argp](IOContext *context) {
+    return context->Ioctl(request, argp);
+  });
 }
 
 int IOManager::Mkdir(const char *path, mode_t mode) {
@@ -828,17 +1187,60 @@ int IOManager::Rename(const char *oldpath, const char *newpath) {
 }
 
 ssize_t IOManager::Writev(int fd, const struct iovec *iov, int iovcnt) {
-  return CallWithContext(fd, [iov, iovcnt](std::shared_ptr<IOContext> context) {
+  return CallWithContext(fd, [iov, iovcnt](IOContext *context) {
     return context->Writev(iov, iovcnt);
   });
 }
 
 ssize_t IOManager::Readv(int fd, const struct iovec *iov, int iovcnt) {
-  return CallWithContext(fd, [iov, iovcnt](std::shared_ptr<IOContext> context) {
+  return CallWithContext(fd, [iov, iovcnt](IOContext *context) {
     return context->Readv(iov, iovcnt);
   });
 }
 
+ssize_t IOManager::PRead(int fd, void *buf, size_t count, off_t offset) {
+  if (offset < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  return CallWithContext(fd, [buf, count, offset](IOContext *context) {
+    return context->PRead(buf, count, offset);
+  });
+}
+
+ssize_t IOManager::PWrite(int fd, const void *buf, size_t count,
+                          off_t offset) {
+  if (offset < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  return CallWithContext(fd, [buf, count, offset](IOContext *context) {
+    return context->PWrite(buf, count, offset);
+  });
+}
+
+ssize_t IOManager::PReadv(int fd, const struct iovec *iov, int iovcnt,
+                          off_t offset) {
+  if (offset < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  return CallWithContext(fd, [iov, iovcnt, offset](IOContext *context) {
+    return context->PReadv(iov, iovcnt, offset);
+  });
+}
+
+ssize_t IOManager::PWritev(int fd, const struct iovec *iov, int iovcnt,
+                           off_t offset) {
+  if (offset < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  return CallWithContext(fd, [iov, iovcnt, offset](IOContext *context) {
+    return context->PWritev(iov, iovcnt, offset);
+  });
+}
+
 mode_t IOManager::Umask(mode_t mask) { return enc_untrusted_umask(mask); }
 
 int IOManager::GetRLimit(int resource, struct rlimit *rlim) {
@@ -887,30 +1289,28 @@ int IOManager::SetRLimit(int resource, const struct rlimit *rlim) {
 int IOManager::SetSockOpt(int sockfd, int level, int option_name,
                           const void *option_value, socklen_t option_len) {
   return CallWithContext(sockfd, [level, option_name, option_value, option_len](
-                                     std::shared_ptr<IOContext> context) {
+                                     IOContext *context) {
     return context->SetSockOpt(level, option_name, option_value, option_len);
   });
 }
 
 int IOManager::Connect(int sockfd, const struct sockaddr *addr,
                        socklen_t addrlen) {
-  return CallWithContext(sockfd,
-                         [addr, addrlen](std::shared_ptr<IOContext> context) {
-                           return context->Connect(addr, addrlen);
-                         });
+  return CallWithContext(sockfd, [addr, addrlen](IOContext *context) {
+    return context->Connect(addr, addrlen);
+  });
 }
 
 int IOManager::Shutdown(int sockfd, int how) {
-  return CallWithContext(sockfd, [how](std::shared_ptr<IOContext> context) {
+  return CallWithContext(sockfd, [how](IOContext *context) {
     return context->Shutdown(how);
   });
 }
 
 ssize_t IOManager::Send(int sockfd, const void *buf, size_t len, int flags) {
-  return CallWithContext(sockfd,
-                         [buf, len, flags](std::shared_ptr<IOContext> context) {
-                           return context->Send(buf, len, flags);
-                         });
+  return CallWithContext(sockfd, [buf, len, flags](IOContext *context) {
+    return context->Send(buf, len, flags);
+  });
 }
 
 int IOManager::Socket(int domain, int type, int protocol) {
@@ -929,16 +1329,15 @@ int IOManager::Socket(int domain, int type, int protocol) {
 int IOManager::GetSockOpt(int sockfd, int level, int optname, void *optval,
                           socklen_t *optlen) {
   return CallWithContext(sockfd, [level, optname, optval,
-                                  optlen](std::shared_ptr<IOContext> context) {
+                                  optlen](IOContext *context) {
     return context->GetSockOpt(level, optname, optval, optlen);
   });
 }
 
 int IOManager::Accept(int sockfd, struct sockaddr *addr, socklen_t *addrlen) {
-  int ret = CallWithContext(
-      sockfd, [addr, addrlen](std::shared_ptr<IOContext> context) {
-        return context->Accept(addr, addrlen);
-      });
+  int ret = CallWithContext(sockfd, [addr, addrlen](IOContext *context) {
+    return context->Accept(addr, addrlen);
+  });
   if (ret < 0) {
     return -1;
   }
@@ -951,52 +1350,47 @@ int IOManager::Accept(int sockfd, struct sockaddr *addr, socklen_t *addrlen) {
 
 int IOManager::Bind(int sockfd, const struct sockaddr *addr,
                     socklen_t addrlen) {
-  return CallWithContext(sockfd,
-                         [addr, addrlen](std::shared_ptr<IOContext> context) {
-                           return context->Bind(addr, addrlen);
-                         });
+  return CallWithContext(sockfd, [addr, addrlen](IOContext *context) {
+    return context->Bind(addr, addrlen);
+  });
 }
 
 int IOManager::Listen(int sockfd, int backlog) {
-  return CallWithContext(sockfd, [backlog](std::shared_ptr<IOContext> context) {
+  return CallWithContext(sockfd, [backlog](IOContext *context) {
     return context->Listen(backlog);
   });
 }
 
 ssize_t IOManager::SendMsg(int sockfd, const struct msghdr *msg, int flags) {
-  return CallWithContext(sockfd,
-                         [msg, flags](std::shared_ptr<IOContext> context) {
-                           return context->SendMsg(msg, flags);
-                         });
+  return CallWithContext(sockfd, [msg, flags](IOContext *context) {
+    return context->SendMsg(msg, flags);
+  });
 }
 
 ssize_t IOManager::RecvMsg(int sockfd, struct msghdr *msg, int flags) {
-  return CallWithContext(sockfd,
-                         [msg, flags](std::shared_ptr<IOContext> context) {
-                           return context->RecvMsg(msg, flags);
-                         });
+  return CallWithContext(sockfd, [msg, flags](IOContext *context) {
+    return context->RecvMsg(msg, flags);
+  });
 }
 
 int IOManager::GetSockName(int sockfd, struct sockaddr *addr,
                            socklen_t *addrlen) {
-  return CallWithContext(sockfd,
-                         [addr, addrlen](std::shared_ptr<IOContext> context) {
-                           return context->GetSockName(addr, addrlen);
-                         });
+  return CallWithContext(sockfd, [addr, addrlen](IOContext *context) {
+    return context->GetSockName(addr, addrlen);
+  });
 }
 
 int IOManager::GetPeerName(int sockfd, struct sockaddr *addr,
                            socklen_t *addrlen) {
-  return CallWithContext(sockfd,
-                         [addr, addrlen](std::shared_ptr<IOContext> context) {
-                           return context->GetPeerName(addr, addrlen);
-                         });
+  return CallWithContext(sockfd, [addr, addrlen](IOContext *context) {
+    return context->GetPeerName(addr, addrlen);
+  });
 }
 
 ssize_t IOManager::RecvFrom(int sockfd, void *buf, size_t len, int flags,
                             struct sockaddr *src_addr, socklen_t *addrlen) {
   return CallWithContext(sockfd, [buf, len, flags, src_addr,
-                                  addrlen](std::shared_ptr<IOContext> context) {
+                                  addrlen](IOContext *context) {
     return context->RecvFrom(buf, len, flags, src_addr, addrlen);
   });
 }
@@ -25,6 +25,7 @@
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <array>
 #include <atomic>
 #include <cerrno>
 #include <cstdint>
@@ -34,11 +35,13 @@
 #include <memory>
 #include <queue>
 #include <type_traits>
+#include <vector>
 
 #include "absl/base/thread_annotations.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
+#include "asylo/platform/posix/io/page_cache.h"
 #include "asylo/platform/storage/secure/enclave_storage_secure.h"
 #include "asylo/util/statusor.h"
 
@@ -50,8 +53,12 @@ namespace io {
 class IOManager {
  public:
   // The maximum number of virtual file descriptors which may be open at any one
-  // time.
-  static const constexpr int kMaxOpenFiles = 1024;
+  // time. This is the default hard limit for RLIMIT_NOFILE.
+  static const constexpr int kMaxOpenFiles = 65536;
+
+  // The default soft limit for RLIMIT_NOFILE, which setrlimit() may raise up to
+  // the hard limit.
+  static const constexpr int kDefaultMaxOpenFiles = 1024;
 
   // An IOContext object represents an abstract I/O stream. Different concrete
   // implementations might wrap a native file descriptor on the host, a virtual
@@ -59,6 +66,10 @@ class IOManager {
   // transparent inline encryption.
   class IOContext {
    public:
+    // Reports the readiness of a stream implemented inside the enclave, as
+    // PollReadiness does, or -1 once the stream has been closed.
+    using ReadinessCallback = std::function<int(uint64_t *generation)>;
+
     virtual ~IOContext() = default;
 
    protected:
@@ -127,6 +138,34 @@ class IOManager {
       return -1;
     }
 
+    // Implements IOManager::PRead. Unlike Read, must not use or move the
+    // cursor, so that threads sharing the descriptor need not coordinate. The
+    // positional calls fail with ESPIPE by default, as they do on Linux for
+    // pipes, sockets and other streams that cannot seek.
+    virtual ssize_t PRead(void *buf, size_t count, off_t offset) {
+      errno = ESPIPE;
+      return -1;
+    }
+
+    // Implements IOManager::PWrite.
+    virtual ssize_t PWrite(const void *buf, size_t count, off_t offset) {
+      errno = ESPIPE;
+      return -1;
+    }
+
+    // Implements IOManager::PReadv.
+    virtual ssize_t PReadv(const struct iovec *iov, int iovcnt, off_t offset) {
+      errno = ESPIPE;
+      return -1;
+    }
+
+    // Implements IOManager::PWritev.
+    virtual ssize_t PWritev(const struct iovec *iov, int iovcnt,
+                            off_t offset) {
+      errno = ESPIPE;
+      return -1;
+    }
+
     virtual int FTruncate(off_t length) {
       errno = ENOSYS;
       return -1;
@@ -240,8 +279,24 @@ class IOManager {
       return -1;
     }
 
+    // Implements epoll_ctl for a stream implemented inside the enclave, which
+    // the host cannot watch. |readiness| reports the current events of the
+    // stream |fd| as PollReadiness does.
+    virtual int EpollCtlEnclave(int op, int fd, ReadinessCallback readiness,
+                                struct epoll_event *event) {
+      // EINVAL since file descriptors do not by default support epoll behavior.
+      errno = EINVAL;
+      return -1;
+    }
+
     virtual int GetHostFileDescriptor() { return -1; }
 
+    // Returns the poll(2) events ready on a stream implemented inside the
+    // enclave, and stores in |generation| a counter that changes whenever the
+    // readiness of the stream may have changed. Returns -1 for streams backed
+    // by a host file descriptor, which are polled by the host instead.
+    virtual int PollReadiness(uint64_t *generation) { return -1; }
+
    private:
     friend class IOManager;
   };
@@ -321,23 +376,68 @@ class IOManager {
   };
 
   // A table of virtual file descriptors managed by the IOManager.
-  // This class is not thread safe. IOManager is responsible for locking the
-  // access to objects of this class.
+  //
+  // Lookups with Get() and Borrow() are lock free and may run concurrently
+  // with each other and with any change to the table. Changes are not thread
+  // safe; IOManager is responsible for serializing them with |fd_table_lock_|.
+  //
+  // The table grows in chunks of kFileDescriptorsPerChunk descriptors as they
+  // are first used, and finds the lowest free descriptor with a two-level
+  // bitmap. A closed descriptor's I/O context is freed only once no thread is
+  // still using a reference to it obtained from Borrow().
   class FileDescriptorTable {
    public:
+    // A reference to the I/O context of a file descriptor. The context stays
+    // alive while the reference exists, even if the descriptor is closed,
+    // without copying a shared_ptr or taking a lock. A reference must be
+    // destroyed on the thread that created it, and is meant to last only for
+    // the duration of one call on the context.
+    class ContextReference {
+     public:
+      ContextReference() = default;
+      ContextReference(ContextReference &&other);
+      ContextReference(const ContextReference &other) = delete;
+      ContextReference &operator=(const ContextReference &other) = delete;
+      ~ContextReference();
+
+      IOContext *get() const { return context_; }
+      explicit operator bool() const { return context_ != nullptr; }
+
+     private:
+      friend class FileDescriptorTable;
+
+      IOContext *context_ = nullptr;
+
+      // The hazard pointer that keeps |context_| alive, if any.
+      std::atomic<const void *> *hazard_ = nullptr;
+
+      // Keeps |context_| alive when the thread had no hazard pointer to spare.
+      std::shared_ptr<IOContext> owner_;
+    };
+
     FileDescriptorTable();
+    ~FileDescriptorTable();
 
     // Returns the IOContext associated with a file descriptor, or nullptr if
     // no such context exists.
     std::shared_ptr<IOContext> Get(int fd);
 
-    // Removes an entry from the table, destroying the associated IOContext if
-    // this is the last reference to the IOContext, and returns the file
+    // Returns a reference to the IOContext associated with a file descriptor,
+    // which is empty if no such context exists. Cheaper than Get().
+    ContextReference Borrow(int fd);
+
+    // Removes an entry from the table, closing the associated IOContext if
+    // this is the last descriptor referring to it, and returns the file
     // descriptor to the free list. If close() is called on the host and that
-    // call fails, returns -1; otherwise, returns 0.
+    // call fails, returns -1; otherwise, returns 0. Returns -1 and sets errno
+    // to EBADF if |fd| is not in use.
     int Delete(int fd);
 
-    // Returns true if a specified file descriptor is available.
+    // Returns whether |fd| is in expected range.
+    bool IsFileDescriptorValid(int fd);
+
+    // Returns true if a specified file descriptor is available. Returns false
+    // for file descriptors that are not valid.
     bool IsFileDescriptorUnused(int fd);
 
     // Inserts an I/O context into the table, assigning it the next available
@@ -368,48 +468,38 @@ class IOManager {
     int get_maximum_fd_hard_limit();
 
    private:
-    // A wrapper around IOContext that ensures that the IOContext is destroyed
-    // when there are no longer any references to it.
-    //
-    // A shared_ptr<AutoCloseIOContext> represents a file descriptor referring
-    // to a backing IOContext, whereas a shared_ptr<IOContext> keeps the
-    // IOContext alive, even if there are no file descriptors referencing it.
-    class AutoCloseIOContext {
-     public:
-      explicit AutoCloseIOContext(IOContext *context)
-          : close_result_(nullptr), context_(context) {}
-
-      ~AutoCloseIOContext() {
-        if (context_->Close() == -1) {
-          int *close_result = close_result_.load();
-          if (close_result) {
-            *close_result = -1;
-          }
-        }
-      }
-
-      std::shared_ptr<IOContext> Get() { return context_; }
-
-      // Indicates that if the Close() call in the destructor fails, then -1
-      // should be written to |close_result|. If called multiple times, only the
-      // most recent |close_result| pointer is used.
-      void WriteCloseResultTo(int *close_result) {
-        close_result_.store(close_result);
-      }
-
-     private:
-      // Where to write the result of the Close() call in the destructor if it
-      // fails. May be nullptr, in which case any Close() failures are silent.
-      std::atomic<int *> close_result_;
-
-      // The IOContext to wrap. A shared_ptr is used to ensure that calls using
-      // the context object don't end up with dangling pointers if the wrapping
-      // AutoCloseIOContext gets destroyed.
-      std::shared_ptr<IOContext> context_;
+    static constexpr int kFileDescriptorsPerChunk = 1024;
+    static constexpr int kBitsPerWord = 64;
+    static constexpr int kWords = kMaxOpenFiles / kBitsPerWord;
+
+    // An open file description: an I/O context together with the number of
+    // file descriptors that refer to it. The context is closed when the last
+    // of those descriptors is deleted.
+    struct OpenFile {
+      explicit OpenFile(IOContext *context)
+          : context(context), descriptor_count(1) {}
+
+      // A shared_ptr is kept so that callers of Get() can hold on to the
+      // context after it is closed.
+      const std::shared_ptr<IOContext> context;
+      int descriptor_count;
     };
 
-    // Returns whether |fd| is in expected range.
-    bool IsFileDescriptorValid(int fd);
+    using Chunk = std::array<std::atomic<OpenFile *>, kFileDescriptorsPerChunk>;
+
+    // Returns the slot of |fd| in the table, or nullptr if the chunk holding
+    // it has not been allocated yet.
+    std::atomic<OpenFile *> *FindSlot(int fd);
+
+    // Returns the slot of |fd| in the table, allocating its chunk if needed.
+    std::atomic<OpenFile *> &GetOrCreateSlot(int fd);
+
+    // Stores |file| in the unused descriptor |fd|.
+    void Assign(int fd, OpenFile *file);
+
+    // Frees |file| once no thread holds a reference to its context, along with
+    // any previously retired file that is no longer referenced.
+    void Retire(OpenFile *file);
 
     // Returns current highest file descriptor number. Returns -1 if no file
     // descriptors are used.
@@ -419,7 +509,19 @@ class IOManager {
     // |startfd|. Returns -1 if there is no file descriptor available.
     int GetNextFreeFileDescriptor(int startfd);
 
-    std::array<std::shared_ptr<AutoCloseIOContext>, kMaxOpenFiles> fd_table_;
+    // The chunks of the table, allocated on first use and never freed before
+    // the table is destroyed, so that lookups need no lock.
+    std::array<std::atomic<Chunk *>, kMaxOpenFiles / kFileDescriptorsPerChunk>
+        chunks_;
+
+    // A bit for each file descriptor, set when the descriptor is used.
+    std::array<uint64_t, kWords> used_;
+
+    // A bit for each word of |used_|, set when all bits of that word are set.
+    std::array<uint64_t, kWords / kBitsPerWord> full_words_;
+
+    // Open files that are no longer in the table but may still be referenced.
+    std::vector<OpenFile *> retired_;
 
     // The maximum file descriptor number allowed.
     int maximum_fd_soft_limit;
@@ -484,8 +586,9 @@ class IOManager {
   // combination of O_CLOEXEC, O_DIRECT, and O_NONBLOCK. The array |pipefd| is
   // used to return two file descriptors referring to the ends of the pipe.
   // |pipefd[0]| refers to the read end while |pipefd[1]| refers to the write
-  // end.
-  int Pipe(int pipefd[2], int flags);
+  // end. The pipe is implemented inside the enclave, unless fork is enabled,
+  // in which case it is a host pipe so that it can be shared with a child.
+  int Pipe(int pipefd[2], int flags) LOCKS_EXCLUDED(fd_table_lock_);
 
   // Reads up to |count| bytes from the stream into |buf|, returning the number
   // of bytes read on success or -1 on error.
@@ -561,6 +664,18 @@ class IOManager {
   // Implements readv(2).
   ssize_t Readv(int fd, const struct iovec *iov, int iovcnt);
 
+  // Implements pread(2).
+  ssize_t PRead(int fd, void *buf, size_t count, off_t offset);
+
+  // Implements pwrite(2).
+  ssize_t PWrite(int fd, const void *buf, size_t count, off_t offset);
+
+  // Implements preadv(2).
+  ssize_t PReadv(int fd, const struct iovec *iov, int iovcnt, off_t offset);
+
+  // Implements pwritev(2).
+  ssize_t PWritev(int fd, const struct iovec *iov, int iovcnt, off_t offset);
+
   // Implements umask(2).
   mode_t Umask(mode_t mask);
 
@@ -616,6 +731,11 @@ class IOManager {
   // Implements socket(2).
   int Socket(int domain, int type, int protocol);
 
+  // Implements socketpair(2) for AF_UNIX stream sockets, which are implemented
+  // inside the enclave.
+  int SocketPair(int domain, int type, int protocol, int sv[2])
+      LOCKS_EXCLUDED(fd_table_lock_);
+
   // Implements eventfd(2).
   int EventFd(unsigned int initval, int flags) LOCKS_EXCLUDED(fd_table_lock_);
 
@@ -652,6 +772,11 @@ class IOManager {
   Status SetCurrentWorkingDirectory(absl::string_view path);
   std::string GetCurrentWorkingDirectory() const;
 
+  // Returns the cache of pages of host files, which serves reads of files
+  // opened read-only and without O_DIRECT under its registered prefixes. The
+  // cache is disabled until it is given a capacity.
+  PageCache *page_cache() { return &page_cache_; }
+
  private:
   IOManager() {}
   IOManager(IOManager const &) = delete;
@@ -668,13 +793,32 @@ class IOManager {
   // for obtaining |fd_table_lock_|.
   int CloseFileDescriptor(int fd) EXCLUSIVE_LOCKS_REQUIRED(fd_table_lock_);
 
+  // Inserts two I/O contexts into the file descriptor table, taking ownership
+  // of both, and returns their file descriptors in |fds|. Returns 0 on
+  // success. If both contexts cannot be inserted, neither is, and -1 is
+  // returned.
+  int InsertPair(std::unique_ptr<IOContext> first,
+                 std::unique_ptr<IOContext> second, int fds[2])
+      LOCKS_EXCLUDED(fd_table_lock_);
+
+  // Implements Poll when some of |fds| refer to streams implemented inside the
+  // enclave. |enclave_streams| holds the context of each such stream at the
+  // index of its entry in |fds|, and null elsewhere. The fd field of every
+  // entry in |fds| must already be translated to a host file descriptor, or
+  // -1 for entries that the host should ignore.
+  int PollWithEnclaveStreams(
+      struct pollfd *fds, nfds_t nfds, int timeout,
+      const std::vector<std::shared_ptr<IOContext>> &enclave_streams);
+
   // Fetches the VirtualFileHandler associated with a given path, or
   // nullptr if no entry is found.
   VirtualPathHandler *HandlerForPath(absl::string_view path) const;
 
-  // Locks the mutex corresponding to |fd| and performs thread safe action.
+  // Calls |action| with the I/O context of |fd|, which stays alive for the
+  // duration of the call even if |fd| is closed concurrently. Sets errno to
+  // EBADF if |fd| is not open.
   template <typename IOAction, typename ReturnType = typename std::result_of<
-                                   IOAction(std::shared_ptr<IOContext>)>::type>
+                                   IOAction(IOContext *)>::type>
   ReturnType CallWithContext(int fd, IOAction action)
       LOCKS_EXCLUDED(fd_table_lock_);
 
@@ -701,10 +845,12 @@ class IOManager {
 
   FileDescriptorTable fd_table_;
 
-  // A mutex that locks the fd_table_.
+  // A mutex that serializes changes to the fd_table_. Lookups do not take it.
   absl::Mutex fd_table_lock_;
 
   std::string current_working_directory_;
+
+  PageCache page_cache_;
 };
 
 }  // namespace io
@@ -19,16 +19,36 @@
 #include "asylo/platform/posix/io/native_paths.h"
 
 #include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 #include <cerrno>
 #include <cstring>
 
 #include "asylo/platform/arch/include/trusted/host_calls.h"
 #include "asylo/platform/core/bridge_msghdr_wrapper.h"
-#include "asylo/platform/core/untrusted_cache_malloc.h"
 #include "asylo/platform/posix/io/secure_paths.h"
 
 namespace asylo {
 namespace io {
+namespace {
+
+// Copies the result of a vectored read that the host reported as |ret| from
+// |staged| back to |iov|, and returns |ret|. Fails with EIO if the host
+// reported reading more bytes than the staged buffers hold.
+ssize_t ReceiveIovecs(const asylo::BridgeMsghdrWrapper &staged, ssize_t ret,
+                      const struct iovec *iov) {
+  if (ret <= 0) {
+    return ret;
+  }
+  if (static_cast<size_t>(ret) > staged.data_size()) {
+    errno = EIO;
+    return -1;
+  }
+  staged.CopyReceivedBuffers(ret, iov);
+  return ret;
+}
+
+}  // namespace
 
 int IOContextNative::Close() { return enc_untrusted_close(host_fd_); }
 
@@ -64,67 +84,67 @@ int IOContextNative::FLock(int operation) {
   return enc_untrusted_flock(host_fd_, operation);
 }
 
-bool IOContextNative::CreateUntrustedBuffer(const struct iovec *iov, int iovcnt,
-                                            char **buf, int *size) {
-  size_t total_size = 0;
-  for (int i = 0; i < iovcnt; ++i) {
-    total_size += iov[i].iov_len;
+ssize_t IOContextNative::Writev(const struct iovec *iov, int iovcnt) {
+  if (iovcnt <= 0) {
+    errno = EINVAL;
+    return -1;
   }
-
-  // Instance of the global memory pool singleton.
-  asylo::UntrustedCacheMalloc *untrusted_cache_malloc =
-      asylo::UntrustedCacheMalloc::Instance();
-  char *tmp = reinterpret_cast<char *>(
-      untrusted_cache_malloc->Malloc(total_size * sizeof(char)));
-  if (!tmp) {
-    return false;
+  asylo::BridgeMsghdrWrapper staged(iov, iovcnt);
+  if (!staged.CopyAllBuffers()) {
+    return -1;
   }
-  *size = total_size;
-  *buf = tmp;
-  return true;
+  return enc_untrusted_writev(host_fd_, staged.get_msg()->msg_iov, iovcnt);
 }
 
-bool IOContextNative::SerializeIov(const struct iovec *iov, int iovcnt,
-                                   char **buf, int *size) {
-  char *tmp;
-  if (!CreateUntrustedBuffer(iov, iovcnt, &tmp, size)) {
-    return false;
+ssize_t IOContextNative::Readv(const struct iovec *iov, int iovcnt) {
+  if (iovcnt <= 0) {
+    errno = EINVAL;
+    return -1;
   }
-  size_t copied_bytes = 0;
-  for (int i = 0; i < iovcnt; ++i) {
-    size_t len =  iov[i].iov_len;
-    memcpy(tmp + copied_bytes, iov[i].iov_base, len);
-    copied_bytes += len;
+  asylo::BridgeMsghdrWrapper staged(iov, iovcnt);
+  if (!staged.get_msg()) {
+    return -1;
   }
-  *buf = tmp;
-  return true;
+  ssize_t ret =
+      enc_untrusted_readv(host_fd_, staged.get_msg()->msg_iov, iovcnt);
+  return ReceiveIovecs(staged, ret, iov);
 }
 
-ssize_t IOContextNative::Writev(const struct iovec *iov, int iovcnt) {
+ssize_t IOContextNative::PRead(void *buf, size_t count, off_t offset) {
+  return enc_untrusted_pread64(host_fd_, buf, count, offset);
+}
+
+ssize_t IOContextNative::PWrite(const void *buf, size_t count, off_t offset) {
+  return enc_untrusted_pwrite64(host_fd_, buf, count, offset);
+}
+
+ssize_t IOContextNative::PReadv(const struct iovec *iov, int iovcnt,
+                                off_t offset) {
   if (iovcnt <= 0) {
     errno = EINVAL;
     return -1;
   }
-
-  char *buf;
-  int size;
-  if (!SerializeIov(iov, iovcnt, &buf, &size)) {
+  asylo::BridgeMsghdrWrapper staged(iov, iovcnt);
+  if (!staged.get_msg()) {
     return -1;
   }
-  return enc_untrusted_writev(host_fd_, buf, size);
+  ssize_t ret = enc_untrusted_preadv(host_fd_, staged.get_msg()->msg_iov,
+                                     iovcnt, offset);
+  return ReceiveIovecs(staged, ret, iov);
 }
 
-ssize_t IOContextNative::Readv(const struct iovec *iov, int iovcnt) {
+ssize_t IOContextNative::PWritev(const struct iovec *iov, int iovcnt,
+                                 off_t offset) {
   if (iovcnt <= 0) {
     errno = EINVAL;
     return -1;
   }
-  char *buf;
-  int size;
-  if (!CreateUntrustedBuffer(iov, iovcnt, &buf, &size)) {
+  asylo::BridgeMsghdrWrapper staged(iov, iovcnt);
+  if (!staged.CopyAllBuffers()) {
     return -1;
   }
-  return enc_untrusted_readv(host_fd_, iov, iovcnt, buf, size);
+  return enc_untrusted_pwritev(host_fd_, staged.get_msg()->msg_iov, iovcnt,
+                               offset);
 }
 
 int IOContextNative::SetSockOpt(int level, int option_name,
@@ -164,24 +184,30 @@ int IOContextNative::Listen(int backlog) {
 }
 
 ssize_t IOContextNative::SendMsg(const struct msghdr *msg, int flags) {
-  asylo::BridgeMsghdrWrapper tmp_wrapper(msg);
-  if (!tmp_wrapper.CopyAllBuffers()) {
-    // CopyAllBuffers sets the ocall status on failure.
-    errno = EFAULT;
+  asylo::BridgeMsghdrWrapper staged(msg);
+  if (!staged.CopyAllBuffers()) {
     return -1;
   }
-
-  return enc_untrusted_sendmsg(host_fd_, tmp_wrapper.get_msg(), flags);
+  return enc_untrusted_sendmsg(host_fd_, staged.get_msg(), flags);
 }
 
 ssize_t IOContextNative::RecvMsg(struct msghdr *msg, int flags) {
-  asylo::BridgeMsghdrWrapper tmp_wrapper(msg);
-  if (!tmp_wrapper.CopyAllBuffers()) {
-    // CopyAllBuffers sets the ocall status on failure.
-    errno = EFAULT;
+  asylo::BridgeMsghdrWrapper staged(msg);
+  if (!staged.get_msg()) {
+    return -1;
+  }
+  ssize_t ret = enc_untrusted_recvmsg(host_fd_, staged.get_msg(), flags);
+  if (ret < 0) {
+    return ret;
+  }
+  // With MSG_TRUNC, a datagram socket reports the full length of a datagram
+  // even if it did not fit.
+  if (static_cast<size_t>(ret) > staged.data_size() && !(flags & MSG_TRUNC)) {
+    errno = EIO;
     return -1;
   }
-  return enc_untrusted_recvmsg(host_fd_, msg, tmp_wrapper.get_msg(), flags);
+  staged.CopyReceivedBuffers(ret, msg);
+  return ret;
 }
 
 int IOContextNative::GetSockName(struct sockaddr *addr, socklen_t *addrlen) {
@@ -200,6 +226,129 @@ ssize_t IOContextNative::RecvFrom(void *buf, size_t len, int flags,
 
 int IOContextNative::GetHostFileDescriptor() { return host_fd_; }
 
+std::unique_ptr<IOManager::IOContext> IOContextCachedNative::Create(
+    int host_fd, PageCache *cache) {
+  struct stat stat_buffer;
+  if (enc_untrusted_fstat(host_fd, &stat_buffer) != 0 ||
+      !S_ISREG(stat_buffer.st_mode)) {
+    return ::absl::make_unique<IOContextNative>(host_fd);
+  }
+  PageCache::FileVersion version =
+      PageCache::FileVersion::FromStat(stat_buffer);
+  cache->Validate(version);
+  return std::unique_ptr<IOManager::IOContext>(
+      new IOContextCachedNative(host_fd, cache, version));
+}
+
+ssize_t IOContextCachedNative::Read(void *buf, size_t count) {
+  absl::MutexLock lock(&mu_);
+  ssize_t bytes_read =
+      cache_->Read(version_, buf, count, position_, HostReader());
+  if (bytes_read > 0) {
+    position_ += bytes_read;
+  }
+  return bytes_read;
+}
+
+ssize_t IOContextCachedNative::Readv(const struct iovec *iov, int iovcnt) {
+  absl::MutexLock lock(&mu_);
+  ssize_t bytes_read = ReadvAt(version_, iov, iovcnt, position_);
+  if (bytes_read > 0) {
+    position_ += bytes_read;
+  }
+  return bytes_read;
+}
+
+ssize_t IOContextCachedNative::PRead(void *buf, size_t count, off_t offset) {
+  PageCache::FileVersion version;
+  {
+    absl::MutexLock lock(&mu_);
+    version = version_;
+  }
+  return cache_->Read(version, buf, count, offset, HostReader());
+}
+
+ssize_t IOContextCachedNative::PReadv(const struct iovec *iov, int iovcnt,
+                                      off_t offset) {
+  PageCache::FileVersion version;
+  {
+    absl::MutexLock lock(&mu_);
+    version = version_;
+  }
+  return ReadvAt(version, iov, iovcnt, offset);
+}
+
+int IOContextCachedNative::LSeek(off_t offset, int whence) {
+  absl::MutexLock lock(&mu_);
+  off_t new_position;
+  switch (whence) {
+    case SEEK_SET:
+      new_position = offset;
+      break;
+    case SEEK_CUR:
+      new_position = position_ + offset;
+      break;
+    case SEEK_END:
+      new_position = version_.size + offset;
+      break;
+    default:
+      errno = EINVAL;
+      return -1;
+  }
+  if (new_position < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  position_ = new_position;
+  return position_;
+}
+
+int IOContextCachedNative::FStat(struct stat *stat_buffer) {
+  int ret = IOContextNative::FStat(stat_buffer);
+  if (ret == 0) {
+    PageCache::FileVersion version =
+        PageCache::FileVersion::FromStat(*stat_buffer);
+    cache_->Validate(version);
+    absl::MutexLock lock(&mu_);
+    version_ = version;
+  }
+  return ret;
+}
+
+PageCache::PageReader IOContextCachedNative::HostReader() {
+  int host_fd = host_fd_;
+  return [host_fd](void *buf, size_t count, off_t offset) -> ssize_t {
+    int64_t bytes_read = enc_untrusted_pread64(host_fd, buf, count, offset);
+    if (bytes_read > 0 && static_cast<uint64_t>(bytes_read) > count) {
+      errno = EIO;
+      return -1;
+    }
+    return bytes_read;
+  };
+}
+
+ssize_t IOContextCachedNative::ReadvAt(const PageCache::FileVersion &version,
+                                       const struct iovec *iov, int iovcnt,
+                                       off_t offset) {
+  if (iovcnt <= 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  ssize_t total = 0;
+  for (int i = 0; i < iovcnt; ++i) {
+    ssize_t bytes_read = cache_->Read(version, iov[i].iov_base, iov[i].iov_len,
+                                      offset + total, HostReader());
+    if (bytes_read == -1) {
+      return total > 0 ? total : -1;
+    }
+    total += bytes_read;
+    if (static_cast<size_t>(bytes_read) < iov[i].iov_len) {
+      break;
+    }
+  }
+  return total;
+}
+
 std::unique_ptr<IOManager::IOContext> NativePathHandler::Open(const char *path,
                                                               int flags,
                                                               mode_t mode) {
@@ -212,6 +361,11 @@ std::unique_ptr<IOManager::IOContext> NativePathHandler::Open(const char *path,
     return nullptr;
   }
 
+  PageCache *cache = IOManager::GetInstance().page_cache();
+  if ((flags & O_ACCMODE) == O_RDONLY && !(flags & O_DIRECT) &&
+      cache->IsCached(path)) {
+    return IOContextCachedNative::Create(host_fd, cache);
+  }
   return ::absl::make_unique<IOContextNative>(host_fd);
 }
 
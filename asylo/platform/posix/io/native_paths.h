@@ -19,7 +19,10 @@
 #ifndef ASYLO_PLATFORM_POSIX_IO_NATIVE_PATHS_H_
 #define ASYLO_PLATFORM_POSIX_IO_NATIVE_PATHS_H_
 
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
 #include "asylo/platform/posix/io/io_manager.h"
+#include "asylo/platform/posix/io/page_cache.h"
 
 namespace asylo {
 namespace io {
@@ -42,6 +45,10 @@ class IOContextNative : public IOManager::IOContext {
   int FTruncate(off_t length) override;
   ssize_t Writev(const struct iovec *iov, int iovcnt) override;
   ssize_t Readv(const struct iovec *iov, int iovcnt) override;
+  ssize_t PRead(void *buf, size_t count, off_t offset) override;
+  ssize_t PWrite(const void *buf, size_t count, off_t offset) override;
+  ssize_t PReadv(const struct iovec *iov, int iovcnt, off_t offset) override;
+  ssize_t PWritev(const struct iovec *iov, int iovcnt, off_t offset) override;
   int SetSockOpt(int level, int option_name, const void *option_value,
                  socklen_t option_len) override;
   int Connect(const struct sockaddr *addr, socklen_t addrlen) override;
@@ -60,13 +67,55 @@ class IOContextNative : public IOManager::IOContext {
                    socklen_t *addrlen) override;
   int GetHostFileDescriptor() override;
 
- private:
+ protected:
   // Host file descriptor implementing this stream.
   int host_fd_;
-  bool CreateUntrustedBuffer(const struct iovec *iov,
-      int iovcnt, char **buf, int *size);
-  bool SerializeIov(const struct iovec *iov, int iovcnt,
-      char **buf, int *size);
+};
+
+// IOContext implementation for a regular host file opened read-only under a
+// prefix registered with a PageCache. Reads are served by the cache, which
+// fetches missing pages with pread, so the cursor is kept in the enclave. The
+// version of the file checked by the cache is refreshed whenever the file is
+// fstat'ed, and pages of an older version are dropped then.
+class IOContextCachedNative : public IOContextNative {
+ public:
+  // Returns a context reading |host_fd| through |cache|, or a plain
+  // IOContextNative if |host_fd| is not a regular file.
+  static std::unique_ptr<IOManager::IOContext> Create(int host_fd,
+                                                      PageCache *cache);
+
+  ssize_t Read(void *buf, size_t count) override;
+  ssize_t Readv(const struct iovec *iov, int iovcnt) override;
+  ssize_t PRead(void *buf, size_t count, off_t offset) override;
+  ssize_t PReadv(const struct iovec *iov, int iovcnt, off_t offset) override;
+  int LSeek(off_t offset, int whence) override;
+  int FStat(struct stat *stat_buffer) override;
+
+ private:
+  IOContextCachedNative(int host_fd, PageCache *cache,
+                        const PageCache::FileVersion &version)
+      : IOContextNative(host_fd),
+        cache_(cache),
+        version_(version),
+        position_(0) {}
+
+  // Returns a reader fetching pages of the file from the host.
+  PageCache::PageReader HostReader();
+
+  // Reads into the buffers of |iov| from |offset| of the file at |version|,
+  // stopping at the first short read.
+  ssize_t ReadvAt(const PageCache::FileVersion &version,
+                  const struct iovec *iov, int iovcnt, off_t offset);
+
+  PageCache *cache_;
+
+  absl::Mutex mu_;
+
+  // The version of the file as of the last fstat.
+  PageCache::FileVersion version_ GUARDED_BY(mu_);
+
+  // The logical offset of the cursor.
+  off_t position_ GUARDED_BY(mu_);
 };
 
 // VirtualPathHandler implementation handling paths to be forwarded to the host.
@@ -0,0 +1,304 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/posix/io/page_cache.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "absl/strings/match.h"
+
+namespace asylo {
+namespace io {
+namespace {
+
+// Calls |reader| and fails with EIO if it reports reading more than |count|
+// bytes, which only an untrusted reader that misbehaves can do.
+ssize_t CheckedRead(const PageCache::PageReader &reader, void *buf,
+                    size_t count, off_t offset) {
+  ssize_t bytes_read = reader(buf, count, offset);
+  if (bytes_read > 0 && static_cast<size_t>(bytes_read) > count) {
+    errno = EIO;
+    return -1;
+  }
+  return bytes_read;
+}
+
+}  // namespace
+
+constexpr size_t PageCache::kPageSize;
+constexpr size_t PageCache::kMaxFetchPages;
+constexpr size_t PageCache::kMaxIdleFiles;
+
+PageCache::FileVersion PageCache::FileVersion::FromStat(
+    const struct stat &stat_buffer) {
+  return {stat_buffer.st_dev, stat_buffer.st_ino, stat_buffer.st_size,
+          stat_buffer.st_mtime};
+}
+
+bool PageCache::FileVersion::operator==(const FileVersion &other) const {
+  return device == other.device && inode == other.inode &&
+         size == other.size && mtime == other.mtime;
+}
+
+PageCache::PageCache() : capacity_(0), size_(0) {}
+
+void PageCache::SetCapacity(size_t capacity) {
+  absl::MutexLock lock(&mu_);
+  capacity_ = capacity;
+  EvictTo(capacity_);
+  if (capacity_ == 0) {
+    files_.clear();
+  }
+}
+
+bool PageCache::RegisterPrefix(const std::string &path_prefix) {
+  if (!path_prefix.empty() &&
+      (path_prefix.front() != '/' || path_prefix.back() == '/')) {
+    return false;
+  }
+  absl::MutexLock lock(&mu_);
+  prefixes_.insert(path_prefix);
+  return true;
+}
+
+void PageCache::DeregisterPrefix(const std::string &path_prefix) {
+  absl::MutexLock lock(&mu_);
+  prefixes_.erase(path_prefix);
+}
+
+bool PageCache::IsCached(absl::string_view path) const {
+  absl::MutexLock lock(&mu_);
+  if (capacity_ == 0) {
+    return false;
+  }
+  for (const std::string &prefix : prefixes_) {
+    if (absl::StartsWith(path, prefix) &&
+        (path.size() == prefix.size() || path[prefix.size()] == '/')) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void PageCache::Validate(const FileVersion &version) {
+  absl::MutexLock lock(&mu_);
+  if (capacity_ == 0) {
+    return;
+  }
+  FileId id(version.device, version.inode);
+  auto iter = files_.find(id);
+  if (iter == files_.end()) {
+    files_.emplace(id, File{version, {}});
+    EvictIdleFiles(id);
+    return;
+  }
+  if (iter->second.version != version) {
+    DropPages(id, &iter->second);
+    iter->second.version = version;
+  }
+}
+
+ssize_t PageCache::Read(const FileVersion &version, void *buf, size_t count,
+                        off_t offset, const PageReader &reader) {
+  {
+    absl::MutexLock lock(&mu_);
+    if (!IsCurrent(version)) {
+      return CheckedRead(reader, buf, count, offset);
+    }
+  }
+  if (count == 0 || offset >= version.size) {
+    return 0;
+  }
+
+  uint8_t *output = static_cast<uint8_t *>(buf);
+  off_t end = offset + std::min<off_t>(count, version.size - offset);
+  off_t position = offset;
+  int64_t index = offset / kPageSize;
+  int64_t last = (end - 1) / kPageSize;
+  while (index <= last) {
+    // Copy the cached pages at the start of the remaining range, then find the
+    // run of missing pages that follows them.
+    int64_t run_end;
+    bool stale;
+    {
+      absl::MutexLock lock(&mu_);
+      stale = !IsCurrent(version);
+      while (!stale && index <= last) {
+        off_t page_offset = index * kPageSize;
+        size_t page_end = std::min<off_t>(end - page_offset, kPageSize);
+        if (!CopyFromPage(version, index, position - page_offset, page_end,
+                          output + (position - offset))) {
+          break;
+        }
+        position = page_offset + page_end;
+        ++index;
+      }
+      run_end = index + 1;
+      while (run_end <= last &&
+             static_cast<size_t>(run_end - index) < kMaxFetchPages &&
+             !page_index_.contains(
+                 PageKey(version.device, version.inode, run_end))) {
+        ++run_end;
+      }
+    }
+    if (stale) {
+      // The file changed since the last pass, so its cached pages may belong
+      // to another version. Read the rest of the range from the host.
+      size_t done = position - offset;
+      ssize_t bytes_read = CheckedRead(reader, output + done, count - done,
+                                       position);
+      if (bytes_read == -1 && done == 0) {
+        return -1;
+      }
+      if (bytes_read > 0) {
+        position += bytes_read;
+      }
+      break;
+    }
+    if (index > last) {
+      break;
+    }
+
+    // Fetch the missing pages whole, so that they can be cached.
+    off_t fetch_offset = index * kPageSize;
+    size_t fetch_size =
+        std::min<off_t>(run_end * kPageSize, version.size) - fetch_offset;
+    std::vector<uint8_t> fetched(fetch_size);
+    size_t fetched_size = 0;
+    while (fetched_size < fetch_size) {
+      ssize_t bytes_read = CheckedRead(
+          reader, fetched.data() + fetched_size, fetch_size - fetched_size,
+          fetch_offset + fetched_size);
+      if (bytes_read == -1 && position == offset) {
+        return -1;
+      }
+      if (bytes_read <= 0) {
+        break;
+      }
+      fetched_size += bytes_read;
+    }
+
+    // Only full pages, and the last page of the file, are cached. A shorter
+    // page means that the file changed since |version| was recorded.
+    {
+      absl::MutexLock lock(&mu_);
+      if (IsCurrent(version)) {
+        for (size_t page_begin = 0; page_begin < fetched_size;
+             page_begin += kPageSize) {
+          size_t page_size = std::min(kPageSize, fetched_size - page_begin);
+          if (page_size == kPageSize ||
+              fetch_offset + static_cast<off_t>(page_begin + page_size) ==
+                  version.size) {
+            InsertPage(version, index + page_begin / kPageSize,
+                       fetched.data() + page_begin, page_size);
+          }
+        }
+      }
+    }
+
+    size_t skip = position - fetch_offset;
+    if (fetched_size <= skip) {
+      break;
+    }
+    size_t copied = std::min<off_t>(fetched_size - skip, end - position);
+    memcpy(output + (position - offset), fetched.data() + skip, copied);
+    position += copied;
+    if (fetched_size < fetch_size) {
+      break;
+    }
+    index = run_end;
+  }
+  return position - offset;
+}
+
+bool PageCache::IsCurrent(const FileVersion &version) const {
+  if (capacity_ == 0) {
+    return false;
+  }
+  auto iter = files_.find(FileId(version.device, version.inode));
+  return iter != files_.end() && iter->second.version == version;
+}
+
+bool PageCache::CopyFromPage(const FileVersion &version, int64_t index,
+                             size_t begin, size_t end, uint8_t *buf) {
+  auto iter =
+      page_index_.find(PageKey(version.device, version.inode, index));
+  if (iter == page_index_.end() || iter->second->data.size() < end) {
+    return false;
+  }
+  memcpy(buf, iter->second->data.data() + begin, end - begin);
+  pages_.splice(pages_.begin(), pages_, iter->second);
+  return true;
+}
+
+void PageCache::InsertPage(const FileVersion &version, int64_t index,
+                           const uint8_t *data, size_t size) {
+  PageKey key(version.device, version.inode, index);
+  if (size > capacity_ || page_index_.contains(key)) {
+    return;
+  }
+  EvictTo(capacity_ - size);
+  pages_.push_front(Page{key, std::vector<uint8_t>(data, data + size)});
+  page_index_.emplace(key, pages_.begin());
+  files_[FileId(version.device, version.inode)].pages.insert(index);
+  size_ += size;
+}
+
+void PageCache::EvictTo(size_t capacity) {
+  while (size_ > capacity && !pages_.empty()) {
+    const Page &page = pages_.back();
+    auto file = files_.find(
+        FileId(std::get<0>(page.key), std::get<1>(page.key)));
+    if (file != files_.end()) {
+      file->second.pages.erase(std::get<2>(page.key));
+    }
+    page_index_.erase(page.key);
+    size_ -= page.data.size();
+    pages_.pop_back();
+  }
+}
+
+void PageCache::EvictIdleFiles(const FileId &keep) {
+  if (files_.size() <= page_index_.size() + kMaxIdleFiles) {
+    return;
+  }
+  for (auto iter = files_.begin(); iter != files_.end();) {
+    auto current = iter++;
+    if (current->second.pages.empty() && current->first != keep) {
+      files_.erase(current);
+    }
+  }
+}
+
+void PageCache::DropPages(const FileId &id, File *file) {
+  for (int64_t index : file->pages) {
+    auto iter = page_index_.find(PageKey(id.first, id.second, index));
+    if (iter == page_index_.end()) {
+      continue;
+    }
+    size_ -= iter->second->data.size();
+    pages_.erase(iter->second);
+    page_index_.erase(iter);
+  }
+  file->pages.clear();
+}
+
+}  // namespace io
+}  // namespace asylo
@@ -0,0 +1,192 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_POSIX_IO_PAGE_CACHE_H_
+#define ASYLO_PLATFORM_POSIX_IO_PAGE_CACHE_H_
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <list>
+#include <set>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+
+namespace asylo {
+namespace io {
+
+// PageCache keeps pages of host files in enclave memory, so that repeated
+// reads of the same regions of large, rarely changing files do not exit the
+// enclave. Only files under registered path prefixes are cached, and only
+// while the capacity is non-zero, which it is not by default.
+//
+// Pages are tagged with the version of their file, made of its size and
+// modification time as reported by fstat. Recording a new version of a file
+// drops all of its pages, and reads made against any version other than the
+// last one recorded bypass the cache. When the total size of the cached pages
+// would exceed the capacity, the least recently used pages are evicted.
+// Files whose pages were all evicted are forgotten once too many of them have
+// been recorded, after which reads against them bypass the cache until their
+// version is recorded again.
+//
+// The data of the host file is not authenticated; the cache only saves the
+// exits needed to fetch it again.
+class PageCache {
+ public:
+  // The size of a cached page, in bytes.
+  static constexpr size_t kPageSize = 4096;
+
+  // The maximum number of pages fetched from the host by a single exit.
+  static constexpr size_t kMaxFetchPages = 256;
+
+  // The maximum number of recorded files without cached pages.
+  static constexpr size_t kMaxIdleFiles = 64;
+
+  // A version of a host file, as reported by fstat.
+  struct FileVersion {
+    dev_t device;
+    ino_t inode;
+    off_t size;
+    time_t mtime;
+
+    static FileVersion FromStat(const struct stat &stat_buffer);
+
+    bool operator==(const FileVersion &other) const;
+    bool operator!=(const FileVersion &other) const {
+      return !(*this == other);
+    }
+  };
+
+  // Reads up to |count| bytes of a host file at |offset| into |buf|, with the
+  // same return value as pread(2).
+  using PageReader =
+      std::function<ssize_t(void *buf, size_t count, off_t offset)>;
+
+  PageCache();
+
+  PageCache(const PageCache &other) = delete;
+  PageCache &operator=(const PageCache &other) = delete;
+
+  // Sets the maximum number of bytes of cached pages, evicting pages as needed.
+  // A capacity of zero disables the cache and drops every page.
+  void SetCapacity(size_t capacity) LOCKS_EXCLUDED(mu_);
+
+  // Caches files under |path_prefix|, which is matched on whole directory
+  // increments like the prefixes of IOManager::RegisterVirtualPathHandler, and
+  // must either be empty or start with a / and not end with one. Returns false
+  // if |path_prefix| is invalid.
+  bool RegisterPrefix(const std::string &path_prefix) LOCKS_EXCLUDED(mu_);
+
+  // Stops caching files newly opened under |path_prefix|.
+  void DeregisterPrefix(const std::string &path_prefix) LOCKS_EXCLUDED(mu_);
+
+  // Returns true if files opened at the canonical path |path| should be
+  // cached.
+  bool IsCached(absl::string_view path) const LOCKS_EXCLUDED(mu_);
+
+  // Records |version| as the current version of its file, dropping the cached
+  // pages of the file if they belong to another version.
+  void Validate(const FileVersion &version) LOCKS_EXCLUDED(mu_);
+
+  // Reads up to |count| bytes at |offset| of the file at |version| into |buf|,
+  // fetching missing pages with |reader|. Returns the number of bytes read,
+  // which is zero at the end of the file, or -1 if |reader| failed before any
+  // bytes were read.
+  ssize_t Read(const FileVersion &version, void *buf, size_t count,
+               off_t offset, const PageReader &reader) LOCKS_EXCLUDED(mu_);
+
+ private:
+  // Identifies a host file.
+  using FileId = std::pair<dev_t, ino_t>;
+
+  // Identifies a page of a host file by the index of the page in the file.
+  using PageKey = std::tuple<dev_t, ino_t, int64_t>;
+
+  struct Page {
+    PageKey key;
+    std::vector<uint8_t> data;
+  };
+
+  struct File {
+    FileVersion version;
+
+    // The indices of the cached pages of the file.
+    absl::flat_hash_set<int64_t> pages;
+  };
+
+  // Returns true if pages of |version| may be read from and added to the
+  // cache.
+  bool IsCurrent(const FileVersion &version) const
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Copies the bytes between |begin| and |end| of the page at |index| of the
+  // file at |version| to |buf|, and marks the page as recently used. Returns
+  // false if the page is not cached.
+  bool CopyFromPage(const FileVersion &version, int64_t index, size_t begin,
+                    size_t end, uint8_t *buf) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Adds the page at |index| of the file at |version|, holding |size| bytes
+  // from |data|, and evicts pages to make room for it.
+  void InsertPage(const FileVersion &version, int64_t index,
+                  const uint8_t *data, size_t size)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Evicts the least recently used pages until the cached pages fit in
+  // |capacity| bytes.
+  void EvictTo(size_t capacity) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Forgets the recorded files other than |keep| that have no cached pages, if
+  // there are more than kMaxIdleFiles of them.
+  void EvictIdleFiles(const FileId &keep) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Removes the cached pages of |file|.
+  void DropPages(const FileId &id, File *file) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  mutable absl::Mutex mu_;
+
+  size_t capacity_ GUARDED_BY(mu_);
+
+  // The total number of bytes of cached pages.
+  size_t size_ GUARDED_BY(mu_);
+
+  std::set<std::string> prefixes_ GUARDED_BY(mu_);
+
+  absl::flat_hash_map<FileId, File> files_ GUARDED_BY(mu_);
+
+  // The cached pages, from most to least recently used, and an index into
+  // them.
+  std::list<Page> pages_ GUARDED_BY(mu_);
+  absl::flat_hash_map<PageKey, std::list<Page>::iterator> page_index_
+      GUARDED_BY(mu_);
+};
+
+}  // namespace io
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_POSIX_IO_PAGE_CACHE_H_
@@ -0,0 +1,340 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/posix/io/page_cache.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace asylo {
+namespace io {
+namespace {
+
+constexpr size_t kPageSize = PageCache::kPageSize;
+
+// A file held in memory, which counts the calls made to read it.
+class FakeFile {
+ public:
+  explicit FakeFile(size_t size) : data_(size), reads_(0), fail_(false) {
+    for (size_t i = 0; i < size; ++i) {
+      data_[i] = static_cast<uint8_t>(i * 7 + i / kPageSize);
+    }
+  }
+
+  PageCache::FileVersion version(time_t mtime = 1) const {
+    return {1, 2, static_cast<off_t>(data_.size()), mtime};
+  }
+
+  PageCache::PageReader reader() {
+    return [this](void *buf, size_t count, off_t offset) -> ssize_t {
+      ++reads_;
+      if (fail_) {
+        errno = EIO;
+        return -1;
+      }
+      if (offset >= static_cast<off_t>(data_.size())) {
+        return 0;
+      }
+      size_t size = std::min(count, data_.size() - offset);
+      memcpy(buf, data_.data() + offset, size);
+      return size;
+    };
+  }
+
+  const uint8_t *data() const { return data_.data(); }
+  std::vector<uint8_t> *mutable_data() { return &data_; }
+  int reads() const { return reads_; }
+  void set_fail(bool fail) { fail_ = fail; }
+
+ private:
+  std::vector<uint8_t> data_;
+  int reads_;
+  bool fail_;
+};
+
+TEST(PageCacheTest, RepeatedReadsHitTheCache) {
+  FakeFile file(10 * kPageSize + 100);
+  PageCache cache;
+  cache.SetCapacity(64 * kPageSize);
+  cache.Validate(file.version());
+
+  std::vector<uint8_t> buf(3 * kPageSize);
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(cache.Read(file.version(), buf.data(), buf.size(), 1000,
+                         file.reader()),
+              buf.size());
+    EXPECT_EQ(memcmp(buf.data(), file.data() + 1000, buf.size()), 0);
+  }
+  EXPECT_EQ(file.reads(), 1);
+}
+
+TEST(PageCacheTest, ReadsStopAtTheEndOfTheFile) {
+  FakeFile file(2 * kPageSize + 100);
+  PageCache cache;
+  cache.SetCapacity(64 * kPageSize);
+  cache.Validate(file.version());
+
+  std::vector<uint8_t> buf(kPageSize);
+  off_t offset = 2 * kPageSize - 50;
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_EQ(cache.Read(file.version(), buf.data(), buf.size(), offset,
+                         file.reader()),
+              150);
+    EXPECT_EQ(memcmp(buf.data(), file.data() + offset, 150), 0);
+  }
+  EXPECT_EQ(file.reads(), 1);
+  EXPECT_EQ(cache.Read(file.version(), buf.data(), buf.size(),
+                       2 * kPageSize + 100, file.reader()),
+            0);
+}
+
+TEST(PageCacheTest, OnlyMissingPagesAreFetched) {
+  FakeFile file(8 * kPageSize);
+  PageCache cache;
+  cache.SetCapacity(64 * kPageSize);
+  cache.Validate(file.version());
+
+  std::vector<uint8_t> buf(8 * kPageSize);
+  ASSERT_EQ(cache.Read(file.version(), buf.data(), kPageSize, 3 * kPageSize,
+                       file.reader()),
+            kPageSize);
+  ASSERT_EQ(
+      cache.Read(file.version(), buf.data(), buf.size(), 0, file.reader()),
+      buf.size());
+  EXPECT_EQ(memcmp(buf.data(), file.data(), buf.size()), 0);
+  // One read for the first page, and one for each run of pages around it.
+  EXPECT_EQ(file.reads(), 3);
+}
+
+TEST(PageCacheTest, NewVersionDropsPages) {
+  FakeFile file(4 * kPageSize);
+  PageCache cache;
+  cache.SetCapacity(64 * kPageSize);
+  cache.Validate(file.version(1));
+
+  std::vector<uint8_t> buf(kPageSize);
+  ASSERT_EQ(cache.Read(file.version(1), buf.data(), buf.size(), 0,
+                       file.reader()),
+            buf.size());
+  std::fill(file.mutable_data()->begin(), file.mutable_data()->end(), 9);
+  cache.Validate(file.version(2));
+  ASSERT_EQ(cache.Read(file.version(2), buf.data(), buf.size(), 0,
+                       file.reader()),
+            buf.size());
+  EXPECT_EQ(buf, std::vector<uint8_t>(kPageSize, 9));
+  EXPECT_EQ(file.reads(), 2);
+}
+
+TEST(PageCacheTest, StaleVersionBypassesTheCache) {
+  FakeFile file(4 * kPageSize);
+  PageCache cache;
+  cache.SetCapacity(64 * kPageSize);
+  cache.Validate(file.version(2));
+
+  std::vector<uint8_t> buf(kPageSize);
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_EQ(cache.Read(file.version(1), buf.data(), buf.size(), 0,
+                         file.reader()),
+              buf.size());
+  }
+  EXPECT_EQ(file.reads(), 2);
+}
+
+TEST(PageCacheTest, EvictsLeastRecentlyUsedPages) {
+  FakeFile file(4 * kPageSize);
+  PageCache cache;
+  cache.SetCapacity(2 * kPageSize);
+  cache.Validate(file.version());
+
+  std::vector<uint8_t> buf(kPageSize);
+  auto read_page = [&](int index) {
+    ASSERT_EQ(cache.Read(file.version(), buf.data(), buf.size(),
+                         index * kPageSize, file.reader()),
+              buf.size());
+    EXPECT_EQ(memcmp(buf.data(), file.data() + index * kPageSize, kPageSize),
+              0);
+  };
+  read_page(0);
+  read_page(1);
+  read_page(0);
+  read_page(2);
+  EXPECT_EQ(file.reads(), 3);
+  read_page(0);
+  EXPECT_EQ(file.reads(), 3);
+  read_page(1);
+  EXPECT_EQ(file.reads(), 4);
+}
+
+TEST(PageCacheTest, ZeroCapacityDisablesTheCache) {
+  FakeFile file(4 * kPageSize);
+  PageCache cache;
+  ASSERT_TRUE(cache.RegisterPrefix("/models"));
+  EXPECT_FALSE(cache.IsCached("/models/weights"));
+  cache.Validate(file.version());
+
+  std::vector<uint8_t> buf(kPageSize);
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_EQ(
+        cache.Read(file.version(), buf.data(), buf.size(), 0, file.reader()),
+        buf.size());
+  }
+  EXPECT_EQ(file.reads(), 2);
+}
+
+TEST(PageCacheTest, PrefixesMatchWholeDirectories) {
+  PageCache cache;
+  cache.SetCapacity(kPageSize);
+  EXPECT_FALSE(cache.RegisterPrefix("models"));
+  EXPECT_FALSE(cache.RegisterPrefix("/models/"));
+  ASSERT_TRUE(cache.RegisterPrefix("/models"));
+
+  EXPECT_TRUE(cache.IsCached("/models"));
+  EXPECT_TRUE(cache.IsCached("/models/weights"));
+  EXPECT_FALSE(cache.IsCached("/models2/weights"));
+  EXPECT_FALSE(cache.IsCached("/etc/config"));
+
+  cache.DeregisterPrefix("/models");
+  EXPECT_FALSE(cache.IsCached("/models/weights"));
+}
+
+TEST(PageCacheTest, ReaderErrorsArePropagated) {
+  FakeFile file(4 * kPageSize);
+  PageCache cache;
+  cache.SetCapacity(64 * kPageSize);
+  cache.Validate(file.version());
+
+  std::vector<uint8_t> buf(2 * kPageSize);
+  ASSERT_EQ(cache.Read(file.version(), buf.data(), kPageSize, 0,
+                       file.reader()),
+            kPageSize);
+  file.set_fail(true);
+  EXPECT_EQ(cache.Read(file.version(), buf.data(), kPageSize, kPageSize,
+                       file.reader()),
+            -1);
+  EXPECT_EQ(errno, EIO);
+
+  // Bytes served from the cache before the failure are still returned.
+  EXPECT_EQ(cache.Read(file.version(), buf.data(), buf.size(), 0,
+                       file.reader()),
+            kPageSize);
+}
+
+// A file that changes while its missing pages are fetched must not have the
+// pages cached for its new version copied into reads of the old one.
+TEST(PageCacheTest, VersionChangesDuringReadsBypassTheCache) {
+  FakeFile file(3 * kPageSize);
+  FakeFile new_file(3 * kPageSize);
+  std::fill(new_file.mutable_data()->begin(), new_file.mutable_data()->end(),
+            9);
+  PageCache cache;
+  cache.SetCapacity(64 * kPageSize);
+  cache.Validate(file.version(1));
+
+  std::vector<uint8_t> buf(3 * kPageSize);
+  ASSERT_EQ(cache.Read(file.version(1), buf.data(), kPageSize, kPageSize,
+                       file.reader()),
+            kPageSize);
+
+  // Fetching the first page records the new version and caches its second
+  // page before returning the first page of the old version.
+  PageCache::PageReader reader = [&](void *data, size_t count,
+                                     off_t offset) -> ssize_t {
+    if (offset == 0) {
+      cache.Validate(new_file.version(2));
+      std::vector<uint8_t> new_page(kPageSize);
+      EXPECT_EQ(cache.Read(new_file.version(2), new_page.data(),
+                           new_page.size(), kPageSize, new_file.reader()),
+                kPageSize);
+    }
+    return file.reader()(data, count, offset);
+  };
+  ASSERT_EQ(cache.Read(file.version(1), buf.data(), buf.size(), 0, reader),
+            buf.size());
+  EXPECT_EQ(memcmp(buf.data(), file.data(), buf.size()), 0);
+}
+
+TEST(PageCacheTest, IdleFilesAreForgotten) {
+  FakeFile file(4 * kPageSize);
+  PageCache cache;
+  cache.SetCapacity(64 * kPageSize);
+  cache.Validate(file.version());
+
+  std::vector<uint8_t> buf(kPageSize);
+  ASSERT_EQ(
+      cache.Read(file.version(), buf.data(), buf.size(), 0, file.reader()),
+      buf.size());
+
+  // Files recorded without being read are forgotten, and reads against them
+  // bypass the cache.
+  PageCache::FileVersion idle = {1, 3, 4 * kPageSize, 1};
+  cache.Validate(idle);
+  for (ino_t inode = 4; inode < 4 + 2 * PageCache::kMaxIdleFiles; ++inode) {
+    cache.Validate({1, inode, 4 * kPageSize, 1});
+  }
+  FakeFile idle_file(4 * kPageSize);
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_EQ(
+        cache.Read(idle, buf.data(), buf.size(), 0, idle_file.reader()),
+        buf.size());
+  }
+  EXPECT_EQ(idle_file.reads(), 2);
+
+  // Files with cached pages are kept.
+  ASSERT_EQ(
+      cache.Read(file.version(), buf.data(), buf.size(), 0, file.reader()),
+      buf.size());
+  EXPECT_EQ(memcmp(buf.data(), file.data(), buf.size()), 0);
+  EXPECT_EQ(file.reads(), 1);
+}
+
+// A reader that claims to have read more than it was asked for must not make
+// the cache copy past the end of its buffers.
+TEST(PageCacheTest, OversizedReadsAreRejected) {
+  FakeFile file(4 * kPageSize);
+  PageCache cache;
+  cache.SetCapacity(64 * kPageSize);
+  cache.Validate(file.version());
+
+  PageCache::PageReader reader = [](void *buf, size_t count, off_t offset) {
+    memset(buf, 0, count);
+    return static_cast<ssize_t>(count + kPageSize);
+  };
+  std::vector<uint8_t> buf(kPageSize);
+  EXPECT_EQ(cache.Read(file.version(), buf.data(), buf.size(), 0, reader), -1);
+  EXPECT_EQ(errno, EIO);
+
+  // Nothing was cached from the rejected read.
+  file.set_fail(true);
+  EXPECT_EQ(cache.Read(file.version(), buf.data(), buf.size(), 0,
+                       file.reader()),
+            -1);
+
+  // The bypass taken for stale versions is checked too.
+  EXPECT_EQ(cache.Read(file.version(2), buf.data(), buf.size(), 0, reader),
+            -1);
+  EXPECT_EQ(errno, EIO);
+}
+
+}  // namespace
+}  // namespace io
+}  // namespace asylo
@@ -23,12 +23,24 @@
 #include <string.h>
 #include <sys/sysmacros.h>
 
+#include "absl/base/attributes.h"
 #include "absl/memory/memory.h"
+#include "asylo/crypto/chacha20_drbg.h"
 #include "asylo/platform/arch/include/trusted/hardware_random.h"
+#include "asylo/util/status.h"
 
 namespace asylo {
 namespace {
 
+Status HardwareSeedSource(uint8_t *seed, size_t size) {
+  enc_hardware_random_seed(seed, size);
+  return Status::OkStatus();
+}
+
+// Each thread draws from its own generator, so reads of the random devices
+// neither contend with each other nor execute RDRAND for every 8 bytes.
+ABSL_CONST_INIT thread_local ChaCha20Drbg device_drbg(HardwareSeedSource);
+
 int GetStat(struct stat *stat_buffer, bool is_urandom) {
   // Set the values of |stat_buffer| according to the values used in Linux
   // random files (Documentation/admin-guide/devices.txt).
@@ -57,9 +69,16 @@ int GetStat(struct stat *stat_buffer, bool is_urandom) {
 
 }  // namespace
 
+ssize_t GenerateRandomBytes(void *buf, size_t count) {
+  if (!device_drbg.Generate(static_cast<uint8_t *>(buf), count).ok()) {
+    errno = EIO;
+    return -1;
+  }
+  return count;
+}
+
 ssize_t RandomIOContext::Read(void *buf, size_t count) {
-  // Delegate to architecture-specific implementation to generate random numbers
-  return enc_hardware_random(reinterpret_cast<uint8_t *>(buf), count);
+  return GenerateRandomBytes(buf, count);
 }
 
 ssize_t RandomIOContext::Write(const void *buf, size_t count) {
@@ -24,6 +24,12 @@
 
 namespace asylo {
 
+// Fills |buf| with |count| random bytes from a per-thread ChaCha20Drbg that is
+// seeded and periodically reseeded from the hardware random number generator.
+// Returns |count|, or -1 and sets errno if the generator could not be seeded.
+// This serves reads of the random devices and getrandom().
+ssize_t GenerateRandomBytes(void *buf, size_t count);
+
 // IOContext implementation that returns random data on reads.
 class RandomIOContext : public io::IOManager::IOContext {
  public:
@@ -20,7 +20,10 @@
 #include <openssl/rand.h>
 #include <stdio.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 #include <unistd.h>
+#include <algorithm>
+#include <cstring>
 #include <string>
 #include <vector>
 
@@ -173,5 +176,131 @@ TEST_F(ReadWriteTest, ReadWriteSecureTest) {
   EXPECT_EQ(close(fd), 0);
 }
 
+TEST_F(ReadWriteTest, ReadWriteSecureSequentialTest) {
+  CleansingVector<uint8_t> secure_key;
+  secure_key.resize(kKeyLength);
+  ASSERT_EQ(RAND_bytes(secure_key.data(), secure_key.size()), 1)
+      << "RAND_bytes() failed";
+
+  struct key_info ioctl_param;
+  ioctl_param.length = secure_key.size();
+  ioctl_param.data = secure_key.data();
+
+  // Write enough data for the read-ahead window to grow to its largest size.
+  std::vector<uint8_t> data(1024 * 1024);
+  ASSERT_EQ(RAND_bytes(data.data(), data.size()), 1) << "RAND_bytes() failed";
+  int fd = open(test_file_.get(), O_CREAT | O_RDWR | O_SECURE, 0644);
+  ASSERT_GE(fd, 0);
+  EXPECT_EQ(ioctl(fd, ENCLAVE_STORAGE_SET_KEY, &ioctl_param), 0);
+  ASSERT_EQ(write(fd, data.data(), data.size()),
+            static_cast<ssize_t>(data.size()));
+  EXPECT_EQ(close(fd), 0);
+
+  fd = open(test_file_.get(), O_RDWR | O_SECURE);
+  ASSERT_GE(fd, 0);
+  EXPECT_EQ(ioctl(fd, ENCLAVE_STORAGE_SET_KEY, &ioctl_param), 0);
+
+  // Check that a scan in small reads returns the whole file.
+  std::vector<uint8_t> read_back(data.size());
+  size_t total = 0;
+  ssize_t rc;
+  while ((rc = read(fd, read_back.data() + total,
+                    std::min<size_t>(1000, data.size() - total))) > 0) {
+    total += rc;
+  }
+  ASSERT_EQ(rc, 0);
+  ASSERT_EQ(total, data.size());
+  EXPECT_EQ(read_back, data);
+
+  // Check that relative seeks are served from the cursor of the descriptor.
+  ASSERT_EQ(lseek(fd, 5000, SEEK_SET), 5000);
+  uint8_t buf[1000];
+  ASSERT_EQ(read(fd, buf, sizeof(buf)), static_cast<ssize_t>(sizeof(buf)));
+  ASSERT_EQ(lseek(fd, -500, SEEK_CUR), 5500);
+  ASSERT_EQ(read(fd, buf, sizeof(buf)), static_cast<ssize_t>(sizeof(buf)));
+  EXPECT_EQ(memcmp(buf, data.data() + 5500, sizeof(buf)), 0);
+
+  // Continue with two sequential reads, which fill the read-ahead buffer past
+  // the range that the next check writes.
+  ASSERT_EQ(read(fd, buf, sizeof(buf)), static_cast<ssize_t>(sizeof(buf)));
+  EXPECT_EQ(memcmp(buf, data.data() + 6500, sizeof(buf)), 0);
+  ASSERT_EQ(read(fd, buf, sizeof(buf)), static_cast<ssize_t>(sizeof(buf)));
+  EXPECT_EQ(memcmp(buf, data.data() + 7500, sizeof(buf)), 0);
+
+  // Check that a write through another descriptor is visible to a read that
+  // would otherwise be served from the read-ahead buffer.
+  int other_fd = open(test_file_.get(), O_RDWR | O_SECURE);
+  ASSERT_GE(other_fd, 0);
+  EXPECT_EQ(ioctl(other_fd, ENCLAVE_STORAGE_SET_KEY, &ioctl_param), 0);
+  std::vector<uint8_t> update(sizeof(buf), 0x5a);
+  ASSERT_EQ(lseek(other_fd, 8500, SEEK_SET), 8500);
+  ASSERT_EQ(write(other_fd, update.data(), update.size()),
+            static_cast<ssize_t>(update.size()));
+  EXPECT_EQ(close(other_fd), 0);
+  ASSERT_EQ(read(fd, buf, sizeof(buf)), static_cast<ssize_t>(sizeof(buf)));
+  EXPECT_EQ(memcmp(buf, update.data(), sizeof(buf)), 0);
+
+  EXPECT_EQ(close(fd), 0);
+}
+
+TEST_F(ReadWriteTest, ReadWriteSecurePositionalTest) {
+  CleansingVector<uint8_t> secure_key;
+  secure_key.resize(kKeyLength);
+  ASSERT_EQ(RAND_bytes(secure_key.data(), secure_key.size()), 1)
+      << "RAND_bytes() failed";
+
+  struct key_info ioctl_param;
+  ioctl_param.length = secure_key.size();
+  ioctl_param.data = secure_key.data();
+
+  std::vector<uint8_t> data(3 * kBlockLength + 50);
+  ASSERT_EQ(RAND_bytes(data.data(), data.size()), 1) << "RAND_bytes() failed";
+  int fd = open(test_file_.get(), O_CREAT | O_RDWR | O_SECURE, 0644);
+  ASSERT_GE(fd, 0);
+  EXPECT_EQ(ioctl(fd, ENCLAVE_STORAGE_SET_KEY, &ioctl_param), 0);
+
+  // Write the file with pwritev and pwrite, across block boundaries.
+  size_t head = kBlockLength + 10;
+  size_t middle = kBlockLength;
+  size_t tail = data.size() - head - middle;
+  struct iovec out[2] = {{data.data(), head}, {data.data() + head, middle}};
+  ASSERT_EQ(pwritev(fd, out, 2, 0), static_cast<ssize_t>(head + middle));
+  ASSERT_EQ(pwrite(fd, data.data() + head + middle, tail, head + middle),
+            static_cast<ssize_t>(tail));
+
+  // Check that the positional calls did not move the cursor.
+  EXPECT_EQ(lseek(fd, 0, SEEK_CUR), 0);
+
+  // Read back with pread and preadv.
+  std::vector<uint8_t> buf(data.size());
+  ASSERT_EQ(pread(fd, buf.data(), buf.size(), 0),
+            static_cast<ssize_t>(data.size()));
+  EXPECT_EQ(buf, data);
+  off_t offset = kBlockLength - 20;
+  std::vector<uint8_t> first(40);
+  std::vector<uint8_t> second(kBlockLength + 10);
+  struct iovec in[2] = {{first.data(), first.size()},
+                        {second.data(), second.size()}};
+  ASSERT_EQ(preadv(fd, in, 2, offset),
+            static_cast<ssize_t>(first.size() + second.size()));
+  EXPECT_EQ(memcmp(first.data(), data.data() + offset, first.size()), 0);
+  EXPECT_EQ(memcmp(second.data(), data.data() + offset + first.size(),
+                   second.size()),
+            0);
+
+  // Check that reads past the end of the file stop there.
+  EXPECT_EQ(pread(fd, buf.data(), buf.size(), data.size() - 10), 10);
+  EXPECT_EQ(pread(fd, buf.data(), buf.size(), data.size()), 0);
+
+  // Check that the cursor is still at the start of the file.
+  EXPECT_EQ(lseek(fd, 0, SEEK_CUR), 0);
+  uint8_t cursor_buf[16];
+  ASSERT_EQ(read(fd, cursor_buf, sizeof(cursor_buf)),
+            static_cast<ssize_t>(sizeof(cursor_buf)));
+  EXPECT_EQ(memcmp(cursor_buf, data.data(), sizeof(cursor_buf)), 0);
+
+  EXPECT_EQ(close(fd), 0);
+}
+
 }  // namespace
 }  // namespace asylo
@@ -0,0 +1,149 @@
+/*
+ *
+ * Copyright 2018 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/posix/io/readiness_notifier.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+
+#include <algorithm>
+
+#include "asylo/platform/arch/include/trusted/host_calls.h"
+
+namespace asylo {
+namespace io {
+namespace {
+
+// The longest a host wait may last while enclave streams are also being
+// waited on.
+constexpr int kHostWaitSliceMs = 5;
+
+}  // namespace
+
+int ReadinessNotifier::RemainingTimeout(absl::Time deadline) {
+  if (deadline == absl::InfiniteFuture()) {
+    return -1;
+  }
+  absl::Duration remaining = deadline - absl::Now();
+  if (remaining <= absl::ZeroDuration()) {
+    return 0;
+  }
+  return static_cast<int>(std::min<int64_t>(
+      INT_MAX, absl::ToInt64Milliseconds(
+                   absl::Ceil(remaining, absl::Milliseconds(1)))));
+}
+
+int ReadinessNotifier::HostWaitTimeout(absl::Time deadline) {
+  absl::Duration remaining = deadline - absl::Now();
+  if (remaining <= absl::ZeroDuration()) {
+    return 0;
+  }
+  return static_cast<int>(std::min<int64_t>(
+      kHostWaitSliceMs, absl::ToInt64Milliseconds(absl::Ceil(
+                            remaining, absl::Milliseconds(1)))));
+}
+
+void ReadinessNotifier::Notify() {
+  generation_.fetch_add(1);
+  bool has_host_waiters = host_waiters_.load() > 0;
+  if (waiters_.load() == 0 && !has_host_waiters) {
+    return;
+  }
+  absl::MutexLock lock(&mu_);
+  changed_.SignalAll();
+  // Host waiters that started before the current epoch have already been
+  // written a byte, which stays in the pipe until they have all ended.
+  if (has_host_waiters && host_waiters_.load() > woken_host_waiters_) {
+    ++epoch_;
+    woken_host_waiters_ = host_waiters_.load();
+    if (wakeup_write_fd_ >= 0) {
+      int saved_errno = errno;
+      uint8_t byte = 0;
+      enc_untrusted_write(wakeup_write_fd_, &byte, 1);
+      wakeup_pending_ = true;
+      errno = saved_errno;
+    }
+  }
+}
+
+bool ReadinessNotifier::WaitForChange(uint64_t generation,
+                                      absl::Time deadline) {
+  // |waiters_| is incremented before |generation_| is checked, so either this
+  // thread sees the new generation or the notifying thread sees the waiter.
+  waiters_.fetch_add(1);
+  bool changed = true;
+  {
+    absl::MutexLock lock(&mu_);
+    while (generation_.load() == generation) {
+      if (changed_.WaitWithDeadline(&mu_, deadline)) {
+        changed = generation_.load() != generation;
+        break;
+      }
+    }
+  }
+  waiters_.fetch_sub(1);
+  return changed;
+}
+
+bool ReadinessNotifier::BeginHostWait(uint64_t generation, int *wakeup_fd,
+                                      uint64_t *epoch) {
+  absl::MutexLock lock(&mu_);
+  // As in WaitForChange(), the waiter is counted before the generation is
+  // checked.
+  host_waiters_.fetch_add(1);
+  if (generation_.load() != generation) {
+    host_waiters_.fetch_sub(1);
+    return false;
+  }
+  if (wakeup_read_fd_ < 0 && !wakeup_failed_) {
+    int saved_errno = errno;
+    int pipefd[2];
+    if (enc_untrusted_pipe2(pipefd, O_NONBLOCK | O_CLOEXEC) == 0) {
+      wakeup_read_fd_ = pipefd[0];
+      wakeup_write_fd_ = pipefd[1];
+    } else {
+      wakeup_failed_ = true;
+    }
+    errno = saved_errno;
+  }
+  *wakeup_fd = wakeup_read_fd_;
+  *epoch = epoch_;
+  return true;
+}
+
+void ReadinessNotifier::EndHostWait(uint64_t epoch) {
+  absl::MutexLock lock(&mu_);
+  host_waiters_.fetch_sub(1);
+  if (epoch != epoch_) {
+    --woken_host_waiters_;
+  }
+  // The waiters left started after the last byte was written, so they do not
+  // need it.
+  if (woken_host_waiters_ == 0 && wakeup_pending_) {
+    int saved_errno = errno;
+    uint8_t buffer[64];
+    while (enc_untrusted_read(wakeup_read_fd_, buffer, sizeof(buffer)) > 0) {
+    }
+    wakeup_pending_ = false;
+    errno = saved_errno;
+  }
+}
+
+}  // namespace io
+}  // namespace asylo
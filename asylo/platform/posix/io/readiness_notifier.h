@@ -0,0 +1,126 @@
+/*
+ *
+ * Copyright 2018 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_POSIX_IO_READINESS_NOTIFIER_H_
+#define ASYLO_PLATFORM_POSIX_IO_READINESS_NOTIFIER_H_
+
+#include <atomic>
+#include <cstdint>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace asylo {
+namespace io {
+
+// ReadinessNotifier lets poll(), select() and epoll_wait() sleep until the
+// readiness of a stream implemented inside the enclave may have changed. Such
+// streams have no host file descriptor, so the host cannot wait on them.
+//
+// Streams call Notify() whenever they change state. A waiter reads
+// generation(), checks the streams it is interested in, and then calls
+// WaitForChange() with the generation it read, so a change that happens after
+// the check is never missed.
+//
+// Waits that also involve host file descriptors are made by the host, which
+// cannot see enclave streams. Such a wait is bracketed by BeginHostWait() and
+// EndHostWait(), and includes a host file descriptor that Notify() makes
+// readable, so that changes to enclave streams end it.
+class ReadinessNotifier {
+ public:
+  // Accessor to the singleton instance.
+  static ReadinessNotifier &GetInstance() {
+    static ReadinessNotifier *instance = new ReadinessNotifier;
+    return *instance;
+  }
+
+  // Returns the timeout in milliseconds for a host wait that ends at
+  // |deadline|, or -1 if |deadline| is infinite.
+  static int RemainingTimeout(absl::Time deadline);
+
+  // Returns the timeout in milliseconds for a host wait that must notice
+  // changes to enclave streams before |deadline| without a wakeup file
+  // descriptor. The wait is bounded to a short slice.
+  static int HostWaitTimeout(absl::Time deadline);
+
+  // Returns a counter that is incremented by every call to Notify().
+  uint64_t generation() const { return generation_.load(); }
+
+  // Wakes all threads waiting for a change. Cheap when no thread is waiting.
+  void Notify() LOCKS_EXCLUDED(mu_);
+
+  // Blocks until generation() differs from |generation| or |deadline| passes.
+  // Returns false if the deadline passed without a change.
+  bool WaitForChange(uint64_t generation, absl::Time deadline)
+      LOCKS_EXCLUDED(mu_);
+
+  // Starts a host wait for changes after |generation|. Returns false if
+  // generation() already differs from |generation|, in which case the caller
+  // must check its streams again rather than wait. Otherwise stores in
+  // |wakeup_fd| a host file descriptor that becomes readable when Notify() is
+  // called before the matching EndHostWait(), or -1 if none is available and
+  // the wait must be bounded with HostWaitTimeout(). The value stored in
+  // |epoch| must be passed to EndHostWait().
+  bool BeginHostWait(uint64_t generation, int *wakeup_fd, uint64_t *epoch)
+      LOCKS_EXCLUDED(mu_);
+
+  // Ends a host wait started by BeginHostWait() at |epoch|.
+  void EndHostWait(uint64_t epoch) LOCKS_EXCLUDED(mu_);
+
+ private:
+  ReadinessNotifier() = default;
+  ReadinessNotifier(ReadinessNotifier const &) = delete;
+  void operator=(ReadinessNotifier const &) = delete;
+
+  std::atomic<uint64_t> generation_{0};
+
+  // The number of threads in WaitForChange(), so that Notify() only takes
+  // |mu_| when there is someone to wake.
+  std::atomic<int> waiters_{0};
+
+  // The number of threads between BeginHostWait() and EndHostWait(). Only
+  // changed with |mu_| held, and read without it by Notify().
+  std::atomic<int> host_waiters_{0};
+
+  absl::Mutex mu_;
+  absl::CondVar changed_;
+
+  // Incremented each time Notify() wakes host waiters.
+  uint64_t epoch_ GUARDED_BY(mu_) = 0;
+
+  // The number of host waiters that started before the current epoch, and so
+  // have already been woken.
+  int woken_host_waiters_ GUARDED_BY(mu_) = 0;
+
+  // The ends of the host pipe used to wake host waiters, or -1 before it is
+  // created.
+  int wakeup_read_fd_ GUARDED_BY(mu_) = -1;
+  int wakeup_write_fd_ GUARDED_BY(mu_) = -1;
+
+  // Set if the host pipe could not be created.
+  bool wakeup_failed_ GUARDED_BY(mu_) = false;
+
+  // Set while bytes written to the host pipe may not have been read back.
+  bool wakeup_pending_ GUARDED_BY(mu_) = false;
+};
+
+}  // namespace io
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_POSIX_IO_READINESS_NOTIFIER_H_
@@ -19,8 +19,12 @@
 #include "asylo/platform/posix/io/secure_paths.h"
 
 #include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <algorithm>
+#include <climits>
 #include <cerrno>
 #include <cstdint>
+#include <cstring>
 
 #include "asylo/platform/arch/include/trusted/host_calls.h"
 #include "asylo/platform/crypto/gcmlib/gcm_cryptor.h"
@@ -34,20 +38,172 @@ using asylo::platform::storage::AeadHandler;
 namespace asylo {
 namespace io {
 
+constexpr size_t IOContextSecure::kMinReadAhead;
+constexpr size_t IOContextSecure::kMaxReadAhead;
+
+namespace {
+
+// Returns the total length of the buffers in |iov|, or -1 and sets errno if
+// the vector is invalid.
+ssize_t IovecLength(const struct iovec *iov, int iovcnt) {
+  if (iovcnt <= 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  size_t total = 0;
+  for (int i = 0; i < iovcnt; ++i) {
+    if (iov[i].iov_len > SSIZE_MAX - total) {
+      errno = EINVAL;
+      return -1;
+    }
+    total += iov[i].iov_len;
+  }
+  return total;
+}
+
+}  // namespace
+
 int IOContextSecure::Close() {
   return platform::storage::secure_close(host_fd_);
 }
 
 ssize_t IOContextSecure::Read(void *buf, size_t count) {
-  return platform::storage::secure_read(host_fd_, buf, count);
+  absl::MutexLock lock(&mu_);
+  int64_t version = AeadHandler::GetInstance().GetFileVersion(host_fd_);
+  if (version == -1) {
+    return -1;
+  }
+  if (version != read_ahead_version_) {
+    DropReadAhead();
+  }
+
+  bool sequential = position_ == last_read_end_;
+  if (!sequential) {
+    window_ = 0;
+  }
+
+  uint8_t *output = static_cast<uint8_t *>(buf);
+  size_t total = 0;
+  while (total < count) {
+    size_t copied = CopyFromReadAhead(output + total, count - total);
+    if (copied > 0) {
+      total += copied;
+      continue;
+    }
+
+    // Random reads, and reads at least as large as the next window, go
+    // straight to the caller's buffer.
+    size_t next_window =
+        std::min(std::max(2 * window_, kMinReadAhead), kMaxReadAhead);
+    if (!sequential || count - total >= next_window) {
+      ssize_t bytes_read = platform::storage::secure_pread(
+          host_fd_, output + total, count - total, position_);
+      if (bytes_read == -1) {
+        return total > 0 ? total : -1;
+      }
+      position_ += bytes_read;
+      total += bytes_read;
+      break;
+    }
+
+    window_ = next_window;
+    ssize_t buffered = FillReadAhead(version);
+    if (buffered <= 0) {
+      if (buffered == -1 && total == 0) {
+        return -1;
+      }
+      break;
+    }
+  }
+
+  last_read_end_ = position_;
+  return total;
 }
 
 ssize_t IOContextSecure::Write(const void *buf, size_t count) {
-  return platform::storage::secure_write(host_fd_, buf, count);
+  absl::MutexLock lock(&mu_);
+  DropReadAhead();
+  ssize_t bytes_written =
+      platform::storage::secure_pwrite(host_fd_, buf, count, position_);
+  if (bytes_written == -1) {
+    return -1;
+  }
+  position_ += bytes_written;
+  return bytes_written;
+}
+
+// Positional calls bypass the read-ahead buffer. A write still invalidates it
+// through the file version, which every cursor-based read checks.
+ssize_t IOContextSecure::PRead(void *buf, size_t count, off_t offset) {
+  return platform::storage::secure_pread(host_fd_, buf, count, offset);
+}
+
+ssize_t IOContextSecure::PWrite(const void *buf, size_t count, off_t offset) {
+  return platform::storage::secure_pwrite(host_fd_, buf, count, offset);
+}
+
+// Vectored calls are served by a single positional call on a staging buffer,
+// so that each costs one pass through the secure I/O layer.
+ssize_t IOContextSecure::PReadv(const struct iovec *iov, int iovcnt,
+                                off_t offset) {
+  ssize_t length = IovecLength(iov, iovcnt);
+  if (length == -1) {
+    return -1;
+  }
+  CleansingVector<uint8_t> staged(length);
+  ssize_t bytes_read =
+      platform::storage::secure_pread(host_fd_, staged.data(), length, offset);
+  if (bytes_read <= 0) {
+    return bytes_read;
+  }
+  size_t copied = 0;
+  for (int i = 0; i < iovcnt && copied < static_cast<size_t>(bytes_read);
+       ++i) {
+    size_t chunk = std::min(iov[i].iov_len, bytes_read - copied);
+    memcpy(iov[i].iov_base, staged.data() + copied, chunk);
+    copied += chunk;
+  }
+  return bytes_read;
+}
+
+ssize_t IOContextSecure::PWritev(const struct iovec *iov, int iovcnt,
+                                 off_t offset) {
+  ssize_t length = IovecLength(iov, iovcnt);
+  if (length == -1) {
+    return -1;
+  }
+  CleansingVector<uint8_t> staged;
+  staged.reserve(length);
+  for (int i = 0; i < iovcnt; ++i) {
+    const uint8_t *base = static_cast<const uint8_t *>(iov[i].iov_base);
+    staged.insert(staged.end(), base, base + iov[i].iov_len);
+  }
+  return platform::storage::secure_pwrite(host_fd_, staged.data(), length,
+                                          offset);
 }
 
 int IOContextSecure::LSeek(off_t offset, int whence) {
-  return platform::storage::secure_lseek(host_fd_, offset, whence);
+  absl::MutexLock lock(&mu_);
+
+  // Absolute and relative seeks only move the cursor of this context. Seeks
+  // from the end ask the secure I/O layer for the logical size of the file.
+  if (whence == SEEK_SET || whence == SEEK_CUR) {
+    off_t new_position = (whence == SEEK_SET) ? offset : position_ + offset;
+    if (new_position < 0) {
+      errno = EINVAL;
+      return -1;
+    }
+    position_ = new_position;
+    return position_;
+  }
+
+  off_t new_position =
+      platform::storage::secure_lseek(host_fd_, offset, whence);
+  if (new_position == -1) {
+    return -1;
+  }
+  position_ = new_position;
+  return position_;
 }
 
 int IOContextSecure::FSync() { return enc_untrusted_fsync(host_fd_); }
@@ -72,5 +228,38 @@ int IOContextSecure::Ioctl(int request, void *argp) {
   return -1;
 }
 
+size_t IOContextSecure::CopyFromReadAhead(uint8_t *buf, size_t count) {
+  if (position_ < read_ahead_offset_ ||
+      position_ >= read_ahead_offset_ +
+                       static_cast<off_t>(read_ahead_.size())) {
+    return 0;
+  }
+  size_t offset = position_ - read_ahead_offset_;
+  size_t copied = std::min(count, read_ahead_.size() - offset);
+  memcpy(buf, read_ahead_.data() + offset, copied);
+  position_ += copied;
+  return copied;
+}
+
+ssize_t IOContextSecure::FillReadAhead(int64_t version) {
+  DropReadAhead();
+  read_ahead_.resize(window_);
+  ssize_t bytes_read = platform::storage::secure_pread(
+      host_fd_, read_ahead_.data(), window_, position_);
+  if (bytes_read == -1) {
+    DropReadAhead();
+    return -1;
+  }
+  read_ahead_.resize(bytes_read);
+  read_ahead_offset_ = position_;
+  read_ahead_version_ = version;
+  return bytes_read;
+}
+
+void IOContextSecure::DropReadAhead() {
+  read_ahead_.clear();
+  read_ahead_version_ = -1;
+}
+
 }  // namespace io
 }  // namespace asylo
@@ -19,12 +19,30 @@
 #ifndef ASYLO_PLATFORM_POSIX_IO_SECURE_PATHS_H_
 #define ASYLO_PLATFORM_POSIX_IO_SECURE_PATHS_H_
 
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
 #include "asylo/platform/posix/io/io_manager.h"
+#include "asylo/util/cleansing_types.h"
 
 namespace asylo {
 namespace io {
 
 // IOContext implementation wrapping a stream managed by the secure I/O layer.
+//
+// Sequential reads are served from a read-ahead buffer of decrypted and
+// verified data. Once a read continues where the previous one ended, the next
+// buffer refill reads kMinReadAhead bytes, and every further refill doubles
+// that up to kMaxReadAhead bytes, so a scan of a large file costs one exit per
+// window instead of several exits per read. The buffer is dropped whenever the
+// file is written, through this or any other file descriptor.
+//
+// The cursor is kept in the enclave and every access to the backing store is
+// positional, so the host cursor is never relied upon. The positional calls
+// PRead and PWrite do not take the lock that guards the cursor, and may run
+// concurrently with each other and with cursor-based calls.
 class IOContextSecure : public IOManager::IOContext {
  public:
   // Factory method to create an instance of the class.
@@ -40,6 +58,10 @@ class IOContextSecure : public IOManager::IOContext {
  protected:
   ssize_t Read(void *buf, size_t count) override;
   ssize_t Write(const void *buf, size_t count) override;
+  ssize_t PRead(void *buf, size_t count, off_t offset) override;
+  ssize_t PWrite(const void *buf, size_t count, off_t offset) override;
+  ssize_t PReadv(const struct iovec *iov, int iovcnt, off_t offset) override;
+  ssize_t PWritev(const struct iovec *iov, int iovcnt, off_t offset) override;
   int Close() override;
   int LSeek(off_t offset, int whence) override;
   int FSync() override;
@@ -48,10 +70,54 @@ class IOContextSecure : public IOManager::IOContext {
   int Ioctl(int request, void *argp) override;
 
  private:
-  explicit IOContextSecure(int host_fd) : host_fd_(host_fd) {}
+  // The sizes of the first and the largest read-ahead windows, in bytes of
+  // plaintext.
+  static constexpr size_t kMinReadAhead = 16 * 1024;
+  static constexpr size_t kMaxReadAhead = 256 * 1024;
+
+  explicit IOContextSecure(int host_fd)
+      : host_fd_(host_fd),
+        position_(0),
+        last_read_end_(0),
+        window_(0),
+        read_ahead_offset_(0),
+        read_ahead_version_(-1) {}
+
+  // Copies up to |count| bytes at |position_| from the read-ahead buffer to
+  // |buf| and advances |position_|. Returns the number of bytes copied, which
+  // is zero if |position_| is not buffered.
+  size_t CopyFromReadAhead(uint8_t *buf, size_t count)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Replaces the read-ahead buffer with up to |window_| bytes starting at
+  // |position_|, for file version |version|. Returns the number of bytes
+  // buffered, which is zero at the end of the file, or -1 on failure.
+  ssize_t FillReadAhead(int64_t version) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Discards the read-ahead buffer.
+  void DropReadAhead() EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
   // Host-provided file descriptor of the backing store.
   int host_fd_;
+
+  absl::Mutex mu_;
+
+  // The logical offset of the cursor as seen through this context.
+  off_t position_ GUARDED_BY(mu_);
+
+  // The logical offset at which the last read ended. A read starting there is
+  // considered sequential.
+  off_t last_read_end_ GUARDED_BY(mu_);
+
+  // The size of the last read-ahead, or zero since the last read that was
+  // not sequential.
+  size_t window_ GUARDED_BY(mu_);
+
+  // Decrypted and verified file data starting at logical offset
+  // |read_ahead_offset_|, read while the file was at |read_ahead_version_|.
+  CleansingVector<uint8_t> read_ahead_ GUARDED_BY(mu_);
+  off_t read_ahead_offset_ GUARDED_BY(mu_);
+  int64_t read_ahead_version_ GUARDED_BY(mu_);
 };
 
 }  // namespace io
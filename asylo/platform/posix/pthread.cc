@@ -19,19 +19,21 @@
 #include <pthread.h>
 
 #include <signal.h>
+#include <algorithm>
 #include <cerrno>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <type_traits>
-#include <array>
-#include <bitset>
 
 #include "asylo/platform/arch/include/trusted/enclave_interface.h"
 #include "asylo/platform/arch/include/trusted/host_calls.h"
 #include "asylo/platform/arch/include/trusted/memory.h"
 #include "asylo/platform/common/time_util.h"
+#include "asylo/platform/core/atomic.h"
 #include "asylo/platform/core/trusted_global_state.h"
+#include "asylo/platform/core/untrusted_cache_malloc.h"
 #include "asylo/platform/posix/include/semaphore.h"
 #include "asylo/platform/posix/pthread_impl.h"
 #include "asylo/platform/posix/threading/thread_manager.h"
@@ -44,12 +46,39 @@ inline int InterlockedExchange(pthread_spinlock_t *dest,
   return __sync_val_compare_and_swap(dest, old_value, new_value);
 }
 
-constexpr size_t PTHREAD_KEYS_MAX = 64;
-thread_local std::array<const void *,
-             PTHREAD_KEYS_MAX> thread_specific = {nullptr};
+constexpr size_t PTHREAD_KEYS_MAX = 1024;
 
-static pthread_mutex_t used_thread_keys_lock = PTHREAD_MUTEX_INITIALIZER;
-std::bitset<PTHREAD_KEYS_MAX> used_thread_keys;
+// The number of times the destructors of a thread's keys are run at thread
+// exit while destructors keep setting new non-null values.
+constexpr int kKeyDestructorIterations = 4;
+
+// A key slot is in use while its sequence number is odd. The sequence number
+// is bumped when the key is created and again when it is deleted, so values
+// set for a deleted key are never visible through a key that reuses its slot.
+struct KeySlot {
+  uint64_t sequence;
+  void (*destructor)(void *);
+};
+
+KeySlot key_slots[PTHREAD_KEYS_MAX];
+
+inline bool IsKeyInUse(uint64_t sequence) { return (sequence & 1) != 0; }
+
+// A value set by pthread_setspecific, and the sequence number of the key it was
+// set for.
+struct ThreadSpecificValue {
+  uint64_t sequence;
+  const void *value;
+};
+
+// The values set by a thread, indexed by key. The array is grown on demand, so
+// it only covers keys up to the largest one the thread has set.
+struct ThreadSpecificStorage {
+  ThreadSpecificValue *values;
+  size_t size;
+};
+
+thread_local ThreadSpecificStorage thread_specific = {nullptr, 0};
 
 inline int pthread_spin_lock(pthread_spinlock_t *lock) {
   while (InterlockedExchange(lock, 0, 1) != 0) {
@@ -136,65 +165,398 @@ int pthread_mutex_lock_internal(pthread_mutex_t *mutex) {
   return EBUSY;
 }
 
-// Read locks the given |rwlock| if possible and returns 0. On success,
-// pthread_self() is removed from |rwlock|._queue and |rwlock|._readers is
-// incremented. Returns EBUSY if the |rwlock| is write locked or pthread_self()
-// is not the front of |rwlock|._queue. |rwlock|._lock must be locked by the
-// caller.
-int pthread_rwlock_tryrdlock_internal(pthread_rwlock_t *rwlock) {
-  // If |rwlock| is owned by a writer it is not read lockable.
-  if (rwlock->_write_owner != PTHREAD_T_NULL) {
-    return EBUSY;
+// The number of times a blocking operation re-checks the state of an object
+// before exiting the enclave to park on the object's futex.
+constexpr int kParkSpinIterations = 100;
+
+// Returns the futex words whose address is stored at |futex|, allocating a
+// zeroed cache line of them in untrusted memory on first use. Objects that are
+// statically initialized have no futex words until a thread first has to park
+// on them.
+//
+// The host kernel cannot read trusted memory, so threads park on these words
+// instead of on the state of the object itself. Each word is used as a
+// sequence number that is bumped before waking the threads parked on it. A
+// host that tampers with the words can only cause spurious wakeups or stall
+// parked threads, since the state of the object is kept in trusted memory.
+//
+// Returns nullptr if the words could not be allocated, in which case threads
+// spin on the state of the object instead of parking.
+int32_t *GetUntrustedFutex(int32_t **futex) {
+  int32_t *words = __atomic_load_n(futex, __ATOMIC_ACQUIRE);
+  if (words) {
+    return words;
+  }
+
+  // Allocate a full cache line to avoid false sharing with another object.
+  asylo::UntrustedCacheMalloc *untrusted_cache_malloc =
+      asylo::UntrustedCacheMalloc::Instance();
+  int32_t *allocated = static_cast<int32_t *>(
+      untrusted_cache_malloc->Malloc(asylo::kCacheLineSize));
+  if (!allocated) {
+    return nullptr;
   }
+  memset(allocated, 0, asylo::kCacheLineSize);
+  if (!__atomic_compare_exchange_n(futex, &words, allocated,
+                                   /*weak=*/false, __ATOMIC_ACQ_REL,
+                                   __ATOMIC_ACQUIRE)) {
+    // Another thread installed its futex words first.
+    untrusted_cache_malloc->Free(allocated);
+    return words;
+  }
+  return allocated;
+}
 
-  asylo::pthread_impl::QueueOperations queue(rwlock);
-  const pthread_t self = pthread_self();
+// Frees the futex words whose address is stored at |futex|, if any.
+void FreeUntrustedFutex(int32_t **futex) {
+  if (*futex) {
+    asylo::UntrustedCacheMalloc::Instance()->Free(*futex);
+    *futex = nullptr;
+  }
+}
 
-  // If the current thread is at the front of the queue or the queue is empty
-  // |rwlock| is read lockable.
-  if (queue.Empty() || queue.Front() == self) {
-    queue.Dequeue();
-    rwlock->_reader_count++;
+// Returns the sequence number of |word|, or zero if |word| is null.
+int32_t LoadFutexSequence(const int32_t *word) {
+  return word ? __atomic_load_n(word, __ATOMIC_SEQ_CST) : 0;
+}
 
+// Parks the calling thread on |word| until it is woken, unless the value of
+// |word| is no longer |sequence|. If |deadline| is not null, returns ETIMEDOUT
+// without parking if |deadline| has passed, and otherwise parks no later than
+// |deadline|. Returns 0 if the thread was woken or did not need to park. If
+// |word| is null, pauses briefly instead of parking, as if woken spuriously.
+//
+// Warning: Enclaves do not currently have a source of secure time. A hostile
+// host could cause a timed park to time out immediately or never time out.
+int ParkOnFutex(int32_t *word, int32_t sequence, const timespec *deadline) {
+  if (deadline == nullptr) {
+    if (word) {
+      enc_untrusted_sys_futex_wait(word, sequence);
+    } else {
+      enc_pause();
+    }
     return 0;
   }
 
-  return EBUSY;
+  timespec curr_time;
+  if (clock_gettime(CLOCK_REALTIME, &curr_time) != 0) {
+    return errno;
+  }
+
+  // TimeSpecSubtract returns true if deadline < curr_time.
+  timespec time_left;
+  if (asylo::TimeSpecSubtract(*deadline, curr_time, &time_left) ||
+      asylo::TimeSpecToNanoseconds(&time_left) == 0) {
+    return ETIMEDOUT;
+  }
+  if (word) {
+    enc_untrusted_sys_futex_timedwait(
+        word, sequence, asylo::TimeSpecToNanoseconds(&time_left));
+  } else {
+    enc_pause();
+  }
+  return 0;
+}
+
+// Bumps the sequence number of |word| and wakes one or all of the threads
+// parked on it. Returns true if the host reports that a thread was woken. If
+// |word| is null, no thread can be parked on it and returns false.
+bool WakeFutex(int32_t *word, bool wake_all) {
+  if (!word) {
+    return false;
+  }
+  __atomic_fetch_add(word, 1, __ATOMIC_SEQ_CST);
+  int woken = wake_all ? enc_untrusted_sys_futex_wake_all(word)
+                       : enc_untrusted_sys_futex_wake(word);
+  return woken > 0;
+}
+
+// The lock state of a pthread_rwlock_t is a single word in trusted memory. The
+// low bits count the readers holding the lock, or are all set while a writer
+// holds it. The two high bits record that readers or writers may be parked
+// waiting for the lock, in which case the thread releasing it must wake them.
+constexpr uint32_t kRwLockMask = (1u << 30) - 1;
+constexpr uint32_t kReadLocked = 1;
+constexpr uint32_t kWriteLocked = kRwLockMask;
+constexpr uint32_t kMaxReaders = kRwLockMask - 1;
+constexpr uint32_t kReadersWaiting = 1u << 30;
+constexpr uint32_t kWritersWaiting = 1u << 31;
+
+// Readers and writers park on separate futex words. The host cannot admit a
+// thread to the lock by tampering with them, since ownership is decided by the
+// trusted lock state alone.
+constexpr int kReadersFutex = 0;
+constexpr int kWritersFutex = 1;
+
+inline uint32_t LoadRwLockState(const pthread_rwlock_t *rwlock) {
+  return __atomic_load_n(&rwlock->_state, __ATOMIC_SEQ_CST);
 }
 
-// Writes locks the given |rwlock| if possible and returns 0. On success,
-// pthread_self() is removed from |rwlock|._queue and added to
-// |rwlock|._write_owner. Returns EBUSY if the |rwlock| is write locked, read
-// locked, or pthread_self() is not the front of |rwlock|._queue. |rwlock|._lock
-// must be locked by the caller.
+// Updates the state of |rwlock| from |*state| to |desired|. On failure, stores
+// the current state of |rwlock| in |*state|.
+inline bool CompareAndSwapRwLockState(pthread_rwlock_t *rwlock,
+                                      uint32_t *state, uint32_t desired) {
+  return __atomic_compare_exchange_n(&rwlock->_state, state, desired,
+                                     /*weak=*/false, __ATOMIC_SEQ_CST,
+                                     __ATOMIC_SEQ_CST);
+}
+
+inline bool IsUnlocked(uint32_t state) { return (state & kRwLockMask) == 0; }
+
+inline bool IsWriteLocked(uint32_t state) {
+  return (state & kRwLockMask) == kWriteLocked;
+}
+
+inline bool HasWaiters(uint32_t state) {
+  return (state & (kReadersWaiting | kWritersWaiting)) != 0;
+}
+
+// Returns true if a reader may take |rwlock| in |state|. Unless |rwlock|
+// prefers readers, new readers queue behind parked threads so that a stream of
+// readers cannot starve a writer.
+inline bool IsReadLockable(const pthread_rwlock_t *rwlock, uint32_t state) {
+  if ((state & kRwLockMask) >= kMaxReaders) {
+    return false;
+  }
+  return rwlock->_kind == PTHREAD_RWLOCK_PREFER_READER_NP || !HasWaiters(state);
+}
+
+// Returns true if |rwlock| is write locked by the calling thread.
+inline bool IsWriteOwner(const pthread_rwlock_t *rwlock, uint32_t state) {
+  return IsWriteLocked(state) &&
+         __atomic_load_n(&rwlock->_write_owner, __ATOMIC_RELAXED) ==
+             pthread_self();
+}
+
+// Spins until |done| returns true for the state of |rwlock| or the spin budget
+// runs out, and returns the last state read.
+template <typename Predicate>
+uint32_t SpinRwLock(const pthread_rwlock_t *rwlock, Predicate done) {
+  uint32_t state = LoadRwLockState(rwlock);
+  for (int i = 0; i < kParkSpinIterations && !done(state); ++i) {
+    enc_pause();
+    state = LoadRwLockState(rwlock);
+  }
+  return state;
+}
+
+// Wakes the threads parked on |rwlock|, which has just been released and was
+// last seen in |state|. Either one writer or all readers are woken, the kind
+// preferred by |rwlock| first, falling back to the other kind if the host
+// reports that none of the preferred kind were parked. A waiting bit may
+// outlive the threads that set it, since a thread that sets it can take the
+// lock instead of parking. Once another thread takes the lock, waking is left
+// to that thread's unlock.
+void WakeWritersOrReaders(pthread_rwlock_t *rwlock, uint32_t state) {
+  int32_t *futex = GetUntrustedFutex(&rwlock->_futex);
+  if (!futex) {
+    // Threads only set the waiting bits once they have futex words to park
+    // on, so no thread is parked.
+    return;
+  }
+  const bool prefer_readers =
+      rwlock->_kind == PTHREAD_RWLOCK_PREFER_READER_NP;
+
+  while (IsUnlocked(state) && HasWaiters(state)) {
+    if (state == (kReadersWaiting | kWritersWaiting)) {
+      // Leave the bit of the kind that is not woken set, so that the threads
+      // of that kind are woken once the woken threads release the lock.
+      uint32_t still_waiting = prefer_readers ? kWritersWaiting
+                                              : kReadersWaiting;
+      if (!CompareAndSwapRwLockState(rwlock, &state, still_waiting)) {
+        continue;
+      }
+      bool woken = prefer_readers
+                       ? WakeFutex(&futex[kReadersFutex],
+                                           /*wake_all=*/true)
+                       : WakeFutex(&futex[kWritersFutex],
+                                           /*wake_all=*/false);
+      if (woken) {
+        return;
+      }
+      state = still_waiting;
+      continue;
+    }
+
+    // Only one kind of thread is waiting.
+    const bool readers_waiting = state == kReadersWaiting;
+    if (CompareAndSwapRwLockState(rwlock, &state, 0)) {
+      if (readers_waiting) {
+        WakeFutex(&futex[kReadersFutex], /*wake_all=*/true);
+      } else {
+        WakeFutex(&futex[kWritersFutex], /*wake_all=*/false);
+      }
+      return;
+    }
+  }
+}
+
+// Read locks |rwlock| if possible without blocking and returns 0. Returns EBUSY
+// if |rwlock| is write locked or, unless it prefers readers, if threads are
+// parked on it. Returns EAGAIN if it is held by the maximum number of readers.
+int pthread_rwlock_tryrdlock_internal(pthread_rwlock_t *rwlock) {
+  uint32_t state = LoadRwLockState(rwlock);
+  while (IsReadLockable(rwlock, state)) {
+    if (CompareAndSwapRwLockState(rwlock, &state, state + kReadLocked)) {
+      return 0;
+    }
+  }
+  return (state & kRwLockMask) == kMaxReaders ? EAGAIN : EBUSY;
+}
+
+// Write locks |rwlock| if possible without blocking and returns 0. Returns
+// EDEADLK if it is already write locked by the calling thread and EBUSY if it
+// is held by any other thread.
 int pthread_rwlock_trywrlock_internal(pthread_rwlock_t *rwlock) {
-  // If |rwlock| is owned by a reader it is not write lockable.
-  if (rwlock->_reader_count != 0) {
-    return EBUSY;
+  uint32_t state = LoadRwLockState(rwlock);
+  while (IsUnlocked(state)) {
+    if (CompareAndSwapRwLockState(rwlock, &state, state | kWriteLocked)) {
+      __atomic_store_n(&rwlock->_write_owner, pthread_self(),
+                       __ATOMIC_RELAXED);
+      return 0;
+    }
   }
+  return IsWriteOwner(rwlock, state) ? EDEADLK : EBUSY;
+}
 
-  // If |rwlock| is owned by the current thread there is a deadlock.
-  const pthread_t self = pthread_self();
-  if (rwlock->_write_owner == self) {
-    return EDEADLK;
+// Read locks |rwlock|, parking the calling thread on the readers futex while
+// it cannot be taken.
+int pthread_rwlock_rdlock_contended(pthread_rwlock_t *rwlock) {
+  int32_t *futex = GetUntrustedFutex(&rwlock->_futex);
+  auto may_proceed = [rwlock](uint32_t current) {
+    return IsReadLockable(rwlock, current) || HasWaiters(current);
+  };
+  uint32_t state = SpinRwLock(rwlock, may_proceed);
+
+  while (true) {
+    if (IsReadLockable(rwlock, state)) {
+      if (CompareAndSwapRwLockState(rwlock, &state, state + kReadLocked)) {
+        return 0;
+      }
+      continue;
+    }
+
+    if ((state & kRwLockMask) == kMaxReaders) {
+      return EAGAIN;
+    }
+    if (IsWriteOwner(rwlock, state)) {
+      return EDEADLK;
+    }
+
+    if (!futex) {
+      // Without futex words the thread cannot park, so it keeps spinning.
+      enc_pause();
+      state = LoadRwLockState(rwlock);
+      continue;
+    }
+
+    // Record that a reader is parked so the thread that releases the lock
+    // wakes the readers.
+    if ((state & kReadersWaiting) == 0 &&
+        !CompareAndSwapRwLockState(rwlock, &state, state | kReadersWaiting)) {
+      continue;
+    }
+
+    // Read the sequence number before re-checking the state, so that a wakeup
+    // that lands between the check and the wait makes the wait return at once.
+    int32_t sequence =
+        __atomic_load_n(&futex[kReadersFutex], __ATOMIC_SEQ_CST);
+    state = LoadRwLockState(rwlock);
+    if (IsReadLockable(rwlock, state) || (state & kReadersWaiting) == 0) {
+      continue;
+    }
+    enc_untrusted_sys_futex_wait(&futex[kReadersFutex], sequence);
+
+    state = SpinRwLock(rwlock, may_proceed);
   }
+}
 
-  // If |rwlock| is owned by another writer it is not write lockable.
-  if (rwlock->_write_owner != PTHREAD_T_NULL) {
-    return EBUSY;
+// Write locks |rwlock|, parking the calling thread on the writers futex while
+// it cannot be taken.
+int pthread_rwlock_wrlock_contended(pthread_rwlock_t *rwlock) {
+  int32_t *futex = GetUntrustedFutex(&rwlock->_futex);
+  auto may_proceed = [](uint32_t current) {
+    return IsUnlocked(current) || HasWaiters(current);
+  };
+  uint32_t state = SpinRwLock(rwlock, may_proceed);
+
+  // Once this thread has parked it cannot tell whether other writers are still
+  // parked, so it keeps kWritersWaiting set when it takes the lock.
+  uint32_t other_writers_waiting = 0;
+  while (true) {
+    if (IsUnlocked(state)) {
+      if (CompareAndSwapRwLockState(
+              rwlock, &state, state | kWriteLocked | other_writers_waiting)) {
+        __atomic_store_n(&rwlock->_write_owner, pthread_self(),
+                         __ATOMIC_RELAXED);
+        return 0;
+      }
+      continue;
+    }
+
+    if (IsWriteOwner(rwlock, state)) {
+      return EDEADLK;
+    }
+
+    if (!futex) {
+      enc_pause();
+      state = LoadRwLockState(rwlock);
+      continue;
+    }
+
+    if ((state & kWritersWaiting) == 0 &&
+        !CompareAndSwapRwLockState(rwlock, &state, state | kWritersWaiting)) {
+      continue;
+    }
+    other_writers_waiting = kWritersWaiting;
+
+    int32_t sequence =
+        __atomic_load_n(&futex[kWritersFutex], __ATOMIC_SEQ_CST);
+    state = LoadRwLockState(rwlock);
+    if (IsUnlocked(state) || (state & kWritersWaiting) == 0) {
+      continue;
+    }
+    enc_untrusted_sys_futex_wait(&futex[kWritersFutex], sequence);
+
+    state = SpinRwLock(rwlock, may_proceed);
   }
+}
 
-  // If the current thread is at the front of the queue or the queue is empty
-  // |rwlock| is write lockable.
-  asylo::pthread_impl::QueueOperations queue(rwlock);
-  if (queue.Empty() || queue.Front() == self) {
-    queue.Dequeue();
-    rwlock->_write_owner = self;
+// Runs the destructors of the keys the calling thread has non-null values for,
+// then releases the thread's storage for key values. Called when a thread
+// created by pthread_create exits.
+void RunThreadSpecificDestructors() {
+  for (int i = 0; i < kKeyDestructorIterations; ++i) {
+    bool called_destructor = false;
+    // A destructor may set values and grow the storage, so values are accessed
+    // by index rather than through a pointer held across destructor calls.
+    for (size_t key = 0; key < thread_specific.size; ++key) {
+      ThreadSpecificValue value = thread_specific.values[key];
+      if (value.value == nullptr) {
+        continue;
+      }
+      thread_specific.values[key].value = nullptr;
 
-    return 0;
+      const KeySlot &slot = key_slots[key];
+      if (value.sequence !=
+          __atomic_load_n(&slot.sequence, __ATOMIC_ACQUIRE)) {
+        // The key was deleted after the value was set.
+        continue;
+      }
+      void (*destructor)(void *) =
+          __atomic_load_n(&slot.destructor, __ATOMIC_ACQUIRE);
+      if (destructor != nullptr) {
+        destructor(const_cast<void *>(value.value));
+        called_destructor = true;
+      }
+    }
+    if (!called_destructor) {
+      break;
+    }
   }
 
-  return EBUSY;
+  free(thread_specific.values);
+  thread_specific = {nullptr, 0};
 }
 
 // Small utility function to "convert" a return value into an errno value. The
@@ -223,39 +585,6 @@ asylo::ThreadManager::ThreadOptions CreateOptions(
   return options;
 }
 
-// Acquires |rwlock| with a read lock or a write lock if |TryLockFunc| is
-// set to pthread_rwlock_tryrdlock_internal() or
-// pthread_rwlock_trywrlock_internal() respectively.
-template <int(TryLockFunc)(pthread_rwlock_t *)>
-int pthread_rwlock_lock(pthread_rwlock_t *rwlock) {
-  if (!asylo::IsValidEnclaveAddress<pthread_rwlock_t>(rwlock)) {
-    return ConvertToErrno(EFAULT);
-  }
-
-  LockableGuard lock_guard(rwlock);
-  int ret = TryLockFunc(rwlock);
-  if (ret == 0) {
-    return 0;
-  }
-
-  const pthread_t self = pthread_self();
-  asylo::pthread_impl::QueueOperations queue(rwlock);
-  if (queue.Contains(self)) {
-    return EDEADLK;
-  }
-  queue.Enqueue(self);
-
-  while (ret == EBUSY) {
-    lock_guard.Unlock();
-    enc_untrusted_sched_yield();
-    lock_guard.Lock();
-
-    ret = TryLockFunc(rwlock);
-  }
-
-  return ret;
-}
-
 }  // namespace
 
 namespace asylo {
@@ -362,8 +691,14 @@ int pthread_create(pthread_t *thread, const pthread_attr_t *attr,
                    void *(*start_routine)(void *), void *arg) {
   asylo::ThreadManager *const thread_manager =
       asylo::ThreadManager::GetInstance();
-  return thread_manager->CreateThread(std::bind(start_routine, arg),
-                                      CreateOptions(attr), thread);
+  auto run_thread = [start_routine, arg] {
+    // Pushed first so that key destructors run after every cleanup routine
+    // pushed by the thread, as POSIX requires.
+    asylo::ThreadManager::GetInstance()->PushCleanupRoutine(
+        RunThreadSpecificDestructors);
+    return start_routine(arg);
+  };
+  return thread_manager->CreateThread(run_thread, CreateOptions(attr), thread);
 }
 
 int pthread_join(pthread_t thread, void **value_ptr) {
@@ -378,48 +713,57 @@ int pthread_detach(pthread_t thread) {
   return thread_manager->DetachThread(thread);
 }
 
-bool assign_key(pthread_key_t *key) {
-  bool ret = false;
-  pthread_key_t next_key;
-  asylo::pthread_impl::PthreadMutexLock lock(&used_thread_keys_lock);
-  for (next_key = 0; next_key < PTHREAD_KEYS_MAX; next_key++) {
-    if (!used_thread_keys[next_key]) {
-      used_thread_keys[next_key] = true;
-      *key = next_key;
-      ret = true;
-      break;
+int pthread_key_create(pthread_key_t *key, void (*destructor)(void *)) {
+  for (pthread_key_t next_key = 0; next_key < PTHREAD_KEYS_MAX; next_key++) {
+    KeySlot *slot = &key_slots[next_key];
+    uint64_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_RELAXED);
+    if (IsKeyInUse(sequence) ||
+        !__atomic_compare_exchange_n(&slot->sequence, &sequence, sequence + 1,
+                                     /*weak=*/false, __ATOMIC_ACQ_REL,
+                                     __ATOMIC_RELAXED)) {
+      continue;
     }
+    // No thread can have a value for the key until it is returned, so the
+    // destructor is set before any thread can run it.
+    __atomic_store_n(&slot->destructor, destructor, __ATOMIC_RELEASE);
+    *key = next_key;
+    return 0;
   }
-  return ret;
-}
 
-int pthread_key_create(pthread_key_t *key, void (*destructor)(void *)) {
-  if (!assign_key(key)) {
-    // Limit on the total number of keys per process has been exceeded.
-    return EAGAIN;
-  }
-  return 0;
+  // Limit on the total number of keys per process has been exceeded.
+  return EAGAIN;
 }
 
 int pthread_key_delete(pthread_key_t key) {
-  if (key > PTHREAD_KEYS_MAX) {
+  if (key >= PTHREAD_KEYS_MAX) {
+    return EINVAL;
+  }
+  KeySlot *slot = &key_slots[key];
+  uint64_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_RELAXED);
+  if (!IsKeyInUse(sequence) ||
+      !__atomic_compare_exchange_n(&slot->sequence, &sequence, sequence + 1,
+                                   /*weak=*/false, __ATOMIC_ACQ_REL,
+                                   __ATOMIC_RELAXED)) {
     return EINVAL;
   }
-  asylo::pthread_impl::PthreadMutexLock lock(&used_thread_keys_lock);
-  used_thread_keys[key] = false;
   return 0;
 }
 
 void *pthread_getspecific(pthread_key_t key) {
   // Behavior if the key wasn't obtained through pthread_key_create is
   // undefined.
-  if (key >= PTHREAD_KEYS_MAX) {
+  if (key >= thread_specific.size) {
     return nullptr;
   }
 
-  // If the key is unset, this is to return nullptr. Because it is initialized
-  // to nullptr, there is no need to check if it has been previously set.
-  return const_cast<void *>(thread_specific[key]);
+  // Values that were never set are zero-initialized, so their sequence number
+  // never matches a key in use.
+  const ThreadSpecificValue &value = thread_specific.values[key];
+  if (value.sequence !=
+      __atomic_load_n(&key_slots[key].sequence, __ATOMIC_ACQUIRE)) {
+    return nullptr;
+  }
+  return const_cast<void *>(value.value);
 }
 
 int pthread_setspecific(pthread_key_t key, const void *value) {
@@ -428,10 +772,32 @@ int pthread_setspecific(pthread_key_t key, const void *value) {
   if (key >= PTHREAD_KEYS_MAX) {
     return EINVAL;
   }
+  uint64_t sequence =
+      __atomic_load_n(&key_slots[key].sequence, __ATOMIC_ACQUIRE);
+  if (!IsKeyInUse(sequence)) {
+    return EINVAL;
+  }
 
-  thread_specific[key] = value;
+  if (key >= thread_specific.size) {
+    // Grow geometrically, so that a thread setting many keys only reallocates
+    // a few times.
+    size_t size = std::max<size_t>(thread_specific.size * 2, 16);
+    size = std::min(std::max<size_t>(size, key + 1), PTHREAD_KEYS_MAX);
+    ThreadSpecificValue *values = static_cast<ThreadSpecificValue *>(
+        realloc(thread_specific.values, size * sizeof(ThreadSpecificValue)));
+    if (values == nullptr) {
+      return ENOMEM;
+    }
+    memset(values + thread_specific.size, 0,
+           (size - thread_specific.size) * sizeof(ThreadSpecificValue));
+    thread_specific.values = values;
+    thread_specific.size = size;
+  }
+
+  thread_specific.values[key] = {sequence, value};
   return 0;
 }
+
 // Initializes |mutex|, |attr| is unused.
 int pthread_mutex_init(pthread_mutex_t *mutex,
                        const pthread_mutexattr_t *attr) {
@@ -455,10 +821,12 @@ int pthread_mutex_destroy(pthread_mutex_t *mutex) {
     return EBUSY;
   }
 
+  FreeUntrustedFutex(&mutex->_futex);
   return 0;
 }
 
-// Locks |mutex|.
+// Locks |mutex|. Queued threads spin briefly, then park on the futex of
+// |mutex| until the owner releases it.
 int pthread_mutex_lock(pthread_mutex_t *mutex) {
   int ret = pthread_mutex_check_parameter(mutex);
   if (ret != 0) {
@@ -471,7 +839,12 @@ int pthread_mutex_lock(pthread_mutex_t *mutex) {
     list.Enqueue(pthread_self());
   }
 
-  while (true) {
+  int32_t *futex = nullptr;
+  for (int i = 0;; ++i) {
+    // Read the sequence before checking the mutex, so that an unlock between
+    // the check and the park changes the sequence and the park returns at
+    // once.
+    int32_t sequence = LoadFutexSequence(futex);
     {
       LockableGuard lock_guard(mutex);
       ret = pthread_mutex_lock_internal(mutex);
@@ -480,7 +853,18 @@ int pthread_mutex_lock(pthread_mutex_t *mutex) {
       return ret;
     }
 
-    enc_untrusted_sched_yield();
+    if (i < kParkSpinIterations) {
+      enc_pause();
+    } else if (!futex) {
+      // Allocate the futex words before checking the mutex again, so that the
+      // thread that releases it sees them.
+      futex = GetUntrustedFutex(&mutex->_futex);
+      if (!futex) {
+        enc_pause();
+      }
+    } else {
+      ParkOnFutex(futex, sequence, /*deadline=*/nullptr);
+    }
   }
 }
 
@@ -505,21 +889,32 @@ int pthread_mutex_unlock(pthread_mutex_t *mutex) {
 
   const pthread_t self = pthread_self();
 
-  LockableGuard lock_guard(mutex);
+  bool has_waiters = false;
+  {
+    LockableGuard lock_guard(mutex);
 
-  if (mutex->_owner == PTHREAD_T_NULL) {
-    return EINVAL;
-  }
+    if (mutex->_owner == PTHREAD_T_NULL) {
+      return EINVAL;
+    }
 
-  if (mutex->_owner != self) {
-    return EPERM;
-  }
+    if (mutex->_owner != self) {
+      return EPERM;
+    }
 
-  mutex->_refcount--;
-  if (mutex->_refcount == 0) {
-    mutex->_owner = PTHREAD_T_NULL;
+    mutex->_refcount--;
+    if (mutex->_refcount == 0) {
+      mutex->_owner = PTHREAD_T_NULL;
+      asylo::pthread_impl::QueueOperations list(mutex);
+      has_waiters = !list.Empty();
+    }
   }
 
+  // Only the thread at the front of the queue may take the mutex, and the host
+  // cannot wake a particular thread, so all parked threads are woken.
+  if (has_waiters) {
+    WakeFutex(__atomic_load_n(&mutex->_futex, __ATOMIC_ACQUIRE),
+              /*wake_all=*/true);
+  }
   return 0;
 }
 
@@ -555,6 +950,7 @@ int pthread_cond_destroy(pthread_cond_t *cond) {
     return EBUSY;
   }
 
+  FreeUntrustedFutex(&cond->_futex);
   return 0;
 }
 
@@ -582,6 +978,9 @@ int pthread_cond_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex,
 
   const pthread_t self = pthread_self();
 
+  // Allocate the futex words before joining the queue, so that the thread that
+  // signals |cond| sees them.
+  int32_t *futex = GetUntrustedFutex(&cond->_futex);
   asylo::pthread_impl::QueueOperations list(cond);
   {
     LockableGuard lock_guard(cond);
@@ -593,27 +992,23 @@ int pthread_cond_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex,
     return ret;
   }
 
-  while (true) {
-    enc_untrusted_sched_yield();
-
-    // If a deadline has been specified, check to see if it has passed.
-    if (deadline != nullptr) {
-      timespec curr_time;
-      ret = clock_gettime(CLOCK_REALTIME, &curr_time);
-      if (ret != 0) {
-        break;
-      }
-
-      // TimeSpecSubtract returns true if deadline < curr_time.
-      timespec time_left;
-      if (asylo::TimeSpecSubtract(*deadline, curr_time, &time_left)) {
-        ret = ETIMEDOUT;
+  for (int i = 0;; ++i) {
+    // Read the sequence before checking the queue, so that a signal between the
+    // check and the park changes the sequence and the park returns at once.
+    int32_t sequence = LoadFutexSequence(futex);
+    {
+      LockableGuard lock_guard(cond);
+      if (!list.Contains(self)) {
         break;
       }
     }
 
-    LockableGuard lock_guard(cond);
-    if (!list.Contains(self)) {
+    if (i < kParkSpinIterations) {
+      enc_pause();
+      continue;
+    }
+    ret = ParkOnFutex(futex, sequence, deadline);
+    if (ret != 0) {
       break;
     }
   }
@@ -649,14 +1044,20 @@ int pthread_cond_signal(pthread_cond_t *cond) {
     return EFAULT;
   }
 
-  LockableGuard lock_guard(cond);
-  asylo::pthread_impl::QueueOperations list(cond);
-  if (list.Empty()) {
-    return 0;
-  }
+  {
+    LockableGuard lock_guard(cond);
+    asylo::pthread_impl::QueueOperations list(cond);
+    if (list.Empty()) {
+      return 0;
+    }
 
-  list.Dequeue();
+    list.Dequeue();
+  }
 
+  // The host cannot wake the dequeued thread alone, so all parked threads are
+  // woken and the others park again.
+  WakeFutex(__atomic_load_n(&cond->_futex, __ATOMIC_ACQUIRE),
+            /*wake_all=*/true);
   return 0;
 }
 
@@ -669,9 +1070,14 @@ int pthread_cond_broadcast(pthread_cond_t *cond) {
   asylo::pthread_impl::QueueOperations list(cond);
   {
     LockableGuard lock_guard(cond);
+    if (list.Empty()) {
+      return 0;
+    }
     list.Clear();
   }
 
+  WakeFutex(__atomic_load_n(&cond->_futex, __ATOMIC_ACQUIRE),
+            /*wake_all=*/true);
   return 0;
 }
 
@@ -687,18 +1093,13 @@ int sem_init(sem_t *sem, const int pshared, const unsigned int value) {
     return ConvertToErrno(ENOSYS);
   }
 
-  sem->count_ = value;
-
-  int ret = pthread_mutex_init(&sem->mu_, nullptr);
-  if (ret != 0) {
-    return ConvertToErrno(ret);
-  }
-
-  ret = pthread_cond_init(&sem->cv_, nullptr);
-  if (ret != 0) {
-    return ConvertToErrno(ret);
+  if (value > SEM_VALUE_MAX) {
+    return ConvertToErrno(EINVAL);
   }
 
+  sem->count_ = value;
+  sem->waiters_ = 0;
+  sem->futex_ = nullptr;
   return 0;
 }
 
@@ -709,8 +1110,7 @@ int sem_getvalue(sem_t *sem, int *sval) {
     return ConvertToErrno(EFAULT);
   }
 
-  asylo::pthread_impl::PthreadMutexLock lock(&sem->mu_);
-  *sval = sem->count_;
+  *sval = __atomic_load_n(&sem->count_, __ATOMIC_ACQUIRE);
   return 0;
 }
 
@@ -720,9 +1120,35 @@ int sem_post(sem_t *sem) {
     return ConvertToErrno(EFAULT);
   }
 
-  asylo::pthread_impl::PthreadMutexLock lock(&sem->mu_);
-  sem->count_++;
-  return ConvertToErrno(pthread_cond_signal(&sem->cv_));
+  int count = __atomic_load_n(&sem->count_, __ATOMIC_RELAXED);
+  do {
+    if (count == SEM_VALUE_MAX) {
+      return ConvertToErrno(EOVERFLOW);
+    }
+  } while (!__atomic_compare_exchange_n(&sem->count_, &count, count + 1,
+                                        /*weak=*/true, __ATOMIC_SEQ_CST,
+                                        __ATOMIC_RELAXED));
+
+  // A waiter registers itself before its last check of the count, so it either
+  // sees the new count or is seen here.
+  if (__atomic_load_n(&sem->waiters_, __ATOMIC_SEQ_CST) > 0) {
+    WakeFutex(GetUntrustedFutex(&sem->futex_), /*wake_all=*/false);
+  }
+  return 0;
+}
+
+// Decrements the value of |sem| if it is positive. Returns true if the value
+// was decremented.
+bool SemTryDecrement(sem_t *sem) {
+  int count = __atomic_load_n(&sem->count_, __ATOMIC_RELAXED);
+  while (count > 0) {
+    if (__atomic_compare_exchange_n(&sem->count_, &count, count - 1,
+                                    /*weak=*/true, __ATOMIC_SEQ_CST,
+                                    __ATOMIC_RELAXED)) {
+      return true;
+    }
+  }
+  return false;
 }
 
 // Wait for |sem| to be unlocked until the time specified by |abs_timeout|. If
@@ -739,26 +1165,34 @@ int sem_timedwait(sem_t *sem, const timespec *abs_timeout) {
     return ConvertToErrno(EFAULT);
   }
 
-  asylo::pthread_impl::PthreadMutexLock lock(&sem->mu_);
+  // Spin briefly before exiting the enclave, since a post often follows soon.
+  for (int i = 0; i < kParkSpinIterations; ++i) {
+    if (SemTryDecrement(sem)) {
+      return 0;
+    }
+    enc_pause();
+  }
 
+  int32_t *futex = GetUntrustedFutex(&sem->futex_);
+  __atomic_fetch_add(&sem->waiters_, 1, __ATOMIC_SEQ_CST);
   int ret = 0;
-  while (sem->count_ == 0) {
-    ret = pthread_cond_timedwait(&sem->cv_, &sem->mu_, abs_timeout);
-
+  while (true) {
+    // Read the sequence before checking the count, so that a post between the
+    // check and the park changes the sequence and the park returns at once.
+    int32_t sequence = LoadFutexSequence(futex);
+    if (SemTryDecrement(sem)) {
+      break;
+    }
+    ret = ParkOnFutex(futex, sequence, abs_timeout);
     if (ret != 0) {
+      // A post may have raced with the timeout.
+      if (SemTryDecrement(sem)) {
+        ret = 0;
+      }
       break;
     }
   }
-
-  // If the pthread_cond_timedwait succeeds, reduce the semaphore count by one,
-  // unlock the mutex, and return any error that might arise from the unlocking.
-  if (ret == 0) {
-    sem->count_--;
-    return 0;
-  }
-
-  // pthread_cond_timedwait failed. We don't decrease the semaphore value and
-  // return whatever retval came from pthread_cond_timedwait.
+  __atomic_fetch_sub(&sem->waiters_, 1, __ATOMIC_SEQ_CST);
   return ConvertToErrno(ret);
 }
 
@@ -766,13 +1200,11 @@ int sem_timedwait(sem_t *sem, const timespec *abs_timeout) {
 int sem_wait(sem_t *sem) { return sem_timedwait(sem, nullptr); }
 
 int sem_trywait(sem_t *sem) {
-  struct timespec deadline = {0, 0};
-  int ret = sem_timedwait(sem, &deadline);
-  if (ret != 0 && errno == ETIMEDOUT) {
-    errno = EAGAIN;
+  if (!asylo::IsValidEnclaveAddress<sem_t>(sem)) {
+    return ConvertToErrno(EFAULT);
   }
 
-  return ret;
+  return ConvertToErrno(SemTryDecrement(sem) ? 0 : EAGAIN);
 }
 
 int sem_destroy(sem_t *sem) {
@@ -780,16 +1212,154 @@ int sem_destroy(sem_t *sem) {
     return ConvertToErrno(EFAULT);
   }
 
-  int ret = pthread_cond_destroy(&sem->cv_);
-  if (ret != 0) {
-    return ConvertToErrno(ret);
+  if (__atomic_load_n(&sem->waiters_, __ATOMIC_ACQUIRE) > 0) {
+    return ConvertToErrno(EBUSY);
   }
 
-  ret = pthread_mutex_destroy(&sem->mu_);
-  if (ret != 0) {
-    return ConvertToErrno(ret);
+  FreeUntrustedFutex(&sem->futex_);
+  return 0;
+}
+
+// The state of a pthread_barrier_t packs the number of completed cycles of the
+// barrier into its upper 32 bits and the number of threads that have arrived
+// in the current cycle into its lower 32 bits, so that a thread can arrive and
+// learn which cycle it arrived in with a single atomic operation.
+constexpr int kBarrierCycleShift = 32;
+constexpr uint64_t kBarrierArrivedMask =
+    (uint64_t{1} << kBarrierCycleShift) - 1;
+
+int pthread_barrierattr_init(pthread_barrierattr_t *attr) {
+  if (!asylo::IsValidEnclaveAddress<pthread_barrierattr_t>(attr)) {
+    return EFAULT;
+  }
+  return 0;
+}
+
+int pthread_barrierattr_destroy(pthread_barrierattr_t *attr) {
+  if (!asylo::IsValidEnclaveAddress<pthread_barrierattr_t>(attr)) {
+    return EFAULT;
+  }
+  return 0;
+}
+
+int pthread_barrier_init(pthread_barrier_t *barrier,
+                         const pthread_barrierattr_t *attr, unsigned count) {
+  if (!asylo::IsValidEnclaveAddress<pthread_barrier_t>(barrier)) {
+    return EFAULT;
+  }
+  if (attr != nullptr &&
+      !asylo::IsValidEnclaveAddress<pthread_barrierattr_t>(attr)) {
+    return EFAULT;
+  }
+  if (count == 0) {
+    return EINVAL;
+  }
+
+  barrier->_state = 0;
+  barrier->_count = count;
+  barrier->_futex = nullptr;
+  return 0;
+}
+
+int pthread_barrier_destroy(pthread_barrier_t *barrier) {
+  if (!asylo::IsValidEnclaveAddress<pthread_barrier_t>(barrier)) {
+    return EFAULT;
+  }
+
+  // Threads still waiting for the current cycle would never be released.
+  if ((__atomic_load_n(&barrier->_state, __ATOMIC_ACQUIRE) &
+       kBarrierArrivedMask) != 0) {
+    return EBUSY;
+  }
+
+  FreeUntrustedFutex(&barrier->_futex);
+  return 0;
+}
+
+// Blocks until |barrier->_count| threads have called pthread_barrier_wait on
+// |barrier|. Returns PTHREAD_BARRIER_SERIAL_THREAD to the last thread to
+// arrive and 0 to the others.
+int pthread_barrier_wait(pthread_barrier_t *barrier) {
+  if (!asylo::IsValidEnclaveAddress<pthread_barrier_t>(barrier)) {
+    return EFAULT;
+  }
+
+  // Allocate the futex words before arriving, so that the last thread to
+  // arrive cannot free them through pthread_barrier_destroy while another
+  // thread is still allocating them.
+  int32_t *futex = GetUntrustedFutex(&barrier->_futex);
+  uint64_t state = __atomic_add_fetch(&barrier->_state, 1, __ATOMIC_SEQ_CST);
+  uint64_t cycle = state >> kBarrierCycleShift;
+  if ((state & kBarrierArrivedMask) == barrier->_count) {
+    // Start the next cycle and release the threads waiting on this one.
+    __atomic_store_n(&barrier->_state, (cycle + 1) << kBarrierCycleShift,
+                     __ATOMIC_SEQ_CST);
+    WakeFutex(futex, /*wake_all=*/true);
+    return PTHREAD_BARRIER_SERIAL_THREAD;
+  }
+
+  auto released = [barrier, cycle] {
+    return (__atomic_load_n(&barrier->_state, __ATOMIC_SEQ_CST) >>
+            kBarrierCycleShift) != cycle;
+  };
+  for (int i = 0; i < kParkSpinIterations; ++i) {
+    if (released()) {
+      return 0;
+    }
+    enc_pause();
+  }
+  while (true) {
+    int32_t sequence = LoadFutexSequence(futex);
+    if (released()) {
+      return 0;
+    }
+    ParkOnFutex(futex, sequence, /*deadline=*/nullptr);
+  }
+}
+
+int pthread_rwlockattr_init(pthread_rwlockattr_t *attr) {
+  if (!asylo::IsValidEnclaveAddress<pthread_rwlockattr_t>(attr)) {
+    return EFAULT;
+  }
+
+  attr->_kind = PTHREAD_RWLOCK_DEFAULT_NP;
+  return 0;
+}
+
+int pthread_rwlockattr_destroy(pthread_rwlockattr_t *attr) {
+  if (!asylo::IsValidEnclaveAddress<pthread_rwlockattr_t>(attr)) {
+    return EFAULT;
+  }
+  return 0;
+}
+
+// Sets the fairness policy of the rwlocks initialized with |attr|. Locks that
+// prefer readers admit new readers whenever no writer holds the lock, which
+// allows recursive read locking but may starve writers. Locks that prefer
+// writers, the default, queue new readers behind parked writers.
+int pthread_rwlockattr_setkind_np(pthread_rwlockattr_t *attr, int pref) {
+  if (!asylo::IsValidEnclaveAddress<pthread_rwlockattr_t>(attr)) {
+    return EFAULT;
   }
 
+  if (pref != PTHREAD_RWLOCK_PREFER_READER_NP &&
+      pref != PTHREAD_RWLOCK_PREFER_WRITER_NP &&
+      pref != PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP) {
+    return EINVAL;
+  }
+
+  attr->_kind = pref;
+  return 0;
+}
+
+int pthread_rwlockattr_getkind_np(const pthread_rwlockattr_t *attr,
+                                  int *pref) {
+  if (!asylo::IsValidEnclaveAddress<pthread_rwlockattr_t>(attr) ||
+      !asylo::IsValidEnclaveAddress<int>(pref)) {
+    return EFAULT;
+  }
+
+  *pref = attr->_kind;
   return 0;
 }
 
@@ -800,6 +1370,9 @@ int pthread_rwlock_init(pthread_rwlock_t *rwlock,
   }
 
   *rwlock = PTHREAD_RWLOCK_INITIALIZER;
+  if (attr != nullptr) {
+    rwlock->_kind = attr->_kind;
+  }
 
   return 0;
 }
@@ -809,7 +1382,6 @@ int pthread_rwlock_tryrdlock(pthread_rwlock_t *rwlock) {
     return ConvertToErrno(EFAULT);
   }
 
-  LockableGuard lock_guard(rwlock);
   return pthread_rwlock_tryrdlock_internal(rwlock);
 }
 
@@ -818,16 +1390,34 @@ int pthread_rwlock_trywrlock(pthread_rwlock_t *rwlock) {
     return ConvertToErrno(EFAULT);
   }
 
-  LockableGuard lock_guard(rwlock);
   return pthread_rwlock_trywrlock_internal(rwlock);
 }
 
 int pthread_rwlock_rdlock(pthread_rwlock_t *rwlock) {
-  return pthread_rwlock_lock<pthread_rwlock_tryrdlock_internal>(rwlock);
+  if (!asylo::IsValidEnclaveAddress<pthread_rwlock_t>(rwlock)) {
+    return ConvertToErrno(EFAULT);
+  }
+
+  // Take the lock without leaving the enclave if it is free for readers.
+  uint32_t state = LoadRwLockState(rwlock);
+  if (IsReadLockable(rwlock, state) &&
+      CompareAndSwapRwLockState(rwlock, &state, state + kReadLocked)) {
+    return 0;
+  }
+  return pthread_rwlock_rdlock_contended(rwlock);
 }
 
 int pthread_rwlock_wrlock(pthread_rwlock_t *rwlock) {
-  return pthread_rwlock_lock<pthread_rwlock_trywrlock_internal>(rwlock);
+  if (!asylo::IsValidEnclaveAddress<pthread_rwlock_t>(rwlock)) {
+    return ConvertToErrno(EFAULT);
+  }
+
+  uint32_t state = 0;
+  if (CompareAndSwapRwLockState(rwlock, &state, kWriteLocked)) {
+    __atomic_store_n(&rwlock->_write_owner, pthread_self(), __ATOMIC_RELAXED);
+    return 0;
+  }
+  return pthread_rwlock_wrlock_contended(rwlock);
 }
 
 int pthread_rwlock_unlock(pthread_rwlock_t *rwlock) {
@@ -835,15 +1425,26 @@ int pthread_rwlock_unlock(pthread_rwlock_t *rwlock) {
     return ConvertToErrno(EFAULT);
   }
 
-  LockableGuard lock_guard(rwlock);
-
-  const pthread_t self = pthread_self();
-  if (rwlock->_write_owner == self) {
-    rwlock->_write_owner = PTHREAD_T_NULL;
-    return 0;
+  uint32_t state = LoadRwLockState(rwlock);
+  if (IsWriteLocked(state)) {
+    if (!IsWriteOwner(rwlock, state)) {
+      return EPERM;
+    }
+    __atomic_store_n(&rwlock->_write_owner, PTHREAD_T_NULL, __ATOMIC_RELAXED);
+    state = __atomic_sub_fetch(&rwlock->_state, kWriteLocked,
+                               __ATOMIC_SEQ_CST);
+  } else {
+    if (IsUnlocked(state)) {
+      return EPERM;
+    }
+    state = __atomic_sub_fetch(&rwlock->_state, kReadLocked, __ATOMIC_SEQ_CST);
   }
 
-  rwlock->_reader_count--;
+  // Only the thread that leaves the lock free wakes parked threads. A reader
+  // that is not the last out leaves that to the last reader.
+  if (IsUnlocked(state) && HasWaiters(state)) {
+    WakeWritersOrReaders(rwlock, state);
+  }
   return 0;
 }
 
@@ -852,13 +1453,12 @@ int pthread_rwlock_destroy(pthread_rwlock_t *rwlock) {
     return ConvertToErrno(EFAULT);
   }
 
-  LockableGuard lock_guard(rwlock);
-  asylo::pthread_impl::QueueOperations queue(rwlock);
-  if (rwlock->_write_owner == PTHREAD_T_NULL && queue.Empty()) {
-    return 0;
+  if (LoadRwLockState(rwlock) != 0) {
+    return EBUSY;
   }
 
-  return EBUSY;
+  FreeUntrustedFutex(&rwlock->_futex);
+  return 0;
 }
 
 int pthread_equal(pthread_t thread_one, pthread_t thread_two) {
@@ -195,6 +195,8 @@ struct servent *getservbyport(int port, const char *proto) {
   abort();
 }
 
-int socketpair(int domain, int type, int protocol, int sv[2]) { abort(); }
+int socketpair(int domain, int type, int protocol, int sv[2]) {
+  return IOManager::GetInstance().SocketPair(domain, type, protocol, sv);
+}
 
 }  // extern "C"
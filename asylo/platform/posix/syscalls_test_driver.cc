@@ -901,6 +901,22 @@ TEST_F(SyscallsTest, Readv) {
       IsOk());
 }
 
+// Tests pwrite() and pread() by writing a message at an offset and reading it
+// back, checking that neither call moves the file cursor.
+TEST_F(SyscallsTest, PRead) {
+  EXPECT_THAT(
+      RunSyscallInsideEnclave("pread", FLAGS_test_tmpdir + "/pread", nullptr),
+      IsOk());
+}
+
+// Tests pwritev() and preadv() by writing a scattered array at an offset and
+// reading it back into differently split buffers.
+TEST_F(SyscallsTest, PReadv) {
+  EXPECT_THAT(
+      RunSyscallInsideEnclave("preadv", FLAGS_test_tmpdir + "/preadv", nullptr),
+      IsOk());
+}
+
 // Tests getrlimit() and setrlimit() with RLIMIT_NOFILE by setting the limit and
 // getting it to compare the result.
 TEST_F(SyscallsTest, RlimitNoFile) {
@@ -926,6 +942,23 @@ TEST_F(SyscallsTest, RlimitInvalidNoFile) {
               IsOk());
 }
 
+// Tests setrlimit() with RLIMIT_NOFILE by raising the limit above the default,
+// and checking that file descriptors beyond the default limit can be used.
+TEST_F(SyscallsTest, RlimitHighNoFile) {
+  EXPECT_THAT(RunSyscallInsideEnclave("rlimit high nofile",
+                                      FLAGS_test_tmpdir + "/rlimit", nullptr),
+              IsOk());
+}
+
+// Tests that dup(), dup2(), fcntl(F_DUPFD) and close() fail with EBADF on file
+// descriptors that are out of range or not open.
+TEST_F(SyscallsTest, InvalidFileDescriptor) {
+  EXPECT_THAT(RunSyscallInsideEnclave("invalid fd",
+                                      FLAGS_test_tmpdir + "/invalid_fd",
+                                      nullptr),
+              IsOk());
+}
+
 // Tests chmod() by changing the mode of a file inside an enclave, and verifies
 // the mode is changed correctly.
 TEST_F(SyscallsTest, ChMod) {
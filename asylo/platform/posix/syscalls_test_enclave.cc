@@ -112,12 +112,20 @@ class SyscallsEnclave : public EnclaveTestCase {
       return RunWritevTest(test_input.path_name());
     } else if (test_input.test_target() == "readv") {
       return RunReadvTest(test_input.path_name());
+    } else if (test_input.test_target() == "pread") {
+      return RunPReadTest(test_input.path_name());
+    } else if (test_input.test_target() == "preadv") {
+      return RunPReadvTest(test_input.path_name());
     } else if (test_input.test_target() == "rlimit nofile") {
       return RunRlimitNoFileTest(test_input.path_name());
     } else if (test_input.test_target() == "rlimit low nofile") {
       return RunRlimitLowNoFileTest(test_input.path_name());
     } else if (test_input.test_target() == "rlimit invalid nofile") {
       return RunRlimitInvalidNoFileTest(test_input.path_name());
+    } else if (test_input.test_target() == "rlimit high nofile") {
+      return RunRlimitHighNoFileTest(test_input.path_name());
+    } else if (test_input.test_target() == "invalid fd") {
+      return RunInvalidFileDescriptorTest(test_input.path_name());
     } else if (test_input.test_target() == "chmod") {
       return RunChModTest(test_input.path_name());
     } else if (test_input.test_target() == "getifaddrs") {
@@ -946,6 +954,98 @@ class SyscallsEnclave : public EnclaveTestCase {
     return Status::OkStatus();
   }
 
+  // Returns an error unless the cursor of |fd| is at the start of the file.
+  Status CheckCursorAtStart(int fd) {
+    off_t position = lseek(fd, 0, SEEK_CUR);
+    if (position != 0) {
+      return Status(error::GoogleError::INTERNAL,
+                    absl::StrCat("Cursor of fd:", fd, " moved to ", position));
+    }
+    return Status::OkStatus();
+  }
+
+  Status RunPReadTest(const std::string &path) {
+    int fd;
+    ASYLO_ASSIGN_OR_RETURN(fd, OpenFile(path, O_CREAT | O_RDWR, 0644));
+    platform::storage::FdCloser fd_closer(fd);
+    const std::string message = "pread and pwrite message";
+    constexpr off_t offset = 10;
+    ssize_t rc = pwrite(fd, message.c_str(), message.size(), offset);
+    if (rc != message.size()) {
+      return Status(static_cast<error::PosixError>(errno),
+                    absl::StrCat("pwrite return:", rc,
+                                 " does not match message size:",
+                                 message.size()));
+    }
+    ASYLO_RETURN_IF_ERROR(CheckCursorAtStart(fd));
+
+    char buf[1024];
+    rc = pread(fd, buf, message.size(), offset);
+    if (rc != message.size()) {
+      return Status(static_cast<error::PosixError>(errno),
+                    absl::StrCat("pread return:", rc,
+                                 " does not match message size:",
+                                 message.size()));
+    }
+    if (memcmp(buf, message.c_str(), message.size()) != 0) {
+      return Status(error::GoogleError::INTERNAL,
+                    "Message from pread does not match the message of pwrite.");
+    }
+    ASYLO_RETURN_IF_ERROR(CheckCursorAtStart(fd));
+
+    if (pread(fd, buf, sizeof(buf), -1) != -1 || errno != EINVAL) {
+      return Status(error::GoogleError::INTERNAL,
+                    "pread with a negative offset did not fail with EINVAL");
+    }
+    return Status::OkStatus();
+  }
+
+  Status RunPReadvTest(const std::string &path) {
+    int fd;
+    ASYLO_ASSIGN_OR_RETURN(fd, OpenFile(path, O_CREAT | O_RDWR, 0644));
+    platform::storage::FdCloser fd_closer(fd);
+    constexpr int num_messages = 2;
+    const std::string message1 = "First pwritev message";
+    const std::string message2 = "Second pwritev message";
+    constexpr off_t offset = 10;
+    struct iovec iov[num_messages];
+    memset(iov, 0, sizeof(iov));
+    iov[0].iov_base = const_cast<char *>(message1.c_str());
+    iov[1].iov_base = const_cast<char *>(message2.c_str());
+    iov[0].iov_len = message1.size();
+    iov[1].iov_len = message2.size();
+    size_t size = message1.size() + message2.size();
+    ssize_t rc = pwritev(fd, iov, num_messages, offset);
+    if (rc != size) {
+      return Status(static_cast<error::PosixError>(errno),
+                    absl::StrCat("pwritev return:", rc,
+                                 " does not match message size:", size));
+    }
+    ASYLO_RETURN_IF_ERROR(CheckCursorAtStart(fd));
+
+    // Read the messages back into buffers split at a different point.
+    char buf1[message1.size() + 1];
+    char buf2[message2.size() - 1];
+    iov[0].iov_base = reinterpret_cast<void *>(buf1);
+    iov[1].iov_base = reinterpret_cast<void *>(buf2);
+    iov[0].iov_len = sizeof(buf1);
+    iov[1].iov_len = sizeof(buf2);
+    rc = preadv(fd, iov, num_messages, offset);
+    if (rc != size) {
+      return Status(static_cast<error::PosixError>(errno),
+                    absl::StrCat("preadv return:", rc,
+                                 " does not match message size:", size));
+    }
+    std::string message = absl::StrCat(
+        absl::string_view(buf1, sizeof(buf1)),
+        absl::string_view(buf2, sizeof(buf2)));
+    if (message != message1 + message2) {
+      return Status(error::GoogleError::INTERNAL,
+                    "Messages from preadv do not match the expected message.");
+    }
+    return CheckCursorAtStart(fd);
+  }
+
   Status RunRlimitNoFileTest(const std::string &path) {
     constexpr int soft_limit = 100;
     constexpr int hard_limit = 200;
@@ -1027,8 +1127,8 @@ class SyscallsEnclave : public EnclaveTestCase {
 
     // setrlimit should fail if the limit is set to be greater than the maximum
     // allowed file descriptor number inside the enclave.
-    set_limit.rlim_cur = 2000;
-    set_limit.rlim_max = 2000;
+    set_limit.rlim_cur = 1 << 20;
+    set_limit.rlim_max = 1 << 20;
     if (setrlimit(RLIMIT_NOFILE, &set_limit) != -1) {
       return Status(error::GoogleError::INTERNAL,
                     "setrlimit with limit higher than the maximum allowed "
@@ -1065,6 +1165,82 @@ class SyscallsEnclave : public EnclaveTestCase {
     return Status::OkStatus();
   }
 
+  Status RunRlimitHighNoFileTest(const std::string &path) {
+    constexpr int limit = 4096;
+    constexpr int high_fd = 3000;
+    int fd;
+    ASYLO_ASSIGN_OR_RETURN(fd, OpenFile(path, O_CREAT | O_RDWR, 0644));
+    // File descriptors beyond the default soft limit are not available until
+    // the limit is raised.
+    if (fcntl(fd, F_DUPFD, high_fd) != -1 || errno != EINVAL) {
+      return Status(error::GoogleError::INTERNAL,
+                    "fcntl F_DUPFD beyond the soft limit succeeded");
+    }
+    struct rlimit set_limit;
+    set_limit.rlim_cur = limit;
+    set_limit.rlim_max = limit;
+    if (setrlimit(RLIMIT_NOFILE, &set_limit) != 0) {
+      return Status(static_cast<error::PosixError>(errno),
+                    absl::StrCat("setrlimit failed:", strerror(errno)));
+    }
+    int dup_fd = fcntl(fd, F_DUPFD, high_fd);
+    if (dup_fd != high_fd) {
+      return Status(error::GoogleError::INTERNAL,
+                    absl::StrCat("fcntl F_DUPFD returned ", dup_fd,
+                                 " instead of ", high_fd));
+    }
+    if (close(fd) != 0) {
+      return Status(static_cast<error::PosixError>(errno),
+                    absl::StrCat("close failed:", strerror(errno)));
+    }
+    const std::string message = path;
+    size_t rc = write(dup_fd, message.c_str(), message.size());
+    if (rc != message.size()) {
+      return Status(static_cast<error::PosixError>(errno),
+                    absl::StrCat("write to fd:", dup_fd,
+                                 " failed: ", strerror(errno)));
+    }
+    if (close(dup_fd) != 0) {
+      return Status(static_cast<error::PosixError>(errno),
+                    absl::StrCat("close failed:", strerror(errno)));
+    }
+    return Status::OkStatus();
+  }
+
+  // Returns an error unless |result| is -1 and errno is EBADF.
+  Status CheckBadFileDescriptor(int result, const std::string &call) {
+    if (result != -1 || errno != EBADF) {
+      return Status(error::GoogleError::INTERNAL,
+                    absl::StrCat(call, " returned ", result,
+                                 " instead of failing with EBADF"));
+    }
+    return Status::OkStatus();
+  }
+
+  Status RunInvalidFileDescriptorTest(const std::string &path) {
+    constexpr int out_of_range_fd = 1 << 20;
+    ASYLO_RETURN_IF_ERROR(CheckBadFileDescriptor(dup(-1), "dup(-1)"));
+    ASYLO_RETURN_IF_ERROR(
+        CheckBadFileDescriptor(dup(out_of_range_fd), "dup(out of range)"));
+    ASYLO_RETURN_IF_ERROR(
+        CheckBadFileDescriptor(dup2(-1, 10), "dup2(-1, 10)"));
+    ASYLO_RETURN_IF_ERROR(CheckBadFileDescriptor(fcntl(-5, F_DUPFD, 0),
+                                                 "fcntl(-5, F_DUPFD, 0)"));
+    ASYLO_RETURN_IF_ERROR(CheckBadFileDescriptor(close(-1), "close(-1)"));
+    ASYLO_RETURN_IF_ERROR(
+        CheckBadFileDescriptor(close(out_of_range_fd), "close(out of range)"));
+
+    int fd;
+    ASYLO_ASSIGN_OR_RETURN(fd, OpenFile(path, O_CREAT | O_RDWR, 0644));
+    if (close(fd) != 0) {
+      return Status(static_cast<error::PosixError>(errno),
+                    absl::StrCat("close failed:", strerror(errno)));
+    }
+    ASYLO_RETURN_IF_ERROR(
+        CheckBadFileDescriptor(close(fd), "close of a closed fd"));
+    return CheckBadFileDescriptor(dup(fd), "dup of a closed fd");
+  }
+
   Status RunChModTest(const std::string &path) {
     if (chmod(path.c_str(), 0644) != 0) {
       return Status(static_cast<error::PosixError>(errno),
@@ -43,6 +43,14 @@ int chown(const char *path, uid_t owner, gid_t group) {
   return IOManager::GetInstance().Chown(path, owner, group);
 }
 
+ssize_t pread(int fd, void *buf, size_t count, off_t offset) {
+  return IOManager::GetInstance().PRead(fd, buf, count, offset);
+}
+
+ssize_t pwrite(int fd, const void *buf, size_t count, off_t offset) {
+  return IOManager::GetInstance().PWrite(fd, buf, count, offset);
+}
+
 ssize_t readlink(const char *path_name, char *buf, size_t bufsize) {
   return IOManager::GetInstance().ReadLink(path_name, buf, bufsize);
 }
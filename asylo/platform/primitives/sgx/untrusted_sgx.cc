@@ -22,6 +22,8 @@
 #include <unistd.h>
 #include <cstdlib>
 
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "asylo/platform/primitives/sgx/sgx_error_space.h"
 #include "asylo/platform/primitives/untrusted_primitives.h"
 #include "asylo/util/elf_reader.h"
@@ -65,6 +67,11 @@ struct ms_ecall_dispatch_trusted_call_t {
   void* ms_buffer;
 };
 
+// Returns the nanoseconds elapsed since |start|.
+int64_t NanosecondsSince(absl::Time start) {
+  return absl::ToInt64Nanoseconds(absl::Now() - start);
+}
+
 }  // namespace
 
 SgxEnclaveClient::~SgxEnclaveClient() = default;
@@ -72,11 +79,13 @@ SgxEnclaveClient::~SgxEnclaveClient() = default;
 StatusOr<std::shared_ptr<Client>> SgxBackend::Load(
     void *base_address, absl::string_view enclave_path, size_t enclave_size,
     const EnclaveConfig &config, bool debug,
-    std::unique_ptr<Client::ExitCallProvider> exit_call_provider) {
+    std::unique_ptr<Client::ExitCallProvider> exit_call_provider,
+    EnclaveLoadTrace *trace) {
   std::shared_ptr<SgxEnclaveClient> client(
       new SgxEnclaveClient(std::move(exit_call_provider)));
   client->base_address_ = base_address;
 
+  absl::Time creation_start = absl::Now();
   int updated;
   sgx_status_t status;
   const uint32_t ex_features = SGX_CREATE_ENCLAVE_EX_ASYLO;
@@ -99,6 +108,9 @@ StatusOr<std::shared_ptr<Client>> SgxBackend::Load(
       break;
     }
   }
+  if (trace) {
+    trace->set_enclave_creation_ns(NanosecondsSince(creation_start));
+  }
 
   if (status != SGX_SUCCESS) {
     return Status(status, "Failed to create an enclave");
@@ -111,7 +123,8 @@ StatusOr<std::shared_ptr<Client>> SgxBackend::Load(
 StatusOr<std::shared_ptr<Client>> SgxEmbeddedBackend::Load(
     void *base_address, absl::string_view section_name, size_t enclave_size,
     const EnclaveConfig &config, bool debug,
-    std::unique_ptr<Client::ExitCallProvider> exit_call_provider) {
+    std::unique_ptr<Client::ExitCallProvider> exit_call_provider,
+    EnclaveLoadTrace *trace) {
   std::shared_ptr<SgxEnclaveClient> client(
       new SgxEnclaveClient(std::move(exit_call_provider)));
   client->base_address_ = base_address;
@@ -125,10 +138,15 @@ StatusOr<std::shared_ptr<Client>> SgxEmbeddedBackend::Load(
                   "Failed to reserve enclave memory");
   }
 
+  absl::Time mapping_start = absl::Now();
   FileMapping self_binary_mapping;
   ASYLO_ASSIGN_OR_RETURN(self_binary_mapping, FileMapping::CreateFromFile(
                                                   kCallingProcessBinaryFile));
+  if (trace) {
+    trace->set_file_mapping_ns(NanosecondsSince(mapping_start));
+  }
 
+  absl::Time lookup_start = absl::Now();
   ElfReader self_binary_reader;
   ASYLO_ASSIGN_OR_RETURN(self_binary_reader, ElfReader::CreateFromSpan(
                                                  self_binary_mapping.buffer()));
@@ -136,6 +154,9 @@ StatusOr<std::shared_ptr<Client>> SgxEmbeddedBackend::Load(
   absl::Span<const uint8_t> enclave_buffer;
   ASYLO_ASSIGN_OR_RETURN(enclave_buffer, self_binary_reader.GetSectionData(
                                              std::string(section_name)));
+  if (trace) {
+    trace->set_elf_section_lookup_ns(NanosecondsSince(lookup_start));
+  }
 
   if (base_address && enclave_size > 0 &&
       munmap(base_address, enclave_size) < 0) {
@@ -143,6 +164,7 @@ StatusOr<std::shared_ptr<Client>> SgxEmbeddedBackend::Load(
                   "Failed to release enclave memory");
   }
 
+  absl::Time creation_start = absl::Now();
   sgx_status_t status;
   const uint32_t ex_features = SGX_CREATE_ENCLAVE_EX_ASYLO;
   asylo_sgx_config_t create_config = {
@@ -162,6 +184,9 @@ StatusOr<std::shared_ptr<Client>> SgxEmbeddedBackend::Load(
       break;
     }
   }
+  if (trace) {
+    trace->set_enclave_creation_ns(NanosecondsSince(creation_start));
+  }
 
   client->size_ = sgx_enclave_size(client->id_);
 
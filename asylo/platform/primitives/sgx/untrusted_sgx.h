@@ -34,11 +34,13 @@ namespace primitives {
 // from the file system.
 struct SgxBackend {
   // Loads an SGX enclave and returns a client to the loaded enclave or an
-  // error status on failure.
+  // error status on failure. If |trace| is not null, the time spent creating
+  // the enclave is recorded in it.
   static StatusOr<std::shared_ptr<Client>> Load(
       void *base_address, absl::string_view enclave_path, size_t enclave_size,
       const EnclaveConfig &config, bool debug,
-      std::unique_ptr<Client::ExitCallProvider> exit_call_provider);
+      std::unique_ptr<Client::ExitCallProvider> exit_call_provider,
+      EnclaveLoadTrace *trace = nullptr);
 };
 
 // Implementation of the generic "EnclaveBackend" concept for Intel Software
@@ -46,11 +48,14 @@ struct SgxBackend {
 // process.
 struct SgxEmbeddedBackend {
   // Loads an embedded SGX enclave and returns a client to the loaded enclave or
-  // an error status on failure.
+  // an error status on failure. If |trace| is not null, the time spent mapping
+  // the binary, finding the enclave section and creating the enclave is
+  // recorded in it.
   static StatusOr<std::shared_ptr<Client>> Load(
       void *base_address, absl::string_view section_name, size_t enclave_size,
       const EnclaveConfig &config, bool debug,
-      std::unique_ptr<Client::ExitCallProvider> exit_call_provider);
+      std::unique_ptr<Client::ExitCallProvider> exit_call_provider,
+      EnclaveLoadTrace *trace = nullptr);
 };
 
 // SGX implementation of Client.
@@ -23,8 +23,10 @@
 // IO syscall interface constants.
 #include <fcntl.h>
 
+#include <algorithm>
 #include <iomanip>
 #include <memory>
+#include <vector>
 
 #include "absl/strings/escaping.h"
 #include "absl/synchronization/mutex.h"
@@ -101,6 +103,55 @@ ssize_t write_all(int fd, const void *buf, size_t len) {
   return offset;
 }
 
+// Similar to read_all, but reads from |offset| without using the cursor.
+ssize_t read_all_at(int fd, void *buf, size_t len, off_t offset) {
+  size_t bytes_to_read = len;
+  size_t bytes_done = 0;
+
+  while (bytes_to_read > 0) {
+    ssize_t bytes_read;
+    do {
+      bytes_read = enc_untrusted_pread64(
+          fd, static_cast<uint8_t *>(buf) + bytes_done, bytes_to_read,
+          offset + bytes_done);
+    } while ((bytes_read == -1) && is_transient_error(errno));
+    if (bytes_read == -1) {
+      return -1;
+    }
+    if (bytes_read == 0) {
+      return bytes_done;
+    }
+
+    bytes_to_read -= bytes_read;
+    bytes_done += bytes_read;
+  }
+
+  return bytes_done;
+}
+
+// Similar to write_all, but writes at |offset| without using the cursor.
+ssize_t write_all_at(int fd, const void *buf, size_t len, off_t offset) {
+  size_t bytes_to_write = len;
+  size_t bytes_done = 0;
+
+  while (bytes_to_write > 0) {
+    ssize_t bytes_written;
+    do {
+      bytes_written = enc_untrusted_pwrite64(
+          fd, static_cast<const uint8_t *>(buf) + bytes_done, bytes_to_write,
+          offset + bytes_done);
+    } while ((bytes_written == -1) && is_transient_error(errno));
+    if (bytes_written == -1) {
+      return -1;
+    }
+
+    bytes_to_write -= bytes_written;
+    bytes_done += bytes_written;
+  }
+
+  return bytes_done;
+}
+
 // Returns offset to the plaintext buffer associated with the |block_index| of
 // a full block.
 const uint8_t *GetPlaintextBuffer(size_t first_partial_block_bytes_count,
@@ -281,6 +332,7 @@ bool AeadHandler::InitializeFile(int fd, const char *path_name,
           : path_it->second;
   fmap_.emplace(fd, file_ctrl);
   opened_files_.emplace(path_name, file_ctrl);
+  cursor_locks_.emplace(fd, std::make_shared<absl::Mutex>());
 
   return true;
 }
@@ -307,7 +359,7 @@ bool AeadHandler::RetrieveLogicalOffset(int fd, off_t *logical_offset) const {
 }
 
 GcmCryptor *AeadHandler::GetGcmCryptor(const FileControl &file_ctrl) const {
-  file_ctrl.mu.AssertHeld();
+  file_ctrl.mu.AssertReaderHeld();
   if (!file_ctrl.master_key) {
     LOG(ERROR) << "Master key has not been set, path = " << file_ctrl.path;
     return nullptr;
@@ -322,60 +374,131 @@ GcmCryptor *AeadHandler::GetGcmCryptor(const FileControl &file_ctrl) const {
   return cryptor;
 }
 
+std::shared_ptr<AeadHandler::FileControl> AeadHandler::GetFileControl(int fd) {
+  absl::ReaderMutexLock global_lock(&mu_);
+  auto entry = fmap_.find(fd);
+  if (entry == fmap_.end()) {
+    errno = ENOENT;
+    return nullptr;
+  }
+  return entry->second;
+}
+
+std::shared_ptr<absl::Mutex> AeadHandler::GetCursorLock(int fd) {
+  absl::ReaderMutexLock global_lock(&mu_);
+  auto entry = cursor_locks_.find(fd);
+  if (entry == cursor_locks_.end()) {
+    errno = ENOENT;
+    return nullptr;
+  }
+  return entry->second;
+}
+
+bool AeadHandler::SetLogicalOffset(int fd, off_t logical_offset) const {
+  off_t physical_offset = offset_translator_->LogicalToPhysical(logical_offset);
+  if (enc_untrusted_lseek(fd, physical_offset, SEEK_SET) == -1) {
+    LOG(ERROR) << "Failed lseek to the end of the accessed range, fd = " << fd;
+    return false;
+  }
+  return true;
+}
+
 ssize_t AeadHandler::DecryptAndVerify(int fd, void *buf, size_t count) {
-  if (!buf) {
-    errno = EINVAL;
+  std::shared_ptr<absl::Mutex> cursor_lock = GetCursorLock(fd);
+  if (!cursor_lock) {
+    LOG(ERROR) << "Attempt made to read from an unopened file, fd = " << fd;
     return -1;
   }
+  absl::MutexLock lock(cursor_lock.get());
 
   off_t logical_offset;
   if (!RetrieveLogicalOffset(fd, &logical_offset)) {
     return -1;
   }
 
-  std::shared_ptr<FileControl> file_ctrl;
-  {
-    absl::MutexLock global_lock(&mu_);
+  ssize_t bytes_read = DecryptAndVerifyAt(fd, buf, count, logical_offset);
+  if (bytes_read > 0 && !SetLogicalOffset(fd, logical_offset + bytes_read)) {
+    return -1;
+  }
+  return bytes_read;
+}
 
-    auto entry = fmap_.find(fd);
-    if (entry == fmap_.end()) {
-      LOG(ERROR) << "Attempt made to read from an unopened file, fd = " << fd;
-      errno = ENOENT;
-      return -1;
-    }
+ssize_t AeadHandler::DecryptAndVerifyAt(int fd, void *buf, size_t count,
+                                        off_t logical_offset) {
+  if (!buf || logical_offset < 0) {
+    errno = EINVAL;
+    return -1;
+  }
 
-    file_ctrl = entry->second;
+  std::shared_ptr<FileControl> file_ctrl = GetFileControl(fd);
+  if (!file_ctrl) {
+    LOG(ERROR) << "Attempt made to read from an unopened file, fd = " << fd;
+    return -1;
   }
 
-  absl::MutexLock lock(&file_ctrl->mu);
-  return DecryptAndVerifyInternal(fd, buf, count, *file_ctrl, logical_offset);
+  if (count == 0) {
+    return 0;
+  }
+
+  ScopedBlockRange range(&file_ctrl->range_lock, logical_offset / kBlockLength,
+                         (logical_offset + count - 1) / kBlockLength,
+                         /*exclusive=*/false);
+  return DecryptAndVerifyInternal(fd, buf, count, file_ctrl.get(),
+                                  logical_offset);
 }
 
 ssize_t AeadHandler::DecryptAndVerifyInternal(int fd, void *buf, size_t count,
-                                              const FileControl &file_ctrl,
+                                              FileControl *file_ctrl,
                                               off_t logical_offset) const {
-  file_ctrl.mu.AssertHeld();
   if (count == 0) {
     return 0;
   }
 
-  // Check for logical EOF.
-  if (logical_offset >= file_ctrl.logical_size) {
-    return 0;
-  }
-
-  // Do not read beyond the EOF.
-  if (logical_offset + count >= file_ctrl.logical_size) {
-    count = file_ctrl.logical_size - logical_offset;
-  }
+  // Offset of the block holding |logical_offset|. The range may also end within
+  // that block, in which case the first partial block is the only block.
+  const off_t first_logical_block_offset =
+      logical_offset - logical_offset % kBlockLength;
 
-  // Determine data breakdown into logical blocks.
+  // Snapshot the metadata needed to verify the range, so that the file data is
+  // read and decrypted without holding the file lock. The blocks of the range
+  // are held in the range lock, so their leaves cannot change meanwhile.
+  GcmCryptor *cryptor;
   size_t first_partial_block_bytes_count;
   size_t last_partial_block_bytes_count;
   size_t full_inclusive_blocks_bytes_count;
-  offset_translator_->ReduceLogicalRangeToFullLogicalBlocks(
-      logical_offset, count, &first_partial_block_bytes_count,
-      &last_partial_block_bytes_count, &full_inclusive_blocks_bytes_count);
+  std::vector<std::string> leaf_hashes;
+  {
+    absl::ReaderMutexLock lock(&file_ctrl->mu);
+
+    // Check for logical EOF.
+    if (logical_offset >= file_ctrl->logical_size) {
+      return 0;
+    }
+
+    // Do not read beyond the EOF.
+    if (logical_offset + count >= file_ctrl->logical_size) {
+      count = file_ctrl->logical_size - logical_offset;
+    }
+
+    cryptor = GetGcmCryptor(*file_ctrl);
+    if (!cryptor) {
+      return -1;
+    }
+
+    // Determine data breakdown into logical blocks.
+    offset_translator_->ReduceLogicalRangeToFullLogicalBlocks(
+        logical_offset, count, &first_partial_block_bytes_count,
+        &last_partial_block_bytes_count, &full_inclusive_blocks_bytes_count);
+
+    const int64_t first_block_index = first_logical_block_offset / kBlockLength;
+    const int64_t blocks_count =
+        std::min<int64_t>(full_inclusive_blocks_bytes_count / kBlockLength,
+                          file_ctrl->ad->LeafCount() - first_block_index);
+    for (int64_t block_index = 0; block_index < blocks_count; block_index++) {
+      leaf_hashes.push_back(
+          file_ctrl->ad->LeafHash(first_block_index + block_index + 1));
+    }
+  }
 
   // Use single read buffer to minimize the number of read calls to the host.
   std::vector<uint8_t> buffer;
@@ -383,28 +506,14 @@ ssize_t AeadHandler::DecryptAndVerifyInternal(int fd, void *buf, size_t count,
       (full_inclusive_blocks_bytes_count / kBlockLength) * kSecureBlockLength;
   buffer.resize(physical_bytes_count);
 
-  // Move cursor to the first full block to read.
-  const off_t first_logical_block_offset =
-      (first_partial_block_bytes_count > 0)
-          ? (logical_offset + first_partial_block_bytes_count - kBlockLength)
-          : logical_offset;
   const off_t first_physical_block_offset =
       offset_translator_->LogicalToPhysical(first_logical_block_offset);
-  if (first_partial_block_bytes_count > 0) {
-    off_t offset =
-        enc_untrusted_lseek(fd, first_physical_block_offset, SEEK_SET);
-    if (offset == -1) {
-      LOG(ERROR)
-          << "Failed lseek to the fist block offset when reading file data.";
-      return -1;
-    }
-  }
 
   // Perform the read. Read may have been requested beyond EOF - cannot require
   // that bytes_read is equal to physical_bytes_count. The read was not
   // requested at EOF - checked this above.
-  ssize_t bytes_read =
-      enc_untrusted_read(fd, buffer.data(), physical_bytes_count);
+  ssize_t bytes_read = read_all_at(fd, buffer.data(), physical_bytes_count,
+                                   first_physical_block_offset);
   if (bytes_read <= 0) {
     LOG(ERROR) << "Cannot verify data - data has not been read, fd = " << fd;
     return -1;
@@ -418,48 +527,28 @@ ssize_t AeadHandler::DecryptAndVerifyInternal(int fd, void *buf, size_t count,
     return -1;
   }
 
-  // Move cursor to the position of the end of the read range.
-  off_t new_cur_logical_offset = logical_offset + count;
-  if (bytes_read != physical_bytes_count) {
-    int64_t blocks_not_read =
-        (physical_bytes_count - bytes_read) / kSecureBlockLength;
-    if (last_partial_block_bytes_count > 0) {
-      new_cur_logical_offset -= last_partial_block_bytes_count;
-      blocks_not_read--;
-    }
-    new_cur_logical_offset -= blocks_not_read * kBlockLength;
-  }
-  const off_t new_cur_physical_offset =
-      offset_translator_->LogicalToPhysical(new_cur_logical_offset);
-  off_t offset = enc_untrusted_lseek(fd, new_cur_physical_offset, SEEK_SET);
-  if (offset == -1) {
-    LOG(ERROR) << "Failed lseek to the end of read range.";
-    return -1;
-  }
-
-  GcmCryptor *cryptor = GetGcmCryptor(file_ctrl);
-  if (!cryptor) {
-    return -1;
-  }
-
   // Cycle through blocks.
-  const int64_t blocks_read = bytes_read / kSecureBlockLength;
+  const int64_t blocks_read = std::min<int64_t>(
+      bytes_read / kSecureBlockLength, leaf_hashes.size());
   const int64_t blocks_read_max = physical_bytes_count / kSecureBlockLength;
-  const off_t first_block_index =
-      (first_physical_block_offset - sizeof(FileHeader)) / kSecureBlockLength;
   size_t read_count = 0;
   for (int64_t block_index = 0; block_index < blocks_read; block_index++) {
-    const size_t merkle_block_idx = first_block_index + block_index + 1;
-
     uint8_t *plaintext_data =
         GetPlaintextBuffer(first_partial_block_bytes_count, block_index, buf);
 
     // Detect full blocks that belong to sparse regions in the file - no need to
     // decrypt.
-    if (file_ctrl.ad->LeafHash(merkle_block_idx) == file_ctrl.zero_hash) {
+    if (leaf_hashes[block_index] == file_ctrl->zero_hash) {
       VLOG(2) << "A sparse region block detected.";
-      memset(plaintext_data, 0, kBlockLength);
-      read_count += kBlockLength;
+      size_t block_bytes_count = kBlockLength;
+      if (block_index == 0 && first_partial_block_bytes_count > 0) {
+        block_bytes_count = first_partial_block_bytes_count;
+      } else if (block_index == blocks_read_max - 1 &&
+                 last_partial_block_bytes_count > 0) {
+        block_bytes_count = last_partial_block_bytes_count;
+      }
+      memset(plaintext_data, 0, block_bytes_count);
+      read_count += block_bytes_count;
       continue;
     }
 
@@ -486,8 +575,8 @@ ssize_t AeadHandler::DecryptAndVerifyInternal(int fd, void *buf, size_t count,
     // Note: Verifying integrity tag will be replaced with integrity
     // verification against AD root if/when AD tree will be stored in a file
     // (i.e. if/when optimizing integrity assurance for large files).
-    if (file_ctrl.ad->LeafHash(merkle_block_idx) !=
-        file_ctrl.ad->LeafHash(std::string(
+    if (leaf_hashes[block_index] !=
+        file_ctrl->ad->LeafHash(std::string(
             reinterpret_cast<const char *>(tag.data()), kTagLength))) {
       LOG(ERROR) << "Integrity verification failed, fd = " << fd;
       return -1;
@@ -518,7 +607,7 @@ ssize_t AeadHandler::DecryptAndVerifyInternal(int fd, void *buf, size_t count,
     // bytes.
     if (block_index == 0 && first_partial_block_bytes_count > 0) {
       std::copy_n(
-          bounce_block.begin() + kBlockLength - first_partial_block_bytes_count,
+          bounce_block.begin() + (logical_offset - first_logical_block_offset),
           first_partial_block_bytes_count, plaintext_data);
       read_count += first_partial_block_bytes_count;
     } else if (block_index == blocks_read_max - 1 &&
@@ -592,34 +681,26 @@ bool AeadHandler::UpdateDigest(FileControl *file_ctrl,
   return true;
 }
 
-bool AeadHandler::ReadFullBlock(const FileControl &file_ctrl,
-                                off_t logical_offset, Block *block) const {
-  file_ctrl.mu.AssertHeld();
+bool AeadHandler::ReadFullBlock(FileControl *file_ctrl, off_t logical_offset,
+                                Block *block) const {
   if (logical_offset < 0 || logical_offset % kBlockLength != 0) {
     errno = EINVAL;
     return false;
   }
 
-  int fd = enc_untrusted_open(file_ctrl.path.c_str(), O_RDONLY);
+  int fd = enc_untrusted_open(file_ctrl->path.c_str(), O_RDONLY);
   if (fd == -1) {
-    LOG(ERROR) << "Failed to open file to read a block, path=" << file_ctrl.path
-               << ", errno = " << errno;
+    LOG(ERROR) << "Failed to open file to read a block, path="
+               << file_ctrl->path << ", errno = " << errno;
     return false;
   }
 
   FdCloser fd_closer(fd, &enc_untrusted_close);
 
-  off_t physical_offset = offset_translator_->LogicalToPhysical(logical_offset);
-  off_t offset = enc_untrusted_lseek(fd, physical_offset, SEEK_SET);
-  if (offset == -1) {
-    LOG(ERROR) << "Failed lseek when reading a full block.";
-    return false;
-  }
-
   ssize_t bytes_read = DecryptAndVerifyInternal(fd, block->data(), kBlockLength,
                                                 file_ctrl, logical_offset);
   if (bytes_read == -1) {
-    return -1;
+    return false;
   }
 
   if (bytes_read < kBlockLength) {
@@ -630,35 +711,59 @@ bool AeadHandler::ReadFullBlock(const FileControl &file_ctrl,
 }
 
 ssize_t AeadHandler::EncryptAndPersist(int fd, const void *buf, size_t count) {
-  if (!buf) {
-    errno = EINVAL;
+  std::shared_ptr<absl::Mutex> cursor_lock = GetCursorLock(fd);
+  if (!cursor_lock) {
+    LOG(ERROR) << "Attempt made to write to an unopened file, fd = " << fd;
     return -1;
   }
+  absl::MutexLock lock(cursor_lock.get());
 
   off_t logical_offset;
   if (!RetrieveLogicalOffset(fd, &logical_offset)) {
     return -1;
   }
 
-  std::shared_ptr<FileControl> file_ctrl;
-  {
-    absl::MutexLock global_lock(&mu_);
+  ssize_t bytes_written = EncryptAndPersistAt(fd, buf, count, logical_offset);
+  if (bytes_written > 0 &&
+      !SetLogicalOffset(fd, logical_offset + bytes_written)) {
+    return -1;
+  }
+  return bytes_written;
+}
 
-    auto entry = fmap_.find(fd);
-    if (entry == fmap_.end()) {
-      LOG(ERROR) << "Attempt made to write to an unopened file, fd = " << fd;
-      errno = ENOENT;
-      return -1;
-    }
+ssize_t AeadHandler::EncryptAndPersistAt(int fd, const void *buf, size_t count,
+                                         off_t logical_offset) {
+  if (!buf || logical_offset < 0) {
+    errno = EINVAL;
+    return -1;
+  }
 
-    file_ctrl = entry->second;
+  std::shared_ptr<FileControl> file_ctrl = GetFileControl(fd);
+  if (!file_ctrl) {
+    LOG(ERROR) << "Attempt made to write to an unopened file, fd = " << fd;
+    return -1;
   }
 
   if (count == 0) {
     return 0;
   }
 
-  absl::MutexLock lock(&file_ctrl->mu);
+  // A write that reaches the last block of the file may also change the file
+  // size and append leaves, so it excludes every access to the blocks from the
+  // current end of the file onwards. Other writes only exclude the blocks they
+  // overwrite. The leaf count never decreases, so a stale count only widens the
+  // locked range.
+  const int64_t first_block = logical_offset / kBlockLength;
+  const int64_t last_block = (logical_offset + count - 1) / kBlockLength;
+  int64_t leaf_count;
+  {
+    absl::ReaderMutexLock lock(&file_ctrl->mu);
+    leaf_count = file_ctrl->ad->LeafCount();
+  }
+  ScopedBlockRange range(
+      &file_ctrl->range_lock, std::min(first_block, leaf_count),
+      last_block + 1 >= leaf_count ? BlockRangeLock::kEndOfFile : last_block,
+      /*exclusive=*/true);
 
   // Determine data breakdown into logical blocks.
   size_t first_partial_block_bytes_count;
@@ -668,30 +773,34 @@ ssize_t AeadHandler::EncryptAndPersist(int fd, const void *buf, size_t count) {
       logical_offset, count, &first_partial_block_bytes_count,
       &last_partial_block_bytes_count, &full_inclusive_blocks_bytes_count);
 
+  // Offset of the block holding |logical_offset|. The range may also end within
+  // that block, in which case the first partial block is the only block.
+  const off_t first_logical_block_offset =
+      logical_offset - logical_offset % kBlockLength;
+
   // Bounce block for writing the first partial block in the range, if any.
-  Block first_block;
+  Block first_block_data;
   if (first_partial_block_bytes_count > 0) {
-    if (!ReadFullBlock(
-            *file_ctrl,
-            logical_offset + first_partial_block_bytes_count - kBlockLength,
-            &first_block)) {
+    if (!ReadFullBlock(file_ctrl.get(), first_logical_block_offset,
+                       &first_block_data)) {
       LOG(ERROR)
           << "failed to read the first misaligned block when writing, fd = "
           << fd;
       return -1;
     }
 
-    std::copy_n(
-        reinterpret_cast<const uint8_t *>(buf), first_partial_block_bytes_count,
-        first_block.data() + kBlockLength - first_partial_block_bytes_count);
+    std::copy_n(reinterpret_cast<const uint8_t *>(buf),
+                first_partial_block_bytes_count,
+                first_block_data.data() +
+                    (logical_offset - first_logical_block_offset));
   }
 
   // Bounce block for writing the last partial block in the range, if any.
-  Block last_block;
+  Block last_block_data;
   if (last_partial_block_bytes_count > 0) {
-    if (!ReadFullBlock(*file_ctrl,
+    if (!ReadFullBlock(file_ctrl.get(),
                        logical_offset + count - last_partial_block_bytes_count,
-                       &last_block)) {
+                       &last_block_data)) {
       LOG(ERROR)
           << "failed to read the last misaligned block when writing, fd = "
           << fd;
@@ -700,37 +809,19 @@ ssize_t AeadHandler::EncryptAndPersist(int fd, const void *buf, size_t count) {
 
     std::copy_n(reinterpret_cast<const uint8_t *>(buf) + count -
                     last_partial_block_bytes_count,
-                last_partial_block_bytes_count, last_block.data());
+                last_partial_block_bytes_count, last_block_data.data());
   }
 
-  const off_t first_logical_block_offset =
-      (first_partial_block_bytes_count > 0)
-          ? (logical_offset + first_partial_block_bytes_count - kBlockLength)
-          : logical_offset;
   const off_t first_physical_block_offset =
       offset_translator_->LogicalToPhysical(first_logical_block_offset);
-  const int64_t eof_block_index = file_ctrl->ad->LeafCount();
-  int64_t start_block_to_write = 0;
-  if (first_physical_block_offset > file_ctrl->physical_size()) {
-    // Append leafs to the Merkle Tree to account for sparse region blocks.
-    int64_t sparse_blocks_count =
-        (first_physical_block_offset - file_ctrl->physical_size()) /
-        kSecureBlockLength;
-    for (int64_t idx = 0; idx < sparse_blocks_count; idx++) {
-      VLOG(2) << "Adding an empty auth tag to AD for a block "
-                 "from a sparse region: "
-              << absl::BytesToHexString(file_ctrl->zero_hash);
-      file_ctrl->ad->AddLeafHash(file_ctrl->zero_hash);
-    }
-    start_block_to_write = eof_block_index + sparse_blocks_count;
-  } else {
-    int64_t blocks_to_eof =
-        (file_ctrl->physical_size() - first_physical_block_offset) /
-        kSecureBlockLength;
-    start_block_to_write = eof_block_index - blocks_to_eof;
-  }
+  const int64_t start_block_to_write =
+      first_logical_block_offset / kBlockLength;
 
-  GcmCryptor *cryptor = GetGcmCryptor(*file_ctrl);
+  GcmCryptor *cryptor;
+  {
+    absl::ReaderMutexLock lock(&file_ctrl->mu);
+    cryptor = GetGcmCryptor(*file_ctrl);
+  }
   if (!cryptor) {
     return -1;
   }
@@ -755,10 +846,10 @@ ssize_t AeadHandler::EncryptAndPersist(int fd, const void *buf, size_t count) {
     // Determine the source depending on whether the written block is at the end
     // of the full range.
     if (block_index == 0 && first_partial_block_bytes_count > 0) {
-      encrypt_source = first_block.data();
+      encrypt_source = first_block_data.data();
     } else if (block_index == blocks_to_write - 1 &&
                last_partial_block_bytes_count > 0) {
-      encrypt_source = last_block.data();
+      encrypt_source = last_block_data.data();
     } else {
       encrypt_source = plaintext_data;
     }
@@ -790,17 +881,6 @@ ssize_t AeadHandler::EncryptAndPersist(int fd, const void *buf, size_t count) {
                    reinterpret_cast<const char *>(tag.data()), kTagLength));
   }
 
-  // Move cursor to the first full block to write.
-  if (first_partial_block_bytes_count > 0) {
-    off_t offset =
-        enc_untrusted_lseek(fd, first_physical_block_offset, SEEK_SET);
-    if (offset == -1) {
-      LOG(ERROR)
-          << "Failed lseek to the fist block offset when writing file data.";
-      return -1;
-    }
-  }
-
   // Note: with block alignment constraint in place, partial block writes are
   // not permissible - complete blocks must be written. Thus, the options are:
   // 1. Allow partial yet block-aligned writes - this would require truncating
@@ -809,31 +889,31 @@ ssize_t AeadHandler::EncryptAndPersist(int fd, const void *buf, size_t count) {
   //    on error or when all data has been written, following the POSIX model -
   //    this may lead to "long" writes when "large" amount of data is written.
   // In this code optimize operation for full writes - i.e. the option #2.
-  ssize_t bytes_written = write_all(fd, buffer.data(), physical_bytes_count);
+
+  file_ctrl->version.fetch_add(1, std::memory_order_release);
+  ssize_t bytes_written = write_all_at(fd, buffer.data(), physical_bytes_count,
+                                       first_physical_block_offset);
   if (bytes_written != physical_bytes_count) {
     LOG(ERROR) << "Failed to write encrypted data to file, path="
                << file_ctrl->path << ", bytes written = " << bytes_written;
     return -1;
   }
 
-  // Move cursor to the position of the end of the write range.
-  if (last_partial_block_bytes_count > 0) {
-    off_t new_cur_logical_offset = logical_offset + count;
-    off_t new_cur_physical_offset =
-        offset_translator_->LogicalToPhysical(new_cur_logical_offset);
-    off_t offset = enc_untrusted_lseek(fd, new_cur_physical_offset, SEEK_SET);
-    if (offset == -1) {
-      LOG(ERROR)
-          << "Failed lseek to the last block offset when reading file data.";
-      return -1;
-    }
+  absl::MutexLock lock(&file_ctrl->mu);
+
+  // Append leafs to the Merkle Tree to account for sparse region blocks.
+  while (file_ctrl->ad->LeafCount() < start_block_to_write) {
+    VLOG(2) << "Adding an empty auth tag to AD for a block "
+               "from a sparse region: "
+            << absl::BytesToHexString(file_ctrl->zero_hash);
+    file_ctrl->ad->AddLeafHash(file_ctrl->zero_hash);
   }
 
   for (int64_t idx = 0; idx < tags.size(); idx++) {
     std::string tag_string(reinterpret_cast<char *>(tags[idx].data()),
                            kTagLength);
     int64_t block_index = start_block_to_write + idx;
-    if (block_index < eof_block_index) {
+    if (block_index < file_ctrl->ad->LeafCount()) {
       VLOG(2) << "Updating auth tag on AD: "
               << absl::BytesToHexString(tag_string);
       file_ctrl->ad->UpdateLeaf(block_index + 1, tag_string);
@@ -844,7 +924,8 @@ ssize_t AeadHandler::EncryptAndPersist(int fd, const void *buf, size_t count) {
     }
   }
 
-  file_ctrl->logical_size = logical_offset + count;
+  file_ctrl->logical_size =
+      std::max<size_t>(file_ctrl->logical_size, logical_offset + count);
 
   if (!UpdateDigest(file_ctrl.get(), *cryptor)) {
     return -1;
@@ -879,6 +960,7 @@ bool AeadHandler::FinalizeFile(int fd) {
           << ", pathname = " << entry->second->path;
   opened_files_.erase(entry->second->path);
   fmap_.erase(entry);
+  cursor_locks_.erase(fd);
 
   return true;
 }
@@ -895,18 +977,10 @@ int AeadHandler::SetMasterKey(int fd, const uint8_t *key_data,
     return -1;
   }
 
-  std::shared_ptr<FileControl> file_ctrl;
-  {
-    absl::MutexLock global_lock(&mu_);
-
-    auto entry = fmap_.find(fd);
-    if (entry == fmap_.end()) {
-      LOG(ERROR) << "Attempt made to set key on an unopened file, fd = " << fd;
-      errno = ENOENT;
-      return -1;
-    }
-
-    file_ctrl = entry->second;
+  std::shared_ptr<FileControl> file_ctrl = GetFileControl(fd);
+  if (!file_ctrl) {
+    LOG(ERROR) << "Attempt made to set key on an unopened file, fd = " << fd;
+    return -1;
   }
 
   absl::MutexLock lock(&file_ctrl->mu);
@@ -938,15 +1012,25 @@ const OffsetTranslator &AeadHandler::GetOffsetTranslator() const {
 }
 
 off_t AeadHandler::GetLogicalFileSize(int fd) {
-  absl::MutexLock global_lock(&mu_);
-  auto entry = fmap_.find(fd);
-  if (entry == fmap_.end()) {
+  std::shared_ptr<FileControl> file_ctrl = GetFileControl(fd);
+  if (!file_ctrl) {
     LOG(ERROR)
         << "Attempt made to get logical file size on an unopened file, fd = "
         << fd;
     return -1;
   }
-  return entry->second->logical_size;
+  absl::ReaderMutexLock lock(&file_ctrl->mu);
+  return file_ctrl->logical_size;
+}
+
+int64_t AeadHandler::GetFileVersion(int fd) {
+  std::shared_ptr<FileControl> file_ctrl = GetFileControl(fd);
+  if (!file_ctrl) {
+    LOG(ERROR) << "Attempt made to get file version on an unopened file, fd = "
+               << fd;
+    return -1;
+  }
+  return file_ctrl->version.load(std::memory_order_acquire);
 }
 
 }  // namespace storage
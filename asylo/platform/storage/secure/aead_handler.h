@@ -20,6 +20,7 @@
 #define ASYLO_PLATFORM_STORAGE_SECURE_AEAD_HANDLER_H_
 
 #include <stdint.h>
+#include <atomic>
 #include <memory>
 #include <string>
 
@@ -30,6 +31,7 @@
 #include "asylo/platform/crypto/gcmlib/gcm_cryptor.h"
 #include "asylo/platform/storage/secure/authenticated_dictionary.h"
 #include "asylo/platform/storage/secure/ctmmt_authenticated_dictionary.h"
+#include "asylo/platform/storage/utils/block_range_lock.h"
 #include "asylo/platform/storage/utils/offset_translator.h"
 
 namespace asylo {
@@ -67,6 +69,15 @@ using FileDigest = UnsafeBytes<kRootHashLength>;
 // supplied file data. Uses enclave-to-host IO delegates to propagate IO calls
 // over the enclave boundary to access file storage outside the enclave.
 //
+// Reads of a file run concurrently with each other, and writes run
+// concurrently with reads and writes of other blocks of the file. Overlapping
+// accesses are ordered by a per-file BlockRangeLock. Per-file metadata is only
+// locked for as long as it takes to snapshot or update it, never across the
+// host calls that move file data. Reads and writes at the cursor of a file
+// descriptor hold a per-descriptor cursor lock while they retrieve, use and
+// advance the cursor, so that concurrent calls on one descriptor do not access
+// the same range.
+//
 // Tracked feature work:
 //
 class AeadHandler {
@@ -84,14 +95,27 @@ class AeadHandler {
       LOCKS_EXCLUDED(mu_);
 
   // Decrypts read data in-place, verifies data has not been tampered with,
-  // returns the size of data verified, or -1 on failure.
+  // returns the size of data verified, or -1 on failure. Reads at and advances
+  // the cursor associated with the file descriptor |fd|.
   ssize_t DecryptAndVerify(int fd, void *buf, size_t count) LOCKS_EXCLUDED(mu_);
 
+  // Similar to DecryptAndVerify, but reads from |logical_offset| and neither
+  // uses nor moves the cursor associated with the file descriptor |fd|.
+  ssize_t DecryptAndVerifyAt(int fd, void *buf, size_t count,
+                             off_t logical_offset) LOCKS_EXCLUDED(mu_);
+
   // Encrypts data and generates integrity metadata for it in memory, writes
   // encrypted data to disk, returns the size of data written, or -1 on failure.
+  // Writes at and advances the cursor associated with the file descriptor
+  // |fd|.
   ssize_t EncryptAndPersist(int fd, const void *buf, size_t count)
       LOCKS_EXCLUDED(mu_);
 
+  // Similar to EncryptAndPersist, but writes at |logical_offset| and neither
+  // uses nor moves the cursor associated with the file descriptor |fd|.
+  ssize_t EncryptAndPersistAt(int fd, const void *buf, size_t count,
+                              off_t logical_offset) LOCKS_EXCLUDED(mu_);
+
   // Frees resources used to assure integrity of an opened file, persists
   // integrity metadata to a designated location on disk, returns false on
   // failure. Does not modify the state of the file descriptor.
@@ -104,6 +128,11 @@ class AeadHandler {
   // Returns the logical file size, or -1 on failure.
   off_t GetLogicalFileSize(int fd) LOCKS_EXCLUDED(mu_);
 
+  // Returns a counter that changes whenever data is written to the file, by
+  // any file descriptor, or -1 on failure. Callers that keep decrypted file
+  // data use it to detect that their copy is stale.
+  int64_t GetFileVersion(int fd) LOCKS_EXCLUDED(mu_);
+
   const OffsetTranslator &GetOffsetTranslator() const;
 
  private:
@@ -143,15 +172,24 @@ class AeadHandler {
     std::string zero_hash;
     std::unique_ptr<GcmCryptorKey> master_key;
 
-    // Mutex for protecting FileControl instance.
+    // Incremented by every write. Read without holding |mu|.
+    std::atomic<int64_t> version;
+
+    // Mutex for protecting FileControl instance. Readers of the file hold it
+    // in shared mode while they snapshot the metadata they verify against.
     absl::Mutex mu;
 
+    // Orders reads and writes of overlapping blocks of the file, indexed from
+    // zero. Acquired before |mu| and held across the host calls.
+    BlockRangeLock range_lock;
+
     FileControl(const char *path_name, bool is_new_file)
         : path(path_name),
           logical_size(0),
           is_new(is_new_file),
           is_deserialized(false),
-          ad(absl::make_unique<CTMMTAuthenticatedDictionary>()) {
+          ad(absl::make_unique<CTMMTAuthenticatedDictionary>()),
+          version(0) {
       UnsafeBytes<kTagLength> tag;
       memset(tag.data(), 0, kTagLength);
       std::string tag_string(reinterpret_cast<char *>(tag.data()), kTagLength);
@@ -178,6 +216,19 @@ class AeadHandler {
   // Returns false on failure.
   bool RetrieveLogicalOffset(int fd, off_t *logical_offset) const;
 
+  // Moves the cursor associated with a file descriptor |fd| to the physical
+  // position of |logical_offset|. Returns false on failure.
+  bool SetLogicalOffset(int fd, off_t logical_offset) const;
+
+  // Returns the control structure of the file opened as |fd|, or nullptr with
+  // errno set if |fd| is not a secure file.
+  std::shared_ptr<FileControl> GetFileControl(int fd) LOCKS_EXCLUDED(mu_);
+
+  // Returns the lock that serializes accesses to the cursor of |fd|, or nullptr
+  // with errno set if |fd| is not a secure file. The cursor lock is acquired
+  // before any lock of the file.
+  std::shared_ptr<absl::Mutex> GetCursorLock(int fd) LOCKS_EXCLUDED(mu_);
+
   // Updates digest of the file data in the secure file header.
   bool UpdateDigest(FileControl *file_ctrl, const GcmCryptor &cryptor) const
       EXCLUSIVE_LOCKS_REQUIRED(file_ctrl->mu);
@@ -185,20 +236,21 @@ class AeadHandler {
   // Returns an instance of GcmCryptor associated with a file, or nullptr if was
   // not able to retrieve. The caller does not own the instance.
   GcmCryptor *GetGcmCryptor(const FileControl &file_ctrl) const
-      EXCLUSIVE_LOCKS_REQUIRED(file_ctrl.mu);
+      SHARED_LOCKS_REQUIRED(file_ctrl.mu);
 
-  // Similar to DecryptAndVerify, but is called by internal implementation, and
-  // as such does not take a file lock. The cursor associated with the file
-  // descriptor |fd| is expected to be at the position of |logical_offset|.
+  // Similar to DecryptAndVerifyAt, but is called by internal implementation,
+  // and as such does not take a range lock. The caller is expected to hold the
+  // blocks being read in |file_ctrl->range_lock|.
   ssize_t DecryptAndVerifyInternal(int fd, void *buf, size_t count,
-                                   const FileControl &file_ctrl,
+                                   FileControl *file_ctrl,
                                    off_t logical_offset) const
-      EXCLUSIVE_LOCKS_REQUIRED(file_ctrl.mu);
+      LOCKS_EXCLUDED(file_ctrl->mu);
 
   // Reads a single full block of a file at a specified logical offset. Returns
-  // false on failure.
-  bool ReadFullBlock(const FileControl &file_ctrl, off_t logical_offset,
-                     Block *block) const EXCLUSIVE_LOCKS_REQUIRED(file_ctrl.mu);
+  // false on failure. The caller is expected to hold the block in
+  // |file_ctrl->range_lock|.
+  bool ReadFullBlock(FileControl *file_ctrl, off_t logical_offset,
+                     Block *block) const LOCKS_EXCLUDED(file_ctrl->mu);
 
   // Map of file (data set) controls for opened files keyed on int identity of
   // files.
@@ -209,10 +261,16 @@ class AeadHandler {
   absl::flat_hash_map<std::string, std::shared_ptr<FileControl>> opened_files_
       GUARDED_BY(mu_);
 
+  // Map of cursor locks keyed on file descriptors of opened files. Unlike file
+  // controls, cursor locks are not shared between descriptors of a file.
+  absl::flat_hash_map<int, std::shared_ptr<absl::Mutex>> cursor_locks_
+      GUARDED_BY(mu_);
+
   // An instance that performs operations on untrusted file offset.
   std::unique_ptr<OffsetTranslator> offset_translator_;
 
-  // Mutex for protecting map members of the class.
+  // Mutex for protecting map members of the class. Lookups hold it in shared
+  // mode, so that I/O on different files does not contend on it.
   absl::Mutex mu_;
 };
 
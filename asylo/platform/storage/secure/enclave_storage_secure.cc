@@ -84,6 +84,15 @@ ssize_t secure_write(int fd, const void *buf, size_t count) {
   return AeadHandler::GetInstance().EncryptAndPersist(fd, buf, count);
 }
 
+ssize_t secure_pread(int fd, void *buf, size_t count, off_t offset) {
+  return AeadHandler::GetInstance().DecryptAndVerifyAt(fd, buf, count, offset);
+}
+
+ssize_t secure_pwrite(int fd, const void *buf, size_t count, off_t offset) {
+  return AeadHandler::GetInstance().EncryptAndPersistAt(fd, buf, count,
+                                                        offset);
+}
+
 int secure_close(int fd) {
   bool finalize_result = AeadHandler::GetInstance().FinalizeFile(fd);
   return (finalize_result && enc_untrusted_close(fd) == 0) ? 0 : -1;
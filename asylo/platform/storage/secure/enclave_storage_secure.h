@@ -43,6 +43,12 @@ ssize_t secure_read(int fd, void *buf, size_t count);
 // responsibility to explicitly set file offset on error as the client desires.
 ssize_t secure_write(int fd, const void *buf, size_t count);
 
+// Reads from and writes at the logical |offset| without using or moving the
+// file offset, so concurrent calls on the same fd do not race on the cursor.
+ssize_t secure_pread(int fd, void *buf, size_t count, off_t offset);
+
+ssize_t secure_pwrite(int fd, const void *buf, size_t count, off_t offset);
+
 int secure_close(int fd);
 
 off_t secure_lseek(int fd, off_t offset, int whence);
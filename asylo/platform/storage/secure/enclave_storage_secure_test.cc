@@ -22,6 +22,10 @@
 #include <fcntl.h>
 #include <openssl/rand.h>
 
+#include <algorithm>
+#include <string>
+#include <vector>
+
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "absl/base/macros.h"
@@ -35,6 +39,7 @@
 #include "asylo/util/cleansing_types.h"
 #include "asylo/util/logging.h"
 #include "asylo/util/status.h"
+#include "asylo/util/thread.h"
 
 namespace asylo {
 namespace {
@@ -48,6 +53,8 @@ using platform::storage::secure_close;
 using platform::storage::secure_fstat;
 using platform::storage::secure_lseek;
 using platform::storage::secure_open;
+using platform::storage::secure_pread;
+using platform::storage::secure_pwrite;
 using platform::storage::secure_read;
 using platform::storage::secure_write;
 using ::testing::Not;
@@ -500,6 +507,147 @@ TEST_P(EnclaveStorageSecureTest, LseekEndSuccess) {
   EXPECT_EQ(secure_close(fd), 0);
 }
 
+TEST_P(EnclaveStorageSecureTest, PreadPwriteDoNotMoveCursorSuccess) {
+  EXPECT_THAT(OpenWriteClose(0), IsOk());
+  int fd = secure_open(GetPath().c_str(), O_RDWR);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(EmulateSetKeyIoctl(fd), 0);
+  const off_t cursor = 16;
+  ASSERT_EQ(secure_lseek(fd, cursor, SEEK_SET), cursor);
+
+  // Overwrite a few bytes in the middle of a block.
+  std::string expected(reinterpret_cast<const char *>(GetWriteBuffer()),
+                       test_buf_len_);
+  const std::string patch = "ZZZZZ";
+  const off_t patch_offset = kBlockLength / 2 + 3;
+  expected.replace(patch_offset, patch.size(), patch);
+  EXPECT_EQ(secure_pwrite(fd, patch.data(), patch.size(), patch_offset),
+            patch.size());
+
+  // The file is neither truncated nor extended, and the cursor did not move.
+  EXPECT_EQ(secure_pread(fd, GetReadBuffer(), kMaxTestBufLen, 0),
+            test_buf_len_);
+  EXPECT_EQ(memcmp(expected.data(), GetReadBuffer(), test_buf_len_), 0);
+  EXPECT_EQ(secure_pread(fd, GetReadBuffer(), 9, patch_offset - 2), 9);
+  EXPECT_EQ(memcmp(expected.data() + patch_offset - 2, GetReadBuffer(), 9), 0);
+  EXPECT_EQ(secure_lseek(fd, 0, SEEK_CUR), cursor);
+  EXPECT_EQ(secure_read(fd, GetReadBuffer(), test_buf_len_ - cursor),
+            test_buf_len_ - cursor);
+  EXPECT_EQ(memcmp(expected.data() + cursor, GetReadBuffer(),
+                   test_buf_len_ - cursor),
+            0);
+  EXPECT_EQ(secure_close(fd), 0);
+}
+
+TEST_P(EnclaveStorageSecureTest, ConcurrentPreadSuccess) {
+  EXPECT_THAT(OpenWriteClose(0), IsOk());
+  int fd = secure_open(GetPath().c_str(), O_RDONLY);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(EmulateSetKeyIoctl(fd), 0);
+
+  // Every thread reads the whole file, one misaligned chunk at a time.
+  constexpr int kThreads = 4;
+  static constexpr size_t kChunkLength = kBlockLength / 2 + 8;
+  std::vector<int> mismatches(kThreads, 0);
+  std::vector<Thread> threads;
+  for (int i = 0; i < kThreads; i++) {
+    threads.emplace_back([this, fd, i, &mismatches] {
+      char buffer[kChunkLength];
+      for (off_t offset = i; offset < test_buf_len_; offset += kChunkLength) {
+        size_t expected_length =
+            std::min<size_t>(kChunkLength, test_buf_len_ - offset);
+        if (secure_pread(fd, buffer, kChunkLength, offset) != expected_length ||
+            memcmp(write_buffer_ + offset, buffer, expected_length) != 0) {
+          mismatches[i]++;
+        }
+      }
+    });
+  }
+  for (Thread &thread : threads) {
+    thread.Join();
+  }
+  EXPECT_THAT(mismatches, ::testing::Each(0));
+  EXPECT_EQ(secure_close(fd), 0);
+}
+
+TEST_P(EnclaveStorageSecureTest, ConcurrentCursorWritesWithReadsSuccess) {
+  int fd = secure_open(GetPath().c_str(), O_RDWR | O_CREAT,
+                       S_IRWXU | S_IRWXG | S_IRWXO);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(EmulateSetKeyIoctl(fd), 0);
+  int read_fd = secure_open(GetPath().c_str(), O_RDONLY);
+  ASSERT_GE(read_fd, 0);
+  ASSERT_EQ(EmulateSetKeyIoctl(read_fd), 0);
+
+  // Writers append chunks through the shared cursor of |fd|, so every chunk
+  // lands at its own chunk-aligned offset. Each chunk is filled with a tag
+  // identifying the writer and the write.
+  constexpr int kWriters = 4;
+  constexpr int kWritesPerWriter = 16;
+  constexpr int kReaders = 2;
+  const size_t chunk_length = test_buf_len_;
+  const size_t file_length = kWriters * kWritesPerWriter * chunk_length;
+  std::vector<int> failures(kWriters + kReaders, 0);
+  std::vector<Thread> threads;
+  for (int i = 0; i < kWriters; i++) {
+    threads.emplace_back([fd, i, chunk_length, &failures] {
+      std::vector<uint8_t> chunk(chunk_length);
+      for (int j = 0; j < kWritesPerWriter; j++) {
+        std::fill(chunk.begin(), chunk.end(), 1 + i * kWritesPerWriter + j);
+        if (secure_write(fd, chunk.data(), chunk.size()) != chunk.size()) {
+          failures[i]++;
+        }
+      }
+    });
+  }
+
+  // Readers concurrently read ranges that straddle chunk boundaries through
+  // |read_fd|. Every chunk they see must be either unwritten or whole.
+  for (int i = 0; i < kReaders; i++) {
+    threads.emplace_back(
+        [read_fd, i, chunk_length, file_length, &failures] {
+          std::vector<uint8_t> buffer(chunk_length);
+          for (off_t offset = chunk_length / 2 + i; offset < file_length;
+               offset += chunk_length / 3) {
+            ssize_t bytes_read =
+                secure_pread(read_fd, buffer.data(), buffer.size(), offset);
+            if (bytes_read < 0) {
+              failures[kWriters + i]++;
+              continue;
+            }
+            for (off_t byte = 1; byte < bytes_read; byte++) {
+              if ((offset + byte) % chunk_length != 0 &&
+                  buffer[byte] != buffer[byte - 1]) {
+                failures[kWriters + i]++;
+                break;
+              }
+            }
+          }
+        });
+  }
+  for (Thread &thread : threads) {
+    thread.Join();
+  }
+  EXPECT_THAT(failures, ::testing::Each(0));
+
+  // No write was lost to a race on the cursor.
+  EXPECT_EQ(secure_lseek(fd, 0, SEEK_CUR), file_length);
+  std::vector<uint8_t> contents(file_length);
+  ASSERT_EQ(secure_pread(read_fd, contents.data(), contents.size(), 0),
+            file_length);
+  std::vector<int> tag_counts(1 + kWriters * kWritesPerWriter, 0);
+  for (size_t offset = 0; offset < file_length; offset += chunk_length) {
+    ASSERT_LT(contents[offset], tag_counts.size());
+    tag_counts[contents[offset]]++;
+  }
+  EXPECT_EQ(tag_counts[0], 0);
+  EXPECT_THAT(std::vector<int>(tag_counts.begin() + 1, tag_counts.end()),
+              ::testing::Each(1));
+
+  EXPECT_EQ(secure_close(read_fd), 0);
+  EXPECT_EQ(secure_close(fd), 0);
+}
+
 //
 // Failure cases.
 //
@@ -0,0 +1,64 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/storage/utils/block_range_lock.h"
+
+#include <algorithm>
+
+namespace asylo {
+namespace platform {
+namespace storage {
+
+constexpr int64_t BlockRangeLock::kEndOfFile;
+
+void BlockRangeLock::Lock(int64_t first, int64_t last, bool exclusive) {
+  const Range range = {first, last, exclusive};
+  auto can_lock = [this, &range]() {
+    mu_.AssertHeld();
+    return !Conflicts(range);
+  };
+  absl::MutexLock lock(&mu_);
+  mu_.Await(absl::Condition(&can_lock));
+  held_.push_back(range);
+}
+
+void BlockRangeLock::Unlock(int64_t first, int64_t last, bool exclusive) {
+  absl::MutexLock lock(&mu_);
+  auto it = std::find_if(held_.begin(), held_.end(), [&](const Range &range) {
+    return range.first == first && range.last == last &&
+           range.exclusive == exclusive;
+  });
+  if (it != held_.end()) {
+    *it = held_.back();
+    held_.pop_back();
+  }
+}
+
+bool BlockRangeLock::Conflicts(const Range &range) const {
+  for (const Range &held : held_) {
+    if (held.first <= range.last && range.first <= held.last &&
+        (held.exclusive || range.exclusive)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace storage
+}  // namespace platform
+}  // namespace asylo
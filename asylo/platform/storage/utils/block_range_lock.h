@@ -0,0 +1,95 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ASYLO_PLATFORM_STORAGE_UTILS_BLOCK_RANGE_LOCK_H_
+#define ASYLO_PLATFORM_STORAGE_UTILS_BLOCK_RANGE_LOCK_H_
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace asylo {
+namespace platform {
+namespace storage {
+
+// Reader-writer lock over ranges of blocks of a file. A range locked in shared
+// mode only excludes overlapping ranges locked in exclusive mode, and an
+// exclusive range excludes every overlapping range. Ranges that do not overlap
+// never wait for each other, so I/O on different parts of a file can proceed
+// concurrently.
+class BlockRangeLock {
+ public:
+  // The last block of a range that extends past the end of the file, however
+  // far the file grows.
+  static constexpr int64_t kEndOfFile = std::numeric_limits<int64_t>::max();
+
+  BlockRangeLock() = default;
+  BlockRangeLock(const BlockRangeLock &) = delete;
+  BlockRangeLock &operator=(const BlockRangeLock &) = delete;
+
+  // Waits until blocks |first| through |last|, inclusive, can be locked in the
+  // requested mode and locks them.
+  void Lock(int64_t first, int64_t last, bool exclusive) LOCKS_EXCLUDED(mu_);
+
+  // Releases a range previously locked by Lock() with the same arguments.
+  void Unlock(int64_t first, int64_t last, bool exclusive) LOCKS_EXCLUDED(mu_);
+
+ private:
+  struct Range {
+    int64_t first;
+    int64_t last;
+    bool exclusive;
+  };
+
+  // Returns true if |range| overlaps a held range and either of them is
+  // exclusive.
+  bool Conflicts(const Range &range) const EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  absl::Mutex mu_;
+  std::vector<Range> held_ GUARDED_BY(mu_);
+};
+
+// Holds a range of a BlockRangeLock for the lifetime of the object.
+class ScopedBlockRange {
+ public:
+  ScopedBlockRange(BlockRangeLock *lock, int64_t first, int64_t last,
+                   bool exclusive)
+      : lock_(lock), first_(first), last_(last), exclusive_(exclusive) {
+    lock_->Lock(first_, last_, exclusive_);
+  }
+
+  ScopedBlockRange(const ScopedBlockRange &) = delete;
+  ScopedBlockRange &operator=(const ScopedBlockRange &) = delete;
+
+  ~ScopedBlockRange() { lock_->Unlock(first_, last_, exclusive_); }
+
+ private:
+  BlockRangeLock *const lock_;
+  const int64_t first_;
+  const int64_t last_;
+  const bool exclusive_;
+};
+
+}  // namespace storage
+}  // namespace platform
+}  // namespace asylo
+
+#endif  // ASYLO_PLATFORM_STORAGE_UTILS_BLOCK_RANGE_LOCK_H_
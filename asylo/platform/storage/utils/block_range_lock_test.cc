@@ -0,0 +1,91 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "asylo/platform/storage/utils/block_range_lock.h"
+
+#include <gtest/gtest.h>
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "asylo/util/thread.h"
+
+namespace asylo {
+namespace platform {
+namespace storage {
+namespace {
+
+// How long to wait for a range that should be acquired while [0, 9] is held.
+// The wait ends as soon as the range is acquired.
+constexpr absl::Duration kAcquireTimeout = absl::Seconds(30);
+
+// How long to wait before deciding that a range is not acquired while [0, 9]
+// is held.
+constexpr absl::Duration kBlockedTimeout = absl::Milliseconds(50);
+
+// Locks [first, last] in the given mode on another thread while [0, 9] is held
+// exclusively, and returns whether the other thread acquired the range within
+// |timeout|, before [0, 9] was released.
+bool AcquiresWhileExclusiveHeld(int64_t first, int64_t last, bool exclusive,
+                                absl::Duration timeout) {
+  BlockRangeLock lock;
+  lock.Lock(0, 9, /*exclusive=*/true);
+  absl::Notification acquired;
+  Thread other([&lock, &acquired, first, last, exclusive] {
+    ScopedBlockRange range(&lock, first, last, exclusive);
+    acquired.Notify();
+  });
+  bool acquired_while_held = acquired.WaitForNotificationWithTimeout(timeout);
+  lock.Unlock(0, 9, /*exclusive=*/true);
+  other.Join();
+  EXPECT_TRUE(acquired.HasBeenNotified());
+  return acquired_while_held;
+}
+
+TEST(BlockRangeLockTest, SharedRangesOverlap) {
+  BlockRangeLock lock;
+  ScopedBlockRange first(&lock, 0, 9, /*exclusive=*/false);
+  ScopedBlockRange second(&lock, 5, 14, /*exclusive=*/false);
+}
+
+TEST(BlockRangeLockTest, DisjointExclusiveRangesDoNotWait) {
+  BlockRangeLock lock;
+  ScopedBlockRange first(&lock, 0, 9, /*exclusive=*/true);
+  ScopedBlockRange second(&lock, 10, BlockRangeLock::kEndOfFile,
+                          /*exclusive=*/true);
+}
+
+TEST(BlockRangeLockTest, DisjointRangeAcquiredWhileExclusiveHeld) {
+  EXPECT_TRUE(
+      AcquiresWhileExclusiveHeld(10, 20, /*exclusive=*/true, kAcquireTimeout));
+  EXPECT_TRUE(AcquiresWhileExclusiveHeld(10, 10, /*exclusive=*/false,
+                                         kAcquireTimeout));
+}
+
+TEST(BlockRangeLockTest, OverlappingRangeWaitsForExclusive) {
+  EXPECT_FALSE(AcquiresWhileExclusiveHeld(9, 20, /*exclusive=*/false,
+                                          kBlockedTimeout));
+  EXPECT_FALSE(
+      AcquiresWhileExclusiveHeld(5, 5, /*exclusive=*/true, kBlockedTimeout));
+  EXPECT_FALSE(AcquiresWhileExclusiveHeld(0, BlockRangeLock::kEndOfFile,
+                                          /*exclusive=*/false,
+                                          kBlockedTimeout));
+}
+
+}  // namespace
+}  // namespace storage
+}  // namespace platform
+}  // namespace asylo
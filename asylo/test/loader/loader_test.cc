@@ -16,9 +16,16 @@
  *
  */
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <thread>
+#include <vector>
 
 #include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "asylo/client.h"
 #include "asylo/test/util/status_matchers.h"
 #include "asylo/util/status.h"
@@ -106,6 +113,41 @@ class FakeLoader : public EnclaveLoader {
   }
 };
 
+// Loads clients by default constructing T, and can be copied into an enclave
+// pool.
+template <typename T>
+class CopyableLoader : public FakeLoader<T> {
+ protected:
+  StatusOr<std::unique_ptr<EnclaveLoader>> Copy() const override {
+    return std::unique_ptr<EnclaveLoader>(new CopyableLoader<T>());
+  }
+};
+
+// Loads clients slowly, and keeps track of how many loads ran at once.
+class SlowLoader : public FakeLoader<TestClient> {
+ public:
+  int max_concurrent_loads() const { return max_concurrent_loads_; }
+
+ protected:
+  StatusOr<std::unique_ptr<EnclaveClient>> LoadEnclave(
+      const std::string &name, void *base_address, const size_t enclave_size,
+      const EnclaveConfig &config) const override {
+    int loads = ++concurrent_loads_;
+    int max_loads = max_concurrent_loads_;
+    while (loads > max_loads &&
+           !max_concurrent_loads_.compare_exchange_weak(max_loads, loads)) {
+    }
+    absl::SleepFor(absl::Milliseconds(50));
+    --concurrent_loads_;
+    return FakeLoader<TestClient>::LoadEnclave(name, base_address,
+                                               enclave_size, config);
+  }
+
+ private:
+  mutable std::atomic<int> concurrent_loads_{0};
+  mutable std::atomic<int> max_concurrent_loads_{0};
+};
+
 class LoaderTest : public ::testing::Test {
  protected:
   void SetUp() override {
@@ -117,6 +159,18 @@ class LoaderTest : public ::testing::Test {
     manager_ = manager_result.ValueOrDie();
   }
 
+  // Waits for the pool named |pool_name| to hold |size| parked enclaves.
+  bool WaitForPoolSize(const std::string &pool_name, size_t size) {
+    absl::Time deadline = absl::Now() + absl::Seconds(10);
+    while (manager_->GetEnclavePoolSize(pool_name) != size) {
+      if (absl::Now() > deadline) {
+        return false;
+      }
+      absl::SleepFor(absl::Milliseconds(1));
+    }
+    return true;
+  }
+
   EnclaveManager *manager_;
   FakeLoader<TestClient> loader_;
 };
@@ -172,5 +226,153 @@ TEST_F(LoaderTest, PropagateLoaderFailure) {
   ASSERT_THAT(status, Not(IsOk()));
 }
 
+// Ensure enclaves with different names are loaded concurrently.
+TEST_F(LoaderTest, ConcurrentLoads) {
+  constexpr int kNumThreads = 4;
+  SlowLoader loader;
+  std::vector<std::thread> threads;
+  std::atomic<int> failures(0);
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([this, &loader, &failures, i] {
+      Status status =
+          manager_->LoadEnclave(absl::StrCat("/concurrent_", i), loader);
+      if (!status.ok()) {
+        ++failures;
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(failures, 0);
+  EXPECT_GT(loader.max_concurrent_loads(), 1);
+
+  for (int i = 0; i < kNumThreads; ++i) {
+    EnclaveClient *client =
+        manager_->GetClient(absl::StrCat("/concurrent_", i));
+    ASSERT_NE(client, nullptr);
+    EnclaveFinal final_input;
+    EXPECT_THAT(manager_->DestroyEnclave(client, final_input), IsOk());
+  }
+}
+
+// Ensure only one of several concurrent loads under the same name succeeds.
+TEST_F(LoaderTest, ConcurrentDuplicateNamesFail) {
+  constexpr int kNumThreads = 4;
+  SlowLoader loader;
+  std::vector<std::thread> threads;
+  std::atomic<int> successes(0);
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([this, &loader, &successes] {
+      if (manager_->LoadEnclave("/concurrent_duplicate", loader).ok()) {
+        ++successes;
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(successes, 1);
+
+  EnclaveFinal final_input;
+  EXPECT_THAT(manager_->DestroyEnclave(
+                  manager_->GetClient("/concurrent_duplicate"), final_input),
+              IsOk());
+}
+
+// Ensure the phases of loading are traced.
+TEST_F(LoaderTest, LoadTrace) {
+  SlowLoader loader;
+  EnclaveLoadTrace trace;
+  ASSERT_THAT(
+      manager_->LoadEnclave("/traced", loader, EnclaveConfig(), &trace),
+      IsOk());
+  EXPECT_GE(trace.load_ns(), absl::ToInt64Nanoseconds(absl::Milliseconds(50)));
+  EXPECT_TRUE(trace.has_enter_and_initialize_ns());
+  EXPECT_GE(trace.total_ns(),
+            trace.load_ns() + trace.enter_and_initialize_ns());
+
+  // The fake loader does not break down its loading time.
+  EXPECT_FALSE(trace.has_enclave_creation_ns());
+
+  EnclaveFinal final_input;
+  EXPECT_THAT(
+      manager_->DestroyEnclave(manager_->GetClient("/traced"), final_input),
+      IsOk());
+}
+
+// Ensure an enclave pool is filled, hands out enclaves bound to the requested
+// name, and is refilled in the background.
+TEST_F(LoaderTest, PoolHandsOutPreloadedEnclaves) {
+  CopyableLoader<TestClient> loader;
+  ASSERT_THAT(manager_->CreateEnclavePool("/pool", loader, EnclaveConfig(), 2),
+              IsOk());
+  ASSERT_TRUE(WaitForPoolSize("/pool", 2));
+
+  ASSERT_THAT(manager_->LoadEnclaveFromPool("/pooled", "/pool"), IsOk());
+  EnclaveClient *client = manager_->GetClient("/pooled");
+  ASSERT_NE(client, nullptr);
+  EXPECT_EQ(client->get_name(), "/pooled");
+  EXPECT_EQ(manager_->GetName(client), "/pooled");
+  EXPECT_TRUE(WaitForPoolSize("/pool", 2));
+
+  EnclaveFinal final_input;
+  EXPECT_THAT(manager_->DestroyEnclave(client, final_input), IsOk());
+  EXPECT_THAT(manager_->DestroyEnclavePool("/pool"), IsOk());
+  EXPECT_EQ(manager_->GetEnclavePoolSize("/pool"), 0);
+}
+
+// Ensure enclaves are loaded on demand when the pool runs dry.
+TEST_F(LoaderTest, EmptyPoolLoadsOnDemand) {
+  CopyableLoader<TestClient> loader;
+  ASSERT_THAT(
+      manager_->CreateEnclavePool("/small_pool", loader, EnclaveConfig(), 1),
+      IsOk());
+
+  for (const char *name : {"/on_demand_1", "/on_demand_2", "/on_demand_3"}) {
+    ASSERT_THAT(manager_->LoadEnclaveFromPool(name, "/small_pool"), IsOk());
+    EnclaveClient *client = manager_->GetClient(name);
+    ASSERT_NE(client, nullptr);
+    EnclaveFinal final_input;
+    EXPECT_THAT(manager_->DestroyEnclave(client, final_input), IsOk());
+  }
+  EXPECT_THAT(manager_->DestroyEnclavePool("/small_pool"), IsOk());
+}
+
+// Ensure pool names and enclave names cannot be reused.
+TEST_F(LoaderTest, PoolDuplicateNamesFail) {
+  CopyableLoader<TestClient> loader;
+  EnclaveConfig config;
+  ASSERT_THAT(manager_->CreateEnclavePool("/duplicate_pool", loader, config, 1),
+              IsOk());
+  EXPECT_THAT(manager_->CreateEnclavePool("/duplicate_pool", loader, config, 1),
+              Not(IsOk()));
+
+  ASSERT_THAT(manager_->LoadEnclave("/taken", loader_), IsOk());
+  EXPECT_THAT(manager_->LoadEnclaveFromPool("/taken", "/duplicate_pool"),
+              Not(IsOk()));
+
+  EnclaveFinal final_input;
+  EXPECT_THAT(
+      manager_->DestroyEnclave(manager_->GetClient("/taken"), final_input),
+      IsOk());
+  EXPECT_THAT(manager_->DestroyEnclavePool("/duplicate_pool"), IsOk());
+}
+
+// Ensure that pools cannot be created from loaders that cannot be copied, and
+// that missing pools are reported.
+TEST_F(LoaderTest, PoolErrors) {
+  EXPECT_THAT(manager_->CreateEnclavePool("/uncopyable_pool", loader_,
+                                          EnclaveConfig(), 1),
+              Not(IsOk()));
+  CopyableLoader<TestClient> loader;
+  EXPECT_THAT(
+      manager_->CreateEnclavePool("/empty_pool", loader, EnclaveConfig(), 0),
+      Not(IsOk()));
+  EXPECT_THAT(manager_->LoadEnclaveFromPool("/unpooled", "/missing_pool"),
+              Not(IsOk()));
+  EXPECT_THAT(manager_->DestroyEnclavePool("/missing_pool"), Not(IsOk()));
+}
+
 };  // namespace
 };  // namespace asylo
@@ -0,0 +1,123 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <errno.h>
+#include <pthread.h>
+
+#include <atomic>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "asylo/test/util/pthread_test_util.h"
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/util/logging.h"
+#include "asylo/util/status.h"
+
+namespace asylo {
+namespace {
+
+TEST(EnclaveBarrier, InvalidBarrierPointer) {
+  // Test various functions to ensure they return EFAULT rather than crashing if
+  // they get invalid pointers.
+  ASSERT_EQ(pthread_barrier_init(nullptr, nullptr, /*count=*/1), EFAULT);
+  ASSERT_EQ(pthread_barrier_destroy(nullptr), EFAULT);
+  ASSERT_EQ(pthread_barrier_wait(nullptr), EFAULT);
+  ASSERT_EQ(pthread_barrierattr_init(nullptr), EFAULT);
+  ASSERT_EQ(pthread_barrierattr_destroy(nullptr), EFAULT);
+}
+
+TEST(EnclaveBarrier, ZeroCount) {
+  pthread_barrier_t barrier;
+  ASSERT_EQ(pthread_barrier_init(&barrier, nullptr, /*count=*/0), EINVAL);
+}
+
+TEST(EnclaveBarrier, SingleThread) {
+  // A barrier for a single thread never blocks, and every wait is the serial
+  // thread of its cycle.
+  pthread_barrierattr_t attr;
+  ASSERT_EQ(pthread_barrierattr_init(&attr), 0);
+  pthread_barrier_t barrier;
+  ASSERT_EQ(pthread_barrier_init(&barrier, &attr, /*count=*/1), 0);
+  ASSERT_EQ(pthread_barrierattr_destroy(&attr), 0);
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_EQ(pthread_barrier_wait(&barrier), PTHREAD_BARRIER_SERIAL_THREAD);
+  }
+  ASSERT_EQ(pthread_barrier_destroy(&barrier), 0);
+}
+
+class BarrierTest : public ::testing::Test {
+ protected:
+  // The number of threads that wait on the barrier.
+  static constexpr int kNumThreads = 4;
+
+  // The number of times each thread waits on the barrier.
+  static constexpr int kCycles = 1000;
+
+  // The barrier under test.
+  pthread_barrier_t barrier_;
+
+  // The number of threads that have finished each cycle.
+  std::atomic<int> arrived_[kCycles];
+
+  // The number of waits that returned PTHREAD_BARRIER_SERIAL_THREAD.
+  std::atomic<int> serial_threads_{0};
+
+  // Waits on the barrier kCycles times, checking on each cycle that no thread
+  // was released before every thread arrived.
+  void WaiterRoutine() {
+    for (int i = 0; i < kCycles; ++i) {
+      arrived_[i]++;
+      int ret = pthread_barrier_wait(&barrier_);
+      CHECK(ret == 0 || ret == PTHREAD_BARRIER_SERIAL_THREAD)
+          << "Unexpected return value " << ret;
+      if (ret == PTHREAD_BARRIER_SERIAL_THREAD) {
+        serial_threads_++;
+      }
+      CHECK_EQ(arrived_[i].load(), kNumThreads)
+          << "Thread released before all threads arrived";
+      BusyWork();
+    }
+  }
+
+  static void *WaiterTrampoline(void *arg) {
+    BarrierTest *test = static_cast<BarrierTest *>(arg);
+    CHECK(test != nullptr) << "Test pointer is unexpectedly null";
+    test->WaiterRoutine();
+    return nullptr;
+  }
+};
+
+TEST_F(BarrierTest, ManyCycles) {
+  // End-to-end test of threads repeatedly meeting at the same barrier. Exactly
+  // one thread is the serial thread of each cycle.
+  for (std::atomic<int> &arrived : arrived_) {
+    arrived = 0;
+  }
+  ASSERT_EQ(pthread_barrier_init(&barrier_, nullptr, kNumThreads), 0);
+
+  std::vector<pthread_t> threads;
+  ASSERT_THAT(LaunchThreads(kNumThreads, WaiterTrampoline, this, &threads),
+              IsOk());
+  ASSERT_THAT(JoinThreads(threads), IsOk());
+
+  EXPECT_EQ(serial_threads_.load(), kCycles);
+  ASSERT_EQ(pthread_barrier_destroy(&barrier_), 0);
+}
+
+}  // namespace
+}  // namespace asylo
@@ -22,6 +22,8 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "asylo/util/logging.h"
 #include "asylo/test/util/pthread_test_util.h"
 #include "asylo/test/util/status_matchers.h"
@@ -51,6 +53,9 @@ absl::Mutex mu2;
 // Mutex used in the TryLock-enabled routine.
 absl::Mutex mu3;
 
+// Mutex used in the pthread_mutex_t routine.
+pthread_mutex_t pthread_mu = PTHREAD_MUTEX_INITIALIZER;
+
 // A counter incremented by many threads.
 volatile int counter = 0;
 
@@ -125,6 +130,23 @@ void *StartRoutineTryLock(void *) {
   return nullptr;
 }
 
+// Increments the counter under a pthread_mutex_t held long enough that the
+// other threads stop spinning and park on it.
+void *StartRoutinePthreadMutex(void *) {
+  for (int i = 0; i < 100; ++i) {
+    if (pthread_mutex_lock(&pthread_mu) != 0) {
+      LOG(FATAL) << "pthread_mutex_lock failed";
+    }
+    volatile int counter_copy = counter;
+    absl::SleepFor(absl::Microseconds(100));
+    counter = counter_copy + 1;
+    if (pthread_mutex_unlock(&pthread_mu) != 0) {
+      LOG(FATAL) << "pthread_mutex_unlock failed";
+    }
+  }
+  return nullptr;
+}
+
 TEST(RunWithUnguardedTest, EnclaveMutex) {
   counter = 0;
   ASSERT_THAT(RunThreads(&StartRoutineUnguarded), IsOk());
@@ -153,5 +175,13 @@ TEST(RunWithTryLockTest, EnclaveMutex) {
   ASSERT_EQ(counter, kExpectedResult);
 }
 
+TEST(RunWithPthreadMutexTest, EnclaveMutex) {
+  counter = 0;
+  ASSERT_THAT(RunThreads(&StartRoutinePthreadMutex), IsOk());
+  LOG(INFO) << "pthread_mutex_guarded_counter: " << counter;
+  ASSERT_EQ(counter, kNumThreads * 100);
+  EXPECT_EQ(pthread_mutex_destroy(&pthread_mu), 0);
+}
+
 }  // namespace
 }  // namespace asylo
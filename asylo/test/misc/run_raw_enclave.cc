@@ -0,0 +1,47 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <algorithm>
+#include <string>
+
+#include "asylo/crypto/util/byte_container_view.h"
+#include "asylo/test/util/enclave_test_application.h"
+#include "asylo/util/status.h"
+
+namespace asylo {
+
+// Enclave that returns the bytes passed to RunRaw() in reverse order, or fails
+// if they spell "fail".
+class RunRawEnclave : public EnclaveTestCase {
+ public:
+  RunRawEnclave() = default;
+
+  Status RunRaw(ByteContainerView input, std::string *output) override {
+    std::string bytes(reinterpret_cast<const char *>(input.data()),
+                      input.size());
+    if (bytes == "fail") {
+      return Status(error::GoogleError::INVALID_ARGUMENT, "Asked to fail");
+    }
+    output->assign(bytes.rbegin(), bytes.rend());
+    return Status::OkStatus();
+  }
+};
+
+TrustedApplication *BuildTrustedApplication() { return new RunRawEnclave; }
+
+}  // namespace asylo
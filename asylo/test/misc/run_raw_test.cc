@@ -0,0 +1,73 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <string>
+
+#include <gtest/gtest.h>
+#include "asylo/crypto/util/byte_container_view.h"
+#include "asylo/test/util/enclave_test.h"
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/util/status.h"
+
+namespace asylo {
+namespace {
+
+class RunRawTest : public EnclaveTest {};
+
+// Ensure a multi-megabyte payload makes the round trip intact.
+TEST_F(RunRawTest, LargePayload) {
+  std::string input(8 << 20, '\0');
+  for (size_t i = 0; i < input.size(); ++i) {
+    input[i] = static_cast<char>(i * 31);
+  }
+  std::string output;
+  ASYLO_ASSERT_OK(client_->EnterAndRunRaw(input, &output));
+  EXPECT_EQ(output, std::string(input.rbegin(), input.rend()));
+}
+
+// Ensure the sink sees the output in place, exactly once.
+TEST_F(RunRawTest, OutputSink) {
+  int calls = 0;
+  std::string output;
+  ASYLO_ASSERT_OK(client_->EnterAndRunRaw(
+      std::string("abc"), [&calls, &output](ByteContainerView bytes) {
+        ++calls;
+        output.assign(reinterpret_cast<const char *>(bytes.data()),
+                      bytes.size());
+      }));
+  EXPECT_EQ(calls, 1);
+  EXPECT_EQ(output, "cba");
+}
+
+// Ensure an empty input yields an empty output.
+TEST_F(RunRawTest, EmptyPayload) {
+  std::string output = "stale";
+  ASYLO_ASSERT_OK(client_->EnterAndRunRaw(std::string(), &output));
+  EXPECT_TRUE(output.empty());
+}
+
+// Ensure errors returned by RunRaw() reach the host.
+TEST_F(RunRawTest, ErrorPropagates) {
+  std::string output;
+  EXPECT_THAT(client_->EnterAndRunRaw(std::string("fail"), &output),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+  EXPECT_TRUE(output.empty());
+}
+
+}  // namespace
+}  // namespace asylo
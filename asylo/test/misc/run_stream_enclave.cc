@@ -0,0 +1,64 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <cctype>
+#include <cstring>
+
+#include "asylo/platform/core/stream_channel.h"
+#include "asylo/test/util/enclave_test_application.h"
+#include "asylo/util/status.h"
+#include "asylo/util/status_macros.h"
+
+namespace asylo {
+
+// Enclave that streams its input back in upper case through a fixed-size
+// buffer, or fails if the input starts with "fail".
+class RunStreamEnclave : public EnclaveTestCase {
+ public:
+  // The size of the only buffer the enclave holds stream data in.
+  static constexpr size_t kBufferSize = 4096;
+
+  RunStreamEnclave() = default;
+
+  Status RunStream(StreamChannel *channel) override {
+    char buffer[kBufferSize];
+    bool first_chunk = true;
+    while (true) {
+      StatusOr<size_t> read_result = channel->Read(buffer, sizeof(buffer));
+      ASYLO_RETURN_IF_ERROR(read_result.status());
+      size_t size = read_result.ValueOrDie();
+      if (size == 0) {
+        return Status::OkStatus();
+      }
+      if (first_chunk && size >= 4 && memcmp(buffer, "fail", 4) == 0) {
+        return Status(error::GoogleError::INVALID_ARGUMENT, "Asked to fail");
+      }
+      first_chunk = false;
+      for (size_t i = 0; i < size; ++i) {
+        buffer[i] = toupper(static_cast<unsigned char>(buffer[i]));
+      }
+      ASYLO_RETURN_IF_ERROR(channel->Write(ByteContainerView(buffer, size)));
+    }
+  }
+};
+
+constexpr size_t RunStreamEnclave::kBufferSize;
+
+TrustedApplication *BuildTrustedApplication() { return new RunStreamEnclave; }
+
+}  // namespace asylo
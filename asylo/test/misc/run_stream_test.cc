@@ -0,0 +1,129 @@
+/*
+ *
+ * Copyright 2019 Asylo authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+#include <gtest/gtest.h>
+#include "asylo/crypto/util/byte_container_view.h"
+#include "asylo/test/util/enclave_test.h"
+#include "asylo/test/util/status_matchers.h"
+#include "asylo/util/status.h"
+#include "asylo/util/statusor.h"
+
+namespace asylo {
+namespace {
+
+// The size of the buffer the test enclave reads into.
+constexpr size_t kEnclaveBufferSize = 4096;
+
+class RunStreamTest : public EnclaveTest {
+ protected:
+  // Streams |size| bytes of a repeating lower-case pattern through the
+  // enclave, checking that every byte comes back in upper case and that no
+  // chunk exceeds the enclave's buffer.
+  void StreamPattern(size_t size) {
+    size_t produced = 0;
+    size_t consumed = 0;
+    bool output_ok = true;
+    ASYLO_ASSERT_OK(client_->EnterAndRunStream(
+        [size, &produced](char *buffer, size_t capacity) -> StatusOr<size_t> {
+          EXPECT_LE(capacity, kEnclaveBufferSize);
+          size_t count = std::min(capacity, size - produced);
+          for (size_t i = 0; i < count; ++i) {
+            buffer[i] = 'a' + (produced + i) % 26;
+          }
+          produced += count;
+          return count;
+        },
+        [&consumed, &output_ok](ByteContainerView chunk) {
+          EXPECT_LE(chunk.size(), kEnclaveBufferSize);
+          for (size_t i = 0; i < chunk.size(); ++i) {
+            if (chunk[i] != 'A' + (consumed + i) % 26) {
+              output_ok = false;
+            }
+          }
+          consumed += chunk.size();
+        }));
+    EXPECT_EQ(produced, size);
+    EXPECT_EQ(consumed, size);
+    EXPECT_TRUE(output_ok);
+  }
+};
+
+// Ensure a stream much larger than the enclave's buffer, and larger than the
+// enclave heap, makes the round trip intact.
+TEST_F(RunStreamTest, LargeStream) { StreamPattern(size_t{512} << 20); }
+
+// Ensure a stream smaller than a single chunk makes the round trip intact.
+TEST_F(RunStreamTest, SmallStream) { StreamPattern(10); }
+
+// Ensure an empty or missing source yields no output.
+TEST_F(RunStreamTest, EmptyStream) {
+  int calls = 0;
+  auto count_calls = [&calls](ByteContainerView chunk) { ++calls; };
+  ASYLO_ASSERT_OK(client_->EnterAndRunStream(
+      [](char *buffer, size_t capacity) -> StatusOr<size_t> { return 0; },
+      count_calls));
+  ASYLO_ASSERT_OK(client_->EnterAndRunStream(nullptr, count_calls));
+  EXPECT_EQ(calls, 0);
+}
+
+// Ensure errors returned by RunStream() reach the host.
+TEST_F(RunStreamTest, EnclaveErrorPropagates) {
+  EXPECT_THAT(client_->EnterAndRunStream(
+                  [](char *buffer, size_t capacity) -> StatusOr<size_t> {
+                    memcpy(buffer, "fail", 4);
+                    return 4;
+                  },
+                  nullptr),
+              StatusIs(error::GoogleError::INVALID_ARGUMENT));
+}
+
+// Ensure an error from the source ends the stream and reaches the host in
+// preference to the error the enclave sees.
+TEST_F(RunStreamTest, SourceErrorPropagates) {
+  int calls = 0;
+  EXPECT_THAT(client_->EnterAndRunStream(
+                  [&calls](char *buffer, size_t capacity) -> StatusOr<size_t> {
+                    if (++calls > 3) {
+                      return Status(error::GoogleError::DATA_LOSS, "Gone");
+                    }
+                    memset(buffer, 'x', capacity);
+                    return capacity;
+                  },
+                  nullptr),
+              StatusIs(error::GoogleError::DATA_LOSS));
+  EXPECT_EQ(calls, 4);
+}
+
+// Ensure a source that claims to have written more than its buffer holds is
+// rejected.
+TEST_F(RunStreamTest, SourceOverrunRejected) {
+  EXPECT_THAT(client_->EnterAndRunStream(
+                  [](char *buffer, size_t capacity) -> StatusOr<size_t> {
+                    return capacity + 1;
+                  },
+                  nullptr),
+              StatusIs(error::GoogleError::OUT_OF_RANGE));
+}
+
+}  // namespace
+}  // namespace asylo
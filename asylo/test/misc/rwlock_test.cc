@@ -24,6 +24,8 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "absl/synchronization/barrier.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "asylo/util/logging.h"
 #include "asylo/platform/common/time_util.h"
 #include "asylo/test/util/pthread_test_util.h"
@@ -105,10 +107,94 @@ TEST_F(RwLockTest, Init) {
   pthread_rwlock_t rwlock;
   ASSERT_EQ(pthread_rwlock_init(&rwlock, nullptr), 0);
 
+  ASSERT_EQ(rwlock._state, rwlock_._state);
+  ASSERT_EQ(rwlock._kind, rwlock_._kind);
   ASSERT_EQ(rwlock._write_owner, rwlock_._write_owner);
-  ASSERT_EQ(rwlock._queue._first, rwlock_._queue._first);
-  ASSERT_EQ(rwlock._lock, rwlock_._lock);
-  ASSERT_EQ(rwlock._reader_count, rwlock_._reader_count);
+  ASSERT_EQ(rwlock._futex, rwlock_._futex);
+}
+
+TEST_F(RwLockTest, Kind) {
+  pthread_rwlockattr_t attr;
+  ASSERT_EQ(pthread_rwlockattr_init(&attr), 0);
+
+  int kind;
+  ASSERT_EQ(pthread_rwlockattr_getkind_np(&attr, &kind), 0);
+  EXPECT_EQ(kind, PTHREAD_RWLOCK_DEFAULT_NP);
+
+  EXPECT_EQ(pthread_rwlockattr_setkind_np(&attr, -1), EINVAL);
+  ASSERT_EQ(
+      pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_READER_NP),
+      0);
+  ASSERT_EQ(pthread_rwlockattr_getkind_np(&attr, &kind), 0);
+  EXPECT_EQ(kind, PTHREAD_RWLOCK_PREFER_READER_NP);
+
+  pthread_rwlock_t rwlock;
+  ASSERT_EQ(pthread_rwlock_init(&rwlock, &attr), 0);
+  EXPECT_EQ(rwlock._kind, PTHREAD_RWLOCK_PREFER_READER_NP);
+  EXPECT_EQ(pthread_rwlock_destroy(&rwlock), 0);
+  EXPECT_EQ(pthread_rwlockattr_destroy(&attr), 0);
+}
+
+TEST_F(RwLockTest, Errors) {
+  EXPECT_EQ(pthread_rwlock_unlock(&rwlock_), EPERM);
+
+  ASSERT_EQ(pthread_rwlock_wrlock(&rwlock_), 0);
+  EXPECT_EQ(pthread_rwlock_wrlock(&rwlock_), EDEADLK);
+  EXPECT_EQ(pthread_rwlock_trywrlock(&rwlock_), EDEADLK);
+  EXPECT_EQ(pthread_rwlock_rdlock(&rwlock_), EDEADLK);
+  EXPECT_EQ(pthread_rwlock_tryrdlock(&rwlock_), EBUSY);
+  EXPECT_EQ(pthread_rwlock_destroy(&rwlock_), EBUSY);
+  ASSERT_EQ(pthread_rwlock_unlock(&rwlock_), 0);
+
+  ASSERT_EQ(pthread_rwlock_rdlock(&rwlock_), 0);
+  EXPECT_EQ(pthread_rwlock_trywrlock(&rwlock_), EBUSY);
+  EXPECT_EQ(pthread_rwlock_destroy(&rwlock_), EBUSY);
+  ASSERT_EQ(pthread_rwlock_unlock(&rwlock_), 0);
+
+  EXPECT_EQ(pthread_rwlock_destroy(&rwlock_), 0);
+}
+
+TEST_F(RwLockTest, WriterPreference) {
+  // A writer waiting for a read-locked rwlock_ keeps new readers out.
+  ASSERT_EQ(pthread_rwlock_rdlock(&rwlock_), 0);
+  std::thread writer([this]() {
+    EXPECT_EQ(pthread_rwlock_wrlock(&rwlock_), 0);
+    EXPECT_EQ(pthread_rwlock_unlock(&rwlock_), 0);
+  });
+
+  while (pthread_rwlock_tryrdlock(&rwlock_) == 0) {
+    EXPECT_EQ(pthread_rwlock_unlock(&rwlock_), 0);
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+
+  EXPECT_EQ(pthread_rwlock_unlock(&rwlock_), 0);
+  writer.join();
+  EXPECT_EQ(pthread_rwlock_destroy(&rwlock_), 0);
+}
+
+TEST_F(RwLockTest, ReaderPreference) {
+  // A rwlock that prefers readers admits new readers while a writer waits, so
+  // read locks may be taken recursively.
+  pthread_rwlockattr_t attr;
+  ASSERT_EQ(pthread_rwlockattr_init(&attr), 0);
+  ASSERT_EQ(
+      pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_READER_NP),
+      0);
+  pthread_rwlock_t rwlock;
+  ASSERT_EQ(pthread_rwlock_init(&rwlock, &attr), 0);
+
+  ASSERT_EQ(pthread_rwlock_rdlock(&rwlock), 0);
+  std::thread writer([&rwlock]() {
+    EXPECT_EQ(pthread_rwlock_wrlock(&rwlock), 0);
+    EXPECT_EQ(pthread_rwlock_unlock(&rwlock), 0);
+  });
+  absl::SleepFor(absl::Milliseconds(10));
+
+  EXPECT_EQ(pthread_rwlock_rdlock(&rwlock), 0);
+  EXPECT_EQ(pthread_rwlock_unlock(&rwlock), 0);
+  EXPECT_EQ(pthread_rwlock_unlock(&rwlock), 0);
+  writer.join();
+  EXPECT_EQ(pthread_rwlock_destroy(&rwlock), 0);
 }
 
 TEST_F(RwLockTest, ManyThreads) {
@@ -18,8 +18,10 @@
 
 #include <pthread.h>
 
+#include <cerrno>
 #include <cstdio>
 #include <thread>
+#include <vector>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -92,6 +94,26 @@ void *thread_specific_function(void *arg) {
   EXPECT_EQ(pthread_getspecific(tls_key), &used_for_address);
 }
 
+static pthread_key_t destructor_key;
+static volatile int destructor_count = 0;
+static volatile int destructor_resets = 0;
+
+void count_destructor(void *value) {
+  EXPECT_EQ(value, &global_arg);
+  ++destructor_count;
+
+  // Setting a new value from a destructor runs the destructor again.
+  if (destructor_resets > 0) {
+    --destructor_resets;
+    EXPECT_EQ(pthread_setspecific(destructor_key, &global_arg), 0);
+  }
+}
+
+void *set_destructor_key(void *arg) {
+  EXPECT_EQ(pthread_setspecific(destructor_key, arg), 0);
+  return nullptr;
+}
+
 static volatile int cc11_count = 0;
 static absl::Mutex cc11_mutex;
 
@@ -122,6 +144,55 @@ TEST(ThreadedTest, ThreadKeys) {
   EXPECT_EQ(pthread_key_delete(tls_key2), 0);
 }
 
+TEST(ThreadedTest, ThreadKeyDestructors) {
+  ASSERT_EQ(pthread_key_create(&destructor_key, count_destructor), 0);
+
+  // The destructor runs when a thread with a non-null value exits.
+  pthread_t thread;
+  destructor_count = 0;
+  ASSERT_EQ(
+      pthread_create(&thread, nullptr, set_destructor_key, &global_arg), 0);
+  EXPECT_EQ(pthread_join(thread, nullptr), 0);
+  EXPECT_EQ(destructor_count, 1);
+
+  // The destructor does not run for a null value.
+  destructor_count = 0;
+  ASSERT_EQ(pthread_create(&thread, nullptr, set_destructor_key, nullptr), 0);
+  EXPECT_EQ(pthread_join(thread, nullptr), 0);
+  EXPECT_EQ(destructor_count, 0);
+
+  // The destructor runs again for values set by the destructor.
+  destructor_count = 0;
+  destructor_resets = 2;
+  ASSERT_EQ(
+      pthread_create(&thread, nullptr, set_destructor_key, &global_arg), 0);
+  EXPECT_EQ(pthread_join(thread, nullptr), 0);
+  EXPECT_EQ(destructor_count, 3);
+
+  EXPECT_EQ(pthread_key_delete(destructor_key), 0);
+}
+
+TEST(ThreadedTest, ManyThreadKeys) {
+  // Keys beyond the initial per-thread storage can be set and read back.
+  constexpr int kNumKeys = 200;
+  std::vector<pthread_key_t> keys(kNumKeys);
+  for (int i = 0; i < kNumKeys; ++i) {
+    ASSERT_EQ(pthread_key_create(&keys[i], nullptr), 0);
+    EXPECT_EQ(pthread_setspecific(keys[i], &keys[i]), 0);
+  }
+  for (int i = 0; i < kNumKeys; ++i) {
+    EXPECT_EQ(pthread_getspecific(keys[i]), &keys[i]);
+    EXPECT_EQ(pthread_key_delete(keys[i]), 0);
+  }
+
+  // A value set before a key was deleted is not visible through a new key.
+  pthread_key_t key;
+  ASSERT_EQ(pthread_key_create(&key, nullptr), 0);
+  EXPECT_EQ(pthread_getspecific(key), nullptr);
+  EXPECT_EQ(pthread_key_delete(key), 0);
+  EXPECT_EQ(pthread_key_delete(key), EINVAL);
+}
+
 // Tests that pthread_create works and that the pthread_mutex_.* symbols are
 // present and do not crash. This does not test the correctness of the mutex.
 TEST(ThreadedTest, EnclaveThread) {
@@ -32,6 +32,11 @@ class MockEnclaveClient : public EnclaveClient {
   MockEnclaveClient() : EnclaveClient("mock") {}
 
   MOCK_METHOD2(EnterAndRun, Status(const EnclaveInput &, EnclaveOutput *));
+  using EnclaveClient::EnterAndRunRaw;
+  MOCK_METHOD2(EnterAndRunRaw,
+               Status(ByteContainerView, const RawOutputSink &));
+  MOCK_METHOD2(EnterAndRunStream,
+               Status(const StreamSource &, const RawOutputSink &));
   MOCK_CONST_METHOD0(get_name, const std::string &());
   MOCK_METHOD1(EnterAndInitialize, Status(const EnclaveConfig &));
   MOCK_METHOD1(EnterAndFinalize, Status(const EnclaveFinal &));